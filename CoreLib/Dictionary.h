@@ -6,6 +6,15 @@
 #include "Exception.h"
 #include "LibMath.h"
 #include "Hash.h"
+#include <stdint.h>
+#include <string.h>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CORELIB_HASH_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace CoreLib
 {
@@ -66,129 +75,304 @@ namespace CoreLib
 			return KeyValuePair<TKey, TValue>(k, v);
 		}
 
-		const float MaxLoadFactor = 0.7f;
+		// Hash tables keep one control byte per slot: Empty, or the low 7 bits (the tag) of a full slot's hash.
+		// Lookups compare a group of HashGroupWidth control bytes against the tag at once and only compare keys
+		// of matching slots. Slots are probed linearly from the home slot selected by the high hash bits, so a
+		// lookup ends at the first group that contains an empty slot and removal shifts the following entries
+		// back instead of leaving tombstones.
+		const int HashGroupWidth = 16;
+		// maximum number of occupied slots per eight slots
+		const int MaxLoadFactorEighths = 7;
 
-		template<typename TKey, typename TValue>
-		class Dictionary
+		struct HashFindResult
 		{
-			friend class Iterator;
-			friend class ItemProxy;
-		private:
-			inline int GetProbeOffset(int /*probeId*/) const
+			int ObjectPosition;
+			int InsertionPosition;
+			HashFindResult()
 			{
-				// quadratic probing
-				return 1;
+				ObjectPosition = -1;
+				InsertionPosition = -1;
 			}
+			HashFindResult(int objPos, int insertPos)
+			{
+				ObjectPosition = objPos;
+				InsertionPosition = insertPos;
+			}
+		};
+
+		class HashControlBytes
+		{
+		public:
+			static const signed char Empty = -128;
 		private:
-			int bucketSizeMinusOne;
-			int _count;
-			IntSet marks;
-			KeyValuePair<TKey, TValue>* hashMap;
-			void Free()
+			// bucketSize + HashGroupWidth - 1 bytes, the first HashGroupWidth - 1 bytes are mirrored after the end
+			// so that a group starting at any slot can be loaded without wrapping around
+			signed char * ctrl = nullptr;
+			int bucketSizeMinusOne = -1;
+			int hashShift = 64;
+			static inline int FirstBit(unsigned int mask)
+			{
+#ifdef _MSC_VER
+				unsigned long index;
+				_BitScanForward(&index, mask);
+				return (int)index;
+#else
+				return __builtin_ctz(mask);
+#endif
+			}
+			// bit i is set if byte i of the group equals val
+			static inline unsigned int MatchGroup(const signed char * group, signed char val)
+			{
+#ifdef CORELIB_HASH_SSE2
+				auto bytes = _mm_loadu_si128((const __m128i*)group);
+				return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(val)));
+#else
+				unsigned int mask = 0;
+				for (int i = 0; i < HashGroupWidth; i++)
+					if (group[i] == val)
+						mask |= 1u << i;
+				return mask;
+#endif
+			}
+			static inline unsigned int MatchFullGroup(const signed char * group)
+			{
+#ifdef CORELIB_HASH_SSE2
+				// empty bytes are the only ones with the sign bit set
+				return (unsigned int)(~_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group))) & 0xFFFF;
+#else
+				unsigned int mask = 0;
+				for (int i = 0; i < HashGroupWidth; i++)
+					if (group[i] != Empty)
+						mask |= 1u << i;
+				return mask;
+#endif
+			}
+			inline int GetHomePosition(uint64_t hash) const
 			{
-				if (hashMap)
-					delete[] hashMap;
-				hashMap = 0;
+				return (int)(hash >> hashShift);
 			}
-			inline bool IsDeleted(int pos) const
+			static inline signed char GetTag(uint64_t hash)
 			{
-				return marks.Contains((pos << 1) + 1);
+				return (signed char)((hash >> 25) & 0x7F);
 			}
-			inline bool IsEmpty(int pos) const
+		public:
+			static inline uint64_t MixHash(int hashCode)
 			{
-				return !marks.Contains((pos << 1));
+				// multiplicative hashing, the high bits select the home slot
+				return (uint64_t)(unsigned int)hashCode * 0x9E3779B97F4A7C15ull;
 			}
-			inline void SetDeleted(int pos, bool val)
+			HashControlBytes() = default;
+			HashControlBytes(const HashControlBytes & other)
 			{
-				if (val)
-					marks.Add((pos << 1) + 1);
-				else
-					marks.Remove((pos << 1) + 1);
+				*this = other;
 			}
-			inline void SetEmpty(int pos, bool val)
+			HashControlBytes(HashControlBytes && other)
 			{
-				if (val)
-					marks.Remove((pos << 1));
-				else
-					marks.Add((pos << 1));
+				*this = _Move(other);
 			}
-			struct FindPositionResult
+			HashControlBytes & operator = (const HashControlBytes & other)
 			{
-				int ObjectPosition;
-				int InsertionPosition;
-				FindPositionResult()
-				{
-					ObjectPosition = -1;
-					InsertionPosition = -1;
-				}
-				FindPositionResult(int objPos, int insertPos)
+				if (this == &other)
+					return *this;
+				Free();
+				bucketSizeMinusOne = other.bucketSizeMinusOne;
+				hashShift = other.hashShift;
+				if (other.ctrl)
 				{
-					ObjectPosition = objPos;
-					InsertionPosition = insertPos;
+					ctrl = new signed char[bucketSizeMinusOne + HashGroupWidth];
+					memcpy(ctrl, other.ctrl, bucketSizeMinusOne + HashGroupWidth);
 				}
-
-			};
-			template<typename T>
-			inline int GetHashPos(T & key) const
+				return *this;
+			}
+			HashControlBytes & operator = (HashControlBytes && other) noexcept
 			{
-				return ((unsigned int)(GetHashCode(key) * 2654435761)) % bucketSizeMinusOne;
+				if (this == &other)
+					return *this;
+				Free();
+				ctrl = other.ctrl;
+				bucketSizeMinusOne = other.bucketSizeMinusOne;
+				hashShift = other.hashShift;
+				other.ctrl = nullptr;
+				other.bucketSizeMinusOne = -1;
+				other.hashShift = 64;
+				return *this;
 			}
-			template<typename T>
-			FindPositionResult FindPosition(const T & key) const
+			~HashControlBytes()
 			{
-				int hashPos = GetHashPos((T&)key);
-				int insertPos = -1;
-				int numProbes = 0;
-				while (numProbes <= bucketSizeMinusOne)
+				Free();
+			}
+			void Free()
+			{
+				if (ctrl)
+					delete[] ctrl;
+				ctrl = nullptr;
+				bucketSizeMinusOne = -1;
+				hashShift = 64;
+			}
+			// bucketSize must be a power of two no less than HashGroupWidth
+			void Allocate(int bucketSize)
+			{
+				Free();
+				ctrl = new signed char[bucketSize + HashGroupWidth - 1];
+				bucketSizeMinusOne = bucketSize - 1;
+				hashShift = 64 - Math::Log2Floor(bucketSize);
+				Clear();
+			}
+			void Clear()
+			{
+				if (ctrl)
+					memset(ctrl, Empty, bucketSizeMinusOne + HashGroupWidth);
+			}
+			int GetBucketSize() const
+			{
+				return bucketSizeMinusOne + 1;
+			}
+			bool NeedsGrow(int count) const
+			{
+				return bucketSizeMinusOne == -1 || (count + 1) * 8 > (bucketSizeMinusOne + 1) * MaxLoadFactorEighths;
+			}
+			inline bool IsFull(int pos) const
+			{
+				return ctrl[pos] != Empty;
+			}
+			inline void SetControl(int pos, signed char val)
+			{
+				ctrl[pos] = val;
+				ctrl[((pos - (HashGroupWidth - 1)) & bucketSizeMinusOne) + (HashGroupWidth - 1)] = val;
+			}
+			inline void SetFull(int pos, uint64_t hash)
+			{
+				SetControl(pos, GetTag(hash));
+			}
+			// equals(pos) compares the key stored at slot pos
+			template<typename EqualsFunc>
+			inline HashFindResult Find(uint64_t hash, const EqualsFunc & equals) const
+			{
+				if (bucketSizeMinusOne == -1)
+					return HashFindResult();
+				int pos = GetHomePosition(hash);
+				auto tag = GetTag(hash);
+				while (true)
 				{
-					if (IsEmpty(hashPos))
-					{
-						if (insertPos == -1)
-							return FindPositionResult(-1, hashPos);
-						else
-							return FindPositionResult(-1, insertPos);
-					}
-					else if (IsDeleted(hashPos))
+					auto group = ctrl + pos;
+					auto match = MatchGroup(group, tag);
+					while (match)
 					{
-						if (insertPos == -1)
-							insertPos = hashPos;
+						int slot = (pos + FirstBit(match)) & bucketSizeMinusOne;
+						if (equals(slot))
+							return HashFindResult(slot, -1);
+						match &= match - 1;
 					}
-					else if (hashMap[hashPos].Key == key)
+					auto empty = MatchGroup(group, Empty);
+					if (empty)
+						return HashFindResult(-1, (pos + FirstBit(empty)) & bucketSizeMinusOne);
+					pos = (pos + HashGroupWidth) & bucketSizeMinusOne;
+				}
+			}
+			// returns the slot a key known not to be in the table is inserted into
+			inline int FindEmpty(uint64_t hash) const
+			{
+				int pos = GetHomePosition(hash);
+				while (true)
+				{
+					auto empty = MatchGroup(ctrl + pos, Empty);
+					if (empty)
+						return (pos + FirstBit(empty)) & bucketSizeMinusOne;
+					pos = (pos + HashGroupWidth) & bucketSizeMinusOne;
+				}
+			}
+			// Empties slot pos and moves the entries that follow it back to keep probe sequences unbroken.
+			// getHash(slot) returns the hash of the entry at slot, moveSlot(dst, src) moves it.
+			// Returns the slot that ends up empty.
+			template<typename GetHashFunc, typename MoveSlotFunc>
+			int Erase(int pos, const GetHashFunc & getHash, const MoveSlotFunc & moveSlot)
+			{
+				int hole = pos;
+				int next = (pos + 1) & bucketSizeMinusOne;
+				while (ctrl[next] != Empty)
+				{
+					int home = GetHomePosition(getHash(next));
+					// the entry may move to the hole if the hole is not before its home slot
+					if (((next - home) & bucketSizeMinusOne) >= ((next - hole) & bucketSizeMinusOne))
 					{
-						return FindPositionResult(hashPos, -1);
+						moveSlot(hole, next);
+						SetControl(hole, ctrl[next]);
+						hole = next;
 					}
-					numProbes++;
-					hashPos = (hashPos + GetProbeOffset(numProbes)) & bucketSizeMinusOne;
+					next = (next + 1) & bucketSizeMinusOne;
 				}
-				if (insertPos != -1)
-					return FindPositionResult(-1, insertPos);
-				throw InvalidOperationException("Hash map is full. This indicates an error in Key::Equal or Key::GetHashCode.");
+				SetControl(hole, Empty);
+				return hole;
+			}
+			// returns the first full slot at or after pos, or the bucket size if there is none
+			inline int NextFull(int pos) const
+			{
+				while (pos <= bucketSizeMinusOne)
+				{
+					auto full = MatchFullGroup(ctrl + pos);
+					if (full)
+						return Math::Min(pos + FirstBit(full), bucketSizeMinusOne + 1);
+					pos += HashGroupWidth;
+				}
+				return bucketSizeMinusOne + 1;
+			}
+		};
+
+		// Dictionary that enumerates its entries in slot order. Removal moves the entries that follow the removed
+		// one back, so entries must not be added or removed while the dictionary is enumerated: entries would be
+		// skipped or visited twice. Collect the keys to remove first, or use EnumerableDictionary, which supports
+		// removal during enumeration.
+		template<typename TKey, typename TValue>
+		class Dictionary
+		{
+			friend class Iterator;
+			friend class ItemProxy;
+		private:
+			HashControlBytes control;
+			int _count = 0;
+			KeyValuePair<TKey, TValue>* hashMap = nullptr;
+			void Free()
+			{
+				if (hashMap)
+					delete[] hashMap;
+				hashMap = 0;
+				control.Free();
+			}
+			template<typename T>
+			HashFindResult FindPosition(const T & key) const
+			{
+				return control.Find(HashControlBytes::MixHash(GetHashCode((T&)key)), [&](int pos)
+				{
+					return hashMap[pos].Key == key;
+				});
 			}
 			TValue & _Insert(KeyValuePair<TKey, TValue> && kvPair, int pos)
 			{
+				control.SetFull(pos, HashControlBytes::MixHash(GetHashCode(kvPair.Key)));
 				hashMap[pos] = _Move(kvPair);
-				SetEmpty(pos, false);
-				SetDeleted(pos, false);
 				return hashMap[pos].Value;
 			}
 			void Rehash()
 			{
-				if (bucketSizeMinusOne == -1 || _count / (float)bucketSizeMinusOne >= MaxLoadFactor)
+				if (control.NeedsGrow(_count))
 				{
-					int newSize = (bucketSizeMinusOne + 1) * 2;
+					int newSize = control.GetBucketSize() * 2;
 					if (newSize == 0)
 					{
 						newSize = 16;
 					}
 					Dictionary<TKey, TValue> newDict;
-					newDict.bucketSizeMinusOne = newSize - 1;
+					newDict.control.Allocate(newSize);
 					newDict.hashMap = new KeyValuePair<TKey, TValue>[newSize];
-					newDict.marks.SetMax(newSize * 2);
+					newDict._count = _count;
 					if (hashMap)
 					{
 						for (auto & kvPair : *this)
 						{
-							newDict.Add(_Move(kvPair));
+							auto hash = HashControlBytes::MixHash(GetHashCode(kvPair.Key));
+							int pos = newDict.control.FindEmpty(hash);
+							newDict.control.SetFull(pos, hash);
+							newDict.hashMap[pos] = _Move(kvPair);
 						}
 					}
 					*this = _Move(newDict);
@@ -246,13 +430,9 @@ namespace CoreLib
 				}
 				Iterator & operator ++()
 				{
-					if (pos > dict->bucketSizeMinusOne)
+					if (pos >= dict->control.GetBucketSize())
 						return *this;
-					pos++;
-					while (pos <= dict->bucketSizeMinusOne && (dict->IsDeleted(pos) || dict->IsEmpty(pos)))
-					{
-						pos++;
-					}
+					pos = dict->control.NextFull(pos + 1);
 					return *this;
 				}
 				Iterator operator ++(int)
@@ -283,19 +463,11 @@ namespace CoreLib
 
 			Iterator begin() const
 			{
-				int pos = 0;
-				while (pos < bucketSizeMinusOne + 1)
-				{
-					if (IsEmpty(pos) || IsDeleted(pos))
-						pos++;
-					else
-						break;
-				}
-				return Iterator(this, pos);
+				return Iterator(this, control.NextFull(0));
 			}
 			Iterator end() const
 			{
-				return Iterator(this, bucketSizeMinusOne + 1);
+				return Iterator(this, control.GetBucketSize());
 			}
 		public:
 			void Add(const TKey & key, const TValue & value)
@@ -321,21 +493,31 @@ namespace CoreLib
 				auto pos = FindPosition(key);
 				if (pos.ObjectPosition != -1)
 				{
-					SetDeleted(pos.ObjectPosition, true);
+					int hole = control.Erase(pos.ObjectPosition, [this](int slot)
+					{
+						return HashControlBytes::MixHash(GetHashCode(hashMap[slot].Key));
+					},
+					[this](int dst, int src)
+					{
+						hashMap[dst] = _Move(hashMap[src]);
+					});
+					// release the resources held by the removed entry
+					hashMap[hole] = KeyValuePair<TKey, TValue>();
 					_count--;
 				}
 			}
 			void Clear()
 			{
+				for (auto & kvPair : *this)
+					kvPair = KeyValuePair<TKey, TValue>();
 				_count = 0;
-
-				marks.Clear();
+				control.Clear();
 			}
 
 			template<typename T>
 			bool ContainsKey(const T & key) const
 			{
-				if (bucketSizeMinusOne == -1)
+				if (_count == 0)
 					return false;
 				auto pos = FindPosition(key);
 				return pos.ObjectPosition != -1;
@@ -343,7 +525,7 @@ namespace CoreLib
 			template<typename T>
 			bool TryGetValue(const T & key, TValue & value) const
 			{
-				if (bucketSizeMinusOne == -1)
+				if (_count == 0)
 					return false;
 				auto pos = FindPosition(key);
 				if (pos.ObjectPosition != -1)
@@ -356,7 +538,7 @@ namespace CoreLib
 			template<typename T>
 			TValue * TryGetValue(const T & key) const
 			{
-				if (bucketSizeMinusOne == -1)
+				if (_count == 0)
 					return nullptr;
 				auto pos = FindPosition(key);
 				if (pos.ObjectPosition != -1)
@@ -428,24 +610,17 @@ namespace CoreLib
 				Init(args...);
 			}
 		public:
-			Dictionary()
-			{
-				bucketSizeMinusOne = -1;
-				_count = 0;
-				hashMap = 0;
-			}
+			Dictionary() = default;
 			template<typename Arg, typename... Args>
 			Dictionary(Arg arg, Args... args)
 			{
 				Init(arg, args...);
 			}
 			Dictionary(const Dictionary<TKey, TValue> & other)
-				: bucketSizeMinusOne(-1), _count(0), hashMap(0)
 			{
 				*this = other;
 			}
 			Dictionary(Dictionary<TKey, TValue> && other)
-				: bucketSizeMinusOne(-1), _count(0), hashMap(0)
 			{
 				*this = (_Move(other));
 			}
@@ -454,12 +629,14 @@ namespace CoreLib
 				if (this == &other)
 					return *this;
 				Free();
-				bucketSizeMinusOne = other.bucketSizeMinusOne;
+				control = other.control;
 				_count = other._count;
-				hashMap = new KeyValuePair<TKey, TValue>[other.bucketSizeMinusOne + 1];
-				marks = other.marks;
-				for (int i = 0; i <= bucketSizeMinusOne; i++)
-					hashMap[i] = other.hashMap[i];
+				if (other.hashMap)
+				{
+					hashMap = new KeyValuePair<TKey, TValue>[control.GetBucketSize()];
+					for (int i = 0; i < control.GetBucketSize(); i++)
+						hashMap[i] = other.hashMap[i];
+				}
 				return *this;
 			}
 			Dictionary<TKey, TValue> & operator = (Dictionary<TKey, TValue> && other) noexcept
@@ -467,13 +644,11 @@ namespace CoreLib
 				if (this == &other)
 					return *this;
 				Free();
-				bucketSizeMinusOne = other.bucketSizeMinusOne;
+				control = _Move(other.control);
 				_count = other._count;
 				hashMap = other.hashMap;
-				marks = _Move(other.marks);
 				other.hashMap = 0;
 				other._count = 0;
-				other.bucketSizeMinusOne = -1;
 				return *this;
 			}
 			~Dictionary()
@@ -482,149 +657,102 @@ namespace CoreLib
 			}
 		};
 
+		// Dictionary that enumerates its entries in insertion order. Entries are stored densely in a list and the
+		// hash table maps to their indices. Removed entries leave holes that are compacted away when they outnumber
+		// the live entries. Entries can be removed while the dictionary is enumerated.
 		template<typename TKey, typename TValue>
 		class EnumerableDictionary
 		{
 			friend class Iterator;
 			friend class ItemProxy;
 		private:
-			inline int GetProbeOffset(int /*probeIdx*/) const
-			{
-				// quadratic probing
-				return 1;
-			}
-		private:
-			int bucketSizeMinusOne;
-			int _count;
-			IntSet marks;
-
-			// debug op
-			struct Op
-			{
-				TKey key;
-				int opType;
-				Op()
-				{}
-				Op(const TKey & key, int t)
-				{
-					this->key = key;
-					opType = t;
-				}
-			};
-			LinkedList<KeyValuePair<TKey, TValue>> kvPairs;
-			LinkedNode<KeyValuePair<TKey, TValue>>** hashMap;
+			HashControlBytes control;
+			int _count = 0;
+			// index of the entry in kvPairs for each full slot
+			int * hashMap = nullptr;
+			List<KeyValuePair<TKey, TValue>> kvPairs;
+			List<bool> isRemoved;
 			void Free()
 			{
 				if (hashMap)
 					delete[] hashMap;
 				hashMap = 0;
-				kvPairs.Clear();
-			}
-			inline bool IsDeleted(int pos) const
-			{
-				return marks.Contains((pos << 1) + 1);
+				control.Free();
+				kvPairs = List<KeyValuePair<TKey, TValue>>();
+				isRemoved = List<bool>();
 			}
-			inline bool IsEmpty(int pos) const
+			template<typename T>
+			HashFindResult FindPosition(const T & key) const
 			{
-				return !marks.Contains((pos << 1));
+				return control.Find(HashControlBytes::MixHash(GetHashCode((T&)key)), [&](int pos)
+				{
+					return kvPairs[hashMap[pos]].Key == key;
+				});
 			}
-			inline void SetDeleted(int pos, bool val)
+			TValue & _Insert(KeyValuePair<TKey, TValue> && kvPair, int pos)
 			{
-				if (val)
-					marks.Add((pos << 1) + 1);
-				else
-					marks.Remove((pos << 1) + 1);
+				control.SetFull(pos, HashControlBytes::MixHash(GetHashCode(kvPair.Key)));
+				hashMap[pos] = kvPairs.Count();
+				kvPairs.Add(_Move(kvPair));
+				isRemoved.Add(false);
+				return kvPairs.Last().Value;
 			}
-			inline void SetEmpty(int pos, bool val)
+			void RemoveEntry(int entry)
 			{
-				if (val)
-					marks.Remove((pos << 1));
-				else
-					marks.Add((pos << 1));
+				kvPairs[entry] = KeyValuePair<TKey, TValue>();
+				isRemoved[entry] = true;
+				// keep Last() cheap by trimming removed entries from the end
+				while (kvPairs.Count() && isRemoved.Last())
+				{
+					kvPairs.RemoveAt(kvPairs.Count() - 1);
+					isRemoved.RemoveAt(isRemoved.Count() - 1);
+				}
 			}
-			struct FindPositionResult
+			void Rehash()
 			{
-				int ObjectPosition;
-				int InsertionPosition;
-				FindPositionResult()
+				int bucketSize = control.GetBucketSize();
+				if (control.NeedsGrow(_count))
+					bucketSize = bucketSize ? bucketSize * 2 : 16;
+				else if (kvPairs.Count() - _count <= Math::Max(_count, HashGroupWidth))
+					return;
+				// compact entries and rebuild the index
+				int liveCount = 0;
+				for (int i = 0; i < kvPairs.Count(); i++)
 				{
-					ObjectPosition = -1;
-					InsertionPosition = -1;
+					if (isRemoved[i])
+						continue;
+					if (liveCount != i)
+						kvPairs[liveCount] = _Move(kvPairs[i]);
+					liveCount++;
 				}
-				FindPositionResult(int objPos, int insertPos)
+				for (int i = liveCount; i < kvPairs.Count(); i++)
+					kvPairs[i] = KeyValuePair<TKey, TValue>();
+				kvPairs.SetSize(liveCount);
+				isRemoved.SetSize(liveCount);
+				for (int i = 0; i < liveCount; i++)
+					isRemoved[i] = false;
+				if (bucketSize != control.GetBucketSize())
 				{
-					ObjectPosition = objPos;
-					InsertionPosition = insertPos;
+					if (hashMap)
+						delete[] hashMap;
+					hashMap = new int[bucketSize];
+					control.Allocate(bucketSize);
 				}
-
-			};
-			template<typename T>
-			inline int GetHashPos(T & key) const
-			{
-				return ((unsigned int)(GetHashCode(key) * 2654435761)) % bucketSizeMinusOne;
-			}
-			template<typename T>
-			FindPositionResult FindPosition(const T & key) const
-			{
-				int hashPos = GetHashPos((T&)key);
-				int insertPos = -1;
-				int numProbes = 0;
-				while (numProbes <= bucketSizeMinusOne)
+				else
+					control.Clear();
+				for (int i = 0; i < liveCount; i++)
 				{
-					if (IsEmpty(hashPos))
-					{
-						if (insertPos == -1)
-							return FindPositionResult(-1, hashPos);
-						else
-							return FindPositionResult(-1, insertPos);
-					}
-					else if (IsDeleted(hashPos))
-					{
-						if (insertPos == -1)
-							insertPos = hashPos;
-					}
-					else if (hashMap[hashPos]->Value.Key == key)
-					{
-						return FindPositionResult(hashPos, -1);
-					}
-					numProbes++;
-					hashPos = (hashPos + GetProbeOffset(numProbes)) & bucketSizeMinusOne;
+					auto hash = HashControlBytes::MixHash(GetHashCode(kvPairs[i].Key));
+					int pos = control.FindEmpty(hash);
+					control.SetFull(pos, hash);
+					hashMap[pos] = i;
 				}
-				if (insertPos != -1)
-					return FindPositionResult(-1, insertPos);
-				throw InvalidOperationException("Hash map is full. This indicates an error in Key::Equal or Key::GetHashCode.");
 			}
-			TValue & _Insert(KeyValuePair<TKey, TValue> && kvPair, int pos)
+			int NextEntry(int entry) const
 			{
-				auto node = kvPairs.AddLast();
-				node->Value = _Move(kvPair);
-				hashMap[pos] = node;
-				SetEmpty(pos, false);
-				SetDeleted(pos, false);
-				return node->Value.Value;
-			}
-			void Rehash()
-			{
-				if (bucketSizeMinusOne == -1 || _count / (float)bucketSizeMinusOne >= MaxLoadFactor)
-				{
-					int newSize = (bucketSizeMinusOne + 1) * 2;
-					if (newSize == 0)
-					{
-						newSize = 16;
-					}
-					EnumerableDictionary<TKey, TValue> newDict;
-					newDict.bucketSizeMinusOne = newSize - 1;
-					newDict.hashMap = new LinkedNode<KeyValuePair<TKey, TValue>>*[newSize];
-					newDict.marks.SetMax(newSize * 2);
-					if (hashMap)
-					{
-						for (auto & kvPair : *this)
-						{
-							newDict.Add(_Move(kvPair));
-						}
-					}
-					*this = _Move(newDict);
-				}
+				while (entry < kvPairs.Count() && isRemoved[entry])
+					entry++;
+				return entry;
 			}
 
 			bool AddIfNotExists(KeyValuePair<TKey, TValue> && kvPair)
@@ -653,8 +781,11 @@ namespace CoreLib
 				auto pos = FindPosition(kvPair.Key);
 				if (pos.ObjectPosition != -1)
 				{
-					hashMap[pos.ObjectPosition]->Delete();
-					return _Insert(_Move(kvPair), pos.ObjectPosition);
+					// a replaced entry moves to the end of the enumeration order
+					int oldEntry = hashMap[pos.ObjectPosition];
+					auto & result = _Insert(_Move(kvPair), pos.ObjectPosition);
+					RemoveEntry(oldEntry);
+					return result;
 				}
 				else if (pos.InsertionPosition != -1)
 				{
@@ -665,15 +796,63 @@ namespace CoreLib
 					throw InvalidOperationException("Inconsistent find result returned. This is a bug in Dictionary implementation.");
 			}
 		public:
-			typedef typename LinkedList<KeyValuePair<TKey, TValue>>::Iterator Iterator;
+			class Iterator
+			{
+			private:
+				const EnumerableDictionary<TKey, TValue> * dict;
+				int pos;
+			public:
+				KeyValuePair<TKey, TValue> & operator *() const
+				{
+					return dict->kvPairs[pos];
+				}
+				KeyValuePair<TKey, TValue> * operator ->() const
+				{
+					return &dict->kvPairs[pos];
+				}
+				Iterator & operator ++()
+				{
+					if (pos < dict->kvPairs.Count())
+						pos = dict->NextEntry(pos + 1);
+					return *this;
+				}
+				Iterator operator ++(int)
+				{
+					Iterator rs = *this;
+					operator++();
+					return rs;
+				}
+				bool operator != (const Iterator & _that) const
+				{
+					return !(*this == _that);
+				}
+				bool operator == (const Iterator & _that) const
+				{
+					// entries added during enumeration are visited, so the end is where the list currently ends
+					if (dict != _that.dict)
+						return false;
+					int end = dict ? dict->kvPairs.Count() : 0;
+					return Math::Min(pos, end) == Math::Min(_that.pos, end);
+				}
+				Iterator(const EnumerableDictionary<TKey, TValue> * _dict, int _pos)
+				{
+					this->dict = _dict;
+					this->pos = _pos;
+				}
+				Iterator()
+				{
+					this->dict = 0;
+					this->pos = 0;
+				}
+			};
 
-			typename LinkedList<KeyValuePair<TKey, TValue>>::Iterator begin() const
+			Iterator begin() const
 			{
-				return kvPairs.begin();
+				return Iterator(this, NextEntry(0));
 			}
-			typename LinkedList<KeyValuePair<TKey, TValue>>::Iterator end() const
+			Iterator end() const
 			{
-				return kvPairs.end();
+				return Iterator(this, kvPairs.Count());
 			}
 		public:
 			void Add(const TKey & key, const TValue & value)
@@ -699,9 +878,16 @@ namespace CoreLib
 					auto pos = FindPosition(key);
 					if (pos.ObjectPosition != -1)
 					{
-						kvPairs.Delete(hashMap[pos.ObjectPosition]);
-						hashMap[pos.ObjectPosition] = 0;
-						SetDeleted(pos.ObjectPosition, true);
+						int entry = hashMap[pos.ObjectPosition];
+						control.Erase(pos.ObjectPosition, [this](int slot)
+						{
+							return HashControlBytes::MixHash(GetHashCode(kvPairs[hashMap[slot]].Key));
+						},
+						[this](int dst, int src)
+						{
+							hashMap[dst] = hashMap[src];
+						});
+						RemoveEntry(entry);
 						_count--;
 					}
 				}
@@ -710,12 +896,13 @@ namespace CoreLib
 			{
 				_count = 0;
 				kvPairs.Clear();
-				marks.Clear();
+				isRemoved.Clear();
+				control.Clear();
 			}
 			template<typename T>
 			bool ContainsKey(const T & key) const
 			{
-				if (bucketSizeMinusOne == -1)
+				if (_count == 0)
 					return false;
 				auto pos = FindPosition(key);
 				return pos.ObjectPosition != -1;
@@ -723,24 +910,24 @@ namespace CoreLib
 			template<typename T>
 			TValue * TryGetValue(const T & key) const
 			{
-				if (bucketSizeMinusOne == -1)
+				if (_count == 0)
 					return nullptr;
 				auto pos = FindPosition(key);
 				if (pos.ObjectPosition != -1)
 				{
-					return &(hashMap[pos.ObjectPosition]->Value.Value);
+					return &(kvPairs[hashMap[pos.ObjectPosition]].Value);
 				}
 				return nullptr;
 			}
 			template<typename T>
 			bool TryGetValue(const T & key, TValue & value) const
 			{
-				if (bucketSizeMinusOne == -1)
+				if (_count == 0)
 					return false;
 				auto pos = FindPosition(key);
 				if (pos.ObjectPosition != -1)
 				{
-					value = hashMap[pos.ObjectPosition]->Value.Value;
+					value = kvPairs[hashMap[pos.ObjectPosition]].Value;
 					return true;
 				}
 				return false;
@@ -766,7 +953,7 @@ namespace CoreLib
 					auto pos = dict->FindPosition(key);
 					if (pos.ObjectPosition != -1)
 					{
-						return dict->hashMap[pos.ObjectPosition]->Value.Value;
+						return dict->kvPairs[dict->hashMap[pos.ObjectPosition]].Value;
 					}
 					else
 					{
@@ -804,7 +991,7 @@ namespace CoreLib
 			}
 			KeyValuePair<TKey, TValue> & First() const
 			{
-				return kvPairs.First();
+				return kvPairs[NextEntry(0)];
 			}
 			KeyValuePair<TKey, TValue> & Last() const
 			{
@@ -818,24 +1005,17 @@ namespace CoreLib
 				Init(args...);
 			}
 		public:
-			EnumerableDictionary()
-			{
-				bucketSizeMinusOne = -1;
-				_count = 0;
-				hashMap = 0;
-			}
+			EnumerableDictionary() = default;
 			template<typename Arg, typename... Args>
 			EnumerableDictionary(Arg arg, Args... args)
 			{
 				Init(arg, args...);
 			}
 			EnumerableDictionary(const EnumerableDictionary<TKey, TValue> & other)
-				: bucketSizeMinusOne(-1), _count(0), hashMap(0)
 			{
 				*this = other;
 			}
 			EnumerableDictionary(EnumerableDictionary<TKey, TValue> && other)
-				: bucketSizeMinusOne(-1), _count(0), hashMap(0)
 			{
 				*this = (_Move(other));
 			}
@@ -853,14 +1033,13 @@ namespace CoreLib
 				if (this == &other)
 					return *this;
 				Free();
-				bucketSizeMinusOne = other.bucketSizeMinusOne;
+				control = _Move(other.control);
 				_count = other._count;
 				hashMap = other.hashMap;
-				marks = _Move(other.marks);
+				kvPairs = _Move(other.kvPairs);
+				isRemoved = _Move(other.isRemoved);
 				other.hashMap = 0;
 				other._count = 0;
-				other.bucketSizeMinusOne = -1;
-				kvPairs = _Move(other.kvPairs);
 				return *this;
 			}
 			~EnumerableDictionary()
@@ -983,6 +1162,7 @@ namespace CoreLib
 				return dict.ContainsKey(obj);
 			}
 		};
+		// must not be modified while enumerated, like Dictionary
 		template <typename T>
 		class HashSet : public HashSetBase<T, Dictionary<T, _DummyClass>>
 		{};
@@ -0,0 +1,236 @@
+#include "FrameAllocator.h"
+#include <atomic>
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		namespace
+		{
+			const unsigned int HeaderMagic = 0xF5A7C4B1;
+			const unsigned char PoisonByte = 0xCD;
+
+			enum class ScratchKind : unsigned int
+			{
+				Heap, Arena
+			};
+
+			// precedes every allocation, keeps the returned pointers 16 byte aligned
+			struct AllocationHeader
+			{
+				long long FrameId;
+				unsigned int Magic;
+				ScratchKind Kind;
+			};
+			static_assert(sizeof(AllocationHeader) == 16, "allocation header must keep 16 byte alignment");
+
+			struct ScratchChunk
+			{
+				unsigned char * Memory;
+				size_t Size;
+			};
+
+			struct ScratchArena
+			{
+				List<ScratchChunk> Chunks;
+				long long FrameId = -1;
+				int ChunkIndex = 0;
+				size_t Offset = 0;
+				size_t BytesUsed = 0;
+			};
+
+			struct ThreadScratch
+			{
+				ScratchArena Arenas[FrameScratch::MaxFramesInFlight];
+				void Release()
+				{
+					for (auto & arena : Arenas)
+					{
+						for (auto & chunk : arena.Chunks)
+							AlignedFree(chunk.Memory);
+						arena = ScratchArena();
+					}
+				}
+				~ThreadScratch()
+				{
+					Release();
+				}
+			};
+
+			void DefaultErrorHandler(const void * /*ptr*/)
+			{
+				CORELIB_ABORT("frame scratch memory used after its frame expired");
+			}
+
+			std::atomic<long long> frameId(0);
+			std::atomic<int> framesInFlight(0);
+#ifdef _DEBUG
+			std::atomic<bool> debugChecks(true);
+#else
+			std::atomic<bool> debugChecks(false);
+#endif
+			std::atomic<FrameScratchErrorHandler> errorHandler(DefaultErrorHandler);
+			thread_local ThreadScratch threadScratch;
+
+			void RewindArena(ScratchArena & arena, long long frame)
+			{
+				if (arena.FrameId != -1)
+				{
+					if (debugChecks.load(std::memory_order_relaxed))
+					{
+						for (int i = 0; i <= arena.ChunkIndex && i < arena.Chunks.Count(); i++)
+						{
+							auto & chunk = arena.Chunks[i];
+							memset(chunk.Memory, PoisonByte, i == arena.ChunkIndex ? arena.Offset : chunk.Size);
+						}
+					}
+					// chunks the last use of this arena never reached were only needed by an earlier spike
+					for (int i = arena.ChunkIndex + 1; i < arena.Chunks.Count(); i++)
+						AlignedFree(arena.Chunks[i].Memory);
+					if (arena.ChunkIndex + 1 < arena.Chunks.Count())
+						arena.Chunks.SetSize(arena.ChunkIndex + 1);
+				}
+				arena.FrameId = frame;
+				arena.ChunkIndex = 0;
+				arena.Offset = 0;
+				arena.BytesUsed = 0;
+			}
+
+			unsigned char * BumpAlloc(ScratchArena & arena, size_t size)
+			{
+				while (arena.ChunkIndex < arena.Chunks.Count())
+				{
+					auto & chunk = arena.Chunks[arena.ChunkIndex];
+					if (arena.Offset + size <= chunk.Size)
+					{
+						auto rs = chunk.Memory + arena.Offset;
+						arena.Offset += size;
+						return rs;
+					}
+					arena.ChunkIndex++;
+					arena.Offset = 0;
+				}
+				ScratchChunk chunk;
+				chunk.Size = Math::Max(FrameScratch::ChunkSize, size);
+				chunk.Memory = (unsigned char*)AlignedAlloc(chunk.Size, 16);
+				if (!chunk.Memory)
+					return nullptr;
+				arena.Chunks.Add(chunk);
+				arena.ChunkIndex = arena.Chunks.Count() - 1;
+				arena.Offset = size;
+				return chunk.Memory;
+			}
+
+			bool IsHeaderAlive(const AllocationHeader * header)
+			{
+				if (header->Magic != HeaderMagic)
+					return false;
+				if (header->Kind == ScratchKind::Heap)
+					return true;
+				int ringLength = framesInFlight.load(std::memory_order_relaxed);
+				return ringLength != 0 && frameId.load(std::memory_order_acquire) - header->FrameId < ringLength;
+			}
+		}
+
+		void FrameScratch::Init(int pFramesInFlight)
+		{
+			if (pFramesInFlight < 1 || pFramesInFlight > MaxFramesInFlight)
+				throw ArgumentException("framesInFlight is out of range.");
+			framesInFlight.store(pFramesInFlight, std::memory_order_release);
+		}
+
+		void FrameScratch::Shutdown()
+		{
+			framesInFlight.store(0, std::memory_order_release);
+			threadScratch.Release();
+		}
+
+		void FrameScratch::BeginFrame()
+		{
+			frameId.fetch_add(1, std::memory_order_acq_rel);
+		}
+
+		bool FrameScratch::IsActive()
+		{
+			return framesInFlight.load(std::memory_order_relaxed) != 0;
+		}
+
+		long long FrameScratch::GetFrameId()
+		{
+			return frameId.load(std::memory_order_acquire);
+		}
+
+		void * FrameScratch::Alloc(size_t size)
+		{
+			size_t blockSize = (size + sizeof(AllocationHeader) + 15) & ~(size_t)15;
+			AllocationHeader * header = nullptr;
+			int ringLength = framesInFlight.load(std::memory_order_relaxed);
+			long long frame = frameId.load(std::memory_order_acquire);
+			if (ringLength)
+			{
+				auto & arena = threadScratch.Arenas[frame % ringLength];
+				if (arena.FrameId != frame)
+					RewindArena(arena, frame);
+				header = (AllocationHeader*)BumpAlloc(arena, blockSize);
+				if (header)
+				{
+					arena.BytesUsed += blockSize;
+					header->Kind = ScratchKind::Arena;
+				}
+			}
+			else
+			{
+				header = (AllocationHeader*)AlignedAlloc(blockSize, 16);
+				if (header)
+					header->Kind = ScratchKind::Heap;
+			}
+			if (!header)
+				return nullptr;
+			header->FrameId = frame;
+			header->Magic = HeaderMagic;
+			return header + 1;
+		}
+
+		void FrameScratch::Free(void * ptr)
+		{
+			if (!ptr)
+				return;
+			auto header = (AllocationHeader*)ptr - 1;
+			if (debugChecks.load(std::memory_order_relaxed) && !IsHeaderAlive(header))
+			{
+				errorHandler.load()(ptr);
+				return;
+			}
+			if (header->Kind == ScratchKind::Heap)
+			{
+				header->Magic = 0;
+				AlignedFree(header);
+			}
+		}
+
+		bool FrameScratch::IsAlive(const void * ptr)
+		{
+			return ptr && IsHeaderAlive((const AllocationHeader*)ptr - 1);
+		}
+
+		size_t FrameScratch::GetThreadBytesUsed()
+		{
+			int ringLength = framesInFlight.load(std::memory_order_relaxed);
+			if (!ringLength)
+				return 0;
+			long long frame = frameId.load(std::memory_order_acquire);
+			auto & arena = threadScratch.Arenas[frame % ringLength];
+			return arena.FrameId == frame ? arena.BytesUsed : 0;
+		}
+
+		void FrameScratch::SetDebugChecks(bool enable)
+		{
+			debugChecks.store(enable, std::memory_order_relaxed);
+		}
+
+		void FrameScratch::SetErrorHandler(FrameScratchErrorHandler handler)
+		{
+			errorHandler.store(handler ? handler : DefaultErrorHandler);
+		}
+	}
+}
@@ -0,0 +1,170 @@
+#ifndef CORE_LIB_FRAME_ALLOCATOR_H
+#define CORE_LIB_FRAME_ALLOCATOR_H
+
+#include "Basic.h"
+
+namespace CoreLib
+{
+	namespace Basic
+	{
+		typedef void (*FrameScratchErrorHandler)(const void * ptr);
+
+		// Linear scratch memory for allocations that do not outlive the frame that made them.
+		// Every thread owns a ring of arenas, one per frame in flight. An arena is rewound the first time
+		// its thread allocates after the ring came back to it, so memory handed out during frame N stays
+		// valid until frame N + framesInFlight begins. Free() never returns memory to an arena.
+		// Before Init() (tools, importers, tests) allocations go to the heap and Free() releases them.
+		// Arenas are released when their thread exits, so worker threads must outlive the memory they hand out.
+		class FrameScratch
+		{
+		public:
+			static constexpr int MaxFramesInFlight = 8;
+			static constexpr size_t ChunkSize = 256 * 1024;
+			static void Init(int framesInFlight);
+			static void Shutdown();
+			// advances the frame counter; call once per frame after the frame reusing this ring slot has retired
+			static void BeginFrame();
+			static bool IsActive();
+			static long long GetFrameId();
+			static void * Alloc(size_t size);
+			static void Free(void * ptr);
+			// heap fallback memory is always alive, scratch memory only while its frame is in flight
+			static bool IsAlive(const void * ptr);
+			// bytes the calling thread took from the arena of the current frame
+			static size_t GetThreadBytesUsed();
+			// debug checks poison rewound arenas and report frees of memory whose frame has expired;
+			// enabled by default in _DEBUG builds
+			static void SetDebugChecks(bool enable);
+			static void SetErrorHandler(FrameScratchErrorHandler handler);
+		};
+
+		class FrameAllocator
+		{
+		public:
+			void * Alloc(size_t size)
+			{
+				return FrameScratch::Alloc(size);
+			}
+			void Free(void * ptr)
+			{
+				FrameScratch::Free(ptr);
+			}
+		};
+
+		template<typename T>
+		using FrameList = List<T, FrameAllocator>;
+
+		// String has no allocator parameter; transient text is built here and only copied into a String
+		// when it has to be kept.
+		class FrameStringBuilder
+		{
+		private:
+			FrameList<char> buffer;
+		public:
+			FrameStringBuilder(int capacity = 128)
+			{
+				buffer.Reserve(capacity);
+				buffer.Add(0);
+			}
+			void Append(const char * str, int strLen)
+			{
+				buffer.UnsafeShrinkToSize(buffer.Count() - 1);
+				buffer.AddRange(str, strLen);
+				buffer.Add(0);
+			}
+			void Append(const char * str)
+			{
+				Append(str, (int)strlen(str));
+			}
+			void Append(const String & str)
+			{
+				Append(str.Buffer(), str.Length());
+			}
+			void Append(char ch)
+			{
+				Append(&ch, 1);
+			}
+			void Append(int value, int radix = 10)
+			{
+				char vBuffer[33];
+				int len = IntToAscii(vBuffer, value, radix);
+				ReverseInternalAscii(vBuffer, len);
+				Append(vBuffer, len);
+			}
+			void Append(unsigned int value, int radix = 10)
+			{
+				char vBuffer[33];
+				int len = IntToAscii(vBuffer, value, radix);
+				ReverseInternalAscii(vBuffer, len);
+				Append(vBuffer, len);
+			}
+			void Append(long long value, int radix = 10)
+			{
+				char vBuffer[65];
+				int len = IntToAscii(vBuffer, value, radix);
+				ReverseInternalAscii(vBuffer, len);
+				Append(vBuffer, len);
+			}
+			void Append(double val, const char * format = "%g")
+			{
+				char buf[128];
+				sprintf_s(buf, 128, format, val);
+				Append(buf, (int)strnlen_s(buf, 128));
+			}
+			FrameStringBuilder & operator << (char ch)
+			{
+				Append(ch);
+				return *this;
+			}
+			FrameStringBuilder & operator << (int val)
+			{
+				Append(val);
+				return *this;
+			}
+			FrameStringBuilder & operator << (unsigned int val)
+			{
+				Append(val);
+				return *this;
+			}
+			FrameStringBuilder & operator << (long long val)
+			{
+				Append(val);
+				return *this;
+			}
+			FrameStringBuilder & operator << (double val)
+			{
+				Append(val);
+				return *this;
+			}
+			FrameStringBuilder & operator << (const char * str)
+			{
+				Append(str);
+				return *this;
+			}
+			FrameStringBuilder & operator << (const String & str)
+			{
+				Append(str);
+				return *this;
+			}
+			const char * Buffer() const
+			{
+				return buffer.Buffer();
+			}
+			int Length() const
+			{
+				return buffer.Count() - 1;
+			}
+			void Clear()
+			{
+				buffer.Clear();
+				buffer.Add(0);
+			}
+			String ToString() const
+			{
+				return String(buffer.Buffer());
+			}
+		};
+	}
+}
+
+#endif
@@ -45,39 +45,92 @@ namespace CoreLib
 				return 0;
 			}
 		}
+		TextureFileReader::TextureFileReader(Stream * pStream)
+			: stream(pStream)
+		{
+			int headerSize = ReadInt32();
+			if (headerSize < 0)
+				throw IOException("Invalid texture content.");
+			// files written before a header field was added have a shorter header, the field keeps its default
+			int readSize = Math::Min(headerSize, (int)sizeof(TextureFileHeader));
+			if (stream->Read(&header, readSize) != readSize)
+				throw IOException("Invalid texture content.");
+			for (int i = readSize; i < headerSize; i++)
+			{
+				unsigned char skipped;
+				if (stream->Read(&skipped, 1) != 1)
+					throw IOException("Invalid texture content.");
+			}
+			if (header.Type == TextureType::Texture2D)
+				mipLevels = ReadInt32();
+		}
+
+		int TextureFileReader::ReadInt32()
+		{
+			int rs = 0;
+			if (stream->Read(&rs, sizeof(int)) != sizeof(int))
+				throw IOException("Invalid texture content.");
+			return rs;
+		}
+
+		void TextureFileReader::ReadLevel(ArrayView<unsigned char> levelData)
+		{
+			int level = nextLevel++;
+			int bufSize = ReadInt32();
+			if (level >= mipLevels || bufSize != (int)GetLevelSize(level) || levelData.Count() < bufSize)
+				throw IOException("Invalid texture content.");
+			if (stream->Read(levelData.Buffer(), bufSize) != bufSize)
+				throw IOException("Invalid texture content.");
+			if (header.RowOrder == TextureRowOrder::TopDown)
+			{
+				if (!CanFlipTextureRows(header.Format, GetLevelWidth(level), GetLevelHeight(level)))
+					throw IOException("Texture rows cannot be flipped.");
+				FlipTextureRows(header.Format, levelData, GetLevelWidth(level), GetLevelHeight(level));
+			}
+		}
+
 		void TextureFile::LoadFromStream(Stream* stream)
 		{
-			bool error = false;
-			BinaryReader reader(stream);
-			TextureFileHeader header;
-			int headerSize = reader.ReadInt32();
-			reader.Read((unsigned char*)& header, headerSize);
+			TextureFileReader reader(stream);
+			auto & header = reader.GetHeader();
 			type = header.Type;
+			rowOrder = TextureRowOrder::BottomUp;
 			if (header.Type == TextureType::Texture2D)
 			{
 				width = header.Width;
 				height = header.Height;
 				format = header.Format;
-				mipLevels = reader.ReadInt32();
+				mipLevels = reader.GetMipLevels();
 				Allocate(format, width, height, mipLevels, 1);
 				size_t offset = 0;
 				for (int i = 0; i < mipLevels; i++)
 				{
-					int bufSize = reader.ReadInt32();
-					reader.Read(buffer.Buffer() + offset, bufSize);
-					offset += bufSize;
-					if (bufSize != GetImagePlaneSize(Math::Max(1, width >> i), Math::Max(1, height >> i)))
-					{
-						error = true;
-						goto end;
-					}
+					auto levelSize = reader.GetLevelSize(i);
+					reader.ReadLevel(ArrayView<unsigned char>(buffer.Buffer() + offset, (int)levelSize));
+					offset += levelSize;
 				}
 			}
-		end:;
-			reader.ReleaseStream();
-			if (error)
-				throw IOException("Invalid texture content.");
 		}
+
+		bool TextureFile::FlipRows()
+		{
+			for (int i = 0; i < mipLevels; i++)
+			{
+				if (!CanFlipTextureRows(format, Math::Max(1, width >> i), Math::Max(1, height >> i)))
+					return false;
+			}
+			for (int a = 0; a < arrayLength; a++)
+			{
+				for (int i = 0; i < mipLevels; i++)
+				{
+					int w = Math::Max(1, width >> i), h = Math::Max(1, height >> i);
+					FlipTextureRows(format, ArrayView<unsigned char>(GetBuffer(i, a).Buffer(), (int)GetImagePlaneSize(w, h)), w, h);
+				}
+			}
+			rowOrder = rowOrder == TextureRowOrder::BottomUp ? TextureRowOrder::TopDown : TextureRowOrder::BottomUp;
+			return true;
+		}
+
 		void TextureFile::SaveToStream(Stream* stream)
 		{
 			BinaryWriter writer(stream);
@@ -89,6 +142,7 @@ namespace CoreLib
 			header.Height = height;
 			header.ArrayLength = arrayLength;
 			header.Type = type;
+			header.RowOrder = rowOrder;
 			writer.Write(header);
 			writer.Write(mipLevels);
 			size_t offset = 0;
@@ -112,6 +166,7 @@ namespace CoreLib
 			height = h;
 			mipLevels = levels;
 			arrayLength = arrayCount;
+			rowOrder = TextureRowOrder::BottomUp;
 			auto size = GetArrayStride() * (size_t)arrayCount;
 			buffer.SetSize((int)size);
 		}
@@ -154,6 +209,128 @@ namespace CoreLib
 			}
 		}
 
+		bool CanFlipTextureRows(TextureStorageFormat format, int width, int height)
+		{
+			switch (format)
+			{
+			case TextureStorageFormat::BC1:
+			case TextureStorageFormat::BC3:
+			case TextureStorageFormat::BC5:
+				// a texel row must stay in the same block row
+				return height <= 4 || (height & 3) == 0;
+			case TextureStorageFormat::BC6H:
+			case TextureStorageFormat::BC7:
+				// flipping would move the anchor texels of the partitions
+				return false;
+			default:
+				return width > 0 && height > 0;
+			}
+		}
+
+		// BC1 color indices: 2 bits per texel, one byte per row
+		static void FlipColorIndexRows(unsigned char * block, const int * rowMap)
+		{
+			unsigned char rows[4];
+			for (int r = 0; r < 4; r++)
+				rows[r] = block[4 + rowMap[r]];
+			for (int r = 0; r < 4; r++)
+				block[4 + r] = rows[r];
+		}
+
+		// BC4 (BC3 alpha, BC5 channels) indices: 3 bits per texel, 12 bits per row in a 48 bit little-endian field
+		static void FlipAlphaIndexRows(unsigned char * block, const int * rowMap)
+		{
+			unsigned long long bits = 0, flipped = 0;
+			for (int i = 0; i < 6; i++)
+				bits |= (unsigned long long)block[2 + i] << (i * 8);
+			for (int r = 0; r < 4; r++)
+				flipped |= ((bits >> (rowMap[r] * 12)) & 0xFFF) << (r * 12);
+			for (int i = 0; i < 6; i++)
+				block[2 + i] = (unsigned char)(flipped >> (i * 8));
+		}
+
+		void FlipTextureRows(TextureStorageFormat format, ArrayView<unsigned char> data, int width, int height)
+		{
+			int blockSize = 0;
+			switch (format)
+			{
+			case TextureStorageFormat::BC1:
+				blockSize = 8;
+				break;
+			case TextureStorageFormat::BC3:
+			case TextureStorageFormat::BC5:
+			case TextureStorageFormat::BC6H:
+			case TextureStorageFormat::BC7:
+				blockSize = 16;
+				break;
+			default:
+				break;
+			}
+			if (blockSize == 0)
+			{
+				int rowSize = (int)GetTextureDataSize(format, width, 1);
+				List<unsigned char> row;
+				row.SetSize(rowSize);
+				for (int i = 0; i < height / 2; i++)
+				{
+					auto row0 = data.Buffer() + (size_t)i * rowSize;
+					auto row1 = data.Buffer() + (size_t)(height - 1 - i) * rowSize;
+					memcpy(row.Buffer(), row0, rowSize);
+					memcpy(row0, row1, rowSize);
+					memcpy(row1, row.Buffer(), rowSize);
+				}
+				return;
+			}
+			// destination row r of each block takes source row rowMap[r]
+			int rowMap[4] = { 3, 2, 1, 0 };
+			if (height < 4)
+			{
+				// a single block row, the padding rows stay in place
+				for (int r = 0; r < 4; r++)
+					rowMap[r] = r < height ? height - 1 - r : r;
+			}
+			int blocksPerRow = (width + 3) >> 2;
+			int blockRows = (height + 3) >> 2;
+			int rowSize = blocksPerRow * blockSize;
+			unsigned char tmp[16];
+			for (int i = 0; i < (blockRows + 1) / 2; i++)
+			{
+				auto row0 = data.Buffer() + (size_t)i * rowSize;
+				auto row1 = data.Buffer() + (size_t)(blockRows - 1 - i) * rowSize;
+				for (int j = 0; j < blocksPerRow; j++)
+				{
+					auto block0 = row0 + j * blockSize;
+					auto block1 = row1 + j * blockSize;
+					if (block0 != block1)
+					{
+						memcpy(tmp, block0, blockSize);
+						memcpy(block0, block1, blockSize);
+						memcpy(block1, tmp, blockSize);
+					}
+					unsigned char * blocks[2] = { block0, block1 };
+					for (int b = 0; b < (block0 == block1 ? 1 : 2); b++)
+					{
+						switch (format)
+						{
+						case TextureStorageFormat::BC1:
+							FlipColorIndexRows(blocks[b], rowMap);
+							break;
+						case TextureStorageFormat::BC3:
+							FlipAlphaIndexRows(blocks[b], rowMap);
+							FlipColorIndexRows(blocks[b] + 8, rowMap);
+							break;
+						case TextureStorageFormat::BC5:
+							FlipAlphaIndexRows(blocks[b], rowMap);
+							FlipAlphaIndexRows(blocks[b] + 8, rowMap);
+							break;
+						default:
+							throw NotImplementedException("block compressed format cannot be flipped.");
+						}
+					}
+				}
+			}
+		}
+
 		CoreLib::List<char> TranslateThreeChannelTextureFormat(char* buffer, int pixelCount, int channelSize)
 		{
 			CoreLib::List<char> result;
@@ -27,6 +27,13 @@ namespace CoreLib
 			R_F32, RG_F32, RGB_F32, RGBA_F32, 
             BC1, BC5, BC3, BC6H, BC7
 		};
+		// Order of the image rows in a texture file. Textures are uploaded bottom-up (the first row is the bottom
+		// of the image), which is how the converters store them. Files written before the row order was
+		// recorded are bottom-up.
+		enum class TextureRowOrder : int
+		{
+			BottomUp, TopDown
+		};
 		class TextureFileHeader
 		{
 		public:
@@ -34,25 +41,65 @@ namespace CoreLib
 			TextureStorageFormat Format;
 			int Width, Height;
             int ArrayLength = 0;
+			TextureRowOrder RowOrder = TextureRowOrder::BottomUp;
 		};
 
         size_t GetTextureDataSize(TextureStorageFormat format, int width, int height);
 
+		// Reverses the row order of a width x height image plane in place. Block compressed planes are flipped
+		// without decompression, by reversing the block rows and the index rows inside each block. That is
+		// possible for BC1, BC3 and BC5 when the height is a multiple of 4 or fits in one block row.
+		bool CanFlipTextureRows(TextureStorageFormat format, int width, int height);
+		void FlipTextureRows(TextureStorageFormat format, CoreLib::Basic::ArrayView<unsigned char> data, int width, int height);
+
+		// Reads a 2D texture file one mip level at a time into memory provided by the caller, so that a level
+		// can be read straight into upload memory. Levels are returned bottom-up whatever the file row order.
+		// The reader does not own the stream.
+		class TextureFileReader
+		{
+		private:
+			CoreLib::IO::Stream * stream;
+			TextureFileHeader header;
+			int mipLevels = 0, nextLevel = 0;
+			int ReadInt32();
+		public:
+			TextureFileReader(CoreLib::IO::Stream * pStream);
+			TextureFileHeader & GetHeader()
+			{
+				return header;
+			}
+			int GetMipLevels()
+			{
+				return mipLevels;
+			}
+			int GetLevelWidth(int level)
+			{
+				return Math::Max(1, header.Width >> level);
+			}
+			int GetLevelHeight(int level)
+			{
+				return Math::Max(1, header.Height >> level);
+			}
+			size_t GetLevelSize(int level)
+			{
+				return GetTextureDataSize(header.Format, GetLevelWidth(level), GetLevelHeight(level));
+			}
+			// reads the next mip level into the first GetLevelSize(level) bytes of `levelData`
+			void ReadLevel(CoreLib::Basic::ArrayView<unsigned char> levelData);
+		};
+
 		class TextureFile
 		{
 		private:
 			CoreLib::Basic::List<unsigned char> buffer;
-			TextureStorageFormat format;
-            TextureType type;
-			int width, height, arrayLength = 1;
-            int mipLevels;
+			TextureStorageFormat format = TextureStorageFormat::RGBA8;
+			TextureType type = TextureType::Texture2D;
+			int width = 0, height = 0, arrayLength = 1;
+			int mipLevels = 0;
+			TextureRowOrder rowOrder = TextureRowOrder::BottomUp;
 			void LoadFromStream(CoreLib::IO::Stream * stream);
 		public:
-			TextureFile()
-			{
-				width = height = 0;
-				format = TextureStorageFormat::RGBA8;
-			}
+			TextureFile() = default;
 			TextureFile(CoreLib::Basic::String fileName);
 			TextureFile(CoreLib::IO::Stream * stream);
 			TextureStorageFormat GetFormat()
@@ -71,6 +118,29 @@ namespace CoreLib
 			{
 				return mipLevels;
 			}
+			// Loaded files are always bottom-up. The compressors keep the row order of their input, so data
+			// compressed from an image in file order is labeled TopDown and then flipped with FlipRows().
+			TextureRowOrder GetRowOrder()
+			{
+				return rowOrder;
+			}
+			void SetRowOrder(TextureRowOrder order)
+			{
+				rowOrder = order;
+			}
+			// releases the pixel data and resets the file to an empty texture
+			void Clear()
+			{
+				buffer = CoreLib::Basic::List<unsigned char>();
+				format = TextureStorageFormat::RGBA8;
+				type = TextureType::Texture2D;
+				width = height = 0;
+				arrayLength = 1;
+				mipLevels = 0;
+				rowOrder = TextureRowOrder::BottomUp;
+			}
+			// flips all mip levels and the row order label, returns false if CanFlipTextureRows() fails for a level
+			bool FlipRows();
             size_t GetImagePlaneSize(int w, int h)
             {
                 return GetTextureDataSize(format, w, h);
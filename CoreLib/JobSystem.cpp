@@ -0,0 +1,260 @@
+#include "JobSystem.h"
+#include <condition_variable>
+
+namespace CoreLib
+{
+	namespace Threading
+	{
+		using namespace CoreLib::Basic;
+
+		class WorkQueue
+		{
+		private:
+			SpinLock lock;
+			List<Job*> ring;
+			int head = 0;
+			int count = 0;
+			void Grow()
+			{
+				List<Job*> newRing;
+				newRing.SetSize(Math::Max(64, ring.Count() * 2));
+				for (int i = 0; i < count; i++)
+					newRing[i] = ring[(head + i) & (ring.Count() - 1)];
+				ring.SwapWith(newRing);
+				head = 0;
+			}
+		public:
+			void Push(Job * job)
+			{
+				lock.Lock();
+				if (count == ring.Count())
+					Grow();
+				ring[(head + count) & (ring.Count() - 1)] = job;
+				count++;
+				lock.Unlock();
+			}
+			// the owner takes the most recently pushed job
+			Job * Pop()
+			{
+				Job * job = nullptr;
+				lock.Lock();
+				if (count)
+				{
+					count--;
+					job = ring[(head + count) & (ring.Count() - 1)];
+				}
+				lock.Unlock();
+				return job;
+			}
+			// thieves take the oldest job, and give up instead of contending for the lock
+			Job * Steal()
+			{
+				Job * job = nullptr;
+				if (!lock.TryLock())
+					return nullptr;
+				if (count)
+				{
+					job = ring[head];
+					head = (head + 1) & (ring.Count() - 1);
+					count--;
+				}
+				lock.Unlock();
+				return job;
+			}
+		};
+
+		struct JobSystemState
+		{
+			List<WorkQueue*> queues;
+			List<RefPtr<Thread>> workers;
+			std::atomic<bool> running;
+			std::atomic<int> queuedJobs;
+			std::atomic<int> sleepingWorkers;
+			std::mutex sleepMutex;
+			std::condition_variable wakeCondition;
+			SpinLock freeListLock;
+			Job * freeList = nullptr;
+		};
+
+		static JobSystemState * state = nullptr;
+		static thread_local int currentThreadIndex = 0;
+
+		static void PushJob(Job * job)
+		{
+			state->queues[currentThreadIndex]->Push(job);
+			state->queuedJobs.fetch_add(1);
+			if (state->sleepingWorkers.load() > 0)
+			{
+				std::lock_guard<std::mutex> guard(state->sleepMutex);
+				state->wakeCondition.notify_one();
+			}
+		}
+
+		static Job * FindJob()
+		{
+			int queueCount = state->queues.Count();
+			auto job = state->queues[currentThreadIndex]->Pop();
+			for (int i = 1; !job && i < queueCount; i++)
+				job = state->queues[(currentThreadIndex + i) % queueCount]->Steal();
+			if (job)
+				state->queuedJobs.fetch_sub(1);
+			return job;
+		}
+
+		static void FreeJob(Job * job)
+		{
+			job->Body = Func<void>();
+			job->Counter = nullptr;
+			state->freeListLock.Lock();
+			job->NextFree = state->freeList;
+			state->freeList = job;
+			state->freeListLock.Unlock();
+		}
+
+		void JobSystem::Execute(Job * job)
+		{
+			job->Body();
+			auto counter = job->Counter;
+			FreeJob(job);
+			if (counter)
+				Finish(counter);
+		}
+
+		void JobSystem::WorkerProc(int threadIndex)
+		{
+			currentThreadIndex = threadIndex;
+			while (state->running.load())
+			{
+				if (auto job = FindJob())
+				{
+					Execute(job);
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(state->sleepMutex);
+				state->sleepingWorkers.fetch_add(1);
+				state->wakeCondition.wait(lock, []()
+				{
+					return !state->running.load() || state->queuedJobs.load() > 0;
+				});
+				state->sleepingWorkers.fetch_sub(1);
+			}
+		}
+
+		void JobSystem::Finish(JobCounter * counter)
+		{
+			// the continuation lock is held across the decrement so that a waiter cannot
+			// observe zero and destroy the counter while we still touch it
+			List<Job*> readyJobs;
+			counter->continuationLock.Lock();
+			if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				readyJobs.SwapWith(counter->continuations);
+			counter->continuationLock.Unlock();
+			for (auto job : readyJobs)
+				PushJob(job);
+		}
+
+		Job * JobSystem::AllocJob()
+		{
+			Job * job = nullptr;
+			state->freeListLock.Lock();
+			if (state->freeList)
+			{
+				job = state->freeList;
+				state->freeList = job->NextFree;
+			}
+			state->freeListLock.Unlock();
+			if (!job)
+				job = new Job();
+			job->NextFree = nullptr;
+			return job;
+		}
+
+		void JobSystem::Submit(Job * job, JobCounter * dependency)
+		{
+			if (dependency)
+			{
+				dependency->continuationLock.Lock();
+				bool deferred = dependency->pending.load(std::memory_order_acquire) != 0;
+				if (deferred)
+					dependency->continuations.Add(job);
+				dependency->continuationLock.Unlock();
+				if (deferred)
+					return;
+			}
+			PushJob(job);
+		}
+
+		void JobSystem::Init(int workerCount)
+		{
+			if (state)
+				return;
+			if (workerCount < 0)
+				workerCount = ParallelSystemInfo::GetProcessorCount() - 1;
+			state = new JobSystemState();
+			state->running = true;
+			state->queuedJobs = 0;
+			state->sleepingWorkers = 0;
+			currentThreadIndex = 0;
+			for (int i = 0; i <= workerCount; i++)
+				state->queues.Add(new WorkQueue());
+			for (int i = 1; i <= workerCount; i++)
+				state->workers.Add(new Thread(new ThreadProc([i]() { WorkerProc(i); })));
+		}
+
+		void JobSystem::Destroy()
+		{
+			if (!state)
+				return;
+			// drain remaining work so that counters held by callers are released
+			while (auto job = FindJob())
+				Execute(job);
+			{
+				std::lock_guard<std::mutex> guard(state->sleepMutex);
+				state->running = false;
+				state->wakeCondition.notify_all();
+			}
+			for (auto & worker : state->workers)
+				worker->Join();
+			for (auto queue : state->queues)
+				delete queue;
+			while (state->freeList)
+			{
+				auto next = state->freeList->NextFree;
+				delete state->freeList;
+				state->freeList = next;
+			}
+			delete state;
+			state = nullptr;
+		}
+
+		bool JobSystem::IsInitialized()
+		{
+			return state != nullptr;
+		}
+
+		int JobSystem::GetThreadCount()
+		{
+			return state ? state->queues.Count() : 1;
+		}
+
+		int JobSystem::GetCurrentThreadIndex()
+		{
+			return currentThreadIndex;
+		}
+
+		void JobSystem::Wait(JobCounter & counter)
+		{
+			while (!counter.IsDone())
+			{
+				Job * job = state ? FindJob() : nullptr;
+				if (job)
+					Execute(job);
+				else
+					std::this_thread::yield();
+			}
+			// synchronize with the thread that released the counter before the caller reuses it
+			counter.continuationLock.Lock();
+			counter.continuationLock.Unlock();
+		}
+	}
+}
@@ -0,0 +1,129 @@
+#ifndef CORE_LIB_JOB_SYSTEM_H
+#define CORE_LIB_JOB_SYSTEM_H
+
+#include "Threading.h"
+#include "Func.h"
+#include "List.h"
+
+namespace CoreLib
+{
+	namespace Threading
+	{
+		struct Job;
+
+		// Tracks a group of outstanding jobs. The counter reaches zero once every job
+		// submitted against it has finished. A counter can also be passed as the dependency
+		// of later jobs, which are held back until it reaches zero.
+		// A counter must not be destroyed or reused before it has been waited on.
+		class JobCounter
+		{
+			friend class JobSystem;
+		private:
+			std::atomic<int> pending;
+			SpinLock continuationLock;
+			CoreLib::Basic::List<Job*> continuations;
+		public:
+			JobCounter()
+			{
+				pending = 0;
+			}
+			JobCounter(const JobCounter &) = delete;
+			JobCounter & operator = (const JobCounter &) = delete;
+			bool IsDone() const
+			{
+				return pending.load(std::memory_order_acquire) == 0;
+			}
+			int GetPendingCount() const
+			{
+				return pending.load(std::memory_order_acquire);
+			}
+		};
+
+		struct Job
+		{
+			CoreLib::Basic::Func<void> Body;
+			JobCounter * Counter = nullptr;
+			Job * NextFree = nullptr;
+		};
+
+		// Work-stealing job scheduler. Each worker (and the thread that called Init) owns a
+		// deque: it pushes and pops its own jobs LIFO, idle workers steal FIFO from others.
+		// Before Init is called, or after Destroy, jobs run inline on the calling thread.
+		class JobSystem
+		{
+		private:
+			static Job * AllocJob();
+			static void Submit(Job * job, JobCounter * dependency);
+			static void Finish(JobCounter * counter);
+			static void Execute(Job * job);
+			static void WorkerProc(int threadIndex);
+		public:
+			// workerCount < 0 creates one worker per processor, minus the calling thread.
+			static void Init(int workerCount = -1);
+			static void Destroy();
+			static bool IsInitialized();
+			// number of threads that execute jobs, including the thread that called Init.
+			static int GetThreadCount();
+			// index of the calling thread in [0, GetThreadCount()), 0 for non-worker threads.
+			static int GetCurrentThreadIndex();
+
+			template<typename TFunc>
+			static void Run(const TFunc & func, JobCounter * counter = nullptr, JobCounter * dependency = nullptr)
+			{
+				if (!IsInitialized())
+				{
+					if (dependency)
+						Wait(*dependency);
+					func();
+					return;
+				}
+				auto job = AllocJob();
+				job->Body = CoreLib::Basic::Func<void>(func);
+				job->Counter = counter;
+				if (counter)
+					counter->pending.fetch_add(1, std::memory_order_relaxed);
+				Submit(job, dependency);
+			}
+
+			// Blocks until the counter reaches zero, executing pending jobs in the meantime.
+			static void Wait(JobCounter & counter);
+
+			// Calls body(start, end) over consecutive ranges of at most grainSize elements.
+			// The range partitioning depends only on the arguments, so per-range results
+			// can be merged in a deterministic order.
+			template<typename TFunc>
+			static void ParallelForRange(int begin, int end, int grainSize, const TFunc & body)
+			{
+				if (end <= begin)
+					return;
+				if (grainSize < 1)
+					grainSize = 1;
+				if (!IsInitialized() || end - begin <= grainSize)
+				{
+					body(begin, end);
+					return;
+				}
+				JobCounter counter;
+				for (int start = begin + grainSize; start < end; start += grainSize)
+				{
+					int stop = CoreLib::Basic::Math::Min(start + grainSize, end);
+					Run([&body, start, stop]() { body(start, stop); }, &counter);
+				}
+				body(begin, begin + grainSize);
+				Wait(counter);
+			}
+
+			template<typename TFunc>
+			static void ParallelFor(int begin, int end, int grainSize, const TFunc & body)
+			{
+				ParallelForRange(begin, end, grainSize, [&body](int start, int stop)
+				{
+					for (int i = start; i < stop; i++)
+						body(i);
+				});
+			}
+		};
+	}
+}
+
+#endif
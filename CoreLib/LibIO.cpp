@@ -18,6 +18,14 @@ namespace filesystem = std::filesystem;
 #include <direct.h>
 #endif
 #endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 namespace CoreLib
 {
 	namespace IO
@@ -44,6 +52,74 @@ namespace CoreLib
 #endif
 		}
 
+		MemoryMappedFile::MemoryMappedFile(const String & fileName)
+		{
+#ifdef _WIN32
+			HANDLE file = CreateFileW(fileName.ToWString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				throw IOException("Cannot open file '" + fileName + "'");
+			fileHandle = file;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize))
+			{
+				CloseHandle(file);
+				throw IOException("Cannot query size of file '" + fileName + "'");
+			}
+			size = (size_t)fileSize.QuadPart;
+			if (size == 0)
+				return;
+			mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mappingHandle)
+				data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+			if (!data)
+			{
+				if (mappingHandle)
+					CloseHandle(mappingHandle);
+				CloseHandle(file);
+				throw IOException("Cannot map file '" + fileName + "'");
+			}
+#else
+			int file = open(fileName.Buffer(), O_RDONLY);
+			if (file == -1)
+				throw IOException("Cannot open file '" + fileName + "'");
+			struct stat fileStat;
+			if (fstat(file, &fileStat) != 0)
+			{
+				close(file);
+				throw IOException("Cannot query size of file '" + fileName + "'");
+			}
+			size = (size_t)fileStat.st_size;
+			if (size != 0)
+			{
+				void * ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+				if (ptr == MAP_FAILED)
+				{
+					close(file);
+					throw IOException("Cannot map file '" + fileName + "'");
+				}
+				data = (unsigned char*)ptr;
+			}
+			// the mapping keeps its own reference to the file
+			close(file);
+#endif
+		}
+
+		MemoryMappedFile::~MemoryMappedFile()
+		{
+#ifdef _WIN32
+			if (data)
+				UnmapViewOfFile(data);
+			if (mappingHandle)
+				CloseHandle(mappingHandle);
+			if (fileHandle)
+				CloseHandle(fileHandle);
+#else
+			if (data)
+				munmap(data, size);
+#endif
+		}
+
 		String Path::TruncateExt(const String & path)
 		{
 			int dotPos = path.LastIndexOf('.');
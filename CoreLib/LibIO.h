@@ -20,6 +20,32 @@ namespace CoreLib
             static void WriteAllBytes(const CoreLib::Basic::String & fileName, void * buffer, size_t size);
 		};
 
+		// Maps an entire file read-only into the address space. The mapping starts at a page boundary,
+		// so data stored at page aligned file offsets can be handed to the renderer without copying.
+		class MemoryMappedFile : public CoreLib::RefObject
+		{
+		private:
+			unsigned char * data = nullptr;
+			size_t size = 0;
+#ifdef _WIN32
+			void * fileHandle = nullptr;
+			void * mappingHandle = nullptr;
+#endif
+		public:
+			MemoryMappedFile(const CoreLib::Basic::String & fileName);
+			~MemoryMappedFile();
+			MemoryMappedFile(const MemoryMappedFile &) = delete;
+			MemoryMappedFile & operator = (const MemoryMappedFile &) = delete;
+			const unsigned char * Buffer() const
+			{
+				return data;
+			}
+			size_t Size() const
+			{
+				return size;
+			}
+		};
+
 		enum class DirectoryEntryType
 		{
 			Unknown,
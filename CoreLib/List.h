@@ -134,19 +134,19 @@ namespace CoreLib
 			{
 				Init(val, args...);
 			}
-			List(const List<T> & list)
+			List(const List<T, TAllocator> & list)
 				: buffer(0), _count(0), bufferSize(0)
 			{
 				this->operator=(list);
 			}
-			List(List<T> && list)
+			List(List<T, TAllocator> && list)
 				: buffer(0), _count(0), bufferSize(0)
 			{
-				this->operator=(static_cast<List<T>&&>(list));
+				this->operator=(static_cast<List<T, TAllocator>&&>(list));
 			}
-			static List<T> Create(const T & val, int count)
+			static List<T, TAllocator> Create(const T & val, int count)
 			{
-				List<T> rs;
+				List<T, TAllocator> rs;
 				rs.SetSize(count);
 				for (int i = 0; i < count; i++)
 					rs[i] = val;
@@ -156,7 +156,7 @@ namespace CoreLib
 			{
 				Free();
 			}
-			List<T> & operator=(const List<T> & list)
+			List<T, TAllocator> & operator=(const List<T, TAllocator> & list)
 			{
 				Free();
 				AddRange(list);
@@ -164,7 +164,7 @@ namespace CoreLib
 				return *this;
 			}
 
-			List<T> & operator=(List<T> && list)
+			List<T, TAllocator> & operator=(List<T, TAllocator> && list)
 			{
 				Free();
 				_count = list._count;
@@ -206,9 +206,6 @@ namespace CoreLib
 				int tmpCount = this->_count;
 				this->_count = other._count;
 				other._count = tmpCount;
-				TAllocator tmpAlloc = _Move(this->allocator);
-				this->allocator = _Move(other.allocator);
-				other.allocator = _Move(tmpAlloc);
 			}
 
 			T* ReleaseBuffer()
@@ -334,9 +331,10 @@ namespace CoreLib
 			//	InsertRange(_count, &val, 1);
 			//}
 
-			void InsertRange(int id, const List<T> & list)
+			template<typename TOtherAllocator>
+			void InsertRange(int id, const List<T, TOtherAllocator> & list)
 			{
-				InsertRange(id, list.buffer, list._count);
+				InsertRange(id, list.Buffer(), list.Count());
 			}
 
 			void AddRange(ArrayView<T> list)
@@ -349,9 +347,10 @@ namespace CoreLib
 				InsertRange(_count, vals, n);
 			}
 
-			void AddRange(const List<T> & list)
+			template<typename TOtherAllocator>
+			void AddRange(const List<T, TOtherAllocator> & list)
 			{
-				InsertRange(_count, list.buffer, list._count);
+				InsertRange(_count, list.Buffer(), list.Count());
 			}
 
 			void RemoveRange(int id, int deleteCount)
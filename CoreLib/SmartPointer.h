@@ -2,6 +2,7 @@
 #define FUNDAMENTAL_LIB_SMART_POINTER_H
 
 #include "TypeTraits.h"
+#include <atomic>
 
 namespace CoreLib
 {
@@ -27,12 +28,35 @@ namespace CoreLib
 			}
 		};
 
+		template<typename T>
+		class WeakRefPtr;
+
+		// Intrusive reference count for objects that are only shared within one thread.
 		class ReferenceCounted
 		{
 			template<typename T, bool b, typename Destructor>
 			friend class RefPtrImpl;
 		private:
 			int _refCount = 0;
+			void IncreaseReference()
+			{
+				_refCount++;
+			}
+			// Returns true when the last reference is released. The count stays at one while the object is
+			// destroyed, so references taken by its destructor do not destroy it again.
+			bool DecreaseReference()
+			{
+				if (_refCount > 1)
+				{
+					_refCount--;
+					return false;
+				}
+				return true;
+			}
+			void DecreaseReferenceNoDelete()
+			{
+				_refCount--;
+			}
 		public:
 			ReferenceCounted() {}
 			ReferenceCounted(const ReferenceCounted &)
@@ -41,6 +65,117 @@ namespace CoreLib
 			}
 		};
 
+		class AtomicReferenceCounted;
+
+		// Shared by an AtomicReferenceCounted object and its weak references, outlives the object until the last
+		// weak reference is released.
+		class WeakReferenceBlock
+		{
+		private:
+			std::atomic_flag lock = ATOMIC_FLAG_INIT;
+		public:
+			// one count is held by the object while it is alive
+			std::atomic<int> weakCount;
+			AtomicReferenceCounted * object;
+			WeakReferenceBlock(AtomicReferenceCounted * obj)
+				: weakCount(1), object(obj)
+			{}
+			void Lock()
+			{
+				while (lock.test_and_set(std::memory_order_acquire))
+					;
+			}
+			void Unlock()
+			{
+				lock.clear(std::memory_order_release);
+			}
+			void AddWeakReference()
+			{
+				weakCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			void ReleaseWeakReference()
+			{
+				if (weakCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					delete this;
+			}
+		};
+
+		// Intrusive reference count that may be updated from multiple threads, and supports WeakRefPtr.
+		// Types opt in by deriving from AtomicRefObject instead of RefObject, which keeps the cheaper
+		// count for objects that never leave their thread.
+		class AtomicReferenceCounted
+		{
+			template<typename T, bool b, typename Destructor>
+			friend class RefPtrImpl;
+			template<typename T>
+			friend class WeakRefPtr;
+		private:
+			std::atomic<int> _refCount;
+			std::atomic<WeakReferenceBlock*> _weakBlock;
+			void IncreaseReference()
+			{
+				_refCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			bool DecreaseReference()
+			{
+				if (_refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return false;
+				// no strong reference is left and none can be created except by a weak reference being locked,
+				// which checks the count under the block lock
+				if (auto block = _weakBlock.load(std::memory_order_acquire))
+				{
+					block->Lock();
+					block->object = nullptr;
+					block->Unlock();
+				}
+				_refCount.store(1, std::memory_order_relaxed);
+				return true;
+			}
+			void DecreaseReferenceNoDelete()
+			{
+				_refCount.fetch_sub(1, std::memory_order_release);
+			}
+			// must be called while holding a strong reference
+			WeakReferenceBlock * GetWeakBlock()
+			{
+				auto block = _weakBlock.load(std::memory_order_acquire);
+				if (!block)
+				{
+					auto newBlock = new WeakReferenceBlock(this);
+					if (_weakBlock.compare_exchange_strong(block, newBlock, std::memory_order_acq_rel))
+						block = newBlock;
+					else
+						delete newBlock;
+				}
+				return block;
+			}
+			bool TryIncreaseReference()
+			{
+				int count = _refCount.load(std::memory_order_relaxed);
+				while (count > 0)
+				{
+					if (_refCount.compare_exchange_weak(count, count + 1, std::memory_order_relaxed))
+						return true;
+				}
+				return false;
+			}
+		public:
+			AtomicReferenceCounted()
+				: _refCount(0), _weakBlock(nullptr)
+			{}
+			AtomicReferenceCounted(const AtomicReferenceCounted &)
+				: _refCount(0), _weakBlock(nullptr)
+			{}
+			AtomicReferenceCounted & operator = (const AtomicReferenceCounted &)
+			{
+				return *this;
+			}
+			~AtomicReferenceCounted()
+			{
+				if (auto block = _weakBlock.load(std::memory_order_acquire))
+					block->ReleaseWeakReference();
+			}
+		};
 
 		class RefObject : public ReferenceCounted
 		{
@@ -49,13 +184,20 @@ namespace CoreLib
 			{}
 		};
 
+		class AtomicRefObject : public AtomicReferenceCounted
+		{
+		public:
+			virtual ~AtomicRefObject()
+			{}
+		};
+
 		template<typename T, bool HasBuiltInCounter, typename Destructor>
 		class RefPtrImpl
 		{
 		};
 
 		template<typename T, typename Destructor = RefPtrDefaultDestructor>
-		using RefPtr = RefPtrImpl<T, IsBaseOf<ReferenceCounted, T>::Value, Destructor>;
+		using RefPtr = RefPtrImpl<T, IsBaseOf<ReferenceCounted, T>::Value || IsBaseOf<AtomicReferenceCounted, T>::Value, Destructor>;
 
         template<typename T, typename Destructor = RefPtrDefaultDestructor>
         using ObjPtr = CoreLib::Basic::RefPtrImpl<T, true, RefPtrDefaultDestructor>;
@@ -280,6 +422,8 @@ namespace CoreLib
 		{
 			template<typename T1, bool b, typename Destructor1>
 			friend class RefPtrImpl;
+			template<typename T1>
+			friend class WeakRefPtr;
 			
 		private:
 			T * pointer;
@@ -311,7 +455,7 @@ namespace CoreLib
 				pointer = ptr.pointer;
 				if (ptr)
 				{
-					ptr->_refCount++;
+					pointer->IncreaseReference();
 				}
 			}
 
@@ -324,7 +468,7 @@ namespace CoreLib
 				pointer = ptr.pointer;
 				if (ptr)
 				{
-					ptr->_refCount++;
+					pointer->IncreaseReference();
 				}
 				return *this;
 			}
@@ -337,7 +481,7 @@ namespace CoreLib
 					pointer = ptr;
 					if (ptr)
 					{
-						ptr->_refCount++;
+						ptr->IncreaseReference();
 					}
 				}
 				return *this;
@@ -349,7 +493,7 @@ namespace CoreLib
 					Unreference();
 					pointer = ptr.pointer;
 					if (pointer)
-						pointer->_refCount++;
+						pointer->IncreaseReference();
 				}
 				return *this;
 			}
@@ -384,7 +528,7 @@ namespace CoreLib
 					result.pointer = dynamic_cast<U*>(pointer);
 					if (result.pointer)
 					{
-						result.pointer->_refCount++;
+						result.pointer->IncreaseReference();
 					}
 				}
 				return result;
@@ -411,7 +555,7 @@ namespace CoreLib
 			{
 				if (pointer)
 				{
-					pointer->_refCount--;
+					pointer->DecreaseReferenceNoDelete();
 				}
 				auto rs = pointer;
 				pointer = 0;
@@ -426,11 +570,7 @@ namespace CoreLib
 			{
 				if (pointer)
 				{
-					if (pointer->_refCount > 1)
-					{
-						pointer->_refCount--;
-					}
-					else
+					if (pointer->DecreaseReference())
 					{
 						Destructor destructor;
 						destructor(pointer);
@@ -460,6 +600,100 @@ namespace CoreLib
 			}
 		};
 
+		// Non-owning reference to an AtomicReferenceCounted object, Lock returns a strong reference or null once the
+		// object has been destroyed.
+		template<typename T>
+		class WeakRefPtr
+		{
+			static_assert(IsBaseOf<AtomicReferenceCounted, T>::Value, "WeakRefPtr requires an AtomicReferenceCounted type.");
+		private:
+			T * pointer = nullptr;
+			WeakReferenceBlock * block = nullptr;
+		public:
+			WeakRefPtr() = default;
+			template<typename Destructor>
+			WeakRefPtr(const RefPtrImpl<T, 1, Destructor> & ptr)
+			{
+				operator=(ptr);
+			}
+			WeakRefPtr(const WeakRefPtr<T> & other)
+			{
+				operator=(other);
+			}
+			WeakRefPtr(WeakRefPtr<T> && other)
+			{
+				operator=(static_cast<WeakRefPtr<T>&&>(other));
+			}
+			~WeakRefPtr()
+			{
+				Reset();
+			}
+			void Reset()
+			{
+				if (block)
+					block->ReleaseWeakReference();
+				block = nullptr;
+				pointer = nullptr;
+			}
+			template<typename Destructor>
+			WeakRefPtr<T> & operator = (const RefPtrImpl<T, 1, Destructor> & ptr)
+			{
+				Reset();
+				if (ptr)
+				{
+					pointer = ptr.Ptr();
+					block = pointer->GetWeakBlock();
+					block->AddWeakReference();
+				}
+				return *this;
+			}
+			WeakRefPtr<T> & operator = (const WeakRefPtr<T> & other)
+			{
+				if (this == &other)
+					return *this;
+				Reset();
+				pointer = other.pointer;
+				block = other.block;
+				if (block)
+					block->AddWeakReference();
+				return *this;
+			}
+			WeakRefPtr<T> & operator = (WeakRefPtr<T> && other)
+			{
+				if (this == &other)
+					return *this;
+				Reset();
+				pointer = other.pointer;
+				block = other.block;
+				other.pointer = nullptr;
+				other.block = nullptr;
+				return *this;
+			}
+			template<typename Destructor = RefPtrDefaultDestructor>
+			RefPtrImpl<T, 1, Destructor> Lock() const
+			{
+				RefPtrImpl<T, 1, Destructor> result;
+				if (block)
+				{
+					block->Lock();
+					// the object is not deleted while the block is locked
+					if (block->object && pointer->TryIncreaseReference())
+						result.pointer = pointer;
+					block->Unlock();
+				}
+				return result;
+			}
+			bool IsExpired() const
+			{
+				if (!block)
+					return true;
+				block->Lock();
+				bool expired = block->object == nullptr;
+				block->Unlock();
+				return expired;
+			}
+		};
+
 		template<typename T>
 		class UniquePtr
 		{
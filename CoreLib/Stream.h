@@ -275,17 +275,13 @@ namespace CoreLib
 			}
 			virtual Int64 Read(void * pbuffer, Int64 length)
 			{
-				Int64 i;
-				for (i = 0; i < length; i++)
-				{
-					if (ptr + i < readBuffer.Count())
-					{
-						((unsigned char*)pbuffer)[i] = readBuffer[(int)(ptr + i)];
-					}
-					else
-						break;
-				}
-				return i;
+				Int64 available = readBuffer.Count() - (Int64)ptr;
+				if (length > available)
+					length = available > 0 ? available : 0;
+				if (length)
+					memcpy(pbuffer, readBuffer.Buffer() + ptr, (size_t)length);
+				ptr += (int)length;
+				return length;
 			}
 			virtual Int64 Write(const void * pbuffer, Int64 length)
 			{
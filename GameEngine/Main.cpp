@@ -73,6 +73,8 @@ int __stdcall wWinMain(
 				args.EngineDirectory = RemoveQuote(parser.GetOptionValue("-enginedir"));
 			if (parser.OptionExists("-gpu"))
 				args.GpuId = StringToInt(parser.GetOptionValue("-gpu"));
+			if (parser.OptionExists("-jobthreads"))
+				args.JobThreads = (int)StringToInt(parser.GetOptionValue("-jobthreads"));
 			if (parser.OptionExists("-recompileshaders"))
 				args.RecompileShaders = true;
 			if (parser.OptionExists("-level"))
@@ -92,6 +94,12 @@ int __stdcall wWinMain(
 				appParams.EnableVideoCapture = true;
 				appParams.FramesPerSecond = (int)StringToInt(parser.GetOptionValue("-recfps"));
 			}
+			if (parser.OptionExists("-recbuffers"))
+				appParams.CaptureReadbackBuffers = (int)StringToInt(parser.GetOptionValue("-recbuffers"));
+			if (parser.OptionExists("-recqueue"))
+				appParams.CaptureQueueLength = (int)StringToInt(parser.GetOptionValue("-recqueue"));
+			if (parser.OptionExists("-recdrop"))
+				appParams.CaptureDropFrames = true;
             if (parser.OptionExists("-forcedpi"))
             {
                 appParams.ForceDPI = (int)StringToInt(parser.GetOptionValue("-forcedpi"));
@@ -135,7 +143,23 @@ int __stdcall wWinMain(
 				Engine::Instance()->SetTimingMode(GameEngine::TimingMode::Fixed);
 				Engine::Instance()->SetFrameDuration(1.0f / appParams.FramesPerSecond);
 			}
-			Engine::Run();
+			if (parser.OptionExists("-compilelevel"))
+			{
+				// converts a text level into the compiled format next to it and exits
+				auto levelName = RemoveQuote(parser.GetOptionValue("-compilelevel"));
+				auto sourceFileName = Engine::Instance()->FindFile(levelName, ResourceType::Level);
+				if (sourceFileName.Length())
+				{
+					auto compiledFileName = CoreLib::IO::Path::ReplaceExt(sourceFileName, "clevel");
+					Level level(sourceFileName);
+					level.SaveToFile(compiledFileName);
+					Print("compiled level written to '%S'.\n", compiledFileName.ToWString());
+				}
+				else
+					Print("error: cannot find level '%S'.\n", levelName.ToWString());
+			}
+			else
+				Engine::Run();
 		}
 		catch (const CoreLib::Exception & e)
 		{
@@ -104,6 +104,67 @@ namespace GameEngine
 		SerializeFields(sb);
 		sb << "}\n";
 	}
+	void Actor::ParseBinary(Level * plevel, CoreLib::IO::BinaryReader & reader, CoreLib::ArrayView<CoreLib::String> propertyNames, bool & isInvalid)
+	{
+		level = plevel;
+		auto stream = reader.GetStream();
+		int propertyCount = reader.ReadInt32();
+		for (int i = 0; i < propertyCount; i++)
+		{
+			int nameId = reader.ReadInt32();
+			int size = reader.ReadInt32();
+			auto valueEnd = stream->GetPosition() + size;
+			if (nameId < 0 || nameId >= propertyNames.Count() || size < 0)
+				throw CoreLib::InvalidOperationException("Invalid compiled level file.");
+			auto & propertyName = propertyNames[nameId];
+			if (auto prop = FindProperty(propertyName.Buffer()))
+			{
+				try
+				{
+					prop->ReadBinary(reader);
+				}
+				catch (CoreLib::Text::TextFormatException)
+				{
+					Print("Cannot parse property '%s' of actor '%S'.\n", propertyName.Buffer(), Name.GetValue().ToWString());
+					isInvalid = true;
+				}
+			}
+			else
+				Print("Actor '%S' does not have property '%s', ignoring the value.\n", Name.GetValue().ToWString(), propertyName.Buffer());
+			stream->Seek(CoreLib::IO::SeekOrigin::Start, valueEnd);
+		}
+		// custom fields are stored in their text form and go through ParseField
+		auto fields = reader.ReadString();
+		if (fields.Length())
+		{
+			CoreLib::Text::TokenReader parser(GetTypeName() + "{" + fields + "}");
+			Parse(plevel, parser, isInvalid);
+		}
+	}
+	void Actor::SerializeToBinary(CoreLib::IO::BinaryWriter & writer, CoreLib::EnumerableDictionary<CoreLib::String, int> & propertyNames)
+	{
+		auto propList = GetPropertyList();
+		writer.Write(propList.Count());
+		CoreLib::RefPtr<CoreLib::IO::MemoryStream> valueStream = new CoreLib::IO::MemoryStream();
+		CoreLib::IO::BinaryWriter valueWriter(valueStream);
+		for (auto & prop : propList)
+		{
+			int nameId = -1;
+			if (!propertyNames.TryGetValue(prop->GetName(), nameId))
+			{
+				nameId = propertyNames.Count();
+				propertyNames.Add(prop->GetName(), nameId);
+			}
+			valueStream->Seek(CoreLib::IO::SeekOrigin::Start, 0);
+			prop->WriteBinary(valueWriter);
+			writer.Write(nameId);
+			writer.Write(valueStream->GetBufferSize());
+			writer.Write((unsigned char*)valueStream->GetBuffer(), valueStream->GetBufferSize());
+		}
+		CoreLib::StringBuilder fields;
+		SerializeFields(fields);
+		writer.Write(fields.ProduceString());
+	}
 	VectorMath::Vec3 Actor::GetPosition()
 	{
 		auto l = LocalTransform.GetValue();
@@ -57,12 +57,19 @@ namespace GameEngine
 		CoreLib::Graphics::BBox Bounds;
 		CoreLib::List<CoreLib::RefPtr<Actor>> SubComponents;
 		virtual void Tick() { }
+		// returns true if Tick() only modifies this actor's own state, so that it can run
+		// concurrently with other actors' Tick()
+		virtual bool CanTickInParallel() { return false; }
 		virtual EngineActorType GetEngineType() = 0;
 		virtual void OnLoad() {};
 		virtual void OnUnload() {};
 		virtual void RegisterUI(GraphicsUI::UIEntry *) {}
 		virtual void Parse(Level * plevel, CoreLib::Text::TokenReader & parser, bool & isInvalid);
 		virtual void SerializeToText(CoreLib::StringBuilder & sb);
+		// compiled level form: property values in binary, prefixed with their size so that properties no
+		// longer declared by the actor can be skipped. Property names are indices into propertyNames.
+		virtual void ParseBinary(Level * plevel, CoreLib::IO::BinaryReader & reader, CoreLib::ArrayView<CoreLib::String> propertyNames, bool & isInvalid);
+		virtual void SerializeToBinary(CoreLib::IO::BinaryWriter & writer, CoreLib::EnumerableDictionary<CoreLib::String, int> & propertyNames);
 		virtual void GetDrawables(const GetDrawablesParameter & /*params*/) {}
 		virtual CoreLib::String GetTypeName() { return "Actor"; }
 		void SetLevel(Level * plevel)
@@ -27,4 +27,11 @@ namespace GameEngine
             p.BlendShapeWeights[anim->BlendShapeChannels[i].Name] = anim->BlendShapeChannels[i].Sample(animTime);
         }
 	}
+
+	void SimpleAnimationSynthesizer::GetPose(PoseSoA & p, float time)
+	{
+		if (binding.GetSkeleton() != skeleton || binding.GetAnimation() != anim)
+			binding.Bind(skeleton, anim);
+		SampleAnimation(p, binding, fmod(time * anim->Speed, anim->Duration));
+	}
 }
\ No newline at end of file
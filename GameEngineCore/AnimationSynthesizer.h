@@ -2,6 +2,7 @@
 #define ANIMATION_SYNTHESIZER_H
 
 #include "Skeleton.h"
+#include "PoseSoA.h"
 #include "CoreLib/LibMath.h"
 #include "CatmullSpline.h"
 #include <queue>
@@ -21,6 +22,7 @@ namespace GameEngine
 	private:
 		Skeleton * skeleton = nullptr;
 		SkeletalAnimation * anim = nullptr;
+		AnimationBinding binding;
 	public:
 		SimpleAnimationSynthesizer() = default;
 		SimpleAnimationSynthesizer(Skeleton * pSkeleton, SkeletalAnimation * pAnim)
@@ -32,6 +34,8 @@ namespace GameEngine
 			this->anim = pAnim;
 		}
 		virtual void GetPose(Pose & p, float time) override;
+		// bone transforms only, sampled with the SIMD pose kernels
+		void GetPose(PoseSoA & p, float time);
 	};
 }
 
@@ -0,0 +1,429 @@
+#include "AssetStreamer.h"
+
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+
+namespace GameEngine
+{
+	template<typename TEntry>
+	static void HeapPush(List<TEntry> & heap, const TEntry & entry)
+	{
+		int i = heap.Count();
+		heap.Add(entry);
+		while (i > 0)
+		{
+			int parent = (i - 1) >> 1;
+			if (heap[parent].priority >= heap[i].priority)
+				break;
+			Swap(heap[parent], heap[i]);
+			i = parent;
+		}
+	}
+
+	template<typename TEntry>
+	static void HeapSiftDown(List<TEntry> & heap, int i)
+	{
+		while (true)
+		{
+			int largest = i;
+			int left = i * 2 + 1, right = left + 1;
+			if (left < heap.Count() && heap[left].priority > heap[largest].priority)
+				largest = left;
+			if (right < heap.Count() && heap[right].priority > heap[largest].priority)
+				largest = right;
+			if (largest == i)
+				break;
+			Swap(heap[largest], heap[i]);
+			i = largest;
+		}
+	}
+
+	template<typename TEntry>
+	static TEntry HeapPop(List<TEntry> & heap)
+	{
+		auto rs = heap[0];
+		heap[0] = heap.Last();
+		heap.RemoveAt(heap.Count() - 1);
+		if (heap.Count())
+			HeapSiftDown(heap, 0);
+		return rs;
+	}
+
+	AssetStreamer::~AssetStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			running = false;
+		}
+		queueCondition.notify_all();
+		for (auto & worker : workers)
+			worker->Join();
+	}
+
+	void AssetStreamer::StartWorkers()
+	{
+		running = true;
+		for (int i = 0; i < Math::Max(1, settings.IoThreads); i++)
+			workers.Add(new Thread(new ThreadProc([this]() { ReadWorkerProc(); })));
+		for (int i = 0; i < Math::Max(1, settings.DecodeThreads); i++)
+			workers.Add(new Thread(new ThreadProc([this]() { DecodeWorkerProc(); })));
+	}
+
+	void AssetStreamer::ReadWorkerProc()
+	{
+		while (true)
+		{
+			StreamingAsset * asset = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return !running || queuedCount != 0; });
+				if (!running)
+					return;
+				// every queued asset has exactly one entry of its current generation in the heap
+				while (!asset)
+				{
+					auto entry = HeapPop(readQueue);
+					if (entry.generation == entry.asset->queueGeneration && entry.asset->state == StreamingState::Queued)
+						asset = entry.asset;
+				}
+				queuedCount--;
+				busyWorkers++;
+				asset->state = StreamingState::Reading;
+			}
+			bool succeeded = asset->Read();
+			size_t stagingSize = succeeded ? asset->GetStagingSize() : 0;
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				busyWorkers--;
+				asset->stagingSize = stagingSize;
+				bytesInFlight += stagingSize;
+				if (succeeded)
+				{
+					asset->state = StreamingState::Decoding;
+					decodeQueue.Add(asset);
+				}
+				else
+				{
+					asset->state = StreamingState::Failed;
+					failedAssets.Add(asset);
+				}
+			}
+			queueCondition.notify_all();
+			idleCondition.notify_all();
+		}
+	}
+
+	void AssetStreamer::DecodeWorkerProc()
+	{
+		while (true)
+		{
+			StreamingAsset * asset = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return !running || decodeQueue.Count() != 0; });
+				if (!running)
+					return;
+				asset = decodeQueue.First();
+				decodeQueue.RemoveAt(0);
+				busyWorkers++;
+			}
+			bool succeeded = asset->Decode();
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				busyWorkers--;
+				if (succeeded)
+				{
+					asset->state = StreamingState::Decoded;
+					decodedAssets.Add(asset);
+				}
+				else
+				{
+					asset->state = StreamingState::Failed;
+					failedAssets.Add(asset);
+				}
+			}
+			idleCondition.notify_all();
+		}
+	}
+
+	void AssetStreamer::PushReadQueue(StreamingAsset * asset, float priority)
+	{
+		// a re-prioritized asset gets a new entry, the old one is recognized by its generation and skipped
+		asset->queueGeneration++;
+		asset->queuedPriority = priority;
+		QueueEntry entry;
+		entry.priority = priority;
+		entry.generation = asset->queueGeneration;
+		entry.asset = asset;
+		HeapPush(readQueue, entry);
+		if (readQueue.Count() > queuedCount * 2 + 64)
+		{
+			int count = 0;
+			for (auto & e : readQueue)
+			{
+				if (e.generation == e.asset->queueGeneration && e.asset->state == StreamingState::Queued)
+					readQueue[count++] = e;
+			}
+			readQueue.SetSize(count);
+			for (int i = count / 2 - 1; i >= 0; i--)
+				HeapSiftDown(readQueue, i);
+		}
+	}
+
+	void AssetStreamer::SetSettings(const StreamingSettings & pSettings)
+	{
+		settings = pSettings;
+	}
+
+	void AssetStreamer::Request(StreamingAsset * asset, float priority)
+	{
+		// an asset requested several times in a frame keeps the highest priority
+		if (asset->lastUseFrame == frame && asset->priority >= priority)
+			return;
+		asset->lastUseFrame = frame;
+		asset->priority = priority;
+		if (asset->resident)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (!running)
+				StartWorkers();
+			if (asset->state == StreamingState::Unloaded)
+			{
+				asset->state = StreamingState::Queued;
+				queuedCount++;
+				PushReadQueue(asset, priority);
+			}
+			else if (asset->state == StreamingState::Queued && asset->queuedPriority != priority)
+				PushReadQueue(asset, priority);
+			else
+				return;
+		}
+		queueCondition.notify_all();
+	}
+
+	bool AssetStreamer::IsStale(StreamingAsset * asset)
+	{
+		return asset->lastUseFrame < frame - settings.CancelAfterFrames;
+	}
+
+	void AssetStreamer::DiscardLoad(StreamingAsset * asset)
+	{
+		asset->DiscardStaging();
+		std::lock_guard<std::mutex> lock(queueMutex);
+		bytesInFlight -= asset->stagingSize;
+		asset->stagingSize = 0;
+		asset->state = StreamingState::Unloaded;
+	}
+
+	void AssetStreamer::EvictAsset(StreamingAsset * asset)
+	{
+		asset->Evict();
+		asset->resident = false;
+		auto last = residentAssets.Last();
+		residentAssets[asset->residentIndex] = last;
+		last->residentIndex = asset->residentIndex;
+		residentAssets.RemoveAt(residentAssets.Count() - 1);
+		asset->residentIndex = -1;
+		stats.ResidentCpuBytes -= asset->residentCpuSize;
+		stats.ResidentGpuBytes -= asset->residentGpuSize;
+		stats.Evictions++;
+		std::lock_guard<std::mutex> lock(queueMutex);
+		asset->state = StreamingState::Unloaded;
+	}
+
+	bool AssetStreamer::MakeRoom(size_t cpuSize, size_t gpuSize)
+	{
+		auto fits = [&]()
+		{
+			return stats.ResidentCpuBytes + cpuSize <= settings.CpuBudget && stats.ResidentGpuBytes + gpuSize <= settings.GpuBudget;
+		};
+		if (fits())
+			return true;
+		if (evictionCursor == -1)
+		{
+			// assets requested since the last Update() are in use and never evicted
+			evictionCandidates.Clear();
+			for (auto asset : residentAssets)
+			{
+				if (asset->lastUseFrame < frame)
+					evictionCandidates.Add(asset);
+			}
+			evictionCandidates.Sort([](StreamingAsset * a, StreamingAsset * b) { return a->lastUseFrame < b->lastUseFrame; });
+			evictionCursor = 0;
+		}
+		while (!fits() && evictionCursor < evictionCandidates.Count())
+		{
+			auto asset = evictionCandidates[evictionCursor++];
+			if (asset->resident)
+				EvictAsset(asset);
+		}
+		return fits();
+	}
+
+	int AssetStreamer::CommitPendingAssets(size_t byteLimit)
+	{
+		int changes = 0;
+		size_t committedBytes = 0;
+		pendingCommits.Sort([](StreamingAsset * a, StreamingAsset * b) { return a->priority > b->priority; });
+		int remaining = 0;
+		for (int i = 0; i < pendingCommits.Count(); i++)
+		{
+			auto asset = pendingCommits[i];
+			if (IsStale(asset))
+			{
+				DiscardLoad(asset);
+				stats.Cancellations++;
+				continue;
+			}
+			size_t cpuSize = asset->GetCpuResidentSize();
+			size_t gpuSize = asset->GetGpuResidentSize();
+			if ((committedBytes >= byteLimit && changes != 0) || !MakeRoom(cpuSize, gpuSize))
+			{
+				pendingCommits[remaining++] = asset;
+				continue;
+			}
+			asset->MakeResident();
+			asset->resident = true;
+			asset->residentCpuSize = cpuSize;
+			asset->residentGpuSize = gpuSize;
+			asset->residentIndex = residentAssets.Count();
+			residentAssets.Add(asset);
+			stats.ResidentCpuBytes += cpuSize;
+			stats.ResidentGpuBytes += gpuSize;
+			stats.Loads++;
+			committedBytes += cpuSize + gpuSize;
+			changes++;
+			std::lock_guard<std::mutex> lock(queueMutex);
+			bytesInFlight -= asset->stagingSize;
+			asset->stagingSize = 0;
+			asset->state = StreamingState::Resident;
+		}
+		pendingCommits.SetSize(remaining);
+		return changes;
+	}
+
+	int AssetStreamer::Update()
+	{
+		List<StreamingAsset*> failed;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			pendingCommits.AddRange(decodedAssets);
+			decodedAssets.Clear();
+			failed.AddRange(failedAssets);
+			failedAssets.Clear();
+			// drop the requests of assets that went out of view before they could be loaded
+			for (auto & entry : readQueue)
+			{
+				auto asset = entry.asset;
+				if (entry.generation == asset->queueGeneration && asset->state == StreamingState::Queued && IsStale(asset))
+				{
+					asset->state = StreamingState::Unloaded;
+					asset->queueGeneration++;
+					queuedCount--;
+					stats.Cancellations++;
+				}
+			}
+		}
+		for (auto asset : failed)
+		{
+			asset->DiscardStaging();
+			stats.Failures++;
+			std::lock_guard<std::mutex> lock(queueMutex);
+			bytesInFlight -= asset->stagingSize;
+			asset->stagingSize = 0;
+		}
+		evictionCursor = -1;
+		int evictions = stats.Evictions;
+		int changes = CommitPendingAssets(settings.CommitBytesPerFrame);
+		// the budgets may have been lowered, or assets that are no longer in use may need to give way
+		MakeRoom(0, 0);
+		changes += stats.Evictions - evictions;
+		frame++;
+		return changes;
+	}
+
+	void AssetStreamer::Flush()
+	{
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			idleCondition.wait(lock, [this]() { return queuedCount == 0 && busyWorkers == 0 && decodeQueue.Count() == 0; });
+			pendingCommits.AddRange(decodedAssets);
+			decodedAssets.Clear();
+		}
+		evictionCursor = -1;
+		CommitPendingAssets((size_t)-1);
+	}
+
+	void AssetStreamer::Remove(StreamingAsset * asset)
+	{
+		if (asset->resident)
+		{
+			EvictAsset(asset);
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			if (asset->state == StreamingState::Queued)
+			{
+				asset->state = StreamingState::Unloaded;
+				asset->queueGeneration++;
+				queuedCount--;
+				return;
+			}
+			int decodeIndex = decodeQueue.IndexOf(asset);
+			if (decodeIndex != -1)
+				decodeQueue.RemoveAt(decodeIndex);
+			else
+				idleCondition.wait(lock, [asset]() { return asset->state != StreamingState::Reading && asset->state != StreamingState::Decoding; });
+			int index = decodedAssets.IndexOf(asset);
+			if (index != -1)
+				decodedAssets.RemoveAt(index);
+			index = failedAssets.IndexOf(asset);
+			if (index != -1)
+				failedAssets.RemoveAt(index);
+		}
+		int index = pendingCommits.IndexOf(asset);
+		if (index != -1)
+			pendingCommits.RemoveAt(index);
+		if (asset->state != StreamingState::Unloaded)
+			DiscardLoad(asset);
+	}
+
+	void AssetStreamer::Clear()
+	{
+		List<StreamingAsset*> loads;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			for (auto & entry : readQueue)
+			{
+				entry.asset->state = StreamingState::Unloaded;
+				entry.asset->queueGeneration++;
+			}
+			readQueue.Clear();
+			queuedCount = 0;
+			idleCondition.wait(lock, [this]() { return busyWorkers == 0 && decodeQueue.Count() == 0; });
+			loads.AddRange(decodedAssets);
+			loads.AddRange(failedAssets);
+			decodedAssets.Clear();
+			failedAssets.Clear();
+		}
+		loads.AddRange(pendingCommits);
+		pendingCommits.Clear();
+		for (auto asset : loads)
+			DiscardLoad(asset);
+		while (residentAssets.Count())
+			EvictAsset(residentAssets.Last());
+	}
+
+	StreamingStats AssetStreamer::GetStats()
+	{
+		StreamingStats rs = stats;
+		std::lock_guard<std::mutex> lock(queueMutex);
+		rs.QueueDepth = queuedCount;
+		rs.LoadsInFlight = busyWorkers + decodeQueue.Count() + decodedAssets.Count() + pendingCommits.Count();
+		rs.BytesInFlight = bytesInFlight;
+		rs.ResidentAssets = residentAssets.Count();
+		return rs;
+	}
+}
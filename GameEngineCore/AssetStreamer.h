@@ -0,0 +1,142 @@
+#ifndef GAME_ENGINE_ASSET_STREAMER_H
+#define GAME_ENGINE_ASSET_STREAMER_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/Threading.h"
+#include <condition_variable>
+
+namespace GameEngine
+{
+	enum class StreamingState
+	{
+		Unloaded, Queued, Reading, Decoding, Decoded, Resident, Failed
+	};
+
+	// An asset that is loaded in the background by an AssetStreamer. Loading goes through three stages:
+	// Read() fetches the source data on an I/O thread, Decode() turns it into the resident representation
+	// on a decode thread, and MakeResident() publishes it on the main thread during AssetStreamer::Update().
+	// Until then the owner keeps showing a placeholder. Evict() returns the asset to the unloaded state.
+	class StreamingAsset : public CoreLib::RefObject
+	{
+		friend class AssetStreamer;
+	private:
+		// guarded by the streamer mutex
+		StreamingState state = StreamingState::Unloaded;
+		int queueGeneration = 0;
+		float queuedPriority = 0.0f;
+		size_t stagingSize = 0;
+		// main thread only
+		bool resident = false;
+		float priority = 0.0f;
+		int lastUseFrame = -1;
+		int residentIndex = -1;
+		size_t residentCpuSize = 0, residentGpuSize = 0;
+	protected:
+		// the following are called on a worker thread and return false if the asset cannot be loaded
+		virtual bool Read() = 0;
+		virtual bool Decode() = 0;
+		// the following are called on the main thread
+		virtual void MakeResident() = 0;
+		virtual void Evict() = 0;
+		// frees the data produced by Read() and Decode() of a load that is abandoned before MakeResident()
+		virtual void DiscardStaging() = 0;
+	public:
+		// memory held between Read() and MakeResident(), valid after Read()
+		virtual size_t GetStagingSize() = 0;
+		// memory used while resident, valid after Decode()
+		virtual size_t GetCpuResidentSize() = 0;
+		virtual size_t GetGpuResidentSize() = 0;
+		bool IsResident()
+		{
+			return resident;
+		}
+	};
+
+	class StreamingSettings
+	{
+	public:
+		int IoThreads = 1;
+		int DecodeThreads = 1;
+		size_t CpuBudget = 256 << 20;
+		size_t GpuBudget = 512 << 20;
+		size_t CommitBytesPerFrame = 16 << 20; // at least one asset is made resident per frame
+		int CancelAfterFrames = 30; // pending loads that are not requested again within this many frames are dropped
+	};
+
+	class StreamingStats
+	{
+	public:
+		int QueueDepth = 0; // requests waiting for an I/O thread
+		int LoadsInFlight = 0; // assets being read, decoded or waiting to be made resident
+		size_t BytesInFlight = 0; // staging memory of the loads in flight
+		size_t ResidentCpuBytes = 0, ResidentGpuBytes = 0;
+		int ResidentAssets = 0;
+		// running totals
+		int Loads = 0, Evictions = 0, Cancellations = 0, Failures = 0;
+	};
+
+	// Loads StreamingAssets on background I/O and decode threads, in priority order, and keeps the resident
+	// assets within a CPU and a GPU memory budget by evicting the least recently requested ones.
+	// All methods are called from the main thread. Like PipelineCompileQueue, the streamer does not own the
+	// assets: they must stay alive until they are evicted, or until Remove() or Clear() returns.
+	class AssetStreamer
+	{
+	private:
+		struct QueueEntry
+		{
+			float priority;
+			int generation;
+			StreamingAsset * asset;
+		};
+		StreamingSettings settings;
+		CoreLib::List<CoreLib::RefPtr<CoreLib::Threading::Thread>> workers;
+		std::mutex queueMutex;
+		std::condition_variable queueCondition, idleCondition;
+		CoreLib::List<QueueEntry> readQueue; // binary max-heap, stale entries are skipped when popped
+		CoreLib::List<StreamingAsset*> decodeQueue, decodedAssets, failedAssets;
+		int queuedCount = 0, busyWorkers = 0;
+		bool running = false;
+		size_t bytesInFlight = 0;
+		// main thread only
+		CoreLib::List<StreamingAsset*> pendingCommits, residentAssets, evictionCandidates;
+		int evictionCursor = -1; // position in evictionCandidates, -1 if the candidates are not gathered yet
+		StreamingStats stats;
+		int frame = 0;
+		void StartWorkers();
+		void ReadWorkerProc();
+		void DecodeWorkerProc();
+		void PushReadQueue(StreamingAsset * asset, float priority);
+		void DiscardLoad(StreamingAsset * asset);
+		bool IsStale(StreamingAsset * asset);
+		bool MakeRoom(size_t cpuSize, size_t gpuSize);
+		void EvictAsset(StreamingAsset * asset);
+		int CommitPendingAssets(size_t byteLimit);
+	public:
+		AssetStreamer() = default;
+		AssetStreamer(const StreamingSettings & pSettings)
+			: settings(pSettings)
+		{}
+		~AssetStreamer();
+		// The budgets and per-frame limits can be changed at any time, thread counts before the first Request().
+		void SetSettings(const StreamingSettings & pSettings);
+		StreamingSettings GetSettings()
+		{
+			return settings;
+		}
+		// Requests `asset` for the current frame. Higher priorities are loaded first, an asset requested several
+		// times uses the highest. Resident assets that are requested are kept resident until the next Update().
+		void Request(StreamingAsset * asset, float priority);
+		// Makes decoded assets resident, drops stale requests and evicts least recently requested assets
+		// until the budgets are met. Returns the number of assets made resident or evicted.
+		int Update();
+		// Blocks until nothing is queued or loading and makes everything that was loaded resident.
+		void Flush();
+		// Cancels any pending load of `asset` and evicts it if it is resident.
+		void Remove(StreamingAsset * asset);
+		// Removes all assets.
+		void Clear();
+		StreamingStats GetStats();
+	};
+}
+
+#endif
@@ -8,6 +8,12 @@ namespace GameEngine
 			commandBuffers.Add(hwRender->CreateCommandBuffer());
 	}
 
+	AsyncCommandBuffer::AsyncCommandBuffer(int threadIndex, HardwareRenderer * hwRender, int size)
+	{
+		for (int i = 0; i < size; i++)
+			commandBuffers.Add(hwRender->CreateThreadCommandBuffer(threadIndex));
+	}
+
 	CommandBuffer * AsyncCommandBuffer::BeginRecording(FrameBuffer * frameBuffer)
 	{
 		framePtr++;
@@ -13,6 +13,8 @@ namespace GameEngine
 		CoreLib::List<CoreLib::RefPtr<CommandBuffer>> commandBuffers;
 	public:
 		AsyncCommandBuffer(HardwareRenderer * hwRender, int size = 3);
+		// creates command buffers owned by job system thread `threadIndex`, see HardwareRenderer::CreateThreadCommandBuffer
+		AsyncCommandBuffer(int threadIndex, HardwareRenderer * hwRender, int size = 3);
 		CommandBuffer * BeginRecording(FrameBuffer * frameBuffer);
 		CommandBuffer * GetBuffer();
 	};
@@ -0,0 +1,1213 @@
+#include "BlockCompression.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/VectorMath.h"
+#include <smmintrin.h>
+#include <float.h>
+
+using namespace CoreLib;
+using namespace VectorMath;
+
+namespace GameEngine
+{
+	namespace
+	{
+		// two subset partitions shared by BC6H and BC7, bit i is the subset of texel i
+		const unsigned short Partitions2[32] =
+		{
+			0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+			0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C
+		};
+		// texel of the second subset whose index is stored without its most significant bit
+		const unsigned char Anchors2[32] =
+		{
+			15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+			15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2
+		};
+		const int Weights2[4] = { 0, 21, 43, 64 };
+		const int Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+		const int Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		inline const int * GetWeights(int indexBits)
+		{
+			return indexBits == 2 ? Weights2 : (indexBits == 3 ? Weights3 : Weights4);
+		}
+		inline int GetSubset(int subsets, int partition, int texel)
+		{
+			return subsets == 1 ? 0 : (Partitions2[partition] >> texel) & 1;
+		}
+		inline unsigned int GetSubsetMask(int subsets, int partition, int subset)
+		{
+			if (subsets == 1)
+				return 0xFFFF;
+			return subset == 0 ? (~Partitions2[partition] & 0xFFFF) : Partitions2[partition];
+		}
+		inline int GetAnchor(int partition, int subset)
+		{
+			return subset == 0 ? 0 : Anchors2[partition];
+		}
+		inline bool IsAnchor(int subsets, int partition, int texel)
+		{
+			return texel == 0 || (subsets == 2 && texel == Anchors2[partition]);
+		}
+
+		// writes the `count` partitions with the lowest estimated error to candidates, best first
+		int SelectPartitions(const float * errors, int count, int * candidates)
+		{
+			int selected = 0;
+			for (int p = 0; p < 32; p++)
+			{
+				int pos = selected < count ? selected++ : count;
+				while (pos > 0 && errors[candidates[pos - 1]] > errors[p])
+				{
+					if (pos < count)
+						candidates[pos] = candidates[pos - 1];
+					pos--;
+				}
+				if (pos < count)
+					candidates[pos] = p;
+			}
+			return selected;
+		}
+
+		// blocks are little endian bit streams, fields are written from the least significant bit
+		class BitWriter
+		{
+		private:
+			uint64_t bits[2] = { 0, 0 };
+			int pos = 0;
+		public:
+			void Write(unsigned int value, int count)
+			{
+				for (int i = 0; i < count; i++, pos++)
+				{
+					if ((value >> i) & 1)
+						bits[pos >> 6] |= 1ull << (pos & 63);
+				}
+			}
+			void Store(unsigned char * output)
+			{
+				memcpy(output, bits, 16);
+			}
+		};
+
+		class BitReader
+		{
+		private:
+			uint64_t bits[2];
+			int pos = 0;
+		public:
+			BitReader(const unsigned char * input)
+			{
+				memcpy(bits, input, 16);
+			}
+			unsigned int Read(int count)
+			{
+				unsigned int rs = 0;
+				for (int i = 0; i < count; i++, pos++)
+					rs |= (unsigned int)((bits[pos >> 6] >> (pos & 63)) & 1) << i;
+				return rs;
+			}
+		};
+
+		/*
+		 * BC7
+		 */
+
+		struct BC7ModeInfo
+		{
+			int Subsets, PartitionBits, ColorBits, AlphaBits, EndpointPBits, SharedPBits, IndexBits;
+		};
+		// Subsets == 0 marks the modes that are not used: the three subset modes and the
+		// modes with channel rotation and a second index set
+		const BC7ModeInfo BC7Modes[8] =
+		{
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 2, 6, 6, 0, 0, 1, 3 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 2, 6, 7, 0, 1, 0, 2 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 1, 0, 7, 7, 1, 0, 4 },
+			{ 2, 6, 5, 5, 1, 0, 2 },
+		};
+
+		struct BC7Block
+		{
+			alignas(16) int Texels[4][16]; // channel major
+			bool Opaque;
+		};
+
+		struct BC7Subset
+		{
+			int Endpoints[2][4]; // quantized, without p-bits
+			int PBits[2];
+			int Indices[16];     // only valid for the texels of this subset
+			int Error;
+		};
+
+		struct BC7Encoding
+		{
+			int Mode = 6, Partition = 0;
+			BC7Subset Subsets[2];
+			int Error = 0x7FFFFFFF;
+		};
+
+		inline int ExpandBits(int value, int bits)
+		{
+			return (value << (8 - bits)) | (value >> (2 * bits - 8));
+		}
+
+		inline int GetPBit(const BC7ModeInfo & mode, const BC7Subset & subset, int endpoint)
+		{
+			if (mode.EndpointPBits)
+				return subset.PBits[endpoint];
+			if (mode.SharedPBits)
+				return subset.PBits[0];
+			return -1;
+		}
+
+		inline int DecodeChannel(int q, int bits, int pbit)
+		{
+			if (bits == 0)
+				return 255;
+			if (pbit >= 0)
+				return ExpandBits((q << 1) | pbit, bits + 1);
+			return ExpandBits(q, bits);
+		}
+
+		// the quantized value whose decoded 8 bit value is closest to v
+		inline int QuantizeChannel(float v, int bits, int pbit)
+		{
+			int maxQ = (1 << bits) - 1;
+			int totalBits = pbit >= 0 ? bits + 1 : bits;
+			float scaled = v * (float)((1 << totalBits) - 1) / 255.0f;
+			if (pbit >= 0)
+				scaled = (scaled - (float)pbit) * 0.5f;
+			int q0 = Math::Clamp((int)floorf(scaled), 0, maxQ);
+			int q1 = Math::Min(q0 + 1, maxQ);
+			float e0 = fabsf((float)DecodeChannel(q0, bits, pbit) - v);
+			float e1 = fabsf((float)DecodeChannel(q1, bits, pbit) - v);
+			return e1 < e0 ? q1 : q0;
+		}
+
+		// closest palette entry of all 16 texels, four texels are processed per SSE register
+		void FindClosestEntries(const BC7Block & block, const int(*palette)[4], int paletteSize, int * indices, int * errors)
+		{
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128i r = _mm_load_si128((const __m128i*)(block.Texels[0] + i));
+				__m128i g = _mm_load_si128((const __m128i*)(block.Texels[1] + i));
+				__m128i b = _mm_load_si128((const __m128i*)(block.Texels[2] + i));
+				__m128i a = _mm_load_si128((const __m128i*)(block.Texels[3] + i));
+				__m128i bestError = _mm_set1_epi32(0x7FFFFFFF);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int k = 0; k < paletteSize; k++)
+				{
+					__m128i dr = _mm_sub_epi32(r, _mm_set1_epi32(palette[k][0]));
+					__m128i dg = _mm_sub_epi32(g, _mm_set1_epi32(palette[k][1]));
+					__m128i db = _mm_sub_epi32(b, _mm_set1_epi32(palette[k][2]));
+					__m128i da = _mm_sub_epi32(a, _mm_set1_epi32(palette[k][3]));
+					__m128i err = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(dr, dr), _mm_mullo_epi32(dg, dg)),
+						_mm_add_epi32(_mm_mullo_epi32(db, db), _mm_mullo_epi32(da, da)));
+					__m128i closer = _mm_cmplt_epi32(err, bestError);
+					bestError = _mm_min_epi32(err, bestError);
+					bestIndex = _mm_blendv_epi8(bestIndex, _mm_set1_epi32(k), closer);
+				}
+				_mm_storeu_si128((__m128i*)(indices + i), bestIndex);
+				_mm_storeu_si128((__m128i*)(errors + i), bestError);
+			}
+		}
+
+		int EvaluateSubset(const BC7Block & block, const BC7ModeInfo & mode, unsigned int texelMask, BC7Subset & subset)
+		{
+			int endpoints[2][4];
+			for (int e = 0; e < 2; e++)
+			{
+				int pbit = GetPBit(mode, subset, e);
+				for (int c = 0; c < 4; c++)
+					endpoints[e][c] = DecodeChannel(subset.Endpoints[e][c], c < 3 ? mode.ColorBits : mode.AlphaBits, pbit);
+			}
+			int palette[16][4];
+			int paletteSize = 1 << mode.IndexBits;
+			auto weights = GetWeights(mode.IndexBits);
+			for (int k = 0; k < paletteSize; k++)
+			{
+				for (int c = 0; c < 4; c++)
+					palette[k][c] = ((64 - weights[k]) * endpoints[0][c] + weights[k] * endpoints[1][c] + 32) >> 6;
+			}
+			int indices[16], errors[16];
+			FindClosestEntries(block, palette, paletteSize, indices, errors);
+			subset.Error = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				if (texelMask & (1 << i))
+				{
+					subset.Indices[i] = indices[i];
+					subset.Error += errors[i];
+				}
+			}
+			return subset.Error;
+		}
+
+		// sums of the texel values and their products, enough to derive the covariance of any texel subset
+		struct TexelMoments
+		{
+			int Count = 0;
+			int Sum[4] = {};
+			int SumSq[4][4] = {};
+			void Add(const BC7Block & block, int texel, int channels)
+			{
+				Count++;
+				for (int c0 = 0; c0 < channels; c0++)
+				{
+					Sum[c0] += block.Texels[c0][texel];
+					for (int c1 = c0; c1 < channels; c1++)
+						SumSq[c0][c1] += block.Texels[c0][texel] * block.Texels[c1][texel];
+				}
+			}
+			TexelMoments operator - (const TexelMoments & other) const
+			{
+				TexelMoments rs;
+				rs.Count = Count - other.Count;
+				for (int c0 = 0; c0 < 4; c0++)
+				{
+					rs.Sum[c0] = Sum[c0] - other.Sum[c0];
+					for (int c1 = 0; c1 < 4; c1++)
+						rs.SumSq[c0][c1] = SumSq[c0][c1] - other.SumSq[c0][c1];
+				}
+				return rs;
+			}
+		};
+
+		TexelMoments ComputeMoments(const BC7Block & block, unsigned int texelMask, int channels)
+		{
+			TexelMoments moments;
+			for (int i = 0; i < 16; i++)
+			{
+				if (texelMask & (1 << i))
+					moments.Add(block, i, channels);
+			}
+			return moments;
+		}
+
+		// principal axis of a texel set, returns the squared distance of the texels from that line
+		float FitLine(const TexelMoments & moments, int channels, float mean[4], float axis[4])
+		{
+			for (int c = 0; c < 4; c++)
+				mean[c] = axis[c] = 0.0f;
+			if (moments.Count == 0)
+				return 0.0f;
+			float invCount = 1.0f / (float)moments.Count;
+			for (int c = 0; c < channels; c++)
+				mean[c] = (float)moments.Sum[c] * invCount;
+			float cov[4][4];
+			for (int c0 = 0; c0 < channels; c0++)
+			{
+				for (int c1 = c0; c1 < channels; c1++)
+				{
+					cov[c0][c1] = (float)moments.SumSq[c0][c1] - (float)moments.Sum[c0] * mean[c1];
+					cov[c1][c0] = cov[c0][c1];
+				}
+			}
+			float trace = 0.0f;
+			int largest = 0;
+			for (int c = 0; c < channels; c++)
+			{
+				trace += cov[c][c];
+				if (cov[c][c] > cov[largest][largest])
+					largest = c;
+			}
+			if (trace <= 0.0f)
+				return 0.0f;
+			// power iteration, starting from the row of the channel with the largest variance
+			for (int c = 0; c < channels; c++)
+				axis[c] = cov[largest][c];
+			for (int iter = 0; iter < 6; iter++)
+			{
+				float v[4] = {};
+				float maxComponent = 0.0f;
+				for (int c0 = 0; c0 < channels; c0++)
+				{
+					for (int c1 = 0; c1 < channels; c1++)
+						v[c0] += cov[c0][c1] * axis[c1];
+					maxComponent = Math::Max(maxComponent, fabsf(v[c0]));
+				}
+				if (maxComponent == 0.0f)
+					break;
+				for (int c = 0; c < channels; c++)
+					axis[c] = v[c] / maxComponent;
+			}
+			float length2 = 0.0f, projected = 0.0f;
+			for (int c0 = 0; c0 < channels; c0++)
+			{
+				length2 += axis[c0] * axis[c0];
+				for (int c1 = 0; c1 < channels; c1++)
+					projected += axis[c0] * cov[c0][c1] * axis[c1];
+			}
+			if (length2 == 0.0f)
+				return trace;
+			float invLength = 1.0f / sqrtf(length2);
+			for (int c = 0; c < channels; c++)
+				axis[c] *= invLength;
+			return Math::Max(0.0f, trace - projected / length2);
+		}
+
+		void FitEndpoints(const BC7Block & block, unsigned int texelMask, int channels, float endpoints[2][4])
+		{
+			float mean[4], axis[4];
+			FitLine(ComputeMoments(block, texelMask, channels), channels, mean, axis);
+			float tMin = 0.0f, tMax = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				if (texelMask & (1 << i))
+				{
+					float t = 0.0f;
+					for (int c = 0; c < channels; c++)
+						t += ((float)block.Texels[c][i] - mean[c]) * axis[c];
+					tMin = Math::Min(tMin, t);
+					tMax = Math::Max(tMax, t);
+				}
+			}
+			for (int c = 0; c < 4; c++)
+			{
+				if (c < channels)
+				{
+					endpoints[0][c] = Math::Clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+					endpoints[1][c] = Math::Clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+				}
+				else
+					endpoints[0][c] = endpoints[1][c] = 255.0f;
+			}
+		}
+
+		// least squares endpoints for fixed indices, returns false if the system is singular
+		bool RefineEndpoints(const BC7Block & block, unsigned int texelMask, int channels, const int * indices, int indexBits, float endpoints[2][4])
+		{
+			auto weights = GetWeights(indexBits);
+			float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f;
+			float b0[4] = {}, b1[4] = {};
+			for (int i = 0; i < 16; i++)
+			{
+				if (texelMask & (1 << i))
+				{
+					float w = (float)weights[indices[i]] * (1.0f / 64.0f);
+					float iw = 1.0f - w;
+					a00 += iw * iw;
+					a01 += iw * w;
+					a11 += w * w;
+					for (int c = 0; c < channels; c++)
+					{
+						b0[c] += iw * (float)block.Texels[c][i];
+						b1[c] += w * (float)block.Texels[c][i];
+					}
+				}
+			}
+			float det = a00 * a11 - a01 * a01;
+			if (fabsf(det) < 1e-6f)
+				return false;
+			float invDet = 1.0f / det;
+			for (int c = 0; c < channels; c++)
+			{
+				endpoints[0][c] = Math::Clamp((a11 * b0[c] - a01 * b1[c]) * invDet, 0.0f, 255.0f);
+				endpoints[1][c] = Math::Clamp((a00 * b1[c] - a01 * b0[c]) * invDet, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		// quantizes the endpoints with every p-bit combination and keeps the one with the lowest error
+		void QuantizeSubset(const BC7Block & block, const BC7ModeInfo & mode, unsigned int texelMask, const float endpoints[2][4], BC7Subset & result)
+		{
+			int combinations = mode.EndpointPBits ? 4 : (mode.SharedPBits ? 2 : 1);
+			result.Error = 0x7FFFFFFF;
+			for (int combination = 0; combination < combinations; combination++)
+			{
+				BC7Subset candidate;
+				candidate.PBits[0] = combination & 1;
+				candidate.PBits[1] = mode.EndpointPBits ? (combination >> 1) : (combination & 1);
+				for (int e = 0; e < 2; e++)
+				{
+					int pbit = GetPBit(mode, candidate, e);
+					for (int c = 0; c < 4; c++)
+					{
+						int bits = c < 3 ? mode.ColorBits : mode.AlphaBits;
+						candidate.Endpoints[e][c] = bits ? QuantizeChannel(endpoints[e][c], bits, pbit) : 0;
+					}
+				}
+				if (EvaluateSubset(block, mode, texelMask, candidate) < result.Error)
+					result = candidate;
+			}
+		}
+
+		void EncodeSubset(const BC7Block & block, const BC7ModeInfo & mode, unsigned int texelMask, TextureCompressionQuality quality, BC7Subset & result)
+		{
+			int channels = mode.AlphaBits ? 4 : 3;
+			float endpoints[2][4];
+			FitEndpoints(block, texelMask, channels, endpoints);
+			QuantizeSubset(block, mode, texelMask, endpoints, result);
+			int iterations = quality == TextureCompressionQuality::High ? 3 : (quality == TextureCompressionQuality::Normal ? 1 : 0);
+			for (int iter = 0; iter < iterations && result.Error > 0; iter++)
+			{
+				if (!RefineEndpoints(block, texelMask, channels, result.Indices, mode.IndexBits, endpoints))
+					break;
+				BC7Subset candidate;
+				QuantizeSubset(block, mode, texelMask, endpoints, candidate);
+				if (candidate.Error >= result.Error)
+					break;
+				result = candidate;
+			}
+		}
+
+		void TryMode(const BC7Block & block, int modeIndex, int partition, TextureCompressionQuality quality, BC7Encoding & best)
+		{
+			auto & mode = BC7Modes[modeIndex];
+			BC7Encoding encoding;
+			encoding.Mode = modeIndex;
+			encoding.Partition = partition;
+			encoding.Error = 0;
+			for (int s = 0; s < mode.Subsets; s++)
+			{
+				EncodeSubset(block, mode, GetSubsetMask(mode.Subsets, partition, s), quality, encoding.Subsets[s]);
+				encoding.Error += encoding.Subsets[s].Error;
+				if (encoding.Error >= best.Error)
+					return;
+			}
+			best = encoding;
+		}
+
+		void WriteBC7Block(unsigned char * output, BC7Encoding & encoding)
+		{
+			auto & mode = BC7Modes[encoding.Mode];
+			int maxIndex = (1 << mode.IndexBits) - 1;
+			int indices[16];
+			for (int i = 0; i < 16; i++)
+				indices[i] = encoding.Subsets[GetSubset(mode.Subsets, encoding.Partition, i)].Indices[i];
+			// the most significant index bit of anchor texels is implicitly zero, swap endpoints where needed
+			for (int s = 0; s < mode.Subsets; s++)
+			{
+				auto & subset = encoding.Subsets[s];
+				if (indices[GetAnchor(encoding.Partition, s)] <= (maxIndex >> 1))
+					continue;
+				for (int c = 0; c < 4; c++)
+					Swap(subset.Endpoints[0][c], subset.Endpoints[1][c]);
+				Swap(subset.PBits[0], subset.PBits[1]);
+				for (int i = 0; i < 16; i++)
+				{
+					if (GetSubset(mode.Subsets, encoding.Partition, i) == s)
+						indices[i] = maxIndex - indices[i];
+				}
+			}
+			BitWriter writer;
+			writer.Write(1 << encoding.Mode, encoding.Mode + 1);
+			writer.Write(encoding.Partition, mode.PartitionBits);
+			int channels = mode.AlphaBits ? 4 : 3;
+			for (int c = 0; c < channels; c++)
+			{
+				for (int s = 0; s < mode.Subsets; s++)
+				{
+					for (int e = 0; e < 2; e++)
+						writer.Write(encoding.Subsets[s].Endpoints[e][c], c < 3 ? mode.ColorBits : mode.AlphaBits);
+				}
+			}
+			for (int s = 0; s < mode.Subsets; s++)
+			{
+				if (mode.EndpointPBits)
+				{
+					writer.Write(encoding.Subsets[s].PBits[0], 1);
+					writer.Write(encoding.Subsets[s].PBits[1], 1);
+				}
+				else if (mode.SharedPBits)
+					writer.Write(encoding.Subsets[s].PBits[0], 1);
+			}
+			for (int i = 0; i < 16; i++)
+				writer.Write(indices[i], IsAnchor(mode.Subsets, encoding.Partition, i) ? mode.IndexBits - 1 : mode.IndexBits);
+			writer.Store(output);
+		}
+
+		/*
+		 * BC6H, a port of the BC6Compression.slang compute kernel so that CPU and GPU results agree
+		 */
+
+		const float HalfMax = 65504.0f;
+
+		struct BC6HBlock
+		{
+			Vec3 Texels[16];
+			Vec3 LogTexels[16]; // log2(texel + 1), the space the error is measured in
+			alignas(16) float X[16], Y[16], Z[16];
+		};
+
+		struct Int3
+		{
+			int x, y, z;
+		};
+
+		// f32tof16 for values in [0, 65504], rounding to nearest even
+		inline unsigned int HalfBits(float x)
+		{
+			if (x < 6.103515625e-05f)
+				return (unsigned int)_mm_cvtss_si32(_mm_set_ss(x * 16777216.0f));
+			unsigned int bits;
+			memcpy(&bits, &x, sizeof(bits));
+			return (bits + 0xFFF + ((bits >> 13) & 1) - (112u << 23)) >> 13;
+		}
+
+		inline __m128 HalfBits4(__m128 x)
+		{
+			__m128i bits = _mm_castps_si128(x);
+			__m128i rounding = _mm_add_epi32(_mm_set1_epi32(0xFFF), _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1)));
+			__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, rounding), _mm_set1_epi32(112 << 23)), 13);
+			__m128i denormal = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(16777216.0f)));
+			__m128i isDenormal = _mm_castps_si128(_mm_cmplt_ps(x, _mm_set1_ps(6.103515625e-05f)));
+			return _mm_cvtepi32_ps(_mm_blendv_epi8(normal, denormal, isDenormal));
+		}
+
+		inline Vec3 Min(const Vec3 & a, const Vec3 & b)
+		{
+			return Vec3::Create(Math::Min(a.x, b.x), Math::Min(a.y, b.y), Math::Min(a.z, b.z));
+		}
+
+		inline Vec3 Max(const Vec3 & a, const Vec3 & b)
+		{
+			return Vec3::Create(Math::Max(a.x, b.x), Math::Max(a.y, b.y), Math::Max(a.z, b.z));
+		}
+
+		inline Vec3 Log2(const Vec3 & v)
+		{
+			return Vec3::Create(log2f(v.x), log2f(v.y), log2f(v.z));
+		}
+
+		inline Vec3 Exp2(const Vec3 & v)
+		{
+			return Vec3::Create(exp2f(v.x), exp2f(v.y), exp2f(v.z));
+		}
+
+		// floor of the endpoint quantized to `levels` steps of the half float range
+		inline Int3 Quantize(const Vec3 & x, float levels)
+		{
+			float scale = levels / (0x7bff + 1.0f);
+			return Int3{ (int)floorf(HalfBits(x.x) * scale), (int)floorf(HalfBits(x.y) * scale), (int)floorf(HalfBits(x.z) * scale) };
+		}
+
+		inline Vec3 Unquantize(const Int3 & x, float levels)
+		{
+			return Vec3::Create((x.x * 65536.0f + 0x8000) / levels, (x.y * 65536.0f + 0x8000) / levels, (x.z * 65536.0f + 0x8000) / levels);
+		}
+
+		inline Vec3 FinishUnquantize(const Vec3 & endpoint0Unq, const Vec3 & endpoint1Unq, float weight)
+		{
+			Vec3 comp = (endpoint0Unq * (64.0f - weight) + endpoint1Unq * weight + Vec3::Create(32.0f)) * (31.0f / 4096.0f);
+			return Vec3::Create(HalfToFloat((unsigned short)comp.x), HalfToFloat((unsigned short)comp.y), HalfToFloat((unsigned short)comp.z));
+		}
+
+		inline float CalcMSLE(const Vec3 & logA, const Vec3 & b)
+		{
+			Vec3 err = Vec3::Create(log2f(b.x + 1.0f), log2f(b.y + 1.0f), log2f(b.z + 1.0f)) - logA;
+			return err.x * err.x + err.y * err.y + err.z * err.z;
+		}
+
+		// normalized so that the components sum to one; a zero range falls back to the gray axis
+		inline Vec3 GetBlockDir(const Vec3 & blockMin, const Vec3 & blockMax)
+		{
+			Vec3 dir = blockMax - blockMin;
+			float sum = dir.x + dir.y + dir.z;
+			if (!(sum > 0.0f))
+				return Vec3::Create(1.0f / 3.0f);
+			return dir * (1.0f / sum);
+		}
+
+		// f32tof16 of the texel positions along `dir`, four texels per SSE register
+		void ProjectTexels(const BC6HBlock & block, const Vec3 & dir, float * positions)
+		{
+			__m128 dx = _mm_set1_ps(dir.x), dy = _mm_set1_ps(dir.y), dz = _mm_set1_ps(dir.z);
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(block.X + i), dx), _mm_mul_ps(_mm_load_ps(block.Y + i), dy)),
+					_mm_mul_ps(_mm_load_ps(block.Z + i), dz));
+				_mm_storeu_ps(positions + i, HalfBits4(p));
+			}
+		}
+
+		// ComputeIndex3/ComputeIndex4 of the kernel for 16 texels, NaNs from a zero range map to index 0
+		void ComputeIndices(const float * positions, float endpoint0Pos, float endpoint1Pos, float scale, float bias, int maxIndex, int * indices)
+		{
+			__m128 e0 = _mm_set1_ps(endpoint0Pos);
+			__m128 range = _mm_set1_ps(endpoint1Pos - endpoint0Pos);
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128 r = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(positions + i), e0), range);
+				__m128 v = _mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(scale)), _mm_set1_ps(bias + 0.5f));
+				v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps((float)maxIndex));
+				_mm_storeu_si128((__m128i*)(indices + i), _mm_cvttps_epi32(v));
+			}
+		}
+
+		inline void SignExtend(Int3 & v, int mask, int signFlag)
+		{
+			v.x = (v.x & mask) | (v.x < 0 ? signFlag : 0);
+			v.y = (v.y & mask) | (v.y < 0 ? signFlag : 0);
+			v.z = (v.z & mask) | (v.z < 0 ? signFlag : 0);
+		}
+
+		inline Int3 ClampDelta(const Int3 & v, const Int3 & base, int maxVal)
+		{
+			return Int3{ Math::Clamp(v.x - base.x, -maxVal, maxVal), Math::Clamp(v.y - base.y, -maxVal, maxVal), Math::Clamp(v.z - base.z, -maxVal, maxVal) };
+		}
+
+		inline Int3 Add(const Int3 & a, const Int3 & b)
+		{
+			return Int3{ a.x + b.x, a.y + b.y, a.z + b.z };
+		}
+
+		// single region mode 11, 10 bit endpoints and 4 bit indices
+		void EncodeP1(uint32_t block[4], float & blockMSLE, const BC6HBlock & b)
+		{
+			auto texels = b.Texels;
+			Vec3 blockMin = texels[0];
+			Vec3 blockMax = texels[0];
+			for (int i = 1; i < 16; i++)
+			{
+				blockMin = Min(blockMin, texels[i]);
+				blockMax = Max(blockMax, texels[i]);
+			}
+
+			// refine endpoints in log2 RGB space
+			Vec3 refinedBlockMin = blockMax;
+			Vec3 refinedBlockMax = blockMin;
+			for (int i = 0; i < 16; i++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					refinedBlockMin[c] = Math::Min(refinedBlockMin[c], texels[i][c] == blockMin[c] ? refinedBlockMin[c] : texels[i][c]);
+					refinedBlockMax[c] = Math::Max(refinedBlockMax[c], texels[i][c] == blockMax[c] ? refinedBlockMax[c] : texels[i][c]);
+				}
+			}
+			Vec3 one = Vec3::Create(1.0f);
+			Vec3 logBlockMax = Log2(blockMax + one);
+			Vec3 logBlockMin = Log2(blockMin + one);
+			Vec3 logRefinedBlockMax = Log2(refinedBlockMax + one);
+			Vec3 logRefinedBlockMin = Log2(refinedBlockMin + one);
+			Vec3 logBlockMaxExt = (logBlockMax - logBlockMin) * (1.0f / 32.0f);
+			logBlockMin += Min(logRefinedBlockMin - logBlockMin, logBlockMaxExt);
+			logBlockMax -= Min(logBlockMax - logRefinedBlockMax, logBlockMaxExt);
+			blockMin = Exp2(logBlockMin) - one;
+			blockMax = Exp2(logBlockMax) - one;
+
+			Vec3 blockDir = GetBlockDir(blockMin, blockMax);
+			Int3 endpoint0 = Quantize(blockMin, 1024.0f);
+			Int3 endpoint1 = Quantize(blockMax, 1024.0f);
+			float endpoint0Pos = (float)HalfBits(Math::Max(0.0f, Vec3::Dot(blockMin, blockDir)));
+			float endpoint1Pos = (float)HalfBits(Math::Max(0.0f, Vec3::Dot(blockMax, blockDir)));
+
+			float positions[16];
+			int indices[16];
+			ProjectTexels(b, blockDir, positions);
+			ComputeIndices(positions, endpoint0Pos, endpoint1Pos, 14.93333f, 0.03333f, 15, indices);
+			// check if endpoint swap is required
+			if (indices[0] > 7)
+			{
+				Swap(endpoint0Pos, endpoint1Pos);
+				Swap(endpoint0, endpoint1);
+				ComputeIndices(positions, endpoint0Pos, endpoint1Pos, 14.93333f, 0.03333f, 15, indices);
+			}
+			// rounding may still leave the anchor index one step too high
+			indices[0] = Math::Min(indices[0], 7);
+
+			// compute compression error (MSLE)
+			Vec3 endpoint0Unq = Unquantize(endpoint0, 1024.0f);
+			Vec3 endpoint1Unq = Unquantize(endpoint1, 1024.0f);
+			float msle = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				float weight = floorf((indices[i] * 64.0f) / 15.0f + 0.5f);
+				msle += CalcMSLE(b.LogTexels[i], FinishUnquantize(endpoint0Unq, endpoint1Unq, weight));
+			}
+
+			// encode block for mode 11
+			blockMSLE = msle;
+			block[0] = 0x03;
+			block[1] = block[2] = block[3] = 0;
+
+			// endpoints
+			block[0] |= (uint32_t)endpoint0.x << 5;
+			block[0] |= (uint32_t)endpoint0.y << 15;
+			block[0] |= (uint32_t)endpoint0.z << 25;
+			block[1] |= (uint32_t)endpoint0.z >> 7;
+			block[1] |= (uint32_t)endpoint1.x << 3;
+			block[1] |= (uint32_t)endpoint1.y << 13;
+			block[1] |= (uint32_t)endpoint1.z << 23;
+			block[2] |= (uint32_t)endpoint1.z >> 9;
+
+			// indices
+			block[2] |= indices[0] << 1;
+			for (int i = 1; i < 8; i++)
+				block[2] |= indices[i] << (i * 4);
+			for (int i = 8; i < 16; i++)
+				block[3] |= indices[i] << ((i - 8) * 4);
+		}
+
+		// two region modes 2 (7.6 bits) and 10 (9.5 bits) for one partition, 3 bit indices
+		void EncodeP2Pattern(uint32_t block[4], float & blockMSLE, int pattern, const BC6HBlock & b)
+		{
+			auto texels = b.Texels;
+			Vec3 p0BlockMin = Vec3::Create(HalfMax);
+			Vec3 p0BlockMax = Vec3::Create(0.0f);
+			Vec3 p1BlockMin = Vec3::Create(HalfMax);
+			Vec3 p1BlockMax = Vec3::Create(0.0f);
+			for (int i = 0; i < 16; i++)
+			{
+				if (GetSubset(2, pattern, i) == 0)
+				{
+					p0BlockMin = Min(p0BlockMin, texels[i]);
+					p0BlockMax = Max(p0BlockMax, texels[i]);
+				}
+				else
+				{
+					p1BlockMin = Min(p1BlockMin, texels[i]);
+					p1BlockMax = Max(p1BlockMax, texels[i]);
+				}
+			}
+
+			Vec3 p0BlockDir = GetBlockDir(p0BlockMin, p0BlockMax);
+			Vec3 p1BlockDir = GetBlockDir(p1BlockMin, p1BlockMax);
+			float p0Endpoint0Pos = (float)HalfBits(Vec3::Dot(p0BlockMin, p0BlockDir));
+			float p0Endpoint1Pos = (float)HalfBits(Vec3::Dot(p0BlockMax, p0BlockDir));
+			float p1Endpoint0Pos = (float)HalfBits(Vec3::Dot(p1BlockMin, p1BlockDir));
+			float p1Endpoint1Pos = (float)HalfBits(Vec3::Dot(p1BlockMax, p1BlockDir));
+
+			int fixupID = Anchors2[pattern];
+			float p0Positions[16], p1Positions[16];
+			int p0Indices[16], p1Indices[16];
+			ProjectTexels(b, p0BlockDir, p0Positions);
+			ProjectTexels(b, p1BlockDir, p1Positions);
+			ComputeIndices(p0Positions, p0Endpoint0Pos, p0Endpoint1Pos, 6.98182f, 0.00909f, 7, p0Indices);
+			ComputeIndices(p1Positions, p1Endpoint0Pos, p1Endpoint1Pos, 6.98182f, 0.00909f, 7, p1Indices);
+			if (p0Indices[0] > 3)
+			{
+				Swap(p0Endpoint0Pos, p0Endpoint1Pos);
+				Swap(p0BlockMin, p0BlockMax);
+				ComputeIndices(p0Positions, p0Endpoint0Pos, p0Endpoint1Pos, 6.98182f, 0.00909f, 7, p0Indices);
+			}
+			if (p1Indices[fixupID] > 3)
+			{
+				Swap(p1Endpoint0Pos, p1Endpoint1Pos);
+				Swap(p1BlockMin, p1BlockMax);
+				ComputeIndices(p1Positions, p1Endpoint0Pos, p1Endpoint1Pos, 6.98182f, 0.00909f, 7, p1Indices);
+			}
+
+			int indices[16];
+			for (int i = 0; i < 16; i++)
+				indices[i] = GetSubset(2, pattern, i) == 0 ? p0Indices[i] : p1Indices[i];
+			indices[0] = Math::Min(indices[0], 3);
+			indices[fixupID] = Math::Min(indices[fixupID], 3);
+
+			Int3 endpoint760 = Quantize(p0BlockMin, 128.0f);
+			Int3 endpoint761 = Quantize(p0BlockMax, 128.0f);
+			Int3 endpoint762 = Quantize(p1BlockMin, 128.0f);
+			Int3 endpoint763 = Quantize(p1BlockMax, 128.0f);
+
+			Int3 endpoint950 = Quantize(p0BlockMin, 512.0f);
+			Int3 endpoint951 = Quantize(p0BlockMax, 512.0f);
+			Int3 endpoint952 = Quantize(p1BlockMin, 512.0f);
+			Int3 endpoint953 = Quantize(p1BlockMax, 512.0f);
+
+			endpoint761 = ClampDelta(endpoint761, endpoint760, 0x1F);
+			endpoint762 = ClampDelta(endpoint762, endpoint760, 0x1F);
+			endpoint763 = ClampDelta(endpoint763, endpoint760, 0x1F);
+
+			endpoint951 = ClampDelta(endpoint951, endpoint950, 0xF);
+			endpoint952 = ClampDelta(endpoint952, endpoint950, 0xF);
+			endpoint953 = ClampDelta(endpoint953, endpoint950, 0xF);
+
+			Vec3 endpoint760Unq = Unquantize(endpoint760, 128.0f);
+			Vec3 endpoint761Unq = Unquantize(Add(endpoint760, endpoint761), 128.0f);
+			Vec3 endpoint762Unq = Unquantize(Add(endpoint760, endpoint762), 128.0f);
+			Vec3 endpoint763Unq = Unquantize(Add(endpoint760, endpoint763), 128.0f);
+			Vec3 endpoint950Unq = Unquantize(endpoint950, 512.0f);
+			Vec3 endpoint951Unq = Unquantize(Add(endpoint950, endpoint951), 512.0f);
+			Vec3 endpoint952Unq = Unquantize(Add(endpoint950, endpoint952), 512.0f);
+			Vec3 endpoint953Unq = Unquantize(Add(endpoint950, endpoint953), 512.0f);
+
+			float msle76 = 0.0f;
+			float msle95 = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				int paletteID = GetSubset(2, pattern, i);
+				Vec3 tmp760Unq = paletteID == 0 ? endpoint760Unq : endpoint762Unq;
+				Vec3 tmp761Unq = paletteID == 0 ? endpoint761Unq : endpoint763Unq;
+				Vec3 tmp950Unq = paletteID == 0 ? endpoint950Unq : endpoint952Unq;
+				Vec3 tmp951Unq = paletteID == 0 ? endpoint951Unq : endpoint953Unq;
+				float weight = floorf((indices[i] * 64.0f) / 7.0f + 0.5f);
+				msle76 += CalcMSLE(b.LogTexels[i], FinishUnquantize(tmp760Unq, tmp761Unq, weight));
+				msle95 += CalcMSLE(b.LogTexels[i], FinishUnquantize(tmp950Unq, tmp951Unq, weight));
+				// the 9.5 mode is usually the better one, stop as soon as both are worse than the current block
+				if (msle76 >= blockMSLE && msle95 >= blockMSLE)
+					return;
+			}
+
+			SignExtend(endpoint761, 0x1F, 0x20);
+			SignExtend(endpoint762, 0x1F, 0x20);
+			SignExtend(endpoint763, 0x1F, 0x20);
+
+			SignExtend(endpoint951, 0xF, 0x10);
+			SignExtend(endpoint952, 0xF, 0x10);
+			SignExtend(endpoint953, 0xF, 0x10);
+
+			// encode block
+			float p2MSLE = Math::Min(msle76, msle95);
+			if (p2MSLE >= blockMSLE)
+				return;
+			blockMSLE = p2MSLE;
+			block[0] = block[1] = block[2] = block[3] = 0;
+
+			if (p2MSLE == msle76)
+			{
+				// 7.6
+				block[0] = 0x1;
+				block[0] |= ((uint32_t)endpoint762.y & 0x20) >> 3;
+				block[0] |= ((uint32_t)endpoint763.y & 0x10) >> 1;
+				block[0] |= ((uint32_t)endpoint763.y & 0x20) >> 1;
+				block[0] |= (uint32_t)endpoint760.x << 5;
+				block[0] |= ((uint32_t)endpoint763.z & 0x01) << 12;
+				block[0] |= ((uint32_t)endpoint763.z & 0x02) << 12;
+				block[0] |= ((uint32_t)endpoint762.z & 0x10) << 10;
+				block[0] |= (uint32_t)endpoint760.y << 15;
+				block[0] |= ((uint32_t)endpoint762.z & 0x20) << 17;
+				block[0] |= ((uint32_t)endpoint763.z & 0x04) << 21;
+				block[0] |= ((uint32_t)endpoint762.y & 0x10) << 20;
+				block[0] |= (uint32_t)endpoint760.z << 25;
+				block[1] |= ((uint32_t)endpoint763.z & 0x08) >> 3;
+				block[1] |= ((uint32_t)endpoint763.z & 0x20) >> 4;
+				block[1] |= ((uint32_t)endpoint763.z & 0x10) >> 2;
+				block[1] |= (uint32_t)endpoint761.x << 3;
+				block[1] |= ((uint32_t)endpoint762.y & 0x0F) << 9;
+				block[1] |= (uint32_t)endpoint761.y << 13;
+				block[1] |= ((uint32_t)endpoint763.y & 0x0F) << 19;
+				block[1] |= (uint32_t)endpoint761.z << 23;
+				block[1] |= ((uint32_t)endpoint762.z & 0x07) << 29;
+				block[2] |= ((uint32_t)endpoint762.z & 0x08) >> 3;
+				block[2] |= (uint32_t)endpoint762.x << 1;
+				block[2] |= (uint32_t)endpoint763.x << 7;
+			}
+			else
+			{
+				// 9.5
+				block[0] = 0xE;
+				block[0] |= (uint32_t)endpoint950.x << 5;
+				block[0] |= ((uint32_t)endpoint952.z & 0x10) << 10;
+				block[0] |= (uint32_t)endpoint950.y << 15;
+				block[0] |= ((uint32_t)endpoint952.y & 0x10) << 20;
+				block[0] |= (uint32_t)endpoint950.z << 25;
+				block[1] |= (uint32_t)endpoint950.z >> 7;
+				block[1] |= ((uint32_t)endpoint953.z & 0x10) >> 2;
+				block[1] |= (uint32_t)endpoint951.x << 3;
+				block[1] |= ((uint32_t)endpoint953.y & 0x10) << 4;
+				block[1] |= ((uint32_t)endpoint952.y & 0x0F) << 9;
+				block[1] |= (uint32_t)endpoint951.y << 13;
+				block[1] |= ((uint32_t)endpoint953.z & 0x01) << 18;
+				block[1] |= ((uint32_t)endpoint953.y & 0x0F) << 19;
+				block[1] |= (uint32_t)endpoint951.z << 23;
+				block[1] |= ((uint32_t)endpoint953.z & 0x02) << 27;
+				block[1] |= (uint32_t)endpoint952.z << 29;
+				block[2] |= ((uint32_t)endpoint952.z & 0x08) >> 3;
+				block[2] |= (uint32_t)endpoint952.x << 1;
+				block[2] |= ((uint32_t)endpoint953.z & 0x04) << 4;
+				block[2] |= (uint32_t)endpoint953.x << 7;
+				block[2] |= ((uint32_t)endpoint953.z & 0x08) << 9;
+			}
+
+			// partition and indices, the anchor indices are one bit shorter
+			block[2] |= pattern << 13;
+			int pos = 82;
+			for (int i = 0; i < 16; i++)
+			{
+				int bits = (i == 0 || i == fixupID) ? 2 : 3;
+				uint64_t value = (uint64_t)indices[i] << (pos & 31);
+				block[pos >> 5] |= (uint32_t)value;
+				if ((pos & 31) + bits > 32)
+					block[(pos >> 5) + 1] |= (uint32_t)(value >> 32);
+				pos += bits;
+			}
+		}
+
+		// squared distance of the texels of both regions from the line through their bounding box corners
+		// in log space, a cheap stand-in for the error of a partition
+		float EstimatePatternError(const BC6HBlock & b, int pattern)
+		{
+			float error = 0.0f;
+			for (int s = 0; s < 2; s++)
+			{
+				unsigned int mask = GetSubsetMask(2, pattern, s);
+				Vec3 logMin = Vec3::Create(FLT_MAX), logMax = Vec3::Create(-FLT_MAX);
+				for (int i = 0; i < 16; i++)
+				{
+					if (mask & (1 << i))
+					{
+						logMin = Min(logMin, b.LogTexels[i]);
+						logMax = Max(logMax, b.LogTexels[i]);
+					}
+				}
+				Vec3 dir = logMax - logMin;
+				float length2 = Vec3::Dot(dir, dir);
+				float invLength2 = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+				for (int i = 0; i < 16; i++)
+				{
+					if (mask & (1 << i))
+					{
+						Vec3 d = b.LogTexels[i] - logMin;
+						Vec3 offset = d - dir * (Vec3::Dot(d, dir) * invLength2);
+						error += Vec3::Dot(offset, offset);
+					}
+				}
+			}
+			return error;
+		}
+
+		// BC6H field layouts used by the decoder: `bits` bits of channel `channel` of endpoint `endpoint`,
+		// starting at bit `shift` of that channel, in stream order
+		struct BC6HField
+		{
+			unsigned char endpoint, channel, shift, bits;
+		};
+		const BC6HField BC6HMode2Fields[] =
+		{
+			{ 2, 1, 5, 1 }, { 3, 1, 4, 1 }, { 3, 1, 5, 1 }, { 0, 0, 0, 7 }, { 3, 2, 0, 1 }, { 3, 2, 1, 1 }, { 2, 2, 4, 1 }, { 0, 1, 0, 7 },
+			{ 2, 2, 5, 1 }, { 3, 2, 2, 1 }, { 2, 1, 4, 1 }, { 0, 2, 0, 7 }, { 3, 2, 3, 1 }, { 3, 2, 5, 1 }, { 3, 2, 4, 1 }, { 1, 0, 0, 6 },
+			{ 2, 1, 0, 4 }, { 1, 1, 0, 6 }, { 3, 1, 0, 4 }, { 1, 2, 0, 6 }, { 2, 2, 0, 4 }, { 2, 0, 0, 6 }, { 3, 0, 0, 6 }
+		};
+		const BC6HField BC6HMode10Fields[] =
+		{
+			{ 0, 0, 0, 9 }, { 2, 2, 4, 1 }, { 0, 1, 0, 9 }, { 2, 1, 4, 1 }, { 0, 2, 0, 9 }, { 3, 2, 4, 1 }, { 1, 0, 0, 5 }, { 3, 1, 4, 1 },
+			{ 2, 1, 0, 4 }, { 1, 1, 0, 5 }, { 3, 2, 0, 1 }, { 3, 1, 0, 4 }, { 1, 2, 0, 5 }, { 3, 2, 1, 1 }, { 2, 2, 0, 4 }, { 2, 0, 0, 5 },
+			{ 3, 2, 2, 1 }, { 3, 0, 0, 5 }, { 3, 2, 3, 1 }
+		};
+		const BC6HField BC6HMode11Fields[] =
+		{
+			{ 0, 0, 0, 10 }, { 0, 1, 0, 10 }, { 0, 2, 0, 10 }, { 1, 0, 0, 10 }, { 1, 1, 0, 10 }, { 1, 2, 0, 10 }
+		};
+
+		inline int UnquantizeBC6H(int value, int bits)
+		{
+			if (value == 0)
+				return 0;
+			if (value == (1 << bits) - 1)
+				return 0xFFFF;
+			return ((value << 16) + 0x8000) >> bits;
+		}
+	}
+
+	void CompressBlock_BC7(unsigned char * output, const unsigned char * rgbaTexels, TextureCompressionQuality quality)
+	{
+		BC7Block block;
+		block.Opaque = true;
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+				block.Texels[c][i] = rgbaTexels[i * 4 + c];
+			block.Opaque = block.Opaque && rgbaTexels[i * 4 + 3] == 255;
+		}
+		BC7Encoding best;
+		TryMode(block, 6, 0, quality, best);
+		// Normal leaves blocks that are already within about one step per channel to mode 6
+		int searchThreshold = quality == TextureCompressionQuality::Normal ? 16 * 3 : 0;
+		if (quality != TextureCompressionQuality::Fast && best.Error > searchThreshold)
+		{
+			// rank the partitions by how well each subset fits a line and fully encode the best ones
+			float errors[32];
+			int candidates[8];
+			int channels = block.Opaque ? 3 : 4;
+			auto blockMoments = ComputeMoments(block, 0xFFFF, channels);
+			for (int p = 0; p < 32; p++)
+			{
+				float mean[4], axis[4];
+				auto subsetMoments = ComputeMoments(block, GetSubsetMask(2, p, 0), channels);
+				errors[p] = FitLine(subsetMoments, channels, mean, axis) + FitLine(blockMoments - subsetMoments, channels, mean, axis);
+			}
+			int count = SelectPartitions(errors, quality == TextureCompressionQuality::High ? 8 : 2, candidates);
+			for (int i = 0; i < count; i++)
+			{
+				if (block.Opaque)
+				{
+					TryMode(block, 1, candidates[i], quality, best);
+					TryMode(block, 3, candidates[i], quality, best);
+				}
+				else
+					TryMode(block, 7, candidates[i], quality, best);
+			}
+		}
+		WriteBC7Block(output, best);
+	}
+
+	void DecompressBlock_BC7(unsigned char * rgbaTexels, const unsigned char * input)
+	{
+		BitReader reader(input);
+		int modeIndex = 0;
+		while (modeIndex < 8 && reader.Read(1) == 0)
+			modeIndex++;
+		if (modeIndex == 8 || BC7Modes[modeIndex].Subsets == 0)
+		{
+			memset(rgbaTexels, 0, 64);
+			return;
+		}
+		auto & mode = BC7Modes[modeIndex];
+		int partition = reader.Read(mode.PartitionBits);
+		if (partition >= 32)
+		{
+			memset(rgbaTexels, 0, 64);
+			return;
+		}
+		BC7Subset subsets[2];
+		int channels = mode.AlphaBits ? 4 : 3;
+		for (int c = 0; c < channels; c++)
+		{
+			for (int s = 0; s < mode.Subsets; s++)
+			{
+				for (int e = 0; e < 2; e++)
+					subsets[s].Endpoints[e][c] = reader.Read(c < 3 ? mode.ColorBits : mode.AlphaBits);
+			}
+		}
+		for (int s = 0; s < mode.Subsets; s++)
+		{
+			if (mode.EndpointPBits)
+			{
+				subsets[s].PBits[0] = reader.Read(1);
+				subsets[s].PBits[1] = reader.Read(1);
+			}
+			else if (mode.SharedPBits)
+				subsets[s].PBits[0] = subsets[s].PBits[1] = reader.Read(1);
+		}
+		int endpoints[2][2][4];
+		for (int s = 0; s < mode.Subsets; s++)
+		{
+			for (int e = 0; e < 2; e++)
+			{
+				int pbit = GetPBit(mode, subsets[s], e);
+				for (int c = 0; c < 4; c++)
+					endpoints[s][e][c] = c < channels ? DecodeChannel(subsets[s].Endpoints[e][c], c < 3 ? mode.ColorBits : mode.AlphaBits, pbit) : 255;
+			}
+		}
+		auto weights = GetWeights(mode.IndexBits);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = reader.Read(IsAnchor(mode.Subsets, partition, i) ? mode.IndexBits - 1 : mode.IndexBits);
+			int s = GetSubset(mode.Subsets, partition, i);
+			int w = weights[index];
+			for (int c = 0; c < 4; c++)
+				rgbaTexels[i * 4 + c] = (unsigned char)(((64 - w) * endpoints[s][0][c] + w * endpoints[s][1][c] + 32) >> 6);
+		}
+	}
+
+	void CompressBlock_BC6H(unsigned char * output, const float * rgbTexels, TextureCompressionQuality quality)
+	{
+		BC6HBlock block;
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				float v = rgbTexels[i * 3 + c];
+				// also maps NaN to zero
+				v = v > 0.0f ? Math::Min(v, HalfMax) : 0.0f;
+				block.Texels[i][c] = v;
+			}
+			block.LogTexels[i] = Log2(block.Texels[i] + Vec3::Create(1.0f));
+			block.X[i] = block.Texels[i].x;
+			block.Y[i] = block.Texels[i].y;
+			block.Z[i] = block.Texels[i].z;
+		}
+		uint32_t result[4] = { 0, 0, 0, 0 };
+		float blockMSLE = 0.0f;
+		EncodeP1(result, blockMSLE, block);
+		if (quality == TextureCompressionQuality::High)
+		{
+			for (int p = 0; p < 32 && blockMSLE > 0.0f; p++)
+				EncodeP2Pattern(result, blockMSLE, p, block);
+		}
+		else if (quality == TextureCompressionQuality::Normal)
+		{
+			// only encode the partitions whose regions fit a line best
+			float errors[32];
+			int candidates[4];
+			for (int p = 0; p < 32; p++)
+				errors[p] = EstimatePatternError(block, p);
+			int count = SelectPartitions(errors, 4, candidates);
+			for (int i = 0; i < count && blockMSLE > 0.0f; i++)
+				EncodeP2Pattern(result, blockMSLE, candidates[i], block);
+		}
+		memcpy(output, result, 16);
+	}
+
+	void DecompressBlock_BC6H(float * rgbTexels, const unsigned char * input)
+	{
+		BitReader reader(input);
+		int mode = reader.Read(2);
+		const BC6HField * fields;
+		int fieldCount, endpointBits, deltaBits, subsets;
+		if (mode == 1)
+		{
+			fields = BC6HMode2Fields;
+			fieldCount = sizeof(BC6HMode2Fields) / sizeof(BC6HField);
+			endpointBits = 7;
+			deltaBits = 6;
+			subsets = 2;
+		}
+		else
+		{
+			mode |= reader.Read(3) << 2;
+			if (mode == 0x0E)
+			{
+				fields = BC6HMode10Fields;
+				fieldCount = sizeof(BC6HMode10Fields) / sizeof(BC6HField);
+				endpointBits = 9;
+				deltaBits = 5;
+				subsets = 2;
+			}
+			else if (mode == 0x03)
+			{
+				fields = BC6HMode11Fields;
+				fieldCount = sizeof(BC6HMode11Fields) / sizeof(BC6HField);
+				endpointBits = 10;
+				deltaBits = 0;
+				subsets = 1;
+			}
+			else
+			{
+				memset(rgbTexels, 0, sizeof(float) * 48);
+				return;
+			}
+		}
+		int endpoints[4][3] = {};
+		for (int f = 0; f < fieldCount; f++)
+			endpoints[fields[f].endpoint][fields[f].channel] |= reader.Read(fields[f].bits) << fields[f].shift;
+		if (deltaBits)
+		{
+			// transformed endpoints are stored as signed deltas from the first endpoint
+			int mask = (1 << endpointBits) - 1;
+			for (int e = 1; e < 4; e++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					int delta = endpoints[e][c];
+					if (delta & (1 << (deltaBits - 1)))
+						delta -= 1 << deltaBits;
+					endpoints[e][c] = (endpoints[0][c] + delta) & mask;
+				}
+			}
+		}
+		for (int e = 0; e < 4; e++)
+			for (int c = 0; c < 3; c++)
+				endpoints[e][c] = UnquantizeBC6H(endpoints[e][c], endpointBits);
+		int partition = subsets == 2 ? reader.Read(5) : 0;
+		int indexBits = subsets == 2 ? 3 : 4;
+		auto weights = GetWeights(indexBits);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = reader.Read(IsAnchor(subsets, partition, i) ? indexBits - 1 : indexBits);
+			int s = GetSubset(subsets, partition, i);
+			int w = weights[index];
+			for (int c = 0; c < 3; c++)
+			{
+				int value = ((64 - w) * endpoints[s * 2][c] + w * endpoints[s * 2 + 1][c] + 32) >> 6;
+				rgbTexels[i * 3 + c] = HalfToFloat((unsigned short)((value * 31) >> 6));
+			}
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef GAME_ENGINE_BLOCK_COMPRESSION_H
+#define GAME_ENGINE_BLOCK_COMPRESSION_H
+
+namespace GameEngine
+{
+	enum class TextureCompressionQuality
+	{
+		Fast, Normal, High
+	};
+
+	// Encodes 4x4 RGBA8 texels (row major, 64 bytes) into a 16 byte BC7 block.
+	// Fast only uses the single subset mode 6, Normal and High also search the two subset modes
+	// (1 and 3 for opaque blocks, 7 for blocks with alpha) and refine endpoints by least squares.
+	void CompressBlock_BC7(unsigned char * output, const unsigned char * rgbaTexels, TextureCompressionQuality quality);
+
+	// Encodes 4x4 RGB float texels (row major, 48 floats) into a 16 byte BC6H_UF16 block.
+	// Negative and non finite values are clamped to [0, 65504]. Fast only uses the single region mode,
+	// Normal also tries the four two region partitions that fit the block best and High tries all 32.
+	void CompressBlock_BC6H(unsigned char * output, const float * rgbTexels, TextureCompressionQuality quality);
+
+	// Reference decoders used to measure encoding error. They support the block modes produced by the
+	// encoders above and output zeros for other modes.
+	void DecompressBlock_BC7(unsigned char * rgbaTexels, const unsigned char * input);
+	void DecompressBlock_BC6H(float * rgbTexels, const unsigned char * input);
+}
+
+#endif
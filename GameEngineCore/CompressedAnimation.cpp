@@ -0,0 +1,584 @@
+#include "CompressedAnimation.h"
+#include "CoreLib/LibIO.h"
+
+namespace GameEngine
+{
+    using namespace CoreLib;
+    using namespace CoreLib::IO;
+    using namespace VectorMath;
+
+    namespace
+    {
+        const float SmallestThreeRange = 0.70710678f;
+        const int QuantizedKeySize = 6;
+        const int RawRotationKeySize = sizeof(Quaternion);
+        const int RawVectorKeySize = sizeof(Vec3);
+
+        Quaternion NormalizeRotation(const Quaternion & q)
+        {
+            return q * (1.0f / q.Length());
+        }
+
+        Quaternion InterpolateRotation(const Quaternion & q0, const Quaternion & q1, float t)
+        {
+            return NormalizeRotation(Quaternion::Slerp(q0, q1, t));
+        }
+
+        // rotation angle in radians between two unit quaternions, computed from the chord length to stay
+        // accurate for the small angles we compare against tolerances
+        float RotationError(const Quaternion & q0, Quaternion q1)
+        {
+            if (Quaternion::Dot(q0, q1) < 0.0f)
+                q1 = -q1;
+            float chord = (q0 - q1).Length();
+            return 4.0f * asinf(Math::Min(1.0f, chord * 0.5f));
+        }
+
+        // smallest-three encoding: the largest component is dropped and reconstructed from the unit length,
+        // the other three are stored with 15 bits each and the index of the dropped one takes the top bits
+        void EncodeRotation(unsigned char * dst, const Quaternion & q)
+        {
+            float c[4] = { q.x, q.y, q.z, q.w };
+            int largest = 0;
+            for (int i = 1; i < 4; i++)
+            {
+                if (fabs(c[i]) > fabs(c[largest]))
+                    largest = i;
+            }
+            float scale = (c[largest] < 0.0f ? -0.5f : 0.5f) / SmallestThreeRange;
+            unsigned short words[3];
+            int k = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                if (i == largest)
+                    continue;
+                float v = Math::Clamp(c[i] * scale + 0.5f, 0.0f, 1.0f);
+                words[k++] = (unsigned short)(v * 32767.0f + 0.5f);
+            }
+            words[0] |= (unsigned short)((largest & 1) << 15);
+            words[1] |= (unsigned short)((largest >> 1) << 15);
+            memcpy(dst, words, sizeof(words));
+        }
+
+        Quaternion DecodeRotation(const unsigned char * src)
+        {
+            unsigned short words[3];
+            memcpy(words, src, sizeof(words));
+            int largest = (words[0] >> 15) | ((words[1] >> 15) << 1);
+            float c[4];
+            float sumSquares = 0.0f;
+            int k = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                if (i == largest)
+                    continue;
+                float v = ((words[k++] & 0x7FFF) * (1.0f / 32767.0f) - 0.5f) * (2.0f * SmallestThreeRange);
+                c[i] = v;
+                sumSquares += v * v;
+            }
+            c[largest] = sqrtf(Math::Max(0.0f, 1.0f - sumSquares));
+            return Quaternion(c[0], c[1], c[2], c[3]);
+        }
+
+        void EncodeVector(unsigned char * dst, const Vec3 & v, const Vec3 & rangeMin, const Vec3 & rangeExtent)
+        {
+            unsigned short words[3];
+            for (int i = 0; i < 3; i++)
+            {
+                float t = rangeExtent[i] > 0.0f ? Math::Clamp((v[i] - rangeMin[i]) / rangeExtent[i], 0.0f, 1.0f) : 0.0f;
+                words[i] = (unsigned short)(t * 65535.0f + 0.5f);
+            }
+            memcpy(dst, words, sizeof(words));
+        }
+
+        Vec3 DecodeVector(const unsigned char * src, const Vec3 & rangeMin, const Vec3 & rangeExtent)
+        {
+            unsigned short words[3];
+            memcpy(words, src, sizeof(words));
+            return Vec3::Create(rangeMin.x + words[0] * (1.0f / 65535.0f) * rangeExtent.x,
+                rangeMin.y + words[1] * (1.0f / 65535.0f) * rangeExtent.y,
+                rangeMin.z + words[2] * (1.0f / 65535.0f) * rangeExtent.z);
+        }
+
+        AnimationTrackFormat ClassifyRotationTrack(const List<Quaternion> & samples, float tolerance, Quaternion & start, Quaternion & end)
+        {
+            start = samples.First();
+            end = samples.Last();
+            bool isConstant = true;
+            for (auto & q : samples)
+            {
+                if (RotationError(q, start) > tolerance)
+                {
+                    isConstant = false;
+                    break;
+                }
+            }
+            if (isConstant)
+                return AnimationTrackFormat::Constant;
+            float invLastFrame = 1.0f / (samples.Count() - 1);
+            bool isLinear = true;
+            for (int i = 1; i < samples.Count() - 1; i++)
+            {
+                if (RotationError(samples[i], InterpolateRotation(start, end, i * invLastFrame)) > tolerance)
+                {
+                    isLinear = false;
+                    break;
+                }
+            }
+            if (isLinear)
+                return AnimationTrackFormat::Linear;
+            unsigned char key[QuantizedKeySize];
+            for (auto & q : samples)
+            {
+                EncodeRotation(key, q);
+                if (RotationError(DecodeRotation(key), q) > tolerance)
+                    return AnimationTrackFormat::Raw;
+            }
+            return AnimationTrackFormat::Quantized;
+        }
+
+        AnimationTrackFormat ClassifyVectorTrack(const List<Vec3> & samples, float tolerance, Vec3 & start, Vec3 & end)
+        {
+            start = samples.First();
+            end = samples.Last();
+            bool isConstant = true;
+            for (auto & v : samples)
+            {
+                if ((v - start).Length() > tolerance)
+                {
+                    isConstant = false;
+                    break;
+                }
+            }
+            if (isConstant)
+                return AnimationTrackFormat::Constant;
+            float invLastFrame = 1.0f / (samples.Count() - 1);
+            bool isLinear = true;
+            for (int i = 1; i < samples.Count() - 1; i++)
+            {
+                if ((samples[i] - Vec3::Lerp(start, end, i * invLastFrame)).Length() > tolerance)
+                {
+                    isLinear = false;
+                    break;
+                }
+            }
+            if (isLinear)
+                return AnimationTrackFormat::Linear;
+            Vec3 rangeMin = samples.First(), rangeMax = samples.First();
+            for (auto & v : samples)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    rangeMin[i] = Math::Min(rangeMin[i], v[i]);
+                    rangeMax[i] = Math::Max(rangeMax[i], v[i]);
+                }
+            }
+            start = rangeMin;
+            end = rangeMax - rangeMin;
+            unsigned char key[QuantizedKeySize];
+            for (auto & v : samples)
+            {
+                EncodeVector(key, v, start, end);
+                if ((DecodeVector(key, start, end) - v).Length() > tolerance)
+                {
+                    start = samples.First();
+                    end = samples.Last();
+                    return AnimationTrackFormat::Raw;
+                }
+            }
+            return AnimationTrackFormat::Quantized;
+        }
+
+        int GetKeySize(AnimationTrackFormat format, int rawSize)
+        {
+            if (format == AnimationTrackFormat::Quantized)
+                return QuantizedKeySize;
+            if (format == AnimationTrackFormat::Raw)
+                return rawSize;
+            return 0;
+        }
+
+        void CountTrack(AnimationCompressionStats & stats, AnimationTrackFormat format)
+        {
+            switch (format)
+            {
+            case AnimationTrackFormat::Constant:
+                stats.ConstantTracks++;
+                break;
+            case AnimationTrackFormat::Linear:
+                stats.LinearTracks++;
+                break;
+            case AnimationTrackFormat::Quantized:
+                stats.QuantizedTracks++;
+                break;
+            default:
+                stats.RawTracks++;
+                break;
+            }
+        }
+    }
+
+    const unsigned char * CompressedAnimationClip::GetFrameRecord(int frame) const
+    {
+        int segment = Math::Min(frame / header.SegmentLength, GetSegmentCount() - 1);
+        int localFrame = frame - segment * header.SegmentLength;
+        return SegmentData.Buffer() + segment * GetSegmentStride() + localFrame * header.FrameStride;
+    }
+
+    int CompressedAnimationClip::GetMemorySize() const
+    {
+        int size = sizeof(CompressedAnimationClip) + Name.Length();
+        for (auto & name : BoneNames)
+            size += sizeof(String) + name.Length();
+        size += Tracks.Count() * sizeof(CompressedBoneTrack);
+        for (auto & channel : BlendShapeChannels)
+            size += sizeof(BlendShapeAnimationChannel) + channel.Name.Length() + channel.KeyFrames.Count() * sizeof(BlendShapeAnimationKeyFrame);
+        size += SegmentData.Count();
+        return size;
+    }
+
+    void CompressedAnimationClip::SaveToStream(CoreLib::IO::Stream * stream)
+    {
+        BinaryWriter writer(stream);
+        writer.Write(header);
+        writer.Write(Name);
+        writer.Write(Speed);
+        writer.Write(Duration);
+        writer.Write(FPS);
+        writer.Write(BoneNames.Count());
+        for (auto & name : BoneNames)
+            writer.Write(name);
+        writer.Write(Tracks);
+        writer.Write(BlendShapeChannels.Count());
+        for (auto & channel : BlendShapeChannels)
+        {
+            writer.Write(channel.Name);
+            writer.Write(channel.KeyFrames);
+        }
+        writer.Write(SegmentData);
+        writer.ReleaseStream();
+    }
+
+    void CompressedAnimationClip::LoadFromStream(CoreLib::IO::Stream * stream)
+    {
+        BinaryReader reader(stream);
+        reader.Read(header);
+        if (header.Identifier != CompressedAnimationIdentifier)
+            throw CoreLib::InvalidOperationException("Invalid compressed animation file.");
+        if (header.Version != CurrentCompressedAnimationVersion)
+            throw CoreLib::InvalidOperationException("Unsupported compressed animation file version.");
+        reader.Read(Name);
+        reader.Read(Speed);
+        reader.Read(Duration);
+        reader.Read(FPS);
+        BoneNames.SetSize(reader.ReadInt32());
+        for (auto & name : BoneNames)
+            reader.Read(name);
+        reader.Read(Tracks);
+        BlendShapeChannels.SetSize(reader.ReadInt32());
+        for (auto & channel : BlendShapeChannels)
+        {
+            reader.Read(channel.Name);
+            reader.Read(channel.KeyFrames);
+        }
+        reader.Read(SegmentData);
+        reader.ReleaseStream();
+        if (BoneNames.Count() != Tracks.Count() || header.FrameCount < 1 || header.SegmentLength < 1 ||
+            (header.FrameStride && SegmentData.Count() < GetSegmentCount(header.FrameCount, header.SegmentLength) * GetSegmentStride()))
+            throw CoreLib::InvalidOperationException("Invalid compressed animation file. Key data does not match the track layout.");
+    }
+
+    void CompressedAnimationClip::SaveToFile(const CoreLib::String & filename)
+    {
+        RefPtr<FileStream> stream = new FileStream(filename, FileMode::Create);
+        SaveToStream(stream.Ptr());
+        stream->Close();
+    }
+
+    void CompressedAnimationClip::LoadFromFile(const CoreLib::String & filename)
+    {
+        RefPtr<FileStream> stream = new FileStream(filename, FileMode::Open);
+        LoadFromStream(stream.Ptr());
+        stream->Close();
+    }
+
+    void CompressedAnimationCursor::SetClip(const CompressedAnimationClip * pClip)
+    {
+        clip = pClip;
+        boundSkeleton = nullptr;
+        decodedFrame = -1;
+        if (clip)
+        {
+            frame0.SetSize(clip->Tracks.Count());
+            frame1.SetSize(clip->Tracks.Count());
+            blendShapeKeys.SetSize(clip->BlendShapeChannels.Count());
+            for (auto & key : blendShapeKeys)
+                key = 0;
+        }
+    }
+
+    void CompressedAnimationCursor::DecodeFrame(int frame, List<BoneTransformation> & transforms)
+    {
+        if (!clip->header.FrameStride)
+            return;
+        auto record = clip->GetFrameRecord(frame);
+        for (int i = 0; i < clip->Tracks.Count(); i++)
+        {
+            auto & track = clip->Tracks[i];
+            auto & transform = transforms[i];
+            if (track.RotationFormat == AnimationTrackFormat::Quantized)
+                transform.Rotation = DecodeRotation(record + track.RotationOffset);
+            else if (track.RotationFormat == AnimationTrackFormat::Raw)
+                memcpy(&transform.Rotation, record + track.RotationOffset, RawRotationKeySize);
+            if (track.TranslationFormat == AnimationTrackFormat::Quantized)
+                transform.Translation = DecodeVector(record + track.TranslationOffset, track.TranslationStart, track.TranslationEnd);
+            else if (track.TranslationFormat == AnimationTrackFormat::Raw)
+                memcpy(&transform.Translation, record + track.TranslationOffset, RawVectorKeySize);
+            if (track.ScaleFormat == AnimationTrackFormat::Quantized)
+                transform.Scale = DecodeVector(record + track.ScaleOffset, track.ScaleStart, track.ScaleEnd);
+            else if (track.ScaleFormat == AnimationTrackFormat::Raw)
+                memcpy(&transform.Scale, record + track.ScaleOffset, RawVectorKeySize);
+        }
+    }
+
+    void CompressedAnimationCursor::Seek(float time, float & alpha, float & clipPosition)
+    {
+        int lastFrame = clip->header.FrameCount - 1;
+        float position = Math::Clamp(time * clip->FPS, 0.0f, (float)lastFrame);
+        // the pair (frame, frame + 1) never crosses a segment, the end of the clip is reached with alpha = 1
+        int frame = Math::Min((int)position, Math::Max(lastFrame - 1, 0));
+        alpha = position - frame;
+        clipPosition = lastFrame > 0 ? position / lastFrame : 0.0f;
+        if (frame == decodedFrame)
+            return;
+        if (decodedFrame != -1 && frame == decodedFrame + 1)
+            frame0.SwapWith(frame1);
+        else
+            DecodeFrame(frame, frame0);
+        DecodeFrame(Math::Min(frame + 1, lastFrame), frame1);
+        decodedFrame = frame;
+    }
+
+    void CompressedAnimationCursor::SampleTrack(int trackId, float alpha, float clipPosition, BoneTransformation & result) const
+    {
+        auto & track = clip->Tracks[trackId];
+        if (track.RotationFormat == AnimationTrackFormat::Constant)
+            result.Rotation = track.RotationStart;
+        else if (track.RotationFormat == AnimationTrackFormat::Linear)
+            result.Rotation = InterpolateRotation(track.RotationStart, track.RotationEnd, clipPosition);
+        else
+            result.Rotation = InterpolateRotation(frame0[trackId].Rotation, frame1[trackId].Rotation, alpha);
+        if (track.TranslationFormat == AnimationTrackFormat::Constant)
+            result.Translation = track.TranslationStart;
+        else if (track.TranslationFormat == AnimationTrackFormat::Linear)
+            result.Translation = Vec3::Lerp(track.TranslationStart, track.TranslationEnd, clipPosition);
+        else
+            result.Translation = Vec3::Lerp(frame0[trackId].Translation, frame1[trackId].Translation, alpha);
+        if (track.ScaleFormat == AnimationTrackFormat::Constant)
+            result.Scale = track.ScaleStart;
+        else if (track.ScaleFormat == AnimationTrackFormat::Linear)
+            result.Scale = Vec3::Lerp(track.ScaleStart, track.ScaleEnd, clipPosition);
+        else
+            result.Scale = Vec3::Lerp(frame0[trackId].Scale, frame1[trackId].Scale, alpha);
+    }
+
+    void CompressedAnimationCursor::SampleTracks(float time, BoneTransformation * result)
+    {
+        float alpha, clipPosition;
+        Seek(time, alpha, clipPosition);
+        for (int i = 0; i < clip->Tracks.Count(); i++)
+            SampleTrack(i, alpha, clipPosition, result[i]);
+    }
+
+    float CompressedAnimationCursor::SampleBlendShape(int channel, float time)
+    {
+        auto & keyFrames = clip->BlendShapeChannels[channel].KeyFrames;
+        if (keyFrames.Count() == 0)
+            return 0.0f;
+        // playback moves forward, so the key of the last sample is the starting point of the search
+        int & key = blendShapeKeys[channel];
+        if (key >= keyFrames.Count() || keyFrames[key].Time > time)
+            key = BinarySearchForKeyFrame(keyFrames, time);
+        else
+        {
+            while (key + 1 < keyFrames.Count() && keyFrames[key + 1].Time <= time)
+                key++;
+        }
+        int nextKey = key + 1;
+        float t = 0.0f;
+        if (nextKey < keyFrames.Count())
+            t = (time - keyFrames[key].Time) / (keyFrames[nextKey].Time - keyFrames[key].Time);
+        else
+            nextKey = 0;
+        return keyFrames[key].Weight * (1.0f - t) + keyFrames[nextKey].Weight * t;
+    }
+
+    void CompressedAnimationCursor::GetPose(Pose & pose, const Skeleton * skeleton, float time)
+    {
+        if (boundSkeleton != skeleton)
+        {
+            boneIds.SetSize(clip->BoneNames.Count());
+            for (int i = 0; i < clip->BoneNames.Count(); i++)
+            {
+                boneIds[i] = -1;
+                skeleton->BoneMapping.TryGetValue(clip->BoneNames[i], boneIds[i]);
+            }
+            boundSkeleton = skeleton;
+        }
+        float alpha, clipPosition;
+        Seek(time, alpha, clipPosition);
+        for (int i = 0; i < boneIds.Count(); i++)
+        {
+            if (boneIds[i] != -1)
+                SampleTrack(i, alpha, clipPosition, pose.Transforms[boneIds[i]]);
+        }
+        for (int i = 0; i < clip->BlendShapeChannels.Count(); i++)
+            pose.BlendShapeWeights[clip->BlendShapeChannels[i].Name] = SampleBlendShape(i, time);
+    }
+
+    int AnimationCompressor::GetSourceMemorySize(const SkeletalAnimation & anim)
+    {
+        int size = sizeof(SkeletalAnimation) + anim.Name.Length();
+        for (auto & channel : anim.Channels)
+            size += sizeof(AnimationChannel) + channel.BoneName.Length() + channel.KeyFrames.Count() * sizeof(AnimationKeyFrame);
+        for (auto & channel : anim.BlendShapeChannels)
+            size += sizeof(BlendShapeAnimationChannel) + channel.Name.Length() + channel.KeyFrames.Count() * sizeof(BlendShapeAnimationKeyFrame);
+        return size;
+    }
+
+    RefPtr<CompressedAnimationClip> AnimationCompressor::Compress(const SkeletalAnimation & anim,
+        const AnimationCompressionSettings & settings, AnimationCompressionStats * pStats)
+    {
+        RefPtr<CompressedAnimationClip> clip = new CompressedAnimationClip();
+        clip->Name = anim.Name;
+        clip->Speed = anim.Speed;
+        clip->Duration = anim.Duration;
+        clip->FPS = anim.FPS > 0.0f ? anim.FPS : 30.0f;
+        clip->BlendShapeChannels = anim.BlendShapeChannels;
+        int frameCount = Math::Max(1, (int)ceil(anim.Duration * clip->FPS - 1e-3f) + 1);
+        clip->header.FrameCount = frameCount;
+        clip->header.SegmentLength = Math::Max(1, settings.SegmentLength);
+
+        // resample every channel at the clip frame rate
+        List<List<BoneTransformation>> samples;
+        for (auto & channel : anim.Channels)
+        {
+            if (channel.KeyFrames.Count() == 0)
+                continue;
+            clip->BoneNames.Add(channel.BoneName);
+            List<BoneTransformation> channelSamples;
+            channelSamples.SetSize(frameCount);
+            for (int f = 0; f < frameCount; f++)
+            {
+                channelSamples[f] = channel.Sample(Math::Min(f / clip->FPS, anim.Duration));
+                channelSamples[f].Rotation = NormalizeRotation(channelSamples[f].Rotation);
+            }
+            samples.Add(_Move(channelSamples));
+        }
+
+        AnimationCompressionStats stats;
+        List<Quaternion> rotations;
+        List<Vec3> translations, scales;
+        int frameStride = 0;
+        for (auto & channelSamples : samples)
+        {
+            rotations.Clear();
+            translations.Clear();
+            scales.Clear();
+            for (auto & sample : channelSamples)
+            {
+                // keep consecutive rotations in the same hemisphere so range and linearity tests see a continuous curve
+                if (rotations.Count() && Quaternion::Dot(rotations.Last(), sample.Rotation) < 0.0f)
+                    rotations.Add(-sample.Rotation);
+                else
+                    rotations.Add(sample.Rotation);
+                translations.Add(sample.Translation);
+                scales.Add(sample.Scale);
+            }
+            CompressedBoneTrack track;
+            if (frameCount == 1)
+            {
+                track.RotationStart = track.RotationEnd = rotations[0];
+                track.TranslationStart = track.TranslationEnd = translations[0];
+                track.ScaleStart = track.ScaleEnd = scales[0];
+            }
+            else
+            {
+                track.RotationFormat = ClassifyRotationTrack(rotations, settings.RotationTolerance, track.RotationStart, track.RotationEnd);
+                track.TranslationFormat = ClassifyVectorTrack(translations, settings.TranslationTolerance, track.TranslationStart, track.TranslationEnd);
+                track.ScaleFormat = ClassifyVectorTrack(scales, settings.ScaleTolerance, track.ScaleStart, track.ScaleEnd);
+            }
+            track.RotationOffset = (unsigned short)frameStride;
+            frameStride += GetKeySize(track.RotationFormat, RawRotationKeySize);
+            track.TranslationOffset = (unsigned short)frameStride;
+            frameStride += GetKeySize(track.TranslationFormat, RawVectorKeySize);
+            track.ScaleOffset = (unsigned short)frameStride;
+            frameStride += GetKeySize(track.ScaleFormat, RawVectorKeySize);
+            if (frameStride > 0xFFFF)
+                throw CoreLib::InvalidOperationException("Animation has too many animated tracks to compress.");
+            CountTrack(stats, track.RotationFormat);
+            CountTrack(stats, track.TranslationFormat);
+            CountTrack(stats, track.ScaleFormat);
+            clip->Tracks.Add(track);
+        }
+        clip->header.FrameStride = frameStride;
+
+        // write frame records segment by segment, each segment repeats the first frame of the next one
+        if (frameStride)
+        {
+            int segmentLength = clip->header.SegmentLength;
+            int segmentCount = CompressedAnimationClip::GetSegmentCount(frameCount, segmentLength);
+            clip->SegmentData.SetSize(segmentCount * clip->GetSegmentStride());
+            auto dst = clip->SegmentData.Buffer();
+            for (int s = 0; s < segmentCount; s++)
+            {
+                for (int j = 0; j <= segmentLength; j++)
+                {
+                    int frame = Math::Min(s * segmentLength + j, frameCount - 1);
+                    for (int i = 0; i < clip->Tracks.Count(); i++)
+                    {
+                        auto & track = clip->Tracks[i];
+                        auto & sample = samples[i][frame];
+                        auto rotation = sample.Rotation;
+                        if (track.RotationFormat == AnimationTrackFormat::Quantized)
+                            EncodeRotation(dst + track.RotationOffset, rotation);
+                        else if (track.RotationFormat == AnimationTrackFormat::Raw)
+                            memcpy(dst + track.RotationOffset, &rotation, RawRotationKeySize);
+                        if (track.TranslationFormat == AnimationTrackFormat::Quantized)
+                            EncodeVector(dst + track.TranslationOffset, sample.Translation, track.TranslationStart, track.TranslationEnd);
+                        else if (track.TranslationFormat == AnimationTrackFormat::Raw)
+                            memcpy(dst + track.TranslationOffset, &sample.Translation, RawVectorKeySize);
+                        if (track.ScaleFormat == AnimationTrackFormat::Quantized)
+                            EncodeVector(dst + track.ScaleOffset, sample.Scale, track.ScaleStart, track.ScaleEnd);
+                        else if (track.ScaleFormat == AnimationTrackFormat::Raw)
+                            memcpy(dst + track.ScaleOffset, &sample.Scale, RawVectorKeySize);
+                    }
+                    dst += frameStride;
+                }
+            }
+        }
+
+        if (pStats)
+        {
+            // measure the error of the runtime sampler against the resampled source
+            CompressedAnimationCursor cursor(clip.Ptr());
+            List<BoneTransformation> decoded;
+            decoded.SetSize(clip->Tracks.Count());
+            for (int f = 0; f < frameCount; f++)
+            {
+                cursor.SampleTracks(f / clip->FPS, decoded.Buffer());
+                for (int i = 0; i < decoded.Count(); i++)
+                {
+                    auto & expected = samples[i][f];
+                    stats.MaxRotationError = Math::Max(stats.MaxRotationError, RotationError(expected.Rotation, decoded[i].Rotation));
+                    stats.MaxTranslationError = Math::Max(stats.MaxTranslationError, (expected.Translation - decoded[i].Translation).Length());
+                    stats.MaxScaleError = Math::Max(stats.MaxScaleError, (expected.Scale - decoded[i].Scale).Length());
+                }
+            }
+            stats.SourceBytes = GetSourceMemorySize(anim);
+            stats.CompressedBytes = clip->GetMemorySize();
+            *pStats = stats;
+        }
+        return clip;
+    }
+}
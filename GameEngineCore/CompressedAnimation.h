@@ -0,0 +1,145 @@
+#ifndef GAME_ENGINE_COMPRESSED_ANIMATION_H
+#define GAME_ENGINE_COMPRESSED_ANIMATION_H
+
+#include "Skeleton.h"
+
+namespace GameEngine
+{
+    constexpr int CurrentCompressedAnimationVersion = 100;
+    constexpr uint32_t CompressedAnimationIdentifier = 'C' + ('A' << 8) + ('N' << 16) + ('M' << 24);
+
+    enum class AnimationTrackFormat : unsigned char
+    {
+        // a single value for the whole clip
+        Constant,
+        // interpolated between the first and the last value of the clip
+        Linear,
+        // per frame keys; rotations use a 48 bit smallest-three encoding,
+        // translations and scales 16 bits per component within the track's range
+        Quantized,
+        // per frame keys stored as floats, used when quantization exceeds the error tolerance
+        Raw
+    };
+
+    struct CompressedBoneTrack
+    {
+        AnimationTrackFormat RotationFormat = AnimationTrackFormat::Constant;
+        AnimationTrackFormat TranslationFormat = AnimationTrackFormat::Constant;
+        AnimationTrackFormat ScaleFormat = AnimationTrackFormat::Constant;
+        unsigned char Reserved = 0;
+        // byte offsets of the per frame keys within a frame record
+        unsigned short RotationOffset = 0, TranslationOffset = 0, ScaleOffset = 0, Reserved1 = 0;
+        // Constant: Start. Linear: Start and End.
+        VectorMath::Quaternion RotationStart, RotationEnd;
+        // Constant: Start. Linear: Start and End. Quantized: Start is the range minimum, End the range extent.
+        VectorMath::Vec3 TranslationStart, TranslationEnd, ScaleStart, ScaleEnd;
+    };
+
+    struct AnimationCompressionSettings
+    {
+        // maximum rotation error in radians
+        float RotationTolerance = 0.001f;
+        float TranslationTolerance = 0.001f;
+        float ScaleTolerance = 0.0001f;
+        // frames per segment; a segment also stores the first frame of the next one so that
+        // both keys of an interpolation always come from the same block
+        int SegmentLength = 16;
+    };
+
+    struct AnimationCompressionStats
+    {
+        int ConstantTracks = 0, LinearTracks = 0, QuantizedTracks = 0, RawTracks = 0;
+        int SourceBytes = 0, CompressedBytes = 0;
+        // measured against the source clip at every frame
+        float MaxRotationError = 0.0f, MaxTranslationError = 0.0f, MaxScaleError = 0.0f;
+    };
+
+    // A skeletal animation resampled at a fixed frame rate, with constant and linear tracks removed and the remaining
+    // keys quantized. Per frame keys of all tracks are interleaved into frame records, and frame records are grouped
+    // into segments so that sampling reads one contiguous block.
+    class CompressedAnimationClip : public CoreLib::RefObject
+    {
+    public:
+        struct Header
+        {
+            uint32_t Identifier = CompressedAnimationIdentifier;
+            int Version = CurrentCompressedAnimationVersion;
+            int FrameCount = 0;
+            int SegmentLength = 0;
+            int FrameStride = 0;
+            int Reserved[11] = {};
+        };
+        Header header;
+        CoreLib::String Name;
+        float Speed = 1.0f;
+        float Duration = 0.0f;
+        float FPS = 30.0f;
+        CoreLib::List<CoreLib::String> BoneNames;
+        CoreLib::List<CompressedBoneTrack> Tracks;
+        CoreLib::List<BlendShapeAnimationChannel> BlendShapeChannels;
+        CoreLib::List<unsigned char> SegmentData;
+    public:
+        // segments needed for frameCount frames; segment s holds frames s * segmentLength to (s + 1) * segmentLength
+        static int GetSegmentCount(int frameCount, int segmentLength)
+        {
+            return frameCount > 1 ? (frameCount - 2) / segmentLength + 1 : 1;
+        }
+        int GetSegmentCount() const
+        {
+            return header.FrameStride ? SegmentData.Count() / GetSegmentStride() : 0;
+        }
+        int GetSegmentStride() const
+        {
+            return (header.SegmentLength + 1) * header.FrameStride;
+        }
+        const unsigned char * GetFrameRecord(int frame) const;
+        int GetMemorySize() const;
+        void SaveToStream(CoreLib::IO::Stream * stream);
+        void LoadFromStream(CoreLib::IO::Stream * stream);
+        void SaveToFile(const CoreLib::String & filename);
+        void LoadFromFile(const CoreLib::String & filename);
+    };
+
+    // Samples a compressed clip. A cursor keeps the two frame records around the last sampled time decoded,
+    // so playback only decodes when it crosses a frame and never searches for keys.
+    // Clips are immutable and can be shared; every playing instance owns its own cursor.
+    class CompressedAnimationCursor
+    {
+    private:
+        const CompressedAnimationClip * clip = nullptr;
+        const Skeleton * boundSkeleton = nullptr;
+        int decodedFrame = -1;
+        CoreLib::List<BoneTransformation> frame0, frame1;
+        CoreLib::List<int> boneIds;
+        CoreLib::List<int> blendShapeKeys;
+        void DecodeFrame(int frame, CoreLib::List<BoneTransformation> & transforms);
+        void Seek(float time, float & alpha, float & clipPosition);
+        void SampleTrack(int track, float alpha, float clipPosition, BoneTransformation & result) const;
+    public:
+        CompressedAnimationCursor() = default;
+        CompressedAnimationCursor(const CompressedAnimationClip * pClip)
+        {
+            SetClip(pClip);
+        }
+        void SetClip(const CompressedAnimationClip * pClip);
+        const CompressedAnimationClip * GetClip() const
+        {
+            return clip;
+        }
+        // samples every track, result is indexed by track
+        void SampleTracks(float time, BoneTransformation * result);
+        float SampleBlendShape(int channel, float time);
+        // writes the animated bones of the skeleton into the pose, other bones are left unchanged
+        void GetPose(Pose & pose, const Skeleton * skeleton, float time);
+    };
+
+    class AnimationCompressor
+    {
+    public:
+        static CoreLib::RefPtr<CompressedAnimationClip> Compress(const SkeletalAnimation & anim,
+            const AnimationCompressionSettings & settings = AnimationCompressionSettings(), AnimationCompressionStats * stats = nullptr);
+        static int GetSourceMemorySize(const SkeletalAnimation & anim);
+    };
+}
+
+#endif
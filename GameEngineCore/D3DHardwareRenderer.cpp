@@ -666,6 +666,7 @@ public:
     bool isMappable = false;
     int mappedStart = -1;
     int mappedEnd = -1;
+    int readbackRowPitch = 0; // row pitch of texture readbacks, 0 if this is not a readback buffer
     BufferUsage usage;
     List<D3D12_RESOURCE_BARRIER> resourceBarriers;
 
@@ -689,6 +690,19 @@ public:
             structInfo = *pStructInfo;
         }
     }
+    // Creates a buffer in the readback heap that receives texture copies with rows rowPitch bytes apart.
+    Buffer(int rowPitch, int height)
+    {
+        auto &state = RendererState::Get();
+        usage = BufferUsage::ArrayBuffer;
+        isMappable = true;
+        readbackRowPitch = rowPitch;
+        bufferSize = rowPitch * height;
+        buffer.resource =
+            state.CreateBufferResource(bufferSize, D3D12_HEAP_TYPE_READBACK, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, false);
+        buffer.subresourceStates.SetSize(1);
+        buffer.subresourceStates[0] = D3D12_RESOURCE_STATE_COPY_DEST;
+    }
     ~Buffer()
     {
         buffer.resource->Release();
@@ -852,7 +866,11 @@ public:
         D3D12_RANGE range;
         range.Begin = (SIZE_T)mappedStart;
         range.End = (SIZE_T)mappedEnd;
+        // nothing is written through the mapping of a readback buffer
+        if (readbackRowPitch)
+            range.End = range.Begin;
         buffer.resource->Unmap(0, &range);
+        mappedStart = mappedEnd = -1;
     }
 };
 
@@ -1000,11 +1018,8 @@ int GetResourceSize(StorageFormat format, int width, int height)
     case StorageFormat::BC1_SRGB:
         return ((width + 3) / 4) * ((height + 3) / 4) * 8;
     case StorageFormat::BC5:
-        return DXGI_FORMAT_BC5_UNORM;
     case StorageFormat::BC3:
-        return DXGI_FORMAT_BC3_UNORM;
     case StorageFormat::BC6H:
-        return DXGI_FORMAT_BC6H_UF16;
     case StorageFormat::RGBA_Compressed:
         return ((width + 3) / 4) * ((height + 3) / 4) * 16;
     default:
@@ -3398,6 +3413,34 @@ public:
         BlitImpl(cmdList.list, dstImage, srcImage, destOffset, flipSrc == SourceFlipMode::Flip);
     }
 
+    virtual void QueueTextureReadback(GameEngine::Buffer *dstBuffer, GameEngine::Texture2D *srcImage) override
+    {
+        auto &state = RendererState::Get();
+        state.FlushCopy();
+        auto cmdList = pendingCommands[renderThreadId];
+        auto srcTexture = static_cast<D3DTexture *>(srcImage->GetInternalPtr());
+        auto dst = dynamic_cast<D3DRenderer::Buffer *>(dstBuffer);
+        CORELIB_ASSERT(dst->readbackRowPitch && "destination must be created by CreateReadbackBuffer().");
+        auto &pendingBarrierList = pendingBarriers[state.version];
+        pendingBarrierList.Clear();
+        srcTexture->TransferState(0, D3D12_RESOURCE_STATE_COPY_SOURCE, pendingBarrierList);
+        if (pendingBarrierList.Count())
+            cmdList->ResourceBarrier(pendingBarrierList.Count(), pendingBarrierList.Buffer());
+        D3D12_TEXTURE_COPY_LOCATION dstLoc = {};
+        D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
+        dstLoc.pResource = dst->buffer.resource;
+        dstLoc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+        dstLoc.PlacedFootprint.Footprint.Format = srcTexture->properties.d3dformat;
+        dstLoc.PlacedFootprint.Footprint.Width = srcTexture->properties.width;
+        dstLoc.PlacedFootprint.Footprint.Height = srcTexture->properties.height;
+        dstLoc.PlacedFootprint.Footprint.Depth = 1;
+        dstLoc.PlacedFootprint.Footprint.RowPitch = dst->readbackRowPitch;
+        srcLoc.pResource = srcTexture->resource;
+        srcLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        srcLoc.SubresourceIndex = 0;
+        cmdList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+    }
+
     virtual void Wait() override
     {
         RendererState::Get().Wait();
@@ -3477,6 +3520,12 @@ public:
         return new Buffer(usage, sizeInBytes, true, structInfo);
     }
 
+    virtual GameEngine::Buffer *CreateReadbackBuffer(int width, int height, StorageFormat format, int &rowPitch) override
+    {
+        rowPitch = Align(width * StorageFormatSize(format), D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+        return new Buffer(rowPitch, height);
+    }
+
     virtual GameEngine::Texture2D *CreateTexture2D(
         String name, int width, int height, StorageFormat format, DataType type, void *data) override
     {
@@ -3586,6 +3635,12 @@ public:
         return new CommandBuffer(D3D12_COMMAND_LIST_TYPE_BUNDLE);
     }
 
+    virtual GameEngine::CommandBuffer *CreateThreadCommandBuffer(int /*threadIndex*/) override
+    {
+        // every bundle owns its allocator, so bundles can be recorded on any thread
+        return new CommandBuffer(D3D12_COMMAND_LIST_TYPE_BUNDLE);
+    }
+
     virtual TargetShadingLanguage GetShadingLanguage() override
     {
         return TargetShadingLanguage::HLSL;
@@ -1,4 +1,5 @@
 #include "DrawCallStatForm.h"
+#include "CoreLib/FrameAllocator.h"
 
 using namespace GraphicsUI;
 
@@ -15,6 +16,8 @@ namespace GameEngine
 		lblNumMaterials = new Label(this);
 		lblCpuTime = new Label(this);
 		lblPipelineLookupTime = new Label(this);
+		lblPipelineCompiles = new Label(this);
+		lblStreaming = new Label(this);
 
 		lblFps->Posit(emToPixel(0.5f), emToPixel(0.5f), emToPixel(20.0f), emToPixel(1.5f));
 		lblNumWorldPasses->Posit(emToPixel(0.5f), emToPixel(1.5f), emToPixel(20.0f), emToPixel(1.5f));
@@ -23,8 +26,10 @@ namespace GameEngine
 		lblPipelineLookupTime->Posit(emToPixel(0.5f), emToPixel(4.5f), emToPixel(20.0f), emToPixel(1.5f));
 		lblNumShaders->Posit(emToPixel(0.5f), emToPixel(5.5f), emToPixel(20.0f), emToPixel(1.5f));
 		lblNumMaterials->Posit(emToPixel(0.5f), emToPixel(6.5f), emToPixel(20.0f), emToPixel(1.5f));
+		lblPipelineCompiles->Posit(emToPixel(0.5f), emToPixel(7.5f), emToPixel(20.0f), emToPixel(1.5f));
+		lblStreaming->Posit(emToPixel(0.5f), emToPixel(8.5f), emToPixel(20.0f), emToPixel(1.5f));
 		SetWidth(emToPixel(14.0f));
-		SetHeight(emToPixel(10.2f));
+		SetHeight(emToPixel(12.2f));
 	}
 
 	void DrawCallStatForm::SetNumDrawCalls(int val)
@@ -49,14 +54,36 @@ namespace GameEngine
 
 	void DrawCallStatForm::SetCpuTime(float time, float pipelineLookupTime)
 	{
-		CoreLib::StringBuilder sb(256);
-		sb << "Renderer CPU: " << CoreLib::String(time*1000.0f, "%.1f") << "ms";
+		CoreLib::FrameStringBuilder sb;
+		sb << "Renderer CPU: ";
+		sb.Append(time * 1000.0f, "%.1f");
+		sb << "ms";
 		lblCpuTime->SetText(sb.ToString());
 		sb.Clear();
-		sb << "PipelineLookup: " << CoreLib::String(pipelineLookupTime * 1000.0f, "%.1f") << "ms";
+		sb << "PipelineLookup: ";
+		sb.Append(pipelineLookupTime * 1000.0f, "%.1f");
+		sb << "ms";
 		lblPipelineLookupTime->SetText(sb.ToString());
 	}
 
+	void DrawCallStatForm::SetPipelineCompiles(int pending, int completed, int stalled)
+	{
+		CoreLib::FrameStringBuilder sb;
+		sb << "Pipelines: " << pending << " pending, " << completed << " done, " << stalled << " stalled";
+		lblPipelineCompiles->SetText(sb.ToString());
+	}
+
+	void DrawCallStatForm::SetTextureStreaming(int queueDepth, size_t bytesInFlight, size_t residentBytes, int loads, int evictions)
+	{
+		CoreLib::FrameStringBuilder sb;
+		sb << "Streaming: " << queueDepth << " queued, ";
+		sb.Append(bytesInFlight / 1048576.0f, "%.1f");
+		sb << "MB in flight, ";
+		sb.Append(residentBytes / 1048576.0f, "%.1f");
+		sb << "MB resident, " << loads << " loaded, " << evictions << " evicted";
+		lblStreaming->SetText(sb.ToString());
+	}
+
 	void DrawCallStatForm::SetFrameRenderTime(float val)
 	{
 		static int i = 0;
@@ -17,6 +17,8 @@ namespace GameEngine
 		GraphicsUI::Label * lblFps;
 		GraphicsUI::Label * lblCpuTime;
 		GraphicsUI::Label * lblPipelineLookupTime;
+		GraphicsUI::Label * lblPipelineCompiles;
+		GraphicsUI::Label * lblStreaming;
 
 	public:
 		DrawCallStatForm(GraphicsUI::UIEntry * parent);
@@ -26,6 +28,8 @@ namespace GameEngine
 		void SetNumWorldPasses(int val);
 		void SetCpuTime(float time, float pipelineLookupTime);
 		void SetFrameRenderTime(float val);
+		void SetPipelineCompiles(int pending, int completed, int stalled);
+		void SetTextureStreaming(int queueDepth, size_t bytesInFlight, size_t residentBytes, int loads, int evictions);
 
 	};
 }
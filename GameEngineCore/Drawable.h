@@ -15,6 +15,7 @@ namespace GameEngine
 	class PipelineContext;
 	class SceneResource;
 	class Pose;
+	class PoseEvaluationCache;
 	class RetargetFile;
 
 	class DrawableMesh : public CoreLib::RefObject
@@ -85,6 +86,7 @@ namespace GameEngine
 		Skeleton * skeleton = nullptr;
 		CoreLib::Array<PipelineClass*, MaxWorldRenderPasses> pipelineCache;
 		SceneResource * scene = nullptr;
+		VectorMath::Matrix4 worldTransform;
 	public:
         uint32_t lightmapId = 0xFFFFFFFF;
 		CoreLib::Graphics::BBox Bounds;
@@ -98,6 +100,15 @@ namespace GameEngine
 		{
 			return transformModule;
 		}
+		inline DrawableType GetDrawableType()
+		{
+			return type;
+		}
+		// world transform of a static drawable, as last set by UpdateTransformUniform()
+		inline const VectorMath::Matrix4 & GetWorldTransform()
+		{
+			return worldTransform;
+		}
 		bool IsTransparent();
 		inline DrawableMesh * GetMesh()
 		{
@@ -107,6 +118,10 @@ namespace GameEngine
 		{
 			return material;
 		}
+		inline Skeleton * GetSkeleton()
+		{
+			return skeleton;
+		}
 		MeshVertexFormat & GetVertexFormat()
 		{
 			return mesh->meshVertexFormat;
@@ -124,6 +139,9 @@ namespace GameEngine
 		void UpdateTransformUniform(const VectorMath::Matrix4 & localTransform);
 		void UpdateTransformUniform(const VectorMath::Matrix4 & localTransform, const Pose & pose, RetargetFile * retarget = nullptr, 
 			BlendShapeWeightInfo *blendShapeInfo = nullptr);
+		// writes bone transforms that were already evaluated for the model instance this drawable belongs to
+		void UpdateTransformUniform(const VectorMath::Matrix4 & localTransform, const PoseEvaluationCache & evaluatedPose,
+			BlendShapeWeightInfo *blendShapeInfo = nullptr);
 	};
 
 	class DrawableSink
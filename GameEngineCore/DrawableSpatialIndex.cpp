@@ -0,0 +1,66 @@
+#include "DrawableSpatialIndex.h"
+
+using namespace CoreLib;
+
+namespace GameEngine
+{
+	void DrawableSpatialIndex::Update(DrawableSink & sink)
+	{
+		submittedDrawables.Clear();
+		submittedDrawables.AddRange(sink.GetDrawables(false));
+		submittedDrawables.AddRange(sink.GetDrawables(true));
+		for (auto & proxy : proxies)
+			proxy.sinkOrder = -1;
+		for (int i = 0; i < submittedDrawables.Count(); i++)
+		{
+			auto drawable = submittedDrawables[i];
+			int proxyId;
+			if (proxyIds.TryGetValue(drawable, proxyId))
+			{
+				// a drawable submitted twice in the same frame is indexed once
+				if (proxies[proxyId].sinkOrder != -1)
+					continue;
+				tree.Move(proxies[proxyId].leaf, drawable->Bounds);
+			}
+			else
+			{
+				if (freeProxies.Count())
+				{
+					proxyId = freeProxies.Last();
+					freeProxies.RemoveAt(freeProxies.Count() - 1);
+				}
+				else
+				{
+					proxyId = proxies.Count();
+					proxies.Add(Proxy());
+				}
+				proxies[proxyId].drawable = drawable;
+				proxies[proxyId].leaf = tree.Insert(proxyId, drawable->Bounds);
+				proxyIds[drawable] = proxyId;
+			}
+			proxies[proxyId].sinkOrder = i;
+		}
+		// drop drawables that were not submitted this frame, they may have been destroyed
+		for (int i = 0; i < proxies.Count(); i++)
+		{
+			auto & proxy = proxies[i];
+			if (proxy.drawable && proxy.sinkOrder == -1)
+			{
+				tree.Remove(proxy.leaf);
+				proxyIds.Remove(proxy.drawable);
+				proxy.drawable = nullptr;
+				proxy.leaf = -1;
+				freeProxies.Add(i);
+			}
+		}
+	}
+
+	void DrawableSpatialIndex::Clear()
+	{
+		tree.Clear();
+		proxies.Clear();
+		freeProxies.Clear();
+		proxyIds.Clear();
+		submittedDrawables.Clear();
+	}
+}
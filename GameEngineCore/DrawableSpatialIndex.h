@@ -0,0 +1,103 @@
+#ifndef GAME_ENGINE_DRAWABLE_SPATIAL_INDEX_H
+#define GAME_ENGINE_DRAWABLE_SPATIAL_INDEX_H
+
+#include "Drawable.h"
+#include "DynamicBvh.h"
+#include "FrustumCulling.h"
+
+namespace GameEngine
+{
+	// Persistent bounding volume hierarchy over the drawables submitted each frame.
+	// Update() synchronizes the tree with the content of a DrawableSink: new drawables are inserted,
+	// drawables that moved out of their fat box are reinserted and drawables no longer submitted are removed.
+	class DrawableSpatialIndex
+	{
+	private:
+		struct Proxy
+		{
+			Drawable * drawable = nullptr;
+			int leaf = -1;
+			int sinkOrder = -1; // position in this frame's submission order, -1 if not submitted
+		};
+		DynamicBvh<int> tree;
+		CoreLib::List<Proxy> proxies;
+		CoreLib::List<int> freeProxies;
+		CoreLib::Dictionary<Drawable*, int> proxyIds;
+		CoreLib::List<Drawable*> submittedDrawables;
+		CoreLib::List<CoreLib::List<int>> queryBuffers;
+		CoreLib::List<int> candidates;
+		CoreLib::List<unsigned int> candidateMasks, visibilityMasks;
+		BBoxArraySoA candidateBounds;
+	public:
+		void Update(DrawableSink & sink);
+		void Clear();
+		int Count()
+		{
+			return tree.Count();
+		}
+		int GetTreeHeight()
+		{
+			return tree.GetHeight();
+		}
+
+		// Culls against all `frustums` with a single tree traversal. results[i] receives the drawables that
+		// pass `filter` and intersect frustums[i], in the order they were submitted to the sink (opaque first).
+		// The per-drawable test gives the same result as CullFrustum::IsBoxInFrustum.
+		template<typename TFilter>
+		void Query(CoreLib::ArrayView<CullFrustum> frustums, CoreLib::ArrayView<CoreLib::List<Drawable*>> results, const TFilter & filter)
+		{
+			for (auto & result : results)
+				result.Clear();
+			for (int start = 0; start < frustums.Count(); start += DynamicBvh<int>::MaxQueryFrustums)
+			{
+				int batchSize = CoreLib::Math::Min(frustums.Count() - start, (int)DynamicBvh<int>::MaxQueryFrustums);
+				auto batch = CoreLib::MakeArrayView(frustums.Buffer() + start, batchSize);
+				if (queryBuffers.Count() < batchSize)
+					queryBuffers.SetSize(batchSize);
+				for (int i = 0; i < batchSize; i++)
+					queryBuffers[i].Clear();
+				// leaves fully inside a frustum are accepted during traversal, the ones straddling a frustum
+				// boundary are gathered and tested against all frusta of the batch at once
+				candidates.Clear();
+				candidateMasks.Clear();
+				candidateBounds.Clear();
+				tree.QueryFrustums(batch, [&](int proxyId, unsigned int partialMask, unsigned int insideMask)
+				{
+					auto & proxy = proxies[proxyId];
+					if (!filter(proxy.drawable))
+						return;
+					for (unsigned int mask = insideMask; mask; mask &= mask - 1)
+						queryBuffers[CoreLib::Math::Log2Floor(mask & (~mask + 1))].Add(proxy.sinkOrder);
+					if (partialMask)
+					{
+						candidates.Add(proxy.sinkOrder);
+						candidateMasks.Add(partialMask);
+						candidateBounds.Add(proxy.drawable->Bounds);
+					}
+				});
+				ComputeFrustumVisibility(batch, candidateBounds, visibilityMasks);
+				for (int i = 0; i < candidates.Count(); i++)
+				{
+					for (unsigned int mask = visibilityMasks[i] & candidateMasks[i]; mask; mask &= mask - 1)
+						queryBuffers[CoreLib::Math::Log2Floor(mask & (~mask + 1))].Add(candidates[i]);
+				}
+				for (int i = 0; i < batchSize; i++)
+				{
+					// tree order depends on insertion history, restore submission order so that results are stable
+					queryBuffers[i].Sort();
+					auto & result = results[start + i];
+					result.Reserve(queryBuffers[i].Count());
+					for (auto order : queryBuffers[i])
+						result.Add(submittedDrawables[order]);
+				}
+			}
+		}
+		template<typename TFilter>
+		void Query(const CullFrustum & frustum, CoreLib::List<Drawable*> & result, const TFilter & filter)
+		{
+			Query(CoreLib::MakeArrayView(frustum), CoreLib::MakeArrayView(result), filter);
+		}
+	};
+}
+
+#endif
@@ -289,6 +289,12 @@ namespace DummyRenderer
             writer->Write(" bytes)\n");
             return new Buffer(sizeInBytes);
         }
+		virtual GameEngine::Buffer* CreateReadbackBuffer(int width, int height, StorageFormat format, int & rowPitch) override
+        {
+            rowPitch = width * StorageFormatSize(format);
+            return new Buffer(rowPitch * height);
+        }
+		virtual void QueueTextureReadback(GameEngine::Buffer* /*dstBuffer*/, GameEngine::Texture2D* /*srcImage*/) override {}
 		virtual GameEngine::Texture2D* CreateTexture2D(CoreLib::String /*name*/, int width, int height, StorageFormat /*format*/, DataType /*type*/, void* /*data*/) override
         {
             writer->Write("Create Texture2D (");
@@ -387,6 +393,11 @@ namespace DummyRenderer
         {
             writer->Write("Create CommandBuffer\n");
             return new CommandBuffer();
+        }
+        virtual GameEngine::CommandBuffer* CreateThreadCommandBuffer(int /*threadIndex*/) override
+        {
+            // called from worker threads, so this is not logged to the shared writer
+            return new CommandBuffer();
         }
 		virtual TargetShadingLanguage GetShadingLanguage() override { return TargetShadingLanguage::SPIRV; }
 		virtual int UniformBufferAlignment() override { return 16; }
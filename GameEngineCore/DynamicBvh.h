@@ -0,0 +1,419 @@
+#ifndef GAME_ENGINE_DYNAMIC_BVH_H
+#define GAME_ENGINE_DYNAMIC_BVH_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/Graphics/BBox.h"
+#include "FrustumCulling.h"
+
+namespace GameEngine
+{
+	// An incrementally updated AABB tree. Leaves store a "fat" box that is enlarged by a margin so that
+	// objects moving by small amounts do not need to be reinserted every frame. Insertion picks the
+	// sibling with the lowest surface area cost and the tree is kept balanced with AVL style rotations.
+	template<typename T>
+	class DynamicBvh
+	{
+	public:
+		static const int NullNode = -1;
+		// maximum number of frusta that can be tested in a single traversal
+		static const int MaxQueryFrustums = 32;
+		// the tree is height balanced, so a traversal stack rarely holds more than height + 1 entries
+		static const int MaxTraversalDepth = 64;
+	private:
+		// a traversal stack that keeps MaxTraversalDepth entries inline and spills the rest to the heap
+		template<typename TEntry>
+		struct TraversalStack
+		{
+			TEntry entries[MaxTraversalDepth];
+			int size = 0;
+			CoreLib::List<TEntry> overflow;
+			inline void Push(const TEntry & entry)
+			{
+				if (size < MaxTraversalDepth)
+					entries[size++] = entry;
+				else
+					overflow.Add(entry);
+			}
+			// entries in `overflow` were pushed after all inline entries, so they are popped first
+			inline TEntry Pop()
+			{
+				if (overflow.Count())
+				{
+					TEntry entry = overflow.Last();
+					overflow.RemoveAt(overflow.Count() - 1);
+					return entry;
+				}
+				return entries[--size];
+			}
+			inline bool IsEmpty() const
+			{
+				return size == 0 && overflow.Count() == 0;
+			}
+		};
+		struct Node
+		{
+			CoreLib::Graphics::BBox Bounds;
+			T Element;
+			int Parent;     // also used as the next pointer of the free list
+			int Children[2];
+			int Height;     // 0 for leaves, -1 for free nodes
+			inline bool IsLeaf() const
+			{
+				return Children[0] == NullNode;
+			}
+		};
+		CoreLib::List<Node> nodes;
+		int root = NullNode;
+		int freeList = NullNode;
+		int leafCount = 0;
+		float marginRatio = 0.1f;
+
+		static inline float HalfArea(const CoreLib::Graphics::BBox & box)
+		{
+			float dx = box.xMax - box.xMin, dy = box.yMax - box.yMin, dz = box.zMax - box.zMin;
+			return dx * dy + dy * dz + dz * dx;
+		}
+		static inline CoreLib::Graphics::BBox Combine(const CoreLib::Graphics::BBox & a, const CoreLib::Graphics::BBox & b)
+		{
+			CoreLib::Graphics::BBox rs = a;
+			rs.Union(b);
+			return rs;
+		}
+		static inline bool ContainsBox(const CoreLib::Graphics::BBox & outer, const CoreLib::Graphics::BBox & inner)
+		{
+			return outer.xMin <= inner.xMin && outer.yMin <= inner.yMin && outer.zMin <= inner.zMin &&
+				outer.xMax >= inner.xMax && outer.yMax >= inner.yMax && outer.zMax >= inner.zMax;
+		}
+		CoreLib::Graphics::BBox Fatten(const CoreLib::Graphics::BBox & box)
+		{
+			CoreLib::Graphics::BBox rs = box;
+			auto extent = box.Max - box.Min;
+			auto margin = VectorMath::Vec3::Create(fabs(extent.x), fabs(extent.y), fabs(extent.z)) * marginRatio;
+			rs.Min -= margin;
+			rs.Max += margin;
+			return rs;
+		}
+		int AllocNode()
+		{
+			int id;
+			if (freeList != NullNode)
+			{
+				id = freeList;
+				freeList = nodes[id].Parent;
+			}
+			else
+			{
+				id = nodes.Count();
+				nodes.Add(Node());
+			}
+			auto & node = nodes[id];
+			node.Parent = NullNode;
+			node.Children[0] = node.Children[1] = NullNode;
+			node.Height = 0;
+			return id;
+		}
+		void FreeNode(int id)
+		{
+			nodes[id].Parent = freeList;
+			nodes[id].Height = -1;
+			freeList = id;
+		}
+		void Refit(int id)
+		{
+			auto & node = nodes[id];
+			auto & c0 = nodes[node.Children[0]];
+			auto & c1 = nodes[node.Children[1]];
+			node.Height = 1 + CoreLib::Math::Max(c0.Height, c1.Height);
+			node.Bounds = Combine(c0.Bounds, c1.Bounds);
+		}
+		void ReplaceChild(int parent, int oldChild, int newChild)
+		{
+			if (parent == NullNode)
+				root = newChild;
+			else if (nodes[parent].Children[0] == oldChild)
+				nodes[parent].Children[0] = newChild;
+			else
+				nodes[parent].Children[1] = newChild;
+		}
+		// rotates the taller grandchild of `a` up if the subtree is unbalanced, returns the new subtree root
+		int Balance(int a)
+		{
+			if (nodes[a].IsLeaf() || nodes[a].Height < 2)
+				return a;
+			int balance = nodes[nodes[a].Children[1]].Height - nodes[nodes[a].Children[0]].Height;
+			if (balance >= -1 && balance <= 1)
+				return a;
+			// `up` is the taller child of `a`, `side` is the slot it occupies
+			int side = balance > 1 ? 1 : 0;
+			int up = nodes[a].Children[side];
+			int f = nodes[up].Children[0];
+			int g = nodes[up].Children[1];
+
+			nodes[up].Parent = nodes[a].Parent;
+			ReplaceChild(nodes[a].Parent, a, up);
+			nodes[up].Children[0] = a;
+			nodes[a].Parent = up;
+			// the taller grandchild stays below `up`, the shorter one moves under `a`
+			int keep = nodes[f].Height > nodes[g].Height ? f : g;
+			int move = keep == f ? g : f;
+			nodes[up].Children[1] = keep;
+			nodes[a].Children[side] = move;
+			nodes[move].Parent = a;
+			Refit(a);
+			Refit(up);
+			return up;
+		}
+		void RefitAncestors(int id)
+		{
+			while (id != NullNode)
+			{
+				id = Balance(id);
+				Refit(id);
+				id = nodes[id].Parent;
+			}
+		}
+		void InsertLeaf(int leaf)
+		{
+			if (root == NullNode)
+			{
+				root = leaf;
+				nodes[leaf].Parent = NullNode;
+				return;
+			}
+			// descend towards the sibling that minimizes the increase of total surface area
+			auto leafBounds = nodes[leaf].Bounds;
+			int id = root;
+			while (!nodes[id].IsLeaf())
+			{
+				auto & node = nodes[id];
+				float area = HalfArea(node.Bounds);
+				float combinedArea = HalfArea(Combine(node.Bounds, leafBounds));
+				float cost = 2.0f * combinedArea;
+				float inheritanceCost = 2.0f * (combinedArea - area);
+				float childCost[2];
+				for (int i = 0; i < 2; i++)
+				{
+					auto & child = nodes[node.Children[i]];
+					float newArea = HalfArea(Combine(child.Bounds, leafBounds));
+					childCost[i] = (child.IsLeaf() ? newArea : newArea - HalfArea(child.Bounds)) + inheritanceCost;
+				}
+				if (cost < childCost[0] && cost < childCost[1])
+					break;
+				id = childCost[0] < childCost[1] ? node.Children[0] : node.Children[1];
+			}
+			int sibling = id;
+			int oldParent = nodes[sibling].Parent;
+			int newParent = AllocNode();
+			nodes[newParent].Parent = oldParent;
+			nodes[newParent].Children[0] = sibling;
+			nodes[newParent].Children[1] = leaf;
+			nodes[newParent].Bounds = Combine(nodes[sibling].Bounds, leafBounds);
+			nodes[newParent].Height = nodes[sibling].Height + 1;
+			ReplaceChild(oldParent, sibling, newParent);
+			nodes[sibling].Parent = newParent;
+			nodes[leaf].Parent = newParent;
+			RefitAncestors(oldParent);
+		}
+		void RemoveLeaf(int leaf)
+		{
+			if (leaf == root)
+			{
+				root = NullNode;
+				return;
+			}
+			int parent = nodes[leaf].Parent;
+			int grandParent = nodes[parent].Parent;
+			int sibling = nodes[parent].Children[0] == leaf ? nodes[parent].Children[1] : nodes[parent].Children[0];
+			ReplaceChild(grandParent, parent, sibling);
+			nodes[sibling].Parent = grandParent;
+			FreeNode(parent);
+			RefitAncestors(grandParent);
+		}
+	public:
+		// set the margin added to each side of a leaf box, as a fraction of the box extent
+		void SetMarginRatio(float ratio)
+		{
+			marginRatio = ratio;
+		}
+		int Insert(const T & element, const CoreLib::Graphics::BBox & bounds)
+		{
+			int leaf = AllocNode();
+			nodes[leaf].Element = element;
+			nodes[leaf].Bounds = Fatten(bounds);
+			InsertLeaf(leaf);
+			leafCount++;
+			return leaf;
+		}
+		void Remove(int leaf)
+		{
+			RemoveLeaf(leaf);
+			FreeNode(leaf);
+			leafCount--;
+		}
+		// returns true if the leaf had to be reinserted
+		bool Move(int leaf, const CoreLib::Graphics::BBox & bounds)
+		{
+			if (ContainsBox(nodes[leaf].Bounds, bounds))
+				return false;
+			RemoveLeaf(leaf);
+			nodes[leaf].Bounds = Fatten(bounds);
+			InsertLeaf(leaf);
+			return true;
+		}
+		void Clear()
+		{
+			nodes.Clear();
+			root = freeList = NullNode;
+			leafCount = 0;
+		}
+		T & GetElement(int leaf)
+		{
+			return nodes[leaf].Element;
+		}
+		const CoreLib::Graphics::BBox & GetFatBounds(int leaf) const
+		{
+			return nodes[leaf].Bounds;
+		}
+		int Count() const
+		{
+			return leafCount;
+		}
+		int GetHeight() const
+		{
+			return root == NullNode ? 0 : nodes[root].Height;
+		}
+
+		// Visits the leaves whose fat box touches any of the frusta in a single traversal.
+		// visitor(element, partialMask, insideMask) is called once per such leaf: bit f of insideMask is set when
+		// the fat box, and therefore the element, is entirely inside frustums[f]; bit f of partialMask is set
+		// when the fat box straddles frustums[f] and the element itself still needs to be tested.
+		template<typename TVisitor>
+		void QueryFrustums(CoreLib::ArrayView<CullFrustum> frustums, const TVisitor & visitor) const
+		{
+			if (root == NullNode || frustums.Count() == 0)
+				return;
+			struct StackEntry
+			{
+				int node;
+				unsigned int testMask;   // frusta that partially overlap the parent and still need testing
+				unsigned int insideMask; // frusta that fully contain the parent
+			};
+			CoreLib::List<StackEntry> stack;
+			stack.Reserve(64);
+			int frustumCount = CoreLib::Math::Min(frustums.Count(), (int)MaxQueryFrustums);
+			unsigned int allMask = frustumCount == 32 ? 0xFFFFFFFFu : ((1u << frustumCount) - 1);
+			stack.Add(StackEntry{ root, allMask, 0 });
+			while (stack.Count())
+			{
+				auto entry = stack.Last();
+				stack.RemoveAt(stack.Count() - 1);
+				auto & node = nodes[entry.node];
+				unsigned int testMask = 0, insideMask = entry.insideMask;
+				for (unsigned int mask = entry.testMask; mask; mask &= mask - 1)
+				{
+					int f = CoreLib::Math::Log2Floor(mask & (~mask + 1));
+					auto result = frustums[f].ClassifyBox(node.Bounds);
+					if (result == FrustumTestResult::Inside)
+						insideMask |= (1u << f);
+					else if (result == FrustumTestResult::Intersecting)
+						testMask |= (1u << f);
+				}
+				if (!(testMask | insideMask))
+					continue;
+				if (node.IsLeaf())
+					visitor(node.Element, testMask, insideMask);
+				else
+				{
+					stack.Add(StackEntry{ node.Children[1], testMask, insideMask });
+					stack.Add(StackEntry{ node.Children[0], testMask, insideMask });
+				}
+			}
+		}
+
+		// Visits the leaves whose fat box overlaps `box`, visitor(element) is called once per such leaf.
+		template<typename TVisitor>
+		void QueryOverlap(const CoreLib::Graphics::BBox & box, const TVisitor & visitor) const
+		{
+			if (root == NullNode)
+				return;
+			TraversalStack<int> stack;
+			stack.Push(root);
+			while (!stack.IsEmpty())
+			{
+				auto & node = nodes[stack.Pop()];
+				if (node.Bounds.xMin > box.xMax || node.Bounds.yMin > box.yMax || node.Bounds.zMin > box.zMax ||
+					node.Bounds.xMax < box.xMin || node.Bounds.yMax < box.yMin || node.Bounds.zMax < box.zMin)
+					continue;
+				if (node.IsLeaf())
+					visitor(node.Element);
+				else
+				{
+					stack.Push(node.Children[1]);
+					stack.Push(node.Children[0]);
+				}
+			}
+		}
+
+		// Visits the leaves whose fat box is hit by the ray segment [0, tMax], nearer boxes first.
+		// visitor(element, tEnter) returns the new tMax, so a closest hit query can skip every box behind
+		// the closest hit found so far. t is measured in multiples of `dir`.
+		template<typename TVisitor>
+		void RayCast(const VectorMath::Vec3 & origin, const VectorMath::Vec3 & dir, float tMax, const TVisitor & visitor) const
+		{
+			if (root == NullNode)
+				return;
+			VectorMath::Vec3 invDir = VectorMath::Vec3::Create(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+			auto intersect = [&](const CoreLib::Graphics::BBox & box, float & tEnter)
+			{
+				float tx0 = (box.xMin - origin.x) * invDir.x, tx1 = (box.xMax - origin.x) * invDir.x;
+				float ty0 = (box.yMin - origin.y) * invDir.y, ty1 = (box.yMax - origin.y) * invDir.y;
+				float tz0 = (box.zMin - origin.z) * invDir.z, tz1 = (box.zMax - origin.z) * invDir.z;
+				float tNear = CoreLib::Math::Max(CoreLib::Math::Max(CoreLib::Math::Min(tx0, tx1), CoreLib::Math::Min(ty0, ty1)),
+					CoreLib::Math::Max(CoreLib::Math::Min(tz0, tz1), 0.0f));
+				float tFar = CoreLib::Math::Min(CoreLib::Math::Min(CoreLib::Math::Max(tx0, tx1), CoreLib::Math::Max(ty0, ty1)),
+					CoreLib::Math::Min(CoreLib::Math::Max(tz0, tz1), tMax));
+				tEnter = tNear;
+				return tNear <= tFar;
+			};
+			struct StackEntry
+			{
+				int node;
+				float tEnter;
+			};
+			TraversalStack<StackEntry> stack;
+			float tRoot;
+			if (intersect(nodes[root].Bounds, tRoot))
+				stack.Push(StackEntry{ root, tRoot });
+			while (!stack.IsEmpty())
+			{
+				auto entry = stack.Pop();
+				if (entry.tEnter > tMax)
+					continue;
+				auto & node = nodes[entry.node];
+				if (node.IsLeaf())
+				{
+					tMax = visitor(node.Element, entry.tEnter);
+					continue;
+				}
+				float t0, t1;
+				bool hit0 = intersect(nodes[node.Children[0]].Bounds, t0);
+				bool hit1 = intersect(nodes[node.Children[1]].Bounds, t1);
+				// push the farther child first so that the nearer one is visited next
+				if (hit0 && hit1 && t1 < t0)
+				{
+					stack.Push(StackEntry{ node.Children[0], t0 });
+					stack.Push(StackEntry{ node.Children[1], t1 });
+				}
+				else
+				{
+					if (hit1)
+						stack.Push(StackEntry{ node.Children[1], t1 });
+					if (hit0)
+						stack.Push(StackEntry{ node.Children[0], t0 });
+				}
+			}
+		}
+	};
+}
+
+#endif
@@ -6,6 +6,8 @@
 #include "CoreLib/Tokenizer.h"
 #include "EngineLimits.h"
 #include "CoreLib/Imaging/Bitmap.h"
+#include "CoreLib/JobSystem.h"
+#include "CoreLib/FrameAllocator.h"
 #include "UISystemBase.h"
 
 #ifndef DWORD
@@ -51,19 +53,14 @@ namespace GameEngine
 			instance->Tick();
             if (params.EnableVideoCapture)
             {
-                renderer->Wait();
                 auto image = instance->GetRenderResult(true);
-                if (videoEncodingStream)
-                {
-                    int w, h;
-                    image->GetSize(w, h);
-                    List<unsigned char> imageBuffer;
-                    imageBuffer.SetSize(w * h * 4);
-                    image->GetData(0, imageBuffer.Buffer(), imageBuffer.Count());
-                    videoEncoder->EncodeFrame(w, h, imageBuffer.Buffer());
-                }
+                if (videoCapture)
+                    videoCapture->CaptureFrame(image);
                 else
+                {
+                    renderer->Wait();
                     Engine::SaveImage(image, CoreLib::IO::Path::Combine(params.Directory, String(frameId) + ".bmp"));
+                }
                 if (Engine::Instance()->GetTime() >= params.Length)
                 {
                     mainWindow->Close();
@@ -81,7 +78,9 @@ namespace GameEngine
                         if (rs.Divisor != 0)
                         {
                             sb << String(rs.CpuTime * 1000.0f / rs.Divisor, "%.1f") << "\t" << String(rs.TotalTime * 1000.0f / rs.Divisor, "%.1f")
-                                << "\t" << rs.NumDrawCalls / rs.Divisor << "\n";
+                                << "\t" << rs.NumDrawCalls / rs.Divisor << "\t" << rs.PendingPipelineCompiles << "\t" << rs.CompletedPipelineCompiles
+                                << "\t" << rs.StalledPipelineCompiles << "\t" << rs.StreamingQueueDepth << "\t" << (int)(rs.StreamingBytesInFlight >> 10)
+                                << "\t" << (int)(rs.StreamingResidentBytes >> 10) << "\t" << rs.StreamingLoads << "\t" << rs.StreamingEvictions << "\n";
                         }
                     }
                     CoreLib::IO::File::WriteAllText(params.RenderStatsDumpFileName, sb.ProduceString());
@@ -145,10 +144,14 @@ namespace GameEngine
             engineDir = Path::Normalize(args.EngineDirectory);
             Path::CreateDir(Path::Combine(gameDir, "Cache"));
             Path::CreateDir(Path::Combine(gameDir, "Cache/Shaders"));
+            Path::CreateDir(Path::Combine(gameDir, "Cache/Physics"));
             Path::CreateDir(Path::Combine(gameDir, "Settings"));
 
             startTime = lastGameLogicTime = lastRenderingTime = Diagnostics::PerformanceCounter::Start();
 
+            Threading::JobSystem::Init(args.JobThreads);
+            FrameScratch::Init(DynamicBufferLengthMultiplier);
+
             GpuId = args.GpuId;
 			useSoftwareRenderer = args.UseSoftwareRenderer;
             RecompileShaders = args.RecompileShaders;
@@ -172,6 +175,12 @@ namespace GameEngine
 			// initialize renderer
 			renderer = CreateRenderer(args.API);
 			renderer->Resize(args.Width, args.Height);
+			if (videoEncoder)
+			{
+				videoCapture = new VideoCapturePipeline(renderer->GetHardwareRenderer(), videoEncoder.Ptr(),
+					args.LaunchParams.CaptureReadbackBuffers, args.LaunchParams.CaptureQueueLength,
+					args.LaunchParams.CaptureDropFrames ? CaptureOverflowPolicy::DropFrame : CaptureOverflowPolicy::Stall);
+			}
 
 			currentViewport.x = currentViewport.y = 0;
 			currentViewport.width = args.Width;
@@ -265,6 +274,11 @@ namespace GameEngine
 
 	Engine::~Engine()
 	{
+		if (videoCapture)
+		{
+			videoCapture->Close();
+			videoCapture = nullptr;
+		}
 		renderer->Wait();
         if (videoEncoder)
             videoEncoder->Close();
@@ -279,6 +293,8 @@ namespace GameEngine
         debugGraphics = nullptr;
 		renderer = nullptr;
         shaderCompiler = nullptr;
+        Threading::JobSystem::Destroy();
+        FrameScratch::Shutdown();
 	}
 
 	void Engine::SaveGraphicsSettings()
@@ -326,8 +342,20 @@ namespace GameEngine
 			}
 		}
 		level->GetPhysicsScene().Tick();
+		// actors that touch shared state tick first, in level order; the rest only update
+		// their own state and are spread across the job system
+		parallelTickActors.Clear();
 		for (auto & actor : level->Actors)
-			actor.Value->Tick();
+		{
+			if (actor.Value->CanTickInParallel())
+				parallelTickActors.Add(actor.Value.Ptr());
+			else
+				actor.Value->Tick();
+		}
+		Threading::JobSystem::ParallelFor(0, parallelTickActors.Count(), 4, [this](int i)
+		{
+			parallelTickActors[i]->Tick();
+		});
 		if (levelEditor)
 		{
 			levelEditor->Tick();
@@ -346,6 +374,8 @@ namespace GameEngine
 			f->Wait();
 			f->Reset();
 		}
+		uiSystemInterface->BeginFrame();
+		FrameScratch::BeginFrame();
 		
 		inDataTransfer = true;
 
@@ -405,6 +435,8 @@ namespace GameEngine
 			drawCallStatForm->SetNumDrawCalls(stats.NumDrawCalls / stats.Divisor);
 			drawCallStatForm->SetNumWorldPasses(stats.NumPasses / stats.Divisor);
 			drawCallStatForm->SetCpuTime(stats.CpuTime / stats.Divisor, stats.PipelineLookupTime / stats.Divisor);
+			drawCallStatForm->SetPipelineCompiles(stats.PendingPipelineCompiles, stats.CompletedPipelineCompiles, stats.StalledPipelineCompiles);
+			drawCallStatForm->SetTextureStreaming(stats.StreamingQueueDepth, stats.StreamingBytesInFlight, stats.StreamingResidentBytes, stats.StreamingLoads, stats.StreamingEvictions);
 			static int ptr = 0;
 			stats.TotalTime = CoreLib::Diagnostics::PerformanceCounter::EndSeconds(stats.StartTime);
 			renderStats[ptr%renderStats.Count()] = stats;
@@ -543,6 +575,13 @@ namespace GameEngine
         OsApplication::DoEvents();
     }
 
+	void Engine::SetTimingMode(TimingMode mode)
+	{
+		timingMode = mode;
+		if (renderer)
+			renderer->GetSharedResource()->pipelineManager.SetAsyncCompilation(UseAsyncPipelineCompilation());
+	}
+
 	void Engine::SetEngineMode(EngineMode newMode)
 	{
 		engineMode = newMode;
@@ -730,6 +769,9 @@ namespace GameEngine
 		case ResourceType::ShaderCache:
 			subDirName = "Cache/Shaders";
 			break;
+		case ResourceType::PhysicsCache:
+			subDirName = "Cache/Physics";
+			break;
 		case ResourceType::ExtTools:
 			subDirName = "ExtTools";
 			break;
@@ -14,6 +14,7 @@
 #include "OS.h"
 #include "UISystemBase.h"
 #include "VideoEncoder.h"
+#include "VideoCapture.h"
 #include "ShaderCompiler.h"
 #include "DebugGraphics.h"
 #include "ComputeTaskManager.h"
@@ -29,6 +30,9 @@ namespace GameEngine
         float Length = 10.0f;
         int FramesPerSecond = 30;
         int RunForFrames = 0; // run for this many frames and then terminate
+        int CaptureReadbackBuffers = 3; // number of captured frames in flight on the GPU
+        int CaptureQueueLength = 4; // number of read back frames waiting for the video encoder
+        bool CaptureDropFrames = false; // drop frames instead of waiting when the video encoder falls behind
 		bool HeadlessMode = false;
         int ForceDPI = 0;
     };
@@ -39,6 +43,7 @@ namespace GameEngine
         bool NoConsole = false;
 		int Width = 400, Height = 400;
 		int GpuId = 0;
+		int JobThreads = -1; // number of job system worker threads, -1 for one per processor
 		bool UseSoftwareRenderer = false;
 		bool RecompileShaders = false;
 		CoreLib::String GameDirectory, EngineDirectory, StartupLevelName;
@@ -52,7 +57,7 @@ namespace GameEngine
 	enum class ResourceType
 	{
 		Font,
-		Mesh, Shader, Level, Texture, Material, Landscape, Animation, Settings, ShaderCache, ExtTools
+		Mesh, Shader, Level, Texture, Material, Landscape, Animation, Settings, ShaderCache, ExtTools, PhysicsCache
 	};
 	enum class TimingMode
 	{
@@ -87,12 +92,14 @@ namespace GameEngine
 		CoreLib::String gameDir, engineDir;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::Func<Actor*>> actorClassRegistry;
 		CoreLib::RefPtr<Level> level;
+		CoreLib::List<Actor*> parallelTickActors;
 		CoreLib::RefPtr<Renderer> renderer;
 		CoreLib::RefPtr<InputDispatcher> inputDispatcher;
 		CoreLib::RefPtr<LevelEditor> levelEditor;
         CoreLib::RefPtr<SystemWindow> mainWindow;
         CoreLib::RefPtr<IVideoEncoder> videoEncoder;
         CoreLib::RefPtr<CoreLib::IO::Stream> videoEncodingStream;
+        CoreLib::RefPtr<VideoCapturePipeline> videoCapture;
         CoreLib::RefPtr<IShaderCompiler> shaderCompiler;
         CoreLib::RefPtr<DebugGraphics> debugGraphics;
 		EngineMode engineMode = EngineMode::Normal;
@@ -113,9 +120,13 @@ namespace GameEngine
 			return graphicsSettings;
 		}
 		void SaveGraphicsSettings();
-		void SetTimingMode(TimingMode mode)
+		void SetTimingMode(TimingMode mode);
+		// Headless, fixed time step and video capture runs must draw everything from the first frame, so they
+		// compile pipelines when they are first used instead of skipping drawables until a background compile ends.
+		bool UseAsyncPipelineCompilation()
 		{
-			timingMode = mode;
+			return graphicsSettings.AsyncPipelineCompilation && !params.HeadlessMode && !params.EnableVideoCapture &&
+				params.RunForFrames == 0 && timingMode != TimingMode::Fixed;
 		}
 		// set fixed frame duration when TimingMode is Fixed
 		void SetFrameDuration(float duration)
@@ -163,9 +174,10 @@ namespace GameEngine
         {
             return mainWindow.Ptr();
         }
+		// null until Init creates the main window
 		GraphicsUI::UIEntry * GetUiEntry()
 		{
-			return mainWindow->GetUIEntry();
+			return mainWindow ? mainWindow->GetUIEntry() : nullptr;
 		}
 		Texture2D * GetRenderResult(bool withUI);
 		CoreLib::ArrayView<RenderStat> GetRenderStats()
@@ -13,6 +13,7 @@ namespace GameEngine
 	const int DynamicBufferLengthMultiplier = 2; // double buffering for dynamic uniforms
 	const int MaxModuleInstances = 1<<20;
     const int MaxBlendShapes = 32;
+    const int MaxInstancesPerDraw = 64; // must match MAX_INSTANCES_PER_DRAW in ShaderLib.slang
     }
 
 #endif
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "FrustumCulling.h"
+#include "CoreLib/JobSystem.h"
+#include <smmintrin.h>
 
 using namespace VectorMath;
 using namespace CoreLib;
@@ -44,7 +46,7 @@ namespace GameEngine
 			Planes[5] = Vec4::Create(normal, d);
 		}
 	}
-	bool CullFrustum::IsBoxInFrustum(CoreLib::Graphics::BBox box)
+	bool CullFrustum::IsBoxInFrustum(const CoreLib::Graphics::BBox & box) const
 	{
 		// for each plane
 		for (int i = 0; i < 6; i++)
@@ -64,6 +66,36 @@ namespace GameEngine
 		}
 		return true;
 	}
+	FrustumTestResult CullFrustum::ClassifyBox(const CoreLib::Graphics::BBox & box) const
+	{
+		auto result = FrustumTestResult::Inside;
+		for (int i = 0; i < 6; i++)
+		{
+			// the positive vertex decides whether the box is outside,
+			// the negative vertex whether it straddles the plane
+			Vec3 p = box.Min, n = box.Max;
+			if (Planes[i].x >= 0)
+			{
+				p.x = box.Max.x;
+				n.x = box.Min.x;
+			}
+			if (Planes[i].y >= 0)
+			{
+				p.y = box.Max.y;
+				n.y = box.Min.y;
+			}
+			if (Planes[i].z >= 0)
+			{
+				p.z = box.Max.z;
+				n.z = box.Min.z;
+			}
+			if (Planes[i].x * p.x + Planes[i].y * p.y + Planes[i].z * p.z + Planes[i].w < 0)
+				return FrustumTestResult::Outside;
+			if (Planes[i].x * n.x + Planes[i].y * n.y + Planes[i].z * n.z + Planes[i].w < 0)
+				result = FrustumTestResult::Intersecting;
+		}
+		return result;
+	}
 
 	CullFrustum::CullFrustum(CoreLib::Graphics::ViewFrustum f)
 	{
@@ -86,4 +118,123 @@ namespace GameEngine
 		FromVerts(verts.GetArrayView());
 	}
 
+	void BBoxArraySoA::SetSize(int size)
+	{
+		count = size;
+		int paddedSize = (size + PaddingGranularity - 1) / PaddingGranularity * PaddingGranularity;
+		if (paddedSize == MinX.Count())
+			return;
+		List<float> * arrays[6] = { &MinX, &MinY, &MinZ, &MaxX, &MaxY, &MaxZ };
+		for (auto array : arrays)
+		{
+			// grow geometrically so that a sequence of Add calls stays linear
+			if (paddedSize > array->Count())
+				array->Reserve(Math::Max(paddedSize, array->Count() * 2));
+			array->SetSize(paddedSize);
+		}
+	}
+
+	namespace
+	{
+		// a frustum plane with the box corner selection of the positive vertex resolved up front:
+		// component k of the positive vertex is read from bounds array Select[k] (0-2: min, 3-5: max)
+		struct BatchCullPlane
+		{
+			float X, Y, Z, W;
+			int Select[3];
+		};
+
+		struct BatchCullFrustums
+		{
+			BatchCullPlane Planes[MaxBatchCullFrustums][6];
+			int Count;
+			BatchCullFrustums(ArrayView<CullFrustum> frustums)
+			{
+				Count = Math::Min(frustums.Count(), MaxBatchCullFrustums);
+				for (int f = 0; f < Count; f++)
+				{
+					for (int i = 0; i < 6; i++)
+					{
+						auto & src = frustums[f].Planes[i];
+						auto & plane = Planes[f][i];
+						plane.X = src.x; plane.Y = src.y; plane.Z = src.z; plane.W = src.w;
+						plane.Select[0] = src.x >= 0 ? 3 : 0;
+						plane.Select[1] = src.y >= 0 ? 4 : 1;
+						plane.Select[2] = src.z >= 0 ? 5 : 2;
+					}
+				}
+			}
+		};
+
+		// computes visibility masks of boxes [start, end), start must be a multiple of the padding granularity
+		void ComputeVisibilityRange(const BatchCullFrustums & frustums, const BBoxArraySoA & bounds, unsigned int * masks, int start, int end)
+		{
+			const float * arrays[6] = { bounds.MinX.Buffer(), bounds.MinY.Buffer(), bounds.MinZ.Buffer(),
+				bounds.MaxX.Buffer(), bounds.MaxY.Buffer(), bounds.MaxZ.Buffer() };
+			const int width = 4;
+			for (int j = start; j < end; j += width)
+			{
+				__m128 box[6];
+				for (int k = 0; k < 6; k++)
+					box[k] = _mm_loadu_ps(arrays[k] + j);
+				unsigned int laneMasks[width] = {};
+				for (int f = 0; f < frustums.Count; f++)
+				{
+					__m128 culled = _mm_setzero_ps();
+					for (int i = 0; i < 6; i++)
+					{
+						auto & plane = frustums.Planes[f][i];
+						// same evaluation order as the scalar test so that results match exactly
+						__m128 dist = _mm_mul_ps(_mm_set1_ps(plane.X), box[plane.Select[0]]);
+						dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.Y), box[plane.Select[1]]));
+						dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.Z), box[plane.Select[2]]));
+						dist = _mm_add_ps(dist, _mm_set1_ps(plane.W));
+						culled = _mm_or_ps(culled, _mm_cmplt_ps(dist, _mm_setzero_ps()));
+					}
+					int visible = ~_mm_movemask_ps(culled) & 0xF;
+					for (; visible; visible &= visible - 1)
+						laneMasks[Math::Log2Floor(visible & (~visible + 1))] |= (1u << f);
+				}
+				int laneCount = Math::Min(width, end - j);
+				for (int k = 0; k < laneCount; k++)
+					masks[j + k] = laneMasks[k];
+			}
+		}
+	}
+
+	void ComputeFrustumVisibility(ArrayView<CullFrustum> frustums, const BBoxArraySoA & bounds, List<unsigned int> & visibilityMasks)
+	{
+		BatchCullFrustums batchFrustums(frustums);
+		visibilityMasks.SetSize(bounds.Count());
+		const int blockSize = BBoxArraySoA::PaddingGranularity;
+		const int blocksPerJob = 128;
+		int blockCount = (bounds.Count() + blockSize - 1) / blockSize;
+		auto masks = visibilityMasks.Buffer();
+		int count = bounds.Count();
+		if (blockCount <= blocksPerJob || Threading::JobSystem::GetThreadCount() == 1)
+		{
+			ComputeVisibilityRange(batchFrustums, bounds, masks, 0, count);
+			return;
+		}
+		Threading::JobSystem::ParallelForRange(0, blockCount, blocksPerJob, [&](int blockStart, int blockEnd)
+		{
+			ComputeVisibilityRange(batchFrustums, bounds, masks, blockStart * blockSize, Math::Min(blockEnd * blockSize, count));
+		});
+	}
+
+	void CullBoxes(ArrayView<CullFrustum> frustums, const BBoxArraySoA & bounds, ArrayView<List<int>> visibleIndices)
+	{
+		List<unsigned int> masks;
+		ComputeFrustumVisibility(frustums, bounds, masks);
+		for (int i = 0; i < masks.Count(); i++)
+		{
+			for (unsigned int mask = masks[i]; mask; mask &= mask - 1)
+				visibleIndices[Math::Log2Floor(mask & (~mask + 1))].Add(i);
+		}
+	}
+
+	void CullBoxes(const CullFrustum & frustum, const BBoxArraySoA & bounds, List<int> & visibleIndices)
+	{
+		CullBoxes(MakeArrayView(frustum), bounds, MakeArrayView(visibleIndices));
+	}
 }
@@ -6,18 +6,67 @@
 
 namespace GameEngine
 {
+	enum class FrustumTestResult
+	{
+		Outside, Intersecting, Inside
+	};
+
 	struct CullFrustum
 	{
 	private:
 		void FromVerts(CoreLib::ArrayView<VectorMath::Vec3> points);
 	public:
 		VectorMath::Vec4 Planes[6];
-		bool IsBoxInFrustum(CoreLib::Graphics::BBox box);
+		bool IsBoxInFrustum(const CoreLib::Graphics::BBox & box) const;
+		// conservative like IsBoxInFrustum, additionally reports boxes that are entirely inside
+		FrustumTestResult ClassifyBox(const CoreLib::Graphics::BBox & box) const;
 
 		CullFrustum(CoreLib::Graphics::ViewFrustum f);
 		CullFrustum(CoreLib::Graphics::Matrix4 invViewProj);
 
 		CullFrustum() = default;
 	};
+
+	// Axis aligned boxes stored as structure of arrays for batched culling.
+	// Storage is padded to a multiple of 8 boxes so that SIMD loops never read past the arrays.
+	class BBoxArraySoA
+	{
+	private:
+		int count = 0;
+	public:
+		static const int PaddingGranularity = 8;
+		CoreLib::List<float> MinX, MinY, MinZ, MaxX, MaxY, MaxZ;
+		int Count() const
+		{
+			return count;
+		}
+		void SetSize(int size);
+		void Clear()
+		{
+			SetSize(0);
+		}
+		void Set(int i, const CoreLib::Graphics::BBox & box)
+		{
+			MinX[i] = box.xMin; MinY[i] = box.yMin; MinZ[i] = box.zMin;
+			MaxX[i] = box.xMax; MaxY[i] = box.yMax; MaxZ[i] = box.zMax;
+		}
+		void Add(const CoreLib::Graphics::BBox & box)
+		{
+			SetSize(count + 1);
+			Set(count - 1, box);
+		}
+	};
+
+	const int MaxBatchCullFrustums = 32;
+
+	// Tests every box against up to MaxBatchCullFrustums frusta in one pass over the bounds, 4 boxes per
+	// SSE instruction. Bit f of visibilityMasks[i] is set if box i passes
+	// CullFrustum::IsBoxInFrustum for frustums[f]; results are identical to the scalar test.
+	// Large inputs are split across the job system.
+	void ComputeFrustumVisibility(CoreLib::ArrayView<CullFrustum> frustums, const BBoxArraySoA & bounds, CoreLib::List<unsigned int> & visibilityMasks);
+
+	// Appends the indices of the boxes that intersect frustums[f] to visibleIndices[f], in ascending order.
+	void CullBoxes(CoreLib::ArrayView<CullFrustum> frustums, const BBoxArraySoA & bounds, CoreLib::ArrayView<CoreLib::List<int>> visibleIndices);
+	void CullBoxes(const CullFrustum & frustum, const BBoxArraySoA & bounds, CoreLib::List<int> & visibleIndices);
 }
 #endif
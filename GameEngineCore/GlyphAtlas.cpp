@@ -0,0 +1,144 @@
+#include "GlyphAtlas.h"
+
+using namespace CoreLib;
+
+namespace GameEngine
+{
+    void PackTextPixels(unsigned char * dst, const unsigned char * pixels, int pixelCount)
+    {
+        const int pixelsPerByte = 1 << Log2TextPixelsPerByte;
+        const float valScale = ((1 << TextPixelBits) - 1) / 255.0f;
+        for (int i = 0; i < pixelCount; i += pixelsPerByte)
+        {
+            int packed = 0;
+            for (int j = 0; j < pixelsPerByte && i + j < pixelCount; j++)
+                packed |= Math::FastFloor(pixels[i + j] * valScale + 0.5f) << (j * TextPixelBits);
+            dst[i >> Log2TextPixelsPerByte] = (unsigned char)packed;
+        }
+    }
+
+    GlyphAtlas::~GlyphAtlas()
+    {
+        Clear();
+    }
+
+    void GlyphAtlas::Init(unsigned char * pTextBuffer, MemoryPool * pPool, int pBudget, int pFramesInFlight)
+    {
+        Clear();
+        textBuffer = pTextBuffer;
+        pool = pPool;
+        budget = pBudget;
+        framesInFlight = pFramesInFlight;
+    }
+
+    void GlyphAtlas::Clear()
+    {
+        while (head)
+        {
+            auto entry = head;
+            head = head->Next;
+            if (entry->Address != -1)
+                pool->Free(textBuffer + entry->Address, entry->BufferSize);
+            delete entry;
+        }
+        tail = nullptr;
+        entries = Dictionary<uint64_t, GlyphAtlasEntry*>();
+        bytesUsed = 0;
+    }
+
+    void GlyphAtlas::Unlink(GlyphAtlasEntry * entry)
+    {
+        if (entry->Previous)
+            entry->Previous->Next = entry->Next;
+        else
+            head = entry->Next;
+        if (entry->Next)
+            entry->Next->Previous = entry->Previous;
+        else
+            tail = entry->Previous;
+        entry->Previous = entry->Next = nullptr;
+    }
+
+    void GlyphAtlas::LinkFront(GlyphAtlasEntry * entry)
+    {
+        entry->Previous = nullptr;
+        entry->Next = head;
+        if (head)
+            head->Previous = entry;
+        head = entry;
+        if (!tail)
+            tail = entry;
+    }
+
+    bool GlyphAtlas::EvictLeastRecentlyUsed()
+    {
+        // a frame still in flight may read the glyph
+        if (!tail || tail->LastUse > frameId - framesInFlight)
+            return false;
+        auto victim = tail;
+        Unlink(victim);
+        entries.Remove(victim->Key);
+        if (victim->Address != -1)
+        {
+            pool->Free(textBuffer + victim->Address, victim->BufferSize);
+            bytesUsed -= victim->BufferSize;
+        }
+        delete victim;
+        evictionCount++;
+        return true;
+    }
+
+    GlyphAtlasEntry * GlyphAtlas::Find(int fontId, unsigned int glyph)
+    {
+        GlyphAtlasEntry * entry = nullptr;
+        if (!entries.TryGetValue(GetKey(fontId, glyph), entry))
+            return nullptr;
+        entry->LastUse = frameId;
+        if (entry != head)
+        {
+            Unlink(entry);
+            LinkFront(entry);
+        }
+        return entry;
+    }
+
+    GlyphAtlasEntry * GlyphAtlas::Add(int fontId, unsigned int glyph, int width, int height, const unsigned char * pixels)
+    {
+        int pixelCount = width * height;
+        int address = -1, bufferSize = 0;
+        if (pixelCount > 0)
+        {
+            int bytes = (pixelCount + (1 << Log2TextPixelsPerByte) - 1) >> Log2TextPixelsPerByte;
+            // the pool hands out power of two sized blocks
+            bufferSize = Math::Max(1 << Log2TextBufferBlockSize, 1 << Math::Log2Ceil(bytes));
+            if (bufferSize > budget)
+                return nullptr;
+            unsigned char * memory = nullptr;
+            while (true)
+            {
+                if (bytesUsed + bufferSize <= budget)
+                {
+                    memory = pool->Alloc(bufferSize);
+                    if (memory)
+                        break;
+                }
+                if (!EvictLeastRecentlyUsed())
+                    return nullptr;
+            }
+            PackTextPixels(memory, pixels, pixelCount);
+            address = (int)(memory - textBuffer);
+            bytesUsed += bufferSize;
+            uploadCount++;
+        }
+        auto entry = new GlyphAtlasEntry();
+        entry->Key = GetKey(fontId, glyph);
+        entry->Width = width;
+        entry->Height = height;
+        entry->Address = address;
+        entry->BufferSize = bufferSize;
+        entry->LastUse = frameId;
+        LinkFront(entry);
+        entries[entry->Key] = entry;
+        return entry;
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef GAME_ENGINE_GLYPH_ATLAS_H
+#define GAME_ENGINE_GLYPH_ATLAS_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/MemoryPool.h"
+#include "CoreLib/LibMath.h"
+
+namespace GameEngine
+{
+    const int TextBufferSize = 6 * 1024 * 1024;
+    const int TextPixelBits = 4;
+    const int Log2TextPixelsPerByte = CoreLib::Math::Log2Floor(8 / TextPixelBits);
+    const int Log2TextBufferBlockSize = 6;
+
+    struct GlyphAtlasEntry
+    {
+        uint64_t Key = 0;
+        int Width = 0, Height = 0;
+        // byte offset of the packed bitmap in the text buffer, -1 for glyphs without pixels
+        int Address = -1;
+        int BufferSize = 0;
+        int64_t LastUse = 0;
+        GlyphAtlasEntry * Previous = nullptr;
+        GlyphAtlasEntry * Next = nullptr;
+    };
+
+    // Keeps rasterized glyphs of all UI fonts in the text buffer, packed like baked text so the UI shader can draw
+    // each glyph as a text quad. Glyphs are uploaded by writing into newly allocated text buffer memory, which no
+    // frame in flight reads, so uploads never wait for the GPU. When the budget is exhausted the least recently used
+    // glyphs are evicted, but only once the last frame that drew them has completed.
+    class GlyphAtlas
+    {
+    private:
+        unsigned char * textBuffer = nullptr;
+        CoreLib::MemoryPool * pool = nullptr;
+        int budget = 0, bytesUsed = 0;
+        int framesInFlight = 1;
+        int64_t frameId = 0;
+        int fontIdAllocator = 0;
+        CoreLib::Dictionary<uint64_t, GlyphAtlasEntry*> entries;
+        // most and least recently used glyph
+        GlyphAtlasEntry * head = nullptr;
+        GlyphAtlasEntry * tail = nullptr;
+        int uploadCount = 0, evictionCount = 0;
+        static uint64_t GetKey(int fontId, unsigned int glyph)
+        {
+            // integer keys hash to their lower 32 bits, mix the font into them so fonts do not collide
+            unsigned int fontBits = (unsigned int)fontId;
+            return ((uint64_t)fontBits << 32) | (glyph ^ (fontBits * 0x9E3779B1u));
+        }
+        void Unlink(GlyphAtlasEntry * entry);
+        void LinkFront(GlyphAtlasEntry * entry);
+        bool EvictLeastRecentlyUsed();
+    public:
+        GlyphAtlas() = default;
+        GlyphAtlas(const GlyphAtlas &) = delete;
+        GlyphAtlas & operator = (const GlyphAtlas &) = delete;
+        ~GlyphAtlas();
+        // textBuffer is the start of the buffer the pool allocates from, glyphs occupy at most budget bytes of it
+        void Init(unsigned char * pTextBuffer, CoreLib::MemoryPool * pPool, int pBudget, int pFramesInFlight);
+        void Clear();
+        // Each font size and dpi gets its own id, glyphs of a font that is no longer used age out of the atlas.
+        int RegisterFont()
+        {
+            return ++fontIdAllocator;
+        }
+        // Called once per frame after waiting for the frame that was submitted framesInFlight frames ago.
+        void AdvanceFrame()
+        {
+            frameId++;
+        }
+        // Returns the glyph and marks it as used by the current frame, or nullptr if it has not been added.
+        GlyphAtlasEntry * Find(int fontId, unsigned int glyph);
+        // Packs and uploads a glyph bitmap with one byte per pixel. Returns nullptr if the glyph does not fit
+        // until more frames complete.
+        GlyphAtlasEntry * Add(int fontId, unsigned int glyph, int width, int height, const unsigned char * pixels);
+        int GetBytesUsed()
+        {
+            return bytesUsed;
+        }
+        int GetGlyphCount()
+        {
+            return entries.Count();
+        }
+        int GetUploadCount()
+        {
+            return uploadCount;
+        }
+        int GetEvictionCount()
+        {
+            return evictionCount;
+        }
+    };
+
+    // Packs 8 bit coverage values to TextPixelBits per pixel.
+    void PackTextPixels(unsigned char * dst, const unsigned char * pixels, int pixelCount);
+}
+
+#endif
@@ -20,6 +20,14 @@ namespace GameEngine
 				ShadowMapArraySize = StringToInt(settingsValue);
 			else if (settingsName == "ShadowMapResolution")
 				ShadowMapResolution = StringToInt(settingsValue);
+			else if (settingsName == "UseInstancing")
+				UseInstancing = StringToInt(settingsValue) != 0;
+			else if (settingsName == "AsyncPipelineCompilation")
+				AsyncPipelineCompilation = StringToInt(settingsValue) != 0;
+			else if (settingsName == "TextureStreaming")
+				TextureStreaming = StringToInt(settingsValue) != 0;
+			else if (settingsName == "TextureStreamingBudget")
+				TextureStreamingBudget = StringToInt(settingsValue);
 		}
 	}
 	void GraphicsSettings::SaveToFile(CoreLib::String fileName)
@@ -27,6 +35,10 @@ namespace GameEngine
 		StringBuilder sb;
 		sb << "ShadowMapArraySize = \"" << ShadowMapArraySize << "\"\n";
 		sb << "ShadowMapResolution = \"" << ShadowMapResolution << "\"\n";
+		sb << "UseInstancing = \"" << (UseInstancing ? 1 : 0) << "\"\n";
+		sb << "AsyncPipelineCompilation = \"" << (AsyncPipelineCompilation ? 1 : 0) << "\"\n";
+		sb << "TextureStreaming = \"" << (TextureStreaming ? 1 : 0) << "\"\n";
+		sb << "TextureStreamingBudget = \"" << TextureStreamingBudget << "\"\n";
 		File::WriteAllText(fileName, sb.ProduceString());
 	}
 }
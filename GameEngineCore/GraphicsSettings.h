@@ -11,6 +11,10 @@ namespace GameEngine
 		int ShadowMapArraySize = 8;
 		int ShadowMapResolution = 1024;
 		bool UsePipelineCache = true;
+		bool UseInstancing = true;
+		bool AsyncPipelineCompilation = true;
+		bool TextureStreaming = false;
+		int TextureStreamingBudget = 512; // MB of GPU memory for streamed textures
 		void LoadFromFile(CoreLib::String fileName);
 		void SaveToFile(CoreLib::String fileName);
 	};
@@ -302,7 +302,90 @@ uint32_t WelsCPUFeatureDetect (int32_t* pNumberOfLogicProcessors) {
          WELS_CPU_NEON;
 }
 
-#else /* Neither X86_ASM, HAVE_NEON nor HAVE_NEON_AARCH64 */
+#elif defined(X86_INTRINSICS)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void WelsCPUIdEx (uint32_t uiIndex, uint32_t uiSubIndex, uint32_t* pFeatureA, uint32_t* pFeatureB,
+                         uint32_t* pFeatureC, uint32_t* pFeatureD) {
+#if defined(_MSC_VER)
+  int32_t iRegs[4];
+  __cpuidex (iRegs, uiIndex, uiSubIndex);
+  *pFeatureA = iRegs[0];
+  *pFeatureB = iRegs[1];
+  *pFeatureC = iRegs[2];
+  *pFeatureD = iRegs[3];
+#else
+  __cpuid_count (uiIndex, uiSubIndex, *pFeatureA, *pFeatureB, *pFeatureC, *pFeatureD);
+#endif
+}
+
+/* the register state components the OS saves on context switches */
+static uint64_t WelsXGetBV() {
+#if defined(_MSC_VER)
+  return _xgetbv (0);
+#else
+  uint32_t uiLow, uiHigh;
+  __asm__ volatile ("xgetbv" : "=a" (uiLow), "=d" (uiHigh) : "c" (0));
+  return ((uint64_t)uiHigh << 32) | uiLow;
+#endif
+}
+
+/* Detects the instruction sets used by the intrinsics kernels. The number of logic processors is not
+ * reported, the encoder then queries the OS for it. */
+uint32_t WelsCPUFeatureDetect (int32_t* pNumberOfLogicProcessors) {
+  uint32_t uiCPU = 0;
+  uint32_t uiFeatureA = 0, uiFeatureB = 0, uiFeatureC = 0, uiFeatureD = 0;
+  uint32_t uiMaxCpuidLevel = 0;
+
+  WelsCPUIdEx (0, 0, &uiFeatureA, &uiFeatureB, &uiFeatureC, &uiFeatureD);
+  uiMaxCpuidLevel = uiFeatureA;
+  if (uiMaxCpuidLevel == 0) {
+    return 0;
+  }
+
+  WelsCPUIdEx (1, 0, &uiFeatureA, &uiFeatureB, &uiFeatureC, &uiFeatureD);
+  if (uiFeatureD & 0x00800000) {
+    uiCPU |= WELS_CPU_MMX;
+  }
+  if (uiFeatureD & 0x02000000) {
+    uiCPU |= WELS_CPU_MMXEXT | WELS_CPU_SSE;
+  }
+  if (uiFeatureD & 0x04000000) {
+    uiCPU |= WELS_CPU_SSE2;
+  }
+  if (uiFeatureC & 0x00000001) {
+    uiCPU |= WELS_CPU_SSE3;
+  }
+  if (uiFeatureC & 0x00000200) {
+    uiCPU |= WELS_CPU_SSSE3;
+  }
+  if (uiFeatureC & 0x00080000) {
+    uiCPU |= WELS_CPU_SSE41;
+  }
+  if (uiFeatureC & 0x00100000) {
+    uiCPU |= WELS_CPU_SSE42;
+  }
+  /* AVX needs OSXSAVE and the OS saving both the XMM and the YMM state */
+  if ((uiFeatureC & 0x18000000) == 0x18000000 && (WelsXGetBV() & 0x6) == 0x6) {
+    uiCPU |= WELS_CPU_AVX;
+  }
+
+  if (uiMaxCpuidLevel >= 7) {
+    WelsCPUIdEx (7, 0, &uiFeatureA, &uiFeatureB, &uiFeatureC, &uiFeatureD);
+    if ((uiCPU & WELS_CPU_AVX) && (uiFeatureB & 0x00000020)) {
+      uiCPU |= WELS_CPU_AVX2;
+    }
+  }
+
+  return uiCPU;
+}
+
+#else /* Neither X86_ASM, X86_INTRINSICS, HAVE_NEON nor HAVE_NEON_AARCH64 */
 
 uint32_t WelsCPUFeatureDetect (int32_t* pNumberOfLogicProcessors) {
   return 0;
@@ -68,7 +68,21 @@
 #define WELS_CPU_FMA        0x00020000  /* AVX VEX FMA instruction sets */
 #define WELS_CPU_AVX        0x00000800  /* Advanced Vector eXtentions */
 
-#ifdef HAVE_AVX2
+/* Without the assembly kernels, x86 builds use kernels written with compiler intrinsics */
+#if !defined(X86_ASM) && (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define X86_INTRINSICS
+#endif
+
+/* Kernels that need more than SSE2 are compiled for their instruction set and only installed at runtime */
+#if defined(X86_INTRINSICS) && (defined(__GNUC__) || defined(__clang__))
+#define WELS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define WELS_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define WELS_TARGET_SSSE3
+#define WELS_TARGET_AVX2
+#endif
+
+#if defined(HAVE_AVX2) || defined(X86_INTRINSICS)
 #define WELS_CPU_AVX2       0x00040000  /* AVX2 */
 #else
 #define WELS_CPU_AVX2       0x00000000  /* !AVX2 */
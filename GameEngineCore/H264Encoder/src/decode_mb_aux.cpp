@@ -279,6 +279,13 @@ void WelsInitReconstructionFuncs (SWelsFuncPtrList* pFuncList, uint32_t  uiCpuFl
 
 #endif//X86_ASM
 
+#if defined(X86_INTRINSICS)
+  if (uiCpuFlag & WELS_CPU_SSE2) {
+    pFuncList->pfIDctT4         = WelsIDctT4Rec_sse2;
+    pFuncList->pfIDctFourT4     = WelsIDctFourT4Rec_sse2;
+  }
+#endif//X86_INTRINSICS
+
 #if defined(HAVE_NEON)
   if (uiCpuFlag & WELS_CPU_NEON) {
     pFuncList->pfDequantization4x4          = WelsDequant4x4_neon;
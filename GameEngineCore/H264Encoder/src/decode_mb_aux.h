@@ -36,6 +36,7 @@
 #include "typedefs.h"
 #include "macros.h"
 #include "wels_func_ptr_def.h"
+#include "cpu_core.h"
 
 namespace WelsEnc {
 void WelsDequantLumaDc4x4 (int16_t* pRes, const int32_t kiQp);
@@ -73,6 +74,11 @@ void WelsIDctT4Rec_avx2 (uint8_t* pRec, int32_t iStride, uint8_t* pPrediction, i
 void WelsIDctFourT4Rec_avx2 (uint8_t* pRec, int32_t iStride, uint8_t* pPrediction, int32_t iPredStride, int16_t* pDct);
 #endif//X86_ASM
 
+#if defined(X86_INTRINSICS)
+void WelsIDctT4Rec_sse2 (uint8_t* pRec, int32_t iStride, uint8_t* pPrediction, int32_t iPredStride, int16_t* pDct);
+void WelsIDctFourT4Rec_sse2 (uint8_t* pRec, int32_t iStride, uint8_t* pPrediction, int32_t iPredStride, int16_t* pDct);
+#endif//X86_INTRINSICS
+
 #ifdef HAVE_NEON
 void WelsDequantFour4x4_neon (int16_t* pDct, const uint16_t* kpMF);
 void WelsDequant4x4_neon (int16_t* pDct, const uint16_t* kpMF);
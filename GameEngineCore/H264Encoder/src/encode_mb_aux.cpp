@@ -541,6 +541,18 @@ void WelsInitEncodingFuncs (SWelsFuncPtrList* pFuncList, uint32_t  uiCpuFlag) {
 
 #endif//X86_ASM
 
+#if defined(X86_INTRINSICS)
+  if (uiCpuFlag & WELS_CPU_SSE2) {
+    pFuncList->pfDctT4                  = WelsDctT4_sse2;
+    pFuncList->pfDctFourT4              = WelsDctFourT4_sse2;
+
+    pFuncList->pfQuantization4x4        = WelsQuant4x4_sse2;
+    pFuncList->pfQuantizationDc4x4      = WelsQuant4x4Dc_sse2;
+    pFuncList->pfQuantizationFour4x4    = WelsQuantFour4x4_sse2;
+    pFuncList->pfQuantizationFour4x4Max = WelsQuantFour4x4Max_sse2;
+  }
+#endif//X86_INTRINSICS
+
 #if defined(HAVE_NEON)
   if (uiCpuFlag & WELS_CPU_NEON) {
     pFuncList->pfQuantizationHadamard2x2        = WelsHadamardQuant2x2_neon;
@@ -36,6 +36,7 @@
 #include "typedefs.h"
 #include "wels_func_ptr_def.h"
 #include "copy_mb.h"
+#include "cpu_core.h"
 
 namespace WelsEnc {
 void WelsInitEncodingFuncs (SWelsFuncPtrList* pFuncList, uint32_t  uiCpuFlag);
@@ -114,6 +115,16 @@ void WelsQuantFour4x4Max_avx2 (int16_t* pDct, const int16_t* pFF, const int16_t*
 
 #endif
 
+#if defined(X86_INTRINSICS)
+void WelsDctT4_sse2 (int16_t* pDct,  uint8_t* pPixel1, int32_t iStride1, uint8_t* pPixel2, int32_t iStride2);
+void WelsDctFourT4_sse2 (int16_t* pDct, uint8_t* pPixel1, int32_t iStride1, uint8_t* pPixel2, int32_t iStride2);
+
+void WelsQuant4x4_sse2 (int16_t* pDct, const int16_t* pFF, const int16_t* pMF);
+void WelsQuant4x4Dc_sse2 (int16_t* pDct, int16_t iFF, int16_t iMF);
+void WelsQuantFour4x4_sse2 (int16_t* pDct, const int16_t* pFF, const int16_t* pMF);
+void WelsQuantFour4x4Max_sse2 (int16_t* pDct, const int16_t* pFF, const int16_t* pMF, int16_t* pMax);
+#endif
+
 #ifdef HAVE_NEON
 void WelsHadamardT4Dc_neon (int16_t* pLumaDc, int16_t* pDct);
 int32_t WelsHadamardQuant2x2_neon (int16_t* pRes, const int16_t kiFF, int16_t iMF, int16_t* pDct, int16_t* pBlock);
@@ -0,0 +1,238 @@
+/*!
+ *************************************************************************************
+ * \file    encode_mb_aux_x86.cpp
+ *
+ * \brief   4x4 forward/inverse transforms and quantization written with SSE2 intrinsics,
+ *          used when the assembly kernels are not built. The results are identical to
+ *          the C functions.
+ *
+ *************************************************************************************
+ */
+
+#include "encode_mb_aux.h"
+#include "decode_mb_aux.h"
+#include "ls_defines.h"
+
+#if defined(X86_INTRINSICS)
+
+#include <emmintrin.h>
+
+namespace WelsEnc {
+namespace {
+
+/****************************************************************************
+ * DCT functions
+ ****************************************************************************/
+inline __m128i LoadDiff8 (const uint8_t* pPixel1, const uint8_t* pPixel2) {
+  const __m128i kZero = _mm_setzero_si128();
+  return _mm_sub_epi16 (_mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)pPixel1), kZero),
+                        _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)pPixel2), kZero));
+}
+
+inline __m128i LoadDiff4 (const uint8_t* pPixel1, const uint8_t* pPixel2) {
+  const __m128i kZero = _mm_setzero_si128();
+  return _mm_sub_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (LD32 (pPixel1)), kZero),
+                        _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (LD32 (pPixel2)), kZero));
+}
+
+// transposes the 4x4 blocks of 16 bit values in the low and the high halves of the four rows
+inline void Transpose4x4Pairs (__m128i& iRow0, __m128i& iRow1, __m128i& iRow2, __m128i& iRow3) {
+  __m128i iLow01 = _mm_unpacklo_epi16 (iRow0, iRow1);
+  __m128i iHigh01 = _mm_unpackhi_epi16 (iRow0, iRow1);
+  __m128i iLow23 = _mm_unpacklo_epi16 (iRow2, iRow3);
+  __m128i iHigh23 = _mm_unpackhi_epi16 (iRow2, iRow3);
+  __m128i iLowCol01 = _mm_unpacklo_epi32 (iLow01, iLow23);
+  __m128i iLowCol23 = _mm_unpackhi_epi32 (iLow01, iLow23);
+  __m128i iHighCol01 = _mm_unpacklo_epi32 (iHigh01, iHigh23);
+  __m128i iHighCol23 = _mm_unpackhi_epi32 (iHigh01, iHigh23);
+  iRow0 = _mm_unpacklo_epi64 (iLowCol01, iHighCol01);
+  iRow1 = _mm_unpackhi_epi64 (iLowCol01, iHighCol01);
+  iRow2 = _mm_unpacklo_epi64 (iLowCol23, iHighCol23);
+  iRow3 = _mm_unpackhi_epi64 (iLowCol23, iHighCol23);
+}
+
+// one dimensional forward transform across the four vectors, wrapping in 16 bits like the C code
+inline void DctButterfly (__m128i& iData0, __m128i& iData1, __m128i& iData2, __m128i& iData3) {
+  __m128i iSum03 = _mm_add_epi16 (iData0, iData3);
+  __m128i iDiff03 = _mm_sub_epi16 (iData0, iData3);
+  __m128i iSum12 = _mm_add_epi16 (iData1, iData2);
+  __m128i iDiff12 = _mm_sub_epi16 (iData1, iData2);
+  iData0 = _mm_add_epi16 (iSum03, iSum12);
+  iData2 = _mm_sub_epi16 (iSum03, iSum12);
+  iData1 = _mm_add_epi16 (_mm_slli_epi16 (iDiff03, 1), iDiff12);
+  iData3 = _mm_sub_epi16 (iDiff03, _mm_slli_epi16 (iDiff12, 1));
+}
+
+// transforms two horizontally adjacent 4x4 blocks, the left one to pDct[0..15], the right one to pDct[16..31]
+inline void DctT4Pair (int16_t* pDct, __m128i iRow0, __m128i iRow1, __m128i iRow2, __m128i iRow3, bool bRightBlock) {
+  Transpose4x4Pairs (iRow0, iRow1, iRow2, iRow3);
+  DctButterfly (iRow0, iRow1, iRow2, iRow3);
+  Transpose4x4Pairs (iRow0, iRow1, iRow2, iRow3);
+  DctButterfly (iRow0, iRow1, iRow2, iRow3);
+  _mm_storeu_si128 ((__m128i*)pDct, _mm_unpacklo_epi64 (iRow0, iRow1));
+  _mm_storeu_si128 ((__m128i*) (pDct + 8), _mm_unpacklo_epi64 (iRow2, iRow3));
+  if (bRightBlock) {
+    _mm_storeu_si128 ((__m128i*) (pDct + 16), _mm_unpackhi_epi64 (iRow0, iRow1));
+    _mm_storeu_si128 ((__m128i*) (pDct + 24), _mm_unpackhi_epi64 (iRow2, iRow3));
+  }
+}
+
+inline void DctT8x4 (int16_t* pDct, const uint8_t* pPixel1, int32_t iStride1, const uint8_t* pPixel2,
+                     int32_t iStride2) {
+  DctT4Pair (pDct, LoadDiff8 (pPixel1, pPixel2), LoadDiff8 (pPixel1 + iStride1, pPixel2 + iStride2),
+             LoadDiff8 (pPixel1 + 2 * iStride1, pPixel2 + 2 * iStride2),
+             LoadDiff8 (pPixel1 + 3 * iStride1, pPixel2 + 3 * iStride2), true);
+}
+
+/****************************************************************************
+ * HDM and Quant functions
+ ****************************************************************************/
+// |pDct| + FF is at most 32768 + 32767, so it is computed unsigned; MF is below 32768
+inline __m128i QuantAbs (__m128i iDct, __m128i iSign, __m128i iFF, __m128i iMF) {
+  __m128i iAbs = _mm_sub_epi16 (_mm_xor_si128 (iDct, iSign), iSign);
+  return _mm_mulhi_epu16 (_mm_add_epi16 (iAbs, iFF), iMF);
+}
+
+inline void Quant8 (int16_t* pDct, __m128i iFF, __m128i iMF) {
+  __m128i iDct = _mm_loadu_si128 ((const __m128i*)pDct);
+  __m128i iSign = _mm_srai_epi16 (iDct, 15);
+  __m128i iLevel = QuantAbs (iDct, iSign, iFF, iMF);
+  _mm_storeu_si128 ((__m128i*)pDct, _mm_sub_epi16 (_mm_xor_si128 (iLevel, iSign), iSign));
+}
+
+/****************************************************************************
+ * IDCT functions, final output = prediction(CS) + IDCT(scaled_coeff)
+ ****************************************************************************/
+inline __m128i SignExtendLow (__m128i iData) {
+  return _mm_srai_epi32 (_mm_unpacklo_epi16 (iData, iData), 16);
+}
+
+inline __m128i SignExtendHigh (__m128i iData) {
+  return _mm_srai_epi32 (_mm_unpackhi_epi16 (iData, iData), 16);
+}
+
+inline void Transpose4x4Epi32 (__m128i& iRow0, __m128i& iRow1, __m128i& iRow2, __m128i& iRow3) {
+  __m128i iLow01 = _mm_unpacklo_epi32 (iRow0, iRow1);
+  __m128i iLow23 = _mm_unpacklo_epi32 (iRow2, iRow3);
+  __m128i iHigh01 = _mm_unpackhi_epi32 (iRow0, iRow1);
+  __m128i iHigh23 = _mm_unpackhi_epi32 (iRow2, iRow3);
+  iRow0 = _mm_unpacklo_epi64 (iLow01, iLow23);
+  iRow1 = _mm_unpackhi_epi64 (iLow01, iLow23);
+  iRow2 = _mm_unpacklo_epi64 (iHigh01, iHigh23);
+  iRow3 = _mm_unpackhi_epi64 (iHigh01, iHigh23);
+}
+
+inline __m128i LoadPred4 (const uint8_t* pPred) {
+  const __m128i kZero = _mm_setzero_si128();
+  return _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (LD32 (pPred)), kZero), kZero);
+}
+
+} // anon ns.
+
+void WelsDctT4_sse2 (int16_t* pDct, uint8_t* pPixel1, int32_t iStride1, uint8_t* pPixel2, int32_t iStride2) {
+  DctT4Pair (pDct, LoadDiff4 (pPixel1, pPixel2), LoadDiff4 (pPixel1 + iStride1, pPixel2 + iStride2),
+             LoadDiff4 (pPixel1 + 2 * iStride1, pPixel2 + 2 * iStride2),
+             LoadDiff4 (pPixel1 + 3 * iStride1, pPixel2 + 3 * iStride2), false);
+}
+
+void WelsDctFourT4_sse2 (int16_t* pDct, uint8_t* pPixel1, int32_t iStride1, uint8_t* pPixel2, int32_t iStride2) {
+  DctT8x4 (pDct,      pPixel1,                iStride1, pPixel2,                iStride2);
+  DctT8x4 (pDct + 32, pPixel1 + 4 * iStride1, iStride1, pPixel2 + 4 * iStride2, iStride2);
+}
+
+void WelsQuant4x4_sse2 (int16_t* pDct, const int16_t* pFF, const int16_t* pMF) {
+  __m128i iFF = _mm_loadu_si128 ((const __m128i*)pFF);
+  __m128i iMF = _mm_loadu_si128 ((const __m128i*)pMF);
+  Quant8 (pDct, iFF, iMF);
+  Quant8 (pDct + 8, iFF, iMF);
+}
+
+void WelsQuant4x4Dc_sse2 (int16_t* pDct, int16_t iFF, int16_t iMF) {
+  __m128i iFFs = _mm_set1_epi16 (iFF);
+  __m128i iMFs = _mm_set1_epi16 (iMF);
+  Quant8 (pDct, iFFs, iMFs);
+  Quant8 (pDct + 8, iFFs, iMFs);
+}
+
+void WelsQuantFour4x4_sse2 (int16_t* pDct, const int16_t* pFF, const int16_t* pMF) {
+  __m128i iFF = _mm_loadu_si128 ((const __m128i*)pFF);
+  __m128i iMF = _mm_loadu_si128 ((const __m128i*)pMF);
+  for (int32_t i = 0; i < 64; i += 8)
+    Quant8 (pDct + i, iFF, iMF);
+}
+
+void WelsQuantFour4x4Max_sse2 (int16_t* pDct, const int16_t* pFF, const int16_t* pMF, int16_t* pMax) {
+  __m128i iFF = _mm_loadu_si128 ((const __m128i*)pFF);
+  __m128i iMF = _mm_loadu_si128 ((const __m128i*)pMF);
+  for (int32_t k = 0; k < 4; k++) {
+    __m128i iMax = _mm_setzero_si128();
+    for (int32_t i = 0; i < 16; i += 8) {
+      __m128i iDct = _mm_loadu_si128 ((const __m128i*) (pDct + i));
+      __m128i iSign = _mm_srai_epi16 (iDct, 15);
+      __m128i iLevel = QuantAbs (iDct, iSign, iFF, iMF);
+      iMax = _mm_max_epi16 (iMax, iLevel);
+      _mm_storeu_si128 ((__m128i*) (pDct + i), _mm_sub_epi16 (_mm_xor_si128 (iLevel, iSign), iSign));
+    }
+    iMax = _mm_max_epi16 (iMax, _mm_srli_si128 (iMax, 8));
+    iMax = _mm_max_epi16 (iMax, _mm_srli_si128 (iMax, 4));
+    iMax = _mm_max_epi16 (iMax, _mm_srli_si128 (iMax, 2));
+    pMax[k] = (int16_t)_mm_cvtsi128_si32 (iMax);
+    pDct += 16;
+  }
+}
+
+// Computed in 32 bits like the C code, the intermediate rows are truncated to 16 bits where the C code stores them.
+void WelsIDctT4Rec_sse2 (uint8_t* pRec, int32_t iStride, uint8_t* pPred, int32_t iPredStride, int16_t* pDct) {
+  __m128i iDct01 = _mm_loadu_si128 ((const __m128i*)pDct);
+  __m128i iDct23 = _mm_loadu_si128 ((const __m128i*) (pDct + 8));
+  __m128i iCol0 = SignExtendLow (iDct01), iCol1 = SignExtendHigh (iDct01);
+  __m128i iCol2 = SignExtendLow (iDct23), iCol3 = SignExtendHigh (iDct23);
+  // horizontal pass, after the transpose each vector holds one column of all four rows
+  Transpose4x4Epi32 (iCol0, iCol1, iCol2, iCol3);
+  __m128i iHorSumU = _mm_add_epi32 (iCol0, iCol2);
+  __m128i iHorDelU = _mm_sub_epi32 (iCol0, iCol2);
+  __m128i iHorSumD = _mm_add_epi32 (iCol1, _mm_srai_epi32 (iCol3, 1));
+  __m128i iHorDelD = _mm_sub_epi32 (_mm_srai_epi32 (iCol1, 1), iCol3);
+  __m128i iTemp0 = _mm_add_epi32 (iHorSumU, iHorSumD);
+  __m128i iTemp1 = _mm_add_epi32 (iHorDelU, iHorDelD);
+  __m128i iTemp2 = _mm_sub_epi32 (iHorDelU, iHorDelD);
+  __m128i iTemp3 = _mm_sub_epi32 (iHorSumU, iHorSumD);
+  iTemp0 = _mm_srai_epi32 (_mm_slli_epi32 (iTemp0, 16), 16);
+  iTemp1 = _mm_srai_epi32 (_mm_slli_epi32 (iTemp1, 16), 16);
+  iTemp2 = _mm_srai_epi32 (_mm_slli_epi32 (iTemp2, 16), 16);
+  iTemp3 = _mm_srai_epi32 (_mm_slli_epi32 (iTemp3, 16), 16);
+  // vertical pass, each vector holds one row
+  Transpose4x4Epi32 (iTemp0, iTemp1, iTemp2, iTemp3);
+  __m128i iVerSumL = _mm_add_epi32 (iTemp0, iTemp2);
+  __m128i iVerDelL = _mm_sub_epi32 (iTemp0, iTemp2);
+  __m128i iVerDelR = _mm_sub_epi32 (_mm_srai_epi32 (iTemp1, 1), iTemp3);
+  __m128i iVerSumR = _mm_add_epi32 (iTemp1, _mm_srai_epi32 (iTemp3, 1));
+  const __m128i kRound = _mm_set1_epi32 (32);
+  __m128i iRow0 = _mm_srai_epi32 (_mm_add_epi32 (_mm_add_epi32 (iVerSumL, iVerSumR), kRound), 6);
+  __m128i iRow1 = _mm_srai_epi32 (_mm_add_epi32 (_mm_add_epi32 (iVerDelL, iVerDelR), kRound), 6);
+  __m128i iRow2 = _mm_srai_epi32 (_mm_add_epi32 (_mm_sub_epi32 (iVerDelL, iVerDelR), kRound), 6);
+  __m128i iRow3 = _mm_srai_epi32 (_mm_add_epi32 (_mm_sub_epi32 (iVerSumL, iVerSumR), kRound), 6);
+  iRow0 = _mm_add_epi32 (iRow0, LoadPred4 (pPred));
+  iRow1 = _mm_add_epi32 (iRow1, LoadPred4 (pPred + iPredStride));
+  iRow2 = _mm_add_epi32 (iRow2, LoadPred4 (pPred + 2 * iPredStride));
+  iRow3 = _mm_add_epi32 (iRow3, LoadPred4 (pPred + 3 * iPredStride));
+  // saturating to 16 bits first keeps the clip to [0, 255] exact
+  __m128i iRec = _mm_packus_epi16 (_mm_packs_epi32 (iRow0, iRow1), _mm_packs_epi32 (iRow2, iRow3));
+  ST32 (pRec, _mm_cvtsi128_si32 (iRec));
+  ST32 (pRec + iStride, _mm_cvtsi128_si32 (_mm_srli_si128 (iRec, 4)));
+  ST32 (pRec + 2 * iStride, _mm_cvtsi128_si32 (_mm_srli_si128 (iRec, 8)));
+  ST32 (pRec + 3 * iStride, _mm_cvtsi128_si32 (_mm_srli_si128 (iRec, 12)));
+}
+
+void WelsIDctFourT4Rec_sse2 (uint8_t* pRec, int32_t iStride, uint8_t* pPred, int32_t iPredStride, int16_t* pDct) {
+  int32_t iDstStridex4  = iStride << 2;
+  int32_t iPredStridex4 = iPredStride << 2;
+  WelsIDctT4Rec_sse2 (pRec,                    iStride, pPred,                     iPredStride, pDct);
+  WelsIDctT4Rec_sse2 (&pRec[4],                iStride, &pPred[4],                 iPredStride, pDct + 16);
+  WelsIDctT4Rec_sse2 (&pRec[iDstStridex4    ], iStride, &pPred[iPredStridex4  ],   iPredStride, pDct + 32);
+  WelsIDctT4Rec_sse2 (&pRec[iDstStridex4 + 4], iStride, &pPred[iPredStridex4 + 4], iPredStride, pDct + 48);
+}
+
+} // namespace WelsEnc
+
+#endif //X86_INTRINSICS
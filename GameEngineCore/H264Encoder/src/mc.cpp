@@ -1696,6 +1696,17 @@ void WelsCommon::InitMcFunc (SMcFunc* pMcFuncs, uint32_t uiCpuFlag) {
 #endif
 #endif //(X86_ASM)
 
+#if defined(X86_INTRINSICS)
+  if (uiCpuFlag & WELS_CPU_SSE2) {
+    pMcFuncs->pfLumaHalfpelHor  = McHorVer20_sse2;
+    pMcFuncs->pfLumaHalfpelVer  = McHorVer02_sse2;
+    pMcFuncs->pfLumaHalfpelCen  = McHorVer22_sse2;
+    pMcFuncs->pfSampleAveraging = PixelAvg_sse2;
+    pMcFuncs->pMcChromaFunc     = McChroma_sse2;
+    pMcFuncs->pMcLumaFunc       = McLuma_sse2;
+  }
+#endif //(X86_INTRINSICS)
+
 #if defined(HAVE_NEON)
   if (uiCpuFlag & WELS_CPU_NEON) {
     pMcFuncs->pMcLumaFunc       = McLuma_neon;
@@ -0,0 +1,350 @@
+/*!
+ *************************************************************************************
+ * \file    mc_x86.cpp
+ *
+ * \brief   Luma and chroma motion compensation written with SSE2 intrinsics, used when
+ *          the assembly kernels are not built. The results are identical to the C functions.
+ *
+ *************************************************************************************
+ */
+
+#include "mc.h"
+#include "ls_defines.h"
+
+#if defined(X86_INTRINSICS)
+
+#include <emmintrin.h>
+
+namespace {
+
+typedef void (*PWelsMcWidthHeightFunc) (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride,
+                                        int32_t iWidth, int32_t iHeight);
+
+inline __m128i Load8To16 (const uint8_t* pSrc) {
+  return _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)pSrc), _mm_setzero_si128());
+}
+
+inline __m128i Load4To16 (const uint8_t* pSrc) {
+  return _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (LD32 (pSrc)), _mm_setzero_si128());
+}
+
+inline uint8_t Clip1 (int32_t iValue) {
+  return (uint8_t) (iValue < 0 ? 0 : (iValue > 255 ? 255 : iValue));
+}
+
+// p0 + p5 - 5 * (p1 + p4) + 20 * (p2 + p3), which stays in [-2550, 10710] for 8 bit samples
+inline __m128i SixTap (__m128i iP0, __m128i iP1, __m128i iP2, __m128i iP3, __m128i iP4, __m128i iP5) {
+  __m128i iPix05 = _mm_add_epi16 (iP0, iP5);
+  __m128i iPix14 = _mm_add_epi16 (iP1, iP4);
+  __m128i iPix23 = _mm_add_epi16 (iP2, iP3);
+  iPix05 = _mm_sub_epi16 (iPix05, _mm_add_epi16 (_mm_slli_epi16 (iPix14, 2), iPix14));
+  return _mm_add_epi16 (iPix05, _mm_add_epi16 (_mm_slli_epi16 (iPix23, 4), _mm_slli_epi16 (iPix23, 2)));
+}
+
+// six tap filter of 8 samples around pSrc, the taps are kiOffset apart
+inline __m128i SixTap8 (const uint8_t* pSrc, const int32_t kiOffset) {
+  return SixTap (Load8To16 (pSrc - 2 * kiOffset), Load8To16 (pSrc - kiOffset), Load8To16 (pSrc),
+                 Load8To16 (pSrc + kiOffset), Load8To16 (pSrc + 2 * kiOffset), Load8To16 (pSrc + 3 * kiOffset));
+}
+
+inline __m128i SixTap4 (const uint8_t* pSrc, const int32_t kiOffset) {
+  return SixTap (Load4To16 (pSrc - 2 * kiOffset), Load4To16 (pSrc - kiOffset), Load4To16 (pSrc),
+                 Load4To16 (pSrc + kiOffset), Load4To16 (pSrc + 2 * kiOffset), Load4To16 (pSrc + 3 * kiOffset));
+}
+
+inline int32_t SixTap1 (const uint8_t* pSrc, const int32_t kiOffset) {
+  return pSrc[-2 * kiOffset] + pSrc[3 * kiOffset] - 5 * (pSrc[-kiOffset] + pSrc[2 * kiOffset])
+         + 20 * (pSrc[0] + pSrc[kiOffset]);
+}
+
+inline __m128i RoundHalfpel (__m128i iFilter) {
+  __m128i iResult = _mm_srai_epi16 (_mm_add_epi16 (iFilter, _mm_set1_epi16 (16)), 5);
+  return _mm_packus_epi16 (iResult, iResult);
+}
+
+// filters one row of half samples, horizontally with kiOffset == 1 or vertically with kiOffset == stride
+inline void HalfpelRow (const uint8_t* pSrc, const int32_t kiOffset, uint8_t* pDst, int32_t iWidth) {
+  int32_t j = 0;
+  for (; j + 8 <= iWidth; j += 8)
+    _mm_storel_epi64 ((__m128i*) (pDst + j), RoundHalfpel (SixTap8 (pSrc + j, kiOffset)));
+  if (j + 4 <= iWidth) {
+    ST32 (pDst + j, _mm_cvtsi128_si32 (RoundHalfpel (SixTap4 (pSrc + j, kiOffset))));
+    j += 4;
+  }
+  for (; j < iWidth; j++)
+    pDst[j] = Clip1 ((SixTap1 (pSrc + j, kiOffset) + 16) >> 5);
+}
+
+// second pass of the center half sample on the vertically filtered 16 bit taps, computed in 32 bits
+inline __m128i HorFilterTaps (const int16_t* pTap, int32_t iCount) {
+  __m128i iTap[6];
+  for (int32_t k = 0; k < 6; k++)
+    iTap[k] = iCount == 8 ? _mm_loadu_si128 ((const __m128i*) (pTap + k)) : _mm_loadl_epi64 ((const __m128i*) (pTap + k));
+  // the pair sums fit in 16 bits, the weighted sum does not
+  __m128i iPix05 = _mm_add_epi16 (iTap[0], iTap[5]);
+  __m128i iPix14 = _mm_add_epi16 (iTap[1], iTap[4]);
+  __m128i iPix23 = _mm_add_epi16 (iTap[2], iTap[3]);
+  const __m128i kiCoef0514 = _mm_set_epi16 (-5, 1, -5, 1, -5, 1, -5, 1);
+  const __m128i kiCoef23 = _mm_set1_epi16 (20);
+  const __m128i kiZero = _mm_setzero_si128();
+  const __m128i kiRound = _mm_set1_epi32 (512);
+  __m128i iLow = _mm_add_epi32 (_mm_madd_epi16 (_mm_unpacklo_epi16 (iPix05, iPix14), kiCoef0514),
+                                _mm_madd_epi16 (_mm_unpacklo_epi16 (iPix23, kiZero), kiCoef23));
+  __m128i iHigh = _mm_add_epi32 (_mm_madd_epi16 (_mm_unpackhi_epi16 (iPix05, iPix14), kiCoef0514),
+                                 _mm_madd_epi16 (_mm_unpackhi_epi16 (iPix23, kiZero), kiCoef23));
+  iLow = _mm_srai_epi32 (_mm_add_epi32 (iLow, kiRound), 10);
+  iHigh = _mm_srai_epi32 (_mm_add_epi32 (iHigh, kiRound), 10);
+  __m128i iResult = _mm_packs_epi32 (iLow, iHigh);
+  return _mm_packus_epi16 (iResult, iResult);
+}
+
+inline void PixelAvgRow (uint8_t* pDst, const uint8_t* pSrcA, const uint8_t* pSrcB, int32_t iWidth) {
+  int32_t j = 0;
+  for (; j + 16 <= iWidth; j += 16)
+    _mm_storeu_si128 ((__m128i*) (pDst + j), _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i*) (pSrcA + j)),
+                      _mm_loadu_si128 ((const __m128i*) (pSrcB + j))));
+  if (j + 8 <= iWidth) {
+    _mm_storel_epi64 ((__m128i*) (pDst + j), _mm_avg_epu8 (_mm_loadl_epi64 ((const __m128i*) (pSrcA + j)),
+                      _mm_loadl_epi64 ((const __m128i*) (pSrcB + j))));
+    j += 8;
+  }
+  if (j + 4 <= iWidth) {
+    ST32 (pDst + j, _mm_cvtsi128_si32 (_mm_avg_epu8 (_mm_cvtsi32_si128 (LD32 (pSrcA + j)),
+                                       _mm_cvtsi32_si128 (LD32 (pSrcB + j)))));
+    j += 4;
+  }
+  for (; j < iWidth; j++)
+    pDst[j] = (pSrcA[j] + pSrcB[j] + 1) >> 1;
+}
+
+// the weighted sum is at most 64 * 255 + 32 and fits in 16 bits
+inline __m128i ChromaBilinear (__m128i iP00, __m128i iP01, __m128i iP10, __m128i iP11, __m128i iWeightA,
+                               __m128i iWeightB, __m128i iWeightC, __m128i iWeightD) {
+  __m128i iSum = _mm_add_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (iP00, iWeightA), _mm_mullo_epi16 (iP01, iWeightB)),
+                                _mm_add_epi16 (_mm_mullo_epi16 (iP10, iWeightC), _mm_mullo_epi16 (iP11, iWeightD)));
+  iSum = _mm_srli_epi16 (_mm_add_epi16 (iSum, _mm_set1_epi16 (32)), 6);
+  return _mm_packus_epi16 (iSum, iSum);
+}
+
+/////////////////////luma MC//////////////////////////
+void McHorVer01_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiTmp[256];
+  McHorVer02_sse2 (pSrc, iSrcStride, uiTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, pSrc, iSrcStride, uiTmp, 16, iWidth, iHeight);
+}
+void McHorVer03_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiTmp[256];
+  McHorVer02_sse2 (pSrc, iSrcStride, uiTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, pSrc + iSrcStride, iSrcStride, uiTmp, 16, iWidth, iHeight);
+}
+void McHorVer10_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiTmp[256];
+  McHorVer20_sse2 (pSrc, iSrcStride, uiTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, pSrc, iSrcStride, uiTmp, 16, iWidth, iHeight);
+}
+void McHorVer11_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  uint8_t uiVerTmp[256];
+  McHorVer20_sse2 (pSrc, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  McHorVer02_sse2 (pSrc, iSrcStride, uiVerTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiHorTmp, 16, uiVerTmp, 16, iWidth, iHeight);
+}
+void McHorVer12_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiVerTmp[256];
+  uint8_t uiCtrTmp[256];
+  McHorVer02_sse2 (pSrc, iSrcStride, uiVerTmp, 16, iWidth, iHeight);
+  McHorVer22_sse2 (pSrc, iSrcStride, uiCtrTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiVerTmp, 16, uiCtrTmp, 16, iWidth, iHeight);
+}
+void McHorVer13_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  uint8_t uiVerTmp[256];
+  McHorVer20_sse2 (pSrc + iSrcStride, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  McHorVer02_sse2 (pSrc, iSrcStride, uiVerTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiHorTmp, 16, uiVerTmp, 16, iWidth, iHeight);
+}
+void McHorVer21_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  uint8_t uiCtrTmp[256];
+  McHorVer20_sse2 (pSrc, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  McHorVer22_sse2 (pSrc, iSrcStride, uiCtrTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiHorTmp, 16, uiCtrTmp, 16, iWidth, iHeight);
+}
+void McHorVer23_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  uint8_t uiCtrTmp[256];
+  McHorVer20_sse2 (pSrc + iSrcStride, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  McHorVer22_sse2 (pSrc, iSrcStride, uiCtrTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiHorTmp, 16, uiCtrTmp, 16, iWidth, iHeight);
+}
+void McHorVer30_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  McHorVer20_sse2 (pSrc, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, pSrc + 1, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+}
+void McHorVer31_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  uint8_t uiVerTmp[256];
+  McHorVer20_sse2 (pSrc, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  McHorVer02_sse2 (pSrc + 1, iSrcStride, uiVerTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiHorTmp, 16, uiVerTmp, 16, iWidth, iHeight);
+}
+void McHorVer32_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiVerTmp[256];
+  uint8_t uiCtrTmp[256];
+  McHorVer02_sse2 (pSrc + 1, iSrcStride, uiVerTmp, 16, iWidth, iHeight);
+  McHorVer22_sse2 (pSrc, iSrcStride, uiCtrTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiVerTmp, 16, uiCtrTmp, 16, iWidth, iHeight);
+}
+void McHorVer33_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  uint8_t uiHorTmp[256];
+  uint8_t uiVerTmp[256];
+  McHorVer20_sse2 (pSrc + iSrcStride, iSrcStride, uiHorTmp, 16, iWidth, iHeight);
+  McHorVer02_sse2 (pSrc + 1, iSrcStride, uiVerTmp, 16, iWidth, iHeight);
+  PixelAvg_sse2 (pDst, iDstStride, uiHorTmp, 16, uiVerTmp, 16, iWidth, iHeight);
+}
+
+} // anon ns.
+
+void McCopy_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                  int32_t iHeight) {
+  for (int32_t i = 0; i < iHeight; i++) {
+    int32_t j = 0;
+    for (; j + 16 <= iWidth; j += 16)
+      _mm_storeu_si128 ((__m128i*) (pDst + j), _mm_loadu_si128 ((const __m128i*) (pSrc + j)));
+    if (j + 8 <= iWidth) {
+      _mm_storel_epi64 ((__m128i*) (pDst + j), _mm_loadl_epi64 ((const __m128i*) (pSrc + j)));
+      j += 8;
+    }
+    if (j + 4 <= iWidth) {
+      ST32 (pDst + j, LD32 (pSrc + j));
+      j += 4;
+    }
+    for (; j < iWidth; j++)
+      pDst[j] = pSrc[j];
+    pDst += iDstStride;
+    pSrc += iSrcStride;
+  }
+}
+
+//horizontal filter to gain half sample, that is (2, 0) location in quarter sample
+void McHorVer20_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  for (int32_t i = 0; i < iHeight; i++) {
+    HalfpelRow (pSrc, 1, pDst, iWidth);
+    pDst += iDstStride;
+    pSrc += iSrcStride;
+  }
+}
+
+//vertical filter to gain half sample, that is (0, 2) location in quarter sample
+void McHorVer02_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  for (int32_t i = 0; i < iHeight; i++) {
+    HalfpelRow (pSrc, iSrcStride, pDst, iWidth);
+    pDst += iDstStride;
+    pSrc += iSrcStride;
+  }
+}
+
+//horizontal and vertical filter to gain half sample, that is (2, 2) location in quarter sample
+void McHorVer22_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride, int32_t iWidth,
+                      int32_t iHeight) {
+  int16_t iTap[17 + 5];
+  for (int32_t i = 0; i < iHeight; i++) {
+    // vertical taps of the row, starting two samples left of the first output
+    const uint8_t* pTapSrc = pSrc - 2;
+    int32_t iTapCount = iWidth + 5, j = 0;
+    for (; j + 8 <= iTapCount; j += 8)
+      _mm_storeu_si128 ((__m128i*) (iTap + j), SixTap8 (pTapSrc + j, iSrcStride));
+    if (j + 4 <= iTapCount) {
+      _mm_storel_epi64 ((__m128i*) (iTap + j), SixTap4 (pTapSrc + j, iSrcStride));
+      j += 4;
+    }
+    for (; j < iTapCount; j++)
+      iTap[j] = SixTap1 (pTapSrc + j, iSrcStride);
+
+    j = 0;
+    for (; j + 8 <= iWidth; j += 8)
+      _mm_storel_epi64 ((__m128i*) (pDst + j), HorFilterTaps (iTap + j, 8));
+    if (j + 4 <= iWidth) {
+      ST32 (pDst + j, _mm_cvtsi128_si32 (HorFilterTaps (iTap + j, 4)));
+      j += 4;
+    }
+    for (; j < iWidth; j++) {
+      const int16_t* pTap = iTap + j;
+      pDst[j] = Clip1 ((pTap[0] + pTap[5] - 5 * (pTap[1] + pTap[4]) + 20 * (pTap[2] + pTap[3]) + 512) >> 10);
+    }
+    pSrc += iSrcStride;
+    pDst += iDstStride;
+  }
+}
+
+void PixelAvg_sse2 (uint8_t* pDst, int32_t iDstStride, const uint8_t* pSrcA, int32_t iSrcAStride,
+                    const uint8_t* pSrcB, int32_t iSrcBStride, int32_t iWidth, int32_t iHeight) {
+  for (int32_t i = 0; i < iHeight; i++) {
+    PixelAvgRow (pDst, pSrcA, pSrcB, iWidth);
+    pDst  += iDstStride;
+    pSrcA += iSrcAStride;
+    pSrcB += iSrcBStride;
+  }
+}
+
+void McLuma_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride,
+                  int16_t iMvX, int16_t iMvY, int32_t iWidth, int32_t iHeight) {
+  static const PWelsMcWidthHeightFunc pWelsMcFunc[4][4] = { //[x][y]
+    {McCopy_sse2,     McHorVer01_sse2, McHorVer02_sse2, McHorVer03_sse2},
+    {McHorVer10_sse2, McHorVer11_sse2, McHorVer12_sse2, McHorVer13_sse2},
+    {McHorVer20_sse2, McHorVer21_sse2, McHorVer22_sse2, McHorVer23_sse2},
+    {McHorVer30_sse2, McHorVer31_sse2, McHorVer32_sse2, McHorVer33_sse2},
+  };
+
+  pWelsMcFunc[iMvX & 0x03][iMvY & 0x03] (pSrc, iSrcStride, pDst, iDstStride, iWidth, iHeight);
+}
+
+void McChroma_sse2 (const uint8_t* pSrc, int32_t iSrcStride, uint8_t* pDst, int32_t iDstStride,
+                    int16_t iMvX, int16_t iMvY, int32_t iWidth, int32_t iHeight) {
+  const int32_t kiD8x = iMvX & 0x07;
+  const int32_t kiD8y = iMvY & 0x07;
+  if (0 == kiD8x && 0 == kiD8y) {
+    McCopy_sse2 (pSrc, iSrcStride, pDst, iDstStride, iWidth, iHeight);
+    return;
+  }
+  const int32_t kiA = (8 - kiD8x) * (8 - kiD8y);
+  const int32_t kiB = kiD8x * (8 - kiD8y);
+  const int32_t kiC = (8 - kiD8x) * kiD8y;
+  const int32_t kiD = kiD8x * kiD8y;
+  const __m128i kiWeightA = _mm_set1_epi16 (kiA), kiWeightB = _mm_set1_epi16 (kiB);
+  const __m128i kiWeightC = _mm_set1_epi16 (kiC), kiWeightD = _mm_set1_epi16 (kiD);
+  const uint8_t* pSrcNext = pSrc + iSrcStride;
+  for (int32_t i = 0; i < iHeight; i++) {
+    int32_t j = 0;
+    for (; j + 8 <= iWidth; j += 8)
+      _mm_storel_epi64 ((__m128i*) (pDst + j), ChromaBilinear (Load8To16 (pSrc + j), Load8To16 (pSrc + j + 1),
+                        Load8To16 (pSrcNext + j), Load8To16 (pSrcNext + j + 1), kiWeightA, kiWeightB, kiWeightC, kiWeightD));
+    if (j + 4 <= iWidth) {
+      ST32 (pDst + j, _mm_cvtsi128_si32 (ChromaBilinear (Load4To16 (pSrc + j), Load4To16 (pSrc + j + 1),
+                                         Load4To16 (pSrcNext + j), Load4To16 (pSrcNext + j + 1), kiWeightA, kiWeightB, kiWeightC, kiWeightD)));
+      j += 4;
+    }
+    for (; j < iWidth; j++)
+      pDst[j] = (kiA * pSrc[j] + kiB * pSrc[j + 1] + kiC * pSrcNext[j] + kiD * pSrcNext[j + 1] + 32) >> 6;
+    pDst     += iDstStride;
+    pSrc      = pSrcNext;
+    pSrcNext += iSrcStride;
+  }
+}
+
+#endif //X86_INTRINSICS
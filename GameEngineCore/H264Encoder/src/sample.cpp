@@ -414,6 +414,35 @@ void WelsInitSampleSadFunc (SWelsFuncPtrList* pFuncList, uint32_t uiCpuFlag) {
 #endif
 #endif //(X86_ASM)
 
+#if defined(X86_INTRINSICS)
+  if (uiCpuFlag & WELS_CPU_SSE2) {
+    pFuncList->sSampleDealingFuncs.pfSampleSad[BLOCK_16x16] = WelsSampleSad16x16_sse2;
+    pFuncList->sSampleDealingFuncs.pfSampleSad[BLOCK_16x8 ] = WelsSampleSad16x8_sse2;
+    pFuncList->sSampleDealingFuncs.pfSampleSad[BLOCK_8x16 ] = WelsSampleSad8x16_sse2;
+    pFuncList->sSampleDealingFuncs.pfSampleSad[BLOCK_8x8  ] = WelsSampleSad8x8_sse2;
+    pFuncList->sSampleDealingFuncs.pfSampleSad[BLOCK_4x4  ] = WelsSampleSad4x4_sse2;
+
+    pFuncList->sSampleDealingFuncs.pfSample4Sad[BLOCK_16x16] = WelsSampleSadFour16x16_sse2;
+    pFuncList->sSampleDealingFuncs.pfSample4Sad[BLOCK_16x8 ] = WelsSampleSadFour16x8_sse2;
+    pFuncList->sSampleDealingFuncs.pfSample4Sad[BLOCK_8x16 ] = WelsSampleSadFour8x16_sse2;
+    pFuncList->sSampleDealingFuncs.pfSample4Sad[BLOCK_8x8  ] = WelsSampleSadFour8x8_sse2;
+    pFuncList->sSampleDealingFuncs.pfSample4Sad[BLOCK_4x4  ] = WelsSampleSadFour4x4_sse2;
+  }
+  if (uiCpuFlag & WELS_CPU_SSSE3) {
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_4x4  ] = WelsSampleSatd4x4_ssse3;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_8x8  ] = WelsSampleSatd8x8_ssse3;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_16x8 ] = WelsSampleSatd16x8_ssse3;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_8x16 ] = WelsSampleSatd8x16_ssse3;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_16x16] = WelsSampleSatd16x16_ssse3;
+  }
+  if (uiCpuFlag & WELS_CPU_AVX2) {
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_16x16] = WelsSampleSatd16x16_avx2;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_16x8 ] = WelsSampleSatd16x8_avx2;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_8x16 ] = WelsSampleSatd8x16_avx2;
+    pFuncList->sSampleDealingFuncs.pfSampleSatd[BLOCK_8x8  ] = WelsSampleSatd8x8_avx2;
+  }
+#endif //(X86_INTRINSICS)
+
 #if defined (HAVE_NEON)
   if (uiCpuFlag & WELS_CPU_NEON) {
     pFuncList->sSampleDealingFuncs.pfSampleSad[BLOCK_4x4  ] = WelsSampleSad4x4_neon;
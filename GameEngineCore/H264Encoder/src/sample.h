@@ -35,6 +35,7 @@
 
 #include "typedefs.h"
 #include "wels_func_ptr_def.h"
+#include "cpu_core.h"
 
 namespace WelsEnc {
 
@@ -89,6 +90,21 @@ int32_t WelsSampleSatd16x16_avx2 (uint8_t*, int32_t, uint8_t*, int32_t);
 
 #endif//X86_ASM
 
+#if defined (X86_INTRINSICS)
+
+int32_t WelsSampleSatd4x4_ssse3 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd8x8_ssse3 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd16x8_ssse3 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd8x16_ssse3 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd16x16_ssse3 (uint8_t*, int32_t, uint8_t*, int32_t);
+
+int32_t WelsSampleSatd8x8_avx2 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd8x16_avx2 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd16x8_avx2 (uint8_t*, int32_t, uint8_t*, int32_t);
+int32_t WelsSampleSatd16x16_avx2 (uint8_t*, int32_t, uint8_t*, int32_t);
+
+#endif//X86_INTRINSICS
+
 #if defined (HAVE_NEON)
 
 
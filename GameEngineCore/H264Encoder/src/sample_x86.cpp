@@ -0,0 +1,388 @@
+/*!
+ *************************************************************************************
+ * \file    sample_x86.cpp
+ *
+ * \brief   SAD and SATD kernels written with SSE2/SSSE3/AVX2 intrinsics, used when the
+ *          assembly kernels are not built. The results are identical to the C functions.
+ *
+ *************************************************************************************
+ */
+
+#include "sad_common.h"
+#include "sample.h"
+#include "ls_defines.h"
+
+#if defined(X86_INTRINSICS)
+
+#include <immintrin.h>
+
+//***************************************************************************//
+//                       SAD                                                 //
+//***************************************************************************//
+namespace {
+
+inline __m128i Load8x2 (const uint8_t* pRow0, const uint8_t* pRow1) {
+  return _mm_unpacklo_epi64 (_mm_loadl_epi64 ((const __m128i*)pRow0), _mm_loadl_epi64 ((const __m128i*)pRow1));
+}
+
+inline __m128i Load4x4 (const uint8_t* pSample, int32_t iStride) {
+  __m128i iRow01 = _mm_unpacklo_epi32 (_mm_cvtsi32_si128 (LD32 (pSample)), _mm_cvtsi32_si128 (LD32 (pSample + iStride)));
+  __m128i iRow23 = _mm_unpacklo_epi32 (_mm_cvtsi32_si128 (LD32 (pSample + 2 * iStride)),
+                                       _mm_cvtsi32_si128 (LD32 (pSample + 3 * iStride)));
+  return _mm_unpacklo_epi64 (iRow01, iRow23);
+}
+
+inline int32_t SumSad (__m128i iSad) {
+  return _mm_cvtsi128_si32 (_mm_add_epi32 (iSad, _mm_srli_si128 (iSad, 8)));
+}
+
+inline int32_t SampleSad16xN (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2, int32_t iStride2,
+                              int32_t iHeight) {
+  __m128i iSad = _mm_setzero_si128();
+  for (int32_t i = 0; i < iHeight; i++) {
+    __m128i iRow1 = _mm_loadu_si128 ((const __m128i*)pSample1);
+    __m128i iRow2 = _mm_loadu_si128 ((const __m128i*)pSample2);
+    iSad = _mm_add_epi32 (iSad, _mm_sad_epu8 (iRow1, iRow2));
+    pSample1 += iStride1;
+    pSample2 += iStride2;
+  }
+  return SumSad (iSad);
+}
+
+inline int32_t SampleSad8xN (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2, int32_t iStride2,
+                             int32_t iHeight) {
+  __m128i iSad = _mm_setzero_si128();
+  for (int32_t i = 0; i < iHeight; i += 2) {
+    __m128i iRows1 = Load8x2 (pSample1, pSample1 + iStride1);
+    __m128i iRows2 = Load8x2 (pSample2, pSample2 + iStride2);
+    iSad = _mm_add_epi32 (iSad, _mm_sad_epu8 (iRows1, iRows2));
+    pSample1 += 2 * iStride1;
+    pSample2 += 2 * iStride2;
+  }
+  return SumSad (iSad);
+}
+
+// SADs against the reference moved up, down, left and right by one pixel, loading each source row once
+inline void SampleSadFour16xN (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2, int32_t iStride2,
+                               int32_t iHeight, int32_t* pSad) {
+  __m128i iSadUp = _mm_setzero_si128(), iSadDown = _mm_setzero_si128();
+  __m128i iSadLeft = _mm_setzero_si128(), iSadRight = _mm_setzero_si128();
+  for (int32_t i = 0; i < iHeight; i++) {
+    __m128i iRow = _mm_loadu_si128 ((const __m128i*)pSample1);
+    iSadUp = _mm_add_epi32 (iSadUp, _mm_sad_epu8 (iRow, _mm_loadu_si128 ((const __m128i*) (pSample2 - iStride2))));
+    iSadDown = _mm_add_epi32 (iSadDown, _mm_sad_epu8 (iRow, _mm_loadu_si128 ((const __m128i*) (pSample2 + iStride2))));
+    iSadLeft = _mm_add_epi32 (iSadLeft, _mm_sad_epu8 (iRow, _mm_loadu_si128 ((const __m128i*) (pSample2 - 1))));
+    iSadRight = _mm_add_epi32 (iSadRight, _mm_sad_epu8 (iRow, _mm_loadu_si128 ((const __m128i*) (pSample2 + 1))));
+    pSample1 += iStride1;
+    pSample2 += iStride2;
+  }
+  pSad[0] = SumSad (iSadUp);
+  pSad[1] = SumSad (iSadDown);
+  pSad[2] = SumSad (iSadLeft);
+  pSad[3] = SumSad (iSadRight);
+}
+
+inline void SampleSadFour8xN (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2, int32_t iStride2,
+                              int32_t iHeight, int32_t* pSad) {
+  __m128i iSadUp = _mm_setzero_si128(), iSadDown = _mm_setzero_si128();
+  __m128i iSadLeft = _mm_setzero_si128(), iSadRight = _mm_setzero_si128();
+  for (int32_t i = 0; i < iHeight; i += 2) {
+    __m128i iRows = Load8x2 (pSample1, pSample1 + iStride1);
+    iSadUp = _mm_add_epi32 (iSadUp, _mm_sad_epu8 (iRows, Load8x2 (pSample2 - iStride2, pSample2)));
+    iSadDown = _mm_add_epi32 (iSadDown, _mm_sad_epu8 (iRows, Load8x2 (pSample2 + iStride2,
+                              pSample2 + 2 * iStride2)));
+    iSadLeft = _mm_add_epi32 (iSadLeft, _mm_sad_epu8 (iRows, Load8x2 (pSample2 - 1, pSample2 + iStride2 - 1)));
+    iSadRight = _mm_add_epi32 (iSadRight, _mm_sad_epu8 (iRows, Load8x2 (pSample2 + 1, pSample2 + iStride2 + 1)));
+    pSample1 += 2 * iStride1;
+    pSample2 += 2 * iStride2;
+  }
+  pSad[0] = SumSad (iSadUp);
+  pSad[1] = SumSad (iSadDown);
+  pSad[2] = SumSad (iSadLeft);
+  pSad[3] = SumSad (iSadRight);
+}
+
+} // anon ns.
+
+int32_t WelsSampleSad4x4_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2) {
+  return SumSad (_mm_sad_epu8 (Load4x4 (pSample1, iStride1), Load4x4 (pSample2, iStride2)));
+}
+
+int32_t WelsSampleSad8x8_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2) {
+  return SampleSad8xN (pSample1, iStride1, pSample2, iStride2, 8);
+}
+
+int32_t WelsSampleSad8x16_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2) {
+  return SampleSad8xN (pSample1, iStride1, pSample2, iStride2, 16);
+}
+
+int32_t WelsSampleSad16x8_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2) {
+  return SampleSad16xN (pSample1, iStride1, pSample2, iStride2, 8);
+}
+
+int32_t WelsSampleSad16x16_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2) {
+  return SampleSad16xN (pSample1, iStride1, pSample2, iStride2, 16);
+}
+
+void WelsSampleSadFour4x4_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2,
+                                int32_t* pSad) {
+  __m128i iBlock = Load4x4 (pSample1, iStride1);
+  pSad[0] = SumSad (_mm_sad_epu8 (iBlock, Load4x4 (pSample2 - iStride2, iStride2)));
+  pSad[1] = SumSad (_mm_sad_epu8 (iBlock, Load4x4 (pSample2 + iStride2, iStride2)));
+  pSad[2] = SumSad (_mm_sad_epu8 (iBlock, Load4x4 (pSample2 - 1, iStride2)));
+  pSad[3] = SumSad (_mm_sad_epu8 (iBlock, Load4x4 (pSample2 + 1, iStride2)));
+}
+
+void WelsSampleSadFour8x8_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2,
+                                int32_t* pSad) {
+  SampleSadFour8xN (pSample1, iStride1, pSample2, iStride2, 8, pSad);
+}
+
+void WelsSampleSadFour8x16_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2,
+                                 int32_t* pSad) {
+  SampleSadFour8xN (pSample1, iStride1, pSample2, iStride2, 16, pSad);
+}
+
+void WelsSampleSadFour16x8_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2,
+                                 int32_t* pSad) {
+  SampleSadFour16xN (pSample1, iStride1, pSample2, iStride2, 8, pSad);
+}
+
+void WelsSampleSadFour16x16_sse2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2, int32_t iStride2,
+                                  int32_t* pSad) {
+  SampleSadFour16xN (pSample1, iStride1, pSample2, iStride2, 16, pSad);
+}
+
+//***************************************************************************//
+//                       SATD                                                //
+//***************************************************************************//
+// The 4x4 Hadamard transform is computed exactly in 16 bits, so transforming the columns before the rows
+// gives the same coefficients as the C code. Each vector holds one row of two adjacent 4x4 blocks,
+// every 4x4 sum is rounded on its own like WelsSampleSatd4x4_c does.
+namespace WelsEnc {
+namespace {
+
+inline __m128i LoadDiff8 (const uint8_t* pSample1, const uint8_t* pSample2) {
+  const __m128i kZero = _mm_setzero_si128();
+  return _mm_sub_epi16 (_mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)pSample1), kZero),
+                        _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)pSample2), kZero));
+}
+
+inline __m128i LoadDiff4 (const uint8_t* pSample1, const uint8_t* pSample2) {
+  const __m128i kZero = _mm_setzero_si128();
+  return _mm_sub_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (LD32 (pSample1)), kZero),
+                        _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (LD32 (pSample2)), kZero));
+}
+
+inline void Hadamard4 (__m128i& iRow0, __m128i& iRow1, __m128i& iRow2, __m128i& iRow3) {
+  __m128i iSum02 = _mm_add_epi16 (iRow0, iRow2);
+  __m128i iSum13 = _mm_add_epi16 (iRow1, iRow3);
+  __m128i iDiff02 = _mm_sub_epi16 (iRow0, iRow2);
+  __m128i iDiff13 = _mm_sub_epi16 (iRow1, iRow3);
+  iRow0 = _mm_add_epi16 (iSum02, iSum13);
+  iRow1 = _mm_add_epi16 (iDiff02, iDiff13);
+  iRow2 = _mm_sub_epi16 (iDiff02, iDiff13);
+  iRow3 = _mm_sub_epi16 (iSum02, iSum13);
+}
+
+// transposes the 4x4 blocks in the low and the high halves of the four rows
+inline void Transpose4x4Pairs (__m128i& iRow0, __m128i& iRow1, __m128i& iRow2, __m128i& iRow3) {
+  __m128i iLow01 = _mm_unpacklo_epi16 (iRow0, iRow1);
+  __m128i iHigh01 = _mm_unpackhi_epi16 (iRow0, iRow1);
+  __m128i iLow23 = _mm_unpacklo_epi16 (iRow2, iRow3);
+  __m128i iHigh23 = _mm_unpackhi_epi16 (iRow2, iRow3);
+  __m128i iLowCol01 = _mm_unpacklo_epi32 (iLow01, iLow23);
+  __m128i iLowCol23 = _mm_unpackhi_epi32 (iLow01, iLow23);
+  __m128i iHighCol01 = _mm_unpacklo_epi32 (iHigh01, iHigh23);
+  __m128i iHighCol23 = _mm_unpackhi_epi32 (iHigh01, iHigh23);
+  iRow0 = _mm_unpacklo_epi64 (iLowCol01, iHighCol01);
+  iRow1 = _mm_unpackhi_epi64 (iLowCol01, iHighCol01);
+  iRow2 = _mm_unpacklo_epi64 (iLowCol23, iHighCol23);
+  iRow3 = _mm_unpackhi_epi64 (iLowCol23, iHighCol23);
+}
+
+// returns the unrounded SATD of the left block in the lower, of the right block in the upper two 32 bit lanes
+WELS_TARGET_SSSE3 inline __m128i Satd8x4 (__m128i iRow0, __m128i iRow1, __m128i iRow2, __m128i iRow3) {
+  Hadamard4 (iRow0, iRow1, iRow2, iRow3);
+  Transpose4x4Pairs (iRow0, iRow1, iRow2, iRow3);
+  Hadamard4 (iRow0, iRow1, iRow2, iRow3);
+  __m128i iAbs = _mm_add_epi16 (_mm_add_epi16 (_mm_abs_epi16 (iRow0), _mm_abs_epi16 (iRow1)),
+                                _mm_add_epi16 (_mm_abs_epi16 (iRow2), _mm_abs_epi16 (iRow3)));
+  return _mm_madd_epi16 (iAbs, _mm_set1_epi16 (1));
+}
+
+WELS_TARGET_SSSE3 inline __m128i Satd8x4 (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2,
+    int32_t iStride2) {
+  return Satd8x4 (LoadDiff8 (pSample1, pSample2), LoadDiff8 (pSample1 + iStride1, pSample2 + iStride2),
+                  LoadDiff8 (pSample1 + 2 * iStride1, pSample2 + 2 * iStride2),
+                  LoadDiff8 (pSample1 + 3 * iStride1, pSample2 + 3 * iStride2));
+}
+
+// rounds the four 4x4 sums of two 8x4 strips
+WELS_TARGET_SSSE3 inline __m128i RoundSatd (__m128i iStrip0, __m128i iStrip1) {
+  return _mm_srai_epi32 (_mm_add_epi32 (_mm_hadd_epi32 (iStrip0, iStrip1), _mm_set1_epi32 (1)), 1);
+}
+
+inline int32_t SumLanes (__m128i iSum) {
+  iSum = _mm_add_epi32 (iSum, _mm_srli_si128 (iSum, 8));
+  return _mm_cvtsi128_si32 (_mm_add_epi32 (iSum, _mm_srli_si128 (iSum, 4)));
+}
+
+WELS_TARGET_SSSE3 inline int32_t SampleSatd_ssse3 (const uint8_t* pSample1, int32_t iStride1,
+    const uint8_t* pSample2, int32_t iStride2, int32_t iWidth, int32_t iHeight) {
+  __m128i iSum = _mm_setzero_si128();
+  for (int32_t i = 0; i < iHeight; i += 8) {
+    for (int32_t j = 0; j < iWidth; j += 8) {
+      __m128i iTop = Satd8x4 (pSample1 + j, iStride1, pSample2 + j, iStride2);
+      __m128i iBottom = Satd8x4 (pSample1 + 4 * iStride1 + j, iStride1, pSample2 + 4 * iStride2 + j, iStride2);
+      iSum = _mm_add_epi32 (iSum, RoundSatd (iTop, iBottom));
+    }
+    pSample1 += 8 * iStride1;
+    pSample2 += 8 * iStride2;
+  }
+  return SumLanes (iSum);
+}
+
+//***************************************************************************//
+//                       AVX2 SATD                                           //
+//***************************************************************************//
+// Each 128 bit lane works like the SSSE3 code, a vector covers four 4x4 blocks.
+WELS_TARGET_AVX2 inline __m256i LoadDiff16 (const uint8_t* pSample1, const uint8_t* pSample2) {
+  return _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i*)pSample1)),
+                           _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i*)pSample2)));
+}
+
+// eight pixels of a row in the low lane and of the row four lines below in the high lane
+WELS_TARGET_AVX2 inline __m256i LoadDiff8x2 (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2,
+    int32_t iStride2) {
+  return _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (Load8x2 (pSample1, pSample1 + 4 * iStride1)),
+                           _mm256_cvtepu8_epi16 (Load8x2 (pSample2, pSample2 + 4 * iStride2)));
+}
+
+WELS_TARGET_AVX2 inline void Hadamard4 (__m256i& iRow0, __m256i& iRow1, __m256i& iRow2, __m256i& iRow3) {
+  __m256i iSum02 = _mm256_add_epi16 (iRow0, iRow2);
+  __m256i iSum13 = _mm256_add_epi16 (iRow1, iRow3);
+  __m256i iDiff02 = _mm256_sub_epi16 (iRow0, iRow2);
+  __m256i iDiff13 = _mm256_sub_epi16 (iRow1, iRow3);
+  iRow0 = _mm256_add_epi16 (iSum02, iSum13);
+  iRow1 = _mm256_add_epi16 (iDiff02, iDiff13);
+  iRow2 = _mm256_sub_epi16 (iDiff02, iDiff13);
+  iRow3 = _mm256_sub_epi16 (iSum02, iSum13);
+}
+
+WELS_TARGET_AVX2 inline void Transpose4x4Pairs (__m256i& iRow0, __m256i& iRow1, __m256i& iRow2, __m256i& iRow3) {
+  __m256i iLow01 = _mm256_unpacklo_epi16 (iRow0, iRow1);
+  __m256i iHigh01 = _mm256_unpackhi_epi16 (iRow0, iRow1);
+  __m256i iLow23 = _mm256_unpacklo_epi16 (iRow2, iRow3);
+  __m256i iHigh23 = _mm256_unpackhi_epi16 (iRow2, iRow3);
+  __m256i iLowCol01 = _mm256_unpacklo_epi32 (iLow01, iLow23);
+  __m256i iLowCol23 = _mm256_unpackhi_epi32 (iLow01, iLow23);
+  __m256i iHighCol01 = _mm256_unpacklo_epi32 (iHigh01, iHigh23);
+  __m256i iHighCol23 = _mm256_unpackhi_epi32 (iHigh01, iHigh23);
+  iRow0 = _mm256_unpacklo_epi64 (iLowCol01, iHighCol01);
+  iRow1 = _mm256_unpackhi_epi64 (iLowCol01, iHighCol01);
+  iRow2 = _mm256_unpacklo_epi64 (iLowCol23, iHighCol23);
+  iRow3 = _mm256_unpackhi_epi64 (iLowCol23, iHighCol23);
+}
+
+WELS_TARGET_AVX2 inline __m256i Satd16x4 (__m256i iRow0, __m256i iRow1, __m256i iRow2, __m256i iRow3) {
+  Hadamard4 (iRow0, iRow1, iRow2, iRow3);
+  Transpose4x4Pairs (iRow0, iRow1, iRow2, iRow3);
+  Hadamard4 (iRow0, iRow1, iRow2, iRow3);
+  __m256i iAbs = _mm256_add_epi16 (_mm256_add_epi16 (_mm256_abs_epi16 (iRow0), _mm256_abs_epi16 (iRow1)),
+                                   _mm256_add_epi16 (_mm256_abs_epi16 (iRow2), _mm256_abs_epi16 (iRow3)));
+  return _mm256_madd_epi16 (iAbs, _mm256_set1_epi16 (1));
+}
+
+WELS_TARGET_AVX2 inline __m256i Satd16x4 (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2,
+    int32_t iStride2) {
+  return Satd16x4 (LoadDiff16 (pSample1, pSample2), LoadDiff16 (pSample1 + iStride1, pSample2 + iStride2),
+                   LoadDiff16 (pSample1 + 2 * iStride1, pSample2 + 2 * iStride2),
+                   LoadDiff16 (pSample1 + 3 * iStride1, pSample2 + 3 * iStride2));
+}
+
+WELS_TARGET_AVX2 inline __m256i Satd8x8 (const uint8_t* pSample1, int32_t iStride1, const uint8_t* pSample2,
+    int32_t iStride2) {
+  return Satd16x4 (LoadDiff8x2 (pSample1, iStride1, pSample2, iStride2),
+                   LoadDiff8x2 (pSample1 + iStride1, iStride1, pSample2 + iStride2, iStride2),
+                   LoadDiff8x2 (pSample1 + 2 * iStride1, iStride1, pSample2 + 2 * iStride2, iStride2),
+                   LoadDiff8x2 (pSample1 + 3 * iStride1, iStride1, pSample2 + 3 * iStride2, iStride2));
+}
+
+WELS_TARGET_AVX2 inline __m256i RoundSatd (__m256i iStrip0, __m256i iStrip1) {
+  return _mm256_srai_epi32 (_mm256_add_epi32 (_mm256_hadd_epi32 (iStrip0, iStrip1), _mm256_set1_epi32 (1)), 1);
+}
+
+WELS_TARGET_AVX2 inline int32_t SumLanes (__m256i iSum) {
+  return SumLanes (_mm_add_epi32 (_mm256_castsi256_si128 (iSum), _mm256_extracti128_si256 (iSum, 1)));
+}
+
+WELS_TARGET_AVX2 inline int32_t SampleSatd16xN_avx2 (const uint8_t* pSample1, int32_t iStride1,
+    const uint8_t* pSample2, int32_t iStride2, int32_t iHeight) {
+  __m256i iSum = _mm256_setzero_si256();
+  for (int32_t i = 0; i < iHeight; i += 8) {
+    __m256i iTop = Satd16x4 (pSample1, iStride1, pSample2, iStride2);
+    __m256i iBottom = Satd16x4 (pSample1 + 4 * iStride1, iStride1, pSample2 + 4 * iStride2, iStride2);
+    iSum = _mm256_add_epi32 (iSum, RoundSatd (iTop, iBottom));
+    pSample1 += 8 * iStride1;
+    pSample2 += 8 * iStride2;
+  }
+  return SumLanes (iSum);
+}
+
+} // anon ns.
+
+WELS_TARGET_SSSE3 int32_t WelsSampleSatd4x4_ssse3 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  // the right block of the strip is zero and adds nothing
+  __m128i iStrip = Satd8x4 (LoadDiff4 (pSample1, pSample2), LoadDiff4 (pSample1 + iStride1, pSample2 + iStride2),
+                            LoadDiff4 (pSample1 + 2 * iStride1, pSample2 + 2 * iStride2),
+                            LoadDiff4 (pSample1 + 3 * iStride1, pSample2 + 3 * iStride2));
+  return SumLanes (RoundSatd (iStrip, _mm_setzero_si128()));
+}
+
+WELS_TARGET_SSSE3 int32_t WelsSampleSatd8x8_ssse3 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SampleSatd_ssse3 (pSample1, iStride1, pSample2, iStride2, 8, 8);
+}
+
+WELS_TARGET_SSSE3 int32_t WelsSampleSatd16x8_ssse3 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SampleSatd_ssse3 (pSample1, iStride1, pSample2, iStride2, 16, 8);
+}
+
+WELS_TARGET_SSSE3 int32_t WelsSampleSatd8x16_ssse3 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SampleSatd_ssse3 (pSample1, iStride1, pSample2, iStride2, 8, 16);
+}
+
+WELS_TARGET_SSSE3 int32_t WelsSampleSatd16x16_ssse3 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SampleSatd_ssse3 (pSample1, iStride1, pSample2, iStride2, 16, 16);
+}
+
+WELS_TARGET_AVX2 int32_t WelsSampleSatd8x8_avx2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SumLanes (RoundSatd (Satd8x8 (pSample1, iStride1, pSample2, iStride2), _mm256_setzero_si256()));
+}
+
+WELS_TARGET_AVX2 int32_t WelsSampleSatd8x16_avx2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  __m256i iTop = Satd8x8 (pSample1, iStride1, pSample2, iStride2);
+  __m256i iBottom = Satd8x8 (pSample1 + 8 * iStride1, iStride1, pSample2 + 8 * iStride2, iStride2);
+  return SumLanes (RoundSatd (iTop, iBottom));
+}
+
+WELS_TARGET_AVX2 int32_t WelsSampleSatd16x8_avx2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SampleSatd16xN_avx2 (pSample1, iStride1, pSample2, iStride2, 8);
+}
+
+WELS_TARGET_AVX2 int32_t WelsSampleSatd16x16_avx2 (uint8_t* pSample1, int32_t iStride1, uint8_t* pSample2,
+    int32_t iStride2) {
+  return SampleSatd16xN_avx2 (pSample1, iStride1, pSample2, iStride2, 16);
+}
+
+} // namespace WelsEnc
+
+#endif //X86_INTRINSICS
@@ -897,6 +897,12 @@ namespace GameEngine
 		virtual Fence* CreateFence() = 0;
 		virtual Buffer* CreateBuffer(BufferUsage usage, int sizeInBytes, const BufferStructureInfo* structInfo = nullptr) = 0;
 		virtual Buffer* CreateMappedBuffer(BufferUsage usage, int sizeInBytes, const BufferStructureInfo* structInfo = nullptr) = 0;
+		// Creates a host readable buffer that can receive mip level 0 of a width x height texture through QueueTextureReadback.
+		// rowPitch receives the distance in bytes between two rows of texels in the buffer.
+		virtual Buffer* CreateReadbackBuffer(int width, int height, StorageFormat format, int & rowPitch) = 0;
+		// Records a copy of mip level 0 of srcImage into a buffer created by CreateReadbackBuffer as part of the current job
+		// submission. The buffer can be mapped once the fence passed to EndJobSubmission is signaled.
+		virtual void QueueTextureReadback(Buffer* dstBuffer, Texture2D* srcImage) = 0;
 		// Automatically builds mipmaps with supplied data
 		virtual Texture2D* CreateTexture2D(CoreLib::String name, int width, int height, StorageFormat format, DataType type, void* data) = 0;
 		// Allocates resources for a texture with supplied parameters
@@ -914,6 +920,9 @@ namespace GameEngine
 		virtual DescriptorSetLayout* CreateDescriptorSetLayout(CoreLib::ArrayView<DescriptorLayout> descriptors) = 0;
 		virtual DescriptorSet* CreateDescriptorSet(DescriptorSetLayout* layout) = 0;
 		virtual CommandBuffer* CreateCommandBuffer() = 0;
+		// Creates a secondary command buffer owned by job system thread `threadIndex`. Command buffers
+		// owned by different threads can be created and recorded concurrently.
+		virtual CommandBuffer* CreateThreadCommandBuffer(int threadIndex) = 0;
 		virtual TargetShadingLanguage GetShadingLanguage() = 0;
 		virtual int UniformBufferAlignment() = 0;
 		virtual int StorageBufferAlignment() = 0;
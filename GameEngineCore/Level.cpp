@@ -1,6 +1,7 @@
 #include "Engine.h"
 #include "Level.h"
 #include "CoreLib/LibIO.h"
+#include "CoreLib/JobSystem.h"
 #include "CoreLib/Tokenizer.h"
 #include "MeshBuilder.h"
 #include "CameraActor.h"
@@ -54,10 +55,22 @@ namespace GameEngine
         return sb.ProduceString();
     }
 
+    static bool IsCompiledLevelFile(const String & fileName)
+    {
+        return Path::GetFileExt(fileName).ToLower() == "clevel";
+    }
+
     Level::Level(const CoreLib::String & fileName)
     {
         FileName = fileName;
-        LoadFromText(File::ReadAllText(fileName));
+        if (IsCompiledLevelFile(fileName))
+        {
+            auto content = File::ReadAllBytes(fileName);
+            RefPtr<MemoryStream> stream = new MemoryStream(content.GetArrayView());
+            LoadFromBinary(stream.Ptr());
+        }
+        else
+            LoadFromText(File::ReadAllText(fileName));
     }
     void Level::LoadFromText(CoreLib::String text)
     {
@@ -156,8 +169,150 @@ namespace GameEngine
         }
         Print("Num materials: %d\n", Materials.Count());
     }
+    void Level::LoadFromBinary(CoreLib::IO::Stream * stream)
+    {
+        BinaryReader reader(stream);
+        try
+        {
+            auto readStrings = [&](List<String> & strings)
+            {
+                int count = reader.ReadInt32();
+                for (int i = 0; i < count; i++)
+                    strings.Add(reader.ReadString());
+            };
+            uint32_t identifier = reader.ReadInt32();
+            int version = reader.ReadInt32();
+            if (identifier != CompiledLevelIdentifier)
+                throw InvalidOperationException("Invalid compiled level file.");
+            if (version != CurrentCompiledLevelVersion)
+                throw InvalidOperationException("Unsupported compiled level file version.");
+            LightmapFileName = reader.ReadString();
+            readStrings(HiddenSections);
+            List<LevelAssetDependency> dependencies;
+            dependencies.SetSize(reader.ReadInt32());
+            for (auto & dependency : dependencies)
+            {
+                dependency.Type = (LevelAssetType)reader.ReadInt32();
+                dependency.FileName = reader.ReadString();
+            }
+            List<String> actorClasses, propertyNames;
+            readStrings(actorClasses);
+            readStrings(propertyNames);
+
+            PreloadAssets(dependencies.GetArrayView());
+
+            int actorCount = reader.ReadInt32();
+            for (int i = 0; i < actorCount; i++)
+            {
+                int classId = reader.ReadInt32();
+                int size = reader.ReadInt32();
+                auto recordEnd = stream->GetPosition() + size;
+                if (classId < 0 || classId >= actorClasses.Count() || size < 0)
+                    throw InvalidOperationException("Invalid compiled level file.");
+                auto & actorClass = actorClasses[classId];
+                ObjPtr<Actor> actor = Engine::Instance()->CreateActor(actorClass);
+                if (!actor)
+                {
+                    Print("Unknown actor class '%S', ignoring the object.\n", actorClass.ToWString());
+                    stream->Seek(SeekOrigin::Start, recordEnd);
+                    continue;
+                }
+                bool isInvalid = false;
+                actor->ParseBinary(this, reader, propertyNames.GetArrayView(), isInvalid);
+                stream->Seek(SeekOrigin::Start, recordEnd);
+                if (isInvalid)
+                {
+                    Print("Error loading actor '%S', ignoring the object.\n", actor->Name.GetValue().ToWString());
+                    continue;
+                }
+                try
+                {
+                    if (Actors.ContainsKey(actor->Name.GetValue()))
+                    {
+                        Print("error: an actor named '%S' already exists, ignoring second definition.\n",
+                            actor->Name.GetValue().ToWString());
+                    }
+                    else
+                    {
+                        RegisterActor(actor.Ptr());
+                        if (actor->GetEngineType() == EngineActorType::Camera)
+                            CurrentCamera = actor.As<CameraActor>();
+                    }
+                }
+                catch (Exception e)
+                {
+                    Print("OnLoad() error: an actor named '%S' failed to load, message: '%S'.\n", actor->Name.GetValue().ToWString(), e.Message.ToWString());
+                }
+            }
+        }
+        catch (...)
+        {
+            // the reader must not free the caller's stream
+            reader.ReleaseStream();
+            throw;
+        }
+        reader.ReleaseStream();
+        Print("Num materials: %d\n", Materials.Count());
+    }
+    void Level::SaveToBinary(CoreLib::IO::Stream * stream)
+    {
+        // actor records are written first to collect the class and property names they refer to
+        EnumerableDictionary<String, int> actorClasses, propertyNames;
+        RefPtr<MemoryStream> actorStream = new MemoryStream();
+        RefPtr<MemoryStream> recordStream = new MemoryStream();
+        BinaryWriter actorWriter(actorStream);
+        BinaryWriter recordWriter(recordStream);
+        for (auto & actor : Actors)
+        {
+            auto className = actor.Value->GetTypeName();
+            int classId = -1;
+            if (!actorClasses.TryGetValue(className, classId))
+            {
+                classId = actorClasses.Count();
+                actorClasses.Add(className, classId);
+            }
+            recordStream->Seek(SeekOrigin::Start, 0);
+            actor.Value->SerializeToBinary(recordWriter, propertyNames);
+            // records are prefixed with their size so that actors of unknown classes can be skipped
+            actorWriter.Write(classId);
+            actorWriter.Write(recordStream->GetBufferSize());
+            actorWriter.Write((unsigned char*)recordStream->GetBuffer(), recordStream->GetBufferSize());
+        }
+        auto dependencies = GetAssetDependencies();
+
+        BinaryWriter writer(stream);
+        writer.Write(CompiledLevelIdentifier);
+        writer.Write(CurrentCompiledLevelVersion);
+        writer.Write(LightmapFileName);
+        writer.Write(HiddenSections.Count());
+        for (auto & sect : HiddenSections)
+            writer.Write(sect);
+        writer.Write(dependencies.Count());
+        for (auto & dependency : dependencies)
+        {
+            writer.Write((int)dependency.Type);
+            writer.Write(dependency.FileName);
+        }
+        writer.Write(actorClasses.Count());
+        for (auto & actorClass : actorClasses)
+            writer.Write(actorClass.Key);
+        writer.Write(propertyNames.Count());
+        for (auto & propertyName : propertyNames)
+            writer.Write(propertyName.Key);
+        writer.Write(Actors.Count());
+        writer.Write((unsigned char*)actorStream->GetBuffer(), actorStream->GetBufferSize());
+        writer.ReleaseStream();
+    }
     void Level::SaveToFile(CoreLib::String fileName)
     {
+        if (IsCompiledLevelFile(fileName))
+        {
+            RefPtr<FileStream> stream = new FileStream(fileName, FileMode::Create);
+            SaveToBinary(stream.Ptr());
+            stream->Close();
+            FileName = fileName;
+            return;
+        }
         StringBuilder sb;
         if (LightmapFileName.Length())
             sb << "lightmap " << CoreLib::Text::EscapeStringLiteral(LightmapFileName) << "\n";
@@ -168,6 +323,195 @@ namespace GameEngine
         File::WriteAllText(fileName, IndentText(sb.ProduceString()));
         FileName = fileName;
     }
+    static ResourceType GetAssetResourceType(LevelAssetType type)
+    {
+        switch (type)
+        {
+        case LevelAssetType::Material:
+            return ResourceType::Material;
+        case LevelAssetType::Animation:
+        case LevelAssetType::CompressedAnimation:
+            return ResourceType::Animation;
+        default:
+            return ResourceType::Mesh;
+        }
+    }
+    template<typename TCache>
+    static void AddAssetDependencies(List<LevelAssetDependency> & dependencies, LevelAssetType type, TCache & cache)
+    {
+        // generated assets such as inline meshes and material instances are cached under names that are not files
+        for (auto & asset : cache)
+        {
+            if (Engine::Instance()->FindFile(asset.Key, GetAssetResourceType(type)).Length())
+            {
+                LevelAssetDependency dependency;
+                dependency.Type = type;
+                dependency.FileName = asset.Key;
+                dependencies.Add(dependency);
+            }
+        }
+    }
+    CoreLib::List<LevelAssetDependency> Level::GetAssetDependencies()
+    {
+        // the caches also hold the materials loaded by models, so the table covers what models reference
+        List<LevelAssetDependency> dependencies;
+        AddAssetDependencies(dependencies, LevelAssetType::Material, Materials);
+        AddAssetDependencies(dependencies, LevelAssetType::Mesh, Meshes);
+        AddAssetDependencies(dependencies, LevelAssetType::Model, Models);
+        AddAssetDependencies(dependencies, LevelAssetType::Skeleton, Skeletons);
+        AddAssetDependencies(dependencies, LevelAssetType::Animation, Animations);
+        AddAssetDependencies(dependencies, LevelAssetType::CompressedAnimation, CompressedAnimations);
+        AddAssetDependencies(dependencies, LevelAssetType::RetargetFile, RetargetFiles);
+        return dependencies;
+    }
+    struct PendingLevelAsset
+    {
+        const LevelAssetDependency * Dependency = nullptr;
+        RefPtr<Mesh> MeshAsset;
+        RefPtr<Model> ModelAsset;
+        RefPtr<Material> MaterialAsset;
+        RefPtr<Skeleton> SkeletonAsset;
+        RefPtr<SkeletalAnimation> AnimationAsset;
+        RefPtr<CompressedAnimationClip> CompressedAnimationAsset;
+        RetargetFile RetargetAsset;
+        String Log;
+        bool Loaded = false;
+    };
+    void Level::PreloadAssets(CoreLib::ArrayView<LevelAssetDependency> dependencies)
+    {
+        // assets are constructed here because constructors such as Material's are not thread safe
+        List<PendingLevelAsset> pending;
+        pending.Reserve(dependencies.Count());
+        for (auto & dependency : dependencies)
+        {
+            auto & fileName = dependency.FileName;
+            PendingLevelAsset asset;
+            asset.Dependency = &dependency;
+            switch (dependency.Type)
+            {
+            case LevelAssetType::Mesh:
+                if (Meshes.ContainsKey(fileName))
+                    continue;
+                asset.MeshAsset = new Mesh();
+                break;
+            case LevelAssetType::Model:
+                if (Models.ContainsKey(fileName))
+                    continue;
+                asset.ModelAsset = new Model();
+                break;
+            case LevelAssetType::Material:
+                if (Materials.ContainsKey(fileName))
+                    continue;
+                asset.MaterialAsset = new Material();
+                break;
+            case LevelAssetType::Skeleton:
+                if (Skeletons.ContainsKey(fileName))
+                    continue;
+                asset.SkeletonAsset = new Skeleton();
+                break;
+            case LevelAssetType::Animation:
+                if (Animations.ContainsKey(fileName))
+                    continue;
+                asset.AnimationAsset = new SkeletalAnimation();
+                break;
+            case LevelAssetType::CompressedAnimation:
+                if (CompressedAnimations.ContainsKey(fileName))
+                    continue;
+                asset.CompressedAnimationAsset = new CompressedAnimationClip();
+                break;
+            case LevelAssetType::RetargetFile:
+                if (RetargetFiles.ContainsKey(fileName))
+                    continue;
+                break;
+            default:
+                continue;
+            }
+            pending.Add(_Move(asset));
+        }
+        // only file reads and parsing run on the job system, neither touches the level or prints
+        Threading::JobSystem::ParallelFor(0, pending.Count(), 1, [&](int i)
+        {
+            auto & asset = pending[i];
+            auto actualName = Engine::Instance()->FindFile(asset.Dependency->FileName, GetAssetResourceType(asset.Dependency->Type));
+            if (!actualName.Length())
+                return;
+            try
+            {
+                switch (asset.Dependency->Type)
+                {
+                case LevelAssetType::Mesh:
+                    asset.MeshAsset->LoadFromFile(actualName);
+                    break;
+                case LevelAssetType::Model:
+                {
+                    StringBuilder log;
+                    asset.ModelAsset->LoadGeometry(File::ReadAllText(actualName), log);
+                    asset.Log = log.ProduceString();
+                    break;
+                }
+                case LevelAssetType::Material:
+                    asset.MaterialAsset->LoadFromFile(actualName);
+                    break;
+                case LevelAssetType::Skeleton:
+                    asset.SkeletonAsset->LoadFromFile(actualName);
+                    break;
+                case LevelAssetType::Animation:
+                    asset.AnimationAsset->LoadFromFile(actualName);
+                    break;
+                case LevelAssetType::CompressedAnimation:
+                    asset.CompressedAnimationAsset->LoadFromFile(actualName);
+                    break;
+                case LevelAssetType::RetargetFile:
+                    asset.RetargetAsset.LoadFromFile(actualName);
+                    break;
+                }
+                asset.Loaded = true;
+            }
+            catch (const Exception &)
+            {
+                // left out of the caches, the Load* call of the actor reports the error
+            }
+        });
+        // models go last so that BindMaterials finds their materials in the cache
+        for (auto & asset : pending)
+        {
+            if (!asset.Loaded)
+                continue;
+            auto & fileName = asset.Dependency->FileName;
+            switch (asset.Dependency->Type)
+            {
+            case LevelAssetType::Mesh:
+                Meshes[fileName] = asset.MeshAsset;
+                break;
+            case LevelAssetType::Material:
+                Materials[fileName] = asset.MaterialAsset;
+                break;
+            case LevelAssetType::Skeleton:
+                Skeletons[fileName] = asset.SkeletonAsset;
+                break;
+            case LevelAssetType::Animation:
+                Animations[fileName] = asset.AnimationAsset;
+                break;
+            case LevelAssetType::CompressedAnimation:
+                CompressedAnimations[fileName] = asset.CompressedAnimationAsset;
+                break;
+            case LevelAssetType::RetargetFile:
+                RetargetFiles[fileName] = _Move(asset.RetargetAsset);
+                break;
+            default:
+                break;
+            }
+        }
+        for (auto & asset : pending)
+        {
+            if (!asset.Loaded || asset.Dependency->Type != LevelAssetType::Model)
+                continue;
+            if (asset.Log.Length())
+                Print("%S", asset.Log.ToWString());
+            asset.ModelAsset->BindMaterials(this);
+            Models[asset.Dependency->FileName] = asset.ModelAsset;
+        }
+    }
     Level::~Level()
     {
         int count = Actors.Count();
@@ -178,6 +522,7 @@ namespace GameEngine
         Meshes = decltype(Meshes)();
         Skeletons = decltype(Skeletons)();
         Animations = decltype(Animations)();
+        CompressedAnimations = decltype(CompressedAnimations)();
         RetargetFiles = decltype(RetargetFiles)();
         Actors = decltype(Actors)();
     }
@@ -185,7 +530,8 @@ namespace GameEngine
     {
         Actors.Add(actor->Name.GetValue(), actor);
         actor->OnLoad();
-        actor->RegisterUI(Engine::Instance()->GetUiEntry());
+        if (auto uiEntry = Engine::Instance()->GetUiEntry())
+            actor->RegisterUI(uiEntry);
     }
     void Level::UnregisterActor(Actor*actor)
     {
@@ -350,6 +696,26 @@ namespace GameEngine
         }
         return result.Ptr();
     }
+    CompressedAnimationClip * Level::LoadCompressedAnimation(const CoreLib::String & fileName)
+    {
+        RefPtr<CompressedAnimationClip> result = nullptr;
+        if (!CompressedAnimations.TryGetValue(fileName, result))
+        {
+            auto actualName = Engine::Instance()->FindFile(fileName, ResourceType::Animation);
+            if (actualName.Length())
+            {
+                result = new CompressedAnimationClip();
+                result->LoadFromFile(actualName);
+                CompressedAnimations[fileName] = result;
+            }
+            else
+            {
+                Print("error: cannot load animation \'%S\'\n", fileName.ToWString());
+                return nullptr;
+            }
+        }
+        return result.Ptr();
+    }
     Actor * Level::FindActor(const CoreLib::String & name)
     {
         RefPtr<Actor> result;
@@ -6,6 +6,7 @@
 #include "Actor.h"
 #include "Material.h"
 #include "Skeleton.h"
+#include "CompressedAnimation.h"
 #include "Physics.h"
 
 namespace GameEngine
@@ -13,6 +14,21 @@ namespace GameEngine
     class Actor;
     class CameraActor;
 
+    constexpr int CurrentCompiledLevelVersion = 100;
+    constexpr uint32_t CompiledLevelIdentifier = 'C' + ('L' << 8) + ('V' << 16) + ('L' << 24);
+
+    enum class LevelAssetType
+    {
+        Mesh, Model, Material, Skeleton, Animation, CompressedAnimation, RetargetFile
+    };
+
+    // an asset file referenced by a level, named as it is passed to the Level::Load* functions
+    struct LevelAssetDependency
+    {
+        LevelAssetType Type = LevelAssetType::Mesh;
+        CoreLib::String FileName;
+    };
+
     class Level : public CoreLib::Object
     {
     private:
@@ -24,6 +40,7 @@ namespace GameEngine
         CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Mesh>> Meshes;
         CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Skeleton>> Skeletons;
         CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<SkeletalAnimation>> Animations;
+        CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<CompressedAnimationClip>> CompressedAnimations;
         CoreLib::EnumerableDictionary<CoreLib::String, RetargetFile> RetargetFiles;
         CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::ObjPtr<Actor>> Actors;
         CoreLib::List<CoreLib::String> HiddenSections;
@@ -31,7 +48,19 @@ namespace GameEngine
         CoreLib::String FileName;
         CoreLib::String LightmapFileName;
         void LoadFromText(CoreLib::String text);
+        // Compiled levels (.clevel) store actor type ids, binary property values and the asset dependency
+        // table of the level. The loader resolves all dependencies in parallel before it constructs actors.
+        void LoadFromBinary(CoreLib::IO::Stream * stream);
+        void SaveToBinary(CoreLib::IO::Stream * stream);
+        // writes the compiled format if fileName has the .clevel extension
         void SaveToFile(CoreLib::String fileName);
+        // assets loaded into the caches that can be found on disk, each listed once
+        CoreLib::List<LevelAssetDependency> GetAssetDependencies();
+        // Reads the assets on the job system and adds them to the caches, so that the Load* calls made
+        // while actors load find them there. Models read their meshes in parallel as well and bind their
+        // materials once those are cached. Assets that fail to load are left out and report their error
+        // when an actor loads them.
+        void PreloadAssets(CoreLib::ArrayView<LevelAssetDependency> dependencies);
         Level(const CoreLib::String & fileName);
         Level() = default;
         ~Level();
@@ -46,6 +75,7 @@ namespace GameEngine
         Material * LoadErrorMaterial();
         Material * CreateNewMaterial();
         SkeletalAnimation * LoadSkeletalAnimation(const CoreLib::String & fileName);
+        CompressedAnimationClip * LoadCompressedAnimation(const CoreLib::String & fileName);
         Actor * FindActor(const CoreLib::String & name);
         PhysicsScene & GetPhysicsScene()
         {
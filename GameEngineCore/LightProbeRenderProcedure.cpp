@@ -6,6 +6,7 @@
 #include "DirectionalLightActor.h"
 #include "AtmosphereActor.h"
 #include "FrustumCulling.h"
+#include "DrawableSpatialIndex.h"
 #include "RenderProcedure.h"
 #include "StandardViewUniforms.h"
 #include "LightingData.h"
@@ -53,8 +54,9 @@ namespace GameEngine
         CoreLib::List<ModuleInstance> shadowViewInstances;
 
         DrawableSink sink;
+        DrawableSpatialIndex spatialIndex;
 
-        List<Drawable*> reorderBuffer, drawableBuffer;
+        List<Drawable*> reorderBuffer, drawableBuffer, cameraVisibleDrawables;
         LightingEnvironment lighting;
         AtmosphereParameters lastAtmosphereParams;
         bool useAtmosphere = false;
@@ -149,28 +151,20 @@ namespace GameEngine
             Shadow, CustomDepth, Main, Transparent
         };
 
-        ArrayView<Drawable*> GetDrawable(DrawableSink * objSink, PassType pass, CullFrustum cf, bool append)
+        // selects the drawables of a camera pass from the camera visibility set computed once per frame
+        ArrayView<Drawable*> GetDrawable(PassType pass)
         {
-            if (!append)
-                drawableBuffer.Clear();
-            for (auto obj : objSink->GetDrawables(pass == PassType::Transparent))
+            drawableBuffer.Clear();
+            for (auto obj : cameraVisibleDrawables)
             {
-                if (pass == PassType::Shadow && !obj->CastShadow)
-                    continue;
-                if (pass == PassType::CustomDepth && !obj->RenderCustomDepth)
-                    continue;
-                if (cf.IsBoxInFrustum(obj->Bounds))
-                    drawableBuffer.Add(obj);
-            }
-            if (pass == PassType::CustomDepth)
-            {
-                for (auto obj : objSink->GetDrawables(true))
+                if (pass == PassType::CustomDepth)
                 {
                     if (!obj->RenderCustomDepth)
                         continue;
-                    if (cf.IsBoxInFrustum(obj->Bounds))
-                        drawableBuffer.Add(obj);
                 }
+                else if (obj->IsTransparent() != (pass == PassType::Transparent))
+                    continue;
+                drawableBuffer.Add(obj);
             }
             return drawableBuffer.GetArrayView();
         }
@@ -260,11 +254,14 @@ namespace GameEngine
                     }
                 }
             }
+            spatialIndex.Update(sink);
+            auto cameraCullFrustum = CullFrustum(params.view.GetFrustum(aspect));
+            spatialIndex.Query(cameraCullFrustum, cameraVisibleDrawables, [](Drawable *) { return true; });
+
             // collect light data and render shadow map
-            lighting.GatherInfo(hardwareRenderer, &sink, params, w, h, viewUniform, shadowRenderPass.Ptr());
+            lighting.GatherInfo(hardwareRenderer, &spatialIndex, params, w, h, viewUniform, shadowRenderPass.Ptr());
 
             viewParams.SetUniformData(&viewUniform, (int)sizeof(viewUniform));
-            auto cameraCullFrustum = CullFrustum(params.view.GetFrustum(aspect));
 
             // pre-z pass
             Array<Texture*, 8> textures;
@@ -275,10 +272,10 @@ namespace GameEngine
             prezTextures.Add(textures[0]);
             customDepthRenderPass->Bind();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
-            preZPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Main, cameraCullFrustum, false));
+            preZPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::Main));
             sharedRes->pipelineManager.PopModuleInstance();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
-            preZPassTransparentInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Transparent, cameraCullFrustum, false));
+            preZPassTransparentInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::Transparent));
             sharedRes->pipelineManager.PopModuleInstance();
             preZPassInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
             preZPassTransparentInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
@@ -310,7 +307,7 @@ namespace GameEngine
             forwardRenderPass->Bind();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
             sharedRes->pipelineManager.PushModuleInstance(&lighting.moduleInstance);
-            forwardBaseInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Main, cameraCullFrustum, false));
+            forwardBaseInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::Main));
             sharedRes->pipelineManager.PopModuleInstance();
             sharedRes->pipelineManager.PopModuleInstance();
             forwardBaseInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
@@ -321,7 +318,7 @@ namespace GameEngine
             }
             // transparency pass
             reorderBuffer.Clear();
-            for (auto drawable : GetDrawable(&sink, PassType::Transparent, cameraCullFrustum, false))
+            for (auto drawable : GetDrawable(PassType::Transparent))
             {
                 reorderBuffer.Add(drawable);
             }
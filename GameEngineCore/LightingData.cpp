@@ -31,18 +31,7 @@ namespace GameEngine
 			(unsigned int)(Math::Clamp(((beta + Math::Pi * 0.5f) / Math::Pi), 0.0f, 1.0f)*65535.0f);
 	}
 
-	void GetDrawable(List<Drawable*> & drawableBuffer, DrawableSink * objSink, bool transparent, CullFrustum cf)
-	{
-		for (auto obj : objSink->GetDrawables(transparent))
-		{
-			if (!obj->CastShadow)
-				continue;
-			if (cf.IsBoxInFrustum(obj->Bounds))
-				drawableBuffer.Add(obj);
-		}
-	}
-
-	void LightingEnvironment::AddShadowPass(HardwareRenderer* hw, WorldRenderPass * shadowRenderPass, DrawableSink * sink, ShadowMapResource & shadowMapRes, int shadowMapId,
+	void LightingEnvironment::AddShadowPass(HardwareRenderer* hw, WorldRenderPass * shadowRenderPass, ArrayView<Drawable*> drawables, ShadowMapResource & shadowMapRes, int shadowMapId,
 		StandardViewUniforms & shadowMapView, int & shadowMapViewInstancePtr)
 	{
 		auto pass = shadowRenderPass->CreateInstance(shadowMapRes.shadowMapRenderOutputs[shadowMapId].Ptr(), true);
@@ -68,17 +57,13 @@ namespace GameEngine
 		}
 		shadowMapPassModuleInstance->SetUniformData(&shadowMapView, sizeof(shadowMapView));
 		sharedRes->pipelineManager.PushModuleInstance(shadowMapPassModuleInstance);
-		drawableBuffer.Clear();
-		auto cullFrustum = CullFrustum(shadowMapView.InvViewProjTransform);
-		GetDrawable(drawableBuffer, sink, true, cullFrustum);
-		GetDrawable(drawableBuffer, sink, false, cullFrustum);
-		pass->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, drawableBuffer.GetArrayView());
+		pass->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, drawables);
 		sharedRes->pipelineManager.PopModuleInstance();
         RenderStat stat;
 		pass->Execute(hw, stat, PipelineBarriers::MemoryAndImage);
 	}
 
-	void LightingEnvironment::GatherInfo(HardwareRenderer* hw, DrawableSink * sink, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & viewUniform, WorldRenderPass * shadowRenderPass)
+	void LightingEnvironment::GatherInfo(HardwareRenderer* hw, DrawableSpatialIndex * spatialIndex, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & viewUniform, WorldRenderPass * shadowRenderPass)
 	{
 		auto renderer = params.renderer;
 		auto level = params.level;
@@ -178,6 +163,7 @@ namespace GameEngine
 		int shadowMapSize = Engine::Instance()->GetGraphicsSettings().ShadowMapResolution;
 		float aspect = w / (float)h;
 		auto camFrustum = params.view.GetFrustum(aspect);
+		shadowPasses.Clear();
 
 		// generate cascaded shadow map passes for sunlight
 		shadowRenderPass->Bind();
@@ -258,7 +244,7 @@ namespace GameEngine
 					viewportMatrix.m[1][1] = 0.5f; viewportMatrix.m[3][1] = 0.5f;
 					viewportMatrix.m[2][2] = 1.0f; viewportMatrix.m[3][2] = 0.0f;
 					Matrix4::Multiply(uniformData.lightMatrix[i], viewportMatrix, shadowMapView.ViewProjectionTransform);
-					AddShadowPass(hw, shadowRenderPass, sink, shadowMapRes, i + shadowMapStartId, shadowMapView, shadowMapViewInstancePtr);
+					shadowPasses.Add(ShadowPassInfo{ shadowMapView, i + shadowMapStartId });
 				}
 			}
 		}
@@ -299,9 +285,21 @@ namespace GameEngine
 				viewportMatrix.m[1][1] = 0.5f; viewportMatrix.m[3][1] = 0.5f;
 				viewportMatrix.m[2][2] = 1.0f; viewportMatrix.m[3][2] = 0.0f;
 				Matrix4::Multiply(light.lightMatrix, viewportMatrix, shadowMapView.ViewProjectionTransform);
-				AddShadowPass(hw, shadowRenderPass, sink, shadowMapRes, light.shaderMapId, shadowMapView, shadowMapViewInstancePtr);
+				shadowPasses.Add(ShadowPassInfo{ shadowMapView, light.shaderMapId });
 			}
 		}
+		// cull all cascades and spot light views in one traversal of the spatial index
+		shadowFrustums.Clear();
+		for (auto & shadowPass : shadowPasses)
+			shadowFrustums.Add(CullFrustum(shadowPass.view.InvViewProjTransform));
+		if (shadowDrawables.Count() < shadowPasses.Count())
+			shadowDrawables.SetSize(shadowPasses.Count());
+		spatialIndex->Query(shadowFrustums.GetArrayView(), shadowDrawables.GetArrayView(0, shadowPasses.Count()), [](Drawable * obj)
+		{
+			return obj->CastShadow;
+		});
+		for (int i = 0; i < shadowPasses.Count(); i++)
+			AddShadowPass(hw, shadowRenderPass, shadowDrawables[i].GetArrayView(), shadowMapRes, shadowPasses[i].shadowMapId, shadowPasses[i].view, shadowMapViewInstancePtr);
 		uniformData.lightCount = lights.Count();
 		uniformData.lightProbeCount = lightProbes.Count();
         uniformData.lightListSizePerTile = MaxLightsPerTile;
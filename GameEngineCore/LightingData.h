@@ -8,6 +8,7 @@
 #include "Level.h"
 #include "RenderProcedure.h"
 #include "StandardViewUniforms.h"
+#include "DrawableSpatialIndex.h"
 
 namespace GameEngine
 {
@@ -58,7 +59,16 @@ namespace GameEngine
 		bool useEnvMap = true;
 		CoreLib::RefPtr<TextureCubeArray> emptyEnvMapArray;
         CoreLib::RefPtr<Texture2DArray> emptyLightmapArray;
-		void AddShadowPass(HardwareRenderer* hw, WorldRenderPass * shadowRenderPass, DrawableSink * sink, ShadowMapResource & shadowMapRes, int shadowMapId,
+		struct ShadowPassInfo
+		{
+			StandardViewUniforms view;
+			int shadowMapId;
+		};
+		// shadow views of the current frame, culled together in a single spatial index query
+		CoreLib::List<ShadowPassInfo> shadowPasses;
+		CoreLib::List<CullFrustum> shadowFrustums;
+		CoreLib::List<CoreLib::List<Drawable*>> shadowDrawables;
+		void AddShadowPass(HardwareRenderer* hw, WorldRenderPass * shadowRenderPass, CoreLib::ArrayView<Drawable*> drawables, ShadowMapResource & shadowMapRes, int shadowMapId,
 			StandardViewUniforms & shadowMapView, int & shadowMapViewInstancePtr);
 	public:
 		DeviceMemory * uniformMemory;
@@ -69,7 +79,7 @@ namespace GameEngine
 		CoreLib::List<CoreLib::RefPtr<Texture2D>> shadowMaps;
 		CoreLib::RefPtr<Buffer> lightBuffer, lightProbeBuffer;
 		CoreLib::List<ModuleInstance> shadowViewInstances;
-		CoreLib::List<Drawable*> drawableBuffer, reorderBuffer;
+		CoreLib::List<Drawable*> reorderBuffer;
         CoreLib::RefPtr<Buffer> tiledLightListBufffer;
         int tiledLightListBufferSize = 0;
         DeviceLightmapSet * deviceLightmapSet = nullptr;
@@ -77,7 +87,7 @@ namespace GameEngine
 		void* lightBufferPtr, *lightProbeBufferPtr;
 		int lightBufferSize, lightProbeBufferSize;
 		LightingUniform uniformData;
-		void GatherInfo(HardwareRenderer* hw, DrawableSink * sink, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & cameraView, WorldRenderPass * shadowPass);
+		void GatherInfo(HardwareRenderer* hw, DrawableSpatialIndex * spatialIndex, const RenderProcedureParameters & params, int w, int h, StandardViewUniforms & cameraView, WorldRenderPass * shadowPass);
 		void Init(RendererSharedResource & sharedRes, DeviceMemory * uniformMemory, bool pUseEnvMap);
 		void UpdateSharedResourceBinding();
         void UpdateSceneResourceBinding(SceneResource* sceneRes);
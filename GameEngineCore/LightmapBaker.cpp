@@ -9,6 +9,7 @@
 #include "CameraActor.h"
 #include "CoreLib/Threading.h"
 #include "LightmapUVGeneration.h"
+#include "TextureCompressor.h"
 #include <atomic>
 
 namespace GameEngine
@@ -22,7 +23,7 @@ namespace GameEngine
     public:
         LightmapBakingSettings settings;
         LightmapSet lightmaps, lightmapsReturn;
-        ComputeKernel* lightmapComrpessionKernel;
+        ComputeKernel* lightmapComrpessionKernel = nullptr;
         int totalBlocks;
         std::atomic<int> completedBlocks;
     private:
@@ -172,6 +173,9 @@ namespace GameEngine
 
         VectorMath::Vec3 TraceShadowRay(Ray & shadowRay)
         {
+            // most shadow rays are unoccluded, an any-hit query answers those without finding the closest face
+            if (!staticScene->TraceOcclusion(shadowRay))
+                return VectorMath::Vec3::Create(1.0f, 1.0f, 1.0f);
             auto inter = staticScene->TraceRay(shadowRay);
             if (inter.IsHit)
             {
@@ -280,6 +284,11 @@ namespace GameEngine
         VectorMath::Vec3 TraceSampleRay(Ray& ray, float minValidDist, bool& isInvalid, int recurseLevel = 0)
         {
             auto inter = staticScene->TraceRay(ray);
+            return ShadeSampleRay(ray, inter, minValidDist, isInvalid, recurseLevel);
+        }
+
+        VectorMath::Vec3 ShadeSampleRay(Ray& ray, const StaticSceneTracingResult & inter, float minValidDist, bool& isInvalid, int recurseLevel = 0)
+        {
             if (inter.IsHit)
             {
                 auto surfaceAlbedo = maps[inter.MapId].diffuseMap.Sample(inter.UV);
@@ -330,17 +339,30 @@ namespace GameEngine
             VectorMath::Vec3 tangent;
             VectorMath::GetOrthoVec(tangent, normal);
             auto binormal = VectorMath::Vec3::Cross(tangent, normal);
-            for (int i = 0; i < sampleCount; i++)
-            {
-                float r1 = random.NextFloat();
-                float r2 = random.NextFloat();
-                Ray ray;
-                ray.Origin = pos;
-                auto tanDir = UniformSampleHemisphere(r1, r2);
-                ray.Dir = tangent * tanDir.x + normal * tanDir.y + binormal * tanDir.z;
-                ray.tMax = FLT_MAX;
-                auto sampleColor = TraceSampleRay(ray, minValidDistance, isInvalidRegion) * r1;
-                result += sampleColor;
+            // all samples of a pixel share their origin, trace them in coherent batches
+            const int batchSize = 16;
+            Ray rays[batchSize];
+            StaticSceneTracingResult hits[batchSize];
+            float weights[batchSize];
+            for (int start = 0; start < sampleCount; start += batchSize)
+            {
+                int count = Math::Min(batchSize, sampleCount - start);
+                for (int i = 0; i < count; i++)
+                {
+                    float r1 = random.NextFloat();
+                    float r2 = random.NextFloat();
+                    rays[i].Origin = pos;
+                    auto tanDir = UniformSampleHemisphere(r1, r2);
+                    rays[i].Dir = tangent * tanDir.x + normal * tanDir.y + binormal * tanDir.z;
+                    rays[i].tMax = FLT_MAX;
+                    weights[i] = r1;
+                }
+                staticScene->TraceRays(MakeArrayView(rays, count), MakeArrayView(hits, count));
+                for (int i = 0; i < count; i++)
+                {
+                    auto sampleColor = ShadeSampleRay(rays[i], hits[i], minValidDistance, isInvalidRegion) * weights[i];
+                    result += sampleColor;
+                }
             }
             result *= 2.0f / (float)sampleCount;
             return result;
@@ -782,8 +804,26 @@ namespace GameEngine
             }
         }
         
+        void CompressLightmapsOnCpu()
+        {
+            for (auto & lm : lightmaps.Lightmaps)
+            {
+                List<unsigned char> blocks;
+                blocks.SetSize(((lm.Width + 3) >> 2) * ((lm.Height + 3) >> 2) * 16);
+                TextureCompressor::CompressSurfaceRGB_BC6H(blocks.Buffer(), (float*)lm.GetBuffer(), lm.Width, lm.Height, settings.CompressionQuality);
+                lm.Init(RawObjectSpaceMap::DataType::BC6H, lm.Width, lm.Height);
+                memcpy(lm.GetBuffer(), blocks.Buffer(), lm.Width * lm.Height);
+                if (isCancelled)
+                    return;
+            }
+        }
         void CompressLightmaps()
         {
+            if (settings.CpuCompression)
+            {
+                CompressLightmapsOnCpu();
+                return;
+            }
             auto computeTaskManager = Engine::GetComputeTaskManager();
             auto hw = Engine::Instance()->GetRenderer()->GetHardwareRenderer();
             RefPtr<Fence> fence = hw->CreateFence();
@@ -938,6 +978,8 @@ namespace GameEngine
         {
             settings = pSettings;
             level = pLevel;
+            if (!settings.CpuCompression && !lightmapComrpessionKernel)
+                lightmapComrpessionKernel = Engine::GetComputeTaskManager()->LoadKernel("BC6Compression.slang", "cs_main");
             lightmaps = LightmapSet();
             maps.Clear();
             started = true;
@@ -971,8 +1013,6 @@ namespace GameEngine
         }
         LightmapBakerImpl()
         {
-            auto computeTaskManager = Engine::GetComputeTaskManager();
-            lightmapComrpessionKernel = computeTaskManager->LoadKernel("BC6Compression.slang", "cs_main");
             isCancelled = false;
             started = false;
         }
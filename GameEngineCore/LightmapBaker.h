@@ -4,6 +4,7 @@
 #include "CoreLib/Basic.h"
 #include "CoreLib/Events.h"
 #include "LightmapSet.h"
+#include "BlockCompression.h"
 
 namespace GameEngine
 {
@@ -22,6 +23,9 @@ namespace GameEngine
         float Epsilon = 1e-5f;
         float ShadowBias = 1e-2f;
         float IndirectLightingWorldGranularity = 30.0f;
+        // compress lightmaps to BC6H on the CPU instead of with the BC6Compression compute kernel
+        bool CpuCompression = false;
+        TextureCompressionQuality CompressionQuality = TextureCompressionQuality::Normal;
     };
     struct LightmapBakerProgressChangedEventArgs
     {
@@ -177,7 +177,7 @@ namespace GameEngine
             return codePoints;
         }
 
-        int DrawChar(unsigned codePoint, TextSize bufferSize, int bpX, int bpY, bool isBeginOfLine)
+        GlyphCacheItem* GetGlyph(unsigned codePoint)
         {
             auto glyph = glyphCache.Find(codePoint);
             if (!glyph->isValid)
@@ -190,6 +190,12 @@ namespace GameEngine
                     fontScale, fontScale, codePoint);
                 glyph->isValid = true;
             }
+            return glyph;
+        }
+
+        int DrawChar(unsigned codePoint, TextSize bufferSize, int bpX, int bpY, bool isBeginOfLine)
+        {
+            auto glyph = GetGlyph(codePoint);
             if (isBeginOfLine && glyph->leftSideBearing < 0)
             {
                 bpX -= (int)(glyph->leftSideBearing * fontScale);
@@ -297,6 +303,105 @@ namespace GameEngine
             return result;
         }
 
+        virtual bool LayoutGlyphs(const CoreLib::String& text, const DrawTextOptions& options, 
+            List<GlyphPlacement>& placements, TextSize& size) override
+        {
+            auto codePoints = StringToCodePointList(text);
+            size = GetTextSize(codePoints, options);
+            placements.Clear();
+            if (!fontInitialized)
+                return true;
+            // same layout as RasterizeText, but each glyph is placed instead of blitted
+            int baselineY = (int)(fontAscent * fontScale);
+            int bpX = 0, bpY = baselineY;
+            bool charUnderline = false;
+            bool isBeginOfLine = true;
+            for (int i = 0; i < codePoints.Count(); i++)
+            {
+                auto codePoint = codePoints[i];
+                auto nextCodePoint = i < codePoints.Count() - 1 ? codePoints[i + 1] : 0;
+                if (options.ProcessPrefix && !options.EditorText)
+                {
+                    if (codePoint == 0x26)
+                    {
+                        if (nextCodePoint != 0x26)
+                        {
+                            charUnderline = true;
+                            continue;
+                        }
+                        else
+                        {
+                            i++;
+                        }
+                    }
+                }
+                if (codePoint == 0xD || (codePoint == 0xA && nextCodePoint != 0xD))
+                {
+                    // Encountered CR/LF
+                    bpY += (int)((fontAscent - fontDescent + fontLineGap) * fontScale);
+                    bpX = 0;
+                    isBeginOfLine = true;
+                }
+                else
+                {
+                    int newBpX = bpX;
+                    if (codePoint)
+                    {
+                        auto glyph = GetGlyph(codePoint);
+                        if (isBeginOfLine && glyph->leftSideBearing < 0)
+                            bpX -= (int)(glyph->leftSideBearing * fontScale);
+                        GlyphPlacement placement;
+                        placement.Glyph = codePoint;
+                        placement.X = bpX + glyph->x0;
+                        placement.Y = bpY + glyph->y0;
+                        placement.Width = glyph->x1 - glyph->x0;
+                        placement.Height = glyph->y1 - glyph->y0;
+                        if (placement.Width > 0 && placement.Height > 0)
+                            placements.Add(placement);
+                        newBpX = bpX + (int)(glyph->advanceWidth * fontScale);
+                    }
+                    if (drawUnderline || charUnderline)
+                    {
+                        charUnderline = false;
+                        GlyphPlacement placement;
+                        placement.Glyph = UnderlineGlyph;
+                        placement.X = bpX;
+                        placement.Y = bpY + underlineCharY0;
+                        placement.Width = newBpX - bpX;
+                        placement.Height = underlineCharY1 - underlineCharY0;
+                        if (placement.Width > 0 && placement.Height > 0)
+                            placements.Add(placement);
+                    }
+                    bpX = newBpX;
+                    isBeginOfLine = false;
+                }
+            }
+            return true;
+        }
+
+        virtual TextRasterizationResult RasterizeGlyph(unsigned int glyph) override
+        {
+            TextRasterizationResult result;
+            if (!fontInitialized)
+            {
+                result.Size = TextSize{ 0, 0 };
+                result.ImageData = nullptr;
+            }
+            else if (glyph == UnderlineGlyph)
+            {
+                // a single column, stretched horizontally when drawn
+                result.Size = TextSize{ 1, underlineCharBuffer.Count() };
+                result.ImageData = underlineCharBuffer.Buffer();
+            }
+            else
+            {
+                auto item = GetGlyph(glyph);
+                result.Size = TextSize{ item->x1 - item->x0, item->y1 - item->y0 };
+                result.ImageData = item->bitmap.Buffer();
+            }
+            return result;
+        }
+
         virtual TextSize GetTextSize(const CoreLib::String& text, const DrawTextOptions& options) override
         {
             auto codePoints = StringToCodePointList(text);
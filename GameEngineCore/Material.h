@@ -19,6 +19,7 @@ namespace GameEngine
 		bool IsTransparent = false;
 		bool IsDoubleSided = false;
 		ModuleInstance MaterialModule;
+		CoreLib::List<StreamedTexture*> StreamedTextures; // textures of MaterialModule that are loaded by the texture streamer
 		CoreLib::EnumerableDictionary<CoreLib::String, DynamicVariable> Variables;
 		CoreLib::List<DynamicVariable*> PatternVariables;
 		void SetVariable(CoreLib::String name, DynamicVariable value);
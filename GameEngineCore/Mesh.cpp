@@ -11,15 +11,7 @@ using namespace VectorMath;
 namespace GameEngine
 {
 	int Mesh::uid = 0;
-	void Mesh::LoadFromFile(const CoreLib::Basic::String & pfileName)
-	{
-		RefPtr<FileStream> stream = new FileStream(pfileName);
-		LoadFromStream(stream.Ptr());
-		stream->Close();
-		this->fileName = pfileName;
-	}
-
-	bool CheckMeshIdentifier(char * str)
+	bool CheckMeshIdentifier(const char * str)
 	{
 		MeshHeader header;
 		for (int i = 0; i < sizeof(header.MeshFileIdentifier); i++)
@@ -28,6 +20,26 @@ namespace GameEngine
 		return true;
 	}
 
+	void Mesh::LoadFromFile(const CoreLib::Basic::String & pfileName)
+	{
+		// paged meshes are used in place from the mapped file, older versions are read through a stream
+		RefPtr<MemoryMappedFile> file = new MemoryMappedFile(pfileName);
+		auto header = (const MeshHeader*)file->Buffer();
+		if (file->Size() >= sizeof(MeshHeader) + sizeof(MeshBlobTable) && CheckMeshIdentifier(header->MeshFileIdentifier) &&
+			header->MeshFileVersion == CurrentMeshFileVersion)
+		{
+			LoadFromMappedFile(file.Ptr());
+		}
+		else
+		{
+			file = nullptr;
+			RefPtr<FileStream> stream = new FileStream(pfileName);
+			LoadFromStream(stream.Ptr());
+			stream->Close();
+		}
+		this->fileName = pfileName;
+	}
+
     static PrimitiveType ReadPrimitiveType(int ptype)
     {
         switch (ptype)
@@ -58,9 +70,61 @@ namespace GameEngine
         }
     }
 
+	static void ReadElementMetaData(BinaryReader & reader, Mesh & mesh, const MeshHeader & header, int indexCount)
+	{
+		mesh.ElementRanges.SetSize(header.ElementCount);
+		reader.Read(mesh.ElementRanges.Buffer(), mesh.ElementRanges.Count());
+		if (mesh.ElementRanges.Count() == 0)
+		{
+			MeshElementRange range;
+			range.StartIndex = 0;
+			range.Count = indexCount;
+			mesh.ElementRanges.Add(range);
+		}
+        mesh.ElementBlendShapeChannels.Clear();
+        if (header.HasBlendShapes)
+        {
+            int blendShapeChannelCount = reader.ReadInt32();
+            mesh.ElementBlendShapeChannels.SetSize(blendShapeChannelCount);
+            CORELIB_ASSERT(blendShapeChannelCount == mesh.ElementRanges.Count());
+            for (auto &blendShapes : mesh.ElementBlendShapeChannels)
+            {
+                blendShapes.SetSize(reader.ReadInt32());
+                for (auto &blendShape : blendShapes)
+                {
+                    reader.Read(blendShape.Name);
+                    reader.Read(blendShape.ChannelId);
+                    reader.Read(blendShape.BlendShapes);
+                    reader.Read(blendShape.Reserved, sizeof(blendShape.Reserved));
+                }
+            }
+        }
+	}
+
+	static void WriteElementMetaData(BinaryWriter & writer, Mesh & mesh, const MeshHeader & header)
+	{
+		writer.Write(mesh.ElementRanges.Buffer(), mesh.ElementRanges.Count());
+        if (header.HasBlendShapes)
+        {
+            writer.Write(mesh.ElementBlendShapeChannels.Count());
+            for (auto &blendShapeChannels : mesh.ElementBlendShapeChannels)
+            {
+                writer.Write(blendShapeChannels.Count());
+                for (auto &blendShapeChannel : blendShapeChannels)
+                {
+                    writer.Write(blendShapeChannel.Name);
+                    writer.Write(blendShapeChannel.ChannelId);
+                    writer.Write(blendShapeChannel.BlendShapes);
+                    writer.Write(blendShapeChannel.Reserved, sizeof(blendShapeChannel.Reserved));
+                }
+            }
+        }
+	}
+
 	void Mesh::LoadFromStream(Stream * stream)
 	{
 		auto reader = BinaryReader(stream);
+		int64_t start = stream->GetPosition();
 		MeshHeader header;
 		reader.Read(header);
         primitiveType = ReadPrimitiveType(header.PrimitiveType);
@@ -70,6 +134,19 @@ namespace GameEngine
 		{
 			stream->Seek(SeekOrigin::Start, 0);
 			header = MeshHeader();
+			header.MeshFileVersion = 1;
+		}
+		if (header.MeshFileVersion != 1 && header.MeshFileVersion != CurrentMeshFileVersion)
+		{
+			reader.ReleaseStream();
+			throw InvalidOperationException("Unsupported mesh file version.");
+		}
+		if (header.MeshFileVersion == CurrentMeshFileVersion)
+		{
+			LoadPagedFromStream(reader, header, start);
+			reader.ReleaseStream();
+			fileName = String("mesh_") + String(uid++);
+			return;
 		}
 		int typeId = reader.ReadInt32();
 		vertexFormat = MeshVertexFormat(typeId);
@@ -81,37 +158,83 @@ namespace GameEngine
 		Indices.SetSize(indexCount);
 		reader.Read((char*)GetVertexBuffer(), vertCount * vertexFormat.GetVertexSize());
 		reader.Read(Indices.Buffer(), indexCount);
-		ElementRanges.SetSize(header.ElementCount);
-		reader.Read(ElementRanges.Buffer(), ElementRanges.Count());
-		if (ElementRanges.Count() == 0)
-		{
-			MeshElementRange range;
-			range.StartIndex = 0;
-			range.Count = indexCount;
-			ElementRanges.Add(range);
-		}
+		ReadElementMetaData(reader, *this, header, indexCount);
+        BlendShapeVertices.Clear();
         if (header.HasBlendShapes)
-        {
-            int blendShapeChannelCount = reader.ReadInt32();
-            ElementBlendShapeChannels.SetSize(blendShapeChannelCount);
-            CORELIB_ASSERT(blendShapeChannelCount == ElementRanges.Count());
-            for (auto &blendShapes : ElementBlendShapeChannels)
-            {
-                blendShapes.SetSize(reader.ReadInt32());
-                for (auto &blendShape : blendShapes)
-                {
-                    reader.Read(blendShape.Name);
-                    reader.Read(blendShape.ChannelId);
-                    reader.Read(blendShape.BlendShapes);
-                    reader.Read(blendShape.Reserved, sizeof(blendShape.Reserved));
-                }
-            }
             reader.Read(BlendShapeVertices);
-        }
 		reader.ReleaseStream();
 		fileName = String("mesh_") + String(uid++);
 	}
 
+	void Mesh::LoadPagedFromStream(BinaryReader & reader, const MeshHeader & header, int64_t start)
+	{
+		auto stream = reader.GetStream();
+		MeshBlobTable table;
+		reader.Read(table);
+		vertexFormat = MeshVertexFormat(table.VertexTypeId);
+		Bounds = table.Bounds;
+		ReadElementMetaData(reader, *this, header, table.IndexCount);
+		AllocVertexBuffer(table.VertexCount);
+		stream->Seek(SeekOrigin::Start, start + table.VertexDataOffset);
+		reader.Read((char*)GetVertexBuffer(), vertCount * vertexFormat.GetVertexSize());
+		Indices.SetSize(table.IndexCount);
+		stream->Seek(SeekOrigin::Start, start + table.IndexDataOffset);
+		reader.Read(Indices.Buffer(), Indices.Count());
+		BlendShapeVertices.SetSize(table.BlendShapeVertexCount);
+		if (table.BlendShapeVertexCount)
+		{
+			stream->Seek(SeekOrigin::Start, start + table.BlendShapeVertexDataOffset);
+			reader.Read(BlendShapeVertices.Buffer(), BlendShapeVertices.Count());
+		}
+	}
+
+	void Mesh::LoadFromMappedFile(MemoryMappedFile * file)
+	{
+		auto data = file->Buffer();
+		auto & header = *(const MeshHeader*)data;
+		auto & table = *(const MeshBlobTable*)(data + sizeof(MeshHeader));
+		primitiveType = ReadPrimitiveType(header.PrimitiveType);
+		surfaceArea = header.SurfaceArea;
+		minLightmapResolution = header.MinLightmapResolution;
+		vertexFormat = MeshVertexFormat(table.VertexTypeId);
+		Bounds = table.Bounds;
+		// blobs follow the header, the blob table and the element metadata
+		const int64_t metaDataStart = sizeof(MeshHeader) + sizeof(MeshBlobTable);
+		if (table.VertexCount < 0 || table.IndexCount < 0 || table.BlendShapeVertexCount < 0 ||
+			table.VertexDataOffset < metaDataStart || table.VertexDataOffset - metaDataStart > 0x7FFFFFFF)
+			throw IOException("invalid mesh blob table.");
+		size_t vertexDataSize = (size_t)table.VertexCount * vertexFormat.GetVertexSize();
+		if ((size_t)table.VertexDataOffset + vertexDataSize > file->Size() ||
+			(size_t)table.IndexDataOffset + (size_t)table.IndexCount * sizeof(int) > file->Size() ||
+			(size_t)table.BlendShapeVertexDataOffset + (size_t)table.BlendShapeVertexCount * sizeof(BlendShapeVertex) > file->Size())
+			throw IOException("truncated mesh file.");
+
+		// element ranges and blend shape channels are small, parse them from the mapped pages
+		BinaryReader reader(new MemoryStream((unsigned char*)data + metaDataStart, (int)(table.VertexDataOffset - metaDataStart)));
+		ReadElementMetaData(reader, *this, header, table.IndexCount);
+
+		vertexData.Clear();
+		vertCount = table.VertexCount;
+		mappedFile = file;
+		mappedVertexData = data + table.VertexDataOffset;
+		Indices.SetSize(table.IndexCount);
+		memcpy(Indices.Buffer(), data + table.IndexDataOffset, Indices.Count() * sizeof(int));
+		BlendShapeVertices.SetSize(table.BlendShapeVertexCount);
+		if (table.BlendShapeVertexCount)
+			memcpy(BlendShapeVertices.Buffer(), data + table.BlendShapeVertexDataOffset, BlendShapeVertices.Count() * sizeof(BlendShapeVertex));
+		fileName = String("mesh_") + String(uid++);
+	}
+
+	void Mesh::DetachMappedVertexData()
+	{
+		auto source = mappedVertexData;
+		auto file = mappedFile;
+		mappedVertexData = nullptr;
+		mappedFile = nullptr;
+		vertexData.SetSize(vertCount * vertexFormat.GetVertexSize());
+		memcpy(vertexData.Buffer(), source, vertexData.Count());
+	}
+
 	Mesh::Mesh()
 	{
 		fileName = String("mesh_") + String(uid++);
@@ -127,9 +250,19 @@ namespace GameEngine
         return fileName;
     }
 
+	static void WritePadding(BinaryWriter & writer, int64_t start)
+	{
+		static const unsigned char zeros[MeshBlobAlignment] = {};
+		int64_t size = writer.GetStream()->GetPosition() - start;
+		int64_t padding = (MeshBlobAlignment - size % MeshBlobAlignment) % MeshBlobAlignment;
+		if (padding)
+			writer.Write(zeros, (int)padding);
+	}
+
 	void Mesh::SaveToStream(Stream * stream)
 	{
 		auto writer = BinaryWriter(stream);
+		int64_t start = stream->GetPosition();
 		MeshHeader header;
 		header.ElementCount = ElementRanges.Count();
         header.PrimitiveType = WritePrimitiveType(primitiveType);
@@ -137,29 +270,35 @@ namespace GameEngine
         header.SurfaceArea = surfaceArea;
         header.HasBlendShapes = BlendShapeVertices.Count() != 0;
 		writer.Write(header);
-		writer.Write(GetVertexTypeId());
-		writer.Write(vertCount);
-		writer.Write(Indices.Count());
-		writer.Write(&Bounds, 1);
-		writer.Write((char*)GetVertexBuffer(), vertCount * GetVertexSize());
+
+		// the blob offsets only depend on the size of the element meta data, so measure it first
+		RefPtr<MemoryStream> metaDataStream = new MemoryStream();
+		BinaryWriter metaDataWriter(metaDataStream);
+		WriteElementMetaData(metaDataWriter, *this, header);
+		metaDataWriter.ReleaseStream();
+		auto alignOffset = [](int64_t offset) { return (offset + MeshBlobAlignment - 1) / MeshBlobAlignment * MeshBlobAlignment; };
+
+		MeshBlobTable table;
+		table.VertexTypeId = GetVertexTypeId();
+		table.VertexCount = vertCount;
+		table.IndexCount = Indices.Count();
+		table.BlendShapeVertexCount = BlendShapeVertices.Count();
+		table.Bounds = Bounds;
+		table.VertexDataOffset = alignOffset(sizeof(MeshHeader) + sizeof(MeshBlobTable) + metaDataStream->GetPosition());
+		table.IndexDataOffset = alignOffset(table.VertexDataOffset + (int64_t)vertCount * GetVertexSize());
+		if (BlendShapeVertices.Count())
+			table.BlendShapeVertexDataOffset = alignOffset(table.IndexDataOffset + (int64_t)Indices.Count() * sizeof(int));
+		writer.Write(table);
+		writer.Write((const unsigned char*)metaDataStream->GetBuffer(), (int)metaDataStream->GetPosition());
+		WritePadding(writer, start);
+		writer.Write((const char*)GetVertexData(), vertCount * GetVertexSize());
+		WritePadding(writer, start);
 		writer.Write(Indices.Buffer(), Indices.Count());
-		writer.Write(ElementRanges.Buffer(), ElementRanges.Count());
-        if (header.HasBlendShapes)
-        {
-            writer.Write(ElementBlendShapeChannels.Count());
-            for (auto &blendShapeChannels : ElementBlendShapeChannels)
-            {
-                writer.Write(blendShapeChannels.Count());
-                for (auto &blendShapeChannel : blendShapeChannels)
-                {
-                    writer.Write(blendShapeChannel.Name);
-                    writer.Write(blendShapeChannel.ChannelId);
-                    writer.Write(blendShapeChannel.BlendShapes);
-                    writer.Write(blendShapeChannel.Reserved, sizeof(blendShapeChannel.Reserved));
-                }
-            }
-            writer.Write(BlendShapeVertices);
-        }
+		if (BlendShapeVertices.Count())
+		{
+			WritePadding(writer, start);
+			writer.Write(BlendShapeVertices.Buffer(), BlendShapeVertices.Count());
+		}
 		writer.ReleaseStream();
 	}
 
@@ -215,6 +354,8 @@ namespace GameEngine
 		Bounds.Init();
 		this->Indices.Clear();
 		this->vertexData.Clear();
+		mappedVertexData = nullptr;
+		mappedFile = nullptr;
 		SetVertexFormat(MeshVertexFormat(0, 0, true, true));
 		List<SkeletonMeshVertex> vertices;
 		List<Matrix4> forwardTransforms;
@@ -372,7 +513,7 @@ namespace GameEngine
 		int vertId = 0;
 		for (int i = 0; i < vertCount; i++)
 		{
-			ByteStreamView vert = ByteStreamView(vertexData.Buffer(), GetVertexSize() * i, GetVertexSize());
+			ByteStreamView vert = ByteStreamView(GetVertexPtr(), GetVertexSize() * i, GetVertexSize());
 			int id = -1;
 			if (!vertSet.TryGetValue(vert, id))
 			{
@@ -79,7 +79,11 @@ namespace GameEngine
 
 	class Skeleton;
 
-	const int CurrentMeshFileVersion = 1;
+	// Version 1 stores the mesh data sequentially after the header. Version 2 follows the header with a
+	// MeshBlobTable and stores the vertex, index and blend shape vertex blobs at MeshBlobAlignment aligned
+	// offsets, so that a memory mapped file can be uploaded without copying the vertices.
+	const int CurrentMeshFileVersion = 2;
+	const int MeshBlobAlignment = 4096;
 
 	struct MeshHeader
 	{
@@ -93,6 +97,21 @@ namespace GameEngine
         unsigned char Reserved[19] = { };
 	};
 
+	struct MeshBlobTable
+	{
+		int VertexTypeId = 0;
+		int VertexCount = 0;
+		int IndexCount = 0;
+		int BlendShapeVertexCount = 0;
+		CoreLib::Graphics::BBox Bounds;
+		int BlobAlignment = MeshBlobAlignment;
+		int Reserved = 0;
+		// offsets are relative to the start of the MeshHeader
+		int64_t VertexDataOffset = 0;
+		int64_t IndexDataOffset = 0;
+		int64_t BlendShapeVertexDataOffset = 0;
+	};
+
 	struct MeshElementRange
 	{
 		int StartIndex, Count;
@@ -143,8 +162,24 @@ namespace GameEngine
         int minLightmapResolution = 0;
         float surfaceArea = 0.0f;
 		CoreLib::Basic::List<unsigned char> vertexData;
+		// vertices of a mesh loaded from a paged file stay in the mapped file until they are modified
+		CoreLib::RefPtr<CoreLib::IO::MemoryMappedFile> mappedFile;
+		const unsigned char * mappedVertexData = nullptr;
 		int vertCount = 0;
 		CoreLib::String fileName;
+		unsigned char * GetVertexPtr()
+		{
+			return mappedVertexData ? (unsigned char*)mappedVertexData : vertexData.Buffer();
+		}
+		unsigned char * GetWritableVertexPtr()
+		{
+			if (mappedVertexData)
+				DetachMappedVertexData();
+			return vertexData.Buffer();
+		}
+		void DetachMappedVertexData();
+		void LoadFromMappedFile(CoreLib::IO::MemoryMappedFile * file);
+		void LoadPagedFromStream(CoreLib::IO::BinaryReader & reader, const MeshHeader & header, int64_t start);
 	public:
 		CoreLib::Graphics::BBox Bounds;
 		CoreLib::Basic::List<int> Indices;
@@ -162,11 +197,11 @@ namespace GameEngine
 		void SetVertexFormat(const MeshVertexFormat & value) { vertexFormat = value; }
 		void SetVertexPosition(int vertId, const VectorMath::Vec3 & pos)
 		{
-			*(VectorMath::Vec3*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize()) = pos;
+			*(VectorMath::Vec3*)(GetWritableVertexPtr() + vertId * vertexFormat.GetVertexSize()) = pos;
 		}
 		VectorMath::Vec3 GetVertexPosition(int vertId)
 		{
-			return *(VectorMath::Vec3*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize());
+			return *(VectorMath::Vec3*)(GetVertexPtr() + vertId * vertexFormat.GetVertexSize());
 		}
         void SetPrimitiveType(PrimitiveType type)
         {
@@ -178,24 +213,24 @@ namespace GameEngine
         }
 		void SetVertexUV(int vertId, int channelId, const VectorMath::Vec2 & uv)
 		{
-			auto destUV = (unsigned short*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetUVOffset(channelId));
+			auto destUV = (unsigned short*)(GetWritableVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetUVOffset(channelId));
 			destUV[0] = CoreLib::FloatToHalf(uv.x);
 			destUV[1] = CoreLib::FloatToHalf(uv.y);
 		}
 		VectorMath::Vec2 GetVertexUV(int vertId, int channelId)
 		{
-			auto destUV = (unsigned short*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetUVOffset(channelId));
+			auto destUV = (unsigned short*)(GetVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetUVOffset(channelId));
 			return VectorMath::Vec2::Create(CoreLib::HalfToFloat(destUV[0]), CoreLib::HalfToFloat(destUV[1]));
 		}
 		void SetVertexTangentFrame(int vertId, const VectorMath::Quaternion & vq)
 		{
             auto tangentFrame = PackTangentFrame(vq);
-            *(unsigned int *)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() +
+            *(unsigned int *)(GetWritableVertexPtr() + vertId * vertexFormat.GetVertexSize() +
                               vertexFormat.GetTangentFrameOffset()) = tangentFrame;
 		}
 		VectorMath::Quaternion GetVertexTangentFrame(int vertId)
 		{
-			unsigned int quat = *(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetTangentFrameOffset());
+			unsigned int quat = *(unsigned int*)(GetVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetTangentFrameOffset());
 			VectorMath::Quaternion result;
 			result.x = (quat & 255) * (2.0f / 255.0f) - 1.0f;
 			result.y = ((quat >> 8) & 255) * (2.0f / 255.0f) - 1.0f;
@@ -210,11 +245,11 @@ namespace GameEngine
 			packedQ[1] = (unsigned char)CoreLib::Math::Clamp((int)((color.y) * 255.0f), 0, 255);
 			packedQ[2] = (unsigned char)CoreLib::Math::Clamp((int)((color.z) * 255.0f), 0, 255);
 			packedQ[3] = (unsigned char)CoreLib::Math::Clamp((int)((color.w) * 255.0f), 0, 255);
-			*(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetColorOffset(channelId)) = packedQ[0] + (packedQ[1] << 8) + (packedQ[2] << 16) + (packedQ[3] << 24);
+			*(unsigned int*)(GetWritableVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetColorOffset(channelId)) = packedQ[0] + (packedQ[1] << 8) + (packedQ[2] << 16) + (packedQ[3] << 24);
 		}
 		VectorMath::Vec4 GetVertexColor(int vertId, int channelId)
 		{
-			unsigned int quat = *(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetColorOffset(channelId));
+			unsigned int quat = *(unsigned int*)(GetVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetColorOffset(channelId));
 			VectorMath::Vec4 result;
 			result.x = (quat & 255) * (1.0f / 255.0f);
 			result.y = ((quat >> 8) & 255) * (1.0f / 255.0f);
@@ -224,8 +259,8 @@ namespace GameEngine
 		}
 		void GetVertexSkinningBinding(int vertId, CoreLib::Array<int, 8> & boneIds, CoreLib::Array<float, 8> & boneWeights)
 		{
-			unsigned int vBoneIds = *(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneIdsOffset());
-			unsigned int vBoneWeights = *(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneWeightsOffset());
+			unsigned int vBoneIds = *(unsigned int*)(GetVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneIdsOffset());
+			unsigned int vBoneWeights = *(unsigned int*)(GetVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneWeightsOffset());
 			boneIds.Clear();
 			boneWeights.Clear();
 			for (int i = 0; i < 4; i++)
@@ -241,8 +276,8 @@ namespace GameEngine
 		}
 		void SetVertexSkinningBinding(int vertId, const CoreLib::ArrayView<int> & boneIds, const CoreLib::ArrayView<float> & boneWeights)
 		{
-			unsigned int & vBoneIds = *(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneIdsOffset());
-			unsigned int & vBoneWeights = *(unsigned int*)((unsigned char *)vertexData.Buffer() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneWeightsOffset());
+			unsigned int & vBoneIds = *(unsigned int*)(GetWritableVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneIdsOffset());
+			unsigned int & vBoneWeights = *(unsigned int*)(GetWritableVertexPtr() + vertId * vertexFormat.GetVertexSize() + vertexFormat.GetBoneWeightsOffset());
 			unsigned char cBoneIds[4], cWeights[4];
             for (int i = 0; i < 4; i++)
             {
@@ -261,16 +296,22 @@ namespace GameEngine
 			vBoneWeights = (unsigned int)(cWeights[0] + (cWeights[1] << 8) + (cWeights[2] << 16) + (cWeights[3] << 24));
 		}
 		int GetVertexSize() { return vertexFormat.GetVertexSize(); }
-		void * GetVertexBuffer() { return vertexData.Buffer(); }
+		// writable access copies the vertices out of a mapped mesh file, use GetVertexData() to read them
+		void * GetVertexBuffer() { return GetWritableVertexPtr(); }
+		const void * GetVertexData() { return GetVertexPtr(); }
 		int GetVertexCount() { return vertCount; }
 		int GetVertexTypeId() { return vertexFormat.GetTypeId(); }
 		void AllocVertexBuffer(int numVerts) 
 		{
+			mappedVertexData = nullptr;
+			mappedFile = nullptr;
 			vertexData.SetSize(vertexFormat.GetVertexSize() * numVerts);
 			vertCount = numVerts;
 		}
         void GrowVertexBuffer(int numVerts)
         {
+            if (mappedVertexData)
+                DetachMappedVertexData();
             if (vertexData.Capacity() < numVerts * vertexFormat.GetVertexSize())
             {
                 vertexData.Reserve((numVerts + numVerts / 2) * vertexFormat.GetVertexSize());
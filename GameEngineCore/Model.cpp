@@ -4,6 +4,7 @@
 #include "RendererService.h"
 #include "CoreLib/LibIO.h"
 #include "CoreLib/Tokenizer.h"
+#include <mutex>
 
 using namespace CoreLib;
 using namespace CoreLib::IO;
@@ -32,6 +33,14 @@ namespace GameEngine
 		LoadFromString(level, File::ReadAllText(fileName));
 	}
 	void Model::LoadFromString(Level * level, CoreLib::String content)
+	{
+		StringBuilder log;
+		LoadGeometry(content, log);
+		if (log.Length())
+			Print("%S", log.ProduceString().ToWString());
+		BindMaterials(level);
+	}
+	void Model::LoadGeometry(CoreLib::String content, CoreLib::StringBuilder & log)
 	{
 		materials.Clear();
 		materialFileNames.Clear();
@@ -52,7 +61,7 @@ namespace GameEngine
 				}
 				else
 				{
-					Print("error: cannot load mesh \'%S\'\n", meshFileName.ToWString());
+					log << "error: cannot load mesh \'" << meshFileName << "\'\n";
 				}
 			}
 			else if (word == "skeleton")
@@ -65,20 +74,28 @@ namespace GameEngine
 				}
 				else
 				{
-					Print("error: cannot load skeleton \'%S\'\n", skeletonFileName.ToWString());
+					log << "error: cannot load skeleton \'" << skeletonFileName << "\'\n";
 				}
 			}
 			else if (word == "material")
 			{
-				auto materialFileName = parser.ReadStringLiteral();
-				materialFileNames.Add(materialFileName);
-				materials.Add(level->LoadMaterial(materialFileName));
+				materialFileNames.Add(parser.ReadStringLiteral());
 			}
 		}
 		parser.Read("}");
+		if (meshFileName.Length())
+			InitPhysicsModel(Path::Combine(Engine::Instance()->GetDirectory(false, ResourceType::PhysicsCache),
+				GetPhysicsCacheName(meshFileName, skeletonFileName)), log);
+		else
+			InitPhysicsModel();
+	}
+	void Model::BindMaterials(Level * level)
+	{
+		materials.Clear();
+		for (auto & materialFileName : materialFileNames)
+			materials.Add(level->LoadMaterial(materialFileName));
 		for (int i = materials.Count(); i < mesh.ElementRanges.Count(); i++)
 			materials.Add(level->LoadMaterial("Error.material"));
-		InitPhysicsModel();
 	}
 	void Model::SaveToFile(CoreLib::String fileName)
 	{
@@ -120,6 +137,90 @@ namespace GameEngine
 		for (int i = 0; i < builders.Count(); i++)
 			physModels[i] = builders[i].GetModel();
 	}
+	static void HashPhysicsSourceBytes(uint64_t & hash, const void * data, size_t size)
+	{
+		auto bytes = (const unsigned char*)data;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(uint64_t));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+		for (; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	// hashes everything InitPhysicsModel reads from the mesh and skeleton
+	static uint64_t ComputePhysicsSourceChecksum(Mesh & mesh, int boneCount)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		int header[4] = { mesh.GetVertexTypeId(), mesh.GetVertexCount(), mesh.Indices.Count(), boneCount };
+		HashPhysicsSourceBytes(hash, header, sizeof(header));
+		HashPhysicsSourceBytes(hash, mesh.GetVertexData(), (size_t)mesh.GetVertexCount() * mesh.GetVertexSize());
+		HashPhysicsSourceBytes(hash, mesh.Indices.Buffer(), mesh.Indices.Count() * sizeof(int));
+		return hash;
+	}
+	// the cache is keyed by the relative paths of the mesh and skeleton, so that meshes with the same file
+	// name in different directories do not overwrite each other's cache
+	String Model::GetPhysicsCacheName(const String & meshFileName, const String & skeletonFileName)
+	{
+		auto key = Path::Normalize(meshFileName) + "|" + Path::Normalize(skeletonFileName);
+#ifdef WIN32
+		key = key.ToLower();
+#endif
+		uint64_t hash = 14695981039346656037ull;
+		HashPhysicsSourceBytes(hash, key.Buffer(), key.Length());
+		return Path::GetFileNameWithoutEXT(meshFileName) + "_" + String((unsigned long long)hash, 16) + ".phys";
+	}
+	// models that share a mesh may be loaded in parallel by Level::PreloadAssets
+	static std::mutex physicsCacheWriteMutex;
+	void Model::InitPhysicsModel(const CoreLib::String & cacheFileName, CoreLib::StringBuilder & log)
+	{
+		uint64_t checksum = ComputePhysicsSourceChecksum(mesh, skeleton.Bones.Count());
+		if (File::Exists(cacheFileName))
+		{
+			try
+			{
+				BinaryReader reader(new FileStream(cacheFileName));
+				if (reader.ReadInt32() == PhysicsModelFileVersion && (uint64_t)reader.ReadInt64() == checksum)
+				{
+					List<RefPtr<PhysicsModel>> models;
+					models.SetSize(reader.ReadInt32());
+					for (auto & model : models)
+					{
+						model = new PhysicsModel();
+						model->LoadFromStream(reader.GetStream());
+					}
+					// the checksum is repeated at the end to detect truncated files
+					if ((uint64_t)reader.ReadInt64() == checksum && models.Count() == Math::Max(1, skeleton.Bones.Count()))
+					{
+						physModels = _Move(models);
+						return;
+					}
+				}
+			}
+			catch (const IOException &)
+			{
+			}
+		}
+		InitPhysicsModel();
+		// a reader that sees a partially written cache rejects it by its checksums and rebuilds the models
+		std::lock_guard<std::mutex> lock(physicsCacheWriteMutex);
+		try
+		{
+			BinaryWriter writer(new FileStream(cacheFileName, FileMode::Create));
+			writer.Write(PhysicsModelFileVersion);
+			writer.Write(checksum);
+			writer.Write(physModels.Count());
+			for (auto & model : physModels)
+				model->SaveToStream(writer.GetStream());
+			writer.Write(checksum);
+		}
+		catch (const IOException &)
+		{
+			log << "warning: cannot write physics cache \'" << cacheFileName << "\'\n";
+		}
+	}
 	ModelDrawableInstance Model::GetDrawableInstance(const GetDrawablesParameter & params)
 	{
 		ModelDrawableInstance rs;
@@ -134,8 +235,7 @@ namespace GameEngine
 			Pose bindPose;
 			for (int j = 0; j < skeleton.Bones.Count(); j++)
 				bindPose.Transforms.Add(skeleton.Bones[j].BindPose);
-			for (auto & drawable : rs.Drawables)
-				drawable->UpdateTransformUniform(identityTransform, bindPose);
+			rs.UpdateTransformUniform(identityTransform, bindPose, nullptr, nullptr);
 		}
 		else
 		{
@@ -185,10 +285,18 @@ namespace GameEngine
     void ModelDrawableInstance::UpdateTransformUniform(VectorMath::Matrix4 localTransform, Pose &pose,
         RetargetFile *retargetFile, ArrayView<BlendShapeWeightInfo> *blendShapeInfo)
 	{
+        if (Drawables.Count() == 0)
+            return;
+        evaluatedPose.Update(Drawables[0]->GetSkeleton(), pose, retargetFile);
+        UpdateTransformUniform(localTransform, evaluatedPose, blendShapeInfo);
+	}
+    void ModelDrawableInstance::UpdateTransformUniform(VectorMath::Matrix4 localTransform, const PoseEvaluationCache &pose,
+        ArrayView<BlendShapeWeightInfo> *blendShapeInfo)
+	{
         int elementId = 0;
         for (auto &drawable : Drawables)
         {
-            drawable->UpdateTransformUniform(localTransform, pose, retargetFile, blendShapeInfo ? &(*blendShapeInfo)[elementId] : nullptr);
+            drawable->UpdateTransformUniform(localTransform, pose, blendShapeInfo ? &(*blendShapeInfo)[elementId] : nullptr);
             elementId++;
         }
 	}
@@ -199,12 +307,16 @@ namespace GameEngine
 	}
 	void ModelPhysicsInstance::SetTransform(VectorMath::Matrix4 localTransform, Pose & pose, RetargetFile * retarget)
 	{
-		List<Matrix4> matrices;
-		pose.GetMatrices(skeleton, matrices, true, retarget);
-		for (int i = 0; i < matrices.Count(); i++)
+		evaluatedPose.Update(skeleton, pose, retarget);
+		SetTransform(localTransform, evaluatedPose);
+	}
+	void ModelPhysicsInstance::SetTransform(VectorMath::Matrix4 localTransform, const PoseEvaluationCache & pose)
+	{
+		for (int i = 0; i < pose.Matrices.Count(); i++)
 		{
-			Matrix4::Multiply(matrices[i], localTransform, matrices[i]);
-			objects[i]->SetModelTransform(matrices[i]);
+			Matrix4 boneTransform;
+			Matrix4::Multiply(boneTransform, localTransform, pose.Matrices[i]);
+			objects[i]->SetModelTransform(boneTransform);
 		}
 	}
     void ModelPhysicsInstance::SetChannels(PhysicsChannels channels)
@@ -14,6 +14,8 @@ namespace GameEngine
 
 	class ModelDrawableInstance
 	{
+	private:
+		PoseEvaluationCache evaluatedPose;
 	public:
 		bool isSkeletal = false;
 		CoreLib::List<CoreLib::RefPtr<Drawable>> Drawables;
@@ -24,18 +26,22 @@ namespace GameEngine
 		void UpdateTransformUniform(VectorMath::Matrix4 localTransform);
         void UpdateTransformUniform(VectorMath::Matrix4 localTransform, Pose &pose, RetargetFile *retargetFile,
             CoreLib::ArrayView<BlendShapeWeightInfo> * blendShapeInfo);
+        void UpdateTransformUniform(VectorMath::Matrix4 localTransform, const PoseEvaluationCache & pose,
+            CoreLib::ArrayView<BlendShapeWeightInfo> * blendShapeInfo);
 	};
 
 	class ModelPhysicsInstance
 	{
 	private:
 		PhysicsScene * scene = nullptr;
+		PoseEvaluationCache evaluatedPose;
 	public:
 		bool isSkeletal = false;
 		Skeleton * skeleton = nullptr;
 		CoreLib::List<PhysicsObject*> objects;
 		void SetTransform(VectorMath::Matrix4 localTransform);
 		void SetTransform(VectorMath::Matrix4 localTransform, Pose & pose, RetargetFile * retargetFile);
+		void SetTransform(VectorMath::Matrix4 localTransform, const PoseEvaluationCache & pose);
         void SetChannels(PhysicsChannels channels);
 		void RemoveFromScene();
 		ModelPhysicsInstance(PhysicsScene * pScene)
@@ -58,6 +64,9 @@ namespace GameEngine
 		CoreLib::List<CoreLib::String> materialFileNames;
 		CoreLib::String skeletonFileName, meshFileName;
 		void InitPhysicsModel();
+		// loads the physics models from the cache file if it was written for the same mesh, otherwise builds and caches them
+		void InitPhysicsModel(const CoreLib::String & cacheFileName, CoreLib::StringBuilder & log);
+		static CoreLib::String GetPhysicsCacheName(const CoreLib::String & meshFileName, const CoreLib::String & skeletonFileName);
 	public:
 		Model() = default;
 		Model(Mesh * pMesh, Material * material);
@@ -65,6 +74,11 @@ namespace GameEngine
 
 		void LoadFromFile(Level * level, CoreLib::String fileName);
 		void LoadFromString(Level * level, CoreLib::String content);
+		// LoadFromString in two steps: LoadGeometry reads the mesh, skeleton and physics models without touching
+		// the level or printing (messages are appended to log), so that models can load in parallel;
+		// BindMaterials then loads the materials through the level.
+		void LoadGeometry(CoreLib::String content, CoreLib::StringBuilder & log);
+		void BindMaterials(Level * level);
 		void SaveToFile(CoreLib::String fileName);
 		CoreLib::Graphics::BBox GetBounds()
 		{
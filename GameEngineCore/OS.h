@@ -142,6 +142,18 @@ namespace GameEngine
         unsigned char* ImageData;
     };
 
+    // Glyph used to draw underlines, its one pixel wide bitmap is stretched over the underlined characters.
+    const unsigned int UnderlineGlyph = 0xFFFFFFFF;
+
+    // Position of a glyph bitmap in a text laid out by OsFontRasterizer::LayoutGlyphs, relative to the top left
+    // corner of the text.
+    struct GlyphPlacement
+    {
+        unsigned int Glyph;
+        int X, Y;
+        int Width, Height;
+    };
+
     class OsFontRasterizer : public CoreLib::RefObject
     {
     public:
@@ -149,6 +161,21 @@ namespace GameEngine
         virtual TextRasterizationResult RasterizeText(const CoreLib::String& text, const GraphicsUI::DrawTextOptions& options) = 0;
         virtual TextSize GetTextSize(const CoreLib::String& text, const GraphicsUI::DrawTextOptions& options) = 0;
         virtual TextSize GetTextSize(const CoreLib::List<unsigned int>& text, const GraphicsUI::DrawTextOptions& options) = 0;
+        // Lays out text as separately rasterized glyphs, so that it can be drawn from the UI glyph atlas.
+        // Rasterizers that can only rasterize whole strings return false.
+        virtual bool LayoutGlyphs(const CoreLib::String& /*text*/, const GraphicsUI::DrawTextOptions& /*options*/,
+            CoreLib::List<GlyphPlacement>& /*placements*/, TextSize& /*size*/)
+        {
+            return false;
+        }
+        // Rasterizes a glyph returned by LayoutGlyphs, the result is valid until the next call.
+        virtual TextRasterizationResult RasterizeGlyph(unsigned int /*glyph*/)
+        {
+            TextRasterizationResult rs;
+            rs.Size.x = rs.Size.y = 0;
+            rs.ImageData = nullptr;
+            return rs;
+        }
     };
 
     // ===============================================
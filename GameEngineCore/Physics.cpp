@@ -1,4 +1,6 @@
 #include "Physics.h"
+#include "CoreLib/JobSystem.h"
+#include <assert.h>
 using namespace VectorMath;
 namespace GameEngine
 {
@@ -51,7 +53,81 @@ namespace GameEngine
 		return true;
 	}
 
+	class PhysicsModelBvhEvaluator
+	{
+	public:
+		static const int ElementsPerNode = 4;
+		inline float EvalCost(int n1, float a1, int n2, float a2, float area)
+		{
+			return 0.125f + ((float)n1*a1 + (float)n2*a2) / area;
+		}
+	};
+
+	static inline float SafeRcp(float x)
+	{
+		// keep the reciprocal finite so that box tests never evaluate 0 * inf
+		if (x < 1e-20f && x > -1e-20f)
+			x = x < 0.0f ? -1e-20f : 1e-20f;
+		return 1.0f / x;
+	}
+
 	HitPoint PhysicsModel::TraceRay(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax)
+	{
+		HitPoint current;
+		current.Distance = tmax;
+		if (nodes.Count() == 0)
+			return current;
+		Vec3 rcpDir = Vec3::Create(SafeRcp(dir.x), SafeRcp(dir.y), SafeRcp(dir.z));
+		bool dirIsNeg[3] = { rcpDir.x < 0.0f, rcpDir.y < 0.0f, rcpDir.z < 0.0f };
+		// built trees are at most 62 levels deep and loaded trees are checked by LoadFromStream()
+		int todo[PhysicsModelMaxTraversalDepth];
+		int todoCount = 0;
+		int nodeId = 0;
+		while (true)
+		{
+			auto & node = nodes[nodeId];
+			float t0, t1;
+			// skip nodes that start behind the closest hit found so far
+			if (CoreLib::Graphics::RayBBoxIntersection_RcpDir(node.Bounds, origin, rcpDir, t0, t1) &&
+				t0 <= current.Distance && t1 >= tmin)
+			{
+				if (node.ElementCount > 0)
+				{
+					for (int i = node.ElementId; i < node.ElementId + node.ElementCount; i++)
+					{
+						HitPoint hit;
+						if (RayTriangleTest(hit, faces[i], origin, dir, tmin, current.Distance))
+						{
+							current = hit;
+							current.FaceId = i;
+						}
+					}
+				}
+				else
+				{
+					assert(todoCount < PhysicsModelMaxTraversalDepth);
+					// visit the child on the near side of the split first
+					if (dirIsNeg[node.Axis])
+					{
+						todo[todoCount++] = nodeId + 1;
+						nodeId += node.ChildOffset;
+					}
+					else
+					{
+						todo[todoCount++] = nodeId + node.ChildOffset;
+						nodeId++;
+					}
+					continue;
+				}
+			}
+			if (todoCount == 0)
+				break;
+			nodeId = todo[--todoCount];
+		}
+		return current;
+	}
+
+	HitPoint PhysicsModel::TraceRayLinear(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax)
 	{
 		HitPoint current;
 		current.Distance = tmax;
@@ -67,18 +143,53 @@ namespace GameEngine
 		return current;
 	}
 
+	static inline bool IsEmptyBox(const CoreLib::Graphics::BBox & box)
+	{
+		return box.xMin > box.xMax || box.yMin > box.yMax || box.zMin > box.zMax;
+	}
+
+	void PhysicsScene::UpdateBroadphase(PhysicsObject * obj)
+	{
+		auto bounds = obj->GetBounds();
+		// objects without faces have an empty box and can never be hit
+		if (IsEmptyBox(bounds))
+		{
+			if (obj->broadphaseLeaf != -1)
+			{
+				broadphase.Remove(obj->broadphaseLeaf);
+				obj->broadphaseLeaf = -1;
+			}
+		}
+		else if (obj->broadphaseLeaf == -1)
+			obj->broadphaseLeaf = broadphase.Insert(obj, bounds);
+		else
+			broadphase.Move(obj->broadphaseLeaf, bounds);
+		obj->ClearModelTransformDirtyBit();
+	}
+
 	void PhysicsScene::AddObject(PhysicsObject * obj)
 	{
 		objects.Add(obj);
+		UpdateBroadphase(obj);
 	}
 
 	void PhysicsScene::RemoveObject(PhysicsObject * obj)
 	{
+		if (obj->broadphaseLeaf != -1)
+		{
+			broadphase.Remove(obj->broadphaseLeaf);
+			obj->broadphaseLeaf = -1;
+		}
 		objects.Remove(obj);
 	}
 
 	void PhysicsScene::Tick()
 	{
+		for (auto & obj : objects)
+		{
+			if (obj->CheckModelTransformDirtyBit())
+				UpdateBroadphase(obj.Ptr());
+		}
 	}
 
 	TraceResult PhysicsScene::RayTraceFirst(const Ray & ray, PhysicsChannels channels, float maxDist)
@@ -86,38 +197,38 @@ namespace GameEngine
 		TraceResult rs;
 		HitPoint curHitPoint;
 		curHitPoint.Distance = maxDist;
-		for (auto obj : objects)
+		float dirLength = ray.Dir.Length();
+		broadphase.RayCast(ray.Origin, ray.Dir, maxDist / dirLength, [&](PhysicsObject * obj, float tEnter)
 		{
-            if ((obj->Channels.value & channels.value) == 0)
-                continue;
+			float tMax = curHitPoint.Distance / dirLength;
+			if ((obj->Channels.value & channels.value) == 0)
+				return tMax;
 			float tmin = 0.0f;
 			float tmax = 0.0f;
 			if (CoreLib::Graphics::RayBBoxIntersection(obj->GetBounds(), ray.Origin, ray.Dir, tmin, tmax))
 			{
-				if (tmax < maxDist)
+				// inverse transform ray
+				VectorMath::Vec3 objOrigin, objDir;
+				objOrigin = obj->GetInverseModelTransform().TransformHomogeneous(ray.Origin);
+				objDir = obj->GetInverseModelTransform().TransformNormal(ray.Dir);
+				float distScale = objDir.Length();
+				objDir *= 1.0f / distScale;
+				// perform object space ray casting
+				auto hit = obj->GetModel()->TraceRay(objOrigin, objDir, 0.0f, 1e30f);
+				if (hit.IsHit)
 				{
-					// inverse transform ray
-					VectorMath::Vec3 objOrigin, objDir;
-					objOrigin = obj->GetInverseModelTransform().TransformHomogeneous(ray.Origin);
-					objDir = obj->GetInverseModelTransform().TransformNormal(ray.Dir);
-					float distScale = objDir.Length();
-					objDir *= 1.0f / distScale;
-					// perform object space ray casting
-					auto hit = obj->GetModel()->TraceRay(objOrigin, objDir, 0.0f, 1e30f);
-                    if (hit.IsHit)
-                    {
-                        hit.Position = obj->GetModelTransform().TransformHomogeneous(hit.Position);
-                        hit.Distance = (ray.Origin - hit.Position).Length();
-
-                        if (hit.Distance < curHitPoint.Distance && hit.FaceId != -1)
-                        {
-                            curHitPoint = hit;
-                            rs.Object = obj.Ptr();
-                        }
-                    }
+					hit.Position = obj->GetModelTransform().TransformHomogeneous(hit.Position);
+					hit.Distance = (ray.Origin - hit.Position).Length();
+
+					if (hit.Distance < curHitPoint.Distance && hit.FaceId != -1)
+					{
+						curHitPoint = hit;
+						rs.Object = obj;
+					}
 				}
 			}
-		}
+			return curHitPoint.Distance / dirLength;
+		});
 		if (rs.Object)
 		{
 			rs.Object->GetInverseModelTransform().TransposeTransformNormal(rs.Normal, curHitPoint.GetNormal());
@@ -126,6 +237,52 @@ namespace GameEngine
 		return rs;
 	}
 
+	void PhysicsScene::RayTraceFirst(CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<TraceResult> results, PhysicsChannels channels, float maxDist)
+	{
+		CORELIB_ASSERT(results.Count() >= rays.Count());
+		CoreLib::Threading::JobSystem::ParallelFor(0, rays.Count(), 64, [&](int i)
+		{
+			results[i] = RayTraceFirst(rays[i], channels, maxDist);
+		});
+	}
+
+	void PhysicsScene::QueryOverlap(const CoreLib::Graphics::BBox & box, CoreLib::List<PhysicsObject*> & result, PhysicsChannels channels)
+	{
+		result.Clear();
+		broadphase.QueryOverlap(box, [&](PhysicsObject * obj)
+		{
+			if ((obj->Channels.value & channels.value) == 0)
+				return;
+			auto bounds = obj->GetBounds();
+			if (bounds.xMin <= box.xMax && bounds.yMin <= box.yMax && bounds.zMin <= box.zMax &&
+				bounds.xMax >= box.xMin && bounds.yMax >= box.yMin && bounds.zMax >= box.zMin)
+				result.Add(obj);
+		});
+	}
+
+	void PhysicsScene::QueryOverlap(const VectorMath::Vec3 & center, float radius, CoreLib::List<PhysicsObject*> & result, PhysicsChannels channels)
+	{
+		result.Clear();
+		CoreLib::Graphics::BBox box;
+		box.Min = center - Vec3::Create(radius);
+		box.Max = center + Vec3::Create(radius);
+		broadphase.QueryOverlap(box, [&](PhysicsObject * obj)
+		{
+			if ((obj->Channels.value & channels.value) == 0)
+				return;
+			// squared distance from the center to the closest point of the object bounds
+			auto bounds = obj->GetBounds();
+			float dist = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				float d = CoreLib::Math::Max(CoreLib::Math::Max(bounds.Min[i] - center[i], center[i] - bounds.Max[i]), 0.0f);
+				dist += d * d;
+			}
+			if (dist <= radius * radius)
+				result.Add(obj);
+		});
+	}
+
 	PhysicsModelBuilder::PhysicsModelBuilder()
 	{
 		model = new PhysicsModel();
@@ -168,17 +325,118 @@ namespace GameEngine
 		f.K_gamma_d = (c[u] * A[v] - c[v] * A[u]) * divisor;
 		f.PackedNormal = PackNormal(face.Normal);
 		model->faces.Add(f);
+		CoreLib::Graphics::BBox faceBox;
+		faceBox.Init();
 		for (int i = 0; i < 3; i++)
-			model->bounds.Union(face.Vertices[i]);
+			faceBox.Union(face.Vertices[i]);
+		faceBounds.Add(faceBox);
+		model->bounds.Union(faceBox);
 	}
 
 	CoreLib::RefPtr<PhysicsModel> PhysicsModelBuilder::GetModel()
 	{
 		auto rs = model;
 		model = nullptr;
+		auto & faces = rs->faces;
+		if (faces.Count())
+		{
+			List<BuildData<PhysicsModel::MeshFace>> elements;
+			elements.SetSize(faces.Count());
+			for (int i = 0; i < faces.Count(); i++)
+			{
+				elements[i].Element = faces.Buffer() + i;
+				elements[i].Bounds = faceBounds[i];
+				elements[i].Center = (faceBounds[i].Min + faceBounds[i].Max) * 0.5f;
+			}
+			Bvh_Build<PhysicsModel::MeshFace> bvhBuild;
+			PhysicsModelBvhEvaluator costEvaluator;
+			ConstructBvh(bvhBuild, elements.Buffer(), elements.Count(), costEvaluator);
+			Bvh<PhysicsModel::MeshFace> bvh;
+			bvh.FromBuild(bvhBuild);
+			rs->nodes = _Move(bvh.Nodes);
+			rs->faces = _Move(bvh.Elements);
+		}
+		faceBounds = List<CoreLib::Graphics::BBox>();
 		return rs;
 	}
 
+	// the number of interior nodes on the longest path from the root, -1 if the nodes do not form a tree over the faces
+	static int GetBvhTraversalDepth(const List<BvhNode> & nodes, int faceCount)
+	{
+		if (nodes.Count() == 0)
+			return 0;
+		struct PendingNode
+		{
+			int id, depth;
+		};
+		List<PendingNode> pending;
+		pending.Add(PendingNode{ 0, 0 });
+		int maxDepth = 0, visited = 0;
+		while (pending.Count())
+		{
+			auto node = pending.Last();
+			pending.RemoveAt(pending.Count() - 1);
+			if (++visited > nodes.Count())
+				return -1;
+			auto & bvhNode = nodes[node.id];
+			if (bvhNode.ElementCount < 0)
+				return -1;
+			if (bvhNode.ElementCount > 0)
+			{
+				if (bvhNode.ElementId < 0 || bvhNode.ElementId > faceCount - bvhNode.ElementCount)
+					return -1;
+				continue;
+			}
+			// children follow their parent, so a valid tree has no cycles
+			if (node.id + 1 >= nodes.Count() || bvhNode.ChildOffset <= 1 || bvhNode.ChildOffset >= nodes.Count() - node.id)
+				return -1;
+			maxDepth = Math::Max(maxDepth, node.depth + 1);
+			pending.Add(PendingNode{ node.id + 1, node.depth + 1 });
+			pending.Add(PendingNode{ node.id + bvhNode.ChildOffset, node.depth + 1 });
+		}
+		return visited == nodes.Count() ? maxDepth : -1;
+	}
+
+	void PhysicsModel::SaveToStream(CoreLib::IO::Stream * stream)
+	{
+		CoreLib::IO::BinaryWriter writer(stream);
+		writer.Write(PhysicsModelFileVersion);
+		writer.Write(bounds);
+		writer.Write(faces);
+		writer.Write(nodes);
+		writer.ReleaseStream();
+	}
+
+	void PhysicsModel::LoadFromStream(CoreLib::IO::Stream * stream)
+	{
+		CoreLib::IO::BinaryReader reader(stream);
+		int version = 0;
+		try
+		{
+			version = reader.ReadInt32();
+			if (version == PhysicsModelFileVersion)
+			{
+				reader.Read(bounds);
+				reader.Read(faces);
+				reader.Read(nodes);
+			}
+		}
+		catch (...)
+		{
+			// the reader must not free the caller's stream
+			reader.ReleaseStream();
+			throw;
+		}
+		reader.ReleaseStream();
+		if (version != PhysicsModelFileVersion)
+			throw CoreLib::IO::IOException("unsupported physics model version.");
+		if ((faces.Count() == 0) != (nodes.Count() == 0))
+			throw CoreLib::IO::IOException("invalid physics model data.");
+		int depth = GetBvhTraversalDepth(nodes, faces.Count());
+		if (depth < 0 || depth > PhysicsModelMaxTraversalDepth)
+			throw CoreLib::IO::IOException("invalid physics model data.");
+	}
+
 	Vec3 HitPoint::GetNormal()
 	{
 		return UnpackNormal(PackedNormal);
@@ -4,7 +4,10 @@
 #include "CoreLib/Basic.h"
 #include "CoreLib/VectorMath.h"
 #include "CoreLib/Graphics/BBox.h"
+#include "CoreLib/Stream.h"
 #include "Ray.h"
+#include "Bvh.h"
+#include "DynamicBvh.h"
 
 namespace GameEngine
 {
@@ -38,27 +41,44 @@ namespace GameEngine
 		};
 	private:
 		CoreLib::Graphics::BBox bounds;
+		// faces are stored in the leaf order of the BVH, HitPoint::FaceId indexes this list
 		CoreLib::List<MeshFace> faces;
+		CoreLib::List<BvhNode> nodes;
 		friend class PhysicsModelBuilder;
 	public:
 		int GetFaceCount()
 		{
 			return faces.Count();
 		}
+		int GetBvhNodeCount()
+		{
+			return nodes.Count();
+		}
 		CoreLib::Graphics::BBox GetBounds()
 		{
 			return bounds;
 		}
 		HitPoint TraceRay(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax);
+		// tests the ray against every face, serves as a reference for TraceRay
+		HitPoint TraceRayLinear(VectorMath::Vec3 origin, VectorMath::Vec3 dir, float tmin, float tmax);
+		// writes the faces together with the built BVH so that loading does not need to rebuild it
+		void SaveToStream(CoreLib::IO::Stream * stream);
+		void LoadFromStream(CoreLib::IO::Stream * stream);
 	};
 
+	const int PhysicsModelFileVersion = 1;
+	// PhysicsModel::TraceRay keeps one pending node per interior level, deeper trees are rejected when loaded
+	const int PhysicsModelMaxTraversalDepth = 256;
+
 	class PhysicsModelBuilder
 	{
 	private:
 		CoreLib::RefPtr<PhysicsModel> model;
+		CoreLib::List<CoreLib::Graphics::BBox> faceBounds;
 	public:
 		PhysicsModelBuilder();
 		void AddFace(const PhysicsModelFace & face);
+		// builds the BVH over all added faces and hands the model over to the caller
 		CoreLib::RefPtr<PhysicsModel> GetModel();
 	};
 
@@ -81,8 +101,10 @@ namespace GameEngine
 
 	class PhysicsObject : public CoreLib::RefObject
 	{
+		friend class PhysicsScene;
 	private:
 		CoreLib::RefPtr<PhysicsModel> model = nullptr;
+		int broadphaseLeaf = -1;
 		VectorMath::Matrix4 modelTransform, inverseModelTransform;
 		CoreLib::Graphics::BBox bounds;
 		bool modelTransformChanged = false;
@@ -147,15 +169,29 @@ namespace GameEngine
 		PhysicsObject * Object = nullptr;
 	};
 
+	// Objects are kept in a dynamic AABB tree over their world bounds. The tree stores boxes enlarged by a
+	// margin and is updated for the objects whose transform changed when Tick() is called, queries between
+	// two ticks see objects that moved beyond that margin at their previous location.
 	class PhysicsScene : public CoreLib::RefObject
 	{
 	private:
 		CoreLib::EnumerableHashSet<CoreLib::RefPtr<PhysicsObject>> objects;
+		DynamicBvh<PhysicsObject*> broadphase;
+		void UpdateBroadphase(PhysicsObject * obj);
 	public:
 		void AddObject(PhysicsObject * obj);
 		void RemoveObject(PhysicsObject * obj);
 		void Tick();
 		TraceResult RayTraceFirst(const Ray & ray, PhysicsChannels channels = PhysicsChannels::All, float maxDist = 1e30f);
+		// traces each ray independently, batches are spread across the job system
+		void RayTraceFirst(CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<TraceResult> results, PhysicsChannels channels = PhysicsChannels::All, float maxDist = 1e30f);
+		// collect the objects whose world bounds overlap a box or a sphere
+		void QueryOverlap(const CoreLib::Graphics::BBox & box, CoreLib::List<PhysicsObject*> & result, PhysicsChannels channels = PhysicsChannels::All);
+		void QueryOverlap(const VectorMath::Vec3 & center, float radius, CoreLib::List<PhysicsObject*> & result, PhysicsChannels channels = PhysicsChannels::All);
+		int GetBroadphaseHeight()
+		{
+			return broadphase.GetHeight();
+		}
 	};
 }
 
@@ -0,0 +1,100 @@
+#include "PipelineCompileQueue.h"
+#include "Engine.h"
+
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+
+namespace GameEngine
+{
+	void PipelineCompileTask::Compile()
+	{
+		Succeeded = Engine::GetShaderCompiler()->CompileShader(Result, EntryPoints.GetArrayView(), &Environment);
+	}
+
+	PipelineCompileQueue::~PipelineCompileQueue()
+	{
+		if (!worker)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			running = false;
+		}
+		queueCondition.notify_all();
+		worker->Join();
+	}
+
+	void PipelineCompileQueue::WorkerProc()
+	{
+		while (true)
+		{
+			PipelineCompileTask * task;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return !running || queuedTasks.Count() != 0; });
+				if (!running)
+					return;
+				task = queuedTasks.First();
+				queuedTasks.RemoveAt(0);
+				runningTask = task;
+			}
+			task->Compile();
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				runningTask = nullptr;
+				completedTasks.Add(task);
+			}
+			queueCondition.notify_all();
+		}
+	}
+
+	void PipelineCompileQueue::Enqueue(PipelineCompileTask * task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			queuedTasks.Add(task);
+			if (!worker)
+			{
+				running = true;
+				worker = new Thread(new ThreadProc([this]() { WorkerProc(); }));
+			}
+		}
+		queueCondition.notify_all();
+	}
+
+	void PipelineCompileQueue::TakeCompletedTasks(List<PipelineCompileTask*> & tasks)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		tasks.AddRange(completedTasks);
+		completedTasks.Clear();
+	}
+
+	void PipelineCompileQueue::Wait(PipelineCompileTask * task)
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		for (int i = 0; i < queuedTasks.Count(); i++)
+		{
+			if (queuedTasks[i] == task)
+			{
+				queuedTasks.RemoveAt(i);
+				lock.unlock();
+				task->Compile();
+				return;
+			}
+		}
+		queueCondition.wait(lock, [&]() { return runningTask != task; });
+		for (int i = 0; i < completedTasks.Count(); i++)
+		{
+			if (completedTasks[i] == task)
+			{
+				completedTasks.RemoveAt(i);
+				break;
+			}
+		}
+	}
+
+	int PipelineCompileQueue::GetPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		return queuedTasks.Count() + (runningTask ? 1 : 0);
+	}
+}
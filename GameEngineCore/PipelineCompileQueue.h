@@ -0,0 +1,50 @@
+#ifndef GAME_ENGINE_PIPELINE_COMPILE_QUEUE_H
+#define GAME_ENGINE_PIPELINE_COMPILE_QUEUE_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/Threading.h"
+#include "ShaderCompiler.h"
+#include <condition_variable>
+
+namespace GameEngine
+{
+	// Shader compilation of one pipeline. Everything the compiler needs is captured when the task
+	// is created, so that the task can be compiled on any thread.
+	class PipelineCompileTask : public CoreLib::RefObject
+	{
+	public:
+		CoreLib::Array<ShaderEntryPoint*, 2> EntryPoints;
+		ShaderCompilationEnvironment Environment;
+		ShaderCompilationResult Result;
+		bool Succeeded = false;
+		void Compile();
+	};
+
+	// Compiles pipeline shaders on a background thread, in the order the tasks are queued.
+	// Finished tasks are collected by the render thread with TakeCompletedTasks(). The queue does not
+	// own the tasks (reference counts are not thread safe), they must be kept alive until they are
+	// returned by TakeCompletedTasks() or waited on.
+	class PipelineCompileQueue
+	{
+	private:
+		CoreLib::RefPtr<CoreLib::Threading::Thread> worker;
+		std::mutex queueMutex;
+		std::condition_variable queueCondition;
+		CoreLib::List<PipelineCompileTask*> queuedTasks, completedTasks;
+		PipelineCompileTask * runningTask = nullptr;
+		bool running = false;
+		void WorkerProc();
+	public:
+		~PipelineCompileQueue();
+		void Enqueue(PipelineCompileTask * task);
+		// moves the tasks that finished compiling since the last call to `tasks`
+		void TakeCompletedTasks(CoreLib::List<PipelineCompileTask*> & tasks);
+		// Blocks until `task` is compiled. A task that has not been started yet is compiled on the
+		// calling thread. The task is not returned by TakeCompletedTasks() afterwards.
+		void Wait(PipelineCompileTask * task);
+		// number of queued tasks, including the one being compiled
+		int GetPendingCount();
+	};
+}
+
+#endif
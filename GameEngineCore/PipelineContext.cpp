@@ -77,43 +77,69 @@ namespace GameEngine
 			return pipeline->Ptr();
 		}
 		//lastKey = shaderKeyBuilder.Key;
-		lastPipeline = CreatePipeline(vertFormat, primType);
+		lastPipeline = nullptr;
+		if (failedPipelines.Contains(shaderKeyBuilder.Key))
+			return nullptr;
+		RefPtr<PendingPipeline> pending;
+		if (pendingPipelines.TryGetValue(shaderKeyBuilder.Key, pending))
+		{
+			if (asyncCompilation)
+				return nullptr;
+			// the pipeline is needed now but is still being compiled in the background
+			compileQueue.Wait(pending.Ptr());
+		}
+		else
+		{
+			pending = CreatePendingPipeline(vertFormat, primType);
+			if (asyncCompilation)
+			{
+				pendingPipelines[pending->Key] = pending;
+				compileQueue.Enqueue(pending.Ptr());
+				return nullptr;
+			}
+			pending->Compile();
+		}
+		if (renderStats)
+			renderStats->StalledPipelineCompiles++;
+		lastPipeline = CreatePipeline(pending.Ptr());
 		return lastPipeline;
 	}
 
-	PipelineClass * PipelineContext::CreatePipeline(MeshVertexFormat * vertFormat, PrimitiveType primType)
+	RefPtr<PendingPipeline> PipelineContext::CreatePendingPipeline(MeshVertexFormat * vertFormat, PrimitiveType primType)
 	{
-		RefPtr<PipelineBuilder> pipelineBuilder = hwRenderer->CreatePipelineBuilder();
-
-		pipelineBuilder->FixedFunctionStates = fixedFunctionStates;
-        pipelineBuilder->FixedFunctionStates.PrimitiveTopology = primType;
+		RefPtr<PendingPipeline> pending = new PendingPipeline();
+		pending->Key = shaderKeyBuilder.Key;
+		pending->FixedFunctionStates = fixedFunctionStates;
+		pending->FixedFunctionStates.PrimitiveTopology = primType;
+		pending->VertexLayout = LoadVertexFormat(*vertFormat);
+		pending->TargetLayout = renderTargetLayout;
+		for (int i = 0; i < modulePtr; i++)
+			pending->Environment.SpecializationTypes.Add(modules[i]->typeSymbol);
+		pending->Environment.SpecializationTypes.Add(vertFormat->GetTypeSymbol());
+		pending->EntryPoints.Add(vertexShaderEntryPoint);
+		pending->EntryPoints.Add(fragmentShaderEntryPoint);
+		return pending;
+	}
 
-		// Set vertex layout
-		pipelineBuilder->SetVertexLayout(LoadVertexFormat(*vertFormat));
+	PipelineClass * PipelineContext::CreatePipeline(PendingPipeline * pending)
+	{
+		RefPtr<PendingPipeline> pendingRef = pending;
+		pendingPipelines.Remove(pending->Key);
+		if (!pending->Succeeded)
+		{
+			failedPipelines.Add(pending->Key);
+			return nullptr;
+		}
+		auto & compileRs = pending->Result;
+		RefPtr<PipelineBuilder> pipelineBuilder = hwRenderer->CreatePipelineBuilder();
+		pipelineBuilder->FixedFunctionStates = pending->FixedFunctionStates;
+		pipelineBuilder->SetVertexLayout(pending->VertexLayout);
 
-		// Compile shaders
-        ShaderCompilationEnvironment env;
-        for (int i = 0; i < modulePtr; i++)
-        {
-            env.SpecializationTypes.Add(modules[i]->typeSymbol);
-        }
-        env.SpecializationTypes.Add(vertFormat->GetTypeSymbol());
-        struct CompilationTask
-        {
-            ShaderEntryPoint * entryPoint;
-            ShaderType shaderType;
-        };
         RefPtr<PipelineClass> pipelineClass = new PipelineClass();
         static int pipelineClassId = 0;
         pipelineClassId++;
         pipelineClass->Id = pipelineClassId;
-        Array<ShaderEntryPoint*, 2> entryPoints;
-        entryPoints.SetSize(2);
-        entryPoints[0] = vertexShaderEntryPoint;
-        entryPoints[1] = fragmentShaderEntryPoint;
 		List<RefPtr<DescriptorSetLayout>> descSetLayouts;
-        ShaderCompilationResult compileRs;
-        Engine::GetShaderCompiler()->CompileShader(compileRs, entryPoints.GetArrayView(), &env);
         auto vsObj = hwRenderer->CreateShader(ShaderType::VertexShader, compileRs.ShaderCode[0].Buffer(), compileRs.ShaderCode[0].Count());
         auto fsObj = hwRenderer->CreateShader(ShaderType::FragmentShader, compileRs.ShaderCode[1].Buffer(), compileRs.ShaderCode[1].Count());
         pipelineClass->shaders.Add(vsObj);
@@ -133,11 +159,29 @@ namespace GameEngine
         }
 		pipelineBuilder->SetShaders(From(pipelineClass->shaders).Select([](const RefPtr<Shader>& s) {return s.Ptr(); }).ToList().GetArrayView());
 		pipelineBuilder->SetBindingLayout(From(descSetLayouts).Select([](auto x) {return x.Ptr(); }).ToList().GetArrayView());
-		pipelineClass->pipeline = pipelineBuilder->ToPipeline(renderTargetLayout);
-		pipelineObjects[shaderKeyBuilder.Key] = pipelineClass;
+		pipelineClass->pipeline = pipelineBuilder->ToPipeline(pending->TargetLayout);
+		pipelineObjects[pending->Key] = pipelineClass;
 		return pipelineClass.Ptr();
 	}
 
+	void PipelineContext::PublishCompiledPipelines()
+	{
+		completedTasks.Clear();
+		compileQueue.TakeCompletedTasks(completedTasks);
+		for (auto task : completedTasks)
+		{
+			CreatePipeline(static_cast<PendingPipeline*>(task));
+			if (renderStats)
+				renderStats->CompletedPipelineCompiles++;
+		}
+		completedTasks.Clear();
+		if (renderStats)
+			renderStats->PendingPipelineCompiles = pendingPipelines.Count();
+		// the last lookup may have returned nullptr for a pipeline that is now available
+		shaderKeyChanged = true;
+		lastPipeline = nullptr;
+	}
+
 	void ModuleInstance::SetUniformData(void * data, int length, int dstOffset)
 	{
 #ifdef _DEBUG
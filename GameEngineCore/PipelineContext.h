@@ -2,6 +2,7 @@
 #define GAME_ENGINE_PIPELINE_CONTEXT_H
 
 #include "ShaderCompiler.h"
+#include "PipelineCompileQueue.h"
 #include "HardwareRenderer.h"
 #include "DeviceMemory.h"
 #include "EngineLimits.h"
@@ -92,6 +93,10 @@ namespace GameEngine
 		{
 			return currentDescriptor;
 		}
+		void SetCurrentVersion(int version)
+		{
+			currentDescriptor = version;
+		}
 		operator bool()
 		{
 			return typeSymbol != nullptr;
@@ -111,6 +116,16 @@ namespace GameEngine
 
 	class RenderStat;
 
+	// a pipeline whose shaders are being compiled, with the pipeline states captured when it was requested
+	class PendingPipeline : public PipelineCompileTask
+	{
+	public:
+		ShaderKey Key;
+		FixedFunctionPipelineStates FixedFunctionStates;
+		VertexFormat VertexLayout;
+		RenderTargetLayout * TargetLayout = nullptr;
+	};
+
 	class PipelineContext
 	{
 	private:
@@ -129,8 +144,15 @@ namespace GameEngine
 		HardwareRenderer * hwRenderer;
 		RenderStat * renderStats = nullptr;
 		CoreLib::Dictionary<int, VertexFormat> vertexFormats;
+		bool asyncCompilation = false;
+		CoreLib::EnumerableDictionary<ShaderKey, CoreLib::RefPtr<PendingPipeline>> pendingPipelines;
+		CoreLib::HashSet<ShaderKey> failedPipelines;
+		CoreLib::List<PipelineCompileTask*> completedTasks;
+		// declared after pendingPipelines so that the compile thread is stopped before the tasks are released
+		PipelineCompileQueue compileQueue;
 		PipelineClass * GetPipelineInternal(MeshVertexFormat * vertFormat, int vtxId, PrimitiveType primType);
-		PipelineClass* CreatePipeline(MeshVertexFormat * vertFormat, PrimitiveType primType);
+		CoreLib::RefPtr<PendingPipeline> CreatePendingPipeline(MeshVertexFormat * vertFormat, PrimitiveType primType);
+		PipelineClass * CreatePipeline(PendingPipeline * pending);
 	public:
 		PipelineContext() = default;
 		void Init(HardwareRenderer * hw, RenderStat * pRenderStats)
@@ -143,6 +165,19 @@ namespace GameEngine
 			return renderStats;
 		}
 		VertexFormat LoadVertexFormat(MeshVertexFormat vertFormat);
+		// When enabled, the shaders of a pipeline that does not exist yet are compiled on a background thread
+		// and GetPipeline() returns nullptr until the pipeline is published by PublishCompiledPipelines().
+		// When disabled, GetPipeline() compiles missing pipelines on the calling thread.
+		void SetAsyncCompilation(bool enable)
+		{
+			asyncCompilation = enable;
+		}
+		bool IsAsyncCompilation()
+		{
+			return asyncCompilation;
+		}
+		// creates the pipelines whose shaders finished compiling, called once per frame before rendering
+		void PublishCompiledPipelines();
 		void BindEntryPoint(ShaderEntryPoint * pVS, ShaderEntryPoint * pFS, RenderTargetLayout * pRenderTargetLayout, FixedFunctionPipelineStates * states)
 		{
 			vertexShaderEntryPoint = pVS;
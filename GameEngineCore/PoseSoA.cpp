@@ -0,0 +1,459 @@
+#include "PoseSoA.h"
+#include "CoreLib/FrameAllocator.h"
+#include "CoreLib/JobSystem.h"
+#include <smmintrin.h>
+
+using namespace VectorMath;
+using namespace CoreLib;
+
+namespace GameEngine
+{
+	namespace
+	{
+		enum PoseStream
+		{
+			RX, RY, RZ, RW, TX, TY, TZ, SX, SY, SZ
+		};
+
+		const float IdentityStreamValues[PoseSoA::StreamCount] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+
+		// arithmetic operators on __m128 come from VectorMath when compiling with MSVC
+		typedef __m128 Lanes;
+		const int LaneCount = 4;
+		inline Lanes LoadLanes(const float * p) { return _mm_loadu_ps(p); }
+		inline void StoreLanes(float * p, Lanes v) { _mm_storeu_ps(p, v); }
+		inline Lanes Splat(float v) { return _mm_set1_ps(v); }
+		inline Lanes Sqrt(Lanes v) { return _mm_sqrt_ps(v); }
+		// flips the sign of v in the lanes where sign is negative
+		inline Lanes MulSign(Lanes v, Lanes sign) { return _mm_xor_ps(v, _mm_and_ps(sign, _mm_set1_ps(-0.0f))); }
+		static_assert(PoseSoA::PaddingGranularity % LaneCount == 0, "pose padding must cover a whole SIMD register");
+
+		// LaneCount bones, one register per stream
+		struct BoneLanes
+		{
+			Lanes V[PoseSoA::StreamCount];
+			void Load(const float * const * streams, int offset)
+			{
+				for (int s = 0; s < PoseSoA::StreamCount; s++)
+					V[s] = LoadLanes(streams[s] + offset);
+			}
+			void Store(float * const * streams, int offset) const
+			{
+				for (int s = 0; s < PoseSoA::StreamCount; s++)
+					StoreLanes(streams[s] + offset, V[s]);
+			}
+		};
+
+		// bones gathered from scattered sources into SIMD friendly storage
+		struct BoneBlock
+		{
+			alignas(32) float Values[PoseSoA::StreamCount][LaneCount];
+			void Set(int lane, const BoneTransformation & transform)
+			{
+				Values[RX][lane] = transform.Rotation.x; Values[RY][lane] = transform.Rotation.y;
+				Values[RZ][lane] = transform.Rotation.z; Values[RW][lane] = transform.Rotation.w;
+				Values[TX][lane] = transform.Translation.x; Values[TY][lane] = transform.Translation.y;
+				Values[TZ][lane] = transform.Translation.z;
+				Values[SX][lane] = transform.Scale.x; Values[SY][lane] = transform.Scale.y; Values[SZ][lane] = transform.Scale.z;
+			}
+			BoneLanes Load() const
+			{
+				BoneLanes result;
+				for (int s = 0; s < PoseSoA::StreamCount; s++)
+					result.V[s] = LoadLanes(Values[s]);
+				return result;
+			}
+			void Store(const BoneLanes & bones)
+			{
+				for (int s = 0; s < PoseSoA::StreamCount; s++)
+					StoreLanes(Values[s], bones.V[s]);
+			}
+		};
+
+		inline void NormalizeRotation(BoneLanes & b)
+		{
+			Lanes invLength = Splat(1.0f) / Sqrt(b.V[RX] * b.V[RX] + b.V[RY] * b.V[RY] + b.V[RZ] * b.V[RZ] + b.V[RW] * b.V[RW]);
+			for (int s = RX; s <= RW; s++)
+				b.V[s] = b.V[s] * invLength;
+		}
+
+		// q0 * q1, same evaluation order as Quaternion::operator *
+		inline void MultiplyRotation(Lanes * result, const Lanes * q0, const Lanes * q1)
+		{
+			Lanes x = q0[3] * q1[0] + q0[0] * q1[3] + q0[1] * q1[2] - q0[2] * q1[1];
+			Lanes y = q0[3] * q1[1] + q0[1] * q1[3] + q0[2] * q1[0] - q0[0] * q1[2];
+			Lanes z = q0[3] * q1[2] + q0[2] * q1[3] + q0[0] * q1[1] - q0[1] * q1[0];
+			Lanes w = q0[3] * q1[3] - q0[0] * q1[0] - q0[1] * q1[1] - q0[2] * q1[2];
+			result[0] = x; result[1] = y; result[2] = z; result[3] = w;
+		}
+
+		inline BoneLanes Interpolate(const BoneLanes & b0, const BoneLanes & b1, Lanes t)
+		{
+			BoneLanes result;
+			Lanes invT = Splat(1.0f) - t;
+			Lanes dot = b0.V[RX] * b1.V[RX] + b0.V[RY] * b1.V[RY] + b0.V[RZ] * b1.V[RZ] + b0.V[RW] * b1.V[RW];
+			for (int s = RX; s <= RW; s++)
+				result.V[s] = b0.V[s] * invT + MulSign(b1.V[s], dot) * t;
+			NormalizeRotation(result);
+			for (int s = TX; s <= SZ; s++)
+				result.V[s] = b0.V[s] * invT + b1.V[s] * t;
+			return result;
+		}
+
+		// composes T * R * S of LaneCount bones into matrices, with the same arithmetic as BoneTransformation::ToMatrix
+		void ComposeMatrices(const BoneBlock & block, Matrix4 * matrices, int count)
+		{
+			auto b = block.Load();
+			Lanes one = Splat(1.0f), two = Splat(2.0f), zero = Splat(0.0f);
+			Lanes & x = b.V[RX], & y = b.V[RY], & z = b.V[RZ], & w = b.V[RW];
+			alignas(32) float columns[16][LaneCount];
+			StoreLanes(columns[0], (one - two * (y * y + z * z)) * b.V[SX]);
+			StoreLanes(columns[1], two * (x * y + w * z) * b.V[SX]);
+			StoreLanes(columns[2], two * (x * z - w * y) * b.V[SX]);
+			StoreLanes(columns[3], zero);
+			StoreLanes(columns[4], two * (x * y - w * z) * b.V[SY]);
+			StoreLanes(columns[5], (one - two * (x * x + z * z)) * b.V[SY]);
+			StoreLanes(columns[6], two * (y * z + w * x) * b.V[SY]);
+			StoreLanes(columns[7], zero);
+			StoreLanes(columns[8], two * (x * z + w * y) * b.V[SZ]);
+			StoreLanes(columns[9], two * (y * z - w * x) * b.V[SZ]);
+			StoreLanes(columns[10], (one - two * (x * x + y * y)) * b.V[SZ]);
+			StoreLanes(columns[11], zero);
+			StoreLanes(columns[12], b.V[TX]);
+			StoreLanes(columns[13], b.V[TY]);
+			StoreLanes(columns[14], b.V[TZ]);
+			StoreLanes(columns[15], one);
+			// transpose groups of 4 lanes into one matrix column per bone
+			for (int g = 0; g < count; g += 4)
+			{
+				int groupCount = Math::Min(4, count - g);
+				for (int c = 0; c < 4; c++)
+				{
+					__m128 r0 = _mm_load_ps(columns[c * 4] + g);
+					__m128 r1 = _mm_load_ps(columns[c * 4 + 1] + g);
+					__m128 r2 = _mm_load_ps(columns[c * 4 + 2] + g);
+					__m128 r3 = _mm_load_ps(columns[c * 4 + 3] + g);
+					_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+					__m128 rows[4] = { r0, r1, r2, r3 };
+					for (int k = 0; k < groupCount; k++)
+						_mm_storeu_ps(matrices[g + k].values + c * 4, rows[k]);
+				}
+			}
+		}
+
+		struct BoneRotationOverride
+		{
+			BoneTransformation transform;
+			float weight;
+		};
+
+		// Pose::GetMatrices on a pose accessed through getTransform(boneId)
+		template<typename TGetTransform>
+		void ComputePoseMatricesImpl(List<Matrix4> & matrices, const Skeleton * skeleton, RetargetFile * retarget,
+			const Dictionary<String, float> * blendShapeWeights, bool multiplyInversePose, const TGetTransform & getTransform)
+		{
+			int boneCount = skeleton->Bones.Count();
+			matrices.Clear();
+			matrices.SetSize(boneCount);
+			FrameList<FrameList<BoneRotationOverride>> morphStateOverrides;
+			if (retarget && retarget->MorphStates.Count() && blendShapeWeights)
+			{
+				morphStateOverrides.SetSize(boneCount);
+				for (auto & weight : *blendShapeWeights)
+				{
+					if (weight.Value == 0.0f)
+						continue;
+					int msId = retarget->MorphStates.FindFirst([&](auto & ms) { return ms.Name == weight.Key; });
+					if (msId != -1)
+					{
+						for (auto bs : retarget->MorphStates[msId].BoneStates)
+							morphStateOverrides[bs.BoneId].Add(BoneRotationOverride{ bs.Transform, weight.Value });
+					}
+				}
+			}
+
+			// Consider the case that the skeleton for animation may contain less bones than the skeleton for mesh
+			// So, we should skip those missing bones and using its bind pose
+			int animatedBoneCount = skeleton->BoneMapping.Count();
+			auto getLocalTransform = [&](int i) -> BoneTransformation
+			{
+				if (i >= animatedBoneCount)
+					return retarget ? retarget->RetargetedBindPose[i] : skeleton->Bones[i].BindPose;
+				BoneTransformation transform;
+				if (!retarget)
+				{
+					transform = getTransform(i);
+					if (i != 0)
+						transform.Translation = skeleton->Bones[i].BindPose.Translation;
+					return transform;
+				}
+				int targetId = retarget->ModelBoneIdToAnimationBoneId[i];
+				if (targetId != -1)
+					transform = getTransform(targetId);
+				if (i == 0)
+				{
+					transform.Translation.x *= retarget->RootTranslationScale.x;
+					transform.Translation.y *= retarget->RootTranslationScale.y;
+					transform.Translation.z *= retarget->RootTranslationScale.z;
+				}
+				else
+					transform.Translation = retarget->RetargetedBindPose[i].Translation;
+				auto rotation = retarget->PreRotations[i] * transform.Rotation;
+				if (morphStateOverrides.Count() && morphStateOverrides[i].Count())
+				{
+					for (auto & bs : morphStateOverrides[i])
+					{
+						rotation = Quaternion::Slerp(rotation, bs.transform.Rotation, bs.weight * 0.01f);
+						transform.Translation = Vec3::Lerp(transform.Translation, bs.transform.Translation, bs.weight * 0.01f);
+					}
+				}
+				transform.Rotation = rotation * retarget->PostRotations[i];
+				transform.Scale = Vec3::Create(1.0f, 1.0f, 1.0f);
+				return transform;
+			};
+			BoneBlock block;
+			for (int j = 0; j < boneCount; j += LaneCount)
+			{
+				int laneCount = Math::Min(LaneCount, boneCount - j);
+				for (int k = 0; k < LaneCount; k++)
+					block.Set(k, k < laneCount ? getLocalTransform(j + k) : BoneTransformation());
+				ComposeMatrices(block, matrices.Buffer() + j, laneCount);
+			}
+
+			for (int i = 1; i < boneCount; i++)
+				Matrix4::Multiply(matrices[i], matrices[skeleton->Bones[i].ParentId], matrices[i]);
+
+			if (multiplyInversePose)
+			{
+				auto & inversePose = retarget ? retarget->RetargetedInversePose : skeleton->InversePose;
+				for (int i = 0; i < boneCount; i++)
+					Matrix4::Multiply(matrices[i], matrices[i], inversePose[i]);
+			}
+		}
+	}
+
+	void PoseSoA::GetStreams(float ** streams)
+	{
+		List<float> * lists[StreamCount] = { &RotationX, &RotationY, &RotationZ, &RotationW,
+			&TranslationX, &TranslationY, &TranslationZ, &ScaleX, &ScaleY, &ScaleZ };
+		for (int s = 0; s < StreamCount; s++)
+			streams[s] = lists[s]->Buffer();
+	}
+
+	void PoseSoA::GetStreams(const float ** streams) const
+	{
+		const List<float> * lists[StreamCount] = { &RotationX, &RotationY, &RotationZ, &RotationW,
+			&TranslationX, &TranslationY, &TranslationZ, &ScaleX, &ScaleY, &ScaleZ };
+		for (int s = 0; s < StreamCount; s++)
+			streams[s] = lists[s]->Buffer();
+	}
+
+	void PoseSoA::SetSize(int size)
+	{
+		int initializedCount = Math::Min(count, size);
+		count = size;
+		int paddedSize = (size + PaddingGranularity - 1) / PaddingGranularity * PaddingGranularity;
+		List<float> * lists[StreamCount] = { &RotationX, &RotationY, &RotationZ, &RotationW,
+			&TranslationX, &TranslationY, &TranslationZ, &ScaleX, &ScaleY, &ScaleZ };
+		for (int s = 0; s < StreamCount; s++)
+		{
+			lists[s]->SetSize(paddedSize);
+			for (int i = initializedCount; i < paddedSize; i++)
+				(*lists[s])[i] = IdentityStreamValues[s];
+		}
+	}
+
+	void PoseSoA::CopyFrom(const PoseSoA & pose)
+	{
+		if (&pose == this)
+			return;
+		SetSize(pose.Count());
+		float * dst[StreamCount];
+		const float * src[StreamCount];
+		GetStreams(dst);
+		pose.GetStreams(src);
+		for (int s = 0; s < StreamCount; s++)
+			memcpy(dst[s], src[s], PaddedCount() * sizeof(float));
+	}
+
+	void PoseSoA::SetBindPose(const Skeleton * skeleton)
+	{
+		SetSize(skeleton->Bones.Count());
+		for (int i = 0; i < count; i++)
+			Set(i, skeleton->Bones[i].BindPose);
+	}
+
+	void PoseSoA::FromPose(const Pose & pose)
+	{
+		SetSize(pose.Transforms.Count());
+		for (int i = 0; i < count; i++)
+			Set(i, pose.Transforms[i]);
+	}
+
+	void PoseSoA::ToPose(Pose & pose) const
+	{
+		pose.Transforms.SetSize(count);
+		for (int i = 0; i < count; i++)
+			pose.Transforms[i] = Get(i);
+	}
+
+	void AnimationBinding::Bind(const Skeleton * pSkeleton, const SkeletalAnimation * pAnim)
+	{
+		skeleton = pSkeleton;
+		animation = pAnim;
+		Channels.Clear();
+		ChannelBoneIds.Clear();
+		for (int i = 0; i < pAnim->Channels.Count(); i++)
+		{
+			int boneId = -1;
+			if (pAnim->Channels[i].KeyFrames.Count() && pSkeleton->BoneMapping.TryGetValue(pAnim->Channels[i].BoneName, boneId))
+			{
+				Channels.Add(i);
+				ChannelBoneIds.Add(boneId);
+			}
+		}
+		BindPose.SetBindPose(pSkeleton);
+	}
+
+	void SampleAnimation(PoseSoA & result, const AnimationBinding & binding, float animTime)
+	{
+		result.CopyFrom(binding.BindPose);
+		auto & channels = binding.GetAnimation()->Channels;
+		float * dst[PoseSoA::StreamCount];
+		result.GetStreams(dst);
+		BoneBlock keys0, keys1;
+		alignas(32) float t[LaneCount];
+		for (int c = 0; c < binding.Channels.Count(); c += LaneCount)
+		{
+			int laneCount = Math::Min(LaneCount, binding.Channels.Count() - c);
+			for (int k = 0; k < LaneCount; k++)
+			{
+				t[k] = 0.0f;
+				if (k >= laneCount)
+				{
+					keys0.Set(k, BoneTransformation());
+					keys1.Set(k, BoneTransformation());
+					continue;
+				}
+				// same key selection as AnimationChannel::Sample
+				auto & keyFrames = channels[binding.Channels[c + k]].KeyFrames;
+				int frame0 = BinarySearchForKeyFrame(keyFrames, animTime);
+				int frame1 = 0;
+				if (frame0 < keyFrames.Count() - 1)
+				{
+					frame1 = frame0 + 1;
+					t[k] = (animTime - keyFrames[frame0].Time) / (keyFrames[frame1].Time - keyFrames[frame0].Time);
+				}
+				keys0.Set(k, keyFrames[frame0].Transform);
+				keys1.Set(k, keyFrames[frame1].Transform);
+			}
+			keys0.Store(Interpolate(keys0.Load(), keys1.Load(), LoadLanes(t)));
+			for (int k = 0; k < laneCount; k++)
+			{
+				int boneId = binding.ChannelBoneIds[c + k];
+				for (int s = 0; s < PoseSoA::StreamCount; s++)
+					dst[s][boneId] = keys0.Values[s][k];
+			}
+		}
+	}
+
+	void BlendPoses(PoseSoA & result, const PoseSoA & pose0, const PoseSoA & pose1, float weight)
+	{
+		result.SetSize(pose0.Count());
+		float * dst[PoseSoA::StreamCount];
+		const float * src0[PoseSoA::StreamCount], * src1[PoseSoA::StreamCount];
+		result.GetStreams(dst);
+		pose0.GetStreams(src0);
+		pose1.GetStreams(src1);
+		Lanes t = Splat(weight);
+		for (int j = 0; j < result.PaddedCount(); j += LaneCount)
+		{
+			BoneLanes b0, b1;
+			b0.Load(src0, j);
+			b1.Load(src1, j);
+			Interpolate(b0, b1, t).Store(dst, j);
+		}
+	}
+
+	void MakeAdditivePose(PoseSoA & result, const PoseSoA & pose, const PoseSoA & reference)
+	{
+		result.SetSize(pose.Count());
+		float * dst[PoseSoA::StreamCount];
+		const float * src[PoseSoA::StreamCount], * ref[PoseSoA::StreamCount];
+		result.GetStreams(dst);
+		pose.GetStreams(src);
+		reference.GetStreams(ref);
+		for (int j = 0; j < result.PaddedCount(); j += LaneCount)
+		{
+			BoneLanes b, r, additive;
+			b.Load(src, j);
+			r.Load(ref, j);
+			Lanes inverseReference[4] = { Splat(0.0f) - r.V[RX], Splat(0.0f) - r.V[RY], Splat(0.0f) - r.V[RZ], r.V[RW] };
+			MultiplyRotation(additive.V + RX, inverseReference, b.V + RX);
+			for (int s = TX; s <= TZ; s++)
+				additive.V[s] = b.V[s] - r.V[s];
+			for (int s = SX; s <= SZ; s++)
+				additive.V[s] = b.V[s] / r.V[s];
+			additive.Store(dst, j);
+		}
+	}
+
+	void AddPose(PoseSoA & result, const PoseSoA & base, const PoseSoA & additive, float weight)
+	{
+		result.SetSize(base.Count());
+		float * dst[PoseSoA::StreamCount];
+		const float * src[PoseSoA::StreamCount], * add[PoseSoA::StreamCount];
+		result.GetStreams(dst);
+		base.GetStreams(src);
+		additive.GetStreams(add);
+		BoneLanes identity;
+		for (int s = 0; s < PoseSoA::StreamCount; s++)
+			identity.V[s] = Splat(IdentityStreamValues[s]);
+		Lanes t = Splat(weight);
+		for (int j = 0; j < result.PaddedCount(); j += LaneCount)
+		{
+			BoneLanes b, a;
+			b.Load(src, j);
+			a.Load(add, j);
+			// scale the additive pose by weight, then apply it in the local space of the base pose
+			auto weighted = Interpolate(identity, a, t);
+			BoneLanes r;
+			MultiplyRotation(r.V + RX, b.V + RX, weighted.V + RX);
+			for (int s = TX; s <= TZ; s++)
+				r.V[s] = b.V[s] + weighted.V[s];
+			for (int s = SX; s <= SZ; s++)
+				r.V[s] = b.V[s] * weighted.V[s];
+			r.Store(dst, j);
+		}
+	}
+
+	void ComputePoseMatrices(List<Matrix4> & matrices, const Skeleton * skeleton, const PoseSoA & pose,
+		RetargetFile * retarget, const Dictionary<String, float> * blendShapeWeights, bool multiplyInversePose)
+	{
+		ComputePoseMatricesImpl(matrices, skeleton, retarget, blendShapeWeights, multiplyInversePose,
+			[&](int i) { return pose.Get(i); });
+	}
+
+	void ComputePoseMatrices(List<Matrix4> & matrices, const Skeleton * skeleton, const Pose & pose,
+		RetargetFile * retarget, bool multiplyInversePose)
+	{
+		ComputePoseMatricesImpl(matrices, skeleton, retarget, &pose.BlendShapeWeights, multiplyInversePose,
+			[&](int i) { return pose.Transforms[i]; });
+	}
+
+	void EvaluatePoses(ArrayView<PoseEvaluationTask> tasks)
+	{
+		const int tasksPerJob = 8;
+		Threading::JobSystem::ParallelFor(0, tasks.Count(), tasksPerJob, [&](int i)
+		{
+			auto & task = tasks[i];
+			if (task.Animation)
+				SampleAnimation(*task.Pose, *task.Animation, task.AnimationTime);
+			if (task.Matrices)
+			{
+				auto skeleton = task.TargetSkeleton ? task.TargetSkeleton : task.Animation->GetSkeleton();
+				ComputePoseMatrices(*task.Matrices, skeleton, *task.Pose, task.Retarget, task.BlendShapeWeights);
+			}
+		});
+	}
+}
@@ -0,0 +1,126 @@
+#ifndef GAME_ENGINE_POSE_SOA_H
+#define GAME_ENGINE_POSE_SOA_H
+
+#include "Skeleton.h"
+
+namespace GameEngine
+{
+	// Bone transformations of a pose stored as structure of arrays, one stream per component.
+	// Storage is padded to a multiple of 8 bones so that SIMD loops never read past the arrays;
+	// padding bones hold the identity transform.
+	class PoseSoA
+	{
+	private:
+		int count = 0;
+	public:
+		static const int PaddingGranularity = 8;
+		static const int StreamCount = 10;
+		CoreLib::List<float> RotationX, RotationY, RotationZ, RotationW;
+		CoreLib::List<float> TranslationX, TranslationY, TranslationZ;
+		CoreLib::List<float> ScaleX, ScaleY, ScaleZ;
+		int Count() const
+		{
+			return count;
+		}
+		// number of bones including padding
+		int PaddedCount() const
+		{
+			return RotationX.Count();
+		}
+		// streams in the order of the members above
+		void GetStreams(float ** streams);
+		void GetStreams(const float ** streams) const;
+		void SetSize(int size);
+		void CopyFrom(const PoseSoA & pose);
+		void Set(int i, const BoneTransformation & transform)
+		{
+			RotationX[i] = transform.Rotation.x; RotationY[i] = transform.Rotation.y;
+			RotationZ[i] = transform.Rotation.z; RotationW[i] = transform.Rotation.w;
+			TranslationX[i] = transform.Translation.x; TranslationY[i] = transform.Translation.y;
+			TranslationZ[i] = transform.Translation.z;
+			ScaleX[i] = transform.Scale.x; ScaleY[i] = transform.Scale.y; ScaleZ[i] = transform.Scale.z;
+		}
+		BoneTransformation Get(int i) const
+		{
+			BoneTransformation transform;
+			transform.Rotation = VectorMath::Quaternion(RotationX[i], RotationY[i], RotationZ[i], RotationW[i]);
+			transform.Translation = VectorMath::Vec3::Create(TranslationX[i], TranslationY[i], TranslationZ[i]);
+			transform.Scale = VectorMath::Vec3::Create(ScaleX[i], ScaleY[i], ScaleZ[i]);
+			return transform;
+		}
+		void SetBindPose(const Skeleton * skeleton);
+		// converts bone transforms only, blend shape weights are not part of a PoseSoA
+		void FromPose(const Pose & pose);
+		void ToPose(Pose & pose) const;
+	};
+
+	// Maps the channels of an animation to the bones of a skeleton. Built once and shared by every instance
+	// that plays the animation on the skeleton, so that sampling neither looks up bone names nor writes
+	// to the animation.
+	class AnimationBinding
+	{
+	private:
+		const Skeleton * skeleton = nullptr;
+		const SkeletalAnimation * animation = nullptr;
+	public:
+		// channels that drive a bone of the skeleton and their bone ids
+		CoreLib::List<int> Channels, ChannelBoneIds;
+		PoseSoA BindPose;
+		AnimationBinding() = default;
+		AnimationBinding(const Skeleton * pSkeleton, const SkeletalAnimation * pAnim)
+		{
+			Bind(pSkeleton, pAnim);
+		}
+		void Bind(const Skeleton * pSkeleton, const SkeletalAnimation * pAnim);
+		const Skeleton * GetSkeleton() const
+		{
+			return skeleton;
+		}
+		const SkeletalAnimation * GetAnimation() const
+		{
+			return animation;
+		}
+	};
+
+	// The kernels below process 4 bones per SSE instruction. Rotations are
+	// interpolated with a normalized lerp along the shorter arc. The result may alias any input pose.
+
+	// Samples the animation at animTime (in clip time, no wrapping). Bones without a channel get the bind pose.
+	void SampleAnimation(PoseSoA & result, const AnimationBinding & binding, float animTime);
+	// Interpolates every bone from pose0 (weight 0) to pose1 (weight 1).
+	void BlendPoses(PoseSoA & result, const PoseSoA & pose0, const PoseSoA & pose1, float weight);
+	// Expresses a pose relative to a reference pose, for use with AddPose.
+	// Rotations become conj(reference) * pose, translations differences and scales ratios.
+	void MakeAdditivePose(PoseSoA & result, const PoseSoA & pose, const PoseSoA & reference);
+	// Applies an additive pose on top of base, scaled by weight.
+	void AddPose(PoseSoA & result, const PoseSoA & base, const PoseSoA & additive, float weight);
+
+	// Skinning matrices of a pose, identical to Pose::GetMatrices. Local matrices are composed 4 bones
+	// per instruction before they are concatenated along the hierarchy.
+	// blendShapeWeights drive the morph states of the retarget file.
+	void ComputePoseMatrices(CoreLib::List<VectorMath::Matrix4> & matrices, const Skeleton * skeleton, const PoseSoA & pose,
+		RetargetFile * retarget = nullptr, const CoreLib::Dictionary<CoreLib::String, float> * blendShapeWeights = nullptr,
+		bool multiplyInversePose = true);
+	void ComputePoseMatrices(CoreLib::List<VectorMath::Matrix4> & matrices, const Skeleton * skeleton, const Pose & pose,
+		RetargetFile * retarget = nullptr, bool multiplyInversePose = true);
+
+	// One skeletal instance of a batch evaluation.
+	struct PoseEvaluationTask
+	{
+		// when set, Pose receives the animation sampled at AnimationTime; otherwise Pose is the input
+		const AnimationBinding * Animation = nullptr;
+		float AnimationTime = 0.0f;
+		PoseSoA * Pose = nullptr;
+		// defaults to the skeleton of Animation
+		const Skeleton * TargetSkeleton = nullptr;
+		RetargetFile * Retarget = nullptr;
+		const CoreLib::Dictionary<CoreLib::String, float> * BlendShapeWeights = nullptr;
+		// receives the skinning matrices of the pose, skipped if null
+		CoreLib::List<VectorMath::Matrix4> * Matrices = nullptr;
+	};
+
+	// Samples and skins the poses of many instances in one call. Large batches are split across the job system.
+	void EvaluatePoses(CoreLib::ArrayView<PoseEvaluationTask> tasks);
+}
+
+#endif
@@ -163,6 +163,15 @@ namespace GameEngine
 		sb << "]";
 	}
 
+	void Property::WriteBinary(CoreLib::IO::BinaryWriter & writer)
+	{
+		writer.Write(GetStringValue());
+	}
+
+	void Property::ReadBinary(CoreLib::IO::BinaryReader & reader)
+	{
+		SetStringValue(reader.ReadString());
+	}
 
 	void PropertyContainer::FreeRegistry()
 	{
@@ -3,6 +3,7 @@
 
 #include "CoreLib/Basic.h"
 #include "CoreLib/Events.h"
+#include "CoreLib/Stream.h"
 #include "CoreLib/Tokenizer.h"
 #include "CoreLib/VectorMath.h"
 #include <type_traits>
@@ -40,6 +41,9 @@ namespace GameEngine
 	public:
 		virtual void ParseValue(CoreLib::Text::TokenReader & parser) = 0;
 		virtual void Serialize(CoreLib::StringBuilder & sb) = 0;
+		// binary form of the value used by compiled levels, types without one store their text form
+		virtual void WriteBinary(CoreLib::IO::BinaryWriter & writer);
+		virtual void ReadBinary(CoreLib::IO::BinaryReader & reader);
 	public:
 		CoreLib::Event<> OnChanged;
 		CoreLib::String GetStringValue()
@@ -241,6 +245,17 @@ namespace GameEngine
 			OnChanging(newValue);
 			value = newValue;
 		}
+		virtual void WriteBinary(CoreLib::IO::BinaryWriter & writer) override
+		{
+			writer.Write(value);
+		}
+		virtual void ReadBinary(CoreLib::IO::BinaryReader & reader) override
+		{
+			T newValue;
+			reader.Read(newValue);
+			OnChanging(newValue);
+			value = newValue;
+		}
 	public:
 		PUBLIC_METHODS(T)
 	};
@@ -284,11 +299,36 @@ namespace GameEngine
 			value = _Move(newValue);
 			OnChanged();
 		}
+		virtual void WriteBinary(CoreLib::IO::BinaryWriter & writer) override
+		{
+			writer.Write(value.Count());
+			for (auto & val : value)
+			{
+				GenericProperty<T> p;
+				p.WriteValue(val);
+				p.WriteBinary(writer);
+			}
+		}
+		virtual void ReadBinary(CoreLib::IO::BinaryReader & reader) override
+		{
+			CoreLib::List<T> newValue;
+			int count = reader.ReadInt32();
+			newValue.Reserve(count);
+			for (int i = 0; i < count; i++)
+			{
+				GenericProperty<T> p;
+				p.ReadBinary(reader);
+				newValue.Add(p.GetValue());
+			}
+			OnChanging(newValue);
+			value = _Move(newValue);
+			OnChanged();
+		}
 	public:
 		PUBLIC_METHODS(CoreLib::List<T>)
 	};
 
-#define BASIC_TYPE_PROPERTY(type, readerFunc, writerExpr) \
+#define BASIC_TYPE_PROPERTY(type, readerFunc, writerExpr, binaryReaderFunc) \
 	template<> \
 	class GenericPropertyHelper<type, std::is_trivially_copyable<type>::value> : public Property \
 	{ \
@@ -307,16 +347,27 @@ namespace GameEngine
 		{\
 			type newValue = (type)parser.readerFunc();\
 			OnChanging(newValue); \
+            value = newValue;\
+			OnChanged();\
+		}\
+		virtual void WriteBinary(CoreLib::IO::BinaryWriter & writer) override \
+		{ \
+			writer.Write(value);\
+		} \
+		virtual void ReadBinary(CoreLib::IO::BinaryReader & reader) override\
+		{\
+			type newValue = (type)reader.binaryReaderFunc();\
+			OnChanging(newValue); \
             value = newValue;\
 			OnChanged();\
 		}\
 		PUBLIC_METHODS(type)\
 	};
-	BASIC_TYPE_PROPERTY(int, ReadInt, value)
-	BASIC_TYPE_PROPERTY(unsigned int, ReadUInt, value)
-	BASIC_TYPE_PROPERTY(float, ReadFloat, CoreLib::String(value, "%.8g"))
-	BASIC_TYPE_PROPERTY(double, ReadDouble, CoreLib::String(value, "%.15g"))
-	BASIC_TYPE_PROPERTY(CoreLib::String, ReadStringLiteral, CoreLib::Text::EscapeStringLiteral(value))
+	BASIC_TYPE_PROPERTY(int, ReadInt, value, ReadInt32)
+	BASIC_TYPE_PROPERTY(unsigned int, ReadUInt, value, ReadInt32)
+	BASIC_TYPE_PROPERTY(float, ReadFloat, CoreLib::String(value, "%.8g"), ReadFloat)
+	BASIC_TYPE_PROPERTY(double, ReadDouble, CoreLib::String(value, "%.15g"), ReadDouble)
+	BASIC_TYPE_PROPERTY(CoreLib::String, ReadStringLiteral, CoreLib::Text::EscapeStringLiteral(value), ReadString)
 	
 	template<>
 	class GenericPropertyHelper<bool, std::is_trivially_copyable<bool>::value> : public Property
@@ -339,6 +390,17 @@ namespace GameEngine
 			value = newValue;
 			OnChanged();
 		}
+		virtual void WriteBinary(CoreLib::IO::BinaryWriter & writer) override
+		{
+			writer.Write((char)(value ? 1 : 0));
+		}
+		virtual void ReadBinary(CoreLib::IO::BinaryReader & reader) override
+		{
+			bool newValue = reader.ReadChar() != 0;
+			OnChanging(newValue);
+			value = newValue;
+			OnChanged();
+		}
 	public:
 		PUBLIC_METHODS(bool)
 	};
@@ -369,6 +431,18 @@ namespace GameEngine
 				values(newValue, i) = parser.ReadFloat();\
 			parser.Read("]");\
 			OnChanging(newValue);\
+            value = newValue;\
+			OnChanged();\
+		}\
+		virtual void WriteBinary(CoreLib::IO::BinaryWriter & writer) override\
+		{\
+			writer.Write(value);\
+		}\
+		virtual void ReadBinary(CoreLib::IO::BinaryReader & reader) override\
+		{\
+			VectorMath::type newValue; \
+			reader.Read(newValue);\
+			OnChanging(newValue);\
             value = newValue;\
 			OnChanged();\
 		}\
@@ -7,6 +7,7 @@
 #include "TextureCompressor.h"
 #include "WorldRenderPass.h"
 #include "CoreLib/LibIO.h"
+#include "CoreLib/JobSystem.h"
 #include "CoreLib/Graphics/TextureFile.h"
 #include <assert.h>
 
@@ -62,7 +63,10 @@ namespace GameEngine
                         }
                     }
                     );
-                    scene->instanceUniformMemory.Sync(ptr0, moduleInstance.BufferLength);
+                    // materials that bind streamed textures use a different version in each frame
+                    for (int i = 1; i < DynamicBufferLengthMultiplier; i++)
+                        memcpy(ptr0 + moduleInstance.BufferLength * i, ptr0, moduleInstance.BufferLength);
+                    scene->instanceUniformMemory.Sync(ptr0, moduleInstance.BufferLength * DynamicBufferLengthMultiplier);
                 }
             };
             update(material->MaterialModule);
@@ -88,6 +92,7 @@ namespace GameEngine
 			throw InvalidOperationException("cannot update non-static drawable with static transform data.");
 		if (!transformModule->UniformMemory)
 			throw InvalidOperationException("invalid buffer.");
+		worldTransform = localTransform;
 		transformModule->SetUniformData((void*)&localTransform, sizeof(Matrix4), 16);
 	}
 
@@ -102,6 +107,14 @@ namespace GameEngine
 
 	void Drawable::UpdateTransformUniform(const VectorMath::Matrix4 &localTransform, const Pose &pose,
         RetargetFile *retarget, BlendShapeWeightInfo *blendShapeInfo)
+	{
+		PoseEvaluationCache evaluatedPose;
+		evaluatedPose.Update(skeleton, pose, retarget);
+		UpdateTransformUniform(localTransform, evaluatedPose, blendShapeInfo);
+	}
+
+	void Drawable::UpdateTransformUniform(const VectorMath::Matrix4 &localTransform, const PoseEvaluationCache &evaluatedPose,
+		BlendShapeWeightInfo *blendShapeInfo)
 	{
 		if (type != DrawableType::Skeletal)
 			throw InvalidOperationException("cannot update static drawable with skeletal transform data.");
@@ -111,20 +124,12 @@ namespace GameEngine
 		// ensure allocated transform buffer is sufficient 
 		assert(transformModule->BufferLength >= sizeof(SkeletalAnimationTransform));
 
-		List<Matrix4> matrices;
-		pose.GetMatrices(skeleton, matrices, true, retarget);
         SkeletalAnimationTransform transformData;
         transformData.worldMat = localTransform;
-        for (int i = 0; i < matrices.Count(); i++)
-        {
-            DualQuaternion dq;
-            dq.FromRotationTranslation(Quaternion::FromMatrix(matrices[i].GetMatrix3()),
-                VectorMath::Vec3::Create(matrices[i].values[12], matrices[i].values[13], matrices[i].values[14]));
-            transformData.boneTransforms[i] = dq;
-        }
+		CORELIB_ASSERT(evaluatedPose.BoneTransforms.Count() <= 90);
+		memcpy(transformData.boneTransforms, evaluatedPose.BoneTransforms.Buffer(), evaluatedPose.BoneTransforms.Count() * sizeof(DualQuaternion));
         if (blendShapeInfo)
         {
-			transformData.blendShapeCount = blendShapeInfo->Weights.Count();
             CORELIB_ASSERT(blendShapeInfo->Weights.Count() <= MaxBlendShapes);
             for (int i = 0; i < blendShapeInfo->Weights.Count(); i++)
             {
@@ -146,7 +151,7 @@ namespace GameEngine
         result->vertexCount = mesh->GetVertexCount();
         result->blendShapeVertexCount = mesh->BlendShapeVertices.Count();
         rendererResource->indexBufferMemory.SetDataAsync(result->indexBufferOffset, mesh->Indices.Buffer(), mesh->Indices.Count() * sizeof(mesh->Indices[0]));
-        rendererResource->vertexBufferMemory.SetDataAsync(result->vertexBufferOffset, mesh->GetVertexBuffer(), mesh->GetVertexCount() * result->vertexFormat.Size());
+        rendererResource->vertexBufferMemory.SetDataAsync(result->vertexBufferOffset, (void*)mesh->GetVertexData(), mesh->GetVertexCount() * result->vertexFormat.Size());
         result->indexCount = mesh->Indices.Count();
         if (mesh->BlendShapeVertices.Count())
         {
@@ -177,16 +182,10 @@ namespace GameEngine
 		meshes[mesh->GetUID()] = result;
 		return result;
 	}
-	Texture2D * SceneResource::LoadTexture2D(const String & name, CoreLib::Graphics::TextureFile & data)
+	static bool GetDeviceTextureFormat(CoreLib::Graphics::TextureStorageFormat fileFormat, StorageFormat & format, DataType & dataType)
 	{
-		RefPtr<Texture2D> value;
-		if (textures.TryGetValue(name, value))
-			return value.Ptr();
-		StorageFormat format;
-		DataType dataType = DataType::Byte4;
-		char * textureData = (char*)data.GetBuffer().Buffer();
-		CoreLib::List<char> translatedData;
-		switch (data.GetFormat())
+		dataType = DataType::Byte4;
+		switch (fileFormat)
 		{
 		case CoreLib::Graphics::TextureStorageFormat::R8:
 			format = StorageFormat::R_8;
@@ -199,8 +198,6 @@ namespace GameEngine
 		case CoreLib::Graphics::TextureStorageFormat::RGB8:
 			format = StorageFormat::RGBA_8;
 			dataType = DataType::Byte4;
-			translatedData = Graphics::TranslateThreeChannelTextureFormat(textureData, data.GetWidth()*data.GetHeight(), 1);
-			textureData = translatedData.Buffer();
 			break;
 		case CoreLib::Graphics::TextureStorageFormat::RGBA8:
 			format = StorageFormat::RGBA_8;
@@ -217,8 +214,6 @@ namespace GameEngine
 		case CoreLib::Graphics::TextureStorageFormat::RGB_F32:
 			format = StorageFormat::RGBA_F32;
 			dataType = DataType::Float4;
-			translatedData = Graphics::TranslateThreeChannelTextureFormat(textureData, data.GetWidth() * data.GetHeight(), 4);
-			textureData = translatedData.Buffer();
 			break;
 		case CoreLib::Graphics::TextureStorageFormat::RGBA_F32:
 			format = StorageFormat::RGBA_F32;
@@ -233,22 +228,80 @@ namespace GameEngine
 		case CoreLib::Graphics::TextureStorageFormat::BC5:
 			format = StorageFormat::BC5;
 			break;
+		case CoreLib::Graphics::TextureStorageFormat::BC6H:
+			format = StorageFormat::BC6H;
+			break;
+		case CoreLib::Graphics::TextureStorageFormat::BC7:
+			format = StorageFormat::RGBA_Compressed;
+			break;
 		default:
+			return false;
+		}
+		return true;
+	}
+
+	Texture2D * SceneResource::CreateTexture2D(const String & name, CoreLib::Graphics::TextureFile & data)
+	{
+		StorageFormat format;
+		DataType dataType;
+		if (!GetDeviceTextureFormat(data.GetFormat(), format, dataType))
 			throw NotImplementedException("unsupported texture format.");
+		char * textureData = (char*)data.GetBuffer().Buffer();
+		CoreLib::List<char> translatedData;
+		if (data.GetFormat() == CoreLib::Graphics::TextureStorageFormat::RGB8)
+		{
+			translatedData = Graphics::TranslateThreeChannelTextureFormat(textureData, data.GetWidth()*data.GetHeight(), 1);
+			textureData = translatedData.Buffer();
+		}
+		else if (data.GetFormat() == CoreLib::Graphics::TextureStorageFormat::RGB_F32)
+		{
+			translatedData = Graphics::TranslateThreeChannelTextureFormat(textureData, data.GetWidth() * data.GetHeight(), 4);
+			textureData = translatedData.Buffer();
 		}
 
 		auto hw = rendererResource->hardwareRenderer.Ptr();
 
-		GameEngine::Texture2D* rs;
-		if (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB || format == StorageFormat::BC5 || format == StorageFormat::BC3)
+		if (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB || format == StorageFormat::BC5 || format == StorageFormat::BC3 ||
+			format == StorageFormat::BC6H || format == StorageFormat::RGBA_Compressed)
 		{
 			Array<void*, 32> mipData;
 			for(int level = 0; level < data.GetMipLevels(); level++)
 				mipData.Add(data.GetBuffer(level).Buffer());
-			rs = hw->CreateTexture2D(name, TextureUsage::Sampled, data.GetWidth(), data.GetHeight(), data.GetMipLevels(), format, dataType, mipData.GetArrayView());
+			return hw->CreateTexture2D(name, TextureUsage::Sampled, data.GetWidth(), data.GetHeight(), data.GetMipLevels(), format, dataType, mipData.GetArrayView());
 		}
 		else
-			rs = hw->CreateTexture2D(name, data.GetWidth(), data.GetHeight(), format, dataType, textureData);
+			return hw->CreateTexture2D(name, data.GetWidth(), data.GetHeight(), format, dataType, textureData);
+	}
+	static bool IsBlockCompressed(CoreLib::Graphics::TextureStorageFormat format)
+	{
+		return format == CoreLib::Graphics::TextureStorageFormat::BC1 || format == CoreLib::Graphics::TextureStorageFormat::BC3 ||
+			format == CoreLib::Graphics::TextureStorageFormat::BC5 || format == CoreLib::Graphics::TextureStorageFormat::BC6H ||
+			format == CoreLib::Graphics::TextureStorageFormat::BC7;
+	}
+	Texture2D * SceneResource::CreateTexture2D(const String & name, CoreLib::Graphics::TextureFileReader & reader)
+	{
+		StorageFormat format;
+		DataType dataType;
+		auto & header = reader.GetHeader();
+		if (!GetDeviceTextureFormat(header.Format, format, dataType))
+			throw NotImplementedException("unsupported texture format.");
+		auto hw = rendererResource->hardwareRenderer.Ptr();
+		RefPtr<Texture2D> texture = hw->CreateTexture2D(name, TextureUsage::Sampled, header.Width, header.Height, reader.GetMipLevels(), format);
+		// each level is read into the same upload buffer and copied to the device before the next one is read
+		for (int level = 0; level < reader.GetMipLevels(); level++)
+		{
+			textureUploadBuffer.SetSize((int)reader.GetLevelSize(level));
+			reader.ReadLevel(textureUploadBuffer.GetArrayView());
+			texture->SetData(level, reader.GetLevelWidth(level), reader.GetLevelHeight(level), 1, dataType, textureUploadBuffer.Buffer());
+		}
+		return texture.Release();
+	}
+	Texture2D * SceneResource::LoadTexture2D(const String & name, CoreLib::Graphics::TextureFile & data)
+	{
+		RefPtr<Texture2D> value;
+		if (textures.TryGetValue(name, value))
+			return value.Ptr();
+		auto rs = CreateTexture2D(name, data);
 		textures[name] = rs;
 		return rs;
 	}
@@ -265,23 +318,26 @@ namespace GameEngine
 		{
 			if (actualFilename.ToLower().EndsWith(".texture"))
 			{
+				{
+					// compressed levels need no conversion and are read one at a time instead of loading the whole file
+					FileStream stream(actualFilename);
+					CoreLib::Graphics::TextureFileReader reader(&stream);
+					if (IsBlockCompressed(reader.GetHeader().Format))
+					{
+						auto rs = CreateTexture2D(filename, reader);
+						textures[filename] = rs;
+						return rs;
+					}
+				}
 				CoreLib::Graphics::TextureFile file(actualFilename);
 				return LoadTexture2D(filename, file);
 			}
 			else
 			{
 				CoreLib::Imaging::Bitmap bmp(actualFilename);
-				List<unsigned int> pixelsInversed;
-                int *sourcePixels = (int *)bmp.GetPixels();
-                pixelsInversed.SetSize(bmp.GetWidth() * bmp.GetHeight());
-                for (int i = 0; i < bmp.GetHeight(); i++)
-                {
-                    for (int j = 0; j < bmp.GetWidth(); j++)
-                        pixelsInversed[i * bmp.GetWidth() + j] =
-                            sourcePixels[(bmp.GetHeight() - 1 - i) * bmp.GetWidth() + j];
-                }
 				CoreLib::Graphics::TextureFile texFile;
-				TextureCompressor::CompressRGBA_BC1(texFile, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), bmp.GetWidth(), bmp.GetHeight());
+				TextureCompressor::CompressTopDownRGBA(texFile, CoreLib::Graphics::TextureStorageFormat::BC1,
+					MakeArrayView((unsigned char*)bmp.GetPixels(), bmp.GetWidth() * bmp.GetHeight() * 4), bmp.GetWidth(), bmp.GetHeight());
 				texFile.SaveToFile(Path::ReplaceExt(actualFilename, "texture"));
 				return LoadTexture2D(filename, texFile);
 			}
@@ -301,6 +357,176 @@ namespace GameEngine
 		}
 	}
 
+	bool StreamedTexture::Read()
+	{
+		// the levels are read straight into the texture file buffer, without an intermediate copy of the file
+		try
+		{
+			FileStream stream(fileName);
+			textureFile = CoreLib::Graphics::TextureFile(&stream);
+			return true;
+		}
+		catch (const Exception &)
+		{
+			return false;
+		}
+	}
+
+	bool StreamedTexture::Decode()
+	{
+		StorageFormat format;
+		DataType dataType;
+		if (!GetDeviceTextureFormat(textureFile.GetFormat(), format, dataType))
+			return false;
+		gpuSize = textureFile.GetArrayStride();
+		if (textureFile.GetFormat() == CoreLib::Graphics::TextureStorageFormat::RGB8 || textureFile.GetFormat() == CoreLib::Graphics::TextureStorageFormat::RGB_F32)
+			gpuSize = gpuSize / 3 * 4;
+		return true;
+	}
+
+	void StreamedTexture::MakeResident()
+	{
+		texture = sceneResource->CreateTexture2D(name, textureFile);
+		textureFile.Clear();
+		sceneResource->QueueBindingUpdate(this);
+	}
+
+	void StreamedTexture::Evict()
+	{
+		// the texture may still be referenced by frames in flight, it is released once they have retired
+		SceneResource::RetiredTexture retired;
+		retired.texture = _Move(texture);
+		retired.frameId = Engine::Instance()->GetFrameId();
+		sceneResource->retiredTextures.Add(_Move(retired));
+		sceneResource->QueueBindingUpdate(this);
+	}
+
+	void StreamedTexture::DiscardStaging()
+	{
+		textureFile.Clear();
+	}
+
+	size_t StreamedTexture::GetStagingSize()
+	{
+		return textureFile.GetArrayStride();
+	}
+
+	Texture2D * StreamedTexture::GetTexture()
+	{
+		if (texture)
+			return texture.Ptr();
+		return sceneResource->GetStreamingPlaceholderTexture();
+	}
+
+	Texture2D * SceneResource::GetStreamingPlaceholderTexture()
+	{
+		RefPtr<Texture2D> value;
+		if (textures.TryGetValue("STREAMING_PLACEHOLDER", value))
+			return value.Ptr();
+		// a flat normal, so that the placeholder is also valid in place of a normal map
+		CoreLib::Graphics::TextureFile placeholder;
+		placeholder.Allocate(CoreLib::Graphics::TextureStorageFormat::RGBA8, 2, 2, 1, 1);
+		auto buffer = placeholder.GetBuffer();
+		for (int i = 0; i < 4; i++)
+		{
+			buffer[i * 4] = 128;
+			buffer[i * 4 + 1] = 128;
+			buffer[i * 4 + 2] = 255;
+			buffer[i * 4 + 3] = 255;
+		}
+		return LoadTexture2D("STREAMING_PLACEHOLDER", placeholder);
+	}
+
+	StreamedTexture * SceneResource::LoadStreamedTexture(const String & filename)
+	{
+		if (!textureStreaming)
+			return nullptr;
+		RefPtr<StreamedTexture> value;
+		if (streamedTextures.TryGetValue(filename, value))
+			return value.Ptr();
+		// only compiled textures are streamed, images are compressed and loaded synchronously by LoadTexture()
+		auto actualFilename = Engine::Instance()->FindFile(Path::ReplaceExt(filename, "texture"), ResourceType::Texture);
+		if (!actualFilename.Length())
+			return nullptr;
+		value = new StreamedTexture(this, filename, actualFilename);
+		streamedTextures[filename] = value;
+		return value.Ptr();
+	}
+
+	void SceneResource::SetTextureStreaming(bool enable, const StreamingSettings & settings)
+	{
+		textureStreaming = enable;
+		textureStreamer.SetSettings(settings);
+	}
+
+	void SceneResource::RequestStreamedTextures(ArrayView<Drawable*> drawables, Vec3 cameraPos)
+	{
+		for (auto drawable : drawables)
+		{
+			if (!drawable->GetMaterial() || drawable->GetMaterial()->StreamedTextures.Count() == 0)
+				continue;
+			auto & bounds = drawable->Bounds;
+			Vec3 closest = Vec3::Create(Math::Clamp(cameraPos.x, bounds.xMin, bounds.xMax),
+				Math::Clamp(cameraPos.y, bounds.yMin, bounds.yMax), Math::Clamp(cameraPos.z, bounds.zMin, bounds.zMax));
+			float priority = -(closest - cameraPos).Length();
+			for (auto texture : drawable->GetMaterial()->StreamedTextures)
+				textureStreamer.Request(texture, priority);
+		}
+	}
+
+	void SceneResource::QueueBindingUpdate(StreamedTexture * texture)
+	{
+		if (!texture->staleVersions)
+			pendingBindingUpdates.Add(texture);
+		texture->staleVersions = (1 << DynamicBufferLengthMultiplier) - 1;
+	}
+
+	void SceneResource::UpdateTextureStreaming(RenderStat & stats)
+	{
+		textureStreamer.Update();
+		// Frame N binds version N % DynamicBufferLengthMultiplier of the streamed material descriptor sets. The
+		// last frame that used this version has retired, so it is rewritten without waiting for the GPU, and
+		// the other versions are rewritten as their frames come up.
+		int frameId = Engine::Instance()->GetFrameId();
+		int version = frameId % DynamicBufferLengthMultiplier;
+		for (auto module : streamedMaterialModules)
+			module->SetCurrentVersion(version);
+		int pendingCount = 0;
+		for (auto texture : pendingBindingUpdates)
+		{
+			if (texture->staleVersions & (1 << version))
+			{
+				for (auto & binding : texture->bindings)
+				{
+					if (auto descSet = binding.module->GetDescriptorSet(version))
+					{
+						descSet->BeginUpdate();
+						descSet->Update(binding.location, texture->GetTexture(), TextureAspect::Color);
+						descSet->EndUpdate();
+					}
+				}
+				texture->staleVersions &= ~(1 << version);
+			}
+			if (texture->staleVersions)
+				pendingBindingUpdates[pendingCount++] = texture;
+		}
+		pendingBindingUpdates.SetSize(pendingCount);
+		// frames recorded before an eviction have all retired DynamicBufferLengthMultiplier frames later
+		int expiredCount = 0;
+		while (expiredCount < retiredTextures.Count() && frameId - retiredTextures[expiredCount].frameId >= DynamicBufferLengthMultiplier)
+			retiredTextures[expiredCount++].texture = nullptr;
+		if (expiredCount)
+			retiredTextures.RemoveRange(0, expiredCount);
+		auto streamingStats = textureStreamer.GetStats();
+		stats.StreamingQueueDepth = streamingStats.QueueDepth;
+		stats.StreamingBytesInFlight = streamingStats.BytesInFlight;
+		stats.StreamingResidentBytes = streamingStats.ResidentGpuBytes;
+		stats.StreamingLoads += streamingStats.Loads - lastStreamingLoads;
+		stats.StreamingEvictions += streamingStats.Evictions - lastStreamingEvictions;
+		lastStreamingLoads = streamingStats.Loads;
+		lastStreamingEvictions = streamingStats.Evictions;
+	}
+
 	void SceneResource::CreateMaterialModuleInstance(ModuleInstance & result, Material* material, const char * moduleName)
 	{
 		bool isValid = true;
@@ -352,7 +578,21 @@ namespace GameEngine
                                 DynamicVariable val;
                                 if (material->Variables.TryGetValue(binding.Key, val))
                                 {
-                                    auto tex = LoadTexture(val.StringValue);
+                                    Texture2D * tex = nullptr;
+                                    if (auto streamedTex = LoadStreamedTexture(val.StringValue))
+                                    {
+                                        if (i == 0)
+                                        {
+                                            StreamedTexture::Binding texBinding;
+                                            texBinding.module = &result;
+                                            texBinding.location = binding.Value;
+                                            streamedTex->bindings.Add(texBinding);
+                                            material->StreamedTextures.Add(streamedTex);
+                                        }
+                                        tex = streamedTex->GetTexture();
+                                    }
+                                    else
+                                        tex = LoadTexture(val.StringValue);
                                     if (tex)
                                         descSet->Update(binding.Value, tex, TextureAspect::Color);
                                 }
@@ -366,6 +606,12 @@ namespace GameEngine
                         }
 					}
 				}
+				if (result && material->StreamedTextures.Count())
+				{
+					// all versions bind the same textures, but later updates must not reach the version in use
+					result.SetCurrentVersion(Engine::Instance()->GetFrameId() % DynamicBufferLengthMultiplier);
+					streamedMaterialModules.Add(&result);
+				}
 				for (auto& v : vars)
 					material->PatternVariables.Add(v.Value);
 			}
@@ -401,10 +647,22 @@ namespace GameEngine
 		transformMemory.Init(hwRenderer, BufferUsage::UniformBuffer, false, 25, hwRenderer->UniformBufferAlignment(), nullptr);
 		Clear();
 	}
+
+	SceneResource::~SceneResource()
+	{
+		// the streamer threads may be loading streamed textures
+		textureStreamer.Clear();
+	}
 	
 	void SceneResource::Clear()
 	{
 		Destroy();
+		// the materials that bind streamed textures are already gone, no binding is updated
+		textureStreamer.Clear();
+		pendingBindingUpdates.Clear();
+		retiredTextures.Clear();
+		streamedMaterialModules.Clear();
+		streamedTextures = EnumerableDictionary<String, RefPtr<StreamedTexture>>();
 		meshes = CoreLib::EnumerableDictionary<CoreLib::String, RefPtr<DrawableMesh>>();
 		textures = EnumerableDictionary<String, RefPtr<Texture2D>>();
         deviceLightmapSet = nullptr;
@@ -639,6 +897,7 @@ namespace GameEngine
         auto blendShapeMemoryStructInfo =
             BufferStructureInfo(sizeof(BlendShapeVertex), (1 << 28) / sizeof(BlendShapeVertex));
         blendShapeMemory.Init(hardwareRenderer.Ptr(), BufferUsage::StorageBuffer, false, 28, 256, &blendShapeMemoryStructInfo);
+		instanceTransformMemory.Init(hardwareRenderer.Ptr(), BufferUsage::UniformBuffer, false, 24, hardwareRenderer->UniformBufferAlignment(), nullptr);
 
 		envMapArray = hardwareRenderer->CreateTextureCubeArray("envMapArray", TextureUsage::SampledColorAttachment, EnvMapSize, Math::Log2Floor(EnvMapSize) + 1, MaxEnvMapCount, StorageFormat::RGBA_F16);
 	
@@ -729,63 +988,118 @@ namespace GameEngine
 		}
 	}
 
+	// uniform layout of InstancedStaticMeshTransform
+	struct InstanceTransformData
+	{
+		uint32_t lightmapId[4];
+		VectorMath::Matrix4 worldMats[MaxInstancesPerDraw];
+	};
+
+	// drawables with the same mesh range, material and transform type resolve to the same pipeline and
+	// can be drawn with a single instanced draw call
+	static bool CanDrawInstanced(Drawable * first, Drawable * other)
+	{
+		if (first->GetDrawableType() != DrawableType::Static || other->GetDrawableType() != DrawableType::Static)
+			return false;
+		auto range0 = first->GetElementRange();
+		auto range1 = other->GetElementRange();
+		return first->GetMesh() == other->GetMesh() && range0.StartIndex == range1.StartIndex && range0.Count == range1.Count &&
+			first->GetMaterial() == other->GetMaterial() && first->GetPrimitiveType() == other->GetPrimitiveType() &&
+			first->lightmapId == other->lightmapId;
+	}
+
+	CommandBuffer * WorldPassRenderTask::RecordDrawChunk(AsyncCommandBuffer * cmd, int start, int end)
+	{
+		auto cmdBuf = cmd->BeginRecording(renderOutput->GetFrameBuffer());
+		cmdBuf->SetViewport(viewport);
+		for (int i = 0; i < passBindings.Count(); i++)
+			cmdBuf->BindDescriptorSet(i, passBindings[i]);
+		if (start == end)
+		{
+			cmdBuf->EndRecording();
+			return cmdBuf;
+		}
+		Array<DescriptorSet*, 32> boundSets;
+		boundSets.SetSize(boundSets.GetCapacity());
+		for (auto & descSet : boundSets)
+			descSet = (DescriptorSet*)-1;
+		PipelineClass * lastPipeline = nullptr;
+		DrawableMesh * lastMesh = nullptr;
+		// the material of the previous draw is still bound when a new chunk begins
+		auto & previous = drawRecords[start == 0 ? 0 : start - 1];
+		Material * lastMaterial = previous.material;
+		cmdBuf->BindIndexBuffer(drawRecords[start].mesh->GetIndexBuffer(), 0);
+		BindDescSet(boundSets.Buffer(), cmdBuf, passBindings.Count(), previous.materialDescSet);
+		for (int i = start; i < end; i++)
+		{
+			auto & draw = drawRecords[i];
+			if (draw.pipeline != lastPipeline)
+			{
+				cmdBuf->BindPipeline(draw.pipeline->pipeline.Ptr());
+				lastPipeline = draw.pipeline;
+			}
+			if (draw.material != lastMaterial)
+			{
+				BindDescSet(boundSets.Buffer(), cmdBuf, passBindings.Count(), draw.materialDescSet);
+			}
+			int descOffset = draw.materialDescSet ? 1 : 0;
+			BindDescSet(boundSets.Buffer(), cmdBuf, passBindings.Count() + descOffset, draw.transformDescSet);
+			if (draw.mesh != lastMesh)
+			{
+				cmdBuf->BindVertexBuffer(draw.mesh->GetVertexBuffer(), draw.mesh->vertexBufferOffset);
+				lastMesh = draw.mesh;
+			}
+			if (draw.instanceCount > 1)
+				cmdBuf->DrawIndexedInstanced(draw.instanceCount, draw.firstIndex, draw.indexCount);
+			else
+				cmdBuf->DrawIndexed(draw.firstIndex, draw.indexCount);
+			lastMaterial = draw.material;
+		}
+		cmdBuf->EndRecording();
+		return cmdBuf;
+	}
+
 	void WorldPassRenderTask::SetFixedOrderDrawContent(PipelineContext & pipelineManager, CoreLib::ArrayView<Drawable*> drawables)
 	{
 		// Note: Intel's vulkan driver seem to have a limit on the size of a secondary command buffer
 		// to play safe, we create multiple secondary command buffers, each holds 128 draw calls.
-		commandBuffers.Clear();
-		apiCommandBuffers.Clear();
-        int outputWidth, outputHeight;
-        renderOutput->GetSize(outputWidth, outputHeight);
+		const int drawsPerCommandBuffer = 128;
+		int outputWidth, outputHeight;
+		renderOutput->GetSize(outputWidth, outputHeight);
 		viewport.w = (float)outputWidth;
-        viewport.h = (float)outputHeight;
-		auto cmd0 = pass->AllocCommandBuffer();
-		commandBuffers.Add(cmd0);
-		auto cmdBuf = cmd0->BeginRecording(renderOutput->GetFrameBuffer());
-		apiCommandBuffers.Add(cmdBuf);
-        cmdBuf->SetViewport(viewport);
-		DescriptorSetBindingArray bindings;
-		pipelineManager.GetBindings(bindings);
-		for (int i = 0; i < bindings.Count(); i++)
-			cmdBuf->BindDescriptorSet(i, bindings[i]);
-		PipelineClass * lastPipeline = nullptr;
+		viewport.h = (float)outputHeight;
+		pipelineManager.GetBindings(passBindings);
 		numDrawCalls = 0;
 		numMaterials = 0;
 		numShaders = 0;
-		Array<DescriptorSet*, 32> boundSets;
-		boundSets.SetSize(boundSets.GetCapacity());
-		for (auto & descSet : boundSets)
-			descSet = (DescriptorSet*)-1;
-		DrawableMesh * lastMesh = nullptr;
+
+		// resolve pipelines and descriptor sets on this thread, the pipeline context is not thread safe.
+		// consecutive static drawables that can be instanced are merged into a single draw call.
+		bool useInstancing = Engine::Instance()->GetGraphicsSettings().UseInstancing;
+		InstanceTransformData instanceData;
+		drawRecords.Clear();
+		drawRecords.Reserve(drawables.Count());
 		if (drawables.Count())
 		{
 			Material* lastMaterial = drawables[0]->GetMaterial();
 			pipelineManager.SetCullMode(lastMaterial->IsDoubleSided ? CullMode::Disabled : CullMode::CullBackFace);
-
-			cmdBuf->BindIndexBuffer(drawables[0]->GetMesh()->GetIndexBuffer(), 0);
 			pipelineManager.PushModuleInstance(&lastMaterial->MaterialModule);
 			numMaterials++;
-			BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), lastMaterial->MaterialModule.GetCurrentDescriptorSet());
-			for (auto obj : drawables)
+			PipelineClass * lastPipeline = nullptr;
+			// -1 before the first draw, otherwise whether the last draw pushed the instanced transform module
+			int lastInstanced = -1;
+			for (int i = 0; i < drawables.Count(); )
 			{
-				numDrawCalls++;
-				if ((numDrawCalls & 127) == 0)
+				auto obj = drawables[i];
+				int instanceCount = 1;
+				if (useInstancing)
 				{
-					cmdBuf->EndRecording();
-					auto cmd = pass->AllocCommandBuffer();
-					commandBuffers.Add(cmd);
-					cmdBuf = cmd->BeginRecording(renderOutput->GetFrameBuffer());
-                    cmdBuf->SetViewport(viewport);
-					apiCommandBuffers.Add(cmdBuf);
-					for (int i = 0; i < boundSets.Count(); i++)
-						boundSets[i] = (DescriptorSet*)-1;
-					for (int i = 0; i < bindings.Count(); i++)
-						cmdBuf->BindDescriptorSet(i, bindings[i]);
-					cmdBuf->BindIndexBuffer(obj->GetMesh()->GetIndexBuffer(), 0);
-					BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), lastMaterial->MaterialModule.GetCurrentDescriptorSet());
-					lastPipeline = nullptr;
-					lastMesh = nullptr;
+					while (i + instanceCount < drawables.Count() && instanceCount < MaxInstancesPerDraw &&
+						CanDrawInstanced(obj, drawables[i + instanceCount]))
+						instanceCount++;
 				}
+				if (drawRecords.Count() % drawsPerCommandBuffer == 0)
+					lastPipeline = nullptr;
 				auto newMaterial = obj->GetMaterial();
 				if (newMaterial != lastMaterial)
 				{
@@ -794,40 +1108,69 @@ namespace GameEngine
 					pipelineManager.PushModuleInstance(&newMaterial->MaterialModule);
 					pipelineManager.SetCullMode(newMaterial->IsDoubleSided ? CullMode::Disabled : CullMode::CullBackFace);
 				}
-				pipelineManager.PushModuleInstanceNoShaderChange(obj->GetTransformModule());
-				if (auto pipelineInst = obj->GetPipeline(renderPassId, pipelineManager))
+				// the shader key only changes when the transform module switches between the per-drawable
+				// transform and InstancedStaticMeshTransform
+				int instanced = instanceCount > 1 ? 1 : 0;
+				ModuleInstance * transformModule = instanced ? pass->AllocInstanceTransformModule() : obj->GetTransformModule();
+				if (instanced != lastInstanced)
+					pipelineManager.PushModuleInstance(transformModule);
+				else
+					pipelineManager.PushModuleInstanceNoShaderChange(transformModule);
+				lastInstanced = instanced;
+				PipelineClass * pipelineInst;
+				if (instanced)
 				{
-					if (pipelineInst != lastPipeline)
-					{
-						cmdBuf->BindPipeline(pipelineInst->pipeline.Ptr());
-						lastPipeline = pipelineInst;
-						numShaders++;
-					}
-					auto mesh = obj->GetMesh();
-					if (newMaterial != lastMaterial)
-					{
-						BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count(), newMaterial->MaterialModule.GetCurrentDescriptorSet());
-					}
-                    int descOffset = newMaterial->MaterialModule.GetCurrentDescriptorSet() ? 1 : 0;
-					BindDescSet(boundSets.Buffer(), cmdBuf, bindings.Count() + descOffset, obj->GetTransformModule()->GetCurrentDescriptorSet());
-					if (mesh != lastMesh)
-					{
-						cmdBuf->BindVertexBuffer(mesh->GetVertexBuffer(), mesh->vertexBufferOffset);
-						lastMesh = mesh;
-					}
-
-					auto range = obj->GetElementRange();
-					cmdBuf->DrawIndexed(mesh->indexBufferOffset / sizeof(int) + range.StartIndex, range.Count);
+					instanceData.lightmapId[0] = obj->lightmapId;
+					for (int j = 0; j < instanceCount; j++)
+						instanceData.worldMats[j] = drawables[i + j]->GetWorldTransform();
+					transformModule->SetUniformData(&instanceData, (int)(sizeof(VectorMath::Vec4) + sizeof(VectorMath::Matrix4) * instanceCount));
+					pipelineInst = pipelineManager.GetPipeline(&obj->GetVertexFormat(), obj->GetPrimitiveType());
 				}
 				else
-					throw "error";
+					pipelineInst = obj->GetPipeline(renderPassId, pipelineManager);
 				lastMaterial = newMaterial;
+				if (!pipelineInst)
+				{
+					// the pipeline is still being compiled in the background, skip the drawables for this frame
+					pipelineManager.PopModuleInstance();
+					i += instanceCount;
+					continue;
+				}
+				if (pipelineInst != lastPipeline)
+				{
+					lastPipeline = pipelineInst;
+					numShaders++;
+				}
+				DrawRecord draw;
+				draw.pipeline = pipelineInst;
+				draw.material = newMaterial;
+				draw.materialDescSet = newMaterial->MaterialModule.GetCurrentDescriptorSet();
+				draw.transformDescSet = transformModule->GetCurrentDescriptorSet();
+				draw.mesh = obj->GetMesh();
+				auto range = obj->GetElementRange();
+				draw.firstIndex = draw.mesh->indexBufferOffset / sizeof(int) + range.StartIndex;
+				draw.indexCount = range.Count;
+				draw.instanceCount = instanceCount;
+				drawRecords.Add(draw);
 				pipelineManager.PopModuleInstance();
+				i += instanceCount;
 			}
 			pipelineManager.PopModuleInstance();
 		}
-		cmdBuf->EndRecording();
+		numDrawCalls = drawRecords.Count();
+
+		// record the chunks in parallel, each thread allocates command buffers from its own pool
+		int chunkCount = Math::Max(1, (drawRecords.Count() + drawsPerCommandBuffer - 1) / drawsPerCommandBuffer);
+		commandBuffers.SetSize(chunkCount);
+		apiCommandBuffers.SetSize(chunkCount);
+		Threading::JobSystem::ParallelFor(0, chunkCount, 1, [&](int chunk)
+		{
+			int start = chunk * drawsPerCommandBuffer;
+			commandBuffers[chunk] = pass->AllocCommandBuffer();
+			apiCommandBuffers[chunk] = RecordDrawChunk(commandBuffers[chunk], start, Math::Min(start + drawsPerCommandBuffer, drawRecords.Count()));
+		});
 	}
+
 	void WorldPassRenderTask::SetDrawContent(PipelineContext & pipelineManager, CoreLib::List<Drawable*>& reorderBuffer, CoreLib::ArrayView<Drawable*> drawables)
 	{
 		reorderBuffer.Clear();
@@ -850,16 +1193,29 @@ namespace GameEngine
 				lastMaterial = newMaterial;
 			}
 			pipelineManager.PushModuleInstanceNoShaderChange(obj->GetTransformModule());
-			obj->ReorderKey = (obj->GetPipeline(renderPassId, pipelineManager)->Id << 18) + newMaterial->Id;
+			auto pipelineInst = obj->GetPipeline(renderPassId, pipelineManager);
 			pipelineManager.PopModuleInstance();
-
+			// drawables whose pipeline is still being compiled are skipped
+			if (!pipelineInst)
+				continue;
+			obj->ReorderKey = (pipelineInst->Id << 18) + newMaterial->Id;
 			reorderBuffer.Add(obj);
 		}
 		if (drawables.Count())
 		{
 			pipelineManager.PopModuleInstance();
 		}
-		reorderBuffer.Sort([](Drawable* d1, Drawable* d2) {return d1->ReorderKey < d2->ReorderKey; });
+		// within a pipeline and material, group drawables of the same mesh range so that they can be instanced
+		reorderBuffer.Sort([](Drawable* d1, Drawable* d2)
+		{
+			if (d1->ReorderKey != d2->ReorderKey)
+				return d1->ReorderKey < d2->ReorderKey;
+			if (d1->GetMesh() != d2->GetMesh())
+				return d1->GetMesh() < d2->GetMesh();
+			if (d1->GetElementRange().StartIndex != d2->GetElementRange().StartIndex)
+				return d1->GetElementRange().StartIndex < d2->GetElementRange().StartIndex;
+			return d1->lightmapId < d2->lightmapId;
+		});
 		SetFixedOrderDrawContent(pipelineManager, reorderBuffer.GetArrayView());
 
 	}
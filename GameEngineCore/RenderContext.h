@@ -18,6 +18,7 @@
 #include "Renderer.h"
 #include "CoreLib/PerformanceCounter.h"
 #include "DeviceLightmapSet.h"
+#include "AssetStreamer.h"
 
 namespace GameEngine
 {
@@ -45,6 +46,14 @@ namespace GameEngine
 		int NumMaterials = 0;
 		float CpuTime = 0.0f;
 		float PipelineLookupTime = 0.0f;
+		int PendingPipelineCompiles = 0;   // pipelines being compiled in the background at the last frame boundary
+		int CompletedPipelineCompiles = 0; // background compiles published since the last Clear()
+		int StalledPipelineCompiles = 0;   // pipelines compiled on the render thread in the middle of a frame
+		int StreamingQueueDepth = 0;       // texture loads waiting for an I/O thread at the last frame boundary
+		size_t StreamingBytesInFlight = 0; // texture data read but not yet uploaded at the last frame boundary
+		size_t StreamingResidentBytes = 0; // GPU memory of the streamed textures at the last frame boundary
+		int StreamingLoads = 0;            // streamed textures made resident since the last Clear()
+		int StreamingEvictions = 0;        // streamed textures evicted since the last Clear()
 		CoreLib::Diagnostics::TimePoint StartTime;
 		void Clear()
 		{
@@ -55,6 +64,11 @@ namespace GameEngine
 			NumMaterials = 0;
 			CpuTime = 0.0f;
 			PipelineLookupTime = 0.0f;
+			PendingPipelineCompiles = 0;
+			CompletedPipelineCompiles = 0;
+			StalledPipelineCompiles = 0;
+			StreamingLoads = 0;
+			StreamingEvictions = 0;
 		}
 	};
 
@@ -78,6 +92,21 @@ namespace GameEngine
 
 	class WorldPassRenderTask : public RenderTask
 	{
+	private:
+		// everything needed to record one draw call, resolved on the calling thread before recording is fanned out
+		struct DrawRecord
+		{
+			PipelineClass * pipeline;
+			Material * material;
+			DescriptorSet * materialDescSet;
+			DescriptorSet * transformDescSet;
+			DrawableMesh * mesh;
+			int firstIndex, indexCount;
+			int instanceCount;
+		};
+		CoreLib::List<DrawRecord> drawRecords;
+		DescriptorSetBindingArray passBindings;
+		CommandBuffer * RecordDrawChunk(AsyncCommandBuffer * cmd, int start, int end);
 	public:
 		int renderPassId = -1; 
 		int numDrawCalls = 0; 
@@ -151,6 +180,7 @@ namespace GameEngine
         CoreLib::RefPtr<Buffer> histogramBuffer, adaptedLuminanceBuffer;
 		CoreLib::RefPtr<Buffer> fullScreenQuadVertBuffer;
 		DeviceMemory indexBufferMemory, vertexBufferMemory, blendShapeMemory;
+		DeviceMemory instanceTransformMemory; // per instance world transforms of instanced draw calls
 		PipelineContext pipelineManager;
 	public:
 		RendererSharedResource(RenderAPI pAPI)
@@ -172,19 +202,88 @@ namespace GameEngine
 		virtual void Destroy() override;
 	};
 
+	// A material texture loaded in the background by the scene's texture streamer. The descriptor sets that
+	// bind it use a placeholder texture until it is resident, and again after it is evicted.
+	class StreamedTexture : public StreamingAsset
+	{
+		friend class SceneResource;
+	private:
+		struct Binding
+		{
+			ModuleInstance * module;
+			int location;
+		};
+		SceneResource * sceneResource;
+		CoreLib::String name, fileName;
+		CoreLib::Graphics::TextureFile textureFile;
+		size_t gpuSize = 0;
+		CoreLib::RefPtr<Texture2D> texture;
+		CoreLib::List<Binding> bindings;
+		int staleVersions = 0; // descriptor set versions that still bind the previous texture, one bit per version
+	protected:
+		virtual bool Read() override;
+		virtual bool Decode() override;
+		virtual void MakeResident() override;
+		virtual void Evict() override;
+		virtual void DiscardStaging() override;
+	public:
+		StreamedTexture(SceneResource * pSceneResource, const CoreLib::String & pName, const CoreLib::String & pFileName)
+			: sceneResource(pSceneResource), name(pName), fileName(pFileName)
+		{}
+		virtual size_t GetStagingSize() override;
+		virtual size_t GetCpuResidentSize() override
+		{
+			return 0;
+		}
+		virtual size_t GetGpuResidentSize() override
+		{
+			return gpuSize;
+		}
+		// the streamed texture if it is resident, the placeholder otherwise
+		Texture2D * GetTexture();
+	};
+
 	class SceneResource : public RendererResource
 	{
+		friend class StreamedTexture;
 	private:
 		RendererSharedResource * rendererResource;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<DrawableMesh>> meshes;
 		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<Texture2D>> textures;
+		bool textureStreaming = false;
+		AssetStreamer textureStreamer;
+		CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<StreamedTexture>> streamedTextures;
+		struct RetiredTexture
+		{
+			CoreLib::RefPtr<Texture2D> texture;
+			int frameId;
+		};
+		CoreLib::List<StreamedTexture*> pendingBindingUpdates;
+		CoreLib::List<RetiredTexture> retiredTextures; // in the order they were evicted
+		CoreLib::List<ModuleInstance*> streamedMaterialModules; // material modules that bind streamed textures
+		int lastStreamingLoads = 0, lastStreamingEvictions = 0;
+		CoreLib::List<unsigned char> textureUploadBuffer;
 		void CreateMaterialModuleInstance(ModuleInstance & mInst, Material* material, const char * moduleName);
+		Texture2D* CreateTexture2D(const CoreLib::String & name, CoreLib::Graphics::TextureFile & data);
+		Texture2D* CreateTexture2D(const CoreLib::String & name, CoreLib::Graphics::TextureFileReader & reader);
+		StreamedTexture* LoadStreamedTexture(const CoreLib::String & filename);
+		void QueueBindingUpdate(StreamedTexture * texture);
 	public:
 		CoreLib::RefPtr<DrawableMesh> LoadDrawableMesh(Mesh * mesh);
         CoreLib::RefPtr<DrawableMesh> CreateDrawableMesh(Mesh * mesh);
         void UpdateDrawableMesh(Mesh* mesh);
 		Texture2D* LoadTexture2D(const CoreLib::String & name, CoreLib::Graphics::TextureFile & data);
 		Texture2D* LoadTexture(const CoreLib::String & filename);
+		Texture2D* GetStreamingPlaceholderTexture();
+		// Material textures are streamed in the background when enabled. Takes effect for the materials
+		// registered afterwards.
+		void SetTextureStreaming(bool enable, const StreamingSettings & settings);
+		// Requests the streamed textures of `drawables`, the closest drawables first.
+		void RequestStreamedTextures(CoreLib::ArrayView<Drawable*> drawables, VectorMath::Vec3 cameraPos);
+		// Called once per frame before any rendering work is recorded: binds the textures that finished
+		// loading, unbinds the evicted ones and updates the streaming counters of `stats`. A binding change
+		// reaches one descriptor set version per frame, the version of the frame being recorded.
+		void UpdateTextureStreaming(RenderStat & stats);
 	public:
         CoreLib::RefPtr<DeviceLightmapSet> deviceLightmapSet;
 		DeviceMemory instanceUniformMemory, transformMemory;
@@ -192,6 +291,7 @@ namespace GameEngine
 		
 	public:
 		SceneResource(RendererSharedResource * resource);
+		~SceneResource();
 		void Clear();
 	};
 }
@@ -174,6 +174,7 @@ namespace GameEngine
             computeTaskManager = new ComputeTaskManager(hardwareRenderer, Engine::GetShaderCompiler());
 
 			sharedRes.Init(hardwareRenderer);
+			sharedRes.pipelineManager.SetAsyncCompilation(Engine::Instance()->UseAsyncPipelineCompilation());
 
 			mainView = new ViewResource(hardwareRenderer);
 			mainView->Resize(1024, 1024);
@@ -191,6 +192,9 @@ namespace GameEngine
 			storageBufferAlignment = hardwareRenderer->StorageBufferAlignment();
 			
 			sceneRes = new SceneResource(&sharedRes);
+			StreamingSettings streamingSettings;
+			streamingSettings.GpuBudget = (size_t)Engine::Instance()->GetGraphicsSettings().TextureStreamingBudget << 20;
+			sceneRes->SetTextureStreaming(Engine::Instance()->GetGraphicsSettings().TextureStreaming, streamingSettings);
 			renderService = new RendererServiceImpl(this);
 			hardwareRenderer->Wait();
 		}
@@ -260,6 +264,9 @@ namespace GameEngine
 		{
 			if (!level) return;
 			LightProbeRenderer lpRenderer(this, renderService.Ptr(), lightProbeRenderProcedure, cubemapRenderView.Ptr());
+			// probes are rendered once, they cannot skip drawables whose pipeline is still compiling
+			bool asyncCompilation = sharedRes.pipelineManager.IsAsyncCompilation();
+			sharedRes.pipelineManager.SetAsyncCompilation(false);
 			int lightProbeCount = 0;
 			for (auto & actor : level->Actors)
 			{
@@ -277,6 +284,7 @@ namespace GameEngine
 					defaultEnvMapId = sharedRes.AllocEnvMap();
 				lpRenderer.RenderLightProbe(sharedRes.envMapArray.Ptr(), defaultEnvMapId, level, Vec3::Create(0.0f, 1000.0f, 0.0f));
 			}
+			sharedRes.pipelineManager.SetAsyncCompilation(asyncCompilation);
 		}
         void TryLoadLightmap()
         {
@@ -343,6 +351,8 @@ namespace GameEngine
             sharedRes.renderStats.Divisor++;
 			sharedRes.renderStats.NumMaterials = 0;
 			sharedRes.renderStats.NumShaders = 0;
+			sharedRes.pipelineManager.PublishCompiledPipelines();
+			sceneRes->UpdateTextureStreaming(sharedRes.renderStats);
             
             RunRenderProcedure();
 		}
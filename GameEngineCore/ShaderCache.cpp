@@ -0,0 +1,333 @@
+#include "ShaderCache.h"
+
+namespace GameEngine
+{
+	using namespace CoreLib;
+	using namespace CoreLib::IO;
+
+	uint64_t HashShaderCacheBytes(const void * data, size_t size, uint64_t hash)
+	{
+		auto bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	static int AlignBlob(int size)
+	{
+		return (size + 3) & ~3;
+	}
+
+	static int64_t GetBlobSize(const ShaderCacheTableEntry & record)
+	{
+		return (int64_t)AlignBlob(record.KeySize) + AlignBlob(record.CodeSize) + record.LayoutSize;
+	}
+
+	static void ReadBindingLayout(List<DescriptorSetInfo> & layout, BinaryReader & reader)
+	{
+		layout.Clear();
+		int count = reader.ReadInt32();
+		layout.SetSize(count);
+		for (int i = 0; i < count; i++)
+		{
+			DescriptorSetInfo& info = layout[i];
+			info.BindingPoint = reader.ReadInt32();
+			info.Name = reader.ReadString();
+			int descCount = reader.ReadInt32();
+			info.Descriptors.SetSize(descCount);
+			for (int j = 0; j < descCount; j++)
+			{
+				info.Descriptors[j].Name = reader.ReadString();
+				info.Descriptors[j].Type = (BindingType)reader.ReadInt32();
+				info.Descriptors[j].Location = reader.ReadInt32();
+				info.Descriptors[j].ArraySize = reader.ReadInt32();
+				info.Descriptors[j].Stages = (StageFlags)reader.ReadInt32();
+			}
+		}
+	}
+
+	static void WriteBindingLayout(BinaryWriter & writer, const List<DescriptorSetInfo> & layout)
+	{
+		writer.Write(layout.Count());
+		for (int i = 0; i < layout.Count(); i++)
+		{
+			auto & info = layout[i];
+			writer.Write((int32_t)info.BindingPoint);
+			writer.Write(info.Name);
+			writer.Write(info.Descriptors.Count());
+			for (int j = 0; j < info.Descriptors.Count(); j++)
+			{
+				writer.Write(info.Descriptors[j].Name);
+				writer.Write((int32_t)info.Descriptors[j].Type);
+				writer.Write(info.Descriptors[j].Location);
+				writer.Write(info.Descriptors[j].ArraySize);
+				writer.Write((int32_t)info.Descriptors[j].Stages);
+			}
+		}
+	}
+
+	void ShaderCache::MapArchive()
+	{
+		archive = nullptr;
+		if (!File::Exists(fileName))
+			return;
+		try
+		{
+			archive = new MemoryMappedFile(fileName);
+		}
+		catch (const IOException &)
+		{
+		}
+	}
+
+	void ShaderCache::ReadSegments()
+	{
+		validSize = 0;
+		if (!archive)
+			return;
+		auto data = archive->Buffer();
+		int64_t size = (int64_t)archive->Size();
+		ShaderCacheFileHeader expectedHeader;
+		expectedHeader.Language = (int)language;
+		if (size < (int64_t)sizeof(ShaderCacheFileHeader) || memcmp(data, &expectedHeader, sizeof(ShaderCacheFileHeader)) != 0)
+			return;
+		int64_t offset = sizeof(ShaderCacheFileHeader);
+		while (offset + (int64_t)sizeof(ShaderCacheSegmentHeader) <= size)
+		{
+			ShaderCacheSegmentHeader segment;
+			memcpy(&segment, data + offset, sizeof(ShaderCacheSegmentHeader));
+			int64_t tableStart = offset + sizeof(ShaderCacheSegmentHeader);
+			int64_t tableSize = (int64_t)segment.EntryCount * sizeof(ShaderCacheTableEntry);
+			if (segment.EntryCount < 0 || segment.Size < tableSize || segment.Size > size - tableStart)
+				break;
+			if (HashShaderCacheBytes(data + tableStart, (size_t)tableSize) != segment.TableChecksum)
+				break;
+			int64_t segmentEnd = tableStart + segment.Size;
+			List<ShaderCacheTableEntry> records;
+			records.SetSize(segment.EntryCount);
+			memcpy(records.Buffer(), data + tableStart, (size_t)tableSize);
+			bool valid = true;
+			for (auto & record : records)
+			{
+				if (record.KeySize < 0 || record.CodeSize < 0 || record.LayoutSize < 0 ||
+					record.BlobOffset < tableStart + tableSize || record.BlobOffset + GetBlobSize(record) > segmentEnd)
+					valid = false;
+			}
+			if (!valid)
+				break;
+			for (auto & record : records)
+			{
+				Entry entry;
+				entry.keyHash = record.KeyHash;
+				entry.record = record;
+				entry.stored = true;
+				storedBytes += GetBlobSize(record);
+				AddEntry(_Move(entry));
+			}
+			offset = segmentEnd;
+		}
+		validSize = offset;
+	}
+
+	void ShaderCache::AddEntry(Entry && entry)
+	{
+		int id = -1;
+		if (entryIndex.TryGetValue(entry.keyHash, id) && entries[id].stored)
+			deadBytes += GetBlobSize(entries[id].record);
+		entryIndex[entry.keyHash] = entries.Count();
+		entries.Add(_Move(entry));
+	}
+
+	bool ShaderCache::LoadEntry(Entry & entry)
+	{
+		if (!entry.stored || !archive || entry.record.BlobOffset + GetBlobSize(entry.record) > (int64_t)archive->Size())
+			return false;
+		auto blob = archive->Buffer() + entry.record.BlobOffset;
+		if (HashShaderCacheBytes(blob, (size_t)GetBlobSize(entry.record)) != entry.record.BlobChecksum)
+			return false;
+		try
+		{
+			auto codeStart = blob + AlignBlob(entry.record.KeySize);
+			auto layoutStart = codeStart + AlignBlob(entry.record.CodeSize);
+			entry.key = String((const char*)blob, entry.record.KeySize);
+			entry.code.Clear();
+			entry.code.AddRange((const char*)codeStart, entry.record.CodeSize);
+			BinaryReader reader(new MemoryStream(MakeArrayView((unsigned char*)layoutStart, entry.record.LayoutSize)));
+			ReadBindingLayout(entry.layouts, reader);
+		}
+		catch (const Exception &)
+		{
+			return false;
+		}
+		entry.loaded = true;
+		return true;
+	}
+
+	void ShaderCache::Load(const String & cachePath, TargetShadingLanguage lang)
+	{
+		language = lang;
+		switch (language)
+		{
+		case TargetShadingLanguage::HLSL:
+			fileName = Path::Combine(cachePath, "shader_cache_hlsl.bin");
+			break;
+		case TargetShadingLanguage::SPIRV:
+			fileName = Path::Combine(cachePath, "shader_cache_spv.bin");
+			break;
+		default:
+			fileName = Path::Combine(cachePath, "shader_cache.bin");
+			break;
+		}
+		entries.Clear();
+		entryIndex = Dictionary<uint64_t, int>();
+		storedBytes = deadBytes = 0;
+		newEntryCount = 0;
+		MapArchive();
+		ReadSegments();
+	}
+
+	void ShaderCache::UpdateEntry(const String & key, const List<char> & code, const List<DescriptorSetInfo> & layouts)
+	{
+		Entry entry;
+		entry.keyHash = HashKey(key);
+		entry.loaded = true;
+		entry.key = key;
+		entry.code = code;
+		entry.layouts = layouts;
+		AddEntry(_Move(entry));
+		newEntryCount++;
+	}
+
+	bool ShaderCache::TryGetEntry(const String & key, List<char> & code, List<DescriptorSetInfo> & layouts)
+	{
+		int id = -1;
+		if (!entryIndex.TryGetValue(HashKey(key), id))
+			return false;
+		auto & entry = entries[id];
+		if (!entry.loaded && !LoadEntry(entry))
+		{
+			// damaged entries are compiled again and replaced by the next Save()
+			entryIndex.Remove(entry.keyHash);
+			return false;
+		}
+		if (entry.key != key)
+			return false;
+		code = entry.code;
+		layouts = entry.layouts;
+		return true;
+	}
+
+	void ShaderCache::WriteSegment(List<unsigned char> & segment, int64_t segmentOffset, List<int> & entryIds)
+	{
+		int64_t tableSize = (int64_t)entryIds.Count() * sizeof(ShaderCacheTableEntry);
+		int64_t blobStart = segmentOffset + sizeof(ShaderCacheSegmentHeader) + tableSize;
+		RefPtr<MemoryStream> blobs = new MemoryStream();
+		BinaryWriter writer(blobs);
+		List<ShaderCacheTableEntry> records;
+		unsigned char padding[4] = {};
+		for (auto id : entryIds)
+		{
+			auto & entry = entries[id];
+			ShaderCacheTableEntry record;
+			record.KeyHash = entry.keyHash;
+			record.BlobOffset = blobStart + blobs->GetPosition();
+			record.KeySize = entry.key.Length();
+			record.CodeSize = entry.code.Count();
+			writer.Write(entry.key.Buffer(), record.KeySize);
+			writer.Write(padding, AlignBlob(record.KeySize) - record.KeySize);
+			writer.Write(entry.code.Buffer(), record.CodeSize);
+			writer.Write(padding, AlignBlob(record.CodeSize) - record.CodeSize);
+			auto layoutStart = blobs->GetPosition();
+			WriteBindingLayout(writer, entry.layouts);
+			record.LayoutSize = (int)(blobs->GetPosition() - layoutStart);
+			records.Add(record);
+		}
+		auto blobData = (unsigned char*)blobs->GetBuffer();
+		for (auto & record : records)
+			record.BlobChecksum = HashShaderCacheBytes(blobData + (record.BlobOffset - blobStart), (size_t)GetBlobSize(record));
+		ShaderCacheSegmentHeader header;
+		header.EntryCount = records.Count();
+		header.Size = tableSize + blobs->GetBufferSize();
+		header.TableChecksum = HashShaderCacheBytes(records.Buffer(), (size_t)tableSize);
+		segment.AddRange((unsigned char*)&header, sizeof(header));
+		segment.AddRange((unsigned char*)records.Buffer(), (int)tableSize);
+		segment.AddRange(blobData, blobs->GetBufferSize());
+		for (int i = 0; i < entryIds.Count(); i++)
+			entries[entryIds[i]].record = records[i];
+	}
+
+	bool ShaderCache::Save()
+	{
+		if (newEntryCount == 0 && (!archive || validSize == (int64_t)archive->Size()))
+			return true;
+		// a damaged tail would hide appended segments, so the archive is rewritten with only the current entries
+		bool rewrite = !archive || validSize == 0 || validSize != (int64_t)archive->Size() || deadBytes * 2 > storedBytes;
+		List<int> entryIds;
+		for (auto & kv : entryIndex)
+		{
+			auto & entry = entries[kv.Value];
+			if (rewrite && !entry.loaded && !LoadEntry(entry))
+				continue;
+			if (rewrite || !entry.stored)
+				entryIds.Add(kv.Value);
+		}
+		entryIds.Sort();
+		List<unsigned char> segment;
+		int64_t segmentOffset = validSize;
+		if (rewrite)
+		{
+			ShaderCacheFileHeader header;
+			header.Language = (int)language;
+			segment.AddRange((unsigned char*)&header, sizeof(header));
+			segmentOffset = sizeof(header);
+		}
+		WriteSegment(segment, segmentOffset, entryIds);
+		// the mapping is released first, a mapped file cannot be written on every platform
+		archive = nullptr;
+		bool succeeded = true;
+		try
+		{
+			// the segment goes out in a single write, the next Load() ignores it if the write is cut short
+			RefPtr<FileStream> stream = new FileStream(fileName, rewrite ? FileMode::Create : FileMode::Append);
+			stream->Write(segment.Buffer(), segment.Count());
+			stream->Close();
+		}
+		catch (const IOException &)
+		{
+			succeeded = false;
+		}
+		MapArchive();
+		if (succeeded)
+		{
+			if (rewrite)
+			{
+				storedBytes = deadBytes = 0;
+				for (auto & entry : entries)
+					entry.stored = false;
+			}
+			for (auto id : entryIds)
+			{
+				entries[id].stored = true;
+				storedBytes += GetBlobSize(entries[id].record);
+			}
+			newEntryCount = 0;
+			validSize = segmentOffset + segment.Count() - (rewrite ? (int64_t)sizeof(ShaderCacheFileHeader) : 0);
+		}
+		else
+		{
+			// the archive may be damaged now: stored entries are still verified when they are loaded,
+			// and the next Save() rewrites the archive
+			validSize = -1;
+		}
+		return succeeded;
+	}
+
+	int ShaderCache::GetLoadedEntryCount()
+	{
+		int count = 0;
+		for (auto & kv : entryIndex)
+			if (entries[kv.Value].loaded)
+				count++;
+		return count;
+	}
+}
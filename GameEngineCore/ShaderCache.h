@@ -0,0 +1,95 @@
+#ifndef GAME_ENGINE_SHADER_CACHE_H
+#define GAME_ENGINE_SHADER_CACHE_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/LibIO.h"
+#include "ShaderCompiler.h"
+
+namespace GameEngine
+{
+	// 64-bit FNV-1a, continued from `hash`
+	uint64_t HashShaderCacheBytes(const void * data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+	// A shader cache archive is a ShaderCacheFileHeader followed by segments, one per Save(). A segment is a
+	// ShaderCacheSegmentHeader, a table of EntryCount ShaderCacheTableEntry records and then the blobs of the
+	// entries. Each blob holds the key, the code and the binding layouts at 4 byte aligned offsets. A segment
+	// is valid only if it fits in the file and its table checksum matches, so an interrupted append leaves the
+	// earlier segments usable. An entry replaces the entries with the same key hash in earlier segments.
+	const int ShaderCacheFileVersion = 1;
+
+	struct ShaderCacheFileHeader
+	{
+		char Identifier[8] = {'S', 'H', 'A', 'D', 'E', 'R', '|', 'C'};
+		int Version = ShaderCacheFileVersion;
+		int Language = 0;
+	};
+
+	struct ShaderCacheSegmentHeader
+	{
+		int EntryCount = 0;
+		int Reserved = 0;
+		int64_t Size = 0; // bytes after the segment header, including the table
+		uint64_t TableChecksum = 0;
+	};
+
+	struct ShaderCacheTableEntry
+	{
+		uint64_t KeyHash = 0;
+		uint64_t BlobChecksum = 0;
+		int64_t BlobOffset = 0; // from the start of the file
+		int KeySize = 0, CodeSize = 0, LayoutSize = 0;
+		int Reserved = 0;
+	};
+
+	// Compiled shader code and binding layouts, keyed by a string that identifies the entry point and the
+	// contents of its sources. The archive is memory mapped by Load() and only the key tables are read;
+	// an entry is read and verified the first time it is looked up. Save() appends the new entries.
+	class ShaderCache
+	{
+	private:
+		struct Entry
+		{
+			uint64_t keyHash = 0;
+			ShaderCacheTableEntry record; // location in the archive, valid if stored
+			bool stored = false, loaded = false;
+			CoreLib::String key;
+			CoreLib::List<char> code;
+			CoreLib::List<DescriptorSetInfo> layouts;
+		};
+		CoreLib::String fileName;
+		TargetShadingLanguage language = TargetShadingLanguage::SPIRV;
+		CoreLib::RefPtr<CoreLib::IO::MemoryMappedFile> archive;
+		int64_t validSize = 0; // bytes at the start of the archive that hold valid segments
+		int64_t storedBytes = 0, deadBytes = 0; // blob bytes in the archive, and those of replaced entries
+		CoreLib::List<Entry> entries;
+		CoreLib::Dictionary<uint64_t, int> entryIndex; // key hash to the current entry
+		int newEntryCount = 0;
+		void MapArchive();
+		void ReadSegments();
+		void AddEntry(Entry && entry);
+		bool LoadEntry(Entry & entry);
+		void WriteSegment(CoreLib::List<unsigned char> & segment, int64_t segmentOffset, CoreLib::List<int> & entryIds);
+	public:
+		static uint64_t HashKey(const CoreLib::String & key)
+		{
+			return HashShaderCacheBytes(key.Buffer(), key.Length());
+		}
+		CoreLib::String GetFileName()
+		{
+			return fileName;
+		}
+		void Load(const CoreLib::String & cachePath, TargetShadingLanguage lang);
+		void UpdateEntry(const CoreLib::String & key, const CoreLib::List<char> & code, const CoreLib::List<DescriptorSetInfo> & layouts);
+		bool TryGetEntry(const CoreLib::String & key, CoreLib::List<char> & code, CoreLib::List<DescriptorSetInfo> & layouts);
+		// Appends the entries added since the last Load() or Save() to the archive. The archive is rewritten
+		// instead if it is missing, damaged or mostly made of replaced entries. Returns false if it cannot be written.
+		bool Save();
+		int GetEntryCount()
+		{
+			return entryIndex.Count();
+		}
+		int GetLoadedEntryCount();
+	};
+}
+
+#endif
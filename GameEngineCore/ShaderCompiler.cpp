@@ -1,202 +1,15 @@
 #include "ShaderCompiler.h"
+#include "ShaderCache.h"
 #include "CoreLib/LibIO.h"
 #include "Engine.h"
 #include "ExternalLibs/Slang/slang.h"
-#include "CoreLib/Tokenizer.h"
+#include <mutex>
 
 namespace GameEngine
 {
 	using namespace CoreLib;
 	using namespace CoreLib::IO;
 
-    class ShaderCache
-    {
-    private:
-        String path;
-        TargetShadingLanguage language;
-        EnumerableDictionary<String, int> shaderCodeIndex;
-        EnumerableDictionary<int, RefPtr<List<char>>> codeRepo;
-        EnumerableDictionary<int, List<DescriptorSetInfo>> bindingLayouts;
-        IntSet updatedCodeIndices;
-        String GetCacheIndexFileName()
-        {
-            switch (language)
-            {
-            case TargetShadingLanguage::HLSL:
-                return Path::Combine(path, "index_hlsl.txt");
-            case TargetShadingLanguage::SPIRV:
-                return Path::Combine(path, "index_spv.txt");
-            default:
-                return Path::Combine(path, "index.txt");
-            }
-        }
-        String GetShaderCodeFileName(int shaderIndex)
-        {
-            switch (language)
-            {
-            case TargetShadingLanguage::HLSL:
-                return Path::Combine(path, String("shader_") + String(shaderIndex) + ".hlsl");
-            case TargetShadingLanguage::SPIRV:
-                return Path::Combine(path, String("shader_") + String(shaderIndex) + ".spv");
-            default:
-                return Path::Combine(path, String("shader_") + String(shaderIndex) + ".bin");
-            }
-        }
-        String GetBindingLayoutFileName(int shaderIndex)
-        {
-            String postfix;
-            switch (language)
-            {
-            case TargetShadingLanguage::HLSL:
-                postfix = ".hlsl";
-                break;
-            case TargetShadingLanguage::SPIRV:
-                postfix = ".spv";
-                break;
-            default:
-                break;
-            }
-            return Path::Combine(path, String("shader_") + String(shaderIndex) + postfix + ".binding");
-        }
-
-        void ReadBindingLayout(List<DescriptorSetInfo> & layout, String fileName)
-        {
-            layout.Clear();
-            BinaryReader reader(new FileStream(fileName));
-            int count = reader.ReadInt32();
-            layout.SetSize(count);
-            for (int i = 0; i < count; i++)
-            {
-                DescriptorSetInfo& info = layout[i];
-                info.BindingPoint = reader.ReadInt32();
-                info.Name = reader.ReadString();
-                int descCount = reader.ReadInt32();
-                info.Descriptors.SetSize(descCount);
-                for (int j = 0; j < descCount; j++)
-                {
-                    info.Descriptors[j].Name = reader.ReadString();
-                    info.Descriptors[j].Type = (BindingType)reader.ReadInt32();
-                    info.Descriptors[j].Location = reader.ReadInt32();
-                    info.Descriptors[j].ArraySize = reader.ReadInt32();
-                    info.Descriptors[j].Stages = (StageFlags)reader.ReadInt32();
-                }
-            }
-        }
-        void WriteBindingLayout(String fileName, List<DescriptorSetInfo> & layout)
-        {
-            BinaryWriter writer(new FileStream(fileName, FileMode::Create));
-            writer.Write(layout.Count());
-            for (int i = 0; i < layout.Count(); i++)
-            {
-                auto & info = layout[i];
-                writer.Write((int32_t)info.BindingPoint);
-                writer.Write(info.Name);
-                writer.Write(info.Descriptors.Count());
-                for (int j = 0; j < info.Descriptors.Count(); j++)
-                {
-                    writer.Write(info.Descriptors[j].Name);
-                    writer.Write((int32_t)info.Descriptors[j].Type);
-                    writer.Write(info.Descriptors[j].Location);
-                    writer.Write(info.Descriptors[j].ArraySize);
-                    writer.Write((int32_t)info.Descriptors[j].Stages);
-                }
-            }
-        }
-    public:
-        void Load(String cachePath, TargetShadingLanguage lang)
-        {
-            language = lang;
-            path = cachePath;
-            if (File::Exists(GetCacheIndexFileName()))
-            {
-                CoreLib::Text::TokenReader reader(File::ReadAllText(GetCacheIndexFileName()));
-                while (!reader.IsEnd())
-                {
-                    auto key = reader.ReadStringLiteral();
-                    auto value = reader.ReadInt();
-                    shaderCodeIndex[key] = value;
-                }
-            }
-        }
-        void UpdateEntry(String key, List<char> & code, char* glslSrc, List<DescriptorSetInfo>& layouts)
-        {
-            int value = shaderCodeIndex.Count();
-            shaderCodeIndex.TryGetValue(key, value);
-            shaderCodeIndex[key] = value;
-            codeRepo[value] = new List<char>(code);
-            bindingLayouts[value] = layouts;
-            updatedCodeIndices.Add(value);
-            if (glslSrc)
-            {
-                File::WriteAllText(Path::ReplaceExt(GetShaderCodeFileName(value), "glsl"), glslSrc);
-            }
-        }
-        bool TryGetEntry(String key, List<char> & code, List<DescriptorSetInfo>& layouts)
-        {
-            int value = -1;
-            if (shaderCodeIndex.TryGetValue(key, value))
-            {
-                RefPtr<List<char>> srcCode;
-                if (!codeRepo.TryGetValue(value, srcCode))
-                {
-                    auto shaderFile = GetShaderCodeFileName(value);
-                    if (File::Exists(shaderFile))
-                    {
-                        auto bytes = File::ReadAllBytes(shaderFile);
-                        srcCode = new List<char>();
-                        srcCode->AddRange((char*)bytes.Buffer(), bytes.Count());
-                        codeRepo[value] = srcCode;
-                    }
-                    else
-                    {
-                        shaderCodeIndex.Remove(key);
-                        return false;
-                    }
-                }
-                if (!bindingLayouts.TryGetValue(value, layouts))
-                {
-                    auto bindingFile = GetBindingLayoutFileName(value);
-                    if (File::Exists(bindingFile))
-                    {
-                        ReadBindingLayout(layouts, bindingFile);
-                    }
-                    else
-                    {
-                        shaderCodeIndex.Remove(key);
-                        return false;
-                    }
-                }
-                code = *srcCode;
-                return true;
-            }
-            return false;
-        }
-        void Save()
-        {
-            for (auto & code : codeRepo)
-            {
-                if (updatedCodeIndices.Contains(code.Key))
-                {
-                    auto fileName = GetShaderCodeFileName(code.Key);
-                    File::WriteAllBytes(fileName, code.Value->Buffer(), code.Value->Count());
-                }
-            }
-            for (auto & binding : bindingLayouts)
-            {
-                if (updatedCodeIndices.Contains(binding.Key))
-                {
-                    auto fileName = GetBindingLayoutFileName(binding.Key);
-                    WriteBindingLayout(fileName, binding.Value);
-                }
-            }
-            StreamWriter writer(GetCacheIndexFileName());
-            for (auto & idx : shaderCodeIndex)
-            {
-                writer << CoreLib::Text::EscapeStringLiteral(idx.Key) << " " << idx.Value << "\n";
-            }
-        }
-    };
-
     class SlangShaderCompiler : public IShaderCompiler
     {
     public:
@@ -206,19 +19,62 @@ namespace GameEngine
         EnumerableDictionary<String, RefPtr<ShaderTypeSymbol>> shaderTypeSymbols;
         SlangSession *session = nullptr;
         StringBuilder sb;
+        String cacheDirectory;
         ShaderCache cache;
+        EnumerableDictionary<String, uint64_t> sourceHashes;
+        // the Slang session, the shader cache and the symbol tables are shared by all requests,
+        // pipelines may be compiled on a background thread while the render thread loads symbols.
+        std::recursive_mutex compilerMutex;
         SlangShaderCompiler()
         {
-            cache.Load(Engine::Instance()->GetDirectory(false, ResourceType::ShaderCache), Engine::Instance()->GetTargetShadingLanguage());
+            cacheDirectory = Engine::Instance()->GetDirectory(false, ResourceType::ShaderCache);
+            cache.Load(cacheDirectory, Engine::Instance()->GetTargetShadingLanguage());
         }
         ~SlangShaderCompiler()
         {
-            cache.Save();
+            if (!cache.Save())
+                Print("warning: cannot write shader cache '%S'\n", cache.GetFileName().ToWString());
             for (auto cr : reflectionCompileRequests)
                 spDestroyCompileRequest(cr.Value);
             if (session)
                 spDestroySession(session);
         }
+        // Hash of a Slang file and of the modules it imports, computed once per run.
+        uint64_t GetSourceHash(const String & fileName)
+        {
+            uint64_t hash = 0;
+            if (sourceHashes.TryGetValue(fileName, hash))
+                return hash;
+            sourceHashes[fileName] = 0; // stops import cycles
+            hash = HashShaderCacheBytes(fileName.Buffer(), fileName.Length());
+            auto path = Engine::Instance()->FindFile(fileName, ResourceType::Shader);
+            if (path.Length())
+            {
+                auto source = File::ReadAllText(path);
+                hash = HashShaderCacheBytes(source.Buffer(), source.Length(), hash);
+                int lineStart = 0;
+                while (lineStart < source.Length())
+                {
+                    int lineEnd = source.IndexOf('\n', lineStart);
+                    if (lineEnd == -1)
+                        lineEnd = source.Length();
+                    auto line = source.SubString(lineStart, lineEnd - lineStart).Trim();
+                    lineStart = lineEnd + 1;
+                    int nameStart = line.StartsWith("import ") ? 7 : (line.StartsWith("__import ") ? 9 : -1);
+                    int nameEnd = line.IndexOf(';');
+                    if (nameStart == -1 || nameEnd < nameStart)
+                        continue;
+                    auto moduleName = line.SubString(nameStart, nameEnd - nameStart).Trim();
+                    // IMPORT_MODULE_n names the module of a specialization type, which is part of the key
+                    if (moduleName.StartsWith("IMPORT_MODULE_"))
+                        continue;
+                    uint64_t moduleHash = GetSourceHash(moduleName + ".slang");
+                    hash = HashShaderCacheBytes(&moduleHash, sizeof(moduleHash), hash);
+                }
+            }
+            sourceHashes[fileName] = hash;
+            return hash;
+        }
     public:
         int GetSlangTarget()
         {
@@ -292,6 +148,7 @@ namespace GameEngine
             const CoreLib::ArrayView<ShaderEntryPoint*> entryPoints,
             const ShaderCompilationEnvironment* env = nullptr) override
         {
+            std::lock_guard<std::recursive_mutex> lock(compilerMutex);
             StringBuilder sbKey;
             List<String> keys;
             src.ShaderCode.SetSize(entryPoints.Count());
@@ -301,13 +158,20 @@ namespace GameEngine
                 auto entryPoint = entryPoints[i];
                 sbKey.Clear();
                 sbKey << entryPoint->FileName << "|" << entryPoint->FunctionName;
+                // every request compiles ShaderLib.slang, and the specialization types import their own modules
+                uint64_t sourceHash = GetSourceHash(entryPoint->FileName);
+                uint64_t shaderLibHash = GetSourceHash("ShaderLib.slang");
+                sourceHash = HashShaderCacheBytes(&shaderLibHash, sizeof(shaderLibHash), sourceHash);
                 if (env)
                 {
                     for (auto & t : env->SpecializationTypes)
                     {
                         sbKey << "|" << t->TypeName;
+                        uint64_t typeHash = GetSourceHash(t->FileName);
+                        sourceHash = HashShaderCacheBytes(&typeHash, sizeof(typeHash), sourceHash);
                     }
                 }
+                sbKey << "|" << String((unsigned long long)sourceHash, 16);
                 keys.Add(sbKey.ToString());
                 List<char> code;
                 if (!cache.TryGetEntry(keys.Last(), src.ShaderCode[i], src.BindingLayouts))
@@ -426,10 +290,12 @@ namespace GameEngine
                 for (int i = 0; i < entryPointsToCompile.Count(); i++)
                 {
                     auto eid = entryPointsToCompile[i];
-                    char* glsl = nullptr;
+                    cache.UpdateEntry(keys[eid], src.ShaderCode[eid], src.BindingLayouts);
                     if (dumpShaderSource)
-                        glsl = glslOutput[i];
-                    cache.UpdateEntry(keys[eid], src.ShaderCode[eid], glsl, src.BindingLayouts);
+                    {
+                        auto sourceFileName = String("shader_") + String((unsigned long long)ShaderCache::HashKey(keys[eid]), 16) + ".glsl";
+                        File::WriteAllText(Path::Combine(cacheDirectory, sourceFileName), glslOutput[i]);
+                    }
                 }
 
                 spDestroyCompileRequest(req);
@@ -479,6 +345,7 @@ namespace GameEngine
         }
         virtual ShaderTypeSymbol* LoadTypeSymbol(CoreLib::String fileName, CoreLib::String TypeName) override
         {
+            std::lock_guard<std::recursive_mutex> lock(compilerMutex);
             sb.Clear();
             sb << fileName << "/" << TypeName;
             auto str = sb.ProduceString();
@@ -593,6 +460,7 @@ namespace GameEngine
         }
         virtual ShaderEntryPoint* LoadShaderEntryPoint(CoreLib::String fileName, CoreLib::String functionName) override
         {
+            std::lock_guard<std::recursive_mutex> lock(compilerMutex);
             sb.Clear();
             sb << fileName << "/" << functionName;
             auto str = sb.ProduceString();
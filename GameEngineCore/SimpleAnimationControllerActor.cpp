@@ -8,10 +8,20 @@ namespace GameEngine
     {
         Tick();
     }
+    bool SimpleAnimationControllerActor::LoadAnimation(const CoreLib::String & fileName)
+    {
+        simpleAnimation = nullptr;
+        compressedAnimation = nullptr;
+        if (CoreLib::IO::Path::GetFileExt(fileName).ToLower() == "canim")
+            compressedAnimation = level->LoadCompressedAnimation(fileName);
+        else
+            simpleAnimation = level->LoadSkeletalAnimation(fileName);
+        compressedAnimationCursor.SetClip(compressedAnimation);
+        return simpleAnimation || compressedAnimation;
+    }
     void SimpleAnimationControllerActor::AnimationFileName_Changing(CoreLib::String & newFileName)
     {
-        simpleAnimation = level->LoadSkeletalAnimation(newFileName);
-        if (!simpleAnimation)
+        if (!LoadAnimation(newFileName))
             newFileName = "";
         UpdateStates();
     }
@@ -30,7 +40,21 @@ namespace GameEngine
 		//	Engine::Instance()->RequestExit();
 		//	return;
 		//}
-        if (simpleAnimation && skeleton)
+        if (compressedAnimation && skeleton)
+        {
+            Pose p;
+            p.Transforms.SetSize(skeleton->Bones.Count());
+            for (int i = 0; i < skeleton->Bones.Count(); i++)
+                p.Transforms[i] = skeleton->Bones[i].BindPose;
+            float animTime = fmod(time * compressedAnimation->Speed, compressedAnimation->Duration);
+            compressedAnimationCursor.GetPose(p, skeleton, animTime);
+            for (int i = 0; i < TargetActors->Count(); i++)
+            {
+                if (auto target = GetTargetActor(i))
+                    target->SetPose(p);
+            }
+        }
+        else if (simpleAnimation && skeleton)
         {
 		    Pose p;
             p.Transforms.SetSize(skeleton->Bones.Count());
@@ -63,7 +87,7 @@ namespace GameEngine
         AnimationControllerActor::OnLoad();
 
 		if (AnimationFile.GetValue().Length())
-			simpleAnimation = level->LoadSkeletalAnimation(*AnimationFile);
+			LoadAnimation(*AnimationFile);
 		else
 			Engine::Print("The animation file path is not defined.\n");
 
@@ -2,6 +2,7 @@
 #define GAME_ENGINE_SIMPLE_ANIMATION_CONTROLLER_ACTOR
 
 #include "AnimationControllerActor.h"
+#include "CompressedAnimation.h"
 #include "CoreLib/VectorMath.h"
 
 namespace GameEngine
@@ -10,7 +11,11 @@ namespace GameEngine
     {
     protected:
         SkeletalAnimation * simpleAnimation = nullptr;
+        // set instead of simpleAnimation when the animation file is a compressed clip (.canim)
+        CompressedAnimationClip * compressedAnimation = nullptr;
+        CompressedAnimationCursor compressedAnimationCursor;
         Skeleton * skeleton = nullptr;
+        bool LoadAnimation(const CoreLib::String & fileName);
         virtual void EvalAnimation(float time) override;
         void UpdateStates();
         void AnimationFileName_Changing(CoreLib::String & newFileName);
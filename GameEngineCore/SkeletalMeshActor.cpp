@@ -21,10 +21,17 @@ namespace GameEngine
 		Tick();
 	}
 
+	const PoseEvaluationCache & SkeletalMeshActor::EvaluatePose(Skeleton * skeleton)
+	{
+		// the physics update in Tick() and all drawable elements in GetDrawables() share one evaluation
+		evaluatedPose.Evaluate(skeleton, nextPose, disableRetargetFile ? nullptr : retargetFile);
+		return evaluatedPose;
+	}
+
 	void SkeletalMeshActor::LocalTransform_Changing(VectorMath::Matrix4 & newTransform)
 	{
 		if (physInstance)
-			physInstance->SetTransform(newTransform, nextPose, retargetFile);
+			physInstance->SetTransform(newTransform, EvaluatePose(physInstance->skeleton));
 		if (errorPhysInstance)
 			errorPhysInstance->SetTransform(newTransform);
 	}
@@ -80,9 +87,10 @@ namespace GameEngine
 			}
 			disableRetargetFile = true;
 		}
+		evaluatedPose.Invalidate();
 		if (physInstance)
 		{
-			physInstance->SetTransform(*LocalTransform, nextPose, disableRetargetFile ? nullptr : retargetFile);
+			physInstance->SetTransform(*LocalTransform, EvaluatePose(physInstance->skeleton));
 		}
 		if ((!model || nextPose.Transforms.Count() == 0) && !errorPhysInstance)
 		{
@@ -97,6 +105,13 @@ namespace GameEngine
 		UpdateBounds();
 	}
 
+	bool SkeletalMeshActor::CanTickInParallel()
+	{
+		// Tick() adds or removes the error model's physics objects from the shared physics scene
+		// when the model or its skeleton is missing, so only a valid skeletal model is isolated
+		return model && model->GetSkeleton() && model->GetSkeleton()->Bones.Count() && !errorPhysInstance;
+	}
+
 	Pose SkeletalMeshActor::GetPose()
 	{
 		return nextPose;
@@ -105,6 +120,7 @@ namespace GameEngine
     void SkeletalMeshActor::SetPose(const Pose & p)
     {
         nextPose = p;
+        evaluatedPose.Invalidate();
     }
 
     VectorMath::Vec3 SkeletalMeshActor::GetRootPosition()
@@ -231,8 +247,7 @@ namespace GameEngine
             }
         }
         auto blendShapeWeightsView = blendShapeWeights.GetArrayView();
-		modelInstance.UpdateTransformUniform(*LocalTransform, nextPose,
-			disableRetargetFile ? nullptr : retargetFile, 
+		modelInstance.UpdateTransformUniform(*LocalTransform, EvaluatePose(model->GetSkeleton()),
 			hasBlendShape ? &blendShapeWeightsView : nullptr);
         AddDrawable(params, &modelInstance);
 	}
@@ -13,6 +13,7 @@ namespace GameEngine
 	{
 	private:
 		Pose nextPose;
+		PoseEvaluationCache evaluatedPose;
         CoreLib::List<BlendShapeWeightInfo> blendShapeWeights;
 		CoreLib::RefPtr<ModelPhysicsInstance> physInstance, errorPhysInstance;
 		ModelDrawableInstance modelInstance, errorModelInstance;
@@ -22,6 +23,7 @@ namespace GameEngine
 	protected:
 		void UpdateBounds();
 		void UpdateStates();
+		const PoseEvaluationCache & EvaluatePose(Skeleton * skeleton);
 		void LocalTransform_Changing(VectorMath::Matrix4 & newTransform);
 		void ModelFileName_Changing(CoreLib::String & newFileName);
 		void RetargetFileName_Changing(CoreLib::String & newFileName);
@@ -33,6 +35,7 @@ namespace GameEngine
         VectorMath::Vec3 GetRootOrientation();
         VectorMath::Matrix4 GetRootTransform();
 		virtual void Tick() override;
+		virtual bool CanTickInParallel() override;
 		Model * GetModel()
 		{
 			return model;
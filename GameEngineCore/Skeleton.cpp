@@ -1,11 +1,12 @@
 #include "Skeleton.h"
 #include "CoreLib/LibMath.h"
+#include "PoseSoA.h"
 
 namespace GameEngine
 {
 	using namespace CoreLib::IO;
 	
-	BoneTransformation AnimationChannel::Sample(float animTime)
+	BoneTransformation AnimationChannel::Sample(float animTime) const
 	{
 		BoneTransformation result;
 		int frame0 = BinarySearchForKeyFrame(KeyFrames, animTime);
@@ -26,7 +27,7 @@ namespace GameEngine
 
 	}
 
-	float BlendShapeAnimationChannel::Sample(float animTime)
+	float BlendShapeAnimationChannel::Sample(float animTime) const
     {
         int frame0 = BinarySearchForKeyFrame(KeyFrames, animTime);
         int frame1 = frame0 + 1;
@@ -283,101 +284,27 @@ namespace GameEngine
 	// used in Rendering
 	void Pose::GetMatrices(const Skeleton * skeleton, CoreLib::List<VectorMath::Matrix4>& matrices, bool multiplyInversePose, RetargetFile * retarget) const
 	{
-		matrices.Clear();
-		matrices.SetSize(skeleton->Bones.Count());
-        struct BoneRotationOverride
-        {
-            BoneTransformation transform;
-            float weight;
-        };
-        CoreLib::List<CoreLib::List<BoneRotationOverride>> morphStateOverrides;
-        if (retarget && retarget->MorphStates.Count())
-        {
-            morphStateOverrides.SetSize(matrices.Count());
-            for (auto &weight : BlendShapeWeights)
-            {
-                if (weight.Value == 0.0f)
-                    continue;
-                int msId = retarget->MorphStates.FindFirst([&](auto &ms) { return ms.Name == weight.Key; });
-                if (msId != -1)
-                {
-                    for (auto bs : retarget->MorphStates[msId].BoneStates)
-                    {
-                        morphStateOverrides[bs.BoneId].Add(BoneRotationOverride{bs.Transform, weight.Value});
-                    }
-                }
-            }
-        }
-
-		// Consider the case that the skeleton for animation may contain less bones than the skeleton for mesh
-		// So, we should skip those missing bones and using its bind pose
-		for (int i = 0; i < matrices.Count(); i++)
-		{
-            if (retarget)
-            {
-                matrices[i] = retarget->RetargetedBindPose[i].ToMatrix();
-            }
-            else
-            {
-				matrices[i] = skeleton->Bones[i].BindPose.ToMatrix();
-            }
-		}
+		ComputePoseMatrices(matrices, skeleton, *this, retarget, multiplyInversePose);
+	}
 
-		for (int i = 0; i < skeleton->BoneMapping.Count(); i++)
-		{
-			BoneTransformation transform;
-			int targetId = i;
-			if (retarget)
-			{
-				targetId = retarget->ModelBoneIdToAnimationBoneId[i];
-                if (targetId != -1)
-                    transform = Transforms[targetId];
-                if (i == 0)
-                {
-                    transform.Translation.x *= retarget->RootTranslationScale.x;
-                    transform.Translation.y *= retarget->RootTranslationScale.y;
-                    transform.Translation.z *= retarget->RootTranslationScale.z;
-                }
-                else
-					transform.Translation = retarget->RetargetedBindPose[i].Translation;
-                auto rotation = retarget->PreRotations[i] * transform.Rotation;
-                if (morphStateOverrides.Count() && morphStateOverrides[i].Count())
-                {
-                    for (auto &bs : morphStateOverrides[i])
-                    {
-                        rotation = VectorMath::Quaternion::Slerp(rotation, bs.transform.Rotation, bs.weight * 0.01f);
-                        transform.Translation =
-                            VectorMath::Vec3::Lerp(transform.Translation, bs.transform.Translation, bs.weight * 0.01f);
-                    }
-                }
-                matrices[i] = (rotation * retarget->PostRotations[i]).ToMatrix4();
-                matrices[i].SetTranslation(transform.Translation);
-			}
-			else
-			{
-				transform = Transforms[i];
-				if (i != 0)
-					transform.Translation = skeleton->Bones[i].BindPose.Translation;
-                matrices[i] = transform.ToMatrix();
-			}
-		}
-		for (int i = 1; i < skeleton->Bones.Count(); i++)
-		{
-			VectorMath::Matrix4::Multiply(matrices[i], matrices[skeleton->Bones[i].ParentId], matrices[i]);
-		}
+	void PoseEvaluationCache::Evaluate(const Skeleton * pSkeleton, const Pose & pose, RetargetFile * pRetarget)
+	{
+		if (!IsValid(pSkeleton, pRetarget))
+			Update(pSkeleton, pose, pRetarget);
+	}
 
-		if (multiplyInversePose)
+	void PoseEvaluationCache::Update(const Skeleton * pSkeleton, const Pose & pose, RetargetFile * pRetarget)
+	{
+		pose.GetMatrices(pSkeleton, Matrices, true, pRetarget);
+		BoneTransforms.SetSize(Matrices.Count());
+		for (int i = 0; i < Matrices.Count(); i++)
 		{
-			if (retarget)
-			{
-				for (int i = 0; i < skeleton->Bones.Count(); i++)
-					VectorMath::Matrix4::Multiply(matrices[i], matrices[i], retarget->RetargetedInversePose[i]);
-			}
-			else
-			{
-				for (int i = 0; i < matrices.Count(); i++)
-					VectorMath::Matrix4::Multiply(matrices[i], matrices[i], skeleton->InversePose[i]);
-			}
+			auto & m = Matrices[i];
+			BoneTransforms[i].FromRotationTranslation(VectorMath::Quaternion::FromMatrix(m.GetMatrix3()),
+				VectorMath::Vec3::Create(m.values[12], m.values[13], m.values[14]));
 		}
+		skeleton = pSkeleton;
+		retarget = pRetarget;
+		valid = true;
 	}
 }
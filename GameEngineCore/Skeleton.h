@@ -159,6 +159,31 @@ namespace GameEngine
 		void GetMatrices(const Skeleton * skeleton, CoreLib::List<VectorMath::Matrix4> & matrices, bool multiplyInversePose = true, RetargetFile * retarget = nullptr) const;
 	};
 
+	// Skinning matrices of a pose and their dual quaternion form, evaluated once per frame and shared by
+	// every consumer of a skeletal model instance (drawable elements and per-bone physics objects).
+	// The buffers are kept between evaluations so that steady state updates do not allocate.
+	class PoseEvaluationCache
+	{
+	private:
+		const Skeleton * skeleton = nullptr;
+		RetargetFile * retarget = nullptr;
+		bool valid = false;
+	public:
+		CoreLib::List<VectorMath::Matrix4> Matrices;
+		CoreLib::List<VectorMath::DualQuaternion> BoneTransforms;
+		void Invalidate()
+		{
+			valid = false;
+		}
+		bool IsValid(const Skeleton * pSkeleton, RetargetFile * pRetarget) const
+		{
+			return valid && skeleton == pSkeleton && retarget == pRetarget;
+		}
+		// re-evaluates the pose only if the cache was invalidated or is keyed on a different skeleton or retarget file
+		void Evaluate(const Skeleton * pSkeleton, const Pose & pose, RetargetFile * pRetarget);
+		void Update(const Skeleton * pSkeleton, const Pose & pose, RetargetFile * pRetarget);
+	};
+
 	class AnimationKeyFrame
 	{
 	public:
@@ -166,7 +191,7 @@ namespace GameEngine
 		BoneTransformation Transform;
 	};
 
-	template <typename TKeyFrame> int BinarySearchForKeyFrame(CoreLib::List<TKeyFrame> &KeyFrames, float time)
+	template <typename TKeyFrame> int BinarySearchForKeyFrame(const CoreLib::List<TKeyFrame> &KeyFrames, float time)
     {
         int begin = 0;
         int end = KeyFrames.Count();
@@ -195,7 +220,7 @@ namespace GameEngine
 		CoreLib::String BoneName;
 		int BoneId = -1;
 		CoreLib::List<AnimationKeyFrame> KeyFrames;
-		BoneTransformation Sample(float time);
+		BoneTransformation Sample(float time) const;
 	};
 
 	struct BlendShapeAnimationKeyFrame
@@ -208,7 +233,7 @@ namespace GameEngine
     {
         CoreLib::String Name;
         CoreLib::List<BlendShapeAnimationKeyFrame> KeyFrames;
-        float Sample(float time);
+        float Sample(float time) const;
     };
 
 	class SkeletalAnimation
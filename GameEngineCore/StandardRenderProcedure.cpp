@@ -7,6 +7,7 @@
 #include "AtmosphereActor.h"
 #include "ToneMappingActor.h"
 #include "FrustumCulling.h"
+#include "DrawableSpatialIndex.h"
 #include "RenderProcedure.h"
 #include "StandardViewUniforms.h"
 #include "LightingData.h"
@@ -74,9 +75,11 @@ namespace GameEngine
         ModuleInstance viewParams;
         CoreLib::List<ModuleInstance> shadowViewInstances;
 
+        SceneResource * sceneResource = nullptr;
         DrawableSink sink;
+        DrawableSpatialIndex spatialIndex;
 
-        List<Drawable*> reorderBuffer, drawableBuffer;
+        List<Drawable*> reorderBuffer, drawableBuffer, cameraVisibleDrawables;
         LightingEnvironment lighting;
         AtmosphereParameters lastAtmosphereParams;
         ToneMappingParameters lastToneMappingParams;
@@ -124,6 +127,7 @@ namespace GameEngine
         }
         virtual void UpdateSceneResourceBinding(SceneResource* sceneRes) override
         {
+            sceneResource = sceneRes;
             lighting.UpdateSceneResourceBinding(sceneRes);
         }
 
@@ -273,28 +277,20 @@ namespace GameEngine
             Shadow, CustomDepth, Main, Transparent
         };
 
-        ArrayView<Drawable*> GetDrawable(DrawableSink * objSink, PassType pass, CullFrustum cf, bool append)
+        // selects the drawables of a camera pass from the camera visibility set computed once per frame
+        ArrayView<Drawable*> GetDrawable(PassType pass)
         {
-            if (!append)
-                drawableBuffer.Clear();
-            for (auto obj : objSink->GetDrawables(pass == PassType::Transparent))
+            drawableBuffer.Clear();
+            for (auto obj : cameraVisibleDrawables)
             {
-                if (pass == PassType::Shadow && !obj->CastShadow)
-                    continue;
-                if (pass == PassType::CustomDepth && !obj->RenderCustomDepth)
-                    continue;
-                if (cf.IsBoxInFrustum(obj->Bounds))
-                    drawableBuffer.Add(obj);
-            }
-            if (pass == PassType::CustomDepth)
-            {
-                for (auto obj : objSink->GetDrawables(true))
+                if (pass == PassType::CustomDepth)
                 {
                     if (!obj->RenderCustomDepth)
                         continue;
-                    if (cf.IsBoxInFrustum(obj->Bounds))
-                        drawableBuffer.Add(obj);
                 }
+                else if (obj->IsTransparent() != (pass == PassType::Transparent))
+                    continue;
+                drawableBuffer.Add(obj);
             }
             return drawableBuffer.GetArrayView();
         }
@@ -418,18 +414,24 @@ namespace GameEngine
                     lastToneMappingParams = toneMappingParameters;
                 }
             }
+            // synchronize the visibility tree with this frame's drawables and cull the camera view once for all passes
+            spatialIndex.Update(sink);
+            auto cameraCullFrustum = CullFrustum(params.view.GetFrustum(aspect));
+            spatialIndex.Query(cameraCullFrustum, cameraVisibleDrawables, [](Drawable *) { return true; });
+            if (sceneResource)
+                sceneResource->RequestStreamedTextures(cameraVisibleDrawables.GetArrayView(), params.view.Position);
+
             // collect light data and render shadow maps
-            lighting.GatherInfo(hardwareRenderer, &sink, params, w, h, viewUniform, shadowRenderPass.Ptr());
+            lighting.GatherInfo(hardwareRenderer, &spatialIndex, params, w, h, viewUniform, shadowRenderPass.Ptr());
 
             viewParams.SetUniformData(&viewUniform, (int)sizeof(viewUniform));
-            auto cameraCullFrustum = CullFrustum(params.view.GetFrustum(aspect));
 
             // custom depth pass
             Array<Texture*, 8> textures;
             customDepthOutput->GetFrameBuffer()->GetRenderAttachments().GetTextures(textures);
             customDepthRenderPass->Bind();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
-            customDepthPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::CustomDepth, cameraCullFrustum, false));
+            customDepthPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::CustomDepth));
             sharedRes->pipelineManager.PopModuleInstance();
             customDepthPassInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
 
@@ -441,10 +443,10 @@ namespace GameEngine
             prezTextures.Add(textures[0]);
             customDepthRenderPass->Bind();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
-            preZPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Main, cameraCullFrustum, false));
+            preZPassInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::Main));
             sharedRes->pipelineManager.PopModuleInstance();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
-            preZPassTransparentInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Transparent, cameraCullFrustum, false));
+            preZPassTransparentInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::Transparent));
             sharedRes->pipelineManager.PopModuleInstance();
             preZPassInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
             preZPassTransparentInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
@@ -498,7 +500,7 @@ namespace GameEngine
             forwardRenderPass->Bind();
             sharedRes->pipelineManager.PushModuleInstance(&viewParams);
             sharedRes->pipelineManager.PushModuleInstance(&lighting.moduleInstance);
-            forwardBaseInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(&sink, PassType::Main, cameraCullFrustum, false));
+            forwardBaseInstance->SetDrawContent(sharedRes->pipelineManager, reorderBuffer, GetDrawable(PassType::Main));
             sharedRes->pipelineManager.PopModuleInstance();
             sharedRes->pipelineManager.PopModuleInstance();
             forwardBaseInstance->Execute(hardwareRenderer, *params.renderStats, PipelineBarriers::MemoryAndImage);
@@ -526,7 +528,7 @@ namespace GameEngine
             }
             // transparency pass
             reorderBuffer.Clear();
-            for (auto drawable : GetDrawable(&sink, PassType::Transparent, cameraCullFrustum, false))
+            for (auto drawable : GetDrawable(PassType::Transparent))
             {
                 reorderBuffer.Add(drawable);
             }
@@ -1,5 +1,5 @@
 #include "StaticScene.h"
-#include "Bvh.h"
+#include "WideBvh.h"
 #include "Level.h"
 #include "CoreLib/Graphics/BBox.h"
 #include "StaticMeshActor.h"
@@ -31,60 +31,51 @@ namespace GameEngine
         }
     };
 
-    // Trace Triangle
-    class MeshTracer
+    class StaticSceneImpl : public StaticScene
     {
-    public:
-        inline bool Trace(StaticSceneTracingResult & inter, const StaticFace & face, const Ray & ray, float & t) const
+    private:
+        inline void FillResult(StaticSceneTracingResult & inter, const WideBvhHit & hit)
         {
-            Vec3 e1 = face.verts[1] - face.verts[0];
-            Vec3 e2 = face.verts[2] - face.verts[0];
-            Vec3 s1 = Vec3::Cross(ray.Dir, e2);
-            float di = Vec3::Dot(s1, e1);
-            float  invd = 1.0f / (di);
-            Vec3 d = ray.Origin - face.verts[0];
-            float  b1 = Vec3::Dot(d, s1) * invd;
-            Vec3 s2 = Vec3::Cross(d, e1);
-            float  b2 = Vec3::Dot(ray.Dir, s2) * invd;
-            float temp = Vec3::Dot(e2, s2) * invd;
-            if (b1 < 0.f || b1 > 1.f || b2 < 0.f || b1 + b2 > 1.f || temp < 1e-5f || temp > ray.tMax)
-            {
-                return false;
-            }
-            else
-            {
-                t = inter.T = temp;
-                inter.IsHit = true;
-                inter.MapId = face.mapId;
-                inter.Normal = face.normal;
-                inter.CastShadow = (face.castShadow != 0);
-                inter.UV = face.uvs[0] * (1.0f - b1 - b2) + face.uvs[1] * b1 + face.uvs[2] * b2;
-                return true;
-            }
+            if (hit.Id == -1)
+                return;
+            auto & face = faces[hit.Id];
+            inter.T = hit.T;
+            inter.IsHit = true;
+            inter.MapId = face.mapId;
+            inter.Normal = face.normal;
+            inter.CastShadow = (face.castShadow != 0);
+            inter.UV = face.uvs[0] * (1.0f - hit.U - hit.V) + face.uvs[1] * hit.U + face.uvs[2] * hit.V;
         }
-    };
-
-    Vec3 SafeRcp(Vec3 vin)
-    {
-        Vec3 rs;
-        if (vin.x > 1e-10f || vin.x < -1e-10f) rs.x = 1.0f / vin.x; else rs.x = 0.0f;
-        if (vin.y > 1e-10f || vin.y < -1e-10f) rs.y = 1.0f / vin.y; else rs.y = 0.0f;
-        if (vin.z > 1e-10f || vin.z < -1e-10f) rs.z = 1.0f / vin.z; else rs.z = 0.0f;
-        return rs;
-    }
-
-    class StaticSceneImpl : public StaticScene
-    {
     public:
-        Bvh<StaticFace> bvh;
+        List<StaticFace> faces;
+        TriangleBvh4 bvh;
         virtual StaticSceneTracingResult TraceRay(const Ray & ray) override
         {
             StaticSceneTracingResult result;
-            MeshTracer tracer;
-            Vec3 rcpDir = SafeRcp(ray.Dir);
-            TraverseBvh<StaticFace, MeshTracer, StaticSceneTracingResult, false>(tracer, result, bvh, ray, rcpDir);
+            FillResult(result, bvh.TraceRay(ray));
             return result;
         }
+        virtual void TraceRays(ArrayView<Ray> rays, ArrayView<StaticSceneTracingResult> results) override
+        {
+            for (int start = 0; start < rays.Count(); start += RayPacket4::Size)
+            {
+                RayPacket4 packet;
+                int count = Math::Min(rays.Count() - start, RayPacket4::Size);
+                for (int i = 0; i < count; i++)
+                    packet.Add(rays[start + i]);
+                WideBvhHit hits[RayPacket4::Size];
+                bvh.TraceRays(packet, hits);
+                for (int i = 0; i < count; i++)
+                {
+                    results[start + i] = StaticSceneTracingResult();
+                    FillResult(results[start + i], hits[i]);
+                }
+            }
+        }
+        virtual bool TraceOcclusion(const Ray & ray) override
+        {
+            return bvh.TraceOcclusion(ray);
+        }
     };
 
     void AddMeshInstance(List<StaticFace>& faces, Mesh * mesh, Matrix4 localTransform, int id, bool castShadow)
@@ -164,7 +155,7 @@ namespace GameEngine
     {
         StaticSceneImpl* scene = new StaticSceneImpl();
         GatherLights(scene, level);
-        List<StaticFace> faces;
+        auto & faces = scene->faces;
         int id = 0;
         for (auto actor : level->Actors)
         {
@@ -177,6 +168,8 @@ namespace GameEngine
                 }
             }
         }
+        if (faces.Count() == 0)
+            return scene;
         Bvh_Build<StaticFace> bvhBuild;
         MeshBvhEvaluator costEvaluator;
         List<BuildData<StaticFace>> elements;
@@ -190,7 +183,7 @@ namespace GameEngine
             elements[i].Center = (elements[i].Bounds.Min + elements[i].Bounds.Max) * 0.5f;
         }
         ConstructBvh(bvhBuild, elements.Buffer(), elements.Count(), costEvaluator);
-        scene->bvh.FromBuild(bvhBuild);
+        scene->bvh.FromBuild(bvhBuild, faces.Buffer(), [](const StaticFace & face, int i) { return face.verts[i]; });
         return scene;
     }
 }
\ No newline at end of file
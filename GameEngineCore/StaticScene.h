@@ -40,6 +40,12 @@ namespace GameEngine
         CoreLib::List<StaticLight> lights;
         VectorMath::Vec3 ambientColor;
         virtual StaticSceneTracingResult TraceRay(const Ray & ray) = 0;
+        // Closest hit of each ray, results[i] receives the result of rays[i]. Rays are traced in packets,
+        // so this is faster than calling TraceRay repeatedly when the rays are coherent (e.g. share an origin).
+        virtual void TraceRays(CoreLib::ArrayView<Ray> rays, CoreLib::ArrayView<StaticSceneTracingResult> results) = 0;
+        // Returns true if the ray hits any face before ray.tMax. Cheaper than TraceRay because traversal
+        // stops at the first hit.
+        virtual bool TraceOcclusion(const Ray & ray) = 0;
     };
 
     StaticScene* BuildStaticScene(Level* level);
@@ -1,4 +1,5 @@
 #include "TextureCompressor.h"
+#include "BlockCompression.h"
 #define STB_DXT_IMPLEMENTATION
 #include "TextureTool/stb_dxt.h"
 
@@ -7,7 +8,8 @@ namespace GameEngine
 	using namespace CoreLib;
 	using namespace CoreLib::Graphics;
 
-	CoreLib::List<unsigned char> Resample(const CoreLib::List<unsigned char> &rgbaPixels, int w, int h, int & nw, int & nh)
+	template<typename TChannel, int Channels>
+	CoreLib::List<TChannel> Resample(const CoreLib::List<TChannel> &rgbaPixels, int w, int h, int & nw, int & nh)
 	{
 		nw = w / 2;
 		nh = h / 2;
@@ -15,8 +17,8 @@ namespace GameEngine
 			nw = 1;
 		if (nh < 1)
 			nh = 1;
-		CoreLib::List<unsigned char> rs;
-		rs.SetSize(nh * nw * 4);
+		CoreLib::List<TChannel> rs;
+		rs.SetSize(nh * nw * Channels);
 		for (int i = 0; i < nh; i++)
 		{
 			int i0 = Math::Clamp(i * 2, 0, h - 1);
@@ -25,18 +27,47 @@ namespace GameEngine
 			{
 				int j0 = Math::Clamp(j * 2, 0, w - 1);
 				int j1 = Math::Clamp(j * 2 + 1, 0, w - 1);
-				for (int k = 0; k < 4; k++)
-					rs[(i * nw + j) * 4 + k] = (rgbaPixels[(i0 * w + j0) * 4 + k] 
-						+ rgbaPixels[(i0 * w + j1) * 4 + k] 
-						+ rgbaPixels[(i1 * w + j0) * 4 + k] 
-						+ rgbaPixels[(i1 * w + j1) * 4 + k]) / 4;
+				for (int k = 0; k < Channels; k++)
+					rs[(i * nw + j) * Channels + k] = (rgbaPixels[(i0 * w + j0) * Channels + k] 
+						+ rgbaPixels[(i0 * w + j1) * Channels + k] 
+						+ rgbaPixels[(i1 * w + j0) * Channels + k] 
+						+ rgbaPixels[(i1 * w + j1) * Channels + k]) / 4;
 			}
 		}
 		return rs;
 	}
 
-    template<typename TBlockCompressFunc>
-    void CompressTexture(TextureFile & result, TextureStorageFormat format, const TBlockCompressFunc & compressFunc, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height)
+    // compresses one surface, compressFunc receives 4x4 texels of `Channels` components each
+    template<typename TChannel, int Channels, typename TBlockCompressFunc>
+    void CompressSurface(unsigned char * output, int blockSize, const TBlockCompressFunc & compressFunc, const TChannel * pixels, int w, int h)
+    {
+        int blocksPerRow = (w + 3) / 4;
+        #pragma omp parallel for
+        for (int i = 0; i < h; i += 4)
+        {
+            for (int j = 0; j < w; j += 4)
+            {
+                TChannel block[16 * Channels];
+                unsigned char outBlock[16];
+                for (int ki = 0; ki < 4; ki++)
+                {
+                    int ni = Math::Clamp(i + ki, 0, h - 1);
+                    for (int kj = 0; kj < 4; kj++)
+                    {
+                        int nj = Math::Clamp(j + kj, 0, w - 1);
+                        for (int c = 0; c < Channels; c++)
+                            block[(ki * 4 + kj) * Channels + c] = pixels[(ni * w + nj) * Channels + c];
+                    }
+                }
+                compressFunc(outBlock, block);
+                int ptr = (i/4) * blocksPerRow + (j/4);
+                memcpy(output + ptr * blockSize, outBlock, blockSize);
+            }
+        }
+    }
+
+    template<typename TChannel, int Channels, typename TBlockCompressFunc>
+    void CompressTexture(TextureFile & result, TextureStorageFormat format, const TBlockCompressFunc & compressFunc, const CoreLib::ArrayView<TChannel> & pixels, int width, int height)
     {
         int blockSize = 0;
         switch (format)
@@ -47,8 +78,8 @@ namespace GameEngine
         default:
             blockSize = 16;
         }
-        List<unsigned char> input;
-        input.AddRange(rgbaPixels.Buffer(), rgbaPixels.Count());
+        List<TChannel> input;
+        input.AddRange(pixels.Buffer(), pixels.Count());
         int w = width;
         int h = height;
         int level = 0;
@@ -56,32 +87,11 @@ namespace GameEngine
         while (w >= 1 || h >= 1)
         {
             auto buffer = result.GetBuffer(level);
-            int blocksPerRow = (w + 3) / 4;
-            #pragma omp parallel for
-            for (int i = 0; i < h; i += 4)
-            {
-                for (int j = 0; j < w; j += 4)
-                {
-                    unsigned char block[64], outBlock[16];
-                    for (int ki = 0; ki < 4; ki++)
-                    {
-                        int ni = Math::Clamp(i + ki, 0, h - 1);
-                        for (int kj = 0; kj < 4; kj++)
-                        {
-                            int nj = Math::Clamp(j + kj, 0, w - 1);
-                            for (int c = 0; c < 4; c++)
-                                block[(ki * 4 + kj) * 4 + c] = input[(ni * w + nj) * 4 + c];
-                        }
-                    }
-                    compressFunc(outBlock, block);
-                    int ptr = (i/4) * blocksPerRow + (j/4);
-                    memcpy(buffer.Buffer() + ptr * blockSize, outBlock, blockSize);
-                }
-            }
+            CompressSurface<TChannel, Channels>(buffer.Buffer(), blockSize, compressFunc, input.Buffer(), w, h);
 
             if (w == 1 && h == 1) break;
             int nw, nh;
-            input = Resample(input, w, h, nw, nh);
+            input = Resample<TChannel, Channels>(input, w, h, nw, nh);
             w = nw;
             h = nh;
             level++;
@@ -90,7 +100,7 @@ namespace GameEngine
 
 	void TextureCompressor::CompressRGBA_BC1(TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height)
 	{
-        CompressTexture(
+        CompressTexture<unsigned char, 4>(
             result, TextureStorageFormat::BC1,
             [](unsigned char *output, unsigned char *input) {
                 stb_compress_dxt_block(output, input, 0, STB_DXT_HIGHQUAL);
@@ -100,18 +110,82 @@ namespace GameEngine
 
 	void TextureCompressor::CompressRGBA_BC3(TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height)
 	{
-        CompressTexture(result, TextureStorageFormat::BC3, [](unsigned char* output, unsigned char* input) {stb_compress_dxt_block(output, input, 1, STB_DXT_HIGHQUAL); },
+        CompressTexture<unsigned char, 4>(result, TextureStorageFormat::BC3, [](unsigned char* output, unsigned char* input) {stb_compress_dxt_block(output, input, 1, STB_DXT_HIGHQUAL); },
             rgbaPixels, width, height);
 	}
 
 	void TextureCompressor::CompressRG_BC5(TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height)
 	{
-        CompressTexture(result, TextureStorageFormat::BC5, [](unsigned char* output, unsigned char* input)
+        CompressTexture<unsigned char, 4>(result, TextureStorageFormat::BC5, [](unsigned char* output, unsigned char* input)
             {
                 stb__CompressAlphaBlock(output, (unsigned char*)input, 4);
                 stb__CompressAlphaBlock(output + 8, (unsigned char*)input + 1, 4);
             },
             rgbaPixels, width, height);
 	}
-}
 
+	void TextureCompressor::CompressRGBA_BC7(TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height, TextureCompressionQuality quality)
+	{
+        CompressTexture<unsigned char, 4>(result, TextureStorageFormat::BC7, [=](unsigned char* output, unsigned char* input) {CompressBlock_BC7(output, input, quality); },
+            rgbaPixels, width, height);
+	}
+
+	void TextureCompressor::CompressRGB_BC6H(TextureFile & result, const CoreLib::ArrayView<float> & rgbPixels, int width, int height, TextureCompressionQuality quality)
+	{
+        CompressTexture<float, 3>(result, TextureStorageFormat::BC6H, [=](unsigned char* output, float* input) {CompressBlock_BC6H(output, input, quality); },
+            rgbPixels, width, height);
+	}
+
+	static void CompressRGBA(TextureFile & result, TextureStorageFormat format, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height, TextureCompressionQuality quality)
+	{
+		switch (format)
+		{
+		case TextureStorageFormat::BC1:
+			TextureCompressor::CompressRGBA_BC1(result, rgbaPixels, width, height);
+			break;
+		case TextureStorageFormat::BC3:
+			TextureCompressor::CompressRGBA_BC3(result, rgbaPixels, width, height);
+			break;
+		case TextureStorageFormat::BC5:
+			TextureCompressor::CompressRG_BC5(result, rgbaPixels, width, height);
+			break;
+		case TextureStorageFormat::BC7:
+			TextureCompressor::CompressRGBA_BC7(result, rgbaPixels, width, height, quality);
+			break;
+		default:
+			throw ArgumentException("format is not an RGBA block compression format.");
+		}
+	}
+
+	void TextureCompressor::CompressTopDownRGBA(TextureFile & result, TextureStorageFormat format, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height, TextureCompressionQuality quality)
+	{
+		bool canFlipBlocks = true;
+		for (int w = width, h = height; canFlipBlocks; w = Math::Max(1, w / 2), h = Math::Max(1, h / 2))
+		{
+			canFlipBlocks = CanFlipTextureRows(format, w, h);
+			if (w == 1 && h == 1)
+				break;
+		}
+		if (canFlipBlocks)
+		{
+			CompressRGBA(result, format, rgbaPixels, width, height, quality);
+			result.SetRowOrder(TextureRowOrder::TopDown);
+			result.FlipRows();
+		}
+		else
+		{
+			List<unsigned int> pixelsInversed;
+			auto sourcePixels = (const unsigned int *)rgbaPixels.Buffer();
+			pixelsInversed.SetSize(width * height);
+			for (int i = 0; i < height; i++)
+				memcpy(pixelsInversed.Buffer() + i * width, sourcePixels + (height - 1 - i) * width, width * sizeof(unsigned int));
+			CompressRGBA(result, format, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), width, height, quality);
+		}
+	}
+
+	void TextureCompressor::CompressSurfaceRGB_BC6H(unsigned char * output, const float * rgbPixels, int width, int height, TextureCompressionQuality quality)
+	{
+        CompressSurface<float, 3>(output, 16, [=](unsigned char* output, float* input) {CompressBlock_BC6H(output, input, quality); },
+            rgbPixels, width, height);
+	}
+}
\ No newline at end of file
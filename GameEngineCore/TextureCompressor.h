@@ -3,6 +3,7 @@
 
 #include "CoreLib/Basic.h"
 #include "CoreLib/Graphics/TextureFile.h"
+#include "BlockCompression.h"
 
 namespace GameEngine
 {
@@ -12,6 +13,19 @@ namespace GameEngine
 		static void CompressRGBA_BC1(CoreLib::Graphics::TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height);
 		static void CompressRGBA_BC3(CoreLib::Graphics::TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height);
 		static void CompressRG_BC5(CoreLib::Graphics::TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height);
+		static void CompressRGBA_BC7(CoreLib::Graphics::TextureFile & result, const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height,
+			TextureCompressionQuality quality = TextureCompressionQuality::Normal);
+		// rgbPixels holds three floats per pixel
+		static void CompressRGB_BC6H(CoreLib::Graphics::TextureFile & result, const CoreLib::ArrayView<float> & rgbPixels, int width, int height,
+			TextureCompressionQuality quality = TextureCompressionQuality::Normal);
+		// Compresses an image in the top-down row order of image files into a bottom-up texture file (BC1, BC3, BC5
+		// or BC7). The compressed blocks are flipped when the format and size allow it, which is much cheaper
+		// than flipping the pixels before compression.
+		static void CompressTopDownRGBA(CoreLib::Graphics::TextureFile & result, CoreLib::Graphics::TextureStorageFormat format,
+			const CoreLib::ArrayView<unsigned char> & rgbaPixels, int width, int height, TextureCompressionQuality quality = TextureCompressionQuality::Normal);
+		// compresses a single surface without mip levels into ((width + 3) / 4) * ((height + 3) / 4) blocks at output
+		static void CompressSurfaceRGB_BC6H(unsigned char * output, const float * rgbPixels, int width, int height,
+			TextureCompressionQuality quality = TextureCompressionQuality::Normal);
 	};
 }
 
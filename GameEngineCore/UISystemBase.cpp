@@ -58,10 +58,41 @@ namespace GameEngine
         return rs;
     }
 
+    void SystemFont::UpdateFontContext(int dpi)
+    {
+        rasterizer->SetFont(fontDesc, dpi);
+        // glyphs rasterized for the previous dpi are no longer drawn and age out of the atlas
+        glyphAtlasFontId = system->GetGlyphAtlas().RegisterFont();
+    }
+
     GraphicsUI::IBakedText* SystemFont::BakeString(const CoreLib::String& text, GraphicsUI::IBakedText* previous, GraphicsUI::DrawTextOptions options)
     {
         BakedText* prev = (BakedText*)previous;
         auto prevBuffer = (prev ? prev->textBuffer : nullptr);
+        List<GlyphPlacement> glyphs;
+        TextSize size;
+        if (rasterizer->LayoutGlyphs(text, options, glyphs, size))
+        {
+            // glyphs are uploaded when drawn, no need to wait for the frame reading the previous text
+            BakedText* result = prev ? prev : new BakedText();
+            if (prevBuffer)
+            {
+                system->WaitForDrawFence();
+                system->FreeTextBuffer(prevBuffer, prev->BufferSize);
+                prev->textBuffer = nullptr;
+                prev->BufferSize = 0;
+            }
+            result->font = this;
+            result->options = options;
+            result->textContent = text;
+            result->system = system;
+            result->UsesGlyphAtlas = true;
+            result->Glyphs = _Move(glyphs);
+            result->Width = size.x;
+            result->Height = size.y;
+            system->bakedTexts.Add(result);
+            return result;
+        }
         system->WaitForDrawFence();
         BakedText* result = prev;
         if (!prevBuffer)
@@ -83,7 +114,6 @@ namespace GameEngine
         // Allocate GPU text buffer.
         int pixelCount = (Width * Height);
         int bytes = pixelCount >> Log2TextPixelsPerByte;
-        int textPixelMask = (1 << TextPixelBits) - 1;
         if (pixelCount & ((1 << Log2TextPixelsPerByte) - 1))
             bytes++;
         bytes = Math::RoundUpToAlignment(bytes, 1 << Log2TextBufferBlockSize);
@@ -95,20 +125,8 @@ namespace GameEngine
             BufferSize = bytes;
         }
         // Store compressed text data in the allocated GPU buffer.
-        const float valScale = ((1 << TextPixelBits) - 1) / 255.0f;
-        for (int i = 0; i < Height; i++)
-        {
-            for (int j = 0; j < Width; j++)
-            {
-                int idx = i * Width + j;
-                auto val = imageData.ImageData[idx];
-                auto packedVal = Math::FastFloor(val * valScale + 0.5f);
-                int addr = idx >> Log2TextPixelsPerByte;
-                int mod = idx & ((1 << Log2TextPixelsPerByte) - 1);
-                int mask = textPixelMask << (mod * TextPixelBits);
-                textBuffer[addr] = (unsigned char)((textBuffer[addr] & (~mask)) | (packedVal << (mod * TextPixelBits)));
-            }
-        }
+        if (textBuffer)
+            PackTextPixels(textBuffer, imageData.ImageData, pixelCount);
     }
 
     BakedText::~BakedText()
@@ -482,12 +500,69 @@ namespace GameEngine
             glContext->BindVertexArray(posUvVertexArray);
             glContext->DrawArray(GL::PrimitiveType::TriangleFans, 0, 4);*/
         }
+        void DrawGlyphQuads(BakedText * text, const GraphicsUI::Color & fontColor, float x, float y, float x1, float y1)
+        {
+            auto & atlas = system->GetGlyphAtlas();
+            auto font = text->font;
+            // glyphs are clipped to the text rectangle like the pixels of a baked text
+            float clipX = Math::Max(clipRect.x, x), clipY = Math::Max(clipRect.y, y);
+            float clipX1 = Math::Min(clipRect.z, x1), clipY1 = Math::Min(clipRect.w, y1);
+            if (clipX >= clipX1 || clipY >= clipY1)
+                return;
+            for (auto & glyph : text->Glyphs)
+            {
+                if (IsBufferFull())
+                    return;
+                auto entry = atlas.Find(font->glyphAtlasFontId, glyph.Glyph);
+                if (!entry)
+                {
+                    auto imageData = font->rasterizer->RasterizeGlyph(glyph.Glyph);
+                    entry = atlas.Add(font->glyphAtlasFontId, glyph.Glyph, imageData.Size.x, imageData.Size.y, imageData.ImageData);
+                }
+                // the atlas is full of glyphs used by frames in flight, skip the glyph for this frame
+                if (!entry || entry->Address == -1)
+                    continue;
+                float gx = x + glyph.X, gy = y + glyph.Y;
+                float gx1 = gx + glyph.Width, gy1 = gy + glyph.Height;
+                indexStream.Add(vertexStream.Count());
+                indexStream.Add(vertexStream.Count() + 1);
+                indexStream.Add(vertexStream.Count() + 2);
+                indexStream.Add(vertexStream.Count() + 3);
+                indexStream.Add(-1);
+
+                UberVertex vertexData[4];
+                vertexData[0].x = gx; vertexData[0].y = gy; vertexData[0].u = 0.0f; vertexData[0].v = 0.0f; vertexData[0].inputIndex = primCounter;
+                vertexData[1].x = gx; vertexData[1].y = gy1; vertexData[1].u = 0.0f; vertexData[1].v = 1.0f; vertexData[1].inputIndex = primCounter;
+                vertexData[2].x = gx1; vertexData[2].y = gy; vertexData[2].u = 1.0f; vertexData[2].v = 0.0f; vertexData[2].inputIndex = primCounter;
+                vertexData[3].x = gx1; vertexData[3].y = gy1; vertexData[3].u = 1.0f; vertexData[3].v = 1.0f; vertexData[3].inputIndex = primCounter;
+                vertexStream.AddRange(vertexData, 4);
+
+                UniformField fields;
+                fields.ClipRectX = (unsigned short)clipX;
+                fields.ClipRectY = (unsigned short)clipY;
+                fields.ClipRectX1 = (unsigned short)clipX1;
+                fields.ClipRectY1 = (unsigned short)clipY1;
+                fields.ShaderType = 1;
+                fields.InputColor = fontColor;
+                fields.TextParams.TextWidth = entry->Width;
+                fields.TextParams.TextHeight = entry->Height;
+                fields.TextParams.StartPointer = entry->Address;
+                uniformFields.Add(fields);
+                primCounter++;
+            }
+        }
         void DrawTextQuad(BakedText * text, const GraphicsUI::Color & fontColor, float x, float y, float x1, float y1)
         {
             static int64_t useStamp = 0;
             useStamp++;
             if (IsBufferFull())
                 return;
+            text->lastUse = useStamp;
+            if (text->UsesGlyphAtlas)
+            {
+                DrawGlyphQuads(text, fontColor, x, y, x1, y1);
+                return;
+            }
             if (!text->textBuffer && text->Height > 0)
             {
                 do
@@ -519,7 +594,6 @@ namespace GameEngine
                     }
                 } while (!text->textBuffer && text->Height > 0 && text->Width > 0);
             }
-            text->lastUse = useStamp;
             indexStream.Add(vertexStream.Count());
             indexStream.Add(vertexStream.Count() + 1);
             indexStream.Add(vertexStream.Count() + 2);
@@ -639,11 +713,13 @@ namespace GameEngine
         textBufferObj = ctx->CreateMappedBuffer(BufferUsage::StorageBuffer, TextBufferSize, &textBufferStructInfo);
         textBuffer = (unsigned char*)textBufferObj->Map();
         textBufferPool.Init(textBuffer, Log2TextBufferBlockSize, TextBufferSize >> Log2TextBufferBlockSize);
+        glyphAtlas.Init(textBuffer, &textBufferPool, TextBufferSize / 2, DynamicBufferLengthMultiplier);
         uiRenderer = new GLUIRenderer(this, ctx);
     }
 
     UISystemBase::~UISystemBase()
     {
+        glyphAtlas.Clear();
         textBufferObj->Unmap();
         fonts = decltype(fonts)();
         delete uiRenderer;
@@ -655,6 +731,11 @@ namespace GameEngine
             textBufferFence->Wait();
     }
 
+    void UISystemBase::BeginFrame()
+    {
+        glyphAtlas.AdvanceFrame();
+    }
+
     unsigned char * UISystemBase::AllocTextBuffer(int size)
     {
         return textBufferPool.Alloc(size);
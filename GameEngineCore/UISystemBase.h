@@ -10,17 +10,13 @@
 #include "EngineLimits.h"
 #include "CoreLib/LibMath.h"
 #include "OS.h"
+#include "GlyphAtlas.h"
 
 namespace GameEngine
 {
     class GLUIRenderer;
     class UISystemBase;
 
-    const int TextBufferSize = 6 * 1024 * 1024;
-    const int TextPixelBits = 4;
-    const int Log2TextPixelsPerByte = CoreLib::Math::Log2Floor(8 / TextPixelBits);
-    const int Log2TextBufferBlockSize = 6;
-
     class SystemFont : public GraphicsUI::IFont
     {
     public:
@@ -28,6 +24,7 @@ namespace GameEngine
         UISystemBase* system;
         SystemWindow* window = nullptr;
         Font fontDesc;
+        int glyphAtlasFontId = 0;
     public:
         SystemFont(UISystemBase* ctx, SystemWindow* associatedWindow, const Font& font)
         {
@@ -37,10 +34,7 @@ namespace GameEngine
             rasterizer = OsApplication::CreateFontRasterizer();
             UpdateFontContext(associatedWindow->GetCurrentDpi());
         }
-        void UpdateFontContext(int dpi)
-        {
-            rasterizer->SetFont(fontDesc, dpi);
-        }
+        void UpdateFontContext(int dpi);
         SystemWindow* GetAssociatedWindow()
         {
             return window;
@@ -61,6 +55,9 @@ namespace GameEngine
         int BufferSize = 0;
         GraphicsUI::DrawTextOptions options;
         int Width = 0, Height = 0;
+        // Texts laid out by the rasterizer are drawn glyph by glyph from the glyph atlas and own no text buffer.
+        bool UsesGlyphAtlas = false;
+        CoreLib::List<GlyphPlacement> Glyphs;
     public:
         void Rebake();
         virtual int GetWidth() override
@@ -107,6 +104,7 @@ namespace GameEngine
         CoreLib::EnumerableDictionary<CoreLib::String, CoreLib::RefPtr<SystemFont>> fonts;
         CoreLib::RefPtr<Buffer> textBufferObj;
         CoreLib::MemoryPool textBufferPool;
+        GlyphAtlas glyphAtlas;
         VectorMath::Vec4 ColorToVec(GraphicsUI::Color c);
         Fence* textBufferFence = nullptr;
     public:
@@ -118,6 +116,12 @@ namespace GameEngine
         UISystemBase(HardwareRenderer * ctx);
         ~UISystemBase();
         void WaitForDrawFence();
+        // Called at the start of a frame once the frame that used the same dynamic buffers has completed.
+        void BeginFrame();
+        GlyphAtlas & GetGlyphAtlas()
+        {
+            return glyphAtlas;
+        }
         unsigned char * AllocTextBuffer(int size);
         void FreeTextBuffer(unsigned char * buffer, int size)
         {
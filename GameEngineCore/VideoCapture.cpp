@@ -0,0 +1,145 @@
+#include "VideoCapture.h"
+#include "Engine.h"
+
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+
+namespace GameEngine
+{
+	VideoCapturePipeline::VideoCapturePipeline(HardwareRenderer * hwRenderer, IVideoEncoder * videoEncoder,
+		int readbackBufferCount, int queueLength, CaptureOverflowPolicy policy)
+	{
+		hardwareRenderer = hwRenderer;
+		encoder = videoEncoder;
+		overflowPolicy = policy;
+		slots.SetSize(Math::Max(1, readbackBufferCount));
+		for (auto & slot : slots)
+			slot.ReadyFence = hardwareRenderer->CreateFence();
+		// one more frame than the queue holds, for the frame being encoded
+		frames.SetSize(Math::Max(1, queueLength) + 1);
+		for (int i = 0; i < frames.Count(); i++)
+			freeFrames.Add(i);
+		running = true;
+		worker = new Thread(new ThreadProc([this]() { WorkerProc(); }));
+	}
+
+	VideoCapturePipeline::~VideoCapturePipeline()
+	{
+		Close();
+	}
+
+	void VideoCapturePipeline::WorkerProc()
+	{
+		while (true)
+		{
+			int frameId;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return !running || queuedFrames.Count() != 0; });
+				// the queue is drained before the thread exits
+				if (queuedFrames.Count() == 0)
+					return;
+				frameId = queuedFrames.First();
+				queuedFrames.RemoveAt(0);
+			}
+			auto & frame = frames[frameId];
+			encoder->EncodeFrame(frame.Width, frame.Height, frame.Pixels.Buffer());
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				freeFrames.Add(frameId);
+			}
+			queueCondition.notify_all();
+		}
+	}
+
+	int VideoCapturePipeline::AcquireFrame()
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		if (freeFrames.Count() == 0)
+		{
+			if (overflowPolicy == CaptureOverflowPolicy::DropFrame)
+				return -1;
+			stalledFrameCount++;
+			queueCondition.wait(lock, [this]() { return freeFrames.Count() != 0; });
+		}
+		int frameId = freeFrames.Last();
+		freeFrames.RemoveAt(freeFrames.Count() - 1);
+		return frameId;
+	}
+
+	void VideoCapturePipeline::RetireSlot(ReadbackSlot & slot)
+	{
+		slot.ReadyFence->Wait();
+		slot.Pending = false;
+		int frameId = AcquireFrame();
+		if (frameId == -1)
+		{
+			droppedFrameCount++;
+			return;
+		}
+		auto & frame = frames[frameId];
+		frame.Width = slot.Width;
+		frame.Height = slot.Height;
+		int rowSize = slot.Width * 4;
+		frame.Pixels.SetSize(rowSize * slot.Height);
+		auto src = (unsigned char*)slot.StagingBuffer->Map();
+		if (slot.RowPitch == rowSize)
+			memcpy(frame.Pixels.Buffer(), src, frame.Pixels.Count());
+		else
+		{
+			for (int i = 0; i < slot.Height; i++)
+				memcpy(frame.Pixels.Buffer() + i * rowSize, src + i * slot.RowPitch, rowSize);
+		}
+		slot.StagingBuffer->Unmap();
+		capturedFrameCount++;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			queuedFrames.Add(frameId);
+		}
+		queueCondition.notify_all();
+	}
+
+	void VideoCapturePipeline::CaptureFrame(Texture2D * image)
+	{
+		auto & slot = slots[nextSlot];
+		if (slot.Pending)
+			RetireSlot(slot);
+		int w, h;
+		image->GetSize(w, h);
+		if (!slot.StagingBuffer || slot.Width != w || slot.Height != h)
+		{
+			slot.StagingBuffer = hardwareRenderer->CreateReadbackBuffer(w, h, StorageFormat::RGBA_8, slot.RowPitch);
+			slot.Width = w;
+			slot.Height = h;
+		}
+		slot.ReadyFence->Reset();
+		hardwareRenderer->BeginJobSubmission();
+		hardwareRenderer->QueueTextureReadback(slot.StagingBuffer.Ptr(), image);
+		hardwareRenderer->EndJobSubmission(slot.ReadyFence.Ptr());
+		slot.Pending = true;
+		nextSlot = (nextSlot + 1) % slots.Count();
+	}
+
+	void VideoCapturePipeline::Close()
+	{
+		if (!worker)
+			return;
+		// retire the remaining readbacks oldest first
+		for (int i = 0; i < slots.Count(); i++)
+		{
+			auto & slot = slots[(nextSlot + i) % slots.Count()];
+			if (slot.Pending)
+				RetireSlot(slot);
+		}
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			running = false;
+		}
+		queueCondition.notify_all();
+		worker->Join();
+		worker = nullptr;
+		if (droppedFrameCount || stalledFrameCount)
+			Print("video capture: %d frames encoded, %d dropped, %d stalled on the encoder.\n",
+				capturedFrameCount, droppedFrameCount, stalledFrameCount);
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef GAME_ENGINE_VIDEO_CAPTURE_H
+#define GAME_ENGINE_VIDEO_CAPTURE_H
+
+#include "CoreLib/Basic.h"
+#include "CoreLib/Threading.h"
+#include "HardwareRenderer.h"
+#include "VideoEncoder.h"
+#include <condition_variable>
+
+namespace GameEngine
+{
+	// What CaptureFrame() does when the encoder thread falls behind and the frame queue is full.
+	enum class CaptureOverflowPolicy
+	{
+		Stall,     // wait for the encoder, every rendered frame ends up in the video
+		DropFrame  // discard the frame, rendering never waits for the encoder
+	};
+
+	// Feeds rendered frames to a video encoder without stalling the GPU or the main thread on every frame.
+	// Each captured image is copied into one of a ring of readback buffers together with the frame's job
+	// submission. A readback buffer is only mapped when its slot comes around again, by which time its
+	// fence has usually been signaled. The pixels are then handed to an encoder thread through a bounded
+	// queue, so that color conversion and encoding overlap with rendering of the following frames.
+	// The encoder is only accessed from the encoder thread until Close() returns.
+	class VideoCapturePipeline
+	{
+	private:
+		struct ReadbackSlot
+		{
+			CoreLib::RefPtr<Buffer> StagingBuffer;
+			CoreLib::RefPtr<Fence> ReadyFence;
+			int Width = 0, Height = 0, RowPitch = 0;
+			bool Pending = false;
+		};
+		struct CapturedFrame
+		{
+			CoreLib::List<unsigned char> Pixels;
+			int Width = 0, Height = 0;
+		};
+		HardwareRenderer * hardwareRenderer;
+		IVideoEncoder * encoder;
+		CaptureOverflowPolicy overflowPolicy;
+		CoreLib::List<ReadbackSlot> slots;
+		int nextSlot = 0;
+		// frames are recycled, a frame index is either in freeFrames, in queuedFrames or held by one of the threads
+		CoreLib::List<CapturedFrame> frames;
+		CoreLib::List<int> freeFrames, queuedFrames;
+		CoreLib::RefPtr<CoreLib::Threading::Thread> worker;
+		std::mutex queueMutex;
+		std::condition_variable queueCondition;
+		bool running = false;
+		int capturedFrameCount = 0, droppedFrameCount = 0, stalledFrameCount = 0;
+		void WorkerProc();
+		int AcquireFrame();
+		void RetireSlot(ReadbackSlot & slot);
+	public:
+		// readbackBufferCount is the number of frames that can be in flight between CaptureFrame() and the
+		// readback, queueLength the number of read back frames that can wait for the encoder thread.
+		VideoCapturePipeline(HardwareRenderer * hwRenderer, IVideoEncoder * videoEncoder, int readbackBufferCount,
+			int queueLength, CaptureOverflowPolicy policy);
+		~VideoCapturePipeline();
+		// Queues a readback of `image` (an RGBA_8 texture) and passes it to the encoder once it is complete.
+		// Must be called on the thread that submits rendering work, after the work that renders `image`.
+		void CaptureFrame(Texture2D * image);
+		// Reads back and encodes all pending frames, then stops the encoder thread.
+		void Close();
+		int GetDroppedFrameCount()
+		{
+			return droppedFrameCount;
+		}
+	};
+}
+
+#endif
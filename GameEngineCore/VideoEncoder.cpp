@@ -454,40 +454,21 @@ private:
     List<uint32_t> frameSizes;
     int fps = 30;
     moovBox moov;
+    YuvConversionOptions conversionOptions;
 
 public:
-    struct Color
-    {
-        unsigned char r, g, b, a;
-    };
     void RGB2YUV(int w, int h, unsigned char *rgbaImage)
     {
         yuv.SetSize(width * height * 3 / 2);
-        auto yPlane = yuv.begin();
-        auto uPlane = yPlane + width * height;
-        auto vPlane = uPlane + width * height / 4;
-        auto hWidth = width >> 1;
-        for (int i = 0; i < height; i++)
-        {
-            for (int j = 0; j < width; j++)
-            {
-                Color color;
-                if (i < h && j < w)
-                    color = ((Color *)rgbaImage)[i * width + j];
-                else
-                    color = Color{0, 0, 0, 0};
-                int lum = 19595 * color.r + 38470 * color.g + 7471 * color.b;
-                auto y = (unsigned char)Math::Clamp(((lum) >> 16), 0, 255);
-                auto Cb = (unsigned char)Math::Clamp(((36962 * (color.b - y)) >> 16) + 128, 0, 255);
-                auto Cr = (unsigned char)Math::Clamp(((46727 * (color.r - y)) >> 16) + 128, 0, 255);
-                yPlane[i * width + j] = y;
-                if ((i & 1) == 0 && (j & 1) == 0)
-                {
-                    uPlane[(i >> 1) * hWidth + (j >> 1)] = Cb;
-                    vPlane[(i >> 1) * hWidth + (j >> 1)] = Cr;
-                }
-            }
-        }
+        I420Image picture;
+        picture.Width = width;
+        picture.Height = height;
+        picture.YStride = width;
+        picture.UVStride = width >> 1;
+        picture.Y = yuv.Buffer();
+        picture.U = picture.Y + width * height;
+        picture.V = picture.U + width * height / 4;
+        ConvertRGBAToI420(rgbaImage, w, h, w * 4, picture, conversionOptions);
     }
 
     List<int> leadingWordPos;
@@ -552,6 +533,9 @@ public:
         height = options.Height;
         stream = outputStream;
         fps = options.FramesPerSecond;
+        conversionOptions.Matrix = options.ColorMatrix;
+        conversionOptions.Range = options.ColorRange;
+        conversionOptions.FlipVertical = options.FlipVertical;
         WelsCreateSVCEncoder(&encoder);
         SEncParamExt params;
         encoder->GetDefaultParams(&params);
@@ -575,6 +559,13 @@ public:
             params.sSpatialLayers[i].uiProfileIdc = PRO_HIGH;
             params.sSpatialLayers[i].uiLevelIdc = LEVEL_5_2;
             params.sSpatialLayers[i].uiVideoFormat = 2;
+            params.sSpatialLayers[i].bVideoSignalTypePresent = true;
+            params.sSpatialLayers[i].bFullRange = options.ColorRange == YuvColorRange::Full;
+            params.sSpatialLayers[i].bColorDescriptionPresent = true;
+            bool bt709 = options.ColorMatrix == YuvColorMatrix::BT709;
+            params.sSpatialLayers[i].uiColorPrimaries = (unsigned char)(bt709 ? CP_BT709 : CP_SMPTE170M);
+            params.sSpatialLayers[i].uiTransferCharacteristics = (unsigned char)(bt709 ? TRC_BT709 : TRC_SMPTE170M);
+            params.sSpatialLayers[i].uiColorMatrix = (unsigned char)(bt709 ? CM_BT709 : CM_SMPTE170M);
             params.sSpatialLayers[i].iDLayerQp = 0;
             params.sSpatialLayers[i].iMaxSpatialBitrate = UNSPECIFIED_BIT_RATE;
             params.sSpatialLayers[i].sSliceArgument.uiSliceMode = SM_FIXEDSLCNUM_SLICE;
@@ -2,6 +2,7 @@
 #define GAME_ENGINE_VIDEO_ENCODER_H
 
 #include "CoreLib/LibIO.h"
+#include "YuvConversion.h"
 
 namespace GameEngine
 {
@@ -11,6 +12,11 @@ namespace GameEngine
         int Width = 1920, Height = 1080;
         int Bitrate = 20*1024*1024;
         int FramesPerSecond = 30;
+        // color space of the encoded video, also written to the stream header
+        YuvColorMatrix ColorMatrix = YuvColorMatrix::BT709;
+        YuvColorRange ColorRange = YuvColorRange::Limited;
+        // frames passed to EncodeFrame are stored bottom-up
+        bool FlipVertical = false;
         VideoEncodingOptions() = default;
         VideoEncodingOptions(int w, int h)
         {
@@ -32,6 +32,8 @@ namespace VK
 	const int TargetVulkanVersion_Minor = 0;
     const int MaxRenderThreads = 4;
     int MaxThreadCount = MaxRenderThreads;
+    // upper bound of job system threads that record secondary command buffers
+    const int MaxRecordingThreads = 64;
 	unsigned int GpuId = 0;
 
     thread_local int renderThreadId = -1;
@@ -179,6 +181,9 @@ namespace VK
 		vk::DescriptorSet emptyDescriptorSet;
 		vk::CommandPool swapchainCommandPool;
 		CoreLib::Array<vk::CommandPool, MaxRenderThreads> renderCommandPools;
+		// pools of secondary command buffers recorded by job system threads, created on first use
+		vk::CommandPool threadCommandPools[MaxRecordingThreads] = {};
+		std::mutex threadCommandPoolMutex;
         CoreLib::Array<CoreLib::RefPtr<CoreLib::List<CoreLib::List<vk::CommandBuffer>>>, MaxRenderThreads> renderCommandBufferPools;
         int currentBufferVersions[MaxRenderThreads] = {};
         int renderCommandBufferAllocPtrs[MaxRenderThreads] = {};
@@ -499,6 +504,12 @@ namespace VK
 		{
             for (int i = 0; i < MaxThreadCount; i++)
 			    State().device.destroyCommandPool(State().renderCommandPools[i]);
+            for (auto & pool : State().threadCommandPools)
+            {
+                if (pool)
+                    State().device.destroyCommandPool(pool);
+                pool = vk::CommandPool();
+            }
 			State().device.destroyCommandPool(State().swapchainCommandPool);
 
             for (auto & pool : State().renderCommandBufferPools)
@@ -616,6 +627,22 @@ namespace VK
 			return State().renderCommandPools[renderThreadId];
 		}
 
+		// a command pool may only be used by one thread at a time, so each recording thread gets its own
+		static const vk::CommandPool& ThreadCommandPool(int threadIndex)
+		{
+			CORELIB_ASSERT(threadIndex < MaxRecordingThreads);
+			std::lock_guard<std::mutex> lock(State().threadCommandPoolMutex);
+			auto & pool = State().threadCommandPools[threadIndex];
+			if (!pool)
+			{
+				vk::CommandPoolCreateInfo poolCreateInfo = vk::CommandPoolCreateInfo()
+					.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+					.setQueueFamilyIndex(State().renderQueueIndex);
+				pool = State().device.createCommandPool(poolCreateInfo);
+			}
+			return pool;
+		}
+
 		static vk::CommandBuffer GetTempTransferCommandBuffer()
 		{
             return GetTempRenderCommandBuffer();
@@ -1439,7 +1466,8 @@ namespace VK
 			
 			// Set up staging buffer and copy data to new image
 			int bufferSize = pwidth * pheight * pdepth * layerCount * dataTypeSize;
-			if (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB|| format == StorageFormat::BC5 || format == StorageFormat::BC3 || format == StorageFormat::BC6H)
+			if (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB|| format == StorageFormat::BC5 || format == StorageFormat::BC3 || format == StorageFormat::BC6H ||
+				format == StorageFormat::RGBA_Compressed)
 			{
 				int blocks = (int)(ceil(pwidth / 4.0f) * ceil(pheight / 4.0f));
 				bufferSize = (format == StorageFormat::BC1||format == StorageFormat::BC1_SRGB) ? blocks * 8 : blocks * 16;
@@ -1595,7 +1623,8 @@ namespace VK
 			CORELIB_UNUSED(bufSize);
 			// Set up staging buffer and copy data to new image
 			int bufferSize = 0;
-			if (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB || format == StorageFormat::BC5 || format == StorageFormat::BC3)
+			if (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB || format == StorageFormat::BC5 || format == StorageFormat::BC3 ||
+				format == StorageFormat::BC6H || format == StorageFormat::RGBA_Compressed)
 			{
 				int blocks = (int)(ceil(width / 4.0f) * ceil(height / 4.0f));
 				bufferSize = (format == StorageFormat::BC1 || format == StorageFormat::BC1_SRGB) ? blocks * 8 : blocks * 16;
@@ -4620,6 +4649,64 @@ namespace VK
 
 			srcTexture->currentSubresourceLayouts[0] = vk::ImageLayout::eTransferSrcOptimal;
 		}
+		virtual void QueueTextureReadback(GameEngine::Buffer* dstBuffer, GameEngine::Texture2D* srcImage) override
+		{
+			auto primaryBuffer = jobSubmissionBuffers[renderThreadId];
+			auto srcTexture = dynamic_cast<VK::Texture2D*>(srcImage);
+			auto dst = dynamic_cast<BufferObject*>(dstBuffer);
+
+			vk::ImageSubresourceRange imageSubresourceRange = vk::ImageSubresourceRange()
+				.setAspectMask(vk::ImageAspectFlagBits::eColor)
+				.setBaseMipLevel(0)
+				.setLevelCount(1)
+				.setBaseArrayLayer(0)
+				.setLayerCount(1);
+
+			vk::ImageMemoryBarrier preCopyBarrier = vk::ImageMemoryBarrier()
+				.setSrcAccessMask(LayoutFlags(srcTexture->currentSubresourceLayouts[0]))
+				.setDstAccessMask(LayoutFlags(vk::ImageLayout::eTransferSrcOptimal))
+				.setOldLayout(srcTexture->currentSubresourceLayouts[0])
+				.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(srcTexture->image)
+				.setSubresourceRange(imageSubresourceRange);
+
+			primaryBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eAllCommands,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::DependencyFlags(),
+				0, nullptr,
+				0, nullptr,
+				1, &preCopyBarrier);
+			srcTexture->currentSubresourceLayouts[0] = vk::ImageLayout::eTransferSrcOptimal;
+
+			vk::BufferImageCopy copyRegion = vk::BufferImageCopy()
+				.setBufferOffset(0)
+				.setBufferRowLength(0)
+				.setBufferImageHeight(0)
+				.setImageSubresource(vk::ImageSubresourceLayers().setAspectMask(vk::ImageAspectFlagBits::eColor).setMipLevel(0).setBaseArrayLayer(0).setLayerCount(1))
+				.setImageOffset(vk::Offset3D())
+				.setImageExtent(vk::Extent3D(srcTexture->width, srcTexture->height, 1));
+			primaryBuffer.copyImageToBuffer(srcTexture->image, vk::ImageLayout::eTransferSrcOptimal, dst->buffer, copyRegion);
+
+			// make the copied data visible to the host once the submission's fence is signaled
+			vk::BufferMemoryBarrier hostReadBarrier = vk::BufferMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eHostRead)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setBuffer(dst->buffer)
+				.setOffset(0)
+				.setSize(VK_WHOLE_SIZE);
+			primaryBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eHost,
+				vk::DependencyFlags(),
+				0, nullptr,
+				1, &hostReadBarrier,
+				0, nullptr);
+		}
 		virtual void Present(GameEngine::WindowSurface *surface, GameEngine::Texture2D* srcImage) override
 		{
           	((VkWindowSurface*)surface)->Present(srcImage);
@@ -4637,6 +4724,12 @@ namespace VK
 			return new BufferObject(TranslateUsageFlags(usage), size, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 		}
 
+		virtual BufferObject* CreateReadbackBuffer(int pwidth, int pheight, StorageFormat format, int & rowPitch) override
+		{
+			rowPitch = pwidth * StorageFormatSize(format);
+			return new BufferObject(vk::BufferUsageFlagBits::eTransferDst, rowPitch * pheight, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+		}
+
 		Texture2D* CreateTexture2D(CoreLib::String name, int pwidth, int pheight, StorageFormat format, DataType dataType, void* data) override
 		{
 			TextureUsage usage;
@@ -4728,6 +4821,11 @@ namespace VK
 			return new CommandBuffer();
 		}
 
+		CommandBuffer* CreateThreadCommandBuffer(int threadIndex) override
+		{
+			return new CommandBuffer(RendererState::ThreadCommandPool(threadIndex));
+		}
+
 		virtual int UniformBufferAlignment() override
 		{
 			return (int)RendererState::PhysicalDevice().getProperties().limits.minUniformBufferOffsetAlignment;
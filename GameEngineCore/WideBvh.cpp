@@ -0,0 +1,418 @@
+#include "WideBvh.h"
+#include <smmintrin.h>
+
+using namespace CoreLib;
+
+namespace GameEngine
+{
+    namespace
+    {
+        // entries kept inline by a traversal, each level pushes at most 3 siblings
+        const int TraversalStackSize = 1024;
+        // widens the far distance of box tests by a few ulps so that rounding never culls a box the ray touches
+        const float BoxFarScale = 1.0f + 4.0f * FLT_EPSILON;
+        const float MinHitDistance = 1e-5f;
+
+        struct StackEntry
+        {
+            int Child;
+            int Count;
+            float TNear;
+        };
+
+        // keeps TraversalStackSize entries inline and spills the rest to the heap, so that degenerate
+        // trees deeper than the inline capacity are still traversed completely
+        struct TraversalStack
+        {
+            StackEntry entries[TraversalStackSize];
+            int size = 0;
+            List<StackEntry> overflow;
+            inline void Push(const StackEntry & entry)
+            {
+                if (size < TraversalStackSize)
+                    entries[size++] = entry;
+                else
+                    overflow.Add(entry);
+            }
+            // entries in `overflow` were pushed after all inline entries, so they are popped first
+            inline StackEntry Pop()
+            {
+                if (overflow.Count())
+                {
+                    StackEntry entry = overflow.Last();
+                    overflow.RemoveAt(overflow.Count() - 1);
+                    return entry;
+                }
+                return entries[--size];
+            }
+            inline bool IsEmpty() const
+            {
+                return size == 0 && overflow.Count() == 0;
+            }
+        };
+
+        inline float SafeRcp(float x)
+        {
+            // keep the reciprocal finite so that box tests never evaluate 0 * inf
+            if (x < 1e-20f && x > -1e-20f)
+                x = x < 0.0f ? -1e-20f : 1e-20f;
+            return 1.0f / x;
+        }
+
+        // ray/box slab test, `near` and `far` are the box planes already selected by the sign of the direction
+        inline int IntersectBox4(__m128 nearX, __m128 nearY, __m128 nearZ, __m128 farX, __m128 farY, __m128 farZ,
+            __m128 ox, __m128 oy, __m128 oz, __m128 rx, __m128 ry, __m128 rz, __m128 tMax, __m128 & tNear)
+        {
+            __m128 tn = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(nearX, ox), rx), _mm_mul_ps(_mm_sub_ps(nearY, oy), ry));
+            tn = _mm_max_ps(tn, _mm_max_ps(_mm_mul_ps(_mm_sub_ps(nearZ, oz), rz), _mm_setzero_ps()));
+            __m128 tf = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(farX, ox), rx), _mm_mul_ps(_mm_sub_ps(farY, oy), ry));
+            tf = _mm_min_ps(tf, _mm_mul_ps(_mm_sub_ps(farZ, oz), rz));
+            tf = _mm_min_ps(_mm_mul_ps(tf, _mm_set1_ps(BoxFarScale)), tMax);
+            tNear = tn;
+            return _mm_movemask_ps(_mm_cmple_ps(tn, tf));
+        }
+
+        // Moller-Trumbore test evaluated in four lanes, with the same operation order and acceptance rules as
+        // the scalar tracer: 0 <= u, 0 <= v, u + v <= 1 and MinHitDistance <= t <= tMax.
+        // Degenerate lanes produce NaNs and fail every comparison.
+        inline int IntersectTriangle4(__m128 ox, __m128 oy, __m128 oz, __m128 dx, __m128 dy, __m128 dz,
+            __m128 v0x, __m128 v0y, __m128 v0z, __m128 e1x, __m128 e1y, __m128 e1z, __m128 e2x, __m128 e2y, __m128 e2z,
+            __m128 tMax, __m128 & tOut, __m128 & uOut, __m128 & vOut)
+        {
+            __m128 s1x = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+            __m128 s1y = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+            __m128 s1z = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+            __m128 di = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s1x, e1x), _mm_mul_ps(s1y, e1y)), _mm_mul_ps(s1z, e1z));
+            __m128 invd = _mm_div_ps(_mm_set1_ps(1.0f), di);
+            __m128 px = _mm_sub_ps(ox, v0x);
+            __m128 py = _mm_sub_ps(oy, v0y);
+            __m128 pz = _mm_sub_ps(oz, v0z);
+            __m128 b1 = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, s1x), _mm_mul_ps(py, s1y)), _mm_mul_ps(pz, s1z)), invd);
+            __m128 s2x = _mm_sub_ps(_mm_mul_ps(py, e1z), _mm_mul_ps(pz, e1y));
+            __m128 s2y = _mm_sub_ps(_mm_mul_ps(pz, e1x), _mm_mul_ps(px, e1z));
+            __m128 s2z = _mm_sub_ps(_mm_mul_ps(px, e1y), _mm_mul_ps(py, e1x));
+            __m128 b2 = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, s2x), _mm_mul_ps(dy, s2y)), _mm_mul_ps(dz, s2z)), invd);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, s2x), _mm_mul_ps(e2y, s2y)), _mm_mul_ps(e2z, s2z)), invd);
+            __m128 zero = _mm_setzero_ps();
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 mask = _mm_and_ps(_mm_cmpge_ps(b1, zero), _mm_cmple_ps(b1, one));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(b2, zero));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(b1, b2), one));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(t, _mm_set1_ps(MinHitDistance)));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(t, tMax));
+            tOut = t;
+            uOut = b1;
+            vOut = b2;
+            return _mm_movemask_ps(mask);
+        }
+
+        // a single ray broadcast to all lanes, tested against four boxes or triangles at once
+        struct SingleRay
+        {
+            __m128 ox, oy, oz, dx, dy, dz, rx, ry, rz;
+            int negX, negY, negZ;
+            SingleRay(const Ray & ray)
+            {
+                ox = _mm_set1_ps(ray.Origin.x); oy = _mm_set1_ps(ray.Origin.y); oz = _mm_set1_ps(ray.Origin.z);
+                dx = _mm_set1_ps(ray.Dir.x); dy = _mm_set1_ps(ray.Dir.y); dz = _mm_set1_ps(ray.Dir.z);
+                float rcpX = SafeRcp(ray.Dir.x), rcpY = SafeRcp(ray.Dir.y), rcpZ = SafeRcp(ray.Dir.z);
+                rx = _mm_set1_ps(rcpX); ry = _mm_set1_ps(rcpY); rz = _mm_set1_ps(rcpZ);
+                negX = rcpX < 0.0f; negY = rcpY < 0.0f; negZ = rcpZ < 0.0f;
+            }
+            inline int IntersectBoxes(const Bvh4Node & node, float tMax, __m128 & tNear) const
+            {
+                return IntersectBox4(_mm_loadu_ps(negX ? node.MaxX : node.MinX), _mm_loadu_ps(negY ? node.MaxY : node.MinY),
+                    _mm_loadu_ps(negZ ? node.MaxZ : node.MinZ), _mm_loadu_ps(negX ? node.MinX : node.MaxX),
+                    _mm_loadu_ps(negY ? node.MinY : node.MaxY), _mm_loadu_ps(negZ ? node.MinZ : node.MaxZ),
+                    ox, oy, oz, rx, ry, rz, _mm_set1_ps(tMax), tNear);
+            }
+            inline int IntersectTriangles(const TriangleBlock4 & block, float tMax, __m128 & t, __m128 & u, __m128 & v) const
+            {
+                return IntersectTriangle4(ox, oy, oz, dx, dy, dz,
+                    _mm_loadu_ps(block.V0X), _mm_loadu_ps(block.V0Y), _mm_loadu_ps(block.V0Z),
+                    _mm_loadu_ps(block.E1X), _mm_loadu_ps(block.E1Y), _mm_loadu_ps(block.E1Z),
+                    _mm_loadu_ps(block.E2X), _mm_loadu_ps(block.E2Y), _mm_loadu_ps(block.E2Z),
+                    _mm_set1_ps(tMax), t, u, v);
+            }
+        };
+
+        // four rays in SIMD lanes, tested against one box or triangle at a time
+        struct PacketRays
+        {
+            __m128 ox, oy, oz, dx, dy, dz, rx, ry, rz;
+            __m128 negX, negY, negZ;
+            int validMask;
+            PacketRays(const RayPacket4 & packet)
+            {
+                alignas(16) float rcp[3][4];
+                float o[3][4], d[3][4];
+                for (int i = 0; i < 4; i++)
+                {
+                    // unused lanes trace a dummy ray that is masked out by a negative tMax
+                    int src = i < packet.Count ? i : 0;
+                    o[0][i] = packet.OriginX[src]; o[1][i] = packet.OriginY[src]; o[2][i] = packet.OriginZ[src];
+                    d[0][i] = packet.DirX[src]; d[1][i] = packet.DirY[src]; d[2][i] = packet.DirZ[src];
+                    for (int k = 0; k < 3; k++)
+                        rcp[k][i] = SafeRcp(d[k][i]);
+                }
+                ox = _mm_loadu_ps(o[0]); oy = _mm_loadu_ps(o[1]); oz = _mm_loadu_ps(o[2]);
+                dx = _mm_loadu_ps(d[0]); dy = _mm_loadu_ps(d[1]); dz = _mm_loadu_ps(d[2]);
+                rx = _mm_load_ps(rcp[0]); ry = _mm_load_ps(rcp[1]); rz = _mm_load_ps(rcp[2]);
+                negX = _mm_cmplt_ps(rx, _mm_setzero_ps());
+                negY = _mm_cmplt_ps(ry, _mm_setzero_ps());
+                negZ = _mm_cmplt_ps(rz, _mm_setzero_ps());
+                validMask = (1 << packet.Count) - 1;
+            }
+            __m128 LoadTMax(const RayPacket4 & packet) const
+            {
+                float tMax[4];
+                for (int i = 0; i < 4; i++)
+                    tMax[i] = i < packet.Count ? packet.TMax[i] : -1.0f;
+                return _mm_loadu_ps(tMax);
+            }
+            inline int IntersectBox(const Bvh4Node & node, int i, __m128 tMax, __m128 & tNear) const
+            {
+                __m128 minX = _mm_set1_ps(node.MinX[i]), minY = _mm_set1_ps(node.MinY[i]), minZ = _mm_set1_ps(node.MinZ[i]);
+                __m128 maxX = _mm_set1_ps(node.MaxX[i]), maxY = _mm_set1_ps(node.MaxY[i]), maxZ = _mm_set1_ps(node.MaxZ[i]);
+                return IntersectBox4(_mm_blendv_ps(minX, maxX, negX), _mm_blendv_ps(minY, maxY, negY), _mm_blendv_ps(minZ, maxZ, negZ),
+                    _mm_blendv_ps(maxX, minX, negX), _mm_blendv_ps(maxY, minY, negY), _mm_blendv_ps(maxZ, minZ, negZ),
+                    ox, oy, oz, rx, ry, rz, tMax, tNear);
+            }
+            inline int IntersectTriangle(const TriangleBlock4 & block, int j, __m128 tMax, __m128 & t, __m128 & u, __m128 & v) const
+            {
+                return IntersectTriangle4(ox, oy, oz, dx, dy, dz,
+                    _mm_set1_ps(block.V0X[j]), _mm_set1_ps(block.V0Y[j]), _mm_set1_ps(block.V0Z[j]),
+                    _mm_set1_ps(block.E1X[j]), _mm_set1_ps(block.E1Y[j]), _mm_set1_ps(block.E1Z[j]),
+                    _mm_set1_ps(block.E2X[j]), _mm_set1_ps(block.E2Y[j]), _mm_set1_ps(block.E2Z[j]),
+                    tMax, t, u, v);
+            }
+        };
+
+        // pushes the children selected by `mask` so that the nearest one is popped first
+        inline void PushChildrenSorted(TraversalStack & stack, const Bvh4Node & node, int mask, const float * tNear)
+        {
+            int order[4];
+            int count = 0;
+            for (; mask; mask &= mask - 1)
+            {
+                int i = Math::Log2Floor(mask & (~mask + 1));
+                int pos = count++;
+                while (pos > 0 && tNear[order[pos - 1]] < tNear[i])
+                {
+                    order[pos] = order[pos - 1];
+                    pos--;
+                }
+                order[pos] = i;
+            }
+            for (int k = 0; k < count; k++)
+            {
+                int i = order[k];
+                stack.Push(StackEntry{ node.Child[i], node.Count[i], tNear[i] });
+            }
+        }
+    }
+
+    WideBvhHit TriangleBvh4::TraceRay(const Ray & ray) const
+    {
+        WideBvhHit hit;
+        if (nodes.Count() == 0)
+            return hit;
+        SingleRay r(ray);
+        TraversalStack stack;
+        stack.Push(StackEntry{ 0, 0, 0.0f });
+        float closest = ray.tMax;
+        while (!stack.IsEmpty())
+        {
+            auto entry = stack.Pop();
+            if (entry.TNear > closest)
+                continue;
+            if (entry.Count > 0)
+            {
+                for (int b = entry.Child; b < entry.Child + entry.Count; b++)
+                {
+                    auto & block = blocks[b];
+                    __m128 t, u, v;
+                    int mask = r.IntersectTriangles(block, closest, t, u, v);
+                    if (!mask)
+                        continue;
+                    alignas(16) float ts[4], us[4], vs[4];
+                    _mm_store_ps(ts, t);
+                    _mm_store_ps(us, u);
+                    _mm_store_ps(vs, v);
+                    for (; mask; mask &= mask - 1)
+                    {
+                        int j = Math::Log2Floor(mask & (~mask + 1));
+                        if (ts[j] <= closest)
+                        {
+                            closest = ts[j];
+                            hit.Id = block.Id[j];
+                            hit.T = ts[j];
+                            hit.U = us[j];
+                            hit.V = vs[j];
+                        }
+                    }
+                }
+                continue;
+            }
+            auto & node = nodes[entry.Child];
+            __m128 tNear;
+            int mask = r.IntersectBoxes(node, closest, tNear);
+            if (mask)
+            {
+                alignas(16) float tn[4];
+                _mm_store_ps(tn, tNear);
+                PushChildrenSorted(stack, node, mask, tn);
+            }
+        }
+        return hit;
+    }
+
+    bool TriangleBvh4::TraceOcclusion(const Ray & ray) const
+    {
+        if (nodes.Count() == 0)
+            return false;
+        SingleRay r(ray);
+        TraversalStack stack;
+        stack.Push(StackEntry{ 0, 0, 0.0f });
+        while (!stack.IsEmpty())
+        {
+            auto entry = stack.Pop();
+            int count = entry.Count;
+            int child = entry.Child;
+            if (count > 0)
+            {
+                // any hit terminates the query, the order of leaves does not matter
+                for (int b = child; b < child + count; b++)
+                {
+                    __m128 t, u, v;
+                    if (r.IntersectTriangles(blocks[b], ray.tMax, t, u, v))
+                        return true;
+                }
+                continue;
+            }
+            auto & node = nodes[child];
+            __m128 tNear;
+            for (int mask = r.IntersectBoxes(node, ray.tMax, tNear); mask; mask &= mask - 1)
+            {
+                int i = Math::Log2Floor(mask & (~mask + 1));
+                stack.Push(StackEntry{ node.Child[i], node.Count[i], 0.0f });
+            }
+        }
+        return false;
+    }
+
+    void TriangleBvh4::TraceRays(const RayPacket4 & packet, WideBvhHit * hits) const
+    {
+        for (int i = 0; i < packet.Count; i++)
+            hits[i] = WideBvhHit();
+        if (nodes.Count() == 0 || packet.Count == 0)
+            return;
+        PacketRays r(packet);
+        __m128 closest = r.LoadTMax(packet);
+        TraversalStack stack;
+        stack.Push(StackEntry{ 0, 0, 0.0f });
+        while (!stack.IsEmpty())
+        {
+            auto entry = stack.Pop();
+            if (entry.Count > 0)
+            {
+                for (int b = entry.Child; b < entry.Child + entry.Count; b++)
+                {
+                    auto & block = blocks[b];
+                    for (int j = 0; j < 4 && block.Id[j] != -1; j++)
+                    {
+                        __m128 t, u, v;
+                        int mask = r.IntersectTriangle(block, j, closest, t, u, v);
+                        if (!mask)
+                            continue;
+                        closest = _mm_blendv_ps(closest, t, _mm_castsi128_ps(_mm_setr_epi32(
+                            -(mask & 1), -((mask >> 1) & 1), -((mask >> 2) & 1), -((mask >> 3) & 1))));
+                        alignas(16) float ts[4], us[4], vs[4];
+                        _mm_store_ps(ts, t);
+                        _mm_store_ps(us, u);
+                        _mm_store_ps(vs, v);
+                        for (; mask; mask &= mask - 1)
+                        {
+                            int k = Math::Log2Floor(mask & (~mask + 1));
+                            hits[k].Id = block.Id[j];
+                            hits[k].T = ts[k];
+                            hits[k].U = us[k];
+                            hits[k].V = vs[k];
+                        }
+                    }
+                }
+                continue;
+            }
+            // a child is visited if any ray of the packet hits its box, nearer children are visited first
+            auto & node = nodes[entry.Child];
+            int childMask = 0;
+            float tn[4];
+            for (int i = 0; i < 4; i++)
+            {
+                if (node.Count[i] < 0)
+                    continue;
+                __m128 tNear;
+                int rayMask = r.IntersectBox(node, i, closest, tNear);
+                if (rayMask)
+                {
+                    alignas(16) float t[4];
+                    _mm_store_ps(t, tNear);
+                    tn[i] = FLT_MAX;
+                    for (; rayMask; rayMask &= rayMask - 1)
+                        tn[i] = Math::Min(tn[i], t[Math::Log2Floor(rayMask & (~rayMask + 1))]);
+                    childMask |= 1 << i;
+                }
+            }
+            if (childMask)
+                PushChildrenSorted(stack, node, childMask, tn);
+        }
+    }
+
+    int TriangleBvh4::TraceOcclusion(const RayPacket4 & packet) const
+    {
+        if (nodes.Count() == 0 || packet.Count == 0)
+            return 0;
+        PacketRays r(packet);
+        // occluded rays get a negative tMax so that they stop taking part in box and triangle tests
+        __m128 tMax = r.LoadTMax(packet);
+        int occluded = 0;
+        TraversalStack stack;
+        stack.Push(StackEntry{ 0, 0, 0.0f });
+        while (!stack.IsEmpty())
+        {
+            auto entry = stack.Pop();
+            int count = entry.Count;
+            int child = entry.Child;
+            if (count > 0)
+            {
+                for (int b = child; b < child + count; b++)
+                {
+                    auto & block = blocks[b];
+                    for (int j = 0; j < 4 && block.Id[j] != -1; j++)
+                    {
+                        __m128 t, u, v;
+                        int mask = r.IntersectTriangle(block, j, tMax, t, u, v);
+                        if (!mask)
+                            continue;
+                        occluded |= mask;
+                        if (occluded == r.validMask)
+                            return occluded;
+                        tMax = _mm_blendv_ps(tMax, _mm_set1_ps(-1.0f), _mm_castsi128_ps(_mm_setr_epi32(
+                            -(mask & 1), -((mask >> 1) & 1), -((mask >> 2) & 1), -((mask >> 3) & 1))));
+                    }
+                }
+                continue;
+            }
+            auto & node = nodes[child];
+            for (int i = 0; i < 4; i++)
+            {
+                __m128 tNear;
+                if (node.Count[i] >= 0 && r.IntersectBox(node, i, tMax, tNear))
+                {
+                    stack.Push(StackEntry{ node.Child[i], node.Count[i], 0.0f });
+                }
+            }
+        }
+        return occluded;
+    }
+}
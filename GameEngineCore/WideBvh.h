@@ -0,0 +1,199 @@
+#ifndef GAME_ENGINE_WIDE_BVH_H
+#define GAME_ENGINE_WIDE_BVH_H
+
+#include "Bvh.h"
+
+namespace GameEngine
+{
+    // Four child boxes stored as structure of arrays so that a ray can be tested against all of them
+    // with one SSE instruction per slab. Count[i] is 0 for inner children (Child[i] is a node index),
+    // the number of triangle blocks for leaves (Child[i] is the first block) and -1 for unused slots.
+    struct Bvh4Node
+    {
+        float MinX[4], MinY[4], MinZ[4];
+        float MaxX[4], MaxY[4], MaxZ[4];
+        int Child[4];
+        int Count[4];
+    };
+
+    // Four triangles stored as structure of arrays, pre-transformed into the vertex/edge form used by
+    // the Moller-Trumbore test. Unused lanes have a zero area triangle and an Id of -1 and never report a hit.
+    struct TriangleBlock4
+    {
+        float V0X[4], V0Y[4], V0Z[4];
+        float E1X[4], E1Y[4], E1Z[4];
+        float E2X[4], E2Y[4], E2Z[4];
+        int Id[4];
+    };
+
+    struct WideBvhHit
+    {
+        int Id = -1;        // index of the triangle, -1 if nothing was hit
+        float T = FLT_MAX;
+        float U = 0.0f, V = 0.0f; // barycentric weights of the second and third vertex
+    };
+
+    // Up to four rays traced together. Rays in a packet should be coherent (e.g. share their origin)
+    // so that they visit mostly the same nodes.
+    struct RayPacket4
+    {
+        static const int Size = 4;
+        float OriginX[4], OriginY[4], OriginZ[4];
+        float DirX[4], DirY[4], DirZ[4];
+        float TMax[4];
+        int Count = 0;
+        void Add(const Ray & ray)
+        {
+            OriginX[Count] = ray.Origin.x; OriginY[Count] = ray.Origin.y; OriginZ[Count] = ray.Origin.z;
+            DirX[Count] = ray.Dir.x; DirY[Count] = ray.Dir.y; DirZ[Count] = ray.Dir.z;
+            TMax[Count] = ray.tMax;
+            Count++;
+        }
+    };
+
+    // Four-wide triangle BVH collapsed from a binary Bvh_Build. Triangles of each leaf are packed into
+    // TriangleBlock4s, the triangle ids refer to the element order of the array the tree was built from.
+    class TriangleBvh4
+    {
+    private:
+        CoreLib::List<Bvh4Node> nodes;
+        CoreLib::List<TriangleBlock4> blocks;
+        template<typename T, typename TGetVertex>
+        void AddLeaf(Bvh4Node & parent, int slot, BvhNode_Build<T> * leaf, T * elementBase, const TGetVertex & getVertex)
+        {
+            parent.Child[slot] = blocks.Count();
+            parent.Count[slot] = (leaf->ElementCount + 3) >> 2;
+            for (int i = 0; i < leaf->ElementCount; i += 4)
+            {
+                TriangleBlock4 block;
+                for (int j = 0; j < 4; j++)
+                {
+                    VectorMath::Vec3 v0, e1, e2;
+                    if (i + j < leaf->ElementCount)
+                    {
+                        auto element = leaf->Elements[i + j];
+                        block.Id[j] = (int)(element - elementBase);
+                        v0 = getVertex(*element, 0);
+                        e1 = getVertex(*element, 1) - v0;
+                        e2 = getVertex(*element, 2) - v0;
+                    }
+                    else
+                    {
+                        block.Id[j] = -1;
+                        v0.SetZero();
+                        e1.SetZero();
+                        e2.SetZero();
+                    }
+                    block.V0X[j] = v0.x; block.V0Y[j] = v0.y; block.V0Z[j] = v0.z;
+                    block.E1X[j] = e1.x; block.E1Y[j] = e1.y; block.E1Z[j] = e1.z;
+                    block.E2X[j] = e2.x; block.E2Y[j] = e2.y; block.E2Z[j] = e2.z;
+                }
+                blocks.Add(block);
+            }
+        }
+        template<typename T, typename TGetVertex>
+        int CollapseNode(BvhNode_Build<T> * node, T * elementBase, const TGetVertex & getVertex)
+        {
+            // pull grandchildren up until there are four children, always opening the largest inner child
+            BvhNode_Build<T> * children[4] = { node->Children[0], node->Children[1], nullptr, nullptr };
+            int childCount = 2;
+            while (childCount < 4)
+            {
+                int best = -1;
+                float bestArea = -1.0f;
+                for (int i = 0; i < childCount; i++)
+                {
+                    if (children[i]->Elements == 0)
+                    {
+                        float area = SurfaceArea(children[i]->Bounds);
+                        if (area > bestArea)
+                        {
+                            bestArea = area;
+                            best = i;
+                        }
+                    }
+                }
+                if (best == -1)
+                    break;
+                auto opened = children[best];
+                children[best] = opened->Children[0];
+                children[childCount++] = opened->Children[1];
+            }
+            int id = nodes.Count();
+            nodes.Add(Bvh4Node());
+            for (int i = 0; i < 4; i++)
+            {
+                auto & n = nodes[id];
+                if (i < childCount)
+                {
+                    auto & bounds = children[i]->Bounds;
+                    n.MinX[i] = bounds.xMin; n.MinY[i] = bounds.yMin; n.MinZ[i] = bounds.zMin;
+                    n.MaxX[i] = bounds.xMax; n.MaxY[i] = bounds.yMax; n.MaxZ[i] = bounds.zMax;
+                    if (children[i]->Elements)
+                        AddLeaf(n, i, children[i], elementBase, getVertex);
+                    else
+                    {
+                        n.Count[i] = 0;
+                        int childId = CollapseNode(children[i], elementBase, getVertex);
+                        nodes[id].Child[i] = childId;
+                    }
+                }
+                else
+                {
+                    // an inverted box is never hit
+                    n.MinX[i] = n.MinY[i] = n.MinZ[i] = FLT_MAX;
+                    n.MaxX[i] = n.MaxY[i] = n.MaxZ[i] = -FLT_MAX;
+                    n.Child[i] = 0;
+                    n.Count[i] = -1;
+                }
+            }
+            return id;
+        }
+    public:
+        // getVertex(element, i) returns the i-th vertex of a triangle element
+        template<typename T, typename TGetVertex>
+        void FromBuild(Bvh_Build<T> & bvh, T * elementBase, const TGetVertex & getVertex)
+        {
+            nodes.Clear();
+            blocks.Clear();
+            auto root = bvh.Root.Ptr();
+            if (!root)
+                return;
+            nodes.Reserve(bvh.NodeCount / 2 + 1);
+            blocks.Reserve(bvh.ElementListSize / 2 + 1);
+            if (root->Elements)
+            {
+                // a single leaf still gets a root node so that traversal always starts from a node
+                Bvh4Node n;
+                for (int i = 0; i < 4; i++)
+                {
+                    n.MinX[i] = n.MinY[i] = n.MinZ[i] = FLT_MAX;
+                    n.MaxX[i] = n.MaxY[i] = n.MaxZ[i] = -FLT_MAX;
+                    n.Child[i] = 0;
+                    n.Count[i] = -1;
+                }
+                n.MinX[0] = root->Bounds.xMin; n.MinY[0] = root->Bounds.yMin; n.MinZ[0] = root->Bounds.zMin;
+                n.MaxX[0] = root->Bounds.xMax; n.MaxY[0] = root->Bounds.yMax; n.MaxZ[0] = root->Bounds.zMax;
+                nodes.Add(n);
+                AddLeaf(nodes[0], 0, root, elementBase, getVertex);
+            }
+            else
+                CollapseNode(root, elementBase, getVertex);
+        }
+        int GetNodeCount() const
+        {
+            return nodes.Count();
+        }
+
+        // closest hit along a single ray
+        WideBvhHit TraceRay(const Ray & ray) const;
+        // returns true if the ray hits any triangle before ray.tMax
+        bool TraceOcclusion(const Ray & ray) const;
+        // closest hit of every ray in the packet, hits[i] receives the result of ray i
+        void TraceRays(const RayPacket4 & packet, WideBvhHit * hits) const;
+        // returns a mask with bit i set if ray i of the packet hits any triangle before its tMax
+        int TraceOcclusion(const RayPacket4 & packet) const;
+    };
+}
+
+#endif
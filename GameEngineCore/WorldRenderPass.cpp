@@ -1,6 +1,7 @@
 #include "WorldRenderPass.h"
 #include "Material.h"
 #include "Engine.h"
+#include "CoreLib/JobSystem.h"
 using namespace CoreLib;
 
 namespace GameEngine
@@ -32,13 +33,39 @@ namespace GameEngine
 		return fragShader->Id;
 	}
 
+	void WorldRenderPass::ResetInstancePool()
+	{
+		int threadCount = Threading::JobSystem::GetThreadCount();
+		if (commandBufferPools.Count() < threadCount)
+			commandBufferPools.SetSize(threadCount);
+		poolAllocPtrs.SetSize(commandBufferPools.Count());
+		for (auto & ptr : poolAllocPtrs)
+			ptr = 0;
+		instanceTransformAllocPtr = 0;
+	}
+
 	AsyncCommandBuffer * WorldRenderPass::AllocCommandBuffer()
 	{
-		if (poolAllocPtr == commandBufferPool.Count())
+		int threadIndex = Threading::JobSystem::GetCurrentThreadIndex();
+		auto & pool = commandBufferPools[threadIndex];
+		auto & allocPtr = poolAllocPtrs[threadIndex];
+		if (allocPtr == pool.Count())
+		{
+			pool.Add(new AsyncCommandBuffer(threadIndex, hwRenderer));
+		}
+		return pool[allocPtr++].Ptr();
+	}
+
+	ModuleInstance * WorldRenderPass::AllocInstanceTransformModule()
+	{
+		if (instanceTransformAllocPtr == instanceTransformPool.Count())
 		{
-			commandBufferPool.Add(new AsyncCommandBuffer(hwRenderer));
+			RefPtr<ModuleInstance> module = new ModuleInstance();
+			sharedRes->CreateModuleInstance(*module, Engine::GetShaderCompiler()->LoadSystemTypeSymbol("InstancedStaticMeshTransform"),
+				&sharedRes->instanceTransformMemory, (int)(sizeof(VectorMath::Vec4) + sizeof(VectorMath::Matrix4) * MaxInstancesPerDraw));
+			instanceTransformPool.Add(module);
 		}
-		return commandBufferPool[poolAllocPtr++].Ptr();
+		return instanceTransformPool[instanceTransformAllocPtr++].Ptr();
 	}
 
 	void WorldRenderPass::Create(Renderer * renderer)
@@ -48,6 +75,7 @@ namespace GameEngine
         fragShader = Engine::GetShaderCompiler()->LoadShaderEntryPoint(GetShaderFileName(), "ps_main");
         SetPipelineStates(fixedFunctionStates);
 		renderPassId = renderer->RegisterWorldRenderPass(GetShaderId());
+		ResetInstancePool();
 	}
 	WorldRenderPass::~WorldRenderPass()
 	{
@@ -12,8 +12,11 @@ namespace GameEngine
 		ShaderEntryPoint * vertShader = nullptr, * fragShader = nullptr;
 		int renderPassId = -1;
 	protected:
-		CoreLib::List<CoreLib::RefPtr<AsyncCommandBuffer>> commandBufferPool;
-		int poolAllocPtr = 0;
+		// one command buffer pool per job system thread, so that draw chunks can be recorded in parallel
+		CoreLib::List<CoreLib::List<CoreLib::RefPtr<AsyncCommandBuffer>>> commandBufferPools;
+		CoreLib::List<int> poolAllocPtrs;
+		CoreLib::List<CoreLib::RefPtr<ModuleInstance>> instanceTransformPool;
+		int instanceTransformAllocPtr = 0;
 		virtual const char * GetShaderFileName() = 0;
 		virtual RenderTargetLayout * CreateRenderTargetLayout() = 0;
 		virtual void SetPipelineStates(FixedFunctionPipelineStates & state)
@@ -24,12 +27,12 @@ namespace GameEngine
 		virtual void Create(Renderer * renderer) override;
 	public:
 		~WorldRenderPass();
-		void ResetInstancePool()
-		{
-			poolAllocPtr = 0;
-		}
+		void ResetInstancePool();
 		virtual void Bind();
+		// allocates a command buffer from the pool of the calling job system thread
 		AsyncCommandBuffer * AllocCommandBuffer();
+		// allocates an InstancedStaticMeshTransform module for one instanced draw call of the current frame
+		ModuleInstance * AllocInstanceTransformModule();
 		CoreLib::RefPtr<WorldPassRenderTask> CreateInstance(RenderOutput * output, bool clearOutput);
 		virtual int GetShaderId() override;
 	};
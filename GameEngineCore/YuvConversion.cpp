@@ -0,0 +1,310 @@
+#include "YuvConversion.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/JobSystem.h"
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// the AVX2 kernel is compiled for AVX2 and only called when the CPU supports it, the rest of the file keeps
+// the baseline flags
+#if defined(__GNUC__) || defined(__clang__)
+#define YUV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define YUV_TARGET_AVX2
+#endif
+
+using namespace CoreLib;
+
+namespace GameEngine
+{
+    namespace
+    {
+        // Q14 fixed point coefficients applied to R, G and B. Chroma is computed from the color sum of a
+        // 2x2 block, so its result is shifted by two more bits. Biases include the rounding term.
+        struct YuvCoefficients
+        {
+            short Y[3], U[3], V[3];
+            int YBias, CBias;
+        };
+
+        YuvCoefficients GetCoefficients(const YuvConversionOptions & options)
+        {
+            double kr = 0.299, kb = 0.114;
+            if (options.Matrix == YuvColorMatrix::BT709)
+            {
+                kr = 0.2126;
+                kb = 0.0722;
+            }
+            double yScale = 1.0, cScale = 1.0;
+            int yOffset = 0;
+            if (options.Range == YuvColorRange::Limited)
+            {
+                yScale = 219.0 / 255.0;
+                cScale = 224.0 / 255.0;
+                yOffset = 16;
+            }
+            const double one = 1 << 14;
+            YuvCoefficients c;
+            // the green coefficients absorb the rounding errors, so that white has the nominal peak luma
+            // and every gray has a chroma of exactly 128
+            c.Y[0] = (short)round(kr * yScale * one);
+            c.Y[2] = (short)round(kb * yScale * one);
+            c.Y[1] = (short)((int)round(yScale * one) - c.Y[0] - c.Y[2]);
+            double cHalf = 0.5 * cScale * one;
+            c.U[0] = (short)round(-cHalf * kr / (1.0 - kb));
+            c.U[2] = (short)round(cHalf);
+            c.U[1] = (short)(-c.U[0] - c.U[2]);
+            c.V[0] = (short)round(cHalf);
+            c.V[2] = (short)round(-cHalf * kb / (1.0 - kr));
+            c.V[1] = (short)(-c.V[0] - c.V[2]);
+            c.YBias = (yOffset << 14) + (1 << 13);
+            c.CBias = (128 << 16) + (1 << 15);
+            return c;
+        }
+
+        // two picture rows and the chroma row they share, source rows are valid up to ValidWidth pixels
+        struct RowPair
+        {
+            const unsigned char * Src[2];
+            int ValidWidth[2];
+            unsigned char * Y[2];
+            unsigned char * U, * V;
+        };
+
+        inline unsigned char ClampByte(int v)
+        {
+            return (unsigned char)Math::Clamp(v, 0, 255);
+        }
+
+        void ConvertBlocksScalar(const RowPair & rows, int xBegin, int width, const YuvCoefficients & c)
+        {
+            static const unsigned char black[4] = {};
+            for (int x = xBegin; x < width; x += 2)
+            {
+                int sum[3] = {};
+                for (int r = 0; r < 2; r++)
+                {
+                    for (int i = 0; i < 2; i++)
+                    {
+                        auto p = x + i < rows.ValidWidth[r] ? rows.Src[r] + (x + i) * 4 : black;
+                        rows.Y[r][x + i] = ClampByte((c.Y[0] * p[0] + c.Y[1] * p[1] + c.Y[2] * p[2] + c.YBias) >> 14);
+                        for (int k = 0; k < 3; k++)
+                            sum[k] += p[k];
+                    }
+                }
+                rows.U[x >> 1] = ClampByte((c.U[0] * sum[0] + c.U[1] * sum[1] + c.U[2] * sum[2] + c.CBias) >> 16);
+                rows.V[x >> 1] = ClampByte((c.V[0] * sum[0] + c.V[1] * sum[1] + c.V[2] * sum[2] + c.CBias) >> 16);
+            }
+        }
+
+        // The vectorized kernels compute the same integer sums as the scalar code: _mm_madd_epi16 multiplies
+        // 16 bit RGBA (or RGBA block sums) with {c0, c1, c2, 0} and _mm_hadd_epi32 adds the two halves, saturating
+        // packs then clamp to [0, 255].
+        inline __m128i Luma4(__m128i pixels, __m128i coef, __m128i bias)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coef);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coef);
+            return _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), bias), 14);
+        }
+
+        inline __m128i Chroma4(__m128i blockSums0, __m128i blockSums1, __m128i coef, __m128i bias)
+        {
+            __m128i sum = _mm_hadd_epi32(_mm_madd_epi16(blockSums0, coef), _mm_madd_epi16(blockSums1, coef));
+            return _mm_srai_epi32(_mm_add_epi32(sum, bias), 16);
+        }
+
+        // converts blocks of 8 columns starting at xBegin, returns the first column left to convert
+        int ConvertBlocksSse(const RowPair & rows, int xBegin, int width, const YuvCoefficients & c)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i yCoef = _mm_setr_epi16(c.Y[0], c.Y[1], c.Y[2], 0, c.Y[0], c.Y[1], c.Y[2], 0);
+            const __m128i uCoef = _mm_setr_epi16(c.U[0], c.U[1], c.U[2], 0, c.U[0], c.U[1], c.U[2], 0);
+            const __m128i vCoef = _mm_setr_epi16(c.V[0], c.V[1], c.V[2], 0, c.V[0], c.V[1], c.V[2], 0);
+            const __m128i yBias = _mm_set1_epi32(c.YBias);
+            const __m128i cBias = _mm_set1_epi32(c.CBias);
+            int end = Math::Min(width, Math::Min(rows.ValidWidth[0], rows.ValidWidth[1]));
+            int x = xBegin;
+            for (; x + 8 <= end; x += 8)
+            {
+                __m128i pixels[2][2];
+                for (int r = 0; r < 2; r++)
+                {
+                    pixels[r][0] = _mm_loadu_si128((const __m128i*)(rows.Src[r] + x * 4));
+                    pixels[r][1] = _mm_loadu_si128((const __m128i*)(rows.Src[r] + x * 4 + 16));
+                    __m128i luma = _mm_packs_epi32(Luma4(pixels[r][0], yCoef, yBias), Luma4(pixels[r][1], yCoef, yBias));
+                    _mm_storel_epi64((__m128i*)(rows.Y[r] + x), _mm_packus_epi16(luma, luma));
+                }
+                // sum the two rows, then the two columns of each block
+                __m128i blockSums[2];
+                for (int i = 0; i < 2; i++)
+                {
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(pixels[0][i], zero), _mm_unpacklo_epi8(pixels[1][i], zero));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(pixels[0][i], zero), _mm_unpackhi_epi8(pixels[1][i], zero));
+                    blockSums[i] = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+                }
+                __m128i uv = _mm_packs_epi32(Chroma4(blockSums[0], blockSums[1], uCoef, cBias),
+                    Chroma4(blockSums[0], blockSums[1], vCoef, cBias));
+                uv = _mm_packus_epi16(uv, uv);
+                int u = _mm_cvtsi128_si32(uv);
+                int v = _mm_extract_epi32(uv, 1);
+                memcpy(rows.U + (x >> 1), &u, sizeof(int));
+                memcpy(rows.V + (x >> 1), &v, sizeof(int));
+            }
+            return x;
+        }
+
+        // 256 bit unpacks and horizontal adds work within 128 bit lanes, so pixels 0-3 are processed in the
+        // low lane and pixels 4-7 in the high lane of each register
+        YUV_TARGET_AVX2 inline __m256i Luma8(__m256i pixels, __m256i coef, __m256i bias)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coef);
+            __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coef);
+            return _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), bias), 14);
+        }
+
+        YUV_TARGET_AVX2 inline __m256i Chroma8(__m256i blockSums0, __m256i blockSums1, __m256i coef, __m256i bias)
+        {
+            __m256i sum = _mm256_hadd_epi32(_mm256_madd_epi16(blockSums0, coef), _mm256_madd_epi16(blockSums1, coef));
+            return _mm256_srai_epi32(_mm256_add_epi32(sum, bias), 16);
+        }
+
+        // converts blocks of 16 columns, returns the first column left to convert
+        YUV_TARGET_AVX2 int ConvertBlocksAvx2(const RowPair & rows, int width, const YuvCoefficients & c)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i yCoef = _mm256_broadcastsi128_si256(_mm_setr_epi16(c.Y[0], c.Y[1], c.Y[2], 0, c.Y[0], c.Y[1], c.Y[2], 0));
+            const __m256i uCoef = _mm256_broadcastsi128_si256(_mm_setr_epi16(c.U[0], c.U[1], c.U[2], 0, c.U[0], c.U[1], c.U[2], 0));
+            const __m256i vCoef = _mm256_broadcastsi128_si256(_mm_setr_epi16(c.V[0], c.V[1], c.V[2], 0, c.V[0], c.V[1], c.V[2], 0));
+            const __m256i yBias = _mm256_set1_epi32(c.YBias);
+            const __m256i cBias = _mm256_set1_epi32(c.CBias);
+            // block sums come out as u0 u1 u4 u5 v0 v1 v4 v5 u2 u3 u6 u7 v2 v3 v6 v7
+            const __m128i chromaOrder = _mm_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+            int end = Math::Min(width, Math::Min(rows.ValidWidth[0], rows.ValidWidth[1]));
+            int x = 0;
+            for (; x + 16 <= end; x += 16)
+            {
+                __m256i pixels[2][2];
+                for (int r = 0; r < 2; r++)
+                {
+                    pixels[r][0] = _mm256_loadu_si256((const __m256i*)(rows.Src[r] + x * 4));
+                    pixels[r][1] = _mm256_loadu_si256((const __m256i*)(rows.Src[r] + x * 4 + 32));
+                    __m256i luma = _mm256_packs_epi32(Luma8(pixels[r][0], yCoef, yBias), Luma8(pixels[r][1], yCoef, yBias));
+                    // luma holds pixels 0-3 8-11 | 4-7 12-15
+                    __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(luma), _mm256_extracti128_si256(luma, 1));
+                    _mm_storeu_si128((__m128i*)(rows.Y[r] + x), _mm_shuffle_epi32(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+                }
+                __m256i blockSums[2];
+                for (int i = 0; i < 2; i++)
+                {
+                    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(pixels[0][i], zero), _mm256_unpacklo_epi8(pixels[1][i], zero));
+                    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(pixels[0][i], zero), _mm256_unpackhi_epi8(pixels[1][i], zero));
+                    blockSums[i] = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+                }
+                __m256i uv = _mm256_packs_epi32(Chroma8(blockSums[0], blockSums[1], uCoef, cBias),
+                    Chroma8(blockSums[0], blockSums[1], vCoef, cBias));
+                __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(uv), _mm256_extracti128_si256(uv, 1));
+                bytes = _mm_shuffle_epi8(bytes, chromaOrder);
+                _mm_storel_epi64((__m128i*)(rows.U + (x >> 1)), bytes);
+                _mm_storel_epi64((__m128i*)(rows.V + (x >> 1)), _mm_srli_si128(bytes, 8));
+            }
+            return x;
+        }
+
+        void CpuId(unsigned int leaf, unsigned int subLeaf, unsigned int regs[4])
+        {
+#if defined(_MSC_VER)
+            __cpuidex((int*)regs, (int)leaf, (int)subLeaf);
+#else
+            __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        }
+
+        // the register state components the OS saves on context switches
+        unsigned long long XGetBV()
+        {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#else
+            unsigned int low, high;
+            __asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+            return ((unsigned long long)high << 32) | low;
+#endif
+        }
+
+        YuvConversionKernel DetectKernel()
+        {
+            unsigned int regs[4];
+            CpuId(0, 0, regs);
+            if (regs[0] < 7)
+                return YuvConversionKernel::SSE41;
+            CpuId(1, 0, regs);
+            bool osxsave = (regs[2] & (1u << 27)) != 0, avx = (regs[2] & (1u << 28)) != 0;
+            // the OS must save the YMM registers
+            if (!osxsave || !avx || (XGetBV() & 6) != 6)
+                return YuvConversionKernel::SSE41;
+            CpuId(7, 0, regs);
+            return (regs[1] & (1u << 5)) ? YuvConversionKernel::AVX2 : YuvConversionKernel::SSE41;
+        }
+
+        void ConvertRowPairs(const unsigned char * rgba, int srcWidth, int srcHeight, int srcStride, const I420Image & dst,
+            const YuvConversionOptions & options, const YuvCoefficients & c, int pairBegin, int pairEnd, YuvConversionKernel kernel)
+        {
+            for (int pair = pairBegin; pair < pairEnd; pair++)
+            {
+                RowPair rows;
+                for (int r = 0; r < 2; r++)
+                {
+                    int y = pair * 2 + r;
+                    bool inside = y < srcHeight;
+                    int srcY = options.FlipVertical ? srcHeight - 1 - y : y;
+                    rows.Src[r] = inside ? rgba + (size_t)srcY * srcStride : nullptr;
+                    rows.ValidWidth[r] = inside ? Math::Min(srcWidth, dst.Width) : 0;
+                    rows.Y[r] = dst.Y + (size_t)y * dst.YStride;
+                }
+                rows.U = dst.U + (size_t)pair * dst.UVStride;
+                rows.V = dst.V + (size_t)pair * dst.UVStride;
+                int x = 0;
+                if (kernel == YuvConversionKernel::AVX2)
+                    x = ConvertBlocksAvx2(rows, dst.Width, c);
+                if (kernel != YuvConversionKernel::Scalar)
+                    x = ConvertBlocksSse(rows, x, dst.Width, c);
+                ConvertBlocksScalar(rows, x, dst.Width, c);
+            }
+        }
+    }
+
+    YuvConversionKernel GetSupportedYuvConversionKernel()
+    {
+        static YuvConversionKernel kernel = DetectKernel();
+        return kernel;
+    }
+
+    void ConvertRGBAToI420(const unsigned char * rgba, int srcWidth, int srcHeight, int srcStride, const I420Image & dst,
+        const YuvConversionOptions & options)
+    {
+        CORELIB_ASSERT((dst.Width & 1) == 0 && (dst.Height & 1) == 0);
+        auto c = GetCoefficients(options);
+        auto kernel = Math::Min(options.MaxKernel, GetSupportedYuvConversionKernel());
+        int pairCount = dst.Height >> 1;
+        int threadCount = Threading::JobSystem::GetThreadCount();
+        // one band per thread, bands smaller than 16 row pairs are not worth a job
+        int grainSize = Math::Max(16, (pairCount + threadCount - 1) / threadCount);
+        Threading::JobSystem::ParallelForRange(0, pairCount, grainSize, [&](int pairBegin, int pairEnd)
+        {
+            ConvertRowPairs(rgba, srcWidth, srcHeight, srcStride, dst, options, c, pairBegin, pairEnd, kernel);
+        });
+    }
+
+    void ConvertRGBAToI420Reference(const unsigned char * rgba, int srcWidth, int srcHeight, int srcStride,
+        const I420Image & dst, const YuvConversionOptions & options)
+    {
+        CORELIB_ASSERT((dst.Width & 1) == 0 && (dst.Height & 1) == 0);
+        auto c = GetCoefficients(options);
+        ConvertRowPairs(rgba, srcWidth, srcHeight, srcStride, dst, options, c, 0, dst.Height >> 1, YuvConversionKernel::Scalar);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef GAME_ENGINE_YUV_CONVERSION_H
+#define GAME_ENGINE_YUV_CONVERSION_H
+
+namespace GameEngine
+{
+    enum class YuvColorMatrix
+    {
+        BT601, BT709
+    };
+
+    enum class YuvColorRange
+    {
+        Limited, // Y in [16, 235], chroma in [16, 240]
+        Full     // all components in [0, 255]
+    };
+
+    // Instruction sets of the ConvertRGBAToI420 kernels, in increasing width
+    enum class YuvConversionKernel
+    {
+        Scalar, SSE41, AVX2
+    };
+
+    struct YuvConversionOptions
+    {
+        YuvColorMatrix Matrix = YuvColorMatrix::BT709;
+        YuvColorRange Range = YuvColorRange::Limited;
+        // the source image is stored bottom-up, i.e. its first row is the bottom row of the picture
+        bool FlipVertical = false;
+        // the widest kernel ConvertRGBAToI420 may use, it is limited to what the CPU supports
+        YuvConversionKernel MaxKernel = YuvConversionKernel::AVX2;
+    };
+
+    // The widest kernel the CPU supports, detected with cpuid on first use. SSE4.1 is always available
+    // since the engine is built for it.
+    YuvConversionKernel GetSupportedYuvConversionKernel();
+
+    // Planes of an I420 picture. Width and Height must be even, the chroma planes are half the size in both dimensions.
+    struct I420Image
+    {
+        unsigned char * Y = nullptr;
+        unsigned char * U = nullptr;
+        unsigned char * V = nullptr;
+        int Width = 0, Height = 0;
+        int YStride = 0, UVStride = 0;
+    };
+
+    // Converts an RGBA8 image of srcWidth x srcHeight pixels, whose rows are srcStride bytes apart, to I420.
+    // Parts of the picture that the source image does not cover are black. Each chroma sample is computed from the
+    // average color of its 2x2 pixel block. Row bands are converted in parallel if the job system is initialized.
+    void ConvertRGBAToI420(const unsigned char * rgba, int srcWidth, int srcHeight, int srcStride, const I420Image & dst,
+        const YuvConversionOptions & options);
+
+    // Scalar implementation of ConvertRGBAToI420, which produces exactly the same output.
+    void ConvertRGBAToI420Reference(const unsigned char * rgba, int srcWidth, int srcHeight, int srcStride,
+        const I420Image & dst, const YuvConversionOptions & options);
+}
+
+#endif
@@ -0,0 +1,151 @@
+// AnimationCompressor.cpp : Converts skeletal animations (.anim) into compressed clips (.canim).
+//
+
+#include "CompressedAnimation.h"
+#include "CoreLib/LibIO.h"
+#include "CoreLib/PerformanceCounter.h"
+
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace CoreLib::Diagnostics;
+using namespace GameEngine;
+using namespace VectorMath;
+
+void PrintStats(const String & fileName, const AnimationCompressionStats & stats)
+{
+	printf("%s: %d -> %d bytes (%.1fx)\n", fileName.Buffer(), stats.SourceBytes, stats.CompressedBytes,
+		stats.SourceBytes / (float)Math::Max(stats.CompressedBytes, 1));
+	printf("tracks: %d constant, %d linear, %d quantized, %d raw\n", stats.ConstantTracks, stats.LinearTracks,
+		stats.QuantizedTracks, stats.RawTracks);
+	printf("max error: rotation %.5f rad, translation %.5f, scale %.5f\n", stats.MaxRotationError,
+		stats.MaxTranslationError, stats.MaxScaleError);
+}
+
+void CompressAnimationFile(const String & fileName, const AnimationCompressionSettings & settings)
+{
+	SkeletalAnimation anim;
+	anim.LoadFromFile(fileName);
+	AnimationCompressionStats stats;
+	auto clip = AnimationCompressor::Compress(anim, settings, &stats);
+	clip->SaveToFile(Path::ReplaceExt(fileName, "canim"));
+	PrintStats(fileName, stats);
+}
+
+// Reports size and accuracy of the compressed clip, and the sampling cost of both formats for
+// sequential playback at 60Hz and for random access. Errors are measured against the source
+// channels at 240Hz, so they include interpolation between resampled frames.
+void BenchmarkCompression(const String & fileName, const AnimationCompressionSettings & settings)
+{
+	SkeletalAnimation anim;
+	anim.LoadFromFile(fileName);
+	AnimationCompressionStats stats;
+	auto counter = PerformanceCounter::Start();
+	auto clip = AnimationCompressor::Compress(anim, settings, &stats);
+	double compressTime = PerformanceCounter::EndSeconds(counter);
+	PrintStats(fileName, stats);
+	printf("compression: %.1f ms\n", compressTime * 1000.0);
+
+	List<int> trackChannels;
+	for (int i = 0; i < anim.Channels.Count(); i++)
+	{
+		if (anim.Channels[i].KeyFrames.Count())
+			trackChannels.Add(i);
+	}
+	List<BoneTransformation> decoded;
+	decoded.SetSize(clip->Tracks.Count());
+	CompressedAnimationCursor cursor(clip.Ptr());
+	float maxRotationError = 0.0f, maxTranslationError = 0.0f;
+	for (float t = 0.0f; t < anim.Duration; t += 1.0f / 240.0f)
+	{
+		cursor.SampleTracks(t, decoded.Buffer());
+		for (int i = 0; i < trackChannels.Count(); i++)
+		{
+			auto expected = anim.Channels[trackChannels[i]].Sample(t);
+			auto rotation = decoded[i].Rotation;
+			if (Quaternion::Dot(expected.Rotation, rotation) < 0.0f)
+				rotation = -rotation;
+			float chord = (expected.Rotation * (1.0f / expected.Rotation.Length()) - rotation).Length();
+			maxRotationError = Math::Max(maxRotationError, 4.0f * asinf(Math::Min(1.0f, chord * 0.5f)));
+			maxTranslationError = Math::Max(maxTranslationError, (expected.Translation - decoded[i].Translation).Length());
+		}
+	}
+	printf("max error between frames: rotation %.5f rad, translation %.5f\n", maxRotationError, maxTranslationError);
+
+	const int sampleCount = 20000;
+	List<float> randomTimes;
+	Random random(1);
+	for (int i = 0; i < sampleCount; i++)
+		randomTimes.Add(random.NextFloat() * anim.Duration);
+	float checksum = 0.0f;
+	auto report = [&](const char * name, double seconds)
+	{
+		printf("%-28s %8.1f ns per bone\n", name, seconds * 1e9 / ((double)sampleCount * Math::Max(trackChannels.Count(), 1)));
+	};
+	for (int pass = 0; pass < 2; pass++)
+	{
+		auto timeAt = [&](int i)
+		{
+			return pass == 0 ? fmod(i / 60.0f, anim.Duration) : randomTimes[i];
+		};
+		counter = PerformanceCounter::Start();
+		for (int i = 0; i < sampleCount; i++)
+		{
+			float t = timeAt(i);
+			for (auto channel : trackChannels)
+				checksum += anim.Channels[channel].Sample(t).Translation.x;
+		}
+		report(pass == 0 ? "source, sequential" : "source, random", PerformanceCounter::EndSeconds(counter));
+		counter = PerformanceCounter::Start();
+		for (int i = 0; i < sampleCount; i++)
+		{
+			cursor.SampleTracks(timeAt(i), decoded.Buffer());
+			checksum += decoded.Count() ? decoded[0].Translation.x : 0.0f;
+		}
+		report(pass == 0 ? "compressed, sequential" : "compressed, random", PerformanceCounter::EndSeconds(counter));
+	}
+	printf("(checksum %f)\n", checksum);
+}
+
+int wmain(int argc, const wchar_t ** argv)
+{
+	if (argc > 1)
+	{
+		String fileName = String::FromWString(argv[1]);
+		AnimationCompressionSettings settings;
+		bool benchmark = false;
+		for (int i = 2; i < argc; i++)
+		{
+			auto arg = String::FromWString(argv[i]);
+			if (arg == "-benchmark")
+				benchmark = true;
+			else if (i + 1 < argc)
+			{
+				auto value = String::FromWString(argv[i + 1]);
+				if (arg == "-rotation")
+					settings.RotationTolerance = (float)StringToDouble(value);
+				else if (arg == "-translation")
+					settings.TranslationTolerance = (float)StringToDouble(value);
+				else if (arg == "-scale")
+					settings.ScaleTolerance = (float)StringToDouble(value);
+				else if (arg == "-segment")
+					settings.SegmentLength = StringToInt(value);
+				else
+					continue;
+				i++;
+			}
+		}
+		if (benchmark)
+			BenchmarkCompression(fileName, settings);
+		else
+			CompressAnimationFile(fileName, settings);
+	}
+	else
+	{
+		printf("Command Format: AnimationCompressor file_name.anim [options]\n");
+		printf("Writes file_name.canim. Options:\n");
+		printf("  -rotation radians, -translation units, -scale value: maximum error per track\n");
+		printf("  -segment frames: frames per segment (default 16)\n");
+		printf("  -benchmark: reports size, accuracy and sampling cost against the source clip\n");
+	}
+	return 0;
+}
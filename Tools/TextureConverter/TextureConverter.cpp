@@ -6,33 +6,61 @@
 #include "CoreLib/LibIO.h"
 #include "CoreLib/Imaging/TextureData.h"
 #include "Imaging/Bitmap.h"
+#include "CoreLib/PerformanceCounter.h"
 
 using namespace CoreLib;
 using namespace CoreLib::Graphics;
 using namespace CoreLib::Imaging;
 using namespace CoreLib::IO;
+using namespace CoreLib::Diagnostics;
 using namespace GameEngine;
 
-void ConvertTexture(const String & fileName, TextureStorageFormat format)
+List<unsigned int> LoadFlippedRGBA(Bitmap & bmp)
 {
-	if (format == TextureStorageFormat::BC1 || format == TextureStorageFormat::BC5 || format == TextureStorageFormat::BC3)
+	List<unsigned int> pixelsInversed;
+	int * sourcePixels = (int*)bmp.GetPixels();
+	pixelsInversed.SetSize(bmp.GetWidth() * bmp.GetHeight());
+	for (int i = 0; i < bmp.GetHeight(); i++)
 	{
-		Bitmap bmp(fileName);
-		List<unsigned int> pixelsInversed;
-		int * sourcePixels = (int*)bmp.GetPixels();
-		pixelsInversed.SetSize(bmp.GetWidth() * bmp.GetHeight());
-		for (int i = 0; i < bmp.GetHeight(); i++)
+		for (int j = 0; j < bmp.GetWidth(); j++)
+			pixelsInversed[i*bmp.GetWidth() + j] = sourcePixels[(bmp.GetHeight() - 1 - i)*bmp.GetWidth() + j];
+	}
+	return pixelsInversed;
+}
+
+List<float> LoadFlippedRGB(BitmapF & bmp)
+{
+	List<float> pixelsInversed;
+	auto sourcePixels = bmp.GetPixels();
+	pixelsInversed.SetSize(bmp.GetWidth() * bmp.GetHeight() * 3);
+	for (int i = 0; i < bmp.GetHeight(); i++)
+	{
+		for (int j = 0; j < bmp.GetWidth(); j++)
 		{
-			for (int j = 0; j < bmp.GetWidth(); j++)
-				pixelsInversed[i*bmp.GetWidth() + j] = sourcePixels[(bmp.GetHeight() - 1 - i)*bmp.GetWidth() + j];
+			auto & pixel = sourcePixels[(bmp.GetHeight() - 1 - i)*bmp.GetWidth() + j];
+			for (int c = 0; c < 3; c++)
+				pixelsInversed[(i*bmp.GetWidth() + j) * 3 + c] = pixel[c];
 		}
+	}
+	return pixelsInversed;
+}
+
+void ConvertTexture(const String & fileName, TextureStorageFormat format, TextureCompressionQuality quality)
+{
+	if (format == TextureStorageFormat::BC1 || format == TextureStorageFormat::BC5 || format == TextureStorageFormat::BC3 || format == TextureStorageFormat::BC7)
+	{
+		Bitmap bmp(fileName);
 		CoreLib::Graphics::TextureFile texFile;
-		if (format == TextureStorageFormat::BC1)
-			TextureCompressor::CompressRGBA_BC1(texFile, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), bmp.GetWidth(), bmp.GetHeight());
-		else if (format == TextureStorageFormat::BC3)
-			TextureCompressor::CompressRGBA_BC3(texFile, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), bmp.GetWidth(), bmp.GetHeight());
-		else
-			TextureCompressor::CompressRG_BC5(texFile, MakeArrayView((unsigned char*)pixelsInversed.Buffer(), pixelsInversed.Count() * 4), bmp.GetWidth(), bmp.GetHeight());
+		TextureCompressor::CompressTopDownRGBA(texFile, format, MakeArrayView((unsigned char*)bmp.GetPixels(), bmp.GetWidth() * bmp.GetHeight() * 4),
+			bmp.GetWidth(), bmp.GetHeight(), quality);
+		texFile.SaveToFile(Path::ReplaceExt(fileName, "texture"));
+	}
+	else if (format == TextureStorageFormat::BC6H)
+	{
+		BitmapF bmp(fileName);
+		List<float> pixelsInversed = LoadFlippedRGB(bmp);
+		CoreLib::Graphics::TextureFile texFile;
+		TextureCompressor::CompressRGB_BC6H(texFile, pixelsInversed.GetArrayView(), bmp.GetWidth(), bmp.GetHeight(), quality);
 		texFile.SaveToFile(Path::ReplaceExt(fileName, "texture"));
 	}
 	else
@@ -46,6 +74,177 @@ void ConvertTexture(const String & fileName, TextureStorageFormat format)
 	}
 }
 
+int GetMipChainPixelCount(int width, int height)
+{
+	int count = 0;
+	while (true)
+	{
+		count += width * height;
+		if (width == 1 && height == 1)
+			break;
+		width = Math::Max(1, width / 2);
+		height = Math::Max(1, height / 2);
+	}
+	return count;
+}
+
+// Compresses the image with the BC6H and BC7 encoders at every quality and reports throughput over the
+// whole mip chain and the PSNR of the top level. BC6H PSNR is measured on log2(1 + x), the space the
+// encoder minimizes its error in, with the brightest source value as peak.
+void BenchmarkCompression(const String & fileName)
+{
+	const char * qualityNames[] = { "fast", "normal", "high" };
+	Bitmap bmp(fileName);
+	BitmapF bmpF(fileName);
+	int width = bmp.GetWidth(), height = bmp.GetHeight();
+	int blocksPerRow = (width + 3) / 4;
+	double megaPixels = GetMipChainPixelCount(width, height) / 1000000.0;
+	List<unsigned int> rgba = LoadFlippedRGBA(bmp);
+	List<float> rgb = LoadFlippedRGB(bmpF);
+	printf("%s: %d x %d\n", fileName.Buffer(), width, height);
+	for (int q = 0; q < 3; q++)
+	{
+		auto quality = (TextureCompressionQuality)q;
+		TextureFile texFile;
+		auto counter = PerformanceCounter::Start();
+		TextureCompressor::CompressRGBA_BC7(texFile, MakeArrayView((unsigned char*)rgba.Buffer(), rgba.Count() * 4), width, height, quality);
+		double seconds = PerformanceCounter::EndSeconds(counter);
+		auto blocks = texFile.GetBuffer(0);
+		double squaredError = 0.0;
+		for (int i = 0; i < height; i++)
+		{
+			for (int j = 0; j < width; j++)
+			{
+				unsigned char texels[64];
+				DecompressBlock_BC7(texels, blocks.Buffer() + ((i >> 2) * blocksPerRow + (j >> 2)) * 16);
+				auto decoded = texels + ((i & 3) * 4 + (j & 3)) * 4;
+				auto source = (unsigned char*)(rgba.Buffer() + i * width + j);
+				for (int c = 0; c < 4; c++)
+					squaredError += (double)(decoded[c] - source[c]) * (decoded[c] - source[c]);
+			}
+		}
+		double mse = Math::Max(squaredError / ((double)width * height * 4), 1e-10);
+		printf("BC7  %-6s %8.2f MP/s  PSNR %6.2f dB\n", qualityNames[q], megaPixels / seconds, 10.0 * log10(255.0 * 255.0 / mse));
+	}
+	float peak = 0.0f;
+	for (auto v : rgb)
+		peak = Math::Max(peak, log2f(1.0f + Math::Max(v, 0.0f)));
+	for (int q = 0; q < 3; q++)
+	{
+		auto quality = (TextureCompressionQuality)q;
+		TextureFile texFile;
+		auto counter = PerformanceCounter::Start();
+		TextureCompressor::CompressRGB_BC6H(texFile, rgb.GetArrayView(), width, height, quality);
+		double seconds = PerformanceCounter::EndSeconds(counter);
+		auto blocks = texFile.GetBuffer(0);
+		double squaredError = 0.0;
+		for (int i = 0; i < height; i++)
+		{
+			for (int j = 0; j < width; j++)
+			{
+				float texels[48];
+				DecompressBlock_BC6H(texels, blocks.Buffer() + ((i >> 2) * blocksPerRow + (j >> 2)) * 16);
+				auto decoded = texels + ((i & 3) * 4 + (j & 3)) * 3;
+				auto source = rgb.Buffer() + (i * width + j) * 3;
+				for (int c = 0; c < 3; c++)
+				{
+					double d = log2f(1.0f + decoded[c]) - log2f(1.0f + Math::Max(source[c], 0.0f));
+					squaredError += d * d;
+				}
+			}
+		}
+		double mse = Math::Max(squaredError / ((double)width * height * 3), 1e-10);
+		printf("BC6H %-6s %8.2f MP/s  PSNR %6.2f dB\n", qualityNames[q], megaPixels / seconds, 10.0 * log10((double)peak * peak / mse));
+	}
+}
+
+// Writes a synthetic set of BC1 and BC3 textures next to `fileName` and compares, per texture, loading the
+// whole file into a TextureFile and copying each level to an upload buffer against reading each level
+// straight into a reused upload buffer with TextureFileReader. Also compares flipping the source pixels
+// before compression against flipping the compressed blocks.
+void BenchmarkLoad(const String & fileName)
+{
+	const int textureCount = 16, textureSize = 1024, repeatCount = 4;
+	List<unsigned int> pixels;
+	pixels.SetSize(textureSize * textureSize);
+	unsigned int seed = 17;
+	for (int i = 0; i < textureSize; i++)
+	{
+		for (int j = 0; j < textureSize; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			unsigned int noise = (seed >> 16) & 31;
+			pixels[i * textureSize + j] = ((i + noise) & 255) | (((j + noise) & 255) << 8) | (((i ^ j) & 255) << 16) | (((i + j) & 255) << 24);
+		}
+	}
+	auto pixelView = MakeArrayView((unsigned char*)pixels.Buffer(), pixels.Count() * 4);
+	TextureStorageFormat formats[] = { TextureStorageFormat::BC1, TextureStorageFormat::BC3 };
+	const char * formatNames[] = { "BC1", "BC3" };
+	List<String> fileNames;
+	size_t totalBytes = 0;
+	for (int f = 0; f < 2; f++)
+	{
+		double pixelFlipSeconds = 0.0, blockFlipSeconds = 0.0;
+		TextureFile texFile;
+		auto counter = PerformanceCounter::Start();
+		List<unsigned int> pixelsInversed;
+		pixelsInversed.SetSize(pixels.Count());
+		for (int i = 0; i < textureSize; i++)
+			memcpy(pixelsInversed.Buffer() + i * textureSize, pixels.Buffer() + (textureSize - 1 - i) * textureSize, textureSize * sizeof(unsigned int));
+		pixelFlipSeconds = PerformanceCounter::EndSeconds(counter);
+		if (formats[f] == TextureStorageFormat::BC1)
+			TextureCompressor::CompressRGBA_BC1(texFile, pixelView, textureSize, textureSize);
+		else
+			TextureCompressor::CompressRGBA_BC3(texFile, pixelView, textureSize, textureSize);
+		counter = PerformanceCounter::Start();
+		texFile.SetRowOrder(TextureRowOrder::TopDown);
+		texFile.FlipRows();
+		blockFlipSeconds = PerformanceCounter::EndSeconds(counter);
+		printf("%s flip: pixels %8.3f ms, blocks %8.3f ms\n", formatNames[f], pixelFlipSeconds * 1000.0, blockFlipSeconds * 1000.0);
+		for (int i = 0; i < textureCount / 2; i++)
+		{
+			auto name = Path::ReplaceExt(fileName, (String("benchmark_") + formatNames[f] + "_" + String(i) + ".texture").Buffer());
+			texFile.SaveToFile(name);
+			fileNames.Add(name);
+			totalBytes += texFile.GetArrayStride();
+		}
+	}
+	List<unsigned char> uploadBuffer;
+	double fileSeconds = 0.0, readerSeconds = 0.0;
+	for (int r = 0; r < repeatCount; r++)
+	{
+		auto counter = PerformanceCounter::Start();
+		for (auto & name : fileNames)
+		{
+			TextureFile texFile(name);
+			for (int level = 0; level < texFile.GetMipLevels(); level++)
+			{
+				auto levelSize = texFile.GetImagePlaneSize(Math::Max(1, texFile.GetWidth() >> level), Math::Max(1, texFile.GetHeight() >> level));
+				uploadBuffer.SetSize((int)levelSize);
+				memcpy(uploadBuffer.Buffer(), texFile.GetBuffer(level).Buffer(), levelSize);
+			}
+		}
+		fileSeconds += PerformanceCounter::EndSeconds(counter);
+		counter = PerformanceCounter::Start();
+		for (auto & name : fileNames)
+		{
+			FileStream stream(name);
+			TextureFileReader reader(&stream);
+			for (int level = 0; level < reader.GetMipLevels(); level++)
+			{
+				uploadBuffer.SetSize((int)reader.GetLevelSize(level));
+				reader.ReadLevel(uploadBuffer.GetArrayView());
+			}
+		}
+		readerSeconds += PerformanceCounter::EndSeconds(counter);
+	}
+	double megaBytes = totalBytes * (double)repeatCount / (1 << 20);
+	printf("load %d textures (%.1f MB): whole file %8.2f MB/s, per level %8.2f MB/s\n", fileNames.Count(), totalBytes / (double)(1 << 20),
+		megaBytes / fileSeconds, megaBytes / readerSeconds);
+	for (auto & name : fileNames)
+		remove(name.Buffer());
+}
+
 const int colorLookupImageSize = 16;
 
 void CreateColorLookupTexture(String fileName)
@@ -80,6 +279,9 @@ int wmain(int argc, const wchar_t ** argv)
 		TextureStorageFormat format = TextureStorageFormat::BC1;
 		String fileName = String::FromWString(argv[1]);
 		bool colorLookup = false;
+		bool benchmark = false;
+		bool benchmarkLoad = false;
+		TextureCompressionQuality quality = TextureCompressionQuality::Normal;
 		for (int i = 0; i < argc; i++)
 		{
 			if (String::FromWString(argv[i]) == "-bc1")
@@ -88,6 +290,10 @@ int wmain(int argc, const wchar_t ** argv)
 				format = TextureStorageFormat::BC5;
 			if (String::FromWString(argv[i]) == "-bc3")
 				format = TextureStorageFormat::BC3;
+			if (String::FromWString(argv[i]) == "-bc6h")
+				format = TextureStorageFormat::BC6H;
+			if (String::FromWString(argv[i]) == "-bc7")
+				format = TextureStorageFormat::BC7;
 			if (String::FromWString(argv[i]) == "-r8")
 				format = TextureStorageFormat::R8;
 			if (String::FromWString(argv[i]) == "-rg8")
@@ -100,16 +306,31 @@ int wmain(int argc, const wchar_t ** argv)
 				format = TextureStorageFormat::RGBA_F32;
 			if (String::FromWString(argv[i]) == "-colorlu")
 				colorLookup = true;
+			if (String::FromWString(argv[i]) == "-fast")
+				quality = TextureCompressionQuality::Fast;
+			if (String::FromWString(argv[i]) == "-high")
+				quality = TextureCompressionQuality::High;
+			if (String::FromWString(argv[i]) == "-benchmark")
+				benchmark = true;
+			if (String::FromWString(argv[i]) == "-benchmarkload")
+				benchmarkLoad = true;
 		}
-		if (colorLookup)
+		if (benchmarkLoad)
+			BenchmarkLoad(fileName);
+		else if (benchmark)
+			BenchmarkCompression(fileName);
+		else if (colorLookup)
 			CreateColorLookupTexture(fileName);
 		else
-			ConvertTexture(fileName, format);
+			ConvertTexture(fileName, format, quality);
 	}
 	else
 	{
 		printf("Command Format: TextureConverter file_name -format\n");
-		printf("Supported formats: bc1, bc5, r8, rg8, rgb8, rgba8, rgba32f, colorlu (require %d x %d image)\n", colorLookupImageSize*colorLookupImageSize, colorLookupImageSize);
+		printf("Supported formats: bc1, bc3, bc5, bc6h, bc7, r8, rg8, rgb8, rgba8, rgba32f, colorlu (require %d x %d image)\n", colorLookupImageSize*colorLookupImageSize, colorLookupImageSize);
+		printf("BC6H and BC7 quality: -fast, -high (default is normal)\n");
+		printf("TextureConverter file_name -benchmark: reports BC6H and BC7 throughput and PSNR\n");
+		printf("TextureConverter file_name -benchmarkload: reports texture load throughput on a synthetic texture set\n");
 	}
     return 0;
 }
@@ -0,0 +1,344 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/VectorMath.h"
+#include "../GameEngineCore/AssetStreamer.h"
+#include <atomic>
+#include <thread>
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    // records the order in which the I/O thread reads assets
+    class ReadLog
+    {
+    public:
+        std::mutex mutex;
+        List<int> ids;
+    };
+
+    class FakeAsset : public StreamingAsset
+    {
+    public:
+        int Id = 0;
+        int Size = 0;
+        Vec3 Position;
+        bool FailRead = false;
+        std::atomic<bool> * Gate = nullptr; // Read() blocks until the gate opens
+        std::atomic<bool> ReadStarted{ false };
+        ReadLog * Log = nullptr;
+        List<unsigned char> Staging;
+        int DecodedChecksum = 0, ResidentChecksum = 0;
+    protected:
+        virtual bool Read() override
+        {
+            ReadStarted = true;
+            if (Gate)
+            {
+                while (!*Gate)
+                    std::this_thread::yield();
+            }
+            if (Log)
+            {
+                std::lock_guard<std::mutex> lock(Log->mutex);
+                Log->ids.Add(Id);
+            }
+            if (FailRead)
+                return false;
+            Staging.SetSize(Size);
+            for (int i = 0; i < Size; i++)
+                Staging[i] = (unsigned char)(Id + i);
+            return true;
+        }
+        virtual bool Decode() override
+        {
+            DecodedChecksum = 0;
+            for (auto b : Staging)
+                DecodedChecksum += b;
+            return true;
+        }
+        virtual void MakeResident() override
+        {
+            ResidentChecksum = DecodedChecksum;
+            Staging = List<unsigned char>();
+        }
+        virtual void Evict() override
+        {
+            ResidentChecksum = 0;
+        }
+        virtual void DiscardStaging() override
+        {
+            Staging = List<unsigned char>();
+        }
+    public:
+        virtual size_t GetStagingSize() override
+        {
+            return Staging.Count();
+        }
+        virtual size_t GetCpuResidentSize() override
+        {
+            return 0;
+        }
+        virtual size_t GetGpuResidentSize() override
+        {
+            return Size;
+        }
+        int ExpectedChecksum()
+        {
+            int rs = 0;
+            for (int i = 0; i < Size; i++)
+                rs += (unsigned char)(Id + i);
+            return rs;
+        }
+    };
+
+    TEST_CLASS(AssetStreamerTest)
+    {
+    private:
+        static RefPtr<FakeAsset> CreateAsset(int id, int size)
+        {
+            RefPtr<FakeAsset> asset = new FakeAsset();
+            asset->Id = id;
+            asset->Size = size;
+            return asset;
+        }
+        // occupies the only I/O thread until `gate` opens, so that the requests made meanwhile are queued
+        static void BlockReader(AssetStreamer & streamer, FakeAsset * blocker, std::atomic<bool> & gate)
+        {
+            blocker->Gate = &gate;
+            streamer.Request(blocker, 1e10f);
+            while (!blocker->ReadStarted)
+                std::this_thread::yield();
+        }
+    public:
+        TEST_METHOD(LoadsInPriorityOrder)
+        {
+            StreamingSettings settings;
+            settings.IoThreads = 1;
+            AssetStreamer streamer(settings);
+            ReadLog log;
+            std::atomic<bool> gate{ false };
+            auto blocker = CreateAsset(-1, 16);
+            BlockReader(streamer, blocker.Ptr(), gate);
+            List<RefPtr<FakeAsset>> assets;
+            Random random(17);
+            for (int i = 0; i < 32; i++)
+            {
+                auto asset = CreateAsset(i, 64);
+                asset->Log = &log;
+                streamer.Request(asset.Ptr(), (float)random.Next(0, 1000));
+                assets.Add(asset);
+            }
+            // re-prioritize an asset while it is queued
+            streamer.Request(assets[5].Ptr(), 5000.0f);
+            Assert::AreEqual(32, streamer.GetStats().QueueDepth);
+            gate = true;
+            streamer.Flush();
+            Assert::AreEqual(assets.Count(), log.ids.Count());
+            Assert::AreEqual(5, log.ids[0]);
+            for (auto & asset : assets)
+                Assert::IsTrue(asset->IsResident() && asset->ResidentChecksum == asset->ExpectedChecksum());
+            for (int i = 1; i < log.ids.Count() - 1; i++)
+            {
+                // requests are served in decreasing priority order
+                float p0 = 0.0f, p1 = 0.0f;
+                Random replay(17);
+                for (int j = 0; j < 32; j++)
+                {
+                    float p = (float)replay.Next(0, 1000);
+                    if (j == log.ids[i]) p0 = p;
+                    if (j == log.ids[i + 1]) p1 = p;
+                }
+                Assert::IsTrue(p0 >= p1);
+            }
+            auto stats = streamer.GetStats();
+            Assert::AreEqual(0, stats.QueueDepth);
+            Assert::AreEqual(0, stats.LoadsInFlight);
+            Assert::IsTrue(stats.BytesInFlight == 0);
+            Assert::AreEqual(33, stats.Loads);
+            streamer.Clear();
+        }
+
+        TEST_METHOD(EvictsLeastRecentlyUsed)
+        {
+            StreamingSettings settings;
+            settings.GpuBudget = 300;
+            AssetStreamer streamer(settings);
+            auto a = CreateAsset(0, 100), b = CreateAsset(1, 100), c = CreateAsset(2, 100), d = CreateAsset(3, 100);
+            streamer.Request(a.Ptr(), 1.0f);
+            streamer.Request(b.Ptr(), 1.0f);
+            streamer.Request(c.Ptr(), 1.0f);
+            streamer.Flush();
+            streamer.Update();
+            Assert::IsTrue(a->IsResident() && b->IsResident() && c->IsResident());
+            streamer.Request(b.Ptr(), 1.0f);
+            streamer.Update();
+            streamer.Request(c.Ptr(), 1.0f);
+            streamer.Update();
+            streamer.Request(a.Ptr(), 1.0f);
+            streamer.Update();
+            streamer.Request(d.Ptr(), 1.0f);
+            streamer.Flush();
+            Assert::IsFalse(b->IsResident());
+            Assert::IsTrue(a->IsResident() && c->IsResident() && d->IsResident());
+            Assert::AreEqual(0, b->ResidentChecksum);
+            auto stats = streamer.GetStats();
+            Assert::AreEqual(1, stats.Evictions);
+            Assert::IsTrue(stats.ResidentGpuBytes == 300);
+            // assets in use are kept even if the budget does not allow them
+            streamer.Request(a.Ptr(), 1.0f);
+            streamer.Request(b.Ptr(), 1.0f);
+            streamer.Request(c.Ptr(), 1.0f);
+            streamer.Request(d.Ptr(), 1.0f);
+            streamer.Flush();
+            Assert::IsFalse(b->IsResident());
+            Assert::AreEqual(1, streamer.GetStats().LoadsInFlight);
+            streamer.Clear();
+            stats = streamer.GetStats();
+            Assert::AreEqual(0, stats.ResidentAssets);
+            Assert::AreEqual(0, stats.LoadsInFlight);
+            Assert::IsTrue(stats.ResidentGpuBytes == 0 && stats.BytesInFlight == 0);
+        }
+
+        TEST_METHOD(CancelsStaleRequests)
+        {
+            StreamingSettings settings;
+            settings.IoThreads = 1;
+            settings.CancelAfterFrames = 4;
+            AssetStreamer streamer(settings);
+            ReadLog log;
+            std::atomic<bool> gate{ false };
+            auto blocker = CreateAsset(-1, 16);
+            BlockReader(streamer, blocker.Ptr(), gate);
+            List<RefPtr<FakeAsset>> assets;
+            for (int i = 0; i < 5; i++)
+            {
+                assets.Add(CreateAsset(i, 16));
+                assets.Last()->Log = &log;
+                streamer.Request(assets.Last().Ptr(), 1.0f);
+            }
+            for (int i = 0; i < settings.CancelAfterFrames + 2; i++)
+            {
+                streamer.Request(blocker.Ptr(), 1.0f);
+                streamer.Update();
+            }
+            Assert::AreEqual(5, streamer.GetStats().Cancellations);
+            Assert::AreEqual(0, streamer.GetStats().QueueDepth);
+            gate = true;
+            streamer.Request(blocker.Ptr(), 1.0f);
+            streamer.Flush();
+            Assert::IsTrue(blocker->IsResident());
+            Assert::AreEqual(0, log.ids.Count());
+            for (auto & asset : assets)
+                Assert::IsFalse(asset->IsResident());
+            // a cancelled asset can be requested again
+            streamer.Request(assets[0].Ptr(), 1.0f);
+            streamer.Flush();
+            Assert::IsTrue(assets[0]->IsResident());
+            streamer.Clear();
+        }
+
+        TEST_METHOD(FailedLoadKeepsPlaceholder)
+        {
+            AssetStreamer streamer;
+            auto asset = CreateAsset(0, 16);
+            asset->FailRead = true;
+            streamer.Request(asset.Ptr(), 1.0f);
+            streamer.Flush();
+            streamer.Update();
+            Assert::IsFalse(asset->IsResident());
+            auto stats = streamer.GetStats();
+            Assert::AreEqual(1, stats.Failures);
+            Assert::AreEqual(0, stats.LoadsInFlight);
+            // failed assets are not retried
+            streamer.Request(asset.Ptr(), 1.0f);
+            Assert::AreEqual(0, streamer.GetStats().QueueDepth);
+            streamer.Remove(asset.Ptr());
+            streamer.Clear();
+        }
+
+        // Headless fly-through: a camera crosses a large grid of assets and requests the ones within its
+        // view radius every frame, closest first. Assets that are not resident yet would show a placeholder.
+        TEST_METHOD(FlyThroughSyntheticScene)
+        {
+            const int gridSize = 64;
+            const float cellSize = 10.0f, viewRadius = 45.0f;
+            const int assetSize = 4096;
+            StreamingSettings settings;
+            settings.IoThreads = 2;
+            settings.DecodeThreads = 2;
+            settings.GpuBudget = 160 * assetSize;
+            settings.CommitBytesPerFrame = 8 * assetSize;
+            AssetStreamer streamer(settings);
+            List<RefPtr<FakeAsset>> assets;
+            for (int z = 0; z < gridSize; z++)
+                for (int x = 0; x < gridSize; x++)
+                {
+                    auto asset = CreateAsset(z * gridSize + x, assetSize);
+                    asset->Position = Vec3::Create(x * cellSize, 0.0f, z * cellSize);
+                    assets.Add(asset);
+                }
+            int placeholderFrames = 0;
+            size_t maxBytesInFlight = 0;
+            List<FakeAsset*> visible;
+            auto requestVisible = [&](Vec3 cameraPos)
+            {
+                visible.Clear();
+                for (auto & asset : assets)
+                {
+                    float dist = (asset->Position - cameraPos).Length();
+                    if (dist < viewRadius)
+                    {
+                        streamer.Request(asset.Ptr(), -dist);
+                        visible.Add(asset.Ptr());
+                    }
+                }
+            };
+            const int frameCount = 400;
+            for (int frameId = 0; frameId < frameCount; frameId++)
+            {
+                float t = frameId / (float)(frameCount - 1);
+                auto cameraPos = Vec3::Create(t * (gridSize - 1) * cellSize, 5.0f, (0.25f + 0.5f * t) * (gridSize - 1) * cellSize);
+                requestVisible(cameraPos);
+                for (auto asset : visible)
+                {
+                    if (!asset->IsResident())
+                    {
+                        placeholderFrames++;
+                        break;
+                    }
+                }
+                streamer.Update();
+                auto stats = streamer.GetStats();
+                Assert::IsTrue(stats.ResidentGpuBytes <= settings.GpuBudget);
+                maxBytesInFlight = Math::Max(maxBytesInFlight, stats.BytesInFlight);
+            }
+            // hover at the end of the path until everything in view is loaded
+            auto endPos = Vec3::Create((gridSize - 1) * cellSize, 5.0f, 0.75f * (gridSize - 1) * cellSize);
+            requestVisible(endPos);
+            streamer.Flush();
+            for (auto asset : visible)
+            {
+                Assert::IsTrue(asset->IsResident());
+                Assert::AreEqual(asset->ExpectedChecksum(), asset->ResidentChecksum);
+            }
+            auto stats = streamer.GetStats();
+            Assert::IsTrue(stats.ResidentGpuBytes <= settings.GpuBudget);
+            Assert::IsTrue(stats.Evictions > 0);
+            Assert::IsTrue(stats.Loads > stats.ResidentAssets);
+            Assert::IsTrue(placeholderFrames > 0);
+            Assert::IsTrue(maxBytesInFlight <= (size_t)assets.Count() * assetSize);
+            streamer.Clear();
+            stats = streamer.GetStats();
+            Assert::AreEqual(0, stats.ResidentAssets);
+            Assert::AreEqual(0, stats.QueueDepth);
+            Assert::AreEqual(0, stats.LoadsInFlight);
+            Assert::IsTrue(stats.BytesInFlight == 0 && stats.ResidentGpuBytes == 0);
+            for (auto & asset : assets)
+                Assert::IsTrue(!asset->IsResident() && asset->Staging.Count() == 0);
+        }
+    };
+}
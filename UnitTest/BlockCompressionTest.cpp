@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/BlockCompression.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+    TEST_CLASS(BlockCompressionTest)
+    {
+    private:
+        static void SmoothBlock(Random & random, unsigned char * texels, bool opaque)
+        {
+            int base[4], dx[4], dy[4];
+            for (int c = 0; c < 4; c++)
+            {
+                base[c] = random.Next(0, 160);
+                dx[c] = random.Next(0, 20);
+                dy[c] = random.Next(0, 20);
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 4; c++)
+                    texels[i * 4 + c] = (unsigned char)(base[c] + dx[c] * (i & 3) + dy[c] * (i >> 2));
+                if (opaque)
+                    texels[i * 4 + 3] = 255;
+            }
+        }
+        static int SquaredError(const unsigned char * a, const unsigned char * b)
+        {
+            int error = 0;
+            for (int i = 0; i < 64; i++)
+                error += (a[i] - b[i]) * (a[i] - b[i]);
+            return error;
+        }
+        static double Psnr(double squaredError, int samples)
+        {
+            return 10.0 * log10(255.0 * 255.0 * samples / Math::Max(squaredError, 1e-9));
+        }
+    public:
+        TEST_METHOD(BC7SolidColor)
+        {
+            Random random(3);
+            for (int b = 0; b < 64; b++)
+            {
+                unsigned char texels[64], decoded[64], block[16];
+                unsigned char color[4] = { (unsigned char)random.Next(0, 256), (unsigned char)random.Next(0, 256),
+                    (unsigned char)random.Next(0, 256), (unsigned char)(b & 1 ? 255 : random.Next(0, 256)) };
+                for (int i = 0; i < 16; i++)
+                    memcpy(texels + i * 4, color, 4);
+                for (int q = 0; q < 3; q++)
+                {
+                    CompressBlock_BC7(block, texels, (TextureCompressionQuality)q);
+                    DecompressBlock_BC7(decoded, block);
+                    // a p-bit is shared by all channels of an endpoint, so single colors may be off by one
+                    for (int i = 0; i < 64; i++)
+                        Assert::IsTrue(abs(texels[i] - decoded[i]) <= 1);
+                }
+            }
+        }
+        TEST_METHOD(BC7RoundTrip)
+        {
+            Random random(7);
+            double error[3] = {};
+            for (int b = 0; b < 256; b++)
+            {
+                unsigned char texels[64], decoded[64], block[16];
+                SmoothBlock(random, texels, (b & 1) == 0);
+                // a sharp edge through every other block favours the two subset modes
+                if (b & 2)
+                {
+                    for (int i = 0; i < 16; i++)
+                    {
+                        if ((i & 3) >= 2)
+                            texels[i * 4 + 1] = (unsigned char)(255 - texels[i * 4 + 1]);
+                    }
+                }
+                int blockError[3];
+                for (int q = 0; q < 3; q++)
+                {
+                    CompressBlock_BC7(block, texels, (TextureCompressionQuality)q);
+                    DecompressBlock_BC7(decoded, block);
+                    blockError[q] = SquaredError(texels, decoded);
+                    error[q] += blockError[q];
+                }
+                // higher qualities only ever replace an encoding with a better one
+                Assert::IsTrue(blockError[1] <= blockError[0]);
+                Assert::IsTrue(blockError[2] <= blockError[0]);
+            }
+            Assert::IsTrue(Psnr(error[0], 256 * 64) > 28.0);
+            Assert::IsTrue(Psnr(error[1], 256 * 64) > 34.0);
+            Assert::IsTrue(Psnr(error[2], 256 * 64) > 34.0);
+        }
+        TEST_METHOD(BC6HRoundTrip)
+        {
+            Random random(5);
+            const float split[2][3] = { { 0.2f, 0.4f, 0.6f }, { 1.0f, 0.3f, 0.1f } };
+            double error[3] = {};
+            for (int b = 0; b < 256; b++)
+            {
+                float texels[48], decoded[48];
+                unsigned char block[16];
+                float base = random.NextFloat(0.01f, 1000.0f);
+                for (int i = 0; i < 16; i++)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        if (b & 1)
+                            texels[i * 3 + c] = base * (1.0f + 0.1f * (i & 3) + 0.05f * c);
+                        else
+                            texels[i * 3 + c] = base * split[(i & 3) >> 1][c] * (1.0f + 0.1f * (i >> 2));
+                    }
+                }
+                for (int q = 0; q < 3; q++)
+                {
+                    CompressBlock_BC6H(block, texels, (TextureCompressionQuality)q);
+                    DecompressBlock_BC6H(decoded, block);
+                    float maxError = 0.0f;
+                    for (int i = 0; i < 48; i++)
+                    {
+                        float relativeError = fabsf(decoded[i] - texels[i]) / texels[i];
+                        maxError = Math::Max(maxError, relativeError);
+                        error[q] += relativeError;
+                    }
+                    // the single region mode cannot follow two unrelated colors
+                    if ((b & 1) || q != 0)
+                        Assert::IsTrue(maxError < 0.15f);
+                }
+            }
+            // the two region modes fit the split blocks better than the single region mode
+            Assert::IsTrue(error[1] < error[0] * 0.8);
+            Assert::IsTrue(error[2] <= error[1]);
+        }
+        TEST_METHOD(BC6HClampsInput)
+        {
+            float texels[48], decoded[48];
+            unsigned char block[16];
+            for (int i = 0; i < 48; i++)
+                texels[i] = i & 1 ? -1.0f : 1e6f;
+            CompressBlock_BC6H(block, texels, TextureCompressionQuality::Normal);
+            DecompressBlock_BC6H(decoded, block);
+            for (int i = 0; i < 48; i++)
+                Assert::IsTrue(decoded[i] >= 0.0f && decoded[i] <= 65504.0f);
+        }
+    };
+}
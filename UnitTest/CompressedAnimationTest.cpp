@@ -0,0 +1,252 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/CompressedAnimation.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(CompressedAnimationTest)
+    {
+    private:
+        static float RotationAngle(const Quaternion & q0, Quaternion q1)
+        {
+            auto a = q0 * (1.0f / q0.Length());
+            q1 = q1 * (1.0f / q1.Length());
+            if (Quaternion::Dot(a, q1) < 0.0f)
+                q1 = -q1;
+            return 4.0f * asinf(Math::Min(1.0f, (a - q1).Length() * 0.5f));
+        }
+        template<typename TFunc>
+        static AnimationChannel CreateChannel(const char * name, float duration, float fps, const TFunc & f)
+        {
+            AnimationChannel channel;
+            channel.BoneName = name;
+            int frameCount = (int)(duration * fps + 0.5f) + 1;
+            for (int i = 0; i < frameCount; i++)
+            {
+                AnimationKeyFrame keyFrame;
+                keyFrame.Time = i / fps;
+                keyFrame.Transform = f(keyFrame.Time);
+                channel.KeyFrames.Add(keyFrame);
+            }
+            return channel;
+        }
+        // a constant bone, a bone sliding along a line, a swinging limb with a bobbing root and a noisy bone
+        static SkeletalAnimation CreateAnimation(float duration = 2.0f, float fps = 30.0f)
+        {
+            SkeletalAnimation anim;
+            anim.Name = "test";
+            anim.Speed = 1.0f;
+            anim.Duration = duration;
+            anim.FPS = fps;
+            anim.Channels.Add(CreateChannel("static", duration, fps, [](float)
+            {
+                BoneTransformation t;
+                t.Rotation = Quaternion::FromAxisAngle(Vec3::Create(0.0f, 1.0f, 0.0f), 0.3f);
+                t.Translation = Vec3::Create(1.0f, 2.0f, 3.0f);
+                return t;
+            }));
+            anim.Channels.Add(CreateChannel("slide", duration, fps, [](float time)
+            {
+                BoneTransformation t;
+                t.Translation = Vec3::Create(time * 10.0f, 0.0f, -time * 4.0f);
+                return t;
+            }));
+            anim.Channels.Add(CreateChannel("swing", duration, fps, [](float time)
+            {
+                BoneTransformation t;
+                t.Rotation = Quaternion::FromAxisAngle(Vec3::Create(1.0f, 0.0f, 0.0f), sinf(time * 5.0f) * 1.2f) *
+                    Quaternion::FromAxisAngle(Vec3::Create(0.0f, 0.0f, 1.0f), time);
+                t.Translation = Vec3::Create(0.0f, 90.0f + sinf(time * 7.0f) * 3.0f, 0.0f);
+                t.Scale = Vec3::Create(1.0f + 0.1f * sinf(time * 2.0f), 1.0f, 1.0f);
+                return t;
+            }));
+            Random random(3);
+            anim.Channels.Add(CreateChannel("noise", duration, fps, [&](float)
+            {
+                BoneTransformation t;
+                auto axis = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), 1.0f).Normalize();
+                t.Rotation = Quaternion::FromAxisAngle(axis, random.NextFloat(-3.0f, 3.0f));
+                t.Translation = Vec3::Create(random.NextFloat(-20.0f, 20.0f), random.NextFloat(-20.0f, 20.0f), random.NextFloat(-20.0f, 20.0f));
+                return t;
+            }));
+            BlendShapeAnimationChannel blendShape;
+            blendShape.Name = "smile";
+            for (int i = 0; i < 7; i++)
+            {
+                BlendShapeAnimationKeyFrame keyFrame;
+                keyFrame.Time = i * duration / 6.0f;
+                keyFrame.Weight = (i & 1) ? 1.0f : 0.0f;
+                blendShape.KeyFrames.Add(keyFrame);
+            }
+            anim.BlendShapeChannels.Add(blendShape);
+            return anim;
+        }
+        static void CheckClipMatchesSource(SkeletalAnimation & anim, CompressedAnimationClip * clip, const AnimationCompressionSettings & settings)
+        {
+            CompressedAnimationCursor cursor(clip);
+            List<BoneTransformation> decoded;
+            decoded.SetSize(clip->Tracks.Count());
+            for (int f = 0; f <= (int)(anim.Duration * anim.FPS + 0.5f); f++)
+            {
+                float time = f / anim.FPS;
+                cursor.SampleTracks(time, decoded.Buffer());
+                for (int i = 0; i < decoded.Count(); i++)
+                {
+                    auto expected = anim.Channels[i].Sample(time);
+                    Assert::IsTrue(RotationAngle(expected.Rotation, decoded[i].Rotation) <= settings.RotationTolerance * 1.01f);
+                    Assert::IsTrue((expected.Translation - decoded[i].Translation).Length() <= settings.TranslationTolerance * 1.01f);
+                    Assert::IsTrue((expected.Scale - decoded[i].Scale).Length() <= settings.ScaleTolerance * 1.01f);
+                }
+            }
+        }
+    public:
+        TEST_METHOD(RemovesConstantAndLinearTracks)
+        {
+            auto anim = CreateAnimation();
+            AnimationCompressionStats stats;
+            auto clip = AnimationCompressor::Compress(anim, AnimationCompressionSettings(), &stats);
+            Assert::AreEqual(4, clip->Tracks.Count());
+            auto & staticTrack = clip->Tracks[0];
+            Assert::IsTrue(staticTrack.RotationFormat == AnimationTrackFormat::Constant);
+            Assert::IsTrue(staticTrack.TranslationFormat == AnimationTrackFormat::Constant);
+            Assert::IsTrue(staticTrack.ScaleFormat == AnimationTrackFormat::Constant);
+            auto & slideTrack = clip->Tracks[1];
+            Assert::IsTrue(slideTrack.RotationFormat == AnimationTrackFormat::Constant);
+            Assert::IsTrue(slideTrack.TranslationFormat == AnimationTrackFormat::Linear);
+            auto & swingTrack = clip->Tracks[2];
+            Assert::IsTrue(swingTrack.RotationFormat == AnimationTrackFormat::Quantized);
+            Assert::IsTrue(swingTrack.TranslationFormat == AnimationTrackFormat::Quantized);
+            Assert::IsTrue(swingTrack.ScaleFormat == AnimationTrackFormat::Quantized);
+            Assert::AreEqual(0, stats.RawTracks);
+            // three quantized components of the swing and two of the noise bone, 6 bytes each
+            Assert::AreEqual(30, clip->header.FrameStride);
+            Assert::IsTrue(stats.CompressedBytes * 3 < stats.SourceBytes);
+        }
+
+        TEST_METHOD(SamplingStaysWithinTolerance)
+        {
+            auto anim = CreateAnimation();
+            AnimationCompressionSettings settings;
+            AnimationCompressionStats stats;
+            auto clip = AnimationCompressor::Compress(anim, settings, &stats);
+            Assert::IsTrue(stats.MaxRotationError <= settings.RotationTolerance);
+            Assert::IsTrue(stats.MaxTranslationError <= settings.TranslationTolerance);
+            Assert::IsTrue(stats.MaxScaleError <= settings.ScaleTolerance);
+            CheckClipMatchesSource(anim, clip.Ptr(), settings);
+        }
+
+        TEST_METHOD(FallsBackToRawKeysForTightTolerance)
+        {
+            auto anim = CreateAnimation();
+            AnimationCompressionSettings settings;
+            settings.TranslationTolerance = 1e-5f;
+            AnimationCompressionStats stats;
+            auto clip = AnimationCompressor::Compress(anim, settings, &stats);
+            // the noise bone spans 40 units, which 16 bits cannot resolve to 1e-5
+            Assert::IsTrue(clip->Tracks[3].TranslationFormat == AnimationTrackFormat::Raw);
+            Assert::IsTrue(stats.RawTracks > 0);
+            Assert::IsTrue(stats.MaxTranslationError <= settings.TranslationTolerance);
+        }
+
+        TEST_METHOD(CursorMatchesRandomAccess)
+        {
+            auto anim = CreateAnimation(3.1f);
+            AnimationCompressionSettings settings;
+            settings.SegmentLength = 8;
+            auto clip = AnimationCompressor::Compress(anim, settings);
+            Assert::IsTrue(clip->GetSegmentCount() > 1);
+            CompressedAnimationCursor playback(clip.Ptr());
+            List<BoneTransformation> sequential, random;
+            sequential.SetSize(clip->Tracks.Count());
+            random.SetSize(clip->Tracks.Count());
+            for (float time = 0.0f; time < anim.Duration; time += 1.0f / 75.0f)
+            {
+                playback.SampleTracks(time, sequential.Buffer());
+                CompressedAnimationCursor fresh(clip.Ptr());
+                fresh.SampleTracks(time, random.Buffer());
+                for (int i = 0; i < sequential.Count(); i++)
+                {
+                    Assert::IsTrue(RotationAngle(sequential[i].Rotation, random[i].Rotation) < 1e-5f);
+                    Assert::IsTrue((sequential[i].Translation - random[i].Translation).Length() < 1e-5f);
+                }
+                Assert::AreEqual(anim.BlendShapeChannels[0].Sample(time), playback.SampleBlendShape(0, time));
+            }
+            // wrapping around restarts the key search
+            Assert::AreEqual(anim.BlendShapeChannels[0].Sample(0.1f), playback.SampleBlendShape(0, 0.1f));
+        }
+
+        TEST_METHOD(PoseUsesSkeletonBoneMapping)
+        {
+            auto anim = CreateAnimation();
+            auto clip = AnimationCompressor::Compress(anim);
+            Skeleton skeleton;
+            const char * names[] = { "root", "swing", "unused", "static" };
+            for (int i = 0; i < 4; i++)
+            {
+                Bone bone;
+                bone.ParentId = i - 1;
+                bone.Name = names[i];
+                skeleton.Bones.Add(bone);
+                skeleton.BoneMapping[bone.Name] = i;
+            }
+            Pose pose;
+            pose.Transforms.SetSize(4);
+            CompressedAnimationCursor cursor(clip.Ptr());
+            cursor.GetPose(pose, &skeleton, 0.5f);
+            auto swing = anim.Channels[2].Sample(0.5f);
+            Assert::IsTrue(RotationAngle(pose.Transforms[1].Rotation, swing.Rotation) < 0.002f);
+            Assert::IsTrue((pose.Transforms[3].Translation - Vec3::Create(1.0f, 2.0f, 3.0f)).Length() < 1e-4f);
+            Assert::IsTrue(pose.Transforms[0].Translation.Length() == 0.0f);
+            Assert::IsTrue(pose.BlendShapeWeights.ContainsKey("smile"));
+        }
+
+        TEST_METHOD(SerializedClipSamplesIdentically)
+        {
+            auto anim = CreateAnimation();
+            auto clip = AnimationCompressor::Compress(anim);
+            RefPtr<MemoryStream> writeStream = new MemoryStream();
+            clip->SaveToStream(writeStream.Ptr());
+            RefPtr<MemoryStream> readStream = new MemoryStream((unsigned char*)writeStream->GetBuffer(), (int)writeStream->GetPosition());
+            CompressedAnimationClip loaded;
+            loaded.LoadFromStream(readStream.Ptr());
+            Assert::IsTrue(readStream->IsEnd());
+            Assert::AreEqual(clip->Tracks.Count(), loaded.Tracks.Count());
+            Assert::AreEqual(clip->SegmentData.Count(), loaded.SegmentData.Count());
+            CompressedAnimationCursor c0(clip.Ptr()), c1(&loaded);
+            BoneTransformation t0[4], t1[4];
+            for (float time = 0.0f; time < anim.Duration; time += 0.07f)
+            {
+                c0.SampleTracks(time, t0);
+                c1.SampleTracks(time, t1);
+                for (int i = 0; i < 4; i++)
+                    Assert::IsTrue(memcmp(&t0[i], &t1[i], sizeof(BoneTransformation)) == 0);
+            }
+        }
+        TEST_METHOD(ReloadsClipsEndingOnSegmentBoundary)
+        {
+            // the last frame of these clips is the shared first frame of a segment that is never written
+            AnimationCompressionSettings settings;
+            for (int segments : { 1, 2, 6 })
+            {
+                int frameCount = segments * settings.SegmentLength + 1;
+                auto anim = CreateAnimation((frameCount - 1) / 30.0f, 30.0f);
+                auto clip = AnimationCompressor::Compress(anim, settings);
+                Assert::AreEqual(frameCount, clip->header.FrameCount);
+                Assert::AreEqual(segments, clip->GetSegmentCount());
+                RefPtr<MemoryStream> writeStream = new MemoryStream();
+                clip->SaveToStream(writeStream.Ptr());
+                RefPtr<MemoryStream> readStream = new MemoryStream((unsigned char*)writeStream->GetBuffer(), (int)writeStream->GetPosition());
+                CompressedAnimationClip loaded;
+                loaded.LoadFromStream(readStream.Ptr());
+                Assert::AreEqual(segments, loaded.GetSegmentCount());
+                CheckClipMatchesSource(anim, &loaded, settings);
+            }
+        }
+    };
+}
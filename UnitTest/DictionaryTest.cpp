@@ -0,0 +1,295 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/PerformanceCounter.h"
+#include <stdio.h>
+#include <unordered_map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+
+namespace UnitTest
+{
+    TEST_CLASS(DictionaryTest)
+    {
+    private:
+        static unsigned int NextRandom(unsigned int & state)
+        {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        }
+        template<typename DictType>
+        static void RunRandomOperations(int keyRange, int keyStride)
+        {
+            DictType dict;
+            List<int> reference;
+            reference.SetSize(keyRange);
+            for (int i = 0; i < keyRange; i++)
+                reference[i] = -1;
+            int count = 0;
+            unsigned int state = 7;
+            for (int step = 0; step < 200000; step++)
+            {
+                int k = NextRandom(state) % keyRange;
+                int key = k * keyStride;
+                int op = NextRandom(state) % 4;
+                if (op == 0)
+                {
+                    bool added = dict.AddIfNotExists(key, step);
+                    Assert::AreEqual(reference[k] == -1, added);
+                    if (added)
+                    {
+                        reference[k] = step;
+                        count++;
+                    }
+                }
+                else if (op == 1)
+                {
+                    dict[key] = step;
+                    if (reference[k] == -1)
+                        count++;
+                    reference[k] = step;
+                }
+                else if (op == 2)
+                {
+                    dict.Remove(key);
+                    if (reference[k] != -1)
+                        count--;
+                    reference[k] = -1;
+                }
+                else
+                {
+                    int value = 0;
+                    bool found = dict.TryGetValue(key, value);
+                    Assert::AreEqual(reference[k] != -1, found);
+                    if (found)
+                        Assert::AreEqual(reference[k], value);
+                }
+                Assert::AreEqual(count, dict.Count());
+            }
+            int visited = 0;
+            for (auto & kv : dict)
+            {
+                Assert::AreEqual(reference[kv.Key / keyStride], kv.Value);
+                visited++;
+            }
+            Assert::AreEqual(count, visited);
+        }
+    public:
+        TEST_METHOD(RandomOperationsMatchReference)
+        {
+            RunRandomOperations<Dictionary<int, int>>(1000, 1);
+            RunRandomOperations<EnumerableDictionary<int, int>>(1000, 1);
+        }
+        TEST_METHOD(KeysDifferingInHighBits)
+        {
+            // keys that only differ above the low 20 bits, like aligned pointers
+            RunRandomOperations<Dictionary<int, int>>(2000, 1 << 20);
+            RunRandomOperations<EnumerableDictionary<int, int>>(2000, 1 << 20);
+        }
+        TEST_METHOD(StringKeys)
+        {
+            Dictionary<String, int> dict;
+            for (int i = 0; i < 5000; i++)
+                dict.Add(String("asset_") + String(i), i);
+            for (int i = 0; i < 5000; i += 2)
+                dict.Remove(String("asset_") + String(i));
+            Assert::AreEqual(2500, dict.Count());
+            for (int i = 0; i < 5000; i++)
+            {
+                int value = -1;
+                bool found = dict.TryGetValue(String("asset_") + String(i), value);
+                Assert::AreEqual(i % 2 == 1, found);
+                if (found)
+                    Assert::AreEqual(i, value);
+            }
+            Assert::IsTrue(dict.ContainsKey(String("asset_4999")));
+            Assert::IsFalse(dict.ContainsKey(String("asset_5000")));
+        }
+        TEST_METHOD(EnumerationFollowsInsertionOrder)
+        {
+            EnumerableDictionary<int, int> dict;
+            for (int i = 0; i < 100; i++)
+                dict.Add(i * 7919, i);
+            for (int i = 0; i < 100; i += 3)
+                dict.Remove(i * 7919);
+            // replacing a value moves the entry to the end, like a removal followed by an insertion
+            dict[7919] = 1000;
+            dict.Add(-1, 2000);
+            List<int> values;
+            for (auto & kv : dict)
+                values.Add(kv.Value);
+            Assert::AreEqual(dict.Count(), values.Count());
+            int expected = 2;
+            for (int i = 0; i < values.Count() - 2; i++)
+            {
+                Assert::AreEqual(expected, values[i]);
+                expected += (expected % 3 == 1) ? 1 : 2;
+            }
+            Assert::AreEqual(1000, values[values.Count() - 2]);
+            Assert::AreEqual(2000, values.Last());
+            Assert::AreEqual(2, dict.First().Value);
+            Assert::AreEqual(2000, dict.Last().Value);
+            dict.Remove(-1);
+            Assert::AreEqual(1000, dict.Last().Value);
+        }
+        TEST_METHOD(RemoveWhileEnumerating)
+        {
+            EnumerableHashSet<int> set;
+            for (int i = 0; i < 1000; i++)
+                set.Add(i);
+            int visited = 0;
+            for (auto & item : set)
+            {
+                if (item % 2 == 0)
+                    set.Remove(item);
+                visited++;
+            }
+            Assert::AreEqual(1000, visited);
+            Assert::AreEqual(500, set.Count());
+            for (int i = 0; i < 1000; i++)
+                Assert::AreEqual(i % 2 == 1, set.Contains(i));
+            // compaction of the removed entries keeps the order
+            for (int i = 1000; i < 3000; i++)
+                set.Add(i);
+            int previous = -1;
+            for (auto & item : set)
+            {
+                Assert::IsTrue(item > previous);
+                previous = item;
+            }
+        }
+        TEST_METHOD(CopyMoveAndClear)
+        {
+            Dictionary<int, String> dict;
+            EnumerableDictionary<int, String> ordered;
+            for (int i = 0; i < 300; i++)
+            {
+                dict[i] = String(i);
+                ordered[i] = String(i);
+            }
+            auto dictCopy = dict;
+            auto orderedCopy = ordered;
+            dict.Remove(5);
+            ordered.Remove(5);
+            Assert::AreEqual(300, dictCopy.Count());
+            Assert::AreEqual(300, orderedCopy.Count());
+            Assert::IsTrue(dictCopy[5].GetValue() == "5");
+            Assert::IsTrue(orderedCopy[5].GetValue() == "5");
+            auto dictMoved = _Move(dictCopy);
+            auto orderedMoved = _Move(orderedCopy);
+            Assert::AreEqual(0, dictCopy.Count());
+            Assert::AreEqual(0, orderedCopy.Count());
+            Assert::AreEqual(300, dictMoved.Count());
+            Assert::AreEqual(300, orderedMoved.Count());
+            dictMoved.Clear();
+            orderedMoved.Clear();
+            Assert::AreEqual(0, dictMoved.Count());
+            Assert::IsFalse(dictMoved.ContainsKey(1));
+            Assert::IsFalse(orderedMoved.ContainsKey(1));
+            Assert::IsTrue(dictMoved.begin() == dictMoved.end());
+            Assert::IsTrue(orderedMoved.begin() == orderedMoved.end());
+            dictMoved.Add(1, "a");
+            orderedMoved.Add(1, "a");
+            Assert::IsTrue(dictMoved[1].GetValue() == "a");
+            Assert::IsTrue(orderedMoved[1].GetValue() == "a");
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(HashTableBenchmark)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(HashTableBenchmark)
+        {
+            const int n = 1 << 20;
+            List<int> keys, missingKeys;
+            List<String> stringKeys, missingStringKeys;
+            unsigned int state = 1;
+            for (int i = 0; i < n; i++)
+            {
+                keys.Add((int)NextRandom(state) * 2);
+                missingKeys.Add(keys.Last() + 1);
+            }
+            for (int i = 0; i < n / 8; i++)
+            {
+                stringKeys.Add(String("Materials/Environment/rock_") + String(keys[i]) + ".material");
+                missingStringKeys.Add(String("Materials/Environment/rock_") + String(missingKeys[i]) + ".material");
+            }
+            char message[256];
+            auto report = [&](const char * name, double insert, double hit, double miss, double iterate, int count)
+            {
+                snprintf(message, sizeof(message), "%s: insert %.1f ns, hit %.1f ns, miss %.1f ns, iterate %.2f ns per entry",
+                    name, insert * 1e9 / count, hit * 1e9 / count, miss * 1e9 / count, iterate * 1e9 / count);
+                Logger::WriteMessage(message);
+            };
+            int checksum = 0;
+            auto runCoreLib = [&](auto & dict, const char * name)
+            {
+                auto t0 = PerformanceCounter::Start();
+                for (int i = 0; i < n; i++)
+                    dict[keys[i]] = i;
+                double insert = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (int i = 0; i < n; i++)
+                    checksum += *dict.TryGetValue(keys[i]);
+                double hit = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (int i = 0; i < n; i++)
+                    checksum += dict.ContainsKey(missingKeys[i]) ? 1 : 0;
+                double miss = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (auto & kv : dict)
+                    checksum += kv.Value;
+                double iterate = PerformanceCounter::EndSeconds(t0);
+                report(name, insert, hit, miss, iterate, n);
+            };
+            Dictionary<int, int> dict;
+            runCoreLib(dict, "Dictionary<int, int>");
+            EnumerableDictionary<int, int> ordered;
+            runCoreLib(ordered, "EnumerableDictionary<int, int>");
+            {
+                std::unordered_map<int, int> stdMap;
+                auto t0 = PerformanceCounter::Start();
+                for (int i = 0; i < n; i++)
+                    stdMap[keys[i]] = i;
+                double insert = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (int i = 0; i < n; i++)
+                    checksum += stdMap.find(keys[i])->second;
+                double hit = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (int i = 0; i < n; i++)
+                    checksum += stdMap.count(missingKeys[i]) ? 1 : 0;
+                double miss = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (auto & kv : stdMap)
+                    checksum += kv.second;
+                double iterate = PerformanceCounter::EndSeconds(t0);
+                report("std::unordered_map<int, int>", insert, hit, miss, iterate, n);
+            }
+            {
+                Dictionary<String, int> stringDict;
+                int count = stringKeys.Count();
+                auto t0 = PerformanceCounter::Start();
+                for (int i = 0; i < count; i++)
+                    stringDict[stringKeys[i]] = i;
+                double insert = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (int i = 0; i < count; i++)
+                    checksum += *stringDict.TryGetValue(stringKeys[i]);
+                double hit = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (int i = 0; i < count; i++)
+                    checksum += stringDict.ContainsKey(missingStringKeys[i]) ? 1 : 0;
+                double miss = PerformanceCounter::EndSeconds(t0);
+                t0 = PerformanceCounter::Start();
+                for (auto & kv : stringDict)
+                    checksum += kv.Value;
+                double iterate = PerformanceCounter::EndSeconds(t0);
+                report("Dictionary<String, int>", insert, hit, miss, iterate, count);
+            }
+            snprintf(message, sizeof(message), "checksum %d", checksum);
+            Logger::WriteMessage(message);
+        }
+    };
+}
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/DynamicBvh.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(DynamicBvhTest)
+    {
+    private:
+        static Graphics::BBox RandomBox(Random & random)
+        {
+            Graphics::BBox box;
+            auto center = Vec3::Create(random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f));
+            auto extent = Vec3::Create(random.NextFloat(0.1f, 10.0f), random.NextFloat(0.1f, 10.0f), random.NextFloat(0.1f, 10.0f));
+            box.Min = center - extent;
+            box.Max = center + extent;
+            return box;
+        }
+        static CullFrustum RandomFrustum(Random & random)
+        {
+            Matrix4 view, proj, viewProj, invViewProj;
+            Matrix4::LookAt(view, Vec3::Create(random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f)),
+                Vec3::Create(0.0f, 0.0f, 0.0f), Vec3::Create(0.0f, 1.0f, 0.0f));
+            Matrix4::CreatePerspectiveMatrixFromViewAngle(proj, 60.0f, 1.5f, 1.0f, 150.0f, ClipSpaceType::ZeroToOne);
+            Matrix4::Multiply(viewProj, proj, view);
+            viewProj.Inverse(invViewProj);
+            return CullFrustum(invViewProj);
+        }
+        static bool RayHitsBox(const Graphics::BBox & box, Vec3 origin, Vec3 dir, float tMax, float & tEnter)
+        {
+            float tNear = 0.0f, tFar = tMax;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float invDir = 1.0f / dir[axis];
+                float t0 = (box.Min[axis] - origin[axis]) * invDir, t1 = (box.Max[axis] - origin[axis]) * invDir;
+                tNear = Math::Max(tNear, Math::Min(t0, t1));
+                tFar = Math::Min(tFar, Math::Max(t0, t1));
+            }
+            tEnter = tNear;
+            return tNear <= tFar;
+        }
+    public:
+        TEST_METHOD(MultiFrustumQueryMatchesBruteForce)
+        {
+            Random random(7);
+            DynamicBvh<int> tree;
+            List<Graphics::BBox> boxes;
+            List<int> leaves;
+            List<bool> alive;
+            for (int i = 0; i < 2000; i++)
+            {
+                boxes.Add(RandomBox(random));
+                leaves.Add(tree.Insert(i, boxes[i]));
+                alive.Add(true);
+            }
+            // mix of removals, reinsertions and small moves
+            for (int k = 0; k < 3000; k++)
+            {
+                int i = random.Next(0, boxes.Count());
+                if (!alive[i])
+                {
+                    boxes[i] = RandomBox(random);
+                    leaves[i] = tree.Insert(i, boxes[i]);
+                    alive[i] = true;
+                }
+                else if (k % 3 == 0)
+                {
+                    tree.Remove(leaves[i]);
+                    alive[i] = false;
+                }
+                else
+                {
+                    auto offset = Vec3::Create(random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f));
+                    boxes[i].Min += offset;
+                    boxes[i].Max += offset;
+                    tree.Move(leaves[i], boxes[i]);
+                }
+            }
+            List<CullFrustum> frustums;
+            for (int f = 0; f < 4; f++)
+                frustums.Add(RandomFrustum(random));
+            List<List<int>> visible;
+            visible.SetSize(frustums.Count());
+            tree.QueryFrustums(frustums.GetArrayView(), [&](int element, unsigned int partialMask, unsigned int insideMask)
+            {
+                for (int f = 0; f < frustums.Count(); f++)
+                {
+                    Assert::IsTrue(!((partialMask & insideMask) & (1u << f)));
+                    if ((insideMask & (1u << f)) || ((partialMask & (1u << f)) && frustums[f].IsBoxInFrustum(boxes[element])))
+                        visible[f].Add(element);
+                }
+            });
+            for (int f = 0; f < frustums.Count(); f++)
+            {
+                visible[f].Sort();
+                List<int> expected;
+                for (int i = 0; i < boxes.Count(); i++)
+                    if (alive[i] && frustums[f].IsBoxInFrustum(boxes[i]))
+                        expected.Add(i);
+                Assert::IsTrue(visible[f].Count() == expected.Count());
+                for (int i = 0; i < expected.Count(); i++)
+                    Assert::IsTrue(visible[f][i] == expected[i]);
+            }
+            // AVL style rotations keep the tree shallow
+            Assert::IsTrue(tree.GetHeight() < 3 * Math::Log2Ceil(tree.Count()));
+        }
+        TEST_METHOD(OverlapAndRayQueriesMatchBruteForce)
+        {
+            Random random(11);
+            DynamicBvh<int> tree;
+            // without a margin the fat boxes are the element boxes
+            tree.SetMarginRatio(0.0f);
+            List<Graphics::BBox> boxes;
+            for (int i = 0; i < 2000; i++)
+            {
+                boxes.Add(RandomBox(random));
+                tree.Insert(i, boxes[i]);
+            }
+            for (int q = 0; q < 50; q++)
+            {
+                auto query = RandomBox(random);
+                List<int> overlapping;
+                tree.QueryOverlap(query, [&](int element) { overlapping.Add(element); });
+                overlapping.Sort();
+                List<int> expected;
+                for (int i = 0; i < boxes.Count(); i++)
+                    if (boxes[i].Intersects(query))
+                        expected.Add(i);
+                Assert::IsTrue(overlapping.Count() == expected.Count());
+                for (int i = 0; i < expected.Count(); i++)
+                    Assert::IsTrue(overlapping[i] == expected[i]);
+
+                auto origin = Vec3::Create(random.NextFloat(-150.0f, 150.0f), random.NextFloat(-150.0f, 150.0f), random.NextFloat(-150.0f, 150.0f));
+                auto dir = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+                float closest = 400.0f;
+                tree.RayCast(origin, dir, closest, [&](int element, float tEnter)
+                {
+                    closest = Math::Min(closest, tEnter);
+                    return closest;
+                });
+                float expectedClosest = 400.0f;
+                for (int i = 0; i < boxes.Count(); i++)
+                {
+                    float t;
+                    if (RayHitsBox(boxes[i], origin, dir, expectedClosest, t))
+                        expectedClosest = t;
+                }
+                Assert::IsTrue(closest == expectedClosest);
+            }
+        }
+        TEST_METHOD(SmallMoveKeepsLeaf)
+        {
+            DynamicBvh<int> tree;
+            Graphics::BBox box;
+            box.Min = Vec3::Create(0.0f);
+            box.Max = Vec3::Create(10.0f);
+            int leaf = tree.Insert(0, box);
+            box.Min.x += 0.5f;
+            box.Max.x += 0.5f;
+            Assert::IsFalse(tree.Move(leaf, box));
+            box.Min.x += 5.0f;
+            box.Max.x += 5.0f;
+            Assert::IsTrue(tree.Move(leaf, box));
+            Assert::IsTrue(tree.Count() == 1);
+        }
+    };
+}
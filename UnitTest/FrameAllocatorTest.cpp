@@ -0,0 +1,136 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/FrameAllocator.h"
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+
+namespace UnitTest
+{
+    static int expiredFrees = 0;
+
+    static void CountExpiredFree(const void * /*ptr*/)
+    {
+        expiredFrees++;
+    }
+
+    TEST_CLASS(FrameAllocatorTest)
+    {
+    public:
+        TEST_METHOD(HeapFallbackBeforeInit)
+        {
+            Assert::IsFalse(FrameScratch::IsActive());
+            FrameList<int> list;
+            for (int i = 0; i < 1000; i++)
+                list.Add(i);
+            Assert::IsTrue(FrameScratch::IsAlive(list.Buffer()));
+            for (int i = 0; i < 1000; i++)
+                Assert::AreEqual(i, list[i]);
+        }
+
+        TEST_METHOD(BumpAllocationIsAligned)
+        {
+            FrameScratch::Init(2);
+            FrameScratch::BeginFrame();
+            size_t usedBefore = FrameScratch::GetThreadBytesUsed();
+            void * ptrs[64];
+            for (int i = 0; i < 64; i++)
+            {
+                ptrs[i] = FrameScratch::Alloc(i * 7 + 1);
+                Assert::IsTrue(((size_t)ptrs[i] & 15) == 0);
+                memset(ptrs[i], i, i * 7 + 1);
+            }
+            for (int i = 1; i < 64; i++)
+                Assert::IsTrue(ptrs[i] > ptrs[i - 1]);
+            Assert::IsTrue(FrameScratch::GetThreadBytesUsed() > usedBefore);
+            // a request larger than a chunk gets its own chunk
+            auto big = (unsigned char*)FrameScratch::Alloc(FrameScratch::ChunkSize * 2);
+            memset(big, 1, FrameScratch::ChunkSize * 2);
+            for (int i = 0; i < 64; i++)
+                Assert::AreEqual((unsigned char)i, ((unsigned char*)ptrs[i])[i * 7]);
+            FrameScratch::Shutdown();
+        }
+
+        TEST_METHOD(MemoryLivesForFramesInFlight)
+        {
+            FrameScratch::Init(2);
+            FrameScratch::BeginFrame();
+            auto firstFrame = (int*)FrameScratch::Alloc(sizeof(int));
+            *firstFrame = 42;
+            FrameScratch::BeginFrame();
+            Assert::IsTrue(FrameScratch::IsAlive(firstFrame));
+            Assert::AreEqual(42, *firstFrame);
+            auto nextFrame = FrameScratch::Alloc(16);
+            Assert::IsTrue(nextFrame != firstFrame);
+            FrameScratch::BeginFrame();
+            Assert::IsFalse(FrameScratch::IsAlive(firstFrame));
+            Assert::IsTrue(FrameScratch::IsAlive(nextFrame));
+            // the ring came back to the first arena, so the new frame reuses its memory
+            auto reused = FrameScratch::Alloc(16);
+            Assert::IsTrue(reused == firstFrame);
+            Assert::AreEqual(32, (int)FrameScratch::GetThreadBytesUsed());
+            FrameScratch::Shutdown();
+        }
+
+        TEST_METHOD(DebugChecksReportExpiredFree)
+        {
+            FrameScratch::Init(2);
+            FrameScratch::SetDebugChecks(true);
+            FrameScratch::SetErrorHandler(CountExpiredFree);
+            expiredFrees = 0;
+            FrameScratch::BeginFrame();
+            auto ptr = FrameScratch::Alloc(64);
+            FrameScratch::Free(ptr);
+            Assert::AreEqual(0, expiredFrees);
+            auto leaked = FrameScratch::Alloc(64);
+            FrameScratch::BeginFrame();
+            FrameScratch::BeginFrame();
+            FrameScratch::Free(leaked);
+            Assert::AreEqual(1, expiredFrees);
+            FrameScratch::SetErrorHandler(nullptr);
+            FrameScratch::SetDebugChecks(false);
+            FrameScratch::Shutdown();
+        }
+
+        TEST_METHOD(ThreadsUseSeparateArenas)
+        {
+            FrameScratch::Init(2);
+            FrameScratch::BeginFrame();
+            auto mainPtr = (int*)FrameScratch::Alloc(sizeof(int) * 256);
+            for (int i = 0; i < 256; i++)
+                mainPtr[i] = i;
+            size_t workerBytes = 0;
+            std::thread worker([&]()
+            {
+                auto ptr = (int*)FrameScratch::Alloc(sizeof(int) * 1024);
+                for (int i = 0; i < 1024; i++)
+                    ptr[i] = -1;
+                workerBytes = FrameScratch::GetThreadBytesUsed();
+            });
+            worker.join();
+            Assert::IsTrue(workerBytes >= sizeof(int) * 1024);
+            for (int i = 0; i < 256; i++)
+                Assert::AreEqual(i, mainPtr[i]);
+            FrameScratch::Shutdown();
+        }
+
+        TEST_METHOD(FrameStringBuilderAppend)
+        {
+            FrameScratch::Init(2);
+            FrameScratch::BeginFrame();
+            {
+                FrameStringBuilder sb(4);
+                sb << "Pipelines: " << 3 << " pending, " << String("x") << ' ';
+                sb.Append(1.25, "%.2f");
+                Assert::IsTrue(sb.ToString() == "Pipelines: 3 pending, x 1.25");
+                Assert::AreEqual(28, sb.Length());
+                sb.Clear();
+                sb << "ms";
+                Assert::IsTrue(String(sb.Buffer()) == "ms");
+            }
+            FrameScratch::Shutdown();
+        }
+    };
+}
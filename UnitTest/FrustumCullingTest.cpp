@@ -0,0 +1,61 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/FrustumCulling.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(FrustumCullingTest)
+    {
+    public:
+        TEST_METHOD(BatchCullingMatchesScalarTest)
+        {
+            Random random(3);
+            List<Graphics::BBox> boxes;
+            BBoxArraySoA bounds;
+            // odd count so that the last SIMD batch is partially filled
+            for (int i = 0; i < 1237; i++)
+            {
+                Graphics::BBox box;
+                auto center = Vec3::Create(random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f));
+                auto extent = Vec3::Create(random.NextFloat(0.0f, 8.0f), random.NextFloat(0.0f, 8.0f), random.NextFloat(0.0f, 8.0f));
+                box.Min = center - extent;
+                box.Max = center + extent;
+                boxes.Add(box);
+                bounds.Add(box);
+            }
+            List<CullFrustum> frustums;
+            for (int f = 0; f < 6; f++)
+            {
+                Matrix4 view, proj, viewProj, invViewProj;
+                Matrix4::LookAt(view, Vec3::Create(random.NextFloat(-50.0f, 50.0f), random.NextFloat(-50.0f, 50.0f), random.NextFloat(-50.0f, 50.0f)),
+                    Vec3::Create(0.0f, 0.0f, 0.0f), Vec3::Create(0.0f, 1.0f, 0.0f));
+                if (f & 1)
+                    Matrix4::CreateOrthoMatrix(proj, -40.0f, 40.0f, 40.0f, -40.0f, -100.0f, 100.0f, ClipSpaceType::ZeroToOne);
+                else
+                    Matrix4::CreatePerspectiveMatrixFromViewAngle(proj, 75.0f, 1.5f, 0.5f, 120.0f, ClipSpaceType::ZeroToOne);
+                Matrix4::Multiply(viewProj, proj, view);
+                viewProj.Inverse(invViewProj);
+                frustums.Add(CullFrustum(invViewProj));
+            }
+            List<List<int>> visible;
+            visible.SetSize(frustums.Count());
+            CullBoxes(frustums.GetArrayView(), bounds, visible.GetArrayView());
+            for (int f = 0; f < frustums.Count(); f++)
+            {
+                List<int> expected;
+                for (int i = 0; i < boxes.Count(); i++)
+                    if (frustums[f].IsBoxInFrustum(boxes[i]))
+                        expected.Add(i);
+                Assert::IsTrue(expected.Count() > 0 && expected.Count() < boxes.Count());
+                Assert::IsTrue(visible[f].Count() == expected.Count());
+                for (int i = 0; i < expected.Count(); i++)
+                    Assert::IsTrue(visible[f][i] == expected[i]);
+            }
+        }
+    };
+}
@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/MemoryPool.h"
+#include "../GameEngineCore/GlyphAtlas.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace GameEngine;
+using namespace CoreLib;
+
+namespace UnitTest
+{
+    TEST_CLASS(GlyphAtlasTest)
+    {
+    private:
+        static const int BufferSize = 1 << 16;
+        static const int FramesInFlight = 3;
+        List<unsigned char> buffer;
+        MemoryPool pool;
+        GlyphAtlas atlas;
+        void Init(int budget)
+        {
+            buffer.SetSize(BufferSize);
+            memset(buffer.Buffer(), 0, BufferSize);
+            pool.Init(buffer.Buffer(), Log2TextBufferBlockSize, BufferSize >> Log2TextBufferBlockSize);
+            atlas.Init(buffer.Buffer(), &pool, budget, FramesInFlight);
+        }
+        static List<unsigned char> MakeGlyph(int w, int h, int seed)
+        {
+            List<unsigned char> pixels;
+            pixels.SetSize(w * h);
+            for (int i = 0; i < pixels.Count(); i++)
+                pixels[i] = (unsigned char)((i * 37 + seed * 101) & 255);
+            return pixels;
+        }
+        // Reads a pixel back the way UI.slang does.
+        int FetchPixel(GlyphAtlasEntry * entry, int x, int y)
+        {
+            int relAddr = y * entry->Width + x;
+            int ptr = entry->Address + (relAddr >> 1);
+            return (buffer[ptr] >> ((relAddr & 1) << 2)) & 15;
+        }
+    public:
+        TEST_METHOD(PackedGlyphReadback)
+        {
+            Init(BufferSize);
+            auto pixels = MakeGlyph(13, 7, 1);
+            auto entry = atlas.Add(1, 'A', 13, 7, pixels.Buffer());
+            Assert::IsNotNull(entry);
+            Assert::AreEqual(0, entry->Address & ((1 << Log2TextBufferBlockSize) - 1));
+            for (int y = 0; y < 7; y++)
+                for (int x = 0; x < 13; x++)
+                {
+                    int expected = Math::FastFloor(pixels[y * 13 + x] * 15 / 255.0f + 0.5f);
+                    Assert::AreEqual(expected, FetchPixel(entry, x, y));
+                }
+            Assert::IsTrue(atlas.Find(1, 'A') == entry);
+            Assert::IsNull(atlas.Find(1, 'B'));
+            Assert::AreEqual(1, atlas.GetUploadCount());
+        }
+        TEST_METHOD(FontsHaveSeparateGlyphs)
+        {
+            Init(BufferSize);
+            int font0 = atlas.RegisterFont();
+            int font1 = atlas.RegisterFont();
+            Assert::AreNotEqual(font0, font1);
+            auto glyph0 = MakeGlyph(8, 8, 0);
+            auto glyph1 = MakeGlyph(10, 12, 1);
+            auto entry0 = atlas.Add(font0, 'x', 8, 8, glyph0.Buffer());
+            auto entry1 = atlas.Add(font1, 'x', 10, 12, glyph1.Buffer());
+            Assert::IsTrue(atlas.Find(font0, 'x') == entry0);
+            Assert::IsTrue(atlas.Find(font1, 'x') == entry1);
+            Assert::AreNotEqual(entry0->Address, entry1->Address);
+            Assert::AreEqual(2, atlas.GetGlyphCount());
+        }
+        TEST_METHOD(EmptyGlyphTakesNoMemory)
+        {
+            Init(BufferSize);
+            auto entry = atlas.Add(1, ' ', 0, 0, nullptr);
+            Assert::IsNotNull(entry);
+            Assert::AreEqual(-1, entry->Address);
+            Assert::AreEqual(0, atlas.GetBytesUsed());
+            Assert::IsTrue(atlas.Find(1, ' ') == entry);
+        }
+        TEST_METHOD(EvictsLeastRecentlyUsedGlyph)
+        {
+            // room for four 64 byte glyphs
+            Init(256);
+            auto pixels = MakeGlyph(8, 8, 0);
+            for (unsigned int c = 0; c < 4; c++)
+                Assert::IsNotNull(atlas.Add(1, c, 8, 8, pixels.Buffer()));
+            for (int i = 0; i < FramesInFlight; i++)
+                atlas.AdvanceFrame();
+            // glyph 0 is drawn again, glyph 1 becomes the least recently used one
+            Assert::IsNotNull(atlas.Find(1, 0));
+            Assert::IsNotNull(atlas.Add(1, 4, 8, 8, pixels.Buffer()));
+            Assert::AreEqual(1, atlas.GetEvictionCount());
+            Assert::IsNull(atlas.Find(1, 1));
+            Assert::IsNotNull(atlas.Find(1, 0));
+            Assert::IsNotNull(atlas.Find(1, 2));
+            Assert::IsNotNull(atlas.Find(1, 4));
+            Assert::IsTrue(atlas.GetBytesUsed() <= 256);
+        }
+        TEST_METHOD(KeepsGlyphsOfFramesInFlight)
+        {
+            Init(256);
+            auto pixels = MakeGlyph(8, 8, 0);
+            for (unsigned int c = 0; c < 4; c++)
+                Assert::IsNotNull(atlas.Add(1, c, 8, 8, pixels.Buffer()));
+            // the frames that drew the glyphs may still be reading them
+            for (int i = 0; i < FramesInFlight - 1; i++)
+            {
+                atlas.AdvanceFrame();
+                Assert::IsNull(atlas.Add(1, 100 + i, 8, 8, pixels.Buffer()));
+            }
+            Assert::AreEqual(0, atlas.GetEvictionCount());
+            atlas.AdvanceFrame();
+            Assert::IsNotNull(atlas.Add(1, 100, 8, 8, pixels.Buffer()));
+            Assert::AreEqual(1, atlas.GetEvictionCount());
+        }
+        TEST_METHOD(StaysWithinBudget)
+        {
+            Init(4096);
+            for (unsigned int c = 0; c < 1000; c++)
+            {
+                atlas.AdvanceFrame();
+                int w = 4 + c % 29, h = 6 + c % 17;
+                auto pixels = MakeGlyph(w, h, c);
+                auto entry = atlas.Add(1, c, w, h, pixels.Buffer());
+                Assert::IsNotNull(entry);
+                Assert::IsTrue(atlas.GetBytesUsed() <= 4096);
+                Assert::AreEqual(Math::FastFloor(pixels[w * h - 1] * 15 / 255.0f + 0.5f), FetchPixel(entry, w - 1, h - 1));
+            }
+            Assert::AreEqual(1000, atlas.GetUploadCount());
+            Assert::AreEqual(1000 - atlas.GetGlyphCount(), atlas.GetEvictionCount());
+            atlas.Clear();
+            Assert::AreEqual(0, atlas.GetBytesUsed());
+            Assert::AreEqual(0, atlas.GetGlyphCount());
+        }
+    };
+}
@@ -0,0 +1,297 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/PerformanceCounter.h"
+#include "../GameEngineCore/VideoEncoder.h"
+#include "../GameEngineCore/H264Encoder/src/cpu.h"
+#include "../GameEngineCore/H264Encoder/src/sad_common.h"
+#include "../GameEngineCore/H264Encoder/src/sample.h"
+#include "../GameEngineCore/H264Encoder/src/encode_mb_aux.h"
+#include "../GameEngineCore/H264Encoder/src/decode_mb_aux.h"
+#include "../GameEngineCore/H264Encoder/src/mc.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace WelsEnc;
+
+namespace UnitTest
+{
+    typedef int32_t(*SadFunc)(uint8_t *, int32_t, uint8_t *, int32_t);
+    typedef void(*SadFourFunc)(uint8_t *, int32_t, uint8_t *, int32_t, int32_t *);
+
+    TEST_CLASS(H264KernelTest)
+    {
+    private:
+        static const int Stride = 48;
+        static const int Rows = 40;
+        // a picture with a margin around it, so kernels may read the pixels next to a block
+        struct Plane
+        {
+            List<uint8_t> Data;
+            Plane(Random & random)
+            {
+                Data.SetSize(Stride * Rows);
+                for (auto & b : Data)
+                    b = (uint8_t)random.Next(0, 256);
+                // flat and extreme areas make the transforms hit their largest values
+                for (int i = 0; i < Stride * 4; i++)
+                    Data[Stride * 20 + i] = (i & 1) ? 255 : 0;
+            }
+            uint8_t * At(int x, int y)
+            {
+                return Data.Buffer() + (y + 4) * Stride + x + 4;
+            }
+        };
+        static uint32_t CpuFlags()
+        {
+            int32_t cores = 0;
+            return WelsCPUFeatureDetect(&cores);
+        }
+        static void CheckSad(Random & random, SadFunc reference, SadFunc simd, SadFourFunc referenceFour, SadFourFunc simdFour)
+        {
+            Plane a(random), b(random);
+            for (int i = 0; i < 50; i++)
+            {
+                int x = random.Next(0, 16), y = random.Next(0, 16);
+                int x2 = random.Next(0, 16), y2 = random.Next(0, 16);
+                Assert::AreEqual(reference(a.At(x, y), Stride, b.At(x2, y2), Stride), simd(a.At(x, y), Stride, b.At(x2, y2), Stride));
+                Assert::AreEqual(reference(a.At(x, y), Stride, a.At(x, y + 20), Stride), simd(a.At(x, y), Stride, a.At(x, y + 20), Stride));
+                if (referenceFour)
+                {
+                    int32_t expected[4], actual[4];
+                    referenceFour(a.At(x, y), Stride, b.At(x2, y2), Stride, expected);
+                    simdFour(a.At(x, y), Stride, b.At(x2, y2), Stride, actual);
+                    Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                }
+            }
+        }
+        static void CheckMc(Random & random, const SMcFunc & reference, const SMcFunc & simd)
+        {
+            Plane src(random), src2(random);
+            uint8_t expected[Stride * 24], actual[Stride * 24];
+            int sizes[][2] = { { 16, 16 }, { 16, 8 }, { 8, 16 }, { 8, 8 }, { 8, 4 }, { 4, 8 }, { 4, 4 }, { 2, 2 }, { 2, 4 }, { 4, 2 },
+                { 17, 17 }, { 9, 9 }, { 5, 5 }, { 17, 16 }, { 16, 17 }, { 9, 8 }, { 8, 9 }, { 5, 4 }, { 4, 5 } };
+            for (auto & size : sizes)
+            {
+                int w = size[0], h = size[1];
+                for (int i = 0; i < 20; i++)
+                {
+                    int x = random.Next(0, 12), y = random.Next(0, 12);
+                    int16_t mvX = (int16_t)random.Next(-3, 32), mvY = (int16_t)random.Next(-3, 32);
+                    auto check = [&](auto call)
+                    {
+                        memset(expected, 0xCD, sizeof(expected));
+                        memset(actual, 0xCD, sizeof(actual));
+                        call(reference, expected);
+                        call(simd, actual);
+                        Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                    };
+                    check([&](const SMcFunc & f, uint8_t * dst) { f.pfLumaHalfpelHor(src.At(x, y), Stride, dst, Stride, w, h); });
+                    check([&](const SMcFunc & f, uint8_t * dst) { f.pfLumaHalfpelVer(src.At(x, y), Stride, dst, Stride, w, h); });
+                    check([&](const SMcFunc & f, uint8_t * dst) { f.pfLumaHalfpelCen(src.At(x, y), Stride, dst, Stride, w, h); });
+                    check([&](const SMcFunc & f, uint8_t * dst) { f.pfSampleAveraging(dst, Stride, src.At(x, y), Stride, src2.At(y, x), Stride - 1, w, h); });
+                    if (w <= 16 && h <= 16 && w >= 4 && h >= 4 && !(w & 3) && !(h & 3))
+                        check([&](const SMcFunc & f, uint8_t * dst) { f.pMcLumaFunc(src.At(x + 4, y + 4), Stride, dst, Stride, mvX, mvY, w, h); });
+                    if (w <= 8 && h <= 8 && !(w & 1) && !(h & 1))
+                        check([&](const SMcFunc & f, uint8_t * dst) { f.pMcChromaFunc(src.At(x, y), Stride, dst, Stride, mvX, mvY, w, h); });
+                }
+            }
+        }
+        template<typename Func>
+        static double Time(Func f, int count)
+        {
+            auto start = Diagnostics::PerformanceCounter::Start();
+            for (int i = 0; i < count; i++)
+                f(i);
+            return Diagnostics::PerformanceCounter::EndSeconds(start);
+        }
+    public:
+        TEST_METHOD(SadMatchesC)
+        {
+#if defined(X86_INTRINSICS)
+            Random random(21);
+            CheckSad(random, WelsSampleSad16x16_c, WelsSampleSad16x16_sse2, WelsSampleSadFour16x16_c, WelsSampleSadFour16x16_sse2);
+            CheckSad(random, WelsSampleSad16x8_c, WelsSampleSad16x8_sse2, WelsSampleSadFour16x8_c, WelsSampleSadFour16x8_sse2);
+            CheckSad(random, WelsSampleSad8x16_c, WelsSampleSad8x16_sse2, WelsSampleSadFour8x16_c, WelsSampleSadFour8x16_sse2);
+            CheckSad(random, WelsSampleSad8x8_c, WelsSampleSad8x8_sse2, WelsSampleSadFour8x8_c, WelsSampleSadFour8x8_sse2);
+            CheckSad(random, WelsSampleSad4x4_c, WelsSampleSad4x4_sse2, WelsSampleSadFour4x4_c, WelsSampleSadFour4x4_sse2);
+#endif
+        }
+        TEST_METHOD(SatdMatchesC)
+        {
+#if defined(X86_INTRINSICS)
+            Random random(22);
+            uint32_t cpu = CpuFlags();
+            if (cpu & WELS_CPU_SSSE3)
+            {
+                CheckSad(random, WelsSampleSatd16x16_c, WelsSampleSatd16x16_ssse3, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd16x8_c, WelsSampleSatd16x8_ssse3, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd8x16_c, WelsSampleSatd8x16_ssse3, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd8x8_c, WelsSampleSatd8x8_ssse3, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd4x4_c, WelsSampleSatd4x4_ssse3, nullptr, nullptr);
+            }
+            if (cpu & WELS_CPU_AVX2)
+            {
+                CheckSad(random, WelsSampleSatd16x16_c, WelsSampleSatd16x16_avx2, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd16x8_c, WelsSampleSatd16x8_avx2, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd8x16_c, WelsSampleSatd8x16_avx2, nullptr, nullptr);
+                CheckSad(random, WelsSampleSatd8x8_c, WelsSampleSatd8x8_avx2, nullptr, nullptr);
+            }
+#endif
+        }
+        TEST_METHOD(TransformsMatchC)
+        {
+#if defined(X86_INTRINSICS)
+            Random random(23);
+            Plane a(random), b(random);
+            for (int i = 0; i < 200; i++)
+            {
+                int x = random.Next(0, 16), y = random.Next(0, 16);
+                int16_t expected[64], actual[64];
+                memset(expected, 0, sizeof(expected));
+                memset(actual, 0, sizeof(actual));
+                WelsDctT4_c(expected, a.At(x, y), Stride, b.At(y, x), Stride - 3);
+                WelsDctT4_sse2(actual, a.At(x, y), Stride, b.At(y, x), Stride - 3);
+                Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                WelsDctFourT4_c(expected, a.At(x, y), Stride, b.At(y, x), Stride - 3);
+                WelsDctFourT4_sse2(actual, a.At(x, y), Stride, b.At(y, x), Stride - 3);
+                Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+
+                // reconstruction from coefficients of any magnitude, including ones that overflow the 16 bit intermediates
+                int16_t coefficients[64];
+                int range = (i & 1) ? 32768 : 600;
+                for (auto & c : coefficients)
+                    c = (int16_t)random.Next(-range, range);
+                Plane expectedRec(random), actualRec(random);
+                actualRec.Data = expectedRec.Data;
+                WelsIDctT4Rec_c(expectedRec.At(x, y), Stride, a.At(y, x), Stride - 1, coefficients);
+                WelsIDctT4Rec_sse2(actualRec.At(x, y), Stride, a.At(y, x), Stride - 1, coefficients);
+                Assert::IsTrue(memcmp(expectedRec.Data.Buffer(), actualRec.Data.Buffer(), expectedRec.Data.Count()) == 0);
+                WelsIDctFourT4Rec_c(expectedRec.At(x, y), Stride, a.At(y, x), Stride - 1, coefficients);
+                WelsIDctFourT4Rec_sse2(actualRec.At(x, y), Stride, a.At(y, x), Stride - 1, coefficients);
+                Assert::IsTrue(memcmp(expectedRec.Data.Buffer(), actualRec.Data.Buffer(), expectedRec.Data.Count()) == 0);
+            }
+#endif
+        }
+        TEST_METHOD(QuantizationMatchesC)
+        {
+#if defined(X86_INTRINSICS)
+            Random random(24);
+            for (int qp = 0; qp < 52; qp++)
+            {
+                for (int intra = 0; intra < 2; intra++)
+                {
+                    const int16_t * ff = intra ? g_iQuantIntraFF[qp] : g_kiQuantInterFF[qp];
+                    const int16_t * mf = g_kiQuantMF[qp];
+                    int16_t expected[64], actual[64], expectedMax[4], actualMax[4];
+                    for (auto & c : expected)
+                        c = (int16_t)random.Next((qp & 1) ? -32768 : -2000, (qp & 1) ? 32768 : 2000);
+                    memcpy(actual, expected, sizeof(expected));
+                    WelsQuant4x4_c(expected, ff, mf);
+                    WelsQuant4x4_sse2(actual, ff, mf);
+                    Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                    WelsQuant4x4Dc_c(expected, ff[0] << 1, mf[0] >> 1);
+                    WelsQuant4x4Dc_sse2(actual, ff[0] << 1, mf[0] >> 1);
+                    Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                    WelsQuantFour4x4_c(expected, ff, mf);
+                    WelsQuantFour4x4_sse2(actual, ff, mf);
+                    Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                    for (auto & c : expected)
+                        c = (int16_t)random.Next(-3000, 3000);
+                    memcpy(actual, expected, sizeof(expected));
+                    WelsQuantFour4x4Max_c(expected, ff, mf, expectedMax);
+                    WelsQuantFour4x4Max_sse2(actual, ff, mf, actualMax);
+                    Assert::IsTrue(memcmp(expected, actual, sizeof(expected)) == 0);
+                    Assert::IsTrue(memcmp(expectedMax, actualMax, sizeof(expectedMax)) == 0);
+                }
+            }
+#endif
+        }
+        TEST_METHOD(MotionCompensationMatchesC)
+        {
+            Random random(25);
+            SMcFunc reference, simd;
+            WelsCommon::InitMcFunc(&reference, 0);
+            WelsCommon::InitMcFunc(&simd, CpuFlags());
+            CheckMc(random, reference, simd);
+        }
+        BEGIN_TEST_METHOD_ATTRIBUTE(KernelAndEncoderBenchmark)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(KernelAndEncoderBenchmark)
+        {
+            Random random(26);
+            Plane a(random), b(random);
+            uint32_t cpu = CpuFlags();
+            SWelsFuncPtrList reference, simd;
+            memset(&reference, 0, sizeof(reference));
+            memset(&simd, 0, sizeof(simd));
+            WelsInitSampleSadFunc(&reference, 0);
+            WelsInitSampleSadFunc(&simd, cpu);
+            WelsInitEncodingFuncs(&reference, 0);
+            WelsInitEncodingFuncs(&simd, cpu);
+            WelsInitReconstructionFuncs(&reference, 0);
+            WelsInitReconstructionFuncs(&simd, cpu);
+            SMcFunc referenceMc, simdMc;
+            WelsCommon::InitMcFunc(&referenceMc, 0);
+            WelsCommon::InitMcFunc(&simdMc, cpu);
+            const int count = 2000000;
+            int32_t sink = 0;
+            auto report = [&](const char * name, double cTime, double simdTime)
+            {
+                char message[256];
+                snprintf(message, sizeof(message), "%s: C %.1f ns, SIMD %.1f ns (%.2fx)\n", name, cTime * 1e9 / count,
+                    simdTime * 1e9 / count, cTime / simdTime);
+                Logger::WriteMessage(message);
+            };
+            auto benchSad = [&](const char * name, PSampleSadSatdCostFunc c, PSampleSadSatdCostFunc s)
+            {
+                double cTime = Time([&](int i) { sink += c(a.At(i & 15, 0), Stride, b.At(0, i & 15), Stride); }, count);
+                double simdTime = Time([&](int i) { sink += s(a.At(i & 15, 0), Stride, b.At(0, i & 15), Stride); }, count);
+                report(name, cTime, simdTime);
+            };
+            benchSad("SAD 16x16", reference.sSampleDealingFuncs.pfSampleSad[BLOCK_16x16], simd.sSampleDealingFuncs.pfSampleSad[BLOCK_16x16]);
+            benchSad("SATD 16x16", reference.sSampleDealingFuncs.pfSampleSatd[BLOCK_16x16], simd.sSampleDealingFuncs.pfSampleSatd[BLOCK_16x16]);
+            benchSad("SATD 4x4", reference.sSampleDealingFuncs.pfSampleSatd[BLOCK_4x4], simd.sSampleDealingFuncs.pfSampleSatd[BLOCK_4x4]);
+            int16_t coefficients[64] = {};
+            auto benchDct = [&](const char * name, PDctFunc c, PDctFunc s)
+            {
+                double cTime = Time([&](int i) { c(coefficients, a.At(i & 15, 0), Stride, b.At(0, i & 15), Stride); }, count);
+                double simdTime = Time([&](int i) { s(coefficients, a.At(i & 15, 0), Stride, b.At(0, i & 15), Stride); }, count);
+                report(name, cTime, simdTime);
+            };
+            benchDct("DCT four 4x4", reference.pfDctFourT4, simd.pfDctFourT4);
+            auto benchMc = [&](const char * name, PWelsLumaHalfpelMcFunc c, PWelsLumaHalfpelMcFunc s)
+            {
+                uint8_t dst[Stride * 16];
+                double cTime = Time([&](int i) { c(a.At(i & 15, 0), Stride, dst, Stride, 16, 16); }, count / 4);
+                double simdTime = Time([&](int i) { s(a.At(i & 15, 0), Stride, dst, Stride, 16, 16); }, count / 4);
+                report(name, cTime, simdTime);
+            };
+            benchMc("Half pel horizontal 16x16", referenceMc.pfLumaHalfpelHor, simdMc.pfLumaHalfpelHor);
+            benchMc("Half pel vertical 16x16", referenceMc.pfLumaHalfpelVer, simdMc.pfLumaHalfpelVer);
+            benchMc("Half pel center 16x16", referenceMc.pfLumaHalfpelCen, simdMc.pfLumaHalfpelCen);
+
+            // whole encoder at 1080p, the SIMD kernels are picked by the encoder itself
+            int w = 1920, h = 1080, frames = 20;
+            List<unsigned char> image;
+            image.SetSize(w * h * 4);
+            RefPtr<IO::MemoryStream> stream = new IO::MemoryStream();
+            RefPtr<IVideoEncoder> encoder = CreateH264VideoEncoder();
+            encoder->Init(VideoEncodingOptions(w, h), stream.Ptr());
+            double encodeTime = 0.0;
+            for (int f = 0; f < frames; f++)
+            {
+                for (int i = 0; i < image.Count(); i++)
+                    image[i] = (unsigned char)((i / 4 % w + f * 3) ^ (i / 4 / w + f));
+                auto start = Diagnostics::PerformanceCounter::Start();
+                encoder->EncodeFrame(w, h, image.Buffer());
+                encodeTime += Diagnostics::PerformanceCounter::EndSeconds(start);
+            }
+            encoder->Close();
+            char message[256];
+            snprintf(message, sizeof(message), "1080p encode: %.2f fps, checksum %d\n", frames / encodeTime, sink);
+            Logger::WriteMessage(message);
+        }
+    };
+}
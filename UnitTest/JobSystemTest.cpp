@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/JobSystem.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Threading;
+
+namespace UnitTest
+{
+    TEST_CLASS(JobSystemTest)
+    {
+    public:
+        TEST_METHOD(ParallelForCoversRange)
+        {
+            JobSystem::Init(3);
+            List<int> hits;
+            hits.SetSize(100000);
+            for (auto & h : hits)
+                h = 0;
+            JobSystem::ParallelFor(0, hits.Count(), 100, [&](int i) { hits[i]++; });
+            JobSystem::Destroy();
+            for (auto h : hits)
+                Assert::IsTrue(h == 1);
+        }
+        TEST_METHOD(DependentJobRunsLast)
+        {
+            JobSystem::Init(3);
+            JobCounter first, second;
+            std::atomic<int> finished;
+            finished = 0;
+            int observed = -1;
+            for (int i = 0; i < 64; i++)
+                JobSystem::Run([&]() { finished++; }, &first);
+            JobSystem::Run([&]() { observed = finished.load(); }, &second, &first);
+            JobSystem::Wait(second);
+            JobSystem::Destroy();
+            Assert::IsTrue(observed == 64);
+        }
+        TEST_METHOD(NestedParallelFor)
+        {
+            JobSystem::Init(3);
+            std::atomic<int> count;
+            count = 0;
+            JobSystem::ParallelFor(0, 32, 1, [&](int)
+            {
+                JobSystem::ParallelFor(0, 1000, 10, [&](int) { count++; });
+            });
+            JobSystem::Destroy();
+            Assert::IsTrue(count.load() == 32000);
+        }
+    };
+}
@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/Stream.h"
+#include "../GameEngineCore/Engine.h"
+#include "../GameEngineCore/Level.h"
+#include "../GameEngineCore/CameraActor.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+    TEST_CLASS(LevelFileTest)
+    {
+    private:
+        class TestActor : public Actor
+        {
+        public:
+            PROPERTY(int, Count);
+            PROPERTY(String, Label);
+            PROPERTY(List<String>, Tags);
+            // custom field, stored in text form
+            String Note;
+        protected:
+            virtual bool ParseField(String name, Text::TokenReader & parser) override
+            {
+                if (name == "note")
+                {
+                    Note = parser.ReadStringLiteral();
+                    return true;
+                }
+                return Actor::ParseField(name, parser);
+            }
+            virtual void SerializeFields(StringBuilder & sb) override
+            {
+                sb << "note " << Text::EscapeStringLiteral(Note) << "\n";
+            }
+        public:
+            virtual EngineActorType GetEngineType() override
+            {
+                return EngineActorType::Util;
+            }
+            virtual String GetTypeName() override
+            {
+                return "LevelFileTestActor";
+            }
+        };
+        // the same class as written by an older build that still declared RemovedScale
+        class OldTestActor : public TestActor
+        {
+        public:
+            PROPERTY(float, RemovedScale);
+        };
+        // a class that is no longer registered with the engine
+        class RemovedActor : public Actor
+        {
+        public:
+            PROPERTY(int, Payload);
+            virtual EngineActorType GetEngineType() override
+            {
+                return EngineActorType::Util;
+            }
+            virtual String GetTypeName() override
+            {
+                return "LevelFileTestRemovedActor";
+            }
+        };
+
+        static ObjPtr<Actor> CreateTestActor(const char * name, int count, const char * note)
+        {
+            ObjPtr<OldTestActor> actor = new OldTestActor();
+            actor->Name = String(name);
+            actor->Count = count;
+            actor->Label = String("label of ") + name;
+            List<String> tags;
+            tags.Add("first");
+            tags.Add(name);
+            actor->Tags = tags;
+            actor->RemovedScale = 2.5f;
+            actor->Note = note;
+            return actor;
+        }
+        static List<unsigned char> SaveTestLevel()
+        {
+            Level level;
+            level.LightmapFileName = "test.lightmap";
+            level.HiddenSections.Add("hidden section");
+            level.RegisterActor(CreateTestActor("a", 1, "note \"a\"").Ptr());
+            ObjPtr<RemovedActor> removed = new RemovedActor();
+            removed->Name = String("removed");
+            removed->Payload = 77;
+            level.RegisterActor(removed.Ptr());
+            level.RegisterActor(CreateTestActor("b", -2, "").Ptr());
+            RefPtr<MemoryStream> stream = new MemoryStream();
+            level.SaveToBinary(stream.Ptr());
+            List<unsigned char> bytes;
+            bytes.AddRange((unsigned char*)stream->GetBuffer(), stream->GetBufferSize());
+            return bytes;
+        }
+        static void RegisterTestActorClass()
+        {
+            Engine::Instance()->RegisterActorClass("LevelFileTestActor", []() {return new TestActor(); });
+        }
+        static List<String> ReadStrings(BinaryReader & reader)
+        {
+            List<String> strings;
+            int count = reader.ReadInt32();
+            for (int i = 0; i < count; i++)
+                strings.Add(reader.ReadString());
+            return strings;
+        }
+    public:
+        TEST_METHOD(RecordLayout)
+        {
+            auto bytes = SaveTestLevel();
+            RefPtr<MemoryStream> stream = new MemoryStream(bytes.GetArrayView());
+            BinaryReader reader(stream);
+            Assert::IsTrue((uint32_t)reader.ReadInt32() == CompiledLevelIdentifier);
+            Assert::AreEqual(reader.ReadInt32(), CurrentCompiledLevelVersion);
+            Assert::IsTrue(reader.ReadString() == "test.lightmap");
+            auto hiddenSections = ReadStrings(reader);
+            Assert::AreEqual(hiddenSections.Count(), 1);
+            Assert::IsTrue(hiddenSections[0] == "hidden section");
+            // no asset was loaded through the level
+            Assert::AreEqual(reader.ReadInt32(), 0);
+            // class and property names are listed once, in order of first use
+            auto actorClasses = ReadStrings(reader);
+            Assert::AreEqual(actorClasses.Count(), 2);
+            Assert::IsTrue(actorClasses[0] == "LevelFileTestActor");
+            Assert::IsTrue(actorClasses[1] == "LevelFileTestRemovedActor");
+            auto propertyNames = ReadStrings(reader);
+            // the properties of Actor, TestActor, OldTestActor and RemovedActor
+            Assert::AreEqual(propertyNames.Count(), 4 + 3 + 1 + 1);
+            Assert::IsTrue(propertyNames.Contains("Name") && propertyNames.Contains("Count") && propertyNames.Contains("RemovedScale"));
+            Assert::IsTrue(propertyNames.Contains("Payload"));
+
+            int expectedClasses[] = { 0, 1, 0 };
+            int expectedCounts[] = { 1, 0, -2 };
+            Assert::AreEqual(reader.ReadInt32(), 3);
+            for (int i = 0; i < 3; i++)
+            {
+                Assert::AreEqual(reader.ReadInt32(), expectedClasses[i]);
+                int size = reader.ReadInt32();
+                auto recordEnd = stream->GetPosition() + size;
+                int propertyCount = reader.ReadInt32();
+                Assert::AreEqual(propertyCount, expectedClasses[i] ? 5 : 8);
+                for (int j = 0; j < propertyCount; j++)
+                {
+                    int nameId = reader.ReadInt32();
+                    int valueSize = reader.ReadInt32();
+                    auto valueEnd = stream->GetPosition() + valueSize;
+                    Assert::IsTrue(nameId >= 0 && nameId < propertyNames.Count());
+                    // basic types are stored raw
+                    if (propertyNames[nameId] == "Count")
+                    {
+                        Assert::AreEqual(valueSize, (int)sizeof(int));
+                        Assert::AreEqual(reader.ReadInt32(), expectedCounts[i]);
+                    }
+                    stream->Seek(SeekOrigin::Start, valueEnd);
+                }
+                auto fields = reader.ReadString();
+                Assert::IsTrue(fields.StartsWith("note ") == (expectedClasses[i] == 0));
+                Assert::IsTrue(stream->GetPosition() == recordEnd);
+            }
+            Assert::IsTrue(stream->IsEnd());
+            reader.ReleaseStream();
+        }
+        TEST_METHOD(ActorRoundTripSkipsRemovedProperties)
+        {
+            auto written = CreateTestActor("actor", 42, "custom \"note\"\n");
+            EnumerableDictionary<String, int> propertyNameIds;
+            RefPtr<MemoryStream> stream = new MemoryStream();
+            BinaryWriter writer(stream);
+            written->SerializeToBinary(writer, propertyNameIds);
+            List<String> propertyNames;
+            for (auto & name : propertyNameIds)
+                propertyNames.Add(name.Key);
+
+            // RemovedScale is no longer declared and is skipped by its size, the fields after it still parse
+            TestActor actor;
+            bool isInvalid = false;
+            BinaryReader reader(new MemoryStream((unsigned char*)stream->GetBuffer(), stream->GetBufferSize()));
+            actor.ParseBinary(nullptr, reader, propertyNames.GetArrayView(), isInvalid);
+            Assert::IsFalse(isInvalid);
+            Assert::IsTrue(reader.GetStream()->IsEnd());
+            Assert::IsTrue(actor.Name.GetValue() == "actor");
+            Assert::AreEqual(actor.Count.GetValue(), 42);
+            Assert::IsTrue(actor.Label.GetValue() == "label of actor");
+            Assert::AreEqual(actor.Tags->Count(), 2);
+            Assert::IsTrue(actor.Tags.GetValue()[1] == "actor");
+            Assert::IsTrue(actor.Note == "custom \"note\"\n");
+        }
+        TEST_METHOD(LevelRoundTripSkipsUnknownClasses)
+        {
+            RegisterTestActorClass();
+            auto bytes = SaveTestLevel();
+            Level level;
+            RefPtr<MemoryStream> stream = new MemoryStream(bytes.GetArrayView());
+            level.LoadFromBinary(stream.Ptr());
+            Assert::IsTrue(level.LightmapFileName == "test.lightmap");
+            Assert::AreEqual(level.HiddenSections.Count(), 1);
+            // the removed class is skipped by its record size and the actor after it still loads
+            Assert::AreEqual(level.Actors.Count(), 2);
+            Assert::IsTrue(level.FindActor("removed") == nullptr);
+            auto a = dynamic_cast<TestActor*>(level.FindActor("a"));
+            auto b = dynamic_cast<TestActor*>(level.FindActor("b"));
+            Assert::IsTrue(a && b);
+            Assert::AreEqual(a->Count.GetValue(), 1);
+            Assert::AreEqual(b->Count.GetValue(), -2);
+            Assert::IsTrue(a->Label.GetValue() == "label of a");
+            Assert::IsTrue(b->Tags.GetValue()[1] == "b");
+            Assert::IsTrue(a->Note == "note \"a\"");
+            Assert::IsTrue(b->Note == "");
+
+            // saving the loaded level again produces the same file apart from the dropped actor and property
+            RefPtr<MemoryStream> resaved = new MemoryStream();
+            level.SaveToBinary(resaved.Ptr());
+            Level reloaded;
+            RefPtr<MemoryStream> resavedReader = new MemoryStream((unsigned char*)resaved->GetBuffer(), resaved->GetBufferSize());
+            reloaded.LoadFromBinary(resavedReader.Ptr());
+            Assert::AreEqual(reloaded.Actors.Count(), 2);
+            auto b1 = dynamic_cast<TestActor*>(reloaded.FindActor("b"));
+            Assert::IsTrue(b1 && b1->Count.GetValue() == -2 && b1->Label.GetValue() == "label of b");
+        }
+        TEST_METHOD(RejectsOtherVersions)
+        {
+            auto bytes = SaveTestLevel();
+            *(int*)(bytes.Buffer() + sizeof(uint32_t)) = CurrentCompiledLevelVersion + 1;
+            Level level;
+            RefPtr<MemoryStream> stream = new MemoryStream(bytes.GetArrayView());
+            bool rejected = false;
+            try
+            {
+                level.LoadFromBinary(stream.Ptr());
+            }
+            catch (const InvalidOperationException &)
+            {
+                rejected = true;
+            }
+            Assert::IsTrue(rejected);
+        }
+    };
+}
@@ -0,0 +1,186 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/LibIO.h"
+#include "../GameEngineCore/Mesh.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(MeshFileTest)
+    {
+    private:
+        static void BuildMesh(Mesh & mesh, bool blendShapes)
+        {
+            mesh.SetVertexFormat(MeshVertexFormat(1, 1, false, false));
+            mesh.AllocVertexBuffer(300);
+            for (int i = 0; i < mesh.GetVertexCount(); i++)
+            {
+                mesh.SetVertexPosition(i, Vec3::Create((float)i, (float)(i * 2), (float)(i % 7)));
+                mesh.SetVertexUV(i, 0, Vec2::Create((i % 10) * 0.1f, (i % 3) * 0.25f));
+                mesh.SetVertexColor(i, 0, Vec4::Create(1.0f, 0.5f, 0.0f, 1.0f));
+            }
+            for (int i = 0; i < 900; i++)
+                mesh.Indices.Add((i * 7) % mesh.GetVertexCount());
+            mesh.ElementRanges.Add(MeshElementRange{ 0, 600 });
+            mesh.ElementRanges.Add(MeshElementRange{ 600, 300 });
+            if (blendShapes)
+            {
+                mesh.ElementBlendShapeChannels.SetSize(2);
+                BlendShapeChannel channel;
+                channel.Name = "smile";
+                channel.ChannelId = 3;
+                BlendShape shape;
+                shape.BlendShapeVertexStartIndex = 0;
+                shape.FullWeightPercentage = 100.0f;
+                channel.BlendShapes.Add(shape);
+                mesh.ElementBlendShapeChannels[1].Add(channel);
+                for (int i = 0; i < 50; i++)
+                    mesh.BlendShapeVertices.Add(BlendShapeVertex{ Vec3::Create(0.0f, (float)i, 0.0f), (uint32_t)i });
+            }
+            mesh.UpdateBounds();
+        }
+        static void CheckEqual(Mesh & expected, Mesh & actual)
+        {
+            Assert::IsTrue(actual.GetVertexTypeId() == expected.GetVertexTypeId());
+            Assert::IsTrue(actual.GetVertexCount() == expected.GetVertexCount());
+            Assert::IsTrue(memcmp(actual.GetVertexData(), expected.GetVertexData(), expected.GetVertexCount() * expected.GetVertexSize()) == 0);
+            Assert::IsTrue(actual.Indices.Count() == expected.Indices.Count());
+            Assert::IsTrue(memcmp(actual.Indices.Buffer(), expected.Indices.Buffer(), expected.Indices.Count() * sizeof(int)) == 0);
+            Assert::IsTrue(actual.ElementRanges.Count() == expected.ElementRanges.Count());
+            for (int i = 0; i < expected.ElementRanges.Count(); i++)
+            {
+                Assert::IsTrue(actual.ElementRanges[i].StartIndex == expected.ElementRanges[i].StartIndex);
+                Assert::IsTrue(actual.ElementRanges[i].Count == expected.ElementRanges[i].Count);
+            }
+            Assert::IsTrue(actual.Bounds.Min.x == expected.Bounds.Min.x && actual.Bounds.Max.y == expected.Bounds.Max.y);
+            Assert::IsTrue(actual.BlendShapeVertices.Count() == expected.BlendShapeVertices.Count());
+            Assert::IsTrue(memcmp(actual.BlendShapeVertices.Buffer(), expected.BlendShapeVertices.Buffer(), expected.BlendShapeVertices.Count() * sizeof(BlendShapeVertex)) == 0);
+            Assert::IsTrue(actual.ElementBlendShapeChannels.Count() == expected.ElementBlendShapeChannels.Count());
+            if (expected.ElementBlendShapeChannels.Count())
+            {
+                Assert::IsTrue(actual.ElementBlendShapeChannels[1].Count() == 1);
+                Assert::IsTrue(actual.ElementBlendShapeChannels[1][0].Name == "smile");
+                Assert::IsTrue(actual.ElementBlendShapeChannels[1][0].ChannelId == 3);
+            }
+        }
+        // writes the sequential layout used before paged mesh files
+        static void SaveVersion1(Mesh & mesh, const String & fileName)
+        {
+            RefPtr<FileStream> stream = new FileStream(fileName, FileMode::Create);
+            BinaryWriter writer(stream);
+            MeshHeader header;
+            header.MeshFileVersion = 1;
+            header.ElementCount = mesh.ElementRanges.Count();
+            writer.Write(header);
+            writer.Write(mesh.GetVertexTypeId());
+            writer.Write(mesh.GetVertexCount());
+            writer.Write(mesh.Indices.Count());
+            writer.Write(&mesh.Bounds, 1);
+            writer.Write((const char*)mesh.GetVertexData(), mesh.GetVertexCount() * mesh.GetVertexSize());
+            writer.Write(mesh.Indices.Buffer(), mesh.Indices.Count());
+            writer.Write(mesh.ElementRanges.Buffer(), mesh.ElementRanges.Count());
+            writer.ReleaseStream();
+            stream->Close();
+        }
+    public:
+        TEST_METHOD(PagedFileRoundTrip)
+        {
+            for (int blendShapes = 0; blendShapes < 2; blendShapes++)
+            {
+                Mesh mesh;
+                BuildMesh(mesh, blendShapes != 0);
+                String fileName = "mesh_file_test.mesh";
+                mesh.SaveToFile(fileName);
+                {
+                    MemoryMappedFile file(fileName);
+                    auto & table = *(const MeshBlobTable*)(file.Buffer() + sizeof(MeshHeader));
+                    Assert::IsTrue(((const MeshHeader*)file.Buffer())->MeshFileVersion == CurrentMeshFileVersion);
+                    Assert::IsTrue(table.VertexDataOffset % MeshBlobAlignment == 0);
+                    Assert::IsTrue(table.IndexDataOffset % MeshBlobAlignment == 0);
+                    Assert::IsTrue(table.BlendShapeVertexDataOffset % MeshBlobAlignment == 0);
+                }
+
+                Mesh mapped;
+                mapped.LoadFromFile(fileName);
+                CheckEqual(mesh, mapped);
+
+                Mesh streamed;
+                RefPtr<FileStream> stream = new FileStream(fileName);
+                streamed.LoadFromStream(stream.Ptr());
+                stream->Close();
+                CheckEqual(mesh, streamed);
+            }
+        }
+        TEST_METHOD(MappedVerticesAreCopiedOnWrite)
+        {
+            Mesh mesh;
+            BuildMesh(mesh, false);
+            String fileName = "mesh_file_test.mesh";
+            mesh.SaveToFile(fileName);
+            Mesh mapped;
+            mapped.LoadFromFile(fileName);
+            Mesh copy = mapped;
+            copy.SetVertexPosition(5, Vec3::Create(-1.0f, -2.0f, -3.0f));
+            Assert::IsTrue(copy.GetVertexPosition(5).x == -1.0f);
+            Assert::IsTrue(mapped.GetVertexPosition(5).x == 5.0f);
+            Assert::IsTrue(copy.GetVertexPosition(6).y == 12.0f);
+        }
+        TEST_METHOD(ReadsVersion1Files)
+        {
+            Mesh mesh;
+            BuildMesh(mesh, false);
+            String fileName = "mesh_file_test_v1.mesh";
+            SaveVersion1(mesh, fileName);
+            Mesh loaded;
+            loaded.LoadFromFile(fileName);
+            CheckEqual(mesh, loaded);
+        }
+        TEST_METHOD(RejectsUnknownVersions)
+        {
+            Mesh mesh;
+            BuildMesh(mesh, false);
+            String fileName = "mesh_file_test_v3.mesh";
+            mesh.SaveToFile(fileName);
+            auto bytes = File::ReadAllBytes(fileName);
+            ((MeshHeader*)bytes.Buffer())->MeshFileVersion = CurrentMeshFileVersion + 1;
+            File::WriteAllBytes(fileName, bytes.Buffer(), bytes.Count());
+            Mesh loaded;
+            bool rejected = false;
+            try
+            {
+                loaded.LoadFromFile(fileName);
+            }
+            catch (const InvalidOperationException &)
+            {
+                rejected = true;
+            }
+            Assert::IsTrue(rejected);
+        }
+        TEST_METHOD(RejectsBlobOffsetsInsideTheHeader)
+        {
+            Mesh mesh;
+            BuildMesh(mesh, false);
+            String fileName = "mesh_file_test_offset.mesh";
+            mesh.SaveToFile(fileName);
+            auto bytes = File::ReadAllBytes(fileName);
+            ((MeshBlobTable*)(bytes.Buffer() + sizeof(MeshHeader)))->VertexDataOffset = sizeof(MeshHeader);
+            File::WriteAllBytes(fileName, bytes.Buffer(), bytes.Count());
+            Mesh loaded;
+            bool rejected = false;
+            try
+            {
+                loaded.LoadFromFile(fileName);
+            }
+            catch (const IOException &)
+            {
+                rejected = true;
+            }
+            Assert::IsTrue(rejected);
+        }
+    };
+}
@@ -0,0 +1,196 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/PerformanceCounter.h"
+#include "../GameEngineCore/Physics.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(PhysicsModelTest)
+    {
+    private:
+        static float Height(float x, float z)
+        {
+            return sinf(x * 0.37f) * cosf(z * 0.23f) * 4.0f + sinf(x * 0.05f + z * 0.07f) * 10.0f;
+        }
+        // a height field with two triangles per cell, faceCount is rounded to the nearest square grid
+        static RefPtr<PhysicsModel> CreateTerrain(int faceCount, float size)
+        {
+            int cells = Math::Max(1, (int)sqrtf(faceCount * 0.5f));
+            float cellSize = size / cells;
+            PhysicsModelBuilder builder;
+            for (int i = 0; i < cells; i++)
+            {
+                for (int j = 0; j < cells; j++)
+                {
+                    Vec3 v[4];
+                    for (int k = 0; k < 4; k++)
+                    {
+                        float x = (i + (k & 1)) * cellSize;
+                        float z = (j + (k >> 1)) * cellSize;
+                        v[k] = Vec3::Create(x, Height(x, z), z);
+                    }
+                    PhysicsModelFace face;
+                    face.Vertices[0] = v[0]; face.Vertices[1] = v[2]; face.Vertices[2] = v[1];
+                    face.Normal = Vec3::Cross(v[2] - v[0], v[1] - v[0]).Normalize();
+                    builder.AddFace(face);
+                    face.Vertices[0] = v[1]; face.Vertices[1] = v[2]; face.Vertices[2] = v[3];
+                    face.Normal = Vec3::Cross(v[2] - v[1], v[3] - v[1]).Normalize();
+                    builder.AddFace(face);
+                }
+            }
+            return builder.GetModel();
+        }
+        static RefPtr<PhysicsModel> CreateTriangleSoup(Random & random, int faceCount)
+        {
+            PhysicsModelBuilder builder;
+            for (int i = 0; i < faceCount; i++)
+            {
+                PhysicsModelFace face;
+                auto center = Vec3::Create(random.NextFloat(-50.0f, 50.0f), random.NextFloat(-50.0f, 50.0f), random.NextFloat(-50.0f, 50.0f));
+                for (int j = 0; j < 3; j++)
+                    face.Vertices[j] = center + Vec3::Create(random.NextFloat(-3.0f, 3.0f), random.NextFloat(-3.0f, 3.0f), random.NextFloat(-3.0f, 3.0f));
+                face.Normal = Vec3::Cross(face.Vertices[1] - face.Vertices[0], face.Vertices[2] - face.Vertices[0]).Normalize();
+                builder.AddFace(face);
+            }
+            return builder.GetModel();
+        }
+        static Ray RandomRay(Random & random, CoreLib::Graphics::BBox bounds)
+        {
+            Ray ray;
+            ray.Origin = Vec3::Create(random.NextFloat(bounds.xMin, bounds.xMax), bounds.yMax + 20.0f, random.NextFloat(bounds.zMin, bounds.zMax));
+            auto target = Vec3::Create(random.NextFloat(bounds.xMin, bounds.xMax), bounds.yMin, random.NextFloat(bounds.zMin, bounds.zMax));
+            ray.Dir = (target - ray.Origin).Normalize();
+            return ray;
+        }
+        static void CheckMatchesLinearScan(PhysicsModel * model, Random & random, bool fromOutside)
+        {
+            int hitCount = 0;
+            for (int i = 0; i < 2000; i++)
+            {
+                Ray ray;
+                if (fromOutside)
+                    ray = RandomRay(random, model->GetBounds());
+                else
+                {
+                    ray.Origin = Vec3::Create(random.NextFloat(-60.0f, 60.0f), random.NextFloat(-60.0f, 60.0f), random.NextFloat(-60.0f, 60.0f));
+                    ray.Dir = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)).Normalize();
+                }
+                // every eighth ray is axis aligned to exercise zero direction components
+                if (i % 8 == 0)
+                    ray.Dir = Vec3::Create(0.0f, -1.0f, 0.0f);
+                float tmax = (i % 3 == 0) ? 30.0f : FLT_MAX;
+                auto expected = model->TraceRayLinear(ray.Origin, ray.Dir, 0.0f, tmax);
+                auto result = model->TraceRay(ray.Origin, ray.Dir, 0.0f, tmax);
+                Assert::IsTrue(result.IsHit == expected.IsHit);
+                if (expected.IsHit)
+                {
+                    Assert::IsTrue(result.Distance == expected.Distance);
+                    Assert::IsTrue((result.Position - expected.Position).Length() < 1e-3f);
+                    hitCount++;
+                }
+            }
+            Assert::IsTrue(hitCount > 100 && hitCount < 2000);
+        }
+    public:
+        TEST_METHOD(TraceRayMatchesLinearScan)
+        {
+            Random random(31);
+            auto terrain = CreateTerrain(20000, 200.0f);
+            Assert::IsTrue(terrain->GetBvhNodeCount() > 1);
+            CheckMatchesLinearScan(terrain.Ptr(), random, true);
+            auto soup = CreateTriangleSoup(random, 5000);
+            CheckMatchesLinearScan(soup.Ptr(), random, false);
+        }
+        TEST_METHOD(SerializedModelTracesIdentically)
+        {
+            Random random(7);
+            auto model = CreateTriangleSoup(random, 3000);
+            MemoryStream writeStream;
+            model->SaveToStream(&writeStream);
+            MemoryStream readStream((unsigned char*)writeStream.GetBuffer(), (int)writeStream.GetPosition());
+            PhysicsModel loaded;
+            loaded.LoadFromStream(&readStream);
+            Assert::IsTrue(readStream.IsEnd());
+            Assert::IsTrue(loaded.GetFaceCount() == model->GetFaceCount());
+            Assert::IsTrue(loaded.GetBvhNodeCount() == model->GetBvhNodeCount());
+            Assert::IsTrue(loaded.GetBounds() == model->GetBounds());
+            for (int i = 0; i < 500; i++)
+            {
+                auto origin = Vec3::Create(random.NextFloat(-60.0f, 60.0f), random.NextFloat(-60.0f, 60.0f), random.NextFloat(-60.0f, 60.0f));
+                auto dir = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)).Normalize();
+                auto expected = model->TraceRay(origin, dir, 0.0f, FLT_MAX);
+                auto result = loaded.TraceRay(origin, dir, 0.0f, FLT_MAX);
+                Assert::IsTrue(result.IsHit == expected.IsHit);
+                Assert::IsTrue(result.FaceId == expected.FaceId);
+                Assert::IsTrue(result.Distance == expected.Distance);
+            }
+
+            // data written by a different version is rejected
+            ((int*)writeStream.GetBuffer())[0] = PhysicsModelFileVersion + 1;
+            MemoryStream badStream((unsigned char*)writeStream.GetBuffer(), (int)writeStream.GetPosition());
+            bool rejected = false;
+            try
+            {
+                loaded.LoadFromStream(&badStream);
+            }
+            catch (const IOException &)
+            {
+                rejected = true;
+            }
+            Assert::IsTrue(rejected);
+
+            // so is a tree whose root points back at itself, it would make TraceRay loop or drop nodes
+            ((int*)writeStream.GetBuffer())[0] = PhysicsModelFileVersion;
+            int rootOffset = (int)(sizeof(int) * 3 + sizeof(CoreLib::Graphics::BBox) + sizeof(PhysicsModel::MeshFace) * model->GetFaceCount());
+            auto root = (BvhNode*)((unsigned char*)writeStream.GetBuffer() + rootOffset);
+            Assert::IsTrue(root->ElementCount == 0);
+            root->ChildOffset = 0;
+            MemoryStream cyclicStream((unsigned char*)writeStream.GetBuffer(), (int)writeStream.GetPosition());
+            rejected = false;
+            try
+            {
+                loaded.LoadFromStream(&cyclicStream);
+            }
+            catch (const IOException &)
+            {
+                rejected = true;
+            }
+            Assert::IsTrue(rejected);
+        }
+        BEGIN_TEST_METHOD_ATTRIBUTE(TraceRayThroughput)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(TraceRayThroughput)
+        {
+            Random random(5);
+            for (int faceCount = 1000; faceCount <= 1000000; faceCount *= 10)
+            {
+                auto model = CreateTerrain(faceCount, 1000.0f);
+                List<Ray> rays;
+                for (int i = 0; i < 100000; i++)
+                    rays.Add(RandomRay(random, model->GetBounds()));
+                // limit the linear scan to roughly 2^24 triangle tests
+                int linearRayCount = Math::Clamp((1 << 24) / model->GetFaceCount(), 16, rays.Count());
+                int hits = 0;
+                auto timePoint = Diagnostics::PerformanceCounter::Start();
+                for (int i = 0; i < linearRayCount; i++)
+                    hits += model->TraceRayLinear(rays[i].Origin, rays[i].Dir, 0.0f, FLT_MAX).IsHit;
+                double linearRaysPerSecond = linearRayCount / Diagnostics::PerformanceCounter::EndSeconds(timePoint);
+                timePoint = Diagnostics::PerformanceCounter::Start();
+                for (auto & ray : rays)
+                    hits += model->TraceRay(ray.Origin, ray.Dir, 0.0f, FLT_MAX).IsHit;
+                double bvhRaysPerSecond = rays.Count() / Diagnostics::PerformanceCounter::EndSeconds(timePoint);
+                char message[256];
+                snprintf(message, sizeof(message), "%d faces: linear %.0f rays/s, bvh %.0f rays/s (%.0fx), %d hits\n",
+                    model->GetFaceCount(), linearRaysPerSecond, bvhRaysPerSecond, bvhRaysPerSecond / linearRaysPerSecond, hits);
+                Logger::WriteMessage(message);
+            }
+        }
+    };
+}
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/Physics.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(PhysicsSceneTest)
+    {
+    private:
+        static RefPtr<PhysicsModel> CreateCube()
+        {
+            PhysicsModelBuilder builder;
+            // two triangles per face of the unit cube [-1, 1]^3
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (int side = -1; side <= 1; side += 2)
+                {
+                    Vec3 corners[4];
+                    for (int i = 0; i < 4; i++)
+                    {
+                        corners[i][axis] = (float)side;
+                        corners[i][(axis + 1) % 3] = (i == 1 || i == 2) ? 1.0f : -1.0f;
+                        corners[i][(axis + 2) % 3] = (i >= 2) ? 1.0f : -1.0f;
+                    }
+                    PhysicsModelFace face;
+                    face.Normal = Vec3::Create(0.0f);
+                    face.Normal[axis] = (float)side;
+                    face.Vertices[0] = corners[0]; face.Vertices[1] = corners[1]; face.Vertices[2] = corners[2];
+                    builder.AddFace(face);
+                    face.Vertices[0] = corners[0]; face.Vertices[1] = corners[2]; face.Vertices[2] = corners[3];
+                    builder.AddFace(face);
+                }
+            }
+            return builder.GetModel();
+        }
+        static Vec3 RandomVec(Random & random, float range)
+        {
+            return Vec3::Create(random.NextFloat(-range, range), random.NextFloat(-range, range), random.NextFloat(-range, range));
+        }
+        static void PlaceObject(Random & random, PhysicsObject * obj)
+        {
+            Matrix4 transform, scale;
+            Matrix4::Scale(scale, random.NextFloat(0.5f, 3.0f), random.NextFloat(0.5f, 3.0f), random.NextFloat(0.5f, 3.0f));
+            Matrix4::Translation(transform, random.NextFloat(-200.0f, 200.0f), random.NextFloat(-200.0f, 200.0f), random.NextFloat(-200.0f, 200.0f));
+            Matrix4::Multiply(transform, transform, scale);
+            obj->SetModelTransform(transform);
+        }
+        // the linear scan PhysicsScene used before it had a broadphase
+        static TraceResult BruteForce(List<RefPtr<PhysicsObject>> & objects, const Ray & ray, PhysicsChannels channels)
+        {
+            TraceResult rs;
+            float best = 1e30f;
+            for (auto & obj : objects)
+            {
+                if ((obj->Channels.value & channels.value) == 0)
+                    continue;
+                auto objOrigin = obj->GetInverseModelTransform().TransformHomogeneous(ray.Origin);
+                auto objDir = obj->GetInverseModelTransform().TransformNormal(ray.Dir).Normalize();
+                auto hit = obj->GetModel()->TraceRay(objOrigin, objDir, 0.0f, 1e30f);
+                if (hit.IsHit)
+                {
+                    float dist = (ray.Origin - obj->GetModelTransform().TransformHomogeneous(hit.Position)).Length();
+                    if (dist < best)
+                    {
+                        best = dist;
+                        rs.Object = obj.Ptr();
+                        rs.Distance = dist;
+                    }
+                }
+            }
+            return rs;
+        }
+        static bool Overlaps(CoreLib::Graphics::BBox a, CoreLib::Graphics::BBox b)
+        {
+            return a.xMin <= b.xMax && a.yMin <= b.yMax && a.zMin <= b.zMax &&
+                a.xMax >= b.xMin && a.yMax >= b.yMin && a.zMax >= b.zMin;
+        }
+        static float DistanceToBox(CoreLib::Graphics::BBox box, Vec3 p)
+        {
+            Vec3 closest = Vec3::Create(Math::Clamp(p.x, box.xMin, box.xMax), Math::Clamp(p.y, box.yMin, box.yMax), Math::Clamp(p.z, box.zMin, box.zMax));
+            return (closest - p).Length();
+        }
+        static void CheckQueries(PhysicsScene & scene, List<RefPtr<PhysicsObject>> & objects, Random & random)
+        {
+            List<Ray> rays;
+            List<PhysicsChannels> channels;
+            for (int i = 0; i < 200; i++)
+            {
+                Ray ray;
+                ray.Origin = RandomVec(random, 250.0f);
+                // aim most rays close to an object so that both hits and misses are covered
+                if (i % 4)
+                {
+                    auto target = objects[random.Next(0, objects.Count())]->GetModelTransform().GetTranslation() + RandomVec(random, 3.0f);
+                    ray.Dir = (target - ray.Origin).Normalize();
+                }
+                else
+                    ray.Dir = RandomVec(random, 1.0f).Normalize();
+                rays.Add(ray);
+                channels.Add(i & 1 ? PhysicsChannels::All : PhysicsChannels::Collision);
+            }
+            List<TraceResult> batchResults;
+            batchResults.SetSize(rays.Count());
+            scene.RayTraceFirst(rays.GetArrayView(), batchResults.GetArrayView());
+            int hitCount = 0;
+            for (int i = 0; i < rays.Count(); i++)
+            {
+                auto expected = BruteForce(objects, rays[i], channels[i]);
+                auto result = scene.RayTraceFirst(rays[i], channels[i]);
+                Assert::IsTrue(result.Object == expected.Object);
+                if (expected.Object)
+                {
+                    Assert::IsTrue(fabs(result.Distance - expected.Distance) < 1e-3f);
+                    hitCount++;
+                }
+                if (channels[i].value == PhysicsChannels::All)
+                    Assert::IsTrue(batchResults[i].Object == expected.Object);
+            }
+            Assert::IsTrue(hitCount > 50 && hitCount < 200);
+
+            List<PhysicsObject*> overlaps;
+            for (int i = 0; i < 50; i++)
+            {
+                CoreLib::Graphics::BBox box;
+                box.Min = RandomVec(random, 200.0f);
+                box.Max = box.Min + Vec3::Create(random.NextFloat(0.0f, 60.0f));
+                scene.QueryOverlap(box, overlaps);
+                int expectedCount = 0;
+                for (auto & obj : objects)
+                {
+                    if (Overlaps(obj->GetBounds(), box))
+                    {
+                        expectedCount++;
+                        Assert::IsTrue(overlaps.Contains(obj.Ptr()));
+                    }
+                }
+                Assert::IsTrue(overlaps.Count() == expectedCount);
+
+                auto center = RandomVec(random, 200.0f);
+                float radius = random.NextFloat(1.0f, 40.0f);
+                scene.QueryOverlap(center, radius, overlaps);
+                expectedCount = 0;
+                for (auto & obj : objects)
+                {
+                    if (DistanceToBox(obj->GetBounds(), center) <= radius)
+                    {
+                        expectedCount++;
+                        Assert::IsTrue(overlaps.Contains(obj.Ptr()));
+                    }
+                }
+                Assert::IsTrue(overlaps.Count() == expectedCount);
+            }
+        }
+    public:
+        TEST_METHOD(QueriesMatchLinearScan)
+        {
+            Random random(17);
+            auto cube = CreateCube();
+            PhysicsScene scene;
+            List<RefPtr<PhysicsObject>> objects;
+            for (int i = 0; i < 2000; i++)
+            {
+                RefPtr<PhysicsObject> obj = new PhysicsObject(cube.Ptr());
+                PlaceObject(random, obj.Ptr());
+                obj->Channels = i % 3 ? PhysicsChannels::All : PhysicsChannels::Visiblity;
+                scene.AddObject(obj.Ptr());
+                objects.Add(obj);
+            }
+            CheckQueries(scene, objects, random);
+            Assert::IsTrue(scene.GetBroadphaseHeight() < 32);
+        }
+        TEST_METHOD(TickUpdatesMovedObjects)
+        {
+            Random random(23);
+            auto cube = CreateCube();
+            PhysicsScene scene;
+            List<RefPtr<PhysicsObject>> objects;
+            for (int i = 0; i < 500; i++)
+            {
+                RefPtr<PhysicsObject> obj = new PhysicsObject(cube.Ptr());
+                PlaceObject(random, obj.Ptr());
+                scene.AddObject(obj.Ptr());
+                objects.Add(obj);
+            }
+            // move a third of the objects far away and remove some others
+            for (int i = 0; i < objects.Count(); i += 3)
+                PlaceObject(random, objects[i].Ptr());
+            for (int i = objects.Count() - 1; i >= 0; i -= 7)
+            {
+                scene.RemoveObject(objects[i].Ptr());
+                objects.RemoveAt(i);
+            }
+            scene.Tick();
+            for (auto & obj : objects)
+                Assert::IsFalse(obj->CheckModelTransformDirtyBit());
+            CheckQueries(scene, objects, random);
+        }
+    };
+}
@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/Skeleton.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(PoseEvaluationCacheTest)
+    {
+    private:
+        static void BuildChain(Skeleton & skeleton, Pose & pose, int boneCount)
+        {
+            for (int i = 0; i < boneCount; i++)
+            {
+                Bone bone;
+                bone.ParentId = i - 1;
+                bone.Name = String("bone") + String(i);
+                bone.BindPose.Translation = Vec3::Create(0.0f, i == 0 ? 0.0f : 1.0f, 0.0f);
+                skeleton.Bones.Add(bone);
+                skeleton.BoneMapping[bone.Name] = i;
+                Matrix4 inversePose;
+                Matrix4::CreateIdentityMatrix(inversePose);
+                inversePose.values[13] = -(float)i;
+                skeleton.InversePose.Add(inversePose);
+            }
+            pose.Transforms.SetSize(boneCount);
+            for (int i = 0; i < boneCount; i++)
+            {
+                pose.Transforms[i] = skeleton.Bones[i].BindPose;
+                pose.Transforms[i].Rotation = Quaternion::FromAxisAngle(Vec3::Create(0.0f, 0.0f, 1.0f), 0.1f * i);
+            }
+        }
+        static bool MatricesEqual(const Matrix4 & a, const Matrix4 & b, float epsilon)
+        {
+            for (int i = 0; i < 16; i++)
+                if (fabs(a.values[i] - b.values[i]) > epsilon)
+                    return false;
+            return true;
+        }
+    public:
+        TEST_METHOD(MatchesPoseMatrices)
+        {
+            Skeleton skeleton;
+            Pose pose;
+            BuildChain(skeleton, pose, 6);
+            List<Matrix4> expected;
+            pose.GetMatrices(&skeleton, expected);
+
+            PoseEvaluationCache cache;
+            cache.Evaluate(&skeleton, pose, nullptr);
+            Assert::IsTrue(cache.Matrices.Count() == 6);
+            Assert::IsTrue(cache.BoneTransforms.Count() == 6);
+            for (int i = 0; i < expected.Count(); i++)
+            {
+                Assert::IsTrue(MatricesEqual(cache.Matrices[i], expected[i], 0.0f));
+                Assert::IsTrue(MatricesEqual(cache.BoneTransforms[i].ToMatrix(), expected[i], 1e-5f));
+            }
+        }
+        TEST_METHOD(ReevaluatesOnlyWhenInvalidated)
+        {
+            Skeleton skeleton;
+            Pose pose;
+            BuildChain(skeleton, pose, 4);
+            PoseEvaluationCache cache;
+            cache.Evaluate(&skeleton, pose, nullptr);
+            auto matrixBuffer = cache.Matrices.Buffer();
+            auto dqBuffer = cache.BoneTransforms.Buffer();
+            Matrix4 first = cache.Matrices[3];
+
+            // a changed pose is not picked up until the owner invalidates the cache
+            pose.Transforms[1].Rotation = Quaternion::FromAxisAngle(Vec3::Create(1.0f, 0.0f, 0.0f), 0.5f);
+            cache.Evaluate(&skeleton, pose, nullptr);
+            Assert::IsTrue(MatricesEqual(cache.Matrices[3], first, 0.0f));
+
+            cache.Invalidate();
+            cache.Evaluate(&skeleton, pose, nullptr);
+            Assert::IsFalse(MatricesEqual(cache.Matrices[3], first, 1e-3f));
+            List<Matrix4> expected;
+            pose.GetMatrices(&skeleton, expected);
+            Assert::IsTrue(MatricesEqual(cache.Matrices[3], expected[3], 0.0f));
+
+            // steady state evaluation reuses the buffers
+            Assert::IsTrue(cache.Matrices.Buffer() == matrixBuffer);
+            Assert::IsTrue(cache.BoneTransforms.Buffer() == dqBuffer);
+        }
+    };
+}
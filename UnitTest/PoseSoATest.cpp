@@ -0,0 +1,290 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/PoseSoA.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(PoseSoATest)
+    {
+    private:
+        static Quaternion RandomRotation(Random & random)
+        {
+            auto axis = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), 1.0f).Normalize();
+            return Quaternion::FromAxisAngle(axis, random.NextFloat(-3.0f, 3.0f));
+        }
+        static BoneTransformation RandomTransform(Random & random)
+        {
+            BoneTransformation t;
+            t.Rotation = RandomRotation(random);
+            t.Translation = Vec3::Create(random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f), random.NextFloat(-2.0f, 2.0f));
+            t.Scale = Vec3::Create(random.NextFloat(0.5f, 2.0f), random.NextFloat(0.5f, 2.0f), random.NextFloat(0.5f, 2.0f));
+            return t;
+        }
+        // a tree of boneCount bones in which every parent precedes its children; the last two bones are not animated
+        static void BuildSkeleton(Skeleton & skeleton, int boneCount, Random & random)
+        {
+            for (int i = 0; i < boneCount; i++)
+            {
+                Bone bone;
+                bone.ParentId = i == 0 ? -1 : random.Next(0, i);
+                bone.Name = String("bone") + String(i);
+                bone.BindPose = RandomTransform(random);
+                skeleton.Bones.Add(bone);
+                if (i < boneCount - 2)
+                    skeleton.BoneMapping[bone.Name] = i;
+                Matrix4 inversePose;
+                RandomTransform(random).ToMatrix().Inverse(inversePose);
+                skeleton.InversePose.Add(inversePose);
+            }
+        }
+        static void BuildPose(Pose & pose, int boneCount, Random & random)
+        {
+            pose.Transforms.SetSize(boneCount);
+            for (int i = 0; i < boneCount; i++)
+                pose.Transforms[i] = RandomTransform(random);
+        }
+        // Pose::GetMatrices one bone at a time, without morph states
+        static void ReferenceMatrices(const Skeleton & skeleton, const Pose & pose, RetargetFile * retarget, List<Matrix4> & matrices)
+        {
+            matrices.SetSize(skeleton.Bones.Count());
+            for (int i = 0; i < matrices.Count(); i++)
+                matrices[i] = retarget ? retarget->RetargetedBindPose[i].ToMatrix() : skeleton.Bones[i].BindPose.ToMatrix();
+            for (int i = 0; i < skeleton.BoneMapping.Count(); i++)
+            {
+                BoneTransformation transform;
+                if (retarget)
+                {
+                    int targetId = retarget->ModelBoneIdToAnimationBoneId[i];
+                    if (targetId != -1)
+                        transform = pose.Transforms[targetId];
+                    if (i == 0)
+                    {
+                        transform.Translation.x *= retarget->RootTranslationScale.x;
+                        transform.Translation.y *= retarget->RootTranslationScale.y;
+                        transform.Translation.z *= retarget->RootTranslationScale.z;
+                    }
+                    else
+                        transform.Translation = retarget->RetargetedBindPose[i].Translation;
+                    matrices[i] = (retarget->PreRotations[i] * transform.Rotation * retarget->PostRotations[i]).ToMatrix4();
+                    matrices[i].SetTranslation(transform.Translation);
+                }
+                else
+                {
+                    transform = pose.Transforms[i];
+                    if (i != 0)
+                        transform.Translation = skeleton.Bones[i].BindPose.Translation;
+                    matrices[i] = transform.ToMatrix();
+                }
+            }
+            for (int i = 1; i < matrices.Count(); i++)
+                Matrix4::Multiply(matrices[i], matrices[skeleton.Bones[i].ParentId], matrices[i]);
+            for (int i = 0; i < matrices.Count(); i++)
+                Matrix4::Multiply(matrices[i], matrices[i], retarget ? retarget->RetargetedInversePose[i] : skeleton.InversePose[i]);
+        }
+        static bool MatricesEqual(const Matrix4 & a, const Matrix4 & b, float epsilon)
+        {
+            for (int i = 0; i < 16; i++)
+                if (fabs(a.values[i] - b.values[i]) > epsilon)
+                    return false;
+            return true;
+        }
+        static float RotationAngle(Quaternion q0, Quaternion q1)
+        {
+            q0 = q0 * (1.0f / q0.Length());
+            q1 = q1 * (1.0f / q1.Length());
+            if (Quaternion::Dot(q0, q1) < 0.0f)
+                q1 = -q1;
+            return 4.0f * asinf(Math::Min(1.0f, (q0 - q1).Length() * 0.5f));
+        }
+        static bool TransformsEqual(const BoneTransformation & a, const BoneTransformation & b, float epsilon)
+        {
+            return RotationAngle(a.Rotation, b.Rotation) <= epsilon && (a.Translation - b.Translation).Length() <= epsilon &&
+                (a.Scale - b.Scale).Length() <= epsilon;
+        }
+        static SkeletalAnimation CreateAnimation(const Skeleton & skeleton, Random & random)
+        {
+            SkeletalAnimation anim;
+            anim.Name = "test";
+            anim.Speed = 1.0f;
+            anim.Duration = 2.0f;
+            anim.FPS = 30.0f;
+            // every other bone is animated, plus a channel for a bone the skeleton does not have
+            for (int i = 0; i < skeleton.Bones.Count() + 2; i += 2)
+            {
+                AnimationChannel channel;
+                channel.BoneName = i < skeleton.Bones.Count() ? skeleton.Bones[i].Name : String("missing");
+                float speed = random.NextFloat(0.5f, 2.0f);
+                auto axis = Vec3::Create(random.NextFloat(-1.0f, 1.0f), 1.0f, random.NextFloat(-1.0f, 1.0f)).Normalize();
+                for (int f = 0; f <= 60; f++)
+                {
+                    AnimationKeyFrame keyFrame;
+                    keyFrame.Time = f / 30.0f;
+                    keyFrame.Transform.Rotation = Quaternion::FromAxisAngle(axis, sinf(keyFrame.Time * speed * 3.0f) * 2.0f);
+                    keyFrame.Transform.Translation = Vec3::Create(keyFrame.Time * speed, 1.0f, 0.0f);
+                    keyFrame.Transform.Scale = Vec3::Create(1.0f + 0.2f * sinf(keyFrame.Time), 1.0f, 1.0f);
+                    channel.KeyFrames.Add(keyFrame);
+                }
+                anim.Channels.Add(channel);
+            }
+            return anim;
+        }
+    public:
+        TEST_METHOD(MatchesScalarPoseMatrices)
+        {
+            Random random(17);
+            Skeleton skeleton;
+            Pose pose;
+            BuildSkeleton(skeleton, 23, random);
+            BuildPose(pose, 23, random);
+            List<Matrix4> expected, matrices, soaMatrices;
+            ReferenceMatrices(skeleton, pose, nullptr, expected);
+            pose.GetMatrices(&skeleton, matrices);
+            PoseSoA soaPose;
+            soaPose.FromPose(pose);
+            ComputePoseMatrices(soaMatrices, &skeleton, soaPose);
+            Assert::AreEqual(expected.Count(), matrices.Count());
+            for (int i = 0; i < expected.Count(); i++)
+            {
+                // same arithmetic in the same order
+                Assert::IsTrue(MatricesEqual(matrices[i], expected[i], 0.0f));
+                Assert::IsTrue(MatricesEqual(soaMatrices[i], expected[i], 0.0f));
+            }
+        }
+
+        TEST_METHOD(MatchesScalarRetargetedMatrices)
+        {
+            Random random(5);
+            Skeleton skeleton;
+            Pose pose;
+            BuildSkeleton(skeleton, 13, random);
+            BuildPose(pose, 9, random);
+            RetargetFile retarget;
+            retarget.SetBoneCount(13);
+            retarget.RootTranslationScale = Vec3::Create(0.5f, 2.0f, 1.0f);
+            for (int i = 0; i < 13; i++)
+            {
+                retarget.PreRotations[i] = RandomRotation(random);
+                retarget.PostRotations[i] = RandomRotation(random);
+                retarget.RetargetedBindPose[i] = RandomTransform(random);
+                retarget.ModelBoneIdToAnimationBoneId[i] = i == 3 ? -1 : (i * 5) % 9;
+                RandomTransform(random).ToMatrix().Inverse(retarget.RetargetedInversePose[i]);
+            }
+            List<Matrix4> expected, matrices;
+            ReferenceMatrices(skeleton, pose, &retarget, expected);
+            pose.GetMatrices(&skeleton, matrices, true, &retarget);
+            for (int i = 0; i < expected.Count(); i++)
+                Assert::IsTrue(MatricesEqual(matrices[i], expected[i], 0.0f));
+        }
+
+        TEST_METHOD(SamplingMatchesAnimationChannels)
+        {
+            Random random(3);
+            Skeleton skeleton;
+            BuildSkeleton(skeleton, 21, random);
+            auto anim = CreateAnimation(skeleton, random);
+            AnimationBinding binding(&skeleton, &anim);
+            // the last two bones and the missing bone are not driven
+            Assert::AreEqual(10, binding.Channels.Count());
+            PoseSoA pose;
+            for (float time = 0.0f; time <= anim.Duration + 0.1f; time += 0.037f)
+            {
+                SampleAnimation(pose, binding, time);
+                Assert::AreEqual(skeleton.Bones.Count(), pose.Count());
+                for (int i = 0; i < skeleton.Bones.Count(); i++)
+                {
+                    bool animated = (i & 1) == 0 && i < skeleton.Bones.Count() - 2;
+                    auto expected = animated ? anim.Channels[i / 2].Sample(time) : skeleton.Bones[i].BindPose;
+                    Assert::IsTrue(TransformsEqual(pose.Get(i), expected, 1e-4f));
+                }
+            }
+        }
+
+        TEST_METHOD(BlendsAndAddsPoses)
+        {
+            Random random(11);
+            Pose p0, p1;
+            BuildPose(p0, 13, random);
+            BuildPose(p1, 13, random);
+            // keep the rotations of the two poses within a radian, as between the clips of a blend
+            for (int i = 0; i < 13; i++)
+            {
+                auto axis = Vec3::Create(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), 1.0f).Normalize();
+                p1.Transforms[i].Rotation = p0.Transforms[i].Rotation * Quaternion::FromAxisAngle(axis, random.NextFloat(-1.0f, 1.0f));
+            }
+            PoseSoA pose0, pose1, blended;
+            pose0.FromPose(p0);
+            pose1.FromPose(p1);
+            BlendPoses(blended, pose0, pose1, 0.0f);
+            for (int i = 0; i < 13; i++)
+                Assert::IsTrue(TransformsEqual(blended.Get(i), p0.Transforms[i], 1e-5f));
+            BlendPoses(blended, pose0, pose1, 0.3f);
+            for (int i = 0; i < 13; i++)
+            {
+                auto expected = BoneTransformation::Lerp(p0.Transforms[i], p1.Transforms[i], 0.3f);
+                auto result = blended.Get(i);
+                // normalized lerp deviates slightly from slerp between distant rotations
+                Assert::IsTrue(RotationAngle(result.Rotation, expected.Rotation) < 0.02f);
+                Assert::IsTrue((result.Translation - expected.Translation).Length() < 1e-5f);
+                Assert::IsTrue((result.Scale - expected.Scale).Length() < 1e-5f);
+                Assert::AreEqual(1.0f, result.Rotation.Length(), 1e-5f);
+            }
+            BlendPoses(blended, pose0, pose1, 1.0f);
+            for (int i = 0; i < 13; i++)
+                Assert::IsTrue(TransformsEqual(blended.Get(i), p1.Transforms[i], 1e-5f));
+
+            // adding the difference of pose1 against pose0 on top of pose0 restores pose1
+            PoseSoA additive, added;
+            MakeAdditivePose(additive, pose1, pose0);
+            AddPose(added, pose0, additive, 1.0f);
+            for (int i = 0; i < 13; i++)
+                Assert::IsTrue(TransformsEqual(added.Get(i), p1.Transforms[i], 1e-4f));
+            AddPose(added, pose0, additive, 0.0f);
+            for (int i = 0; i < 13; i++)
+                Assert::IsTrue(TransformsEqual(added.Get(i), p0.Transforms[i], 1e-5f));
+            // results may alias an input
+            AddPose(pose0, pose0, additive, 1.0f);
+            for (int i = 0; i < 13; i++)
+                Assert::IsTrue(TransformsEqual(pose0.Get(i), p1.Transforms[i], 1e-4f));
+        }
+
+        TEST_METHOD(BatchMatchesSingleEvaluation)
+        {
+            Random random(8);
+            Skeleton skeleton;
+            BuildSkeleton(skeleton, 30, random);
+            auto anim = CreateAnimation(skeleton, random);
+            AnimationBinding binding(&skeleton, &anim);
+            const int instanceCount = 40;
+            List<PoseSoA> poses;
+            List<List<Matrix4>> matrices;
+            List<PoseEvaluationTask> tasks;
+            poses.SetSize(instanceCount);
+            matrices.SetSize(instanceCount);
+            for (int i = 0; i < instanceCount; i++)
+            {
+                PoseEvaluationTask task;
+                task.Animation = &binding;
+                task.AnimationTime = i * 0.049f;
+                task.Pose = &poses[i];
+                task.Matrices = &matrices[i];
+                tasks.Add(task);
+            }
+            EvaluatePoses(tasks.GetArrayView());
+            PoseSoA pose;
+            List<Matrix4> expected;
+            for (int i = 0; i < instanceCount; i++)
+            {
+                SampleAnimation(pose, binding, i * 0.049f);
+                ComputePoseMatrices(expected, &skeleton, pose);
+                Assert::AreEqual(expected.Count(), matrices[i].Count());
+                for (int j = 0; j < expected.Count(); j++)
+                    Assert::IsTrue(MatricesEqual(matrices[i][j], expected[j], 0.0f));
+            }
+        }
+    };
+}
@@ -166,5 +166,134 @@ namespace UnitTest
 
 			Assert::IsTrue(val.t == val1.t && val.b == val1.b);
 		}
+
+		struct CustomType
+		{
+			int t = 0;
+			String b;
+			void Serialize(StringBuilder & sb)
+			{
+				sb << t << " " << CoreLib::Text::EscapeStringLiteral(b);
+			}
+			void Parse(CoreLib::Text::TokenReader & parser)
+			{
+				t = parser.ReadInt();
+				b = parser.ReadStringLiteral();
+			}
+		};
+		struct BlobType
+		{
+			int a;
+			float b;
+			short c[3];
+		};
+		struct BinaryContainer : public PropertyContainer
+		{
+		public:
+			PROPERTY(int, intProp);
+			PROPERTY(float, floatProp);
+			PROPERTY(double, doubleProp);
+			PROPERTY(String, stringProp);
+			PROPERTY(bool, boolProp);
+			PROPERTY(VectorMath::Vec3, vec3Prop);
+			PROPERTY(VectorMath::Matrix4, mat4Prop);
+			PROPERTY(CoreLib::List<String>, strListProp);
+			PROPERTY(CoreLib::List<VectorMath::Vec3>, vec3ListProp);
+			PROPERTY(BlobType, blobProp);
+			PROPERTY(CustomType, customProp);
+		};
+
+		TEST_METHOD(BinaryRoundTrip)
+		{
+			BinaryContainer c;
+			c.intProp = -42;
+			c.floatProp = 3.14159274f;
+			c.doubleProp = 2.718281828459045;
+			c.stringProp = String("binary \"string\"\n");
+			c.boolProp = true;
+			c.vec3Prop = VectorMath::Vec3::Create(1.0f, -2.0f, 3.5f);
+			VectorMath::Matrix4 mat;
+			VectorMath::Matrix4::CreateRandomMatrix(mat);
+			c.mat4Prop = mat;
+			List<String> strings;
+			strings.Add("first");
+			strings.Add("");
+			strings.Add("third");
+			c.strListProp = strings;
+			List<VectorMath::Vec3> vectors;
+			vectors.Add(VectorMath::Vec3::Create(1.0f, 2.0f, 3.0f));
+			vectors.Add(VectorMath::Vec3::Create(-4.0f, 5.0f, -6.0f));
+			c.vec3ListProp = vectors;
+			BlobType blob = { 7, 0.5f, { 1, -2, 3 } };
+			c.blobProp = blob;
+			CustomType custom;
+			custom.t = 1682;
+			custom.b = "test str";
+			c.customProp = custom;
+
+			RefPtr<IO::MemoryStream> stream = new IO::MemoryStream();
+			IO::BinaryWriter writer(stream);
+			for (auto prop : c.GetPropertyList())
+				prop->WriteBinary(writer);
+
+			BinaryContainer c1;
+			IO::BinaryReader reader(new IO::MemoryStream((unsigned char*)stream->GetBuffer(), stream->GetBufferSize()));
+			for (auto prop : c1.GetPropertyList())
+				prop->ReadBinary(reader);
+			Assert::IsTrue(reader.GetStream()->IsEnd());
+
+			Assert::AreEqual(c1.intProp.GetValue(), -42);
+			Assert::IsTrue(c1.floatProp.GetValue() == 3.14159274f);
+			Assert::IsTrue(c1.doubleProp.GetValue() == 2.718281828459045);
+			Assert::IsTrue(c1.stringProp.GetValue() == c.stringProp.GetValue());
+			Assert::IsTrue(c1.boolProp.GetValue());
+			Assert::IsTrue((c1.vec3Prop.GetValue() - c.vec3Prop.GetValue()).Length2() == 0.0f);
+			for (int i = 0; i < 16; i++)
+				Assert::IsTrue(c1.mat4Prop.GetValue().values[i] == mat.values[i]);
+			auto strings1 = c1.strListProp.GetValue();
+			Assert::AreEqual(strings1.Count(), strings.Count());
+			for (int i = 0; i < strings.Count(); i++)
+				Assert::IsTrue(strings1[i] == strings[i]);
+			auto vectors1 = c1.vec3ListProp.GetValue();
+			Assert::AreEqual(vectors1.Count(), vectors.Count());
+			for (int i = 0; i < vectors.Count(); i++)
+				Assert::IsTrue((vectors1[i] - vectors[i]).Length2() == 0.0f);
+			auto blob1 = c1.blobProp.GetValue();
+			Assert::IsTrue(blob1.a == 7 && blob1.b == 0.5f && blob1.c[0] == 1 && blob1.c[1] == -2 && blob1.c[2] == 3);
+			Assert::IsTrue(c1.customProp->t == 1682 && c1.customProp->b == "test str");
+		}
+
+		TEST_METHOD(UIntBinaryRoundTrip)
+		{
+			GenericProperty<unsigned int> p;
+			p.SetValue(0xFFFFFFF0u);
+			RefPtr<IO::MemoryStream> stream = new IO::MemoryStream();
+			IO::BinaryWriter writer(stream);
+			p.WriteBinary(writer);
+
+			GenericProperty<unsigned int> p1;
+			IO::BinaryReader reader(new IO::MemoryStream((unsigned char*)stream->GetBuffer(), stream->GetBufferSize()));
+			p1.ReadBinary(reader);
+			Assert::IsTrue(p1.GetValue() == 0xFFFFFFF0u);
+		}
+
+		TEST_METHOD(BinaryReadNotifiesChanges)
+		{
+			GenericProperty<String> p;
+			p.SetValue("value");
+			RefPtr<IO::MemoryStream> stream = new IO::MemoryStream();
+			IO::BinaryWriter writer(stream);
+			p.WriteBinary(writer);
+
+			// like ParseValue, ReadBinary lets OnChanging adjust the new value
+			GenericProperty<String> p1;
+			int changedCount = 0;
+			p1.OnChanging.Bind([](String & newValue) { newValue = newValue + " changed"; });
+			p1.OnChanged.Bind([&]() { changedCount++; });
+			IO::BinaryReader reader(new IO::MemoryStream((unsigned char*)stream->GetBuffer(), stream->GetBufferSize()));
+			p1.ReadBinary(reader);
+			Assert::IsTrue(p1.GetValue() == "value changed");
+			Assert::AreEqual(changedCount, 1);
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/PerformanceCounter.h"
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::Diagnostics;
+
+namespace UnitTest
+{
+    static std::atomic<int> destroyedObjects;
+
+    class SingleThreadObject : public RefObject
+    {
+    public:
+        int Value = 0;
+        ~SingleThreadObject()
+        {
+            destroyedObjects++;
+        }
+    };
+
+    class SharedObject : public AtomicRefObject
+    {
+    public:
+        int Value = 0;
+        ~SharedObject()
+        {
+            destroyedObjects++;
+        }
+    };
+
+    class DerivedSharedObject : public SharedObject
+    {
+    };
+
+    TEST_CLASS(RefPtrTest)
+    {
+    private:
+        template<typename T>
+        static double CopyReferences(const RefPtr<T> & source, int threadCount, int iterations, bool sharedObject)
+        {
+            List<RefPtr<T>> sources;
+            for (int i = 0; i < threadCount; i++)
+                sources.Add(sharedObject ? source : RefPtr<T>(new T()));
+            std::atomic<int> ready;
+            ready = 0;
+            std::atomic<int> checksum;
+            checksum = 0;
+            List<std::thread> threads;
+            auto start = PerformanceCounter::Start();
+            for (int t = 0; t < threadCount; t++)
+            {
+                threads.Add(std::thread([&, t]()
+                {
+                    ready++;
+                    while (ready.load() < threadCount)
+                        ;
+                    auto & ptr = sources[t];
+                    int sum = 0;
+                    for (int i = 0; i < iterations; i++)
+                    {
+                        RefPtr<T> copy = ptr;
+                        sum += copy->Value;
+                    }
+                    checksum += sum;
+                }));
+            }
+            for (auto & thread : threads)
+                thread.join();
+            return PerformanceCounter::EndSeconds(start);
+        }
+    public:
+        TEST_METHOD(SharedAcrossThreads)
+        {
+            destroyedObjects = 0;
+            {
+                RefPtr<SharedObject> obj = new SharedObject();
+                List<std::thread> threads;
+                for (int t = 0; t < 4; t++)
+                {
+                    threads.Add(std::thread([obj]()
+                    {
+                        for (int i = 0; i < 100000; i++)
+                        {
+                            RefPtr<SharedObject> copy = obj;
+                            RefPtr<SharedObject> moved = _Move(copy);
+                        }
+                    }));
+                }
+                for (auto & thread : threads)
+                    thread.join();
+                Assert::AreEqual(0, destroyedObjects.load());
+            }
+            Assert::AreEqual(1, destroyedObjects.load());
+        }
+        TEST_METHOD(LastReleaseOnAnyThreadDestroysOnce)
+        {
+            destroyedObjects = 0;
+            for (int round = 0; round < 200; round++)
+            {
+                RefPtr<SharedObject> obj = new SharedObject();
+                List<std::thread> threads;
+                for (int t = 0; t < 4; t++)
+                    threads.Add(std::thread([copy = obj]() mutable { copy = nullptr; }));
+                obj = nullptr;
+                for (auto & thread : threads)
+                    thread.join();
+            }
+            Assert::AreEqual(200, destroyedObjects.load());
+        }
+        TEST_METHOD(WeakReferences)
+        {
+            destroyedObjects = 0;
+            WeakRefPtr<SharedObject> weak;
+            Assert::IsTrue(weak.IsExpired());
+            Assert::IsTrue(weak.Lock() == nullptr);
+            {
+                RefPtr<SharedObject> obj = new SharedObject();
+                obj->Value = 42;
+                weak = obj;
+                WeakRefPtr<SharedObject> weakCopy = weak;
+                Assert::IsFalse(weakCopy.IsExpired());
+                auto locked = weakCopy.Lock();
+                Assert::IsTrue(locked == obj.Ptr());
+                Assert::AreEqual(42, locked->Value);
+            }
+            Assert::AreEqual(1, destroyedObjects.load());
+            Assert::IsTrue(weak.IsExpired());
+            Assert::IsTrue(weak.Lock() == nullptr);
+            RefPtr<DerivedSharedObject> derived = new DerivedSharedObject();
+            RefPtr<SharedObject> base = derived;
+            Assert::IsTrue(base.As<DerivedSharedObject>() == derived.Ptr());
+        }
+        TEST_METHOD(WeakLockRacesWithRelease)
+        {
+            destroyedObjects = 0;
+            int lockedCount = 0;
+            for (int round = 0; round < 500; round++)
+            {
+                RefPtr<SharedObject> obj = new SharedObject();
+                WeakRefPtr<SharedObject> weak = obj;
+                std::atomic<bool> locked(false);
+                std::thread locker([&]()
+                {
+                    for (int i = 0; i < 50; i++)
+                    {
+                        auto strong = weak.Lock();
+                        if (strong)
+                        {
+                            strong->Value++;
+                            locked = true;
+                        }
+                    }
+                });
+                obj = nullptr;
+                locker.join();
+                if (locked)
+                    lockedCount++;
+                Assert::IsTrue(weak.IsExpired());
+            }
+            Assert::AreEqual(500, destroyedObjects.load());
+            Logger::WriteMessage(lockedCount > 0 ? "weak references locked before release" : "no lock won the race");
+        }
+        TEST_METHOD(SingleThreadCountUnchanged)
+        {
+            destroyedObjects = 0;
+            {
+                RefPtr<SingleThreadObject> a = new SingleThreadObject();
+                RefPtr<SingleThreadObject> b = a;
+                a = nullptr;
+                Assert::AreEqual(0, destroyedObjects.load());
+                auto raw = b.Release();
+                Assert::AreEqual(0, destroyedObjects.load());
+                delete raw;
+            }
+            Assert::AreEqual(1, destroyedObjects.load());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(ReferenceCountingBenchmark)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(ReferenceCountingBenchmark)
+        {
+            const int iterations = 10000000;
+            char message[256];
+            int threadCount = Math::Max(2, (int)std::thread::hardware_concurrency());
+            RefPtr<SingleThreadObject> singleThreadObj = new SingleThreadObject();
+            RefPtr<SharedObject> sharedObj = new SharedObject();
+            double plain = CopyReferences(singleThreadObj, 1, iterations, true);
+            double atomicOneThread = CopyReferences(sharedObj, 1, iterations, true);
+            double atomicPrivate = CopyReferences(sharedObj, threadCount, iterations, false);
+            double atomicContended = CopyReferences(sharedObj, threadCount, iterations, true);
+            snprintf(message, sizeof(message), "RefObject copy, one thread: %.2f ns", plain * 1e9 / iterations);
+            Logger::WriteMessage(message);
+            snprintf(message, sizeof(message), "AtomicRefObject copy, one thread: %.2f ns", atomicOneThread * 1e9 / iterations);
+            Logger::WriteMessage(message);
+            snprintf(message, sizeof(message), "AtomicRefObject copy, %d threads with their own objects: %.2f ns",
+                threadCount, atomicPrivate * 1e9 / iterations);
+            Logger::WriteMessage(message);
+            snprintf(message, sizeof(message), "AtomicRefObject copy, %d threads sharing one object: %.2f ns",
+                threadCount, atomicContended * 1e9 / iterations);
+            Logger::WriteMessage(message);
+        }
+    };
+}
@@ -0,0 +1,292 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/LibIO.h"
+#include "CoreLib/PerformanceCounter.h"
+#include "../GameEngineCore/ShaderCache.h"
+#include <stdio.h>
+#ifdef _WIN32
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace CoreLib::Diagnostics;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+    TEST_CLASS(ShaderCacheTest)
+    {
+    private:
+        // a directory of its own for the archive of one test, removed with the archive when the test ends;
+        // declare it before the caches so that their mapped archives are closed first
+        struct TempCacheDirectory
+        {
+            String Directory;
+            TempCacheDirectory(const char * testName)
+            {
+                Directory = String("ShaderCacheTest_") + testName;
+                RemoveArchives();
+                Path::CreateDir(Directory);
+            }
+            ~TempCacheDirectory()
+            {
+                RemoveArchives();
+                rmdir(Directory.Buffer());
+            }
+            void RemoveArchives()
+            {
+                for (auto lang : { TargetShadingLanguage::SPIRV, TargetShadingLanguage::HLSL })
+                {
+                    String fileName;
+                    {
+                        ShaderCache cache;
+                        cache.Load(Directory, lang);
+                        fileName = cache.GetFileName();
+                    }
+                    remove(fileName.Buffer());
+                }
+            }
+        };
+        static String MakeKey(int i, uint64_t sourceHash = 1)
+        {
+            return String("Shaders/Pass") + String(i % 7) + ".slang|vs_main|Material" + String(i) + "|" + String((unsigned long long)sourceHash, 16);
+        }
+        static void MakeEntry(int i, int codeSize, List<char> & code, List<DescriptorSetInfo> & layouts)
+        {
+            code.SetSize(codeSize);
+            for (int j = 0; j < codeSize; j++)
+                code[j] = (char)(i * 31 + j * 7);
+            layouts.Clear();
+            for (int s = 0; s < 1 + i % 3; s++)
+            {
+                DescriptorSetInfo set;
+                set.BindingPoint = s;
+                set.Name = String("set") + String(s);
+                for (int d = 0; d < 1 + (i + s) % 4; d++)
+                {
+                    DescriptorLayout desc(sfGraphics, d, d == 0 ? BindingType::UniformBuffer : BindingType::Texture, 1 + d % 2);
+                    desc.Name = set.Name + "_" + String(d);
+                    set.Descriptors.Add(desc);
+                }
+                layouts.Add(set);
+            }
+        }
+        static void CheckEntry(ShaderCache & cache, int i, int codeSize, uint64_t sourceHash = 1)
+        {
+            List<char> expectedCode, code;
+            List<DescriptorSetInfo> expectedLayouts, layouts;
+            MakeEntry(i, codeSize, expectedCode, expectedLayouts);
+            Assert::IsTrue(cache.TryGetEntry(MakeKey(i, sourceHash), code, layouts));
+            Assert::AreEqual(code.Count(), expectedCode.Count());
+            Assert::IsTrue(memcmp(code.Buffer(), expectedCode.Buffer(), code.Count()) == 0);
+            Assert::AreEqual(layouts.Count(), expectedLayouts.Count());
+            for (int s = 0; s < layouts.Count(); s++)
+            {
+                Assert::AreEqual(layouts[s].BindingPoint, expectedLayouts[s].BindingPoint);
+                Assert::IsTrue(layouts[s].Name == expectedLayouts[s].Name);
+                Assert::AreEqual(layouts[s].Descriptors.Count(), expectedLayouts[s].Descriptors.Count());
+                for (int d = 0; d < layouts[s].Descriptors.Count(); d++)
+                {
+                    auto & desc = layouts[s].Descriptors[d];
+                    auto & expected = expectedLayouts[s].Descriptors[d];
+                    Assert::IsTrue(desc.Name == expected.Name);
+                    Assert::IsTrue(desc.Type == expected.Type && desc.Stages == expected.Stages);
+                    Assert::AreEqual(desc.Location, expected.Location);
+                    Assert::AreEqual(desc.ArraySize, expected.ArraySize);
+                }
+            }
+        }
+        static void AddEntries(ShaderCache & cache, int begin, int end, int codeSize, uint64_t sourceHash = 1)
+        {
+            List<char> code;
+            List<DescriptorSetInfo> layouts;
+            for (int i = begin; i < end; i++)
+            {
+                MakeEntry(i, codeSize, code, layouts);
+                cache.UpdateEntry(MakeKey(i, sourceHash), code, layouts);
+            }
+        }
+        static void CreateCache(ShaderCache & cache, const TempCacheDirectory & dir)
+        {
+            String fileName;
+            {
+                ShaderCache existing;
+                existing.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+                fileName = existing.GetFileName();
+            }
+            // start from an empty archive
+            FileStream(fileName, FileMode::Create).Close();
+            cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+        }
+    public:
+        TEST_METHOD(EntriesLoadOnFirstUse)
+        {
+            TempCacheDirectory dir("EntriesLoadOnFirstUse");
+            {
+                ShaderCache cache;
+                CreateCache(cache, dir);
+                AddEntries(cache, 0, 20, 301);
+                Assert::IsTrue(cache.Save());
+            }
+            ShaderCache cache;
+            cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+            Assert::AreEqual(cache.GetEntryCount(), 20);
+            Assert::AreEqual(cache.GetLoadedEntryCount(), 0);
+            CheckEntry(cache, 3, 301);
+            CheckEntry(cache, 17, 301);
+            Assert::AreEqual(cache.GetLoadedEntryCount(), 2);
+            List<char> code;
+            List<DescriptorSetInfo> layouts;
+            Assert::IsFalse(cache.TryGetEntry(MakeKey(3, 2), code, layouts));
+            Assert::IsFalse(cache.TryGetEntry("missing", code, layouts));
+
+            ShaderCache otherLanguage;
+            otherLanguage.Load(dir.Directory, TargetShadingLanguage::HLSL);
+            Assert::AreEqual(otherLanguage.GetEntryCount(), 0);
+        }
+
+        TEST_METHOD(SaveAppendsSegments)
+        {
+            TempCacheDirectory dir("SaveAppendsSegments");
+            int64_t firstSize = 0;
+            List<unsigned char> firstBytes;
+            {
+                ShaderCache cache;
+                CreateCache(cache, dir);
+                AddEntries(cache, 0, 10, 64);
+                Assert::IsTrue(cache.Save());
+                firstBytes = File::ReadAllBytes(cache.GetFileName());
+                firstSize = firstBytes.Count();
+            }
+            {
+                ShaderCache cache;
+                cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+                // a source edit changes the key, replacing an entry keeps its key
+                AddEntries(cache, 10, 15, 64);
+                AddEntries(cache, 0, 2, 64, 2);
+                AddEntries(cache, 5, 6, 80);
+                Assert::IsTrue(cache.Save());
+                auto bytes = File::ReadAllBytes(cache.GetFileName());
+                Assert::IsTrue(bytes.Count() > firstSize);
+                Assert::IsTrue(memcmp(bytes.Buffer(), firstBytes.Buffer(), (size_t)firstSize) == 0);
+                // nothing new, nothing written
+                Assert::IsTrue(cache.Save());
+                Assert::AreEqual(File::ReadAllBytes(cache.GetFileName()).Count(), bytes.Count());
+            }
+            ShaderCache cache;
+            cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+            Assert::AreEqual(cache.GetEntryCount(), 17);
+            for (int i = 0; i < 15; i++)
+                CheckEntry(cache, i, i == 5 ? 80 : 64);
+            CheckEntry(cache, 0, 64, 2);
+            CheckEntry(cache, 1, 64, 2);
+        }
+
+        TEST_METHOD(InterruptedAppendIsIgnored)
+        {
+            TempCacheDirectory dir("InterruptedAppendIsIgnored");
+            String fileName;
+            int64_t firstSize = 0;
+            {
+                ShaderCache cache;
+                CreateCache(cache, dir);
+                fileName = cache.GetFileName();
+                AddEntries(cache, 0, 8, 100);
+                Assert::IsTrue(cache.Save());
+                firstSize = File::ReadAllBytes(fileName).Count();
+                AddEntries(cache, 8, 16, 100);
+                Assert::IsTrue(cache.Save());
+            }
+            // cut the second segment short, as if the process stopped while appending
+            auto bytes = File::ReadAllBytes(fileName);
+            File::WriteAllBytes(fileName, bytes.Buffer(), (size_t)(firstSize + (bytes.Count() - firstSize) / 2));
+            {
+                ShaderCache cache;
+                cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+                Assert::AreEqual(cache.GetEntryCount(), 8);
+                CheckEntry(cache, 7, 100);
+                AddEntries(cache, 8, 10, 100);
+                Assert::IsTrue(cache.Save());
+            }
+            ShaderCache cache;
+            cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+            Assert::AreEqual(cache.GetEntryCount(), 10);
+            for (int i = 0; i < 10; i++)
+                CheckEntry(cache, i, 100);
+        }
+
+        TEST_METHOD(DamagedEntryIsRejected)
+        {
+            TempCacheDirectory dir("DamagedEntryIsRejected");
+            String fileName;
+            {
+                ShaderCache cache;
+                CreateCache(cache, dir);
+                fileName = cache.GetFileName();
+                AddEntries(cache, 0, 4, 256);
+                Assert::IsTrue(cache.Save());
+            }
+            // the last entry's code ends 4 bytes before its binding layout blob
+            auto bytes = File::ReadAllBytes(fileName);
+            List<char> code;
+            List<DescriptorSetInfo> layouts;
+            MakeEntry(3, 256, code, layouts);
+            int64_t codeEnd = bytes.Count() - 4;
+            for (auto & set : layouts)
+            {
+                codeEnd -= 12 + set.Name.Length();
+                for (auto & desc : set.Descriptors)
+                    codeEnd -= 20 + desc.Name.Length();
+            }
+            bytes[(int)codeEnd - 1] ^= 0xFF;
+            File::WriteAllBytes(fileName, bytes.Buffer(), bytes.Count());
+            ShaderCache cache;
+            cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+            Assert::AreEqual(cache.GetEntryCount(), 4);
+            Assert::IsFalse(cache.TryGetEntry(MakeKey(3), code, layouts));
+            CheckEntry(cache, 2, 256);
+            Assert::AreEqual(cache.GetEntryCount(), 3);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(StartupBenchmark)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(StartupBenchmark)
+        {
+            TempCacheDirectory dir("StartupBenchmark");
+            const int entryCount = 2000, codeSize = 12 << 10, usedCount = 200;
+            char message[256];
+            {
+                ShaderCache cache;
+                CreateCache(cache, dir);
+                auto t0 = PerformanceCounter::Start();
+                AddEntries(cache, 0, entryCount, codeSize);
+                Assert::IsTrue(cache.Save());
+                snprintf(message, sizeof(message), "cold: %d entries added and saved in %.2f ms", entryCount, PerformanceCounter::EndSeconds(t0) * 1000.0);
+                Logger::WriteMessage(message);
+            }
+            List<char> code;
+            List<DescriptorSetInfo> layouts;
+            ShaderCache cache;
+            auto t0 = PerformanceCounter::Start();
+            cache.Load(dir.Directory, TargetShadingLanguage::SPIRV);
+            double loadTime = PerformanceCounter::EndSeconds(t0);
+            t0 = PerformanceCounter::Start();
+            for (int i = 0; i < usedCount; i++)
+                Assert::IsTrue(cache.TryGetEntry(MakeKey(i * (entryCount / usedCount)), code, layouts));
+            double firstUseTime = PerformanceCounter::EndSeconds(t0);
+            t0 = PerformanceCounter::Start();
+            for (int i = 0; i < usedCount; i++)
+                Assert::IsTrue(cache.TryGetEntry(MakeKey(i * (entryCount / usedCount)), code, layouts));
+            double hitTime = PerformanceCounter::EndSeconds(t0);
+            snprintf(message, sizeof(message), "warm: load %.3f ms, first use %.2f us, later use %.2f us per entry (%d of %d entries used)",
+                loadTime * 1000.0, firstUseTime * 1e6 / usedCount, hitTime * 1e6 / usedCount, usedCount, entryCount);
+            Logger::WriteMessage(message);
+        }
+    };
+}
@@ -0,0 +1,189 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/LibIO.h"
+#include "CoreLib/Graphics/TextureFile.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace CoreLib::IO;
+using namespace CoreLib::Graphics;
+
+namespace UnitTest
+{
+    TEST_CLASS(TextureFileTest)
+    {
+    private:
+        static void FillRandom(Random & random, ArrayView<unsigned char> data)
+        {
+            for (int i = 0; i < data.Count(); i++)
+                data[i] = (unsigned char)random.Next(0, 256);
+        }
+        // 2-bit color index of texel (x, y) of a BC1 style color block
+        static int ColorIndex(const unsigned char * block, int x, int y)
+        {
+            return (block[4 + y] >> (x * 2)) & 3;
+        }
+        // 3-bit alpha index of texel (x, y) of a BC4 style alpha block
+        static int AlphaIndex(const unsigned char * block, int x, int y)
+        {
+            unsigned long long bits = 0;
+            for (int i = 0; i < 6; i++)
+                bits |= (unsigned long long)block[2 + i] << (i * 8);
+            return (int)((bits >> ((y * 4 + x) * 3)) & 7);
+        }
+        // checks that texel (x, y) of `flipped` has the index texel (x, height - 1 - y) has in `source`
+        static void CheckFlipped(TextureStorageFormat format, const List<unsigned char> & source, const List<unsigned char> & flipped, int width, int height)
+        {
+            int blockSize = format == TextureStorageFormat::BC1 ? 8 : 16;
+            int blocksPerRow = (width + 3) / 4;
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    int sy = height - 1 - y;
+                    auto flippedBlock = flipped.Buffer() + ((y >> 2) * blocksPerRow + (x >> 2)) * blockSize;
+                    auto sourceBlock = source.Buffer() + ((sy >> 2) * blocksPerRow + (x >> 2)) * blockSize;
+                    switch (format)
+                    {
+                    case TextureStorageFormat::BC1:
+                        Assert::AreEqual(ColorIndex(sourceBlock, x & 3, sy & 3), ColorIndex(flippedBlock, x & 3, y & 3));
+                        break;
+                    case TextureStorageFormat::BC3:
+                        Assert::AreEqual(AlphaIndex(sourceBlock, x & 3, sy & 3), AlphaIndex(flippedBlock, x & 3, y & 3));
+                        Assert::AreEqual(ColorIndex(sourceBlock + 8, x & 3, sy & 3), ColorIndex(flippedBlock + 8, x & 3, y & 3));
+                        break;
+                    default:
+                        Assert::AreEqual(AlphaIndex(sourceBlock, x & 3, sy & 3), AlphaIndex(flippedBlock, x & 3, y & 3));
+                        Assert::AreEqual(AlphaIndex(sourceBlock + 8, x & 3, sy & 3), AlphaIndex(flippedBlock + 8, x & 3, y & 3));
+                        break;
+                    }
+                }
+            }
+            // endpoints are not changed by a flip
+            for (int y = 0; y < height; y += 4)
+            {
+                for (int x = 0; x < width; x += 4)
+                {
+                    auto flippedBlock = flipped.Buffer() + ((y >> 2) * blocksPerRow + (x >> 2)) * blockSize;
+                    auto sourceBlock = source.Buffer() + (((height - 1 - y) >> 2) * blocksPerRow + (x >> 2)) * blockSize;
+                    for (int b = 0; b < blockSize; b += 8)
+                    {
+                        int endpointSize = (format == TextureStorageFormat::BC1 || (format == TextureStorageFormat::BC3 && b == 8)) ? 4 : 2;
+                        Assert::IsTrue(memcmp(sourceBlock + b, flippedBlock + b, endpointSize) == 0);
+                    }
+                }
+            }
+        }
+    public:
+        TEST_METHOD(BlockFlipReversesTexelRows)
+        {
+            Random random(5);
+            TextureStorageFormat formats[] = { TextureStorageFormat::BC1, TextureStorageFormat::BC3, TextureStorageFormat::BC5 };
+            int sizes[][2] = { { 16, 16 }, { 12, 8 }, { 8, 4 }, { 4, 2 }, { 2, 1 }, { 1, 3 }, { 20, 36 } };
+            for (auto format : formats)
+            {
+                for (auto & size : sizes)
+                {
+                    Assert::IsTrue(CanFlipTextureRows(format, size[0], size[1]));
+                    List<unsigned char> source, flipped;
+                    source.SetSize((int)GetTextureDataSize(format, size[0], size[1]));
+                    FillRandom(random, source.GetArrayView());
+                    flipped.AddRange(source);
+                    FlipTextureRows(format, flipped.GetArrayView(), size[0], size[1]);
+                    CheckFlipped(format, source, flipped, size[0], size[1]);
+                    // flipping twice restores the data, including the padding rows of partial blocks
+                    FlipTextureRows(format, flipped.GetArrayView(), size[0], size[1]);
+                    Assert::IsTrue(memcmp(source.Buffer(), flipped.Buffer(), source.Count()) == 0);
+                }
+            }
+        }
+
+        TEST_METHOD(UncompressedFlipSwapsRows)
+        {
+            List<unsigned char> data;
+            data.SetSize((int)GetTextureDataSize(TextureStorageFormat::RGBA8, 3, 5));
+            for (int i = 0; i < data.Count(); i++)
+                data[i] = (unsigned char)i;
+            FlipTextureRows(TextureStorageFormat::RGBA8, data.GetArrayView(), 3, 5);
+            for (int y = 0; y < 5; y++)
+            {
+                for (int i = 0; i < 12; i++)
+                    Assert::AreEqual((int)data[y * 12 + i], (4 - y) * 12 + i);
+            }
+        }
+
+        TEST_METHOD(CanFlipRejectsUnsupportedLayouts)
+        {
+            Assert::IsFalse(CanFlipTextureRows(TextureStorageFormat::BC7, 16, 16));
+            Assert::IsFalse(CanFlipTextureRows(TextureStorageFormat::BC6H, 16, 16));
+            Assert::IsFalse(CanFlipTextureRows(TextureStorageFormat::BC1, 16, 6));
+            Assert::IsTrue(CanFlipTextureRows(TextureStorageFormat::BC1, 16, 3));
+            Assert::IsTrue(CanFlipTextureRows(TextureStorageFormat::RGBA8, 16, 6));
+        }
+
+        TEST_METHOD(TopDownFileLoadsBottomUp)
+        {
+            Random random(7);
+            TextureFile texFile;
+            texFile.Allocate(TextureStorageFormat::BC3, 32, 16, 6, 1);
+            FillRandom(random, MakeArrayView(texFile.GetBuffer().Buffer(), (int)texFile.GetArrayStride()));
+            List<unsigned char> bottomUp;
+            bottomUp.AddRange(texFile.GetBuffer().Buffer(), (int)texFile.GetArrayStride());
+            Assert::IsTrue(texFile.FlipRows());
+            Assert::IsTrue(texFile.GetRowOrder() == TextureRowOrder::TopDown);
+
+            RefPtr<MemoryStream> stream = new MemoryStream();
+            texFile.SaveToStream(stream.Ptr());
+            MemoryStream readStream(MakeArrayView((unsigned char*)stream->GetBuffer(), (int)stream->GetBufferSize()));
+            TextureFile loaded(&readStream);
+            Assert::IsTrue(loaded.GetRowOrder() == TextureRowOrder::BottomUp);
+            Assert::AreEqual(loaded.GetMipLevels(), 6);
+            Assert::IsTrue(memcmp(loaded.GetBuffer().Buffer(), bottomUp.Buffer(), bottomUp.Count()) == 0);
+        }
+
+        TEST_METHOD(ReaderMatchesTextureFile)
+        {
+            Random random(11);
+            TextureFile texFile;
+            texFile.Allocate(TextureStorageFormat::BC1, 64, 8, 7, 1);
+            FillRandom(random, MakeArrayView(texFile.GetBuffer().Buffer(), (int)texFile.GetArrayStride()));
+            RefPtr<MemoryStream> stream = new MemoryStream();
+            texFile.SaveToStream(stream.Ptr());
+            MemoryStream readStream(MakeArrayView((unsigned char*)stream->GetBuffer(), (int)stream->GetBufferSize()));
+            TextureFileReader reader(&readStream);
+            Assert::AreEqual(reader.GetHeader().Width, 64);
+            Assert::AreEqual(reader.GetHeader().Height, 8);
+            Assert::AreEqual(reader.GetMipLevels(), 7);
+            List<unsigned char> levelData;
+            for (int level = 0; level < reader.GetMipLevels(); level++)
+            {
+                levelData.SetSize((int)reader.GetLevelSize(level));
+                reader.ReadLevel(levelData.GetArrayView());
+                Assert::IsTrue(memcmp(levelData.Buffer(), texFile.GetBuffer(level).Buffer(), levelData.Count()) == 0);
+            }
+        }
+
+        TEST_METHOD(LegacyHeaderLoads)
+        {
+            // files written before the row order field have a 16 byte header
+            RefPtr<MemoryStream> stream = new MemoryStream();
+            BinaryWriter writer(stream);
+            writer.Write(16);
+            writer.Write(TextureType::Texture2D);
+            writer.Write(TextureStorageFormat::RGBA8);
+            writer.Write(1);
+            writer.Write(2);
+            writer.Write(0);
+            writer.Write(1);
+            writer.Write(8);
+            unsigned char pixels[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+            writer.Write(pixels, 8);
+            MemoryStream readStream(MakeArrayView((unsigned char*)stream->GetBuffer(), (int)stream->GetBufferSize()));
+            TextureFile loaded(&readStream);
+            Assert::AreEqual(loaded.GetWidth(), 1);
+            Assert::AreEqual(loaded.GetHeight(), 2);
+            Assert::IsTrue(loaded.GetRowOrder() == TextureRowOrder::BottomUp);
+            Assert::IsTrue(memcmp(loaded.GetBuffer().Buffer(), pixels, 8) == 0);
+        }
+    };
+}
@@ -0,0 +1,176 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "../GameEngineCore/WideBvh.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+using namespace VectorMath;
+
+namespace UnitTest
+{
+    TEST_CLASS(WideBvhTest)
+    {
+    private:
+        struct Triangle
+        {
+            Vec3 Verts[3];
+        };
+        class CostEvaluator
+        {
+        public:
+            static const int ElementsPerNode = 8;
+            inline float EvalCost(int n1, float a1, int n2, float a2, float area)
+            {
+                return 0.125f + ((float)n1*a1 + (float)n2*a2) / area;
+            }
+        };
+        static Vec3 RandomVec(Random & random, float range)
+        {
+            return Vec3::Create(random.NextFloat(-range, range), random.NextFloat(-range, range), random.NextFloat(-range, range));
+        }
+        static void BuildScene(List<Triangle> & triangles, TriangleBvh4 & bvh, int count)
+        {
+            Random random(11);
+            for (int i = 0; i < count; i++)
+            {
+                Triangle tri;
+                auto center = RandomVec(random, 50.0f);
+                for (int j = 0; j < 3; j++)
+                    tri.Verts[j] = center + RandomVec(random, 3.0f);
+                triangles.Add(tri);
+            }
+            // an axis aligned quad exercises flat boxes and rays parallel to box faces
+            Triangle quad[2];
+            quad[0].Verts[0] = Vec3::Create(-60.0f, -55.0f, -60.0f);
+            quad[0].Verts[1] = Vec3::Create(60.0f, -55.0f, -60.0f);
+            quad[0].Verts[2] = Vec3::Create(60.0f, -55.0f, 60.0f);
+            quad[1].Verts[0] = Vec3::Create(-60.0f, -55.0f, -60.0f);
+            quad[1].Verts[1] = Vec3::Create(60.0f, -55.0f, 60.0f);
+            quad[1].Verts[2] = Vec3::Create(-60.0f, -55.0f, 60.0f);
+            triangles.Add(quad[0]);
+            triangles.Add(quad[1]);
+
+            List<BuildData<Triangle>> elements;
+            elements.SetSize(triangles.Count());
+            for (int i = 0; i < triangles.Count(); i++)
+            {
+                elements[i].Bounds.Init();
+                for (int j = 0; j < 3; j++)
+                    elements[i].Bounds.Union(triangles[i].Verts[j]);
+                elements[i].Element = triangles.Buffer() + i;
+                elements[i].Center = (elements[i].Bounds.Min + elements[i].Bounds.Max) * 0.5f;
+            }
+            Bvh_Build<Triangle> build;
+            CostEvaluator eval;
+            ConstructBvh(build, elements.Buffer(), elements.Count(), eval);
+            bvh.FromBuild(build, triangles.Buffer(), [](const Triangle & tri, int i) { return tri.Verts[i]; });
+        }
+        // scalar reference with the acceptance rules of the lightmap tracer
+        static WideBvhHit BruteForce(List<Triangle> & triangles, const Ray & ray)
+        {
+            WideBvhHit hit;
+            float tMax = ray.tMax;
+            for (int i = 0; i < triangles.Count(); i++)
+            {
+                auto & tri = triangles[i];
+                Vec3 e1 = tri.Verts[1] - tri.Verts[0];
+                Vec3 e2 = tri.Verts[2] - tri.Verts[0];
+                Vec3 s1 = Vec3::Cross(ray.Dir, e2);
+                float invd = 1.0f / Vec3::Dot(s1, e1);
+                Vec3 d = ray.Origin - tri.Verts[0];
+                float b1 = Vec3::Dot(d, s1) * invd;
+                Vec3 s2 = Vec3::Cross(d, e1);
+                float b2 = Vec3::Dot(ray.Dir, s2) * invd;
+                float t = Vec3::Dot(e2, s2) * invd;
+                if (b1 >= 0.0f && b1 <= 1.0f && b2 >= 0.0f && b1 + b2 <= 1.0f && t >= 1e-5f && t <= tMax)
+                {
+                    tMax = t;
+                    hit.Id = i;
+                    hit.T = t;
+                    hit.U = b1;
+                    hit.V = b2;
+                }
+            }
+            return hit;
+        }
+        static Ray RandomRay(Random & random, Vec3 origin)
+        {
+            Ray ray;
+            ray.Origin = origin;
+            ray.Dir = RandomVec(random, 1.0f).Normalize();
+            // some rays are bounded, and some are axis aligned
+            ray.tMax = random.Next(0, 4) == 0 ? random.NextFloat(1.0f, 40.0f) : FLT_MAX;
+            if (random.Next(0, 8) == 0)
+                ray.Dir = Vec3::Create(0.0f, -1.0f, 0.0f);
+            return ray;
+        }
+    public:
+        TEST_METHOD(ClosestHitMatchesBruteForce)
+        {
+            List<Triangle> triangles;
+            TriangleBvh4 bvh;
+            BuildScene(triangles, bvh, 3000);
+            Random random(5);
+            int hitCount = 0;
+            for (int i = 0; i < 256; i++)
+            {
+                auto origin = RandomVec(random, 60.0f);
+                RayPacket4 packet;
+                Ray rays[4];
+                for (int j = 0; j < 4; j++)
+                {
+                    rays[j] = RandomRay(random, origin);
+                    packet.Add(rays[j]);
+                }
+                WideBvhHit packetHits[4];
+                bvh.TraceRays(packet, packetHits);
+                int occlusionMask = bvh.TraceOcclusion(packet);
+                for (int j = 0; j < 4; j++)
+                {
+                    auto expected = BruteForce(triangles, rays[j]);
+                    auto hit = bvh.TraceRay(rays[j]);
+                    Assert::IsTrue(hit.Id == expected.Id);
+                    Assert::IsTrue(hit.T == expected.T);
+                    Assert::IsTrue(hit.U == expected.U && hit.V == expected.V);
+                    Assert::IsTrue(packetHits[j].Id == expected.Id);
+                    Assert::IsTrue(packetHits[j].T == expected.T);
+                    Assert::IsTrue(bvh.TraceOcclusion(rays[j]) == (expected.Id != -1));
+                    Assert::IsTrue(((occlusionMask >> j) & 1) == (expected.Id != -1 ? 1 : 0));
+                    if (expected.Id != -1)
+                        hitCount++;
+                }
+            }
+            // make sure the comparison covers both outcomes
+            Assert::IsTrue(hitCount > 64 && hitCount < 1000);
+        }
+        TEST_METHOD(PartialPacket)
+        {
+            List<Triangle> triangles;
+            TriangleBvh4 bvh;
+            BuildScene(triangles, bvh, 100);
+            Random random(9);
+            for (int i = 0; i < 64; i++)
+            {
+                RayPacket4 packet;
+                Ray rays[3];
+                int count = random.Next(1, 4);
+                for (int j = 0; j < count; j++)
+                {
+                    rays[j] = RandomRay(random, RandomVec(random, 60.0f));
+                    packet.Add(rays[j]);
+                }
+                WideBvhHit hits[4];
+                bvh.TraceRays(packet, hits);
+                int occlusionMask = bvh.TraceOcclusion(packet);
+                Assert::IsTrue((occlusionMask >> count) == 0);
+                for (int j = 0; j < count; j++)
+                {
+                    auto expected = BruteForce(triangles, rays[j]);
+                    Assert::IsTrue(hits[j].Id == expected.Id);
+                    Assert::IsTrue(((occlusionMask >> j) & 1) == (expected.Id != -1 ? 1 : 0));
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "CoreLib/Basic.h"
+#include "CoreLib/JobSystem.h"
+#include "../GameEngineCore/YuvConversion.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CoreLib;
+using namespace GameEngine;
+
+namespace UnitTest
+{
+    TEST_CLASS(YuvConversionTest)
+    {
+    private:
+        struct Picture
+        {
+            List<unsigned char> Data;
+            I420Image Image;
+            Picture(int w, int h)
+            {
+                // strides wider than the picture, filled with a marker that must not be overwritten
+                Image.Width = w;
+                Image.Height = h;
+                Image.YStride = w + 5;
+                Image.UVStride = w / 2 + 3;
+                Data.SetSize(Image.YStride * h + Image.UVStride * h);
+                for (auto & b : Data)
+                    b = 0xCD;
+                Image.Y = Data.Buffer();
+                Image.U = Image.Y + Image.YStride * h;
+                Image.V = Image.U + Image.UVStride * h / 2;
+            }
+        };
+        static List<unsigned char> RandomImage(Random & random, int stride, int height)
+        {
+            List<unsigned char> image;
+            image.SetSize(stride * height);
+            for (auto & b : image)
+                b = (unsigned char)random.Next(0, 256);
+            // include saturated colors
+            for (int i = 0; i + 3 < image.Count(); i += 4 * 7)
+            {
+                image[i] = 255;
+                image[i + 1] = 0;
+                image[i + 2] = (i & 8) ? 255 : 0;
+            }
+            return image;
+        }
+        static void CheckConversion(Random & random, int srcWidth, int srcHeight, int width, int height)
+        {
+            int srcStride = srcWidth * 4 + 12;
+            auto image = RandomImage(random, srcStride, srcHeight);
+            for (int matrix = 0; matrix < 2; matrix++)
+            {
+                for (int range = 0; range < 2; range++)
+                {
+                    for (int flip = 0; flip < 2; flip++)
+                    {
+                        YuvConversionOptions options;
+                        options.Matrix = matrix ? YuvColorMatrix::BT709 : YuvColorMatrix::BT601;
+                        options.Range = range ? YuvColorRange::Full : YuvColorRange::Limited;
+                        options.FlipVertical = flip != 0;
+                        Picture expected(width, height);
+                        ConvertRGBAToI420Reference(image.Buffer(), srcWidth, srcHeight, srcStride, expected.Image, options);
+                        // every kernel this CPU can run must be bit-exact
+                        for (int kernel = (int)YuvConversionKernel::SSE41; kernel <= (int)GetSupportedYuvConversionKernel(); kernel++)
+                        {
+                            options.MaxKernel = (YuvConversionKernel)kernel;
+                            Picture actual(width, height);
+                            ConvertRGBAToI420(image.Buffer(), srcWidth, srcHeight, srcStride, actual.Image, options);
+                            Assert::IsTrue(memcmp(expected.Data.Buffer(), actual.Data.Buffer(), expected.Data.Count()) == 0);
+                        }
+                    }
+                }
+            }
+        }
+        static void ConvertPixel(const unsigned char * rgba, YuvConversionOptions options, unsigned char yuv[3])
+        {
+            // a uniform 2x2 block has the color's chroma
+            unsigned char image[16];
+            for (int i = 0; i < 4; i++)
+                memcpy(image + i * 4, rgba, 4);
+            unsigned char planes[6];
+            I420Image picture;
+            picture.Width = picture.Height = 2;
+            picture.YStride = 2;
+            picture.UVStride = 1;
+            picture.Y = planes;
+            picture.U = planes + 4;
+            picture.V = planes + 5;
+            ConvertRGBAToI420Reference(image, 2, 2, 8, picture, options);
+            yuv[0] = planes[0];
+            yuv[1] = planes[4];
+            yuv[2] = planes[5];
+        }
+    public:
+        TEST_METHOD(VectorizedMatchesReference)
+        {
+            Random random(11);
+            CheckConversion(random, 64, 32, 64, 32);
+            // widths that leave scalar tails, pictures larger and smaller than the source
+            CheckConversion(random, 70, 34, 70, 34);
+            CheckConversion(random, 37, 19, 48, 24);
+            CheckConversion(random, 100, 60, 62, 40);
+            CheckConversion(random, 6, 2, 22, 6);
+        }
+        TEST_METHOD(ParallelBandsMatchReference)
+        {
+            Threading::JobSystem::Init(3);
+            Random random(12);
+            CheckConversion(random, 1920, 1080, 1920, 1080);
+            CheckConversion(random, 333, 517, 334, 518);
+            Threading::JobSystem::Destroy();
+        }
+        TEST_METHOD(ReferenceMatchesColorSpaceFormulas)
+        {
+            Random random(13);
+            for (int i = 0; i < 2000; i++)
+            {
+                unsigned char rgba[4] = { (unsigned char)random.Next(0, 256), (unsigned char)random.Next(0, 256),
+                    (unsigned char)random.Next(0, 256), 255 };
+                if (i < 256)
+                    rgba[0] = rgba[1] = rgba[2] = (unsigned char)i;
+                for (int matrix = 0; matrix < 2; matrix++)
+                {
+                    for (int range = 0; range < 2; range++)
+                    {
+                        YuvConversionOptions options;
+                        options.Matrix = matrix ? YuvColorMatrix::BT709 : YuvColorMatrix::BT601;
+                        options.Range = range ? YuvColorRange::Full : YuvColorRange::Limited;
+                        double kr = matrix ? 0.2126 : 0.299, kb = matrix ? 0.0722 : 0.114;
+                        double yScale = range ? 1.0 : 219.0 / 255.0, cScale = range ? 1.0 : 224.0 / 255.0;
+                        double yOffset = range ? 0.0 : 16.0;
+                        double lum = kr * rgba[0] + (1.0 - kr - kb) * rgba[1] + kb * rgba[2];
+                        double y = yOffset + yScale * lum;
+                        double u = 128.0 + cScale * (rgba[2] - lum) / (2.0 * (1.0 - kb));
+                        double v = 128.0 + cScale * (rgba[0] - lum) / (2.0 * (1.0 - kr));
+                        unsigned char yuv[3];
+                        ConvertPixel(rgba, options, yuv);
+                        Assert::IsTrue(fabs(yuv[0] - y) <= 1.0);
+                        Assert::IsTrue(fabs(yuv[1] - u) <= 1.0);
+                        Assert::IsTrue(fabs(yuv[2] - v) <= 1.0);
+                        if (rgba[0] == rgba[1] && rgba[1] == rgba[2])
+                        {
+                            Assert::IsTrue(yuv[1] == 128 && yuv[2] == 128);
+                            if (rgba[0] == 255)
+                                Assert::IsTrue(yuv[0] == (range ? 255 : 235));
+                            if (rgba[0] == 0)
+                                Assert::IsTrue(yuv[0] == (range ? 0 : 16));
+                        }
+                    }
+                }
+            }
+        }
+        TEST_METHOD(FlipReadsRowsBottomUp)
+        {
+            Random random(14);
+            int w = 40, h = 18, stride = w * 4;
+            auto image = RandomImage(random, stride, h);
+            List<unsigned char> flipped;
+            flipped.SetSize(image.Count());
+            for (int i = 0; i < h; i++)
+                memcpy(flipped.Buffer() + i * stride, image.Buffer() + (h - 1 - i) * stride, stride);
+            YuvConversionOptions options;
+            Picture expected(w, h), actual(w, h);
+            ConvertRGBAToI420(image.Buffer(), w, h, stride, expected.Image, options);
+            options.FlipVertical = true;
+            ConvertRGBAToI420(flipped.Buffer(), w, h, stride, actual.Image, options);
+            Assert::IsTrue(memcmp(expected.Data.Buffer(), actual.Data.Buffer(), expected.Data.Count()) == 0);
+        }
+    };
+}